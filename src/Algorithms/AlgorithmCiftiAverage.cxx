@@ -21,12 +21,13 @@
 #include "AlgorithmCiftiAverage.h"
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
-#include "CaretLogger.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
-#include "MathFunctions.h"
+#include "CiftiGroupAverager.h"
+#include "DataFileException.h"
 
-#include <cmath>
+#include <fstream>
+#include <string>
 
 using namespace caret;
 using namespace std;
@@ -57,11 +58,30 @@ OperationParameters* AlgorithmCiftiAverage::getParameters()
     OptionalParameter* weightOpt = ciftiOpt->createOptionalParameter(1, "-weight", "give a weight for this file");
     weightOpt->addDoubleParameter(1, "weight", "the weight to use");
     
+    OptionalParameter* listOpt = ret->createOptionalParameter(4, "-file-list", "specify the input files in a text file instead");
+    listOpt->addStringParameter(1, "list-file", "text file containing the input file names, one per line");
+    
+    OptionalParameter* listWeightOpt = listOpt->createOptionalParameter(2, "-weights", "give weights for the listed files");
+    listWeightOpt->addStringParameter(1, "weight-file", "text file containing one weight per line, in the same order as the list file");
+    
+    OptionalParameter* maxOpenOpt = listOpt->createOptionalParameter(3, "-max-open-files", "limit the number of listed files that are kept open, default 256");
+    maxOpenOpt->addIntegerParameter(1, "number", "the maximum number of listed files to keep open");
+    
+    OptionalParameter* memLimitOpt = ret->createOptionalParameter(5, "-mem-limit", "restrict memory usage");
+    memLimitOpt->addDoubleParameter(1, "limit-GB", "memory limit in gigabytes");
+    
     ret->setHelpText(
         AString("Averages cifti files together.  ") +
         "Files without -weight specified are given a weight of 1.  " +
         "If -exclude-outliers is specified, at each element, the data across all files is taken as a set, its unweighted mean and sample standard deviation are found, " +
-        "and values outside the specified number of standard deviations are excluded from the (potentially weighted) average at that element."
+        "and values outside the specified number of standard deviations are excluded from the (potentially weighted) average at that element.\n\n" +
+        "Blocks of rows are read from several input files at once, while previously read rows are added to the average.  " +
+        "-mem-limit controls the size of these blocks, the default is 1 GB.  " +
+        "To average more files than can be open at the same time, use -file-list instead of -cifti: " +
+        "if there are more listed files than the -max-open-files limit, each file is opened only while a block of rows is read from it.  " +
+        "In this case, a larger -mem-limit reduces how often files are reopened, this matters most with -exclude-outliers, " +
+        "which needs the block from every file at the same time.  " +
+        "-file-list cannot be combined with -cifti."
     );
     return ret;
 }
@@ -84,15 +104,94 @@ void AlgorithmCiftiAverage::useParameters(OperationParameters* myParams, Progres
         }
     }
     OptionalParameter* excludeOpt = myParams->getOptionalParameter(2);
+    float memLimitGB = -1.0f;
+    OptionalParameter* memLimitOpt = myParams->getOptionalParameter(5);
+    if (memLimitOpt->m_present)
+    {
+        memLimitGB = (float)memLimitOpt->getDouble(1);
+        if (memLimitGB < 0.0f)
+        {
+            throw AlgorithmException("memory limit cannot be negative");
+        }
+    }
+    OptionalParameter* listOpt = myParams->getOptionalParameter(4);
+    if (listOpt->m_present)
+    {
+        if (!ciftiList.empty())
+        {
+            throw AlgorithmException("-file-list cannot be combined with -cifti");
+        }
+        AString listFileName = listOpt->getString(1);
+        ifstream listFile(listFileName.toLocal8Bit().constData());
+        if (!listFile.good())
+        {
+            throw AlgorithmException("error reading file list '" + listFileName + "'");
+        }
+        vector<AString> ciftiNames;
+        string line;
+        while (getline(listFile, line))
+        {
+            AString fileName = AString(line.c_str()).trimmed();
+            if (!fileName.isEmpty()) ciftiNames.push_back(fileName);
+        }
+        vector<float> listWeights;
+        vector<float>* listWeightsPtr = NULL;
+        OptionalParameter* listWeightOpt = listOpt->getOptionalParameter(2);
+        if (listWeightOpt->m_present)
+        {
+            AString weightFileName = listWeightOpt->getString(1);
+            ifstream weightFile(weightFileName.toLocal8Bit().constData());
+            if (!weightFile.good())
+            {
+                throw AlgorithmException("error reading weight file '" + weightFileName + "'");
+            }
+            float weight;
+            while (weightFile >> weight)
+            {
+                listWeights.push_back(weight);
+            }
+            if (!weightFile.eof())
+            {
+                throw AlgorithmException("weight file '" + weightFileName + "' contains a value that is not a number");
+            }
+            listWeightsPtr = &listWeights;
+        }
+        int maxOpenFiles = 256;
+        OptionalParameter* maxOpenOpt = listOpt->getOptionalParameter(3);
+        if (maxOpenOpt->m_present)
+        {
+            maxOpenFiles = (int)maxOpenOpt->getInteger(1);
+        }
+        if (excludeOpt->m_present)
+        {
+            AlgorithmCiftiAverage(myProgObj, ciftiNames, ciftiOut, listWeightsPtr, true, excludeOpt->getDouble(1), excludeOpt->getDouble(2), memLimitGB, maxOpenFiles);
+        } else {
+            AlgorithmCiftiAverage(myProgObj, ciftiNames, ciftiOut, listWeightsPtr, false, 0.0f, 0.0f, memLimitGB, maxOpenFiles);
+        }
+        return;
+    }
     if (excludeOpt->m_present)
     {
-        AlgorithmCiftiAverage(myProgObj, ciftiList, excludeOpt->getDouble(1), excludeOpt->getDouble(2), ciftiOut, &weights);
+        AlgorithmCiftiAverage(myProgObj, ciftiList, excludeOpt->getDouble(1), excludeOpt->getDouble(2), ciftiOut, &weights, memLimitGB);
     } else {
-        AlgorithmCiftiAverage(myProgObj, ciftiList, ciftiOut, &weights);
+        AlgorithmCiftiAverage(myProgObj, ciftiList, ciftiOut, &weights, memLimitGB);
+    }
+}
+
+namespace
+{
+    int64_t bufferBytesForLimit(const float& memLimitGB)
+    {
+        if (memLimitGB >= 0.0f)
+        {
+            return (int64_t)(memLimitGB * 1024 * 1024 * 1024);
+        }
+        return 1024 * (int64_t)(1 << 20);//same as the CiftiGroupAverager default
     }
 }
 
-AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<const CiftiFile*>& ciftiList, CiftiFile* ciftiOut, const vector<float>* weightsPtr) : AbstractAlgorithm(myProgObj)
+AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<const CiftiFile*>& ciftiList, CiftiFile* ciftiOut, const vector<float>* weightsPtr,
+                                             const float& memLimitGB) : AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     if (ciftiList.size() == 0)
@@ -103,69 +202,23 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
     {
         throw AlgorithmException("number of weights doesn't match number of input cifti files");
     }
-    CaretAssert(ciftiList[0] != NULL);
-    CiftiXML baseXML = ciftiList[0]->getCiftiXML();
-    if (baseXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti average currently only supports 2D files");
-    int numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW), numFiles = (int)ciftiList.size();
-    for (int i = 1; i < numFiles; ++i)
+    CiftiGroupAverager myAverager(bufferBytesForLimit(memLimitGB));
+    for (int i = 0; i < (int)ciftiList.size(); ++i)
     {
         CaretAssert(ciftiList[i] != NULL);
-        if (!baseXML.approximateMatch(ciftiList[i]->getCiftiXML()))//requires at least length to match, often more restrictive
-        {
-            throw AlgorithmException("cifti file '" + ciftiList[i]->getFileName() + "' does not match earlier inputs");
-        }
+        myAverager.addInput(ciftiList[i], (weightsPtr == NULL ? 1.0f : (*weightsPtr)[i]));
     }
-    ciftiOut->setCiftiXML(baseXML);
-    vector<double> accum(rowSize);
-    vector<float> myrow(rowSize);
-    for (int i = 0; i < numRows; ++i)
+    try
     {
-        vector<double> weightaccum(rowSize, 0.0);
-        for (int j = 0; j < rowSize; ++j)
-        {
-            accum[j] = 0.0;
-        }
-        for (int j = 0; j < numFiles; ++j)
-        {
-            ciftiList[j]->getRow(myrow.data(), i);
-            if (weightsPtr == NULL)
-            {
-                for (int k = 0; k < rowSize; ++k)
-                {
-                    if (MathFunctions::isNumeric(myrow[k]))
-                    {
-                        weightaccum[k] += 1.0;
-                        accum[k] += myrow[k];
-                    }
-                }
-            } else {
-                float weight = (*weightsPtr)[j];
-                for (int k = 0; k < rowSize; ++k)
-                {
-                    if (MathFunctions::isNumeric(myrow[k]))
-                    {
-                        weightaccum[k] += weight;
-                        accum[k] += myrow[k] * weight;
-                    }
-                }
-            }
-        }
-        for (int k = 0; k < rowSize; ++k)
-        {
-            if (weightaccum[k] != 0.0)
-            {
-                myrow[k] = accum[k] / weightaccum[k];
-            } else {
-                myrow[k] = 0.0f;
-            }
-        }
-        ciftiOut->setRow(myrow.data(), i);
+        myAverager.run(ciftiOut);
+    } catch (DataFileException& e) {
+        throw AlgorithmException(e);
     }
 }
 
 AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<const CiftiFile*>& ciftiList,
                                              const float& sigmaBelow, const float& sigmaAbove,
-                                             CiftiFile* ciftiOut, const std::vector<float>* weightsPtr): AbstractAlgorithm(myProgObj)
+                                             CiftiFile* ciftiOut, const std::vector<float>* weightsPtr, const float& memLimitGB): AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
     if (ciftiList.size() < 2)
@@ -176,89 +229,56 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
     {
         throw AlgorithmException("number of weights doesn't match number of input cifti files");
     }
-    CaretAssert(ciftiList[0] != NULL);
-    CiftiXML baseXML = ciftiList[0]->getCiftiXML();
-    if (baseXML.getNumberOfDimensions() != 2) throw AlgorithmException("cifti average currently only supports 2D files");
-    int numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowSize = baseXML.getDimensionLength(CiftiXML::ALONG_ROW), numFiles = (int)ciftiList.size();
-    for (int i = 1; i < numFiles; ++i)
+    CiftiGroupAverager myAverager(bufferBytesForLimit(memLimitGB));
+    for (int i = 0; i < (int)ciftiList.size(); ++i)
     {
         CaretAssert(ciftiList[i] != NULL);
-        if (!baseXML.approximateMatch(ciftiList[i]->getCiftiXML()))
-        {
-            throw AlgorithmException("cifti files do not match");
-        }
+        myAverager.addInput(ciftiList[i], (weightsPtr == NULL ? 1.0f : (*weightsPtr)[i]));
     }
-    bool haveWarned = false;
-    ciftiOut->setCiftiXML(baseXML);
-    vector<vector<float> > myrows(numFiles, vector<float>(rowSize));
-    for (int i = 0; i < numRows; ++i)
+    myAverager.setOutlierExclusion(sigmaBelow, sigmaAbove);
+    try
     {
-        for (int j = 0; j < numFiles; ++j)
-        {
-            ciftiList[j]->getRow(myrows[j].data(), i);
-        }
-        vector<float> outrow(rowSize);
-        for (int k = 0; k < rowSize; ++k)
-        {
-            double accum = 0.0;
-            double weightaccum = 0.0;
-            int nonnumeric = 0;
-            for (int j = 0; j < numFiles; ++j)
-            {
-                if (MathFunctions::isNumeric(myrows[j][k]))
-                {
-                    accum += myrows[j][k];
-                } else {
-                    ++nonnumeric;
-                }
-            }
-            if (nonnumeric >= numFiles - 1)
-            {
-                if (!haveWarned)
-                {
-                    CaretLogWarning("found element where less than 2 files have numeric values");
-                    haveWarned = true;
-                }
-                outrow[k] = 0.0f;
-            } else {
-                float mean = accum / (numFiles - nonnumeric);
-                accum = 0.0;
-                for (int j = 0; j < numFiles; ++j)
-                {
-                    if (MathFunctions::isNumeric(myrows[j][k]))
-                    {
-                        float temp = myrows[j][k] - mean;
-                        accum += temp * temp;
-                    }
-                }
-                float stdev = sqrt(accum / (numFiles - 1 - nonnumeric));
-                float cutoffLow = mean - sigmaBelow * stdev;
-                float cutoffHigh = mean + sigmaAbove * stdev;
-                accum = 0.0;
-                for (int j = 0; j < numFiles; ++j)
-                {
-                    if (myrows[j][k] > cutoffLow && myrows[j][k] < cutoffHigh)//implicitly excludes NaN and inf
-                    {
-                        if (weightsPtr != NULL)
-                        {
-                            float weight = (*weightsPtr)[j];
-                            accum += myrows[j][k] * weight;
-                            weightaccum += weight;
-                        } else {
-                            accum += myrows[j][k];
-                            weightaccum += 1.0;
-                        }
-                    }
-                }
-                if (weightaccum != 0.0)
-                {
-                    outrow[k] = accum / weightaccum;
-                } else {
-                    outrow[k] = 0.0f;
-                }
-            }
-        }
-        ciftiOut->setRow(outrow.data(), i);
+        myAverager.run(ciftiOut);
+    } catch (DataFileException& e) {
+        throw AlgorithmException(e);
+    }
+}
+
+AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<AString>& ciftiNames, CiftiFile* ciftiOut, const vector<float>* weightsPtr,
+                                             const bool& excludeOutliers, const float& sigmaBelow, const float& sigmaAbove,
+                                             const float& memLimitGB, const int& maxOpenFiles) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    if (ciftiNames.size() == 0)
+    {
+        throw AlgorithmException("no files specified");
+    }
+    if (excludeOutliers && ciftiNames.size() < 2)
+    {
+        throw AlgorithmException("fewer than 2 files specified with outlier exclusion");
+    }
+    if (weightsPtr != NULL && ciftiNames.size() != weightsPtr->size())
+    {
+        throw AlgorithmException("number of weights doesn't match number of input cifti files");
+    }
+    if (maxOpenFiles < 1)
+    {
+        throw AlgorithmException("maximum number of open files must be positive");
+    }
+    CiftiGroupAverager myAverager(bufferBytesForLimit(memLimitGB), maxOpenFiles);
+    for (int i = 0; i < (int)ciftiNames.size(); ++i)
+    {
+        myAverager.addInput(ciftiNames[i], (weightsPtr == NULL ? 1.0f : (*weightsPtr)[i]));
+    }
+    if (excludeOutliers)
+    {
+        myAverager.setOutlierExclusion(sigmaBelow, sigmaAbove);
+    }
+    try
+    {
+        myAverager.run(ciftiOut);
+    } catch (DataFileException& e) {
+        throw AlgorithmException(e);
     }
 }
 
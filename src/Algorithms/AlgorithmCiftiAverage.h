@@ -33,8 +33,13 @@ namespace caret {
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
-        AlgorithmCiftiAverage(ProgressObject* myProgObj, const std::vector<const CiftiFile*>& ciftiList, CiftiFile* ciftiOut, const std::vector<float>* weightsPtr = NULL);
-        AlgorithmCiftiAverage(ProgressObject* myProgObj, const std::vector<const CiftiFile*>& ciftiList, const float& sigmaBelow, const float& sigmaAbove, CiftiFile* ciftiOut, const std::vector<float>* weightsPtr = NULL);
+        AlgorithmCiftiAverage(ProgressObject* myProgObj, const std::vector<const CiftiFile*>& ciftiList, CiftiFile* ciftiOut, const std::vector<float>* weightsPtr = NULL,
+                              const float& memLimitGB = -1.0f);
+        AlgorithmCiftiAverage(ProgressObject* myProgObj, const std::vector<const CiftiFile*>& ciftiList, const float& sigmaBelow, const float& sigmaAbove, CiftiFile* ciftiOut, const std::vector<float>* weightsPtr = NULL,
+                              const float& memLimitGB = -1.0f);
+        ///opens the inputs only as needed, keeping at most maxOpenFiles of them open at once
+        AlgorithmCiftiAverage(ProgressObject* myProgObj, const std::vector<AString>& ciftiNames, CiftiFile* ciftiOut, const std::vector<float>* weightsPtr,
+                              const bool& excludeOutliers, const float& sigmaBelow, const float& sigmaAbove, const float& memLimitGB = -1.0f, const int& maxOpenFiles = 256);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
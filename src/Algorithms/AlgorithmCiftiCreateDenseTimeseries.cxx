@@ -24,11 +24,13 @@
 #include "CaretLogger.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiStreamingMerger.h"
 #include "GiftiLabelTable.h"
 #include "MetricFile.h"
 #include "StructureEnum.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <cmath>
@@ -36,6 +38,45 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    ///copies one element of each map into each output row, for rows belonging to one model
+    class MapValueSource : public CiftiStreamingMerger::RowSource
+    {
+        vector<pair<int64_t, int64_t> > m_rowOffsets;//cifti row, element offset within each map, sorted by row
+        vector<const float*> m_mapData;
+    public:
+        MapValueSource(const vector<pair<int64_t, int64_t> >& rowOffsets, const vector<const float*>& mapData) : m_rowOffsets(rowOffsets), m_mapData(mapData)
+        { }
+        void fillRows(float* block, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength)
+        {
+            const int numMaps = (int)m_mapData.size();
+            CaretAssert(numMaps <= rowLength);
+            vector<pair<int64_t, int64_t> >::const_iterator iter = lower_bound(m_rowOffsets.begin(), m_rowOffsets.end(), make_pair(firstRow, (int64_t)-1));
+            for (; iter != m_rowOffsets.end() && iter->first < firstRow + numRows; ++iter)
+            {
+                float* outRow = block + (iter->first - firstRow) * rowLength;
+                for (int t = 0; t < numMaps; ++t)
+                {
+                    outRow[t] = m_mapData[t][iter->second];
+                }
+            }
+        }
+    };
+    
+    ///split a model into pieces so that a single large model still gets filled on several threads
+    void addMapValueSources(CiftiStreamingMerger& merger, vector<pair<int64_t, int64_t> >& rowOffsets, const vector<const float*>& mapData)
+    {
+        const int64_t PIECE_ROWS = 2048;
+        sort(rowOffsets.begin(), rowOffsets.end());
+        for (int64_t start = 0; start < (int64_t)rowOffsets.size(); start += PIECE_ROWS)
+        {
+            int64_t end = min(start + PIECE_ROWS, (int64_t)rowOffsets.size());
+            merger.addSource(new MapValueSource(vector<pair<int64_t, int64_t> >(rowOffsets.begin() + start, rowOffsets.begin() + end), mapData));
+        }
+    }
+}
+
 AString AlgorithmCiftiCreateDenseTimeseries::getCommandSwitch()
 {
     return "-cifti-create-dense-timeseries";
@@ -232,8 +273,8 @@ AlgorithmCiftiCreateDenseTimeseries::AlgorithmCiftiCreateDenseTimeseries(Progres
     seriesMap.setLength(numMaps);
     myXML.setMap(CiftiXML::ALONG_ROW, seriesMap);
     myCiftiOut->setCiftiXML(myXML);
-    CaretArray<float> temprow(numMaps);
     const CiftiBrainModelsMap& myDenseMap = myXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
+    CiftiStreamingMerger myMerger(myCiftiOut);//fills blocks of rows from all models concurrently, writes them in order
     vector<StructureEnum::Enum> surfStructs = myDenseMap.getSurfaceStructureList();
     for (int whichStruct = 0; whichStruct < (int)surfStructs.size(); ++whichStruct)
     {
@@ -253,24 +294,34 @@ AlgorithmCiftiCreateDenseTimeseries::AlgorithmCiftiCreateDenseTimeseries(Progres
             default:
                 CaretAssert(false);
         }
-        for (int64_t i = 0; i < (int)surfMap.size(); ++i)
+        vector<const float*> mapData(numMaps);
+        for (int t = 0; t < numMaps; ++t)
         {
-            for (int t = 0; t < numMaps; ++t)
-            {
-                temprow[t] = dataMetric->getValue(surfMap[i].m_surfaceNode, t);
-            }
-            myCiftiOut->setRow(temprow, surfMap[i].m_ciftiIndex);
+            mapData[t] = dataMetric->getValuePointerForColumn(t);
+        }
+        vector<pair<int64_t, int64_t> > rowOffsets(surfMap.size());
+        for (int64_t i = 0; i < (int64_t)surfMap.size(); ++i)
+        {
+            rowOffsets[i] = make_pair(surfMap[i].m_ciftiIndex, surfMap[i].m_surfaceNode);
         }
+        addMapValueSources(myMerger, rowOffsets, mapData);
     }
     vector<CiftiBrainModelsMap::VolumeMap> volMap = myDenseMap.getFullVolumeMap();//we don't need to know which voxel is from which structure
-    for (int64_t i = 0; i < (int)volMap.size(); ++i)
+    if (!volMap.empty())
     {
+        vector<const float*> mapData(numMaps);
         for (int t = 0; t < numMaps; ++t)
         {
-            temprow[t] = myVol->getValue(volMap[i].m_ijk, t);
+            mapData[t] = myVol->getFrame(t);
+        }
+        vector<pair<int64_t, int64_t> > rowOffsets(volMap.size());
+        for (int64_t i = 0; i < (int64_t)volMap.size(); ++i)
+        {
+            rowOffsets[i] = make_pair(volMap[i].m_ciftiIndex, myVol->getIndex(volMap[i].m_ijk));
         }
-        myCiftiOut->setRow(temprow, volMap[i].m_ciftiIndex);
+        addMapValueSources(myMerger, rowOffsets, mapData);
     }
+    myMerger.run();
 }
 
 CiftiBrainModelsMap AlgorithmCiftiCreateDenseTimeseries::makeDenseMapping(const VolumeFile* myVol, const VolumeFile* myVolLabel,
@@ -21,6 +21,7 @@
 #include "AlgorithmCiftiParcellate.h"
 #include "AlgorithmException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
@@ -29,6 +30,7 @@
 #include "ReductionOperation.h"
 #include "SurfaceFile.h"
 
+#include <algorithm>
 #include <cmath>
 #include <map>
 
@@ -52,7 +54,7 @@ OperationParameters* AlgorithmCiftiParcellate::getParameters()
     
     ret->addCiftiParameter(2, "cifti-label", "a cifti label file to use for the parcellation");
     
-    ret->addStringParameter(3, "direction", "which mapping to parcellate (integer, ROW, or COLUMN)");
+    ret->addStringParameter(3, "direction", "which mapping to parcellate (integer, ROW, COLUMN, or BOTH)");
     
     ret->addCiftiOutputParameter(4, "cifti-out", "output cifti file");
     
@@ -97,7 +99,7 @@ OperationParameters* AlgorithmCiftiParcellate::getParameters()
         "If -legacy-mode is specified, parcels will be defined as the overlap between a label and the data, with no errors for missing data vertices or voxels, and empty parcels discarded.  " +
         CiftiXML::directionFromStringExplanation() + "  " +
         "For dtseries or dscalar, use COLUMN.  " +
-        "If you are parcellating a dconn in both directions, parcellating by ROW first will use much less memory.\n\n" +
+        "To parcellate a dconn in both directions, use BOTH, which parcellates each row as it is read and does not need a dense intermediate file.\n\n" +
         "The parameter to the -method option must be one of the following:\n\n" + ReductionOperation::getHelpInfo() +
         "\nThe -*-weights options are mutually exclusive and may only be used with MEAN (default), SUM, STDEV, SAMPSTDEV, VARIANCE, MEDIAN, or MODE (default for label data)."
     );
@@ -108,7 +110,11 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
 {
     CiftiFile* myCiftiIn = myParams->getCifti(1);
     CiftiFile* myCiftiLabel = myParams->getCifti(2);
-    int direction = CiftiXML::directionFromString(myParams->getString(3));
+    int direction = AlgorithmCiftiParcellate::BOTH_DIRECTIONS;
+    if (myParams->getString(3) != "BOTH")
+    {
+        direction = CiftiXML::directionFromString(myParams->getString(3));
+    }
     CiftiFile* myCiftiOut = myParams->getOutputCifti(4);
     const CiftiXML& myXML = myCiftiIn->getCiftiXML();
     vector<int64_t> dims = myXML.getDimensions();
@@ -163,9 +169,11 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
     }
     if (spatialWeightOpt->m_present)
     {
-        if (direction >= myXML.getNumberOfDimensions()) throw AlgorithmException("input cifti file does not have the specified dimension");
-        if (myXML.getMappingType(direction) != CiftiMappingType::BRAIN_MODELS) throw AlgorithmException("input cifti file does not have brain models mapping type in specified direction");
-        CiftiBrainModelsMap myDenseMap = myXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
+        if (direction != AlgorithmCiftiParcellate::BOTH_DIRECTIONS)
+        {
+            if (direction >= myXML.getNumberOfDimensions()) throw AlgorithmException("input cifti file does not have the specified dimension");
+            if (myXML.getMappingType(direction) != CiftiMappingType::BRAIN_MODELS) throw AlgorithmException("input cifti file does not have brain models mapping type in specified direction");
+        }
         OptionalParameter* leftSurfOpt = spatialWeightOpt->getOptionalParameter(1);
         OptionalParameter* rightSurfOpt = spatialWeightOpt->getOptionalParameter(2);
         OptionalParameter* cerebSurfOpt = spatialWeightOpt->getOptionalParameter(3);
@@ -237,274 +245,395 @@ void AlgorithmCiftiParcellate::useParameters(OperationParameters* myParams, Prog
                              legacyMode, emptyFillValue, emptyMaskOut);
 }
 
-AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
-                                                   const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric,
-                                                   const bool& legacyMode, const float& emptyFillVal, CiftiFile* emptyMaskOut) : AbstractAlgorithm(myProgObj)
+const int AlgorithmCiftiParcellate::BOTH_DIRECTIONS;
+
+namespace
 {
-    LevelProgress myProgress(myProgObj);
-    CaretAssert(direction >= 0);
-    const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
-    const CiftiXML& myLabelXML = myCiftiLabel->getCiftiXML();
-    vector<int64_t> dims = myInputXML.getDimensions();
-    if (direction >= (int)dims.size()) throw AlgorithmException("specified direction doesn't exist in input file");
-    if (myInputXML.getMappingType(direction) != CiftiMappingType::BRAIN_MODELS)
-    {
-        throw AlgorithmException("input cifti file does not have brain models mapping type in specified direction");
-    }
-    if (myLabelXML.getNumberOfDimensions() != 2 ||
-        myLabelXML.getMappingType(CiftiXML::ALONG_ROW) != CiftiMappingType::LABELS ||
-        myLabelXML.getMappingType(CiftiXML::ALONG_COLUMN) != CiftiMappingType::BRAIN_MODELS)
+    const int64_t PARCELLATE_BLOCK_BYTES = 64 * (int64_t)(1 << 20);//how much input to read at a time before reducing it in parallel
+    const int64_t PARCELLATE_CHUNK_COLUMNS = 4096;//long rows are split into chunks of this many columns to have enough parallel work
+    
+    struct ParcelOperator
+    {//sparse (CSR) form of the parcellation of one dimension, the members of each parcel are in increasing dense index order
+        CiftiParcelsMap m_parcelMap;
+        vector<int> m_indexToParcel;
+        vector<int64_t> m_offsets;//parcel i has members m_members[m_offsets[i]] through m_members[m_offsets[i + 1] - 1]
+        vector<int64_t> m_members;
+        vector<float> m_weights;//same order as m_members, empty if unweighted
+        int getNumberOfParcels() const { return (int)m_offsets.size() - 1; }
+        int64_t getCount(const int& parcel) const { return m_offsets[parcel + 1] - m_offsets[parcel]; }
+        const float* getWeights(const int& parcel) const { return m_weights.empty() ? NULL : m_weights.data() + m_offsets[parcel]; }
+    };
+    
+    void buildOperator(ParcelOperator& myOp, const CiftiFile* myCiftiLabel, const CiftiBrainModelsMap& inputDense, const bool& legacyMode)
     {
-        throw AlgorithmException("input cifti label file has the wrong mapping types");
-    }
-    const CiftiBrainModelsMap& inputDense = myInputXML.getBrainModelsMap(direction);
-    const CiftiBrainModelsMap& labelDense = myLabelXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
-    if (inputDense.hasVolumeData())
-    {//don't check volume space if direction doesn't have volume data
-        if (labelDense.hasVolumeData() && !inputDense.getVolumeSpace().matches(labelDense.getVolumeSpace()))
+        myOp.m_parcelMap = AlgorithmCiftiParcellate::parcellateMapping(myCiftiLabel, inputDense, myOp.m_indexToParcel, legacyMode);
+        int numParcels = myOp.m_parcelMap.getLength();
+        if (numParcels < 1)
         {
-            throw AlgorithmException("input cifti files must have the same volume space");
+            throw AlgorithmException("no parcels found, output file would be empty, aborting");
         }
-    }
-    vector<int> indexToParcel;
-    CiftiXML myOutXML = myInputXML;
-    CiftiParcelsMap outParcelMap = parcellateMapping(myCiftiLabel, inputDense, indexToParcel, legacyMode);
-    int numParcels = outParcelMap.getLength();
-    if (numParcels < 1)
-    {
-        throw AlgorithmException("no parcels found, output file would be empty, aborting");
-    }
-    myOutXML.setMap(direction, outParcelMap);
-    myCiftiOut->setCiftiXML(myOutXML);
-    int64_t numCols = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW);
-    vector<float> scratchRow(numCols);
-    vector<int64_t> parcelCounts(numParcels, 0);
-    for (int64_t j = 0; j < (int64_t)indexToParcel.size(); ++j)
-    {
-        int parcel = indexToParcel[j];
-        CaretAssert(parcel > -2 && parcel < numParcels);
-        if (parcel != -1)
+        myOp.m_offsets.clear();
+        myOp.m_offsets.resize(numParcels + 1, 0);
+        for (int64_t j = 0; j < (int64_t)myOp.m_indexToParcel.size(); ++j)
         {
-            ++parcelCounts[parcel];
+            int parcel = myOp.m_indexToParcel[j];
+            CaretAssert(parcel > -2 && parcel < numParcels);
+            if (parcel != -1)
+            {
+                ++myOp.m_offsets[parcel + 1];
+            }
         }
-    }
-    if (emptyMaskOut != NULL)
-    {
-        CiftiXML maskOutXML;
-        maskOutXML.setNumberOfDimensions(2);
-        maskOutXML.setMap(CiftiXML::ALONG_COLUMN, outParcelMap);
-        CiftiScalarsMap maskNameMap;
-        maskNameMap.setLength(1);
-        maskNameMap.setMapName(0, "parcel not empty");
-        maskOutXML.setMap(CiftiXML::ALONG_ROW, maskNameMap);
-        emptyMaskOut->setCiftiXML(maskOutXML);
-        vector<float> emptyMaskData(numParcels, 1.0f);
         for (int i = 0; i < numParcels; ++i)
         {
-            if (parcelCounts[i] == 0)
+            myOp.m_offsets[i + 1] += myOp.m_offsets[i];
+        }
+        vector<int64_t> nextMember(myOp.m_offsets.begin(), myOp.m_offsets.end() - 1);
+        myOp.m_members.resize(myOp.m_offsets[numParcels]);
+        for (int64_t j = 0; j < (int64_t)myOp.m_indexToParcel.size(); ++j)
+        {
+            int parcel = myOp.m_indexToParcel[j];
+            if (parcel != -1)
             {
-                emptyMaskData[i] = 0.0f;
+                myOp.m_members[nextMember[parcel]] = j;
+                ++nextMember[parcel];
             }
         }
-        emptyMaskOut->setColumn(emptyMaskData.data(), 0);
+        myOp.m_weights.clear();
     }
-    bool isLabel = false;
-    int labelDir = -1;
-    for (int i = 0; i < (int)dims.size(); ++i)
+    
+    struct ReductionSettings
     {
-        if (myInputXML.getMappingType(i) == CiftiMappingType::LABELS)
-        {
-            isLabel = true;
-            labelDir = i;
-            break;//there should never be more than one dimension with LABEL type, and if there is, just use the first one, i guess...
+        ReductionEnum::Enum m_method;
+        float m_excludeLow, m_excludeHigh;
+        bool m_onlyNumeric, m_isLabel;
+        bool excluding() const { return m_excludeLow > 0.0f && m_excludeHigh > 0.0f; }
+        bool isLinear() const
+        {//MEAN and SUM without exclusions are a sparse matrix product, so they don't need the values copied into per-parcel lists
+            return !m_isLabel && !excluding() && !m_onlyNumeric && (m_method == ReductionEnum::MEAN || m_method == ReductionEnum::SUM);
         }
-    }
-    if (isLabel && method != ReductionEnum::MODE)
-    {
-        CaretLogWarning(ReductionEnum::toName(method) + " reduction requested while parcellating label data");
-    }
-    if (direction == CiftiXML::ALONG_ROW)
-    {
-        vector<float> scratchOutRow(numParcels);
-        vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
-        for (int j = 0; j < numParcels; ++j)
+        bool canReduce(const int64_t& count) const { return count > 0 && (m_method != ReductionEnum::SAMPSTDEV || count > 1); }
+        float reduce(const float* data, const float* weights, const int64_t& count) const
         {
-            parcelData[j].reserve(parcelCounts[j]);
+            if (weights == NULL)
+            {
+                if (excluding()) return ReductionOperation::reduceExcludeDev(data, count, m_method, m_excludeLow, m_excludeHigh);
+                if (m_onlyNumeric) return ReductionOperation::reduceOnlyNumeric(data, count, m_method);
+                return ReductionOperation::reduce(data, count, m_method);
+            } else {
+                if (excluding()) return ReductionOperation::reduceWeightedExcludeDev(data, weights, count, m_method, m_excludeLow, m_excludeHigh);
+                if (m_onlyNumeric) return ReductionOperation::reduceWeightedOnlyNumeric(data, weights, count, m_method);
+                return ReductionOperation::reduceWeighted(data, weights, count, m_method);
+            }
+        }
+        float finishLinear(const double& accum, const double& weightsum, const int64_t& count, const bool& weighted) const
+        {//same arithmetic as ReductionOperation::reduce and reduceWeighted, so the fast path gives identical results
+            if (m_method == ReductionEnum::SUM) return accum;
+            if (weighted)
+            {
+                const float mean = accum / weightsum;
+                return mean;
+            }
+            return accum / count;
         }
-        for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
+    };
+    
+    void reduceRow(const float* rowIn, float* rowOut, const ParcelOperator& myOp, const ReductionSettings& settings, const float& fillVal, vector<float>& scratch)
+    {
+        int numParcels = myOp.getNumberOfParcels();
+        bool linear = settings.isLinear();
+        for (int p = 0; p < numParcels; ++p)
         {
-            for (int j = 0; j < numParcels; ++j)
+            int64_t count = myOp.getCount(p);
+            if (!settings.canReduce(count))
             {
-                parcelData[j].clear();//doesn't change allocation
+                rowOut[p] = fillVal;
+                continue;
             }
-            myCiftiIn->getRow(scratchRow.data(), *iter);
-            for (int64_t j = 0; j < numCols; ++j)
+            const int64_t* members = myOp.m_members.data() + myOp.m_offsets[p];
+            const float* weights = myOp.getWeights(p);
+            if (linear)
             {
-                int parcel = indexToParcel[j];
-                if (parcel != -1)
+                double accum = 0.0, weightsum = 0.0;
+                if (weights == NULL)
                 {
-                    if (isLabel)
+                    for (int64_t k = 0; k < count; ++k)
                     {
-                        parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
-                    } else {
-                        parcelData[parcel].push_back(scratchRow[j]);
+                        accum += rowIn[members[k]];
                     }
-                }
-            }
-            for (int j = 0; j < numParcels; ++j)
-            {
-                CaretAssert(parcelCounts[j] == (int64_t)parcelData[j].size());
-                if (parcelCounts[j] > 0 && (method != ReductionEnum::SAMPSTDEV || parcelCounts[j] > 1))
-                {
-                    if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                } else {
+                    for (int64_t k = 0; k < count; ++k)
                     {
-                        scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelData[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                    } else {
-                        if (onlyNumeric)
-                        {
-                            scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelData[j].data(), parcelData[j].size(), method);
-                        } else {
-                            scratchOutRow[j] = ReductionOperation::reduce(parcelData[j].data(), parcelData[j].size(), method);
-                        }
+                        accum += rowIn[members[k]] * weights[k];
+                        weightsum += weights[k];
                     }
-                } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                    if (isLabel)
+                }
+                rowOut[p] = settings.finishLinear(accum, weightsum, count, weights != NULL);
+            } else {
+                if ((int64_t)scratch.size() < count) scratch.resize(count);
+                for (int64_t k = 0; k < count; ++k)
+                {
+                    if (settings.m_isLabel)
                     {
-                        scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
+                        scratch[k] = floor(rowIn[members[k]] + 0.5f);//round to nearest integer to be safe
                     } else {
-                        scratchOutRow[j] = emptyFillVal;//odd corner case, but probably fine: with nonzero empty fill value and SAMPSTDEV, parcels with only one element get the fill value, but aren't technically empty
+                        scratch[k] = rowIn[members[k]];
                     }
                 }
+                rowOut[p] = settings.reduce(scratch.data(), weights, count);
             }
-            myCiftiOut->setRow(scratchOutRow.data(), *iter);
         }
-    } else {
-        vector<float> scratchOutRow(numCols);
-        vector<int64_t> otherDims = dims;
-        otherDims.erase(otherDims.begin() + direction);//direction being parcellated
-        otherDims.erase(otherDims.begin());//row
-        vector<vector<vector<float> > > parcelData(numParcels, vector<vector<float> >(numCols));//float so we can use ReductionOperation
-        for (int i = 0; i < numParcels; ++i)
+    }
+    
+    class DenseRowSource
+    {//provides the rows along the dimension being parcellated, by dense index
+    public:
+        virtual int64_t getRowLength() const = 0;
+        virtual int64_t getRowsPerBlock() const = 0;
+        virtual void getRows(const int64_t* denseIndices, const int64_t& numRows, float* dataOut) = 0;//rows are consecutive in dataOut
+        virtual ~DenseRowSource() { }
+    };
+    
+    class CiftiDenseRowSource : public DenseRowSource
+    {//rows of a cifti file with fixed indices in the other dimensions
+        const CiftiFile* m_file;
+        vector<int64_t> m_indices;
+        int m_direction;
+        int64_t m_rowLength;
+    public:
+        CiftiDenseRowSource(const CiftiFile* file, const vector<int64_t>& indices, const int& direction)
+        {
+            CaretAssert(direction > 0);
+            m_file = file;
+            m_indices = indices;
+            m_direction = direction;
+            m_rowLength = file->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW);
+        }
+        int64_t getRowLength() const { return m_rowLength; }
+        int64_t getRowsPerBlock() const { return max((int64_t)1, PARCELLATE_BLOCK_BYTES / (m_rowLength * (int64_t)sizeof(float))); }
+        void getRows(const int64_t* denseIndices, const int64_t& numRows, float* dataOut)
         {
-            for (int j = 0; j < numCols; ++j)
+            for (int64_t i = 0; i < numRows; ++i)
             {
-                parcelData[i][j].reserve(parcelCounts[i]);
+                m_indices[m_direction - 1] = denseIndices[i];
+                m_file->getRow(dataOut + i * m_rowLength, m_indices);
             }
         }
-        for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
+    };
+    
+    class ParcellatedRowSource : public DenseRowSource
+    {//rows of a 2D cifti file, parcellated along the row as they are read, so parcellating a dconn in both directions doesn't need a dense intermediate
+        const CiftiFile* m_file;
+        const ParcelOperator& m_rowOp;
+        const ReductionSettings& m_settings;
+        float m_fillVal;
+        int64_t m_inputLength;
+        vector<float> m_readBuffer;
+    public:
+        ParcellatedRowSource(const CiftiFile* file, const ParcelOperator& rowOp, const ReductionSettings& settings, const float& fillVal) : m_rowOp(rowOp), m_settings(settings)
         {
-            vector<int64_t> indices(dims.size() - 1);//we need to add the parcellated direction index back into the index list to use it in getRow/setRow
-            for (int i = 0; i < (int)otherDims.size(); ++i)
-            {
-                if (i < direction - 1)
-                {
-                    indices[i] = (*iter)[i];
-                } else {
-                    indices[i + 1] = (*iter)[i];
-                }
-            }//indices[direction - 1] is uninitialized, as it is the dimension to be parcellated
-            for (int i = 0; i < numParcels; ++i)
+            m_file = file;
+            m_fillVal = fillVal;
+            m_inputLength = file->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW);
+        }
+        int64_t getRowLength() const { return m_rowOp.getNumberOfParcels(); }
+        int64_t getRowsPerBlock() const { return max((int64_t)1, PARCELLATE_BLOCK_BYTES / (m_inputLength * (int64_t)sizeof(float))); }
+        void getRows(const int64_t* denseIndices, const int64_t& numRows, float* dataOut)
+        {//a large parcel can be many more rows than a block, so read and reduce in batches of at most a block of dense rows
+            int64_t rowLength = getRowLength(), rowsPerBlock = getRowsPerBlock();
+            m_readBuffer.resize(min(numRows, rowsPerBlock) * m_inputLength);
+            for (int64_t batchStart = 0; batchStart < numRows; batchStart += rowsPerBlock)
             {
-                for (int j = 0; j < numCols; ++j)
+                int64_t batchRows = min(rowsPerBlock, numRows - batchStart);
+                for (int64_t i = 0; i < batchRows; ++i)
                 {
-                    parcelData[i][j].clear();//doesn't change allocation
+                    m_file->getRow(m_readBuffer.data() + i * m_inputLength, denseIndices[batchStart + i]);
                 }
-            }
-            for (int64_t i = 0; i < dims[direction]; ++i)
-            {
-                int parcel = indexToParcel[i];
-                if (parcel != -1)
+                float* batchOut = dataOut + batchStart * rowLength;
+                AString errorMessage;
+#pragma omp CARET_PAR
                 {
-                    indices[direction - 1] = i;
-                    myCiftiIn->getRow(scratchRow.data(), indices);
-                    vector<vector<float> >& parcelRef = parcelData[parcel];
-                    for (int j = 0; j < numCols; ++j)
+                    vector<float> scratch;
+#pragma omp CARET_FOR schedule(dynamic)
+                    for (int64_t i = 0; i < batchRows; ++i)
                     {
-                        if (isLabel)
+                        try
                         {
-                            parcelRef[j].push_back(floor(scratchRow[j] + 0.5f));
-                        } else {
-                            parcelRef[j].push_back(scratchRow[j]);
+                            reduceRow(m_readBuffer.data() + i * m_inputLength, batchOut + i * rowLength, m_rowOp, m_settings, m_fillVal, scratch);
+                        } catch (CaretException& e) {
+#pragma omp critical
+                            {
+                                if (errorMessage.isEmpty()) errorMessage = e.whatString();
+                            }
                         }
                     }
                 }
+                if (!errorMessage.isEmpty()) throw AlgorithmException(errorMessage);
             }
-            for (int i = 0; i < numParcels; ++i)
+        }
+    };
+    
+    void reduceColumns(DenseRowSource& mySource, const ParcelOperator& myOp, const ReductionSettings& settings, const vector<float>& fillVals, vector<float>& outData)
+    {//outData gets one row per parcel, whole parcels are read at a time so memory is bounded by the block size or the largest parcel
+        int numParcels = myOp.getNumberOfParcels();
+        int64_t rowLength = mySource.getRowLength(), rowsPerBlock = mySource.getRowsPerBlock();
+        int64_t numChunks = (rowLength + PARCELLATE_CHUNK_COLUMNS - 1) / PARCELLATE_CHUNK_COLUMNS;
+        CaretAssert((int64_t)fillVals.size() == rowLength);
+        bool linear = settings.isLinear();
+        outData.resize(numParcels * rowLength);
+        vector<float> block;
+        int blockStart = 0;
+        while (blockStart < numParcels)
+        {
+            int blockEnd = blockStart + 1;
+            while (blockEnd < numParcels && myOp.m_offsets[blockEnd + 1] - myOp.m_offsets[blockStart] <= rowsPerBlock)
             {
-                indices[direction - 1] = i;
-                int64_t count = parcelCounts[i];
-                vector<vector<float> >& parcelRef = parcelData[i];
-                if (count > 0 && (method != ReductionEnum::SAMPSTDEV || count > 1))
+                ++blockEnd;
+            }
+            int64_t firstMember = myOp.m_offsets[blockStart], numRows = myOp.m_offsets[blockEnd] - firstMember;
+            block.resize(numRows * rowLength);
+            mySource.getRows(myOp.m_members.data() + firstMember, numRows, block.data());
+            if (settings.m_isLabel)
+            {//round to nearest integer to be safe
+                for (int64_t i = 0; i < numRows * rowLength; ++i)
                 {
-                    for (int j = 0; j < numCols; ++j)
+                    block[i] = floor(block[i] + 0.5f);
+                }
+            }
+            int64_t numItems = (blockEnd - blockStart) * numChunks;
+            AString errorMessage;
+#pragma omp CARET_PAR
+            {
+                vector<float> scratch;
+                vector<double> accum(min(rowLength, PARCELLATE_CHUNK_COLUMNS));
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int64_t item = 0; item < numItems; ++item)
+                {
+                    try
                     {
-                        CaretAssert((int64_t)parcelRef[j].size() == count);
-                        if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                        int p = blockStart + (int)(item / numChunks);
+                        int64_t chunkStart = (item % numChunks) * PARCELLATE_CHUNK_COLUMNS, chunkEnd = min(chunkStart + PARCELLATE_CHUNK_COLUMNS, rowLength);
+                        int64_t count = myOp.getCount(p);
+                        float* outRow = outData.data() + p * rowLength;
+                        if (!settings.canReduce(count))
                         {
-                            scratchOutRow[j] = ReductionOperation::reduceExcludeDev(parcelRef[j].data(), parcelRef[j].size(), method, excludeLow, excludeHigh);
-                        } else {
-                            if (onlyNumeric)
+                            for (int64_t c = chunkStart; c < chunkEnd; ++c)
                             {
-                                scratchOutRow[j] = ReductionOperation::reduceOnlyNumeric(parcelRef[j].data(), parcelRef[j].size(), method);
-                            } else {
-                                scratchOutRow[j] = ReductionOperation::reduce(parcelRef[j].data(), parcelRef[j].size(), method);
+                                outRow[c] = fillVals[c];
                             }
+                            continue;
                         }
-                    }
-                } else {
-                    for (int j = 0; j < numCols; ++j)
-                    {
-                        CaretAssert((int64_t)parcelRef[j].size() == count);
-                        if (isLabel)
-                        {
-                            if (labelDir == CiftiXML::ALONG_ROW)
+                        const float* parcelRows = block.data() + (myOp.m_offsets[p] - firstMember) * rowLength;
+                        const float* weights = myOp.getWeights(p);
+                        if (linear)
+                        {//each element is accumulated in member order, same as reduceRow
+                            double weightsum = 0.0;
+                            for (int64_t c = chunkStart; c < chunkEnd; ++c)
                             {
-                                scratchOutRow[j] = myOutXML.getLabelsMap(CiftiXML::ALONG_ROW).getMapLabelTable(j)->getUnassignedLabelKey();
-                            } else {
-                                scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable(indices[labelDir - 1])->getUnassignedLabelKey();
+                                accum[c - chunkStart] = 0.0;
+                            }
+                            for (int64_t k = 0; k < count; ++k)
+                            {
+                                const float* thisRow = parcelRows + k * rowLength;
+                                if (weights == NULL)
+                                {
+                                    for (int64_t c = chunkStart; c < chunkEnd; ++c)
+                                    {
+                                        accum[c - chunkStart] += thisRow[c];
+                                    }
+                                } else {
+                                    const float weight = weights[k];
+                                    for (int64_t c = chunkStart; c < chunkEnd; ++c)
+                                    {
+                                        accum[c - chunkStart] += thisRow[c] * weight;
+                                    }
+                                    weightsum += weight;
+                                }
+                            }
+                            for (int64_t c = chunkStart; c < chunkEnd; ++c)
+                            {
+                                outRow[c] = settings.finishLinear(accum[c - chunkStart], weightsum, count, weights != NULL);
                             }
                         } else {
-                            scratchOutRow[j] = emptyFillVal;
+                            if ((int64_t)scratch.size() < count) scratch.resize(count);
+                            for (int64_t c = chunkStart; c < chunkEnd; ++c)
+                            {
+                                for (int64_t k = 0; k < count; ++k)
+                                {
+                                    scratch[k] = parcelRows[k * rowLength + c];
+                                }
+                                outRow[c] = settings.reduce(scratch.data(), weights, count);
+                            }
+                        }
+                    } catch (CaretException& e) {
+#pragma omp critical
+                        {
+                            if (errorMessage.isEmpty()) errorMessage = e.whatString();
                         }
                     }
                 }
-                myCiftiOut->setRow(scratchOutRow.data(), indices);
             }
+            if (!errorMessage.isEmpty()) throw AlgorithmException(errorMessage);
+            blockStart = blockEnd;
         }
     }
-}
-
-namespace
-{
-    void doWeightedParcellation(const CiftiFile* myCiftiIn, const int& direction, CiftiFile* myCiftiOut, const vector<int>& indexToParcel,
-                                const vector<vector<float> >& parcelWeights, const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric,
-                                const float& emptyFillVal, CiftiFile* emptyMaskOut)
+    
+    vector<int> getParcelDirections(const CiftiXML& myInputXML, const int& direction)
+    {
+        vector<int> ret;
+        if (direction == AlgorithmCiftiParcellate::BOTH_DIRECTIONS)
+        {
+            if (myInputXML.getNumberOfDimensions() != 2) throw AlgorithmException("parcellating both directions requires a 2D cifti file");
+            ret.push_back(CiftiXML::ALONG_ROW);
+            ret.push_back(CiftiXML::ALONG_COLUMN);
+        } else {
+            if (direction < 0 || direction >= myInputXML.getNumberOfDimensions()) throw AlgorithmException("specified direction doesn't exist in input file");
+            ret.push_back(direction);
+        }
+        for (int i = 0; i < (int)ret.size(); ++i)
+        {
+            if (myInputXML.getMappingType(ret[i]) != CiftiMappingType::BRAIN_MODELS)
+            {
+                throw AlgorithmException("input cifti file does not have brain models mapping type in specified direction");
+            }
+        }
+        return ret;
+    }
+    
+    void doParcellation(const CiftiFile* myCiftiIn, const vector<int>& parcelDirs, const vector<ParcelOperator>& myOps, CiftiFile* myCiftiOut,
+                        const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric,
+                        const float& emptyFillVal, CiftiFile* emptyMaskOut)
     {
         const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
         const CiftiXML& myOutXML = myCiftiOut->getCiftiXML();
         vector<int64_t> dims = myInputXML.getDimensions();
-        CaretAssert(direction < (int)dims.size());
-        bool isLabel = false;
+        CaretAssert(parcelDirs.size() == myOps.size());
+        ReductionSettings settings;
+        settings.m_method = method;
+        settings.m_excludeLow = excludeLow;
+        settings.m_excludeHigh = excludeHigh;
+        settings.m_onlyNumeric = onlyNumeric;
+        settings.m_isLabel = false;
         int labelDir = -1;
         for (int i = 0; i < (int)dims.size(); ++i)
         {
             if (myInputXML.getMappingType(i) == CiftiMappingType::LABELS)
             {
-                isLabel = true;
+                settings.m_isLabel = true;
                 labelDir = i;
                 break;//there should never be more than one dimension with LABEL type, and if there is, just use the first one, i guess...
             }
         }
-        if (isLabel && method != ReductionEnum::MODE)
+        if (settings.m_isLabel && method != ReductionEnum::MODE)
         {
             CaretLogWarning(ReductionEnum::toName(method) + " reduction requested while parcellating label data");
         }
-        int numParcels = myOutXML.getDimensionLength(direction);
         if (emptyMaskOut != NULL)
-        {
+        {//when parcellating both directions, use the parcels along the column
+            const ParcelOperator& maskOp = myOps.back();
+            int numParcels = maskOp.getNumberOfParcels();
             CiftiXML maskOutXML;
             maskOutXML.setNumberOfDimensions(2);
-            maskOutXML.setMap(CiftiXML::ALONG_COLUMN, myOutXML.getParcelsMap(direction));
+            maskOutXML.setMap(CiftiXML::ALONG_COLUMN, maskOp.m_parcelMap);
             CiftiScalarsMap maskNameMap;
             maskNameMap.setLength(1);
             maskNameMap.setMapName(0, "parcel not empty");
@@ -513,7 +642,7 @@ namespace
             vector<float> emptyMaskData(numParcels, 1.0f);
             for (int i = 0; i < numParcels; ++i)
             {
-                if (parcelWeights[i].size() == 0)
+                if (maskOp.getCount(i) == 0)
                 {
                     emptyMaskData[i] = 0.0f;
                 }
@@ -521,75 +650,74 @@ namespace
             emptyMaskOut->setColumn(emptyMaskData.data(), 0);
         }
         int64_t numCols = myInputXML.getDimensionLength(CiftiXML::ALONG_ROW);
-        vector<float> scratchRow(numCols);
-        if (direction == CiftiXML::ALONG_ROW)
-        {
-            vector<float> scratchOutRow(numParcels);
-            vector<vector<float> > parcelData(numParcels);//float so we can use ReductionOperation
-            for (int j = 0; j < numParcels; ++j)
+        vector<float> outData;
+        if (parcelDirs.size() == 2)
+        {//both dimensions are brain models, so there is no label dimension
+            CaretAssert(parcelDirs[0] == CiftiXML::ALONG_ROW && parcelDirs[1] == CiftiXML::ALONG_COLUMN);
+            ParcellatedRowSource mySource(myCiftiIn, myOps[0], settings, emptyFillVal);
+            reduceColumns(mySource, myOps[1], settings, vector<float>(mySource.getRowLength(), emptyFillVal), outData);
+            int numParcels = myOps[1].getNumberOfParcels();
+            for (int i = 0; i < numParcels; ++i)
             {
-                parcelData[j].reserve(parcelWeights[j].size());
+                myCiftiOut->setRow(outData.data() + i * mySource.getRowLength(), i);
             }
-            for (MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end())); !iter.atEnd(); ++iter)
+            return;
+        }
+        int direction = parcelDirs[0];
+        const ParcelOperator& myOp = myOps[0];
+        int numParcels = myOp.getNumberOfParcels();
+        if (direction == CiftiXML::ALONG_ROW)
+        {//rows are independent, so read a block of them and reduce them in parallel
+            int64_t rowsPerBlock = max((int64_t)1, PARCELLATE_BLOCK_BYTES / (numCols * (int64_t)sizeof(float)));
+            vector<float> inBlock(rowsPerBlock * numCols), fillVals(rowsPerBlock);
+            outData.resize(rowsPerBlock * numParcels);
+            vector<vector<int64_t> > blockIndices(rowsPerBlock);
+            MultiDimIterator<int64_t> iter(vector<int64_t>(dims.begin() + 1, dims.end()));
+            while (!iter.atEnd())
             {
-                for (int j = 0; j < numParcels; ++j)
+                int64_t numRows = 0;
+                while (numRows < rowsPerBlock && !iter.atEnd())
                 {
-                    parcelData[j].clear();//doesn't change allocation
-                }
-                myCiftiIn->getRow(scratchRow.data(), *iter);
-                for (int64_t j = 0; j < numCols; ++j)
-                {
-                    int parcel = indexToParcel[j];
-                    if (parcel != -1)
-                    {
-                        if (isLabel)
-                        {
-                            parcelData[parcel].push_back(floor(scratchRow[j] + 0.5f));//round to nearest integer to be safe
-                        } else {
-                            parcelData[parcel].push_back(scratchRow[j]);
-                        }
+                    blockIndices[numRows] = *iter;
+                    myCiftiIn->getRow(inBlock.data() + numRows * numCols, *iter);
+                    if (settings.m_isLabel)
+                    {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
+                        fillVals[numRows] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
+                    } else {
+                        fillVals[numRows] = emptyFillVal;//odd corner case, but probably fine: with nonzero empty fill value and SAMPSTDEV, parcels with only one element get the fill value, but aren't technically empty
                     }
+                    ++numRows;
+                    ++iter;
                 }
-                for (int j = 0; j < numParcels; ++j)
+                AString errorMessage;
+#pragma omp CARET_PAR
                 {
-                    CaretAssert(parcelWeights[j].size() == parcelData[j].size());
-                    if (parcelData[j].size() > 0 && (method != ReductionEnum::SAMPSTDEV || parcelData[j].size() > 1))
+                    vector<float> scratch;
+#pragma omp CARET_FOR schedule(dynamic)
+                    for (int64_t i = 0; i < numRows; ++i)
                     {
-                        if (excludeLow > 0.0f && excludeHigh > 0.0f)
+                        try
                         {
-                            scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method, excludeLow, excludeHigh);
-                        } else {
-                            if (onlyNumeric)
+                            reduceRow(inBlock.data() + i * numCols, outData.data() + i * numParcels, myOp, settings, fillVals[i], scratch);
+                        } catch (CaretException& e) {
+#pragma omp critical
                             {
-                                scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
-                            } else {
-                                scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelData[j].data(), parcelWeights[j].data(), parcelData[j].size(), method);
+                                if (errorMessage.isEmpty()) errorMessage = e.whatString();
                             }
                         }
-                    } else {//labelDir can't be 0 (row) because we are parcellating along row, so row must be dense
-                        if (isLabel)
-                        {
-                            scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable((*iter)[labelDir - 1])->getUnassignedLabelKey();
-                        } else {
-                            scratchOutRow[j] = emptyFillVal;
-                        }
                     }
                 }
-                myCiftiOut->setRow(scratchOutRow.data(), *iter);
+                if (!errorMessage.isEmpty()) throw AlgorithmException(errorMessage);
+                for (int64_t i = 0; i < numRows; ++i)
+                {
+                    myCiftiOut->setRow(outData.data() + i * numParcels, blockIndices[i]);
+                }
             }
         } else {
-            vector<float> scratchOutRow(numCols);
             vector<int64_t> otherDims = dims;
             otherDims.erase(otherDims.begin() + direction);//direction being parcellated
             otherDims.erase(otherDims.begin());//row
-            vector<vector<vector<float> > > parcelData(numParcels, vector<vector<float> >(numCols));//float so we can use ReductionOperation
-            for (int i = 0; i < numParcels; ++i)
-            {
-                for (int j = 0; j < numCols; ++j)
-                {
-                    parcelData[i][j].reserve(parcelWeights[i].size());
-                }
-            }
+            vector<float> fillVals(numCols);
             for (MultiDimIterator<int64_t> iter(otherDims); !iter.atEnd(); ++iter)
             {
                 vector<int64_t> indices(dims.size() - 1);//we need to add the parcellated direction index back into the index list to use it in getRow/setRow
@@ -602,157 +730,133 @@ namespace
                         indices[i + 1] = (*iter)[i];
                     }
                 }//indices[direction - 1] is uninitialized, as it is the dimension to be parcellated
-                for (int i = 0; i < numParcels; ++i)
-                {
-                    for (int j = 0; j < numCols; ++j)
-                    {
-                        parcelData[i][j].clear();//doesn't change allocation
-                    }
-                }
-                for (int64_t i = 0; i < dims[direction]; ++i)
+                for (int64_t j = 0; j < numCols; ++j)
                 {
-                    int parcel = indexToParcel[i];
-                    if (parcel != -1)
+                    if (settings.m_isLabel)
                     {
-                        indices[direction - 1] = i;
-                        myCiftiIn->getRow(scratchRow.data(), indices);
-                        vector<vector<float> >& parcelRef = parcelData[parcel];
-                        for (int j = 0; j < numCols; ++j)
+                        if (labelDir == CiftiXML::ALONG_ROW)
                         {
-                            if (isLabel)
-                            {
-                                parcelRef[j].push_back(floor(scratchRow[j] + 0.5f));
-                            } else {
-                                parcelRef[j].push_back(scratchRow[j]);
-                            }
+                            fillVals[j] = myOutXML.getLabelsMap(CiftiXML::ALONG_ROW).getMapLabelTable(j)->getUnassignedLabelKey();
+                        } else {
+                            fillVals[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable(indices[labelDir - 1])->getUnassignedLabelKey();
                         }
+                    } else {
+                        fillVals[j] = emptyFillVal;
                     }
                 }
+                CiftiDenseRowSource mySource(myCiftiIn, indices, direction);
+                reduceColumns(mySource, myOp, settings, fillVals, outData);
                 for (int i = 0; i < numParcels; ++i)
                 {
                     indices[direction - 1] = i;
-                    int64_t count = (int64_t)parcelWeights[i].size();
-                    vector<vector<float> >& parcelRef = parcelData[i];
-                    if (count > 0 && (method != ReductionEnum::SAMPSTDEV || count > 1))
-                    {
-                        for (int j = 0; j < numCols; ++j)
-                        {
-                            CaretAssert((int64_t)parcelRef[j].size() == count);
-                            if (excludeLow > 0.0f && excludeHigh > 0.0f)
-                            {
-                                scratchOutRow[j] = ReductionOperation::reduceWeightedExcludeDev(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method, excludeLow, excludeHigh);
-                            } else {
-                                if (onlyNumeric)
-                                {
-                                    scratchOutRow[j] = ReductionOperation::reduceWeightedOnlyNumeric(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method);
-                                } else {
-                                    scratchOutRow[j] = ReductionOperation::reduceWeighted(parcelRef[j].data(), parcelWeights[i].data(), parcelRef[j].size(), method);
-                                }
-                            }
-                        }
-                    } else {
-                        for (int j = 0; j < numCols; ++j)
-                        {
-                            CaretAssert((int64_t)parcelRef[j].size() == count);
-                            if (isLabel)
-                            {
-                                if (labelDir == CiftiXML::ALONG_ROW)
-                                {
-                                    scratchOutRow[j] = myOutXML.getLabelsMap(CiftiXML::ALONG_ROW).getMapLabelTable(j)->getUnassignedLabelKey();
-                                } else {
-                                    scratchOutRow[j] = myOutXML.getLabelsMap(labelDir).getMapLabelTable(indices[labelDir - 1])->getUnassignedLabelKey();
-                                }
-                            } else {
-                                scratchOutRow[j] = emptyFillVal;
-                            }
-                        }
-                    }
-                    myCiftiOut->setRow(scratchOutRow.data(), indices);
+                    myCiftiOut->setRow(outData.data() + i * numCols, indices);
                 }
             }
         }
     }
 }
 
+AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
+                                                   const ReductionEnum::Enum& method, const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric,
+                                                   const bool& legacyMode, const float& emptyFillVal, CiftiFile* emptyMaskOut) : AbstractAlgorithm(myProgObj)
+{
+    LevelProgress myProgress(myProgObj);
+    const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
+    const CiftiXML& myLabelXML = myCiftiLabel->getCiftiXML();
+    vector<int> parcelDirs = getParcelDirections(myInputXML, direction);
+    if (myLabelXML.getNumberOfDimensions() != 2 ||
+        myLabelXML.getMappingType(CiftiXML::ALONG_ROW) != CiftiMappingType::LABELS ||
+        myLabelXML.getMappingType(CiftiXML::ALONG_COLUMN) != CiftiMappingType::BRAIN_MODELS)
+    {
+        throw AlgorithmException("input cifti label file has the wrong mapping types");
+    }
+    const CiftiBrainModelsMap& labelDense = myLabelXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
+    CiftiXML myOutXML = myInputXML;
+    vector<ParcelOperator> myOps(parcelDirs.size());
+    for (int d = 0; d < (int)parcelDirs.size(); ++d)
+    {
+        const CiftiBrainModelsMap& inputDense = myInputXML.getBrainModelsMap(parcelDirs[d]);
+        if (inputDense.hasVolumeData())
+        {//don't check volume space if direction doesn't have volume data
+            if (labelDense.hasVolumeData() && !inputDense.getVolumeSpace().matches(labelDense.getVolumeSpace()))
+            {
+                throw AlgorithmException("input cifti files must have the same volume space");
+            }
+        }
+        buildOperator(myOps[d], myCiftiLabel, inputDense, legacyMode);
+        myOutXML.setMap(parcelDirs[d], myOps[d].m_parcelMap);
+    }
+    myCiftiOut->setCiftiXML(myOutXML);
+    doParcellation(myCiftiIn, parcelDirs, myOps, myCiftiOut, method, excludeLow, excludeHigh, onlyNumeric, emptyFillVal, emptyMaskOut);
+}
+
 AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
                                                    const MetricFile* leftWeights, const MetricFile* rightWeights, const MetricFile* cerebWeights, const ReductionEnum::Enum& method,
                                                    const float& excludeLow, const float& excludeHigh, const bool& onlyNumeric,
                                                    const bool& legacyMode, const float& emptyFillVal, CiftiFile* emptyMaskOut): AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
-    CaretAssert(direction >= 0);
     const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
     const CiftiXML& myLabelXML = myCiftiLabel->getCiftiXML();
-    vector<int64_t> dims = myInputXML.getDimensions();
-    if (direction >= (int)dims.size()) throw AlgorithmException("specified direction doesn't exist in input file");
-    if (myInputXML.getMappingType(direction) != CiftiMappingType::BRAIN_MODELS)
-    {
-        throw AlgorithmException("input cifti file does not have brain models mapping type in specified direction");
-    }
+    vector<int> parcelDirs = getParcelDirections(myInputXML, direction);
     if (myLabelXML.getNumberOfDimensions() != 2 ||
         myLabelXML.getMappingType(CiftiXML::ALONG_ROW) != CiftiMappingType::LABELS ||
         myLabelXML.getMappingType(CiftiXML::ALONG_COLUMN) != CiftiMappingType::BRAIN_MODELS)
     {
         throw AlgorithmException("input cifti label file has the wrong mapping types");
     }
-    const CiftiBrainModelsMap& inputDense = myInputXML.getBrainModelsMap(direction);
     const CiftiBrainModelsMap& labelDense = myLabelXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
-    float voxelVolume = 1.0f;
-    if (inputDense.hasVolumeData())
-    {//don't check volume space if direction doesn't have volume data
-        if (labelDense.hasVolumeData() && !inputDense.getVolumeSpace().matches(labelDense.getVolumeSpace()))
-        {
-            throw AlgorithmException("input cifti files must have the same volume space");
-        }
-        Vector3D ivec, jvec, kvec, origin;//compute the volume of a voxel in case a parcel spans both surface and volume
-        inputDense.getVolumeSpace().getSpacingVectors(ivec, jvec, kvec, origin);
-        voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
-    }
-    vector<StructureEnum::Enum> surfStructs = inputDense.getSurfaceStructureList();
-    for (int i = 0; i < (int)surfStructs.size(); ++i)
+    CiftiXML myOutXML = myInputXML;
+    vector<ParcelOperator> myOps(parcelDirs.size());
+    for (int d = 0; d < (int)parcelDirs.size(); ++d)
     {
-        const MetricFile* toCheck = NULL;
-        switch (surfStructs[i])
-        {
-            case StructureEnum::CORTEX_LEFT:
-                toCheck = leftWeights;
-                break;
-            case StructureEnum::CORTEX_RIGHT:
-                toCheck = rightWeights;
-                break;
-            case StructureEnum::CEREBELLUM:
-                toCheck = cerebWeights;
-                break;
-            default:
-                throw AlgorithmException("unsupported surface structure: " + StructureEnum::toName(surfStructs[i]));
+        const CiftiBrainModelsMap& inputDense = myInputXML.getBrainModelsMap(parcelDirs[d]);
+        float voxelVolume = 1.0f;
+        if (inputDense.hasVolumeData())
+        {//don't check volume space if direction doesn't have volume data
+            if (labelDense.hasVolumeData() && !inputDense.getVolumeSpace().matches(labelDense.getVolumeSpace()))
+            {
+                throw AlgorithmException("input cifti files must have the same volume space");
+            }
+            Vector3D ivec, jvec, kvec, origin;//compute the volume of a voxel in case a parcel spans both surface and volume
+            inputDense.getVolumeSpace().getSpacingVectors(ivec, jvec, kvec, origin);
+            voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
         }
-        if (toCheck == NULL) throw AlgorithmException("weight metric required but not provided for structure " + StructureEnum::toName(surfStructs[i]));
-        if (toCheck->getNumberOfNodes() != inputDense.getSurfaceNumberOfNodes(surfStructs[i]))
+        vector<StructureEnum::Enum> surfStructs = inputDense.getSurfaceStructureList();
+        for (int i = 0; i < (int)surfStructs.size(); ++i)
         {
-            throw AlgorithmException("weight metric has incorrect number of vertices for structure " + StructureEnum::toName(surfStructs[i]));
+            const MetricFile* toCheck = NULL;
+            switch (surfStructs[i])
+            {
+                case StructureEnum::CORTEX_LEFT:
+                    toCheck = leftWeights;
+                    break;
+                case StructureEnum::CORTEX_RIGHT:
+                    toCheck = rightWeights;
+                    break;
+                case StructureEnum::CEREBELLUM:
+                    toCheck = cerebWeights;
+                    break;
+                default:
+                    throw AlgorithmException("unsupported surface structure: " + StructureEnum::toName(surfStructs[i]));
+            }
+            if (toCheck == NULL) throw AlgorithmException("weight metric required but not provided for structure " + StructureEnum::toName(surfStructs[i]));
+            if (toCheck->getNumberOfNodes() != inputDense.getSurfaceNumberOfNodes(surfStructs[i]))
+            {
+                throw AlgorithmException("weight metric has incorrect number of vertices for structure " + StructureEnum::toName(surfStructs[i]));
+            }
+            checkStructureMatch(toCheck, surfStructs[i], "weight metric", "it is provided as the argument for");
         }
-        checkStructureMatch(toCheck, surfStructs[i], "weight metric", "it is provided as the argument for");
-    }
-    vector<int> indexToParcel;
-    CiftiXML myOutXML = myInputXML;
-    CiftiParcelsMap outParcelMap = parcellateMapping(myCiftiLabel, inputDense, indexToParcel, legacyMode);
-    int numParcels = outParcelMap.getLength();
-    if (numParcels < 1)
-    {
-        throw AlgorithmException("no parcels found, output file would be empty, aborting");
-    }
-    myOutXML.setMap(direction, outParcelMap);
-    myCiftiOut->setCiftiXML(myOutXML);
-    vector<vector<float> > parcelWeights(numParcels);
-    for (int64_t j = 0; j < (int64_t)indexToParcel.size(); ++j)
-    {
-        int parcel = indexToParcel[j];
-        if (parcel != -1)
+        ParcelOperator& myOp = myOps[d];
+        buildOperator(myOp, myCiftiLabel, inputDense, legacyMode);
+        myOutXML.setMap(parcelDirs[d], myOp.m_parcelMap);
+        myOp.m_weights.resize(myOp.m_members.size());
+        for (int64_t j = 0; j < (int64_t)myOp.m_members.size(); ++j)
         {
-            const CiftiBrainModelsMap::IndexInfo myDenseInfo = inputDense.getInfoForIndex(j);
+            const CiftiBrainModelsMap::IndexInfo myDenseInfo = inputDense.getInfoForIndex(myOp.m_members[j]);
             if (myDenseInfo.m_type == CiftiBrainModelsMap::VOXELS)
             {
-                parcelWeights[parcel].push_back(voxelVolume);
+                myOp.m_weights[j] = voxelVolume;
             } else {
                 const MetricFile* toUse = NULL;
                 switch (myDenseInfo.m_structure)
@@ -769,11 +873,12 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                     default:
                         CaretAssert(0);
                 }
-                parcelWeights[parcel].push_back(toUse->getValue(myDenseInfo.m_surfaceNode, 0));
+                myOp.m_weights[j] = toUse->getValue(myDenseInfo.m_surfaceNode, 0);
             }
         }
     }
-    doWeightedParcellation(myCiftiIn, direction, myCiftiOut, indexToParcel, parcelWeights, method, excludeLow, excludeHigh, onlyNumeric, emptyFillVal, emptyMaskOut);
+    myCiftiOut->setCiftiXML(myOutXML);
+    doParcellation(myCiftiIn, parcelDirs, myOps, myCiftiOut, method, excludeLow, excludeHigh, onlyNumeric, emptyFillVal, emptyMaskOut);
 }
 
 AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
@@ -781,16 +886,10 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
                                                    const bool& legacyMode, const float& emptyFillVal, CiftiFile* emptyMaskOut): AbstractAlgorithm(myProgObj)
 {
     LevelProgress myProgress(myProgObj);
-    CaretAssert(direction >= 0);
     const CiftiXML& myInputXML = myCiftiIn->getCiftiXML();
     const CiftiXML& myLabelXML = myCiftiLabel->getCiftiXML();
     const CiftiXML& weightsXML = ciftiWeights->getCiftiXML();
-    vector<int64_t> dims = myInputXML.getDimensions();
-    if (direction >= (int)dims.size()) throw AlgorithmException("specified direction doesn't exist in input file");
-    if (myInputXML.getMappingType(direction) != CiftiMappingType::BRAIN_MODELS)
-    {
-        throw AlgorithmException("input cifti file does not have brain models mapping type in specified direction");
-    }
+    vector<int> parcelDirs = getParcelDirections(myInputXML, direction);
     if (weightsXML.getMappingType(CiftiXML::ALONG_COLUMN) != CiftiMappingType::BRAIN_MODELS)
     {
         throw AlgorithmException("cifti weight file does not have brain models along column");
@@ -801,7 +900,6 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
     {
         throw AlgorithmException("input cifti label file has the wrong mapping types");
     }
-    const CiftiBrainModelsMap& inputDense = myInputXML.getBrainModelsMap(direction);
     const CiftiBrainModelsMap& labelDense = myLabelXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
     const CiftiBrainModelsMap& weightsDense = weightsXML.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
     vector<StructureEnum::Enum> surfModels = labelDense.getSurfaceStructureList();
@@ -815,37 +913,32 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
             }
         }
     }
-    if (labelDense.hasVolumeData())
-    {//don't check volume space if direction doesn't have volume data
-        if (inputDense.hasVolumeData() && !labelDense.getVolumeSpace().matches(inputDense.getVolumeSpace()))
-        {
-            throw AlgorithmException("input cifti file has a different volume space");
-        }
-        if (weightsDense.hasVolumeData() && !labelDense.getVolumeSpace().matches(weightsDense.getVolumeSpace()))
-        {
-            throw AlgorithmException("cifti weight file has a different volume space");
-        }
-    }
-    vector<int> indexToParcel;
-    CiftiXML myOutXML = myInputXML;
-    CiftiParcelsMap outParcelMap = parcellateMapping(myCiftiLabel, inputDense, indexToParcel, legacyMode);
-    int numParcels = outParcelMap.getLength();
-    if (numParcels < 1)
+    if (labelDense.hasVolumeData() && weightsDense.hasVolumeData() && !labelDense.getVolumeSpace().matches(weightsDense.getVolumeSpace()))
     {
-        throw AlgorithmException("no parcels found, output file would be empty, aborting");
+        throw AlgorithmException("cifti weight file has a different volume space");
     }
-    myOutXML.setMap(direction, outParcelMap);
-    myCiftiOut->setCiftiXML(myOutXML);
     vector<float> weightCol(weightsXML.getDimensionLength(CiftiXML::ALONG_COLUMN));
     ciftiWeights->getColumn(weightCol.data(), 0);
-    vector<vector<float> > parcelWeights(numParcels);
-    for (int64_t j = 0; j < (int64_t)indexToParcel.size(); ++j)
+    CiftiXML myOutXML = myInputXML;
+    vector<ParcelOperator> myOps(parcelDirs.size());
+    for (int d = 0; d < (int)parcelDirs.size(); ++d)
     {
-        int parcel = indexToParcel[j];
-        if (parcel != -1)
+        const CiftiBrainModelsMap& inputDense = myInputXML.getBrainModelsMap(parcelDirs[d]);
+        if (labelDense.hasVolumeData())
+        {//don't check volume space if direction doesn't have volume data
+            if (inputDense.hasVolumeData() && !labelDense.getVolumeSpace().matches(inputDense.getVolumeSpace()))
+            {
+                throw AlgorithmException("input cifti file has a different volume space");
+            }
+        }
+        ParcelOperator& myOp = myOps[d];
+        buildOperator(myOp, myCiftiLabel, inputDense, legacyMode);
+        myOutXML.setMap(parcelDirs[d], myOp.m_parcelMap);
+        myOp.m_weights.resize(myOp.m_members.size());
+        for (int64_t j = 0; j < (int64_t)myOp.m_members.size(); ++j)
         {
             int weightIndex = -1;
-            CiftiBrainModelsMap::IndexInfo myInfo = inputDense.getInfoForIndex(j);
+            CiftiBrainModelsMap::IndexInfo myInfo = inputDense.getInfoForIndex(myOp.m_members[j]);
             switch (myInfo.m_type)
             {
                 case CiftiBrainModelsMap::SURFACE:
@@ -859,10 +952,11 @@ AlgorithmCiftiParcellate::AlgorithmCiftiParcellate(ProgressObject* myProgObj, co
             {
                 throw AlgorithmException("cifti weights file does not contain all necessary vertices and voxels");
             }
-            parcelWeights[parcel].push_back(weightCol[weightIndex]);
+            myOp.m_weights[j] = weightCol[weightIndex];
         }
     }
-    doWeightedParcellation(myCiftiIn, direction, myCiftiOut, indexToParcel, parcelWeights, method, excludeLow, excludeHigh, onlyNumeric, emptyFillVal, emptyMaskOut);
+    myCiftiOut->setCiftiXML(myOutXML);
+    doParcellation(myCiftiIn, parcelDirs, myOps, myCiftiOut, method, excludeLow, excludeHigh, onlyNumeric, emptyFillVal, emptyMaskOut);
 }
 
 CiftiParcelsMap AlgorithmCiftiParcellate::parcellateMapping(const CiftiFile* myCiftiLabel, const CiftiBrainModelsMap& toParcellate, vector<int>& indexToParcelOut, const bool& legacyMode)
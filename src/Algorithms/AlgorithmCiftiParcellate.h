@@ -36,6 +36,7 @@ namespace caret {
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
     public:
+        static const int BOTH_DIRECTIONS = -1;//for direction, parcellate both dimensions of a 2D file (dconn to pconn) in one pass
         AlgorithmCiftiParcellate(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const CiftiFile* myCiftiLabel, const int& direction, CiftiFile* myCiftiOut,
                                  const ReductionEnum::Enum& method = ReductionEnum::MEAN,
                                  const float& excludeLow = -1.0f, const float& excludeHigh = -1.0f, const bool& onlyNumeric = false,
@@ -195,15 +195,12 @@ AlgorithmCiftiReplaceStructure::AlgorithmCiftiReplaceStructure(ProgressObject* m
         {
             throw AlgorithmException("input metric has the wrong number of columns");
         }
-        int mapSize = (int)myMap.size();
         CaretArray<float> rowScratch(rowSize);
+        vector<CiftiBrainModelsMap::IndexRange> myRanges = myDenseMap.getSurfaceRanges(myStruct);
         for (int i = 0; i < colSize; ++i)
         {
             ciftiInOut->getRow(rowScratch, i, true);
-            for (int j = 0; j < mapSize; ++j)
-            {
-                rowScratch[myMap[j].m_ciftiIndex] = metricIn->getValue(myMap[j].m_surfaceNode, i);
-            }
+            CiftiBrainModelsMap::copyElementsToCifti(myRanges, metricIn->getValuePointerForColumn(i), rowScratch);
             ciftiInOut->setRow(rowScratch, i);
         }
     }
@@ -530,14 +527,11 @@ AlgorithmCiftiReplaceStructure::AlgorithmCiftiReplaceStructure(ProgressObject* m
                 ciftiInOut->setRow(rowScratch, i);
             }
         } else {
+            vector<CiftiBrainModelsMap::IndexRange> myRanges = myBrainMap.getVolumeStructureRanges(myStruct, newdims.data(), offset);
             for (int64_t i = 0; i < colSize; ++i)
             {
                 ciftiInOut->getRow(rowScratch, i, true);//the on-disk cifti file may not have been allocated yet, so short reads are okay
-                for (int64_t j = 0; j < numVoxels; ++j)
-                {
-                    int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offset[0], myMap[j].m_ijk[1] - offset[1], myMap[j].m_ijk[2] - offset[2] };
-                    rowScratch[myMap[j].m_ciftiIndex] = volIn->getValue(thisvoxel, i);
-                }
+                CiftiBrainModelsMap::copyElementsToCifti(myRanges, volIn->getFrame(i), rowScratch);
                 ciftiInOut->setRow(rowScratch, i);
             }
         }
@@ -715,14 +709,11 @@ AlgorithmCiftiReplaceStructure::AlgorithmCiftiReplaceStructure(ProgressObject* m
                 ciftiInOut->setRow(rowScratch, i);
             }
         } else {
+            vector<CiftiBrainModelsMap::IndexRange> myRanges = myBrainMap.getFullVolumeRanges(newdims.data(), offset);
             for (int64_t i = 0; i < colSize; ++i)
             {
                 ciftiInOut->getRow(rowScratch, i, true);//the on-disk cifti file may not have been allocated yet, so short reads are okay
-                for (int64_t j = 0; j < numVoxels; ++j)
-                {
-                    int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offset[0], myMap[j].m_ijk[1] - offset[1], myMap[j].m_ijk[2] - offset[2] };
-                    rowScratch[myMap[j].m_ciftiIndex] = volIn->getValue(thisvoxel, i);
-                }
+                CiftiBrainModelsMap::copyElementsToCifti(myRanges, volIn->getFrame(i), rowScratch);
                 ciftiInOut->setRow(rowScratch, i);
             }
         }
@@ -29,12 +29,40 @@
 #include "Vector3D.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <map>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    ///write each cifti row as a frame of the volume through contiguous index ranges, and mark the used voxels in the roi
+    void writeVolumeFrames(const CiftiFile* ciftiIn, const vector<CiftiBrainModelsMap::IndexRange>& ranges, VolumeFile* volOut, VolumeFile* roiOut)
+    {
+        const int64_t* dims = volOut->getDimensionsPtr();
+        int64_t frameSize = dims[0] * dims[1] * dims[2];
+        int64_t numRows = ciftiIn->getNumberOfRows();
+        vector<float> rowScratch(ciftiIn->getNumberOfColumns()), frameScratch(frameSize, 0.0f);//voxels outside the ranges are never written, so they stay 0
+        for (int64_t i = 0; i < numRows; ++i)
+        {
+            ciftiIn->getRow(rowScratch.data(), i);
+            CiftiBrainModelsMap::copyCiftiToElements(ranges, rowScratch.data(), frameScratch.data());
+            volOut->setFrame(frameScratch.data(), i);
+        }
+        if (roiOut != NULL)
+        {
+            vector<float> roiFrame(frameSize, 0.0f);
+            for (int64_t i = 0; i < (int64_t)ranges.size(); ++i)
+            {
+                fill(roiFrame.begin() + ranges[i].m_elementStart, roiFrame.begin() + ranges[i].m_elementStart + ranges[i].m_count, 1.0f);
+            }
+            roiOut->setFrame(roiFrame.data());
+        }
+    }
+}
+
 AString AlgorithmCiftiSeparate::getCommandSwitch()
 {
     return "-cifti-separate";
@@ -277,13 +305,11 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
             }
             roiOut->setValuesForColumn(0, nodeUsed);
         }
+        vector<CiftiBrainModelsMap::IndexRange> myRanges = myBrainModelsMap.getSurfaceRanges(myStruct);
         for (int i = 0; i < colSize; ++i)
         {
             ciftiIn->getRow(rowScratch, i);
-            for (int j = 0; j < mapSize; ++j)
-            {
-                metricScratch[myMap[j].m_surfaceNode] = rowScratch[myMap[j].m_ciftiIndex];
-            }
+            CiftiBrainModelsMap::copyCiftiToElements(myRanges, rowScratch, metricScratch);//unused vertices stay 0
             metricOut->setValuesForColumn(i, metricScratch);
         }
     }
@@ -399,25 +425,26 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
         }
         *(labelOut->getLabelTable()) = myTable;
         int32_t unusedLabel = myTable.getUnassignedLabelKey();
+        vector<CiftiBrainModelsMap::IndexRange> myRanges = myBrainModelsMap.getSurfaceRanges(myStruct);
+        CaretArray<float> nodeScratch(numNodes, 0.0f);
         for (int64_t i = 0; i < colSize; ++i)
         {
             ciftiIn->getRow(rowScratch, i);
-            for (int64_t j = 0; j < mapSize; ++j)
+            CiftiBrainModelsMap::copyCiftiToElements(myRanges, rowScratch, nodeScratch);
+            for (int64_t j = 0; j < numNodes; ++j)
             {
-                int32_t inVal = (int32_t)floor(rowScratch[j] + 0.5f);
-                map<int32_t, int32_t>::const_iterator iter = cumulativeRemap.find(inVal);
-                if (iter == cumulativeRemap.end())
-                {
-                    labelOut->setLabelKey(myMap[j].m_surfaceNode, i, inVal);
-                } else {
-                    labelOut->setLabelKey(myMap[j].m_surfaceNode, i, iter->second);
-                }
-            }
-            for (int64_t j = 0; j < numNodes; ++j)//set unused columns to unassigned
-            {
-                if (nodeUsed[j] == 0)
+                if (nodeUsed[j] == 0)//set unused vertices to unassigned
                 {
                     labelOut->setLabelKey(j, i, unusedLabel);
+                } else {
+                    int32_t inVal = (int32_t)floor(nodeScratch[j] + 0.5f);
+                    map<int32_t, int32_t>::const_iterator iter = cumulativeRemap.find(inVal);
+                    if (iter == cumulativeRemap.end())
+                    {
+                        labelOut->setLabelKey(j, i, inVal);
+                    } else {
+                        labelOut->setLabelKey(j, i, iter->second);
+                    }
                 }
             }
         }
@@ -509,19 +536,8 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
                 *(volOut->getMapLabelTable(j)) = *(myLabelsMap.getMapLabelTable(j));
             }
         }
-        for (int64_t i = 0; i < colSize; ++i)
-        {
-            ciftiIn->getRow(rowScratch, i);
-            for (int64_t j = 0; j < numVoxels; ++j)
-            {
-                int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offsetOut[0], myMap[j].m_ijk[1] - offsetOut[1], myMap[j].m_ijk[2] - offsetOut[2] };
-                if (i == 0 && roiOut != NULL)
-                {
-                    roiOut->setValue(1.0f, thisvoxel);
-                }
-                volOut->setValue(rowScratch[myMap[j].m_ciftiIndex], thisvoxel, i);
-            }
-        }
+        vector<CiftiBrainModelsMap::IndexRange> myRanges = myBrainMap.getVolumeStructureRanges(myStruct, newdims.data(), offsetOut);
+        writeVolumeFrames(ciftiIn, myRanges, volOut, roiOut);
     }
 }
 
@@ -627,19 +643,8 @@ AlgorithmCiftiSeparate::AlgorithmCiftiSeparate(ProgressObject* myProgObj, const
                 *(volOut->getMapLabelTable(j)) = *(myLabelsMap.getMapLabelTable(j));
             }
         }
-        for (int64_t i = 0; i < colSize; ++i)
-        {
-            ciftiIn->getRow(rowScratch, i);
-            for (int64_t j = 0; j < numVoxels; ++j)
-            {
-                int64_t thisvoxel[3] = { myMap[j].m_ijk[0] - offsetOut[0], myMap[j].m_ijk[1] - offsetOut[1], myMap[j].m_ijk[2] - offsetOut[2] };
-                if (i == 0 && roiOut != NULL)
-                {
-                    roiOut->setValue(1.0f, thisvoxel);
-                }
-                volOut->setValue(rowScratch[myMap[j].m_ciftiIndex], thisvoxel, i);
-            }
-        }
+        vector<CiftiBrainModelsMap::IndexRange> myRanges = myBrainMap.getFullVolumeRanges(newdims.data(), offsetOut);
+        writeVolumeFrames(ciftiIn, myRanges, volOut, roiOut);
     }
 }
 
@@ -23,6 +23,7 @@
 
 #include "CaretAssert.h"
 #include "CaretOMP.h"
+#include "CaretPointer.h"
 #include "FastStatistics.h"
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
@@ -33,10 +34,16 @@
 
 #include <algorithm>
 #include <cmath>
+#include <map>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int MAX_CACHED_MASKS = 16;//columns with yet more distinct bad masks get dilated as they are found, without keeping their stencils
+}
+
 AString AlgorithmMetricDilate::getCommandSwitch()
 {
     return "-metric-dilate";
@@ -181,9 +188,6 @@ AlgorithmMetricDilate::AlgorithmMetricDilate(ProgressObject* myProgObj, const Me
         throw AlgorithmException("distance cannot be negative");
     }
     myMetricOut->setStructure(mySurf->getStructure());
-    vector<pair<int, StencilElem> > myStencils;//because we need to iterate over it in parallel
-    vector<pair<int, int> > myNearest;
-    vector<float> colScratch(numNodes);
     vector<float> myAreasData;
     const float* myAreas = NULL;
     if (corrAreas == NULL)
@@ -195,71 +199,128 @@ AlgorithmMetricDilate::AlgorithmMetricDilate(ProgressObject* myProgObj, const Me
     }
     bool linear = (myMethod == LINEAR), nearest = (myMethod == NEAREST);
     FastStatistics spacingStats;
-    if (!linear && badNodeRoi != NULL)//if we know which nodes need to have their values replaced, then we can do the same thing at each vertex for each column
+    mySurf->getNodesSpacingStatistics(spacingStats);//use mean spacing to help set minimum stencil distance, since native surfaces might have a minimum of 0
+    vector<int> inputColumns;
+    if (columnNum == -1)
     {
-        if (nearest)
+        myMetricOut->setNumberOfNodesAndColumns(numNodes, myMetric->getNumberOfColumns());
+        for (int thisCol = 0; thisCol < myMetric->getNumberOfColumns(); ++thisCol)
         {
-            precomputeNearest(myNearest, mySurf, badNodeRoi, dataRoi, corrAreas, distance);
-        } else {
-            precomputeStencils(myStencils, mySurf, myAreas, badNodeRoi, dataRoi, corrAreas, distance, exponent, legacyCutoff);
+            inputColumns.push_back(thisCol);
         }
     } else {
-        mySurf->getNodesSpacingStatistics(spacingStats);//use mean spacing to help set minimum stencil distance, since native surfaces might have a minimum of 0
+        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
+        inputColumns.push_back(columnNum);
     }
-    if (columnNum == -1)
+    int numOutColumns = (int)inputColumns.size();
+    for (int outCol = 0; outCol < numOutColumns; ++outCol)
     {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, myMetric->getNumberOfColumns());
-        for (int thisCol = 0; thisCol < myMetric->getNumberOfColumns(); ++thisCol)
+        *(myMetricOut->getMapPaletteColorMapping(outCol)) = *(myMetric->getMapPaletteColorMapping(inputColumns[outCol]));
+        myMetricOut->setColumnName(outCol, myMetric->getColumnName(inputColumns[outCol]));
+    }
+    if (linear)
+    {//linear depends on the values, not just on which vertices are bad, so it can't use stencils
+        vector<float> colScratch(numNodes);
+        for (int outCol = 0; outCol < numOutColumns; ++outCol)
+        {
+            processColumn(colScratch.data(), myMetric->getValuePointerForColumn(inputColumns[outCol]), mySurf, myAreas, badNodeRoi, dataRoi, corrAreas,
+                          distance, nearest, linear, exponent, legacyCutoff, spacingStats.getMean());
+            myMetricOut->setValuesForColumn(outCol, colScratch.data());
+        }
+        return;
+    }
+    //the stencil only depends on which vertices are bad, so compute it once per distinct bad mask - with a bad vertex roi, that is once total,
+    //otherwise, bad is (value == 0), which is usually the same in every column (medial wall, or a shared missing-data region)
+    vector<CaretPointer<MaskStencils> > stencilCache;
+    map<uint64_t, vector<int> > cacheByHash;
+    vector<int> columnStencil(numOutColumns, -1);
+    vector<char> badMask(numNodes);
+    for (int outCol = 0; outCol < numOutColumns; ++outCol)
+    {
+        if (badNodeRoi != NULL)
         {
-            *(myMetricOut->getMapPaletteColorMapping(thisCol)) = *(myMetric->getMapPaletteColorMapping(thisCol));
-            const float* myInputData = myMetric->getValuePointerForColumn(thisCol);
-            myMetricOut->setColumnName(thisCol, myMetric->getColumnName(thisCol));
-            if (badNodeRoi == NULL)
+            if (!stencilCache.empty())
             {
-                processColumn(colScratch.data(), myInputData, mySurf, myAreas, badNodeRoi, dataRoi, corrAreas, distance, nearest, linear, exponent, legacyCutoff, spacingStats.getMean());
-            } else {
-                switch (myMethod)
-                {
-                    case NEAREST:
-                        processColumn(colScratch.data(), numNodes, myInputData, myNearest);
-                        break;
-                    case WEIGHTED:
-                        processColumn(colScratch.data(), numNodes, myInputData, myStencils);
-                        break;
-                    case LINEAR:
-                        processColumn(colScratch.data(), myInputData, mySurf, myAreas, badNodeRoi, dataRoi, corrAreas, distance, nearest, linear, exponent, legacyCutoff, spacingStats.getMean());
-                        break;
-                }
+                columnStencil[outCol] = 0;
+                continue;
+            }
+            const float* badRoiData = badNodeRoi->getValuePointerForColumn(0);
+            for (int i = 0; i < numNodes; ++i)
+            {
+                badMask[i] = (badRoiData[i] > 0.0f) ? 1 : 0;
+            }
+        } else {
+            const float* myInputData = myMetric->getValuePointerForColumn(inputColumns[outCol]);
+            for (int i = 0; i < numNodes; ++i)
+            {
+                badMask[i] = (myInputData[i] == 0.0f) ? 1 : 0;//NaN is not bad
             }
-            myMetricOut->setValuesForColumn(thisCol, colScratch.data());
         }
-    } else {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
-        *(myMetricOut->getMapPaletteColorMapping(0)) = *(myMetric->getMapPaletteColorMapping(columnNum));
-        const float* myInputData = myMetric->getValuePointerForColumn(columnNum);
-        myMetricOut->setColumnName(0, myMetric->getColumnName(columnNum));
-        if (badNodeRoi == NULL)
+        uint64_t maskHash = 14695981039346656037ULL;//FNV-1a
+        for (int i = 0; i < numNodes; ++i)
         {
-            processColumn(colScratch.data(), myInputData, mySurf, myAreas, badNodeRoi, dataRoi, corrAreas, distance, nearest, linear, exponent, legacyCutoff, spacingStats.getMean());
+            maskHash = (maskHash ^ (unsigned char)badMask[i]) * 1099511628211ULL;
+        }
+        vector<int>& candidates = cacheByHash[maskHash];
+        for (int i = 0; i < (int)candidates.size(); ++i)
+        {
+            if (stencilCache[candidates[i]]->m_badMask == badMask)
+            {
+                columnStencil[outCol] = candidates[i];
+                break;
+            }
+        }
+        if (columnStencil[outCol] != -1) continue;
+        CaretPointer<MaskStencils> newStencils(new MaskStencils());
+        if (nearest)
+        {
+            precomputeNearest(newStencils->m_nearest, mySurf, badMask.data(), dataRoi, corrAreas, distance);
         } else {
-            switch (myMethod)
+            precomputeStencils(newStencils->m_stencils, mySurf, myAreas, badMask.data(), dataRoi, corrAreas, distance, exponent, legacyCutoff);
+        }
+        if ((int)stencilCache.size() < MAX_CACHED_MASKS)
+        {
+            newStencils->m_badMask = badMask;
+            columnStencil[outCol] = (int)stencilCache.size();
+            candidates.push_back(columnStencil[outCol]);
+            stencilCache.push_back(newStencils);
+        } else {//if every column has a different bad mask, don't keep them all in memory, just use this one immediately
+            vector<float> colScratch(numNodes);
+            const float* myInputData = myMetric->getValuePointerForColumn(inputColumns[outCol]);
+            if (nearest)
+            {
+                processColumn(colScratch.data(), numNodes, myInputData, newStencils->m_nearest);
+            } else {
+                processColumn(colScratch.data(), numNodes, myInputData, newStencils->m_stencils);
+            }
+            myMetricOut->setValuesForColumn(outCol, colScratch.data());
+        }
+    }
+    //applying a stencil is just a sparse gather, so do whole columns in parallel (the parallel loop inside processColumn becomes serial)
+#pragma omp CARET_PAR
+    {
+        vector<float> colScratch(numNodes);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int outCol = 0; outCol < numOutColumns; ++outCol)
+        {
+            if (columnStencil[outCol] == -1) continue;//already done
+            const float* myInputData = myMetric->getValuePointerForColumn(inputColumns[outCol]);
+            const MaskStencils& myMaskStencils = *(stencilCache[columnStencil[outCol]]);
+            if (nearest)
+            {
+                processColumn(colScratch.data(), numNodes, myInputData, myMaskStencils.m_nearest);
+            } else {
+                processColumn(colScratch.data(), numNodes, myInputData, myMaskStencils.m_stencils);
+            }
+#pragma omp critical
             {
-                case NEAREST:
-                    processColumn(colScratch.data(), numNodes, myInputData, myNearest);
-                    break;
-                case WEIGHTED:
-                    processColumn(colScratch.data(), numNodes, myInputData, myStencils);
-                    break;
-                case LINEAR:
-                    processColumn(colScratch.data(), myInputData, mySurf, myAreas, badNodeRoi, dataRoi, corrAreas, distance, nearest, linear, exponent, legacyCutoff, spacingStats.getMean());
-                    break;
+                myMetricOut->setValuesForColumn(outCol, colScratch.data());
             }
         }
-        myMetricOut->setValuesForColumn(0, colScratch.data());
     }
 }
 
-void AlgorithmMetricDilate::processColumn(float* colScratch, const int& numNodes, const float* myInputData, vector<pair<int, int> > myNearest)
+void AlgorithmMetricDilate::processColumn(float* colScratch, const int& numNodes, const float* myInputData, const vector<pair<int, int> >& myNearest)
 {
     for (int i = 0; i < numNodes; ++i)
     {
@@ -280,7 +341,7 @@ void AlgorithmMetricDilate::processColumn(float* colScratch, const int& numNodes
     }
 }
 
-void AlgorithmMetricDilate::processColumn(float* colScratch, const int& numNodes, const float* myInputData, vector<pair<int, StencilElem> > myStencils)
+void AlgorithmMetricDilate::processColumn(float* colScratch, const int& numNodes, const float* myInputData, const vector<pair<int, StencilElem> >& myStencils)
 {
     for (int i = 0; i < numNodes; ++i)
     {
@@ -523,11 +584,9 @@ void AlgorithmMetricDilate::processColumn(float* colScratch, const float* myInpu
 }
 
 void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >& myStencils, const SurfaceFile* mySurf, const float* myAreas,
-                                               const MetricFile* badNodeRoi, const MetricFile* dataRoi, const MetricFile* corrAreas,
+                                               const char* badMask, const MetricFile* dataRoi, const MetricFile* corrAreas,
                                                const float& distance, const float& exponent, const bool legacyCutoff)
 {
-    CaretAssert(badNodeRoi != NULL);//because it should never be called if we don't know exactly what nodes we are replacing
-    const float* badNodeData = badNodeRoi->getValuePointerForColumn(0);
     FastStatistics spacingStats;
     mySurf->getNodesSpacingStatistics(spacingStats);//use mean spacing to help set minimum stencil distance, since native surfaces might have a minimum of 0
     float cutoffBase = max(2.0f * distance, 2.0f * spacingStats.getMean()), cutoffRatio = max(1.1f, pow(49.0f, 1.0f / (exponent - 2.0f)));//find what ratio from closest vertex corresponds to having 98% of total weight accounted for on a plane, assuming non-adverse ROI
@@ -552,7 +611,7 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
     }
     for (int i = 0; i < numNodes; ++i)
     {
-        if (badNodeData[i] > 0.0f)
+        if (badMask[i] != 0)
         {
             ++badCount;
         } else {
@@ -582,7 +641,7 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
 #pragma omp CARET_FOR schedule(dynamic)
         for (int i = 0; i < numNodes; ++i)
         {
-            if (badNodeData[i] > 0.0f)
+            if (badMask[i] != 0)
             {
                 int myIndex;
 #pragma omp critical
@@ -654,10 +713,8 @@ void AlgorithmMetricDilate::precomputeStencils(vector<pair<int, StencilElem> >&
 }
 
 void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest, const SurfaceFile* mySurf,
-                                              const MetricFile* badNodeRoi, const MetricFile* dataRoi, const MetricFile* corrAreas, const float& distance)
+                                              const char* badMask, const MetricFile* dataRoi, const MetricFile* corrAreas, const float& distance)
 {
-    CaretAssert(badNodeRoi != NULL);//because it should never be called if we don't know exactly what nodes we are replacing
-    const float* badNodeData = badNodeRoi->getValuePointerForColumn(0);
     int numNodes = mySurf->getNumberOfNodes();
     vector<char> charRoi(numNodes, 0);
     const float* dataRoiVals = NULL;
@@ -668,7 +725,7 @@ void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest
     }
     for (int i = 0; i < numNodes; ++i)
     {
-        if (badNodeData[i] > 0.0f)
+        if (badMask[i] != 0)
         {
             ++badCount;
         } else {
@@ -698,7 +755,7 @@ void AlgorithmMetricDilate::precomputeNearest(vector<pair<int, int> >& myNearest
 #pragma omp CARET_FOR schedule(dynamic)
         for (int i = 0; i < numNodes; ++i)
         {
-            if (badNodeData[i] > 0.0f)
+            if (badMask[i] != 0)
             {
                 int myIndex;
 #pragma omp critical
@@ -32,14 +32,20 @@ namespace caret {
             std::vector<std::pair<int, float> > m_weightlist;
             float m_weightsum;
         };
+        struct MaskStencils
+        {//everything needed to dilate any column that has this set of bad vertices
+            std::vector<char> m_badMask;
+            std::vector<std::pair<int, StencilElem> > m_stencils;
+            std::vector<std::pair<int, int> > m_nearest;
+        };
         AlgorithmMetricDilate();
         void precomputeStencils(std::vector<std::pair<int, StencilElem> >& myStencils, const SurfaceFile* mySurf, const float* myAreas,
-                                const MetricFile* badNodeRoi, const MetricFile* dataRoi, const MetricFile* corrAreas,
+                                const char* badMask, const MetricFile* dataRoi, const MetricFile* corrAreas,
                                 const float& distance, const float& exponent, const bool legacyCutoff);
         void precomputeNearest(std::vector<std::pair<int, int> >& myNearest, const SurfaceFile* mySurf,
-                               const MetricFile* badNodeRoi, const MetricFile* dataRoi, const MetricFile* corrAreas, const float& distance);
-        void processColumn(float* colScratch, const int& numNodes, const float* myInputData, std::vector<std::pair<int, int> > myNearest);
-        void processColumn(float* colScratch, const int& numNodes, const float* myInputData, std::vector<std::pair<int, StencilElem> > myStencils);
+                               const char* badMask, const MetricFile* dataRoi, const MetricFile* corrAreas, const float& distance);
+        void processColumn(float* colScratch, const int& numNodes, const float* myInputData, const std::vector<std::pair<int, int> >& myNearest);
+        void processColumn(float* colScratch, const int& numNodes, const float* myInputData, const std::vector<std::pair<int, StencilElem> >& myStencils);
         void processColumn(float* colScratch, const float* myInputData, const SurfaceFile* mySurf, const float* myAreas,
                            const MetricFile* badNodeRoi, const MetricFile* dataRoi, const MetricFile* corrAreas,
                            const float& distance, const bool& nearest, const bool& linear, const float& exponent, const bool legacyCutoff, const float meanSpacing);
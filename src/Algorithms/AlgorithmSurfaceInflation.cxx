@@ -20,6 +20,7 @@
 /*LICENSE_END*/
 
 #include <cmath>
+#include <vector>
 
 #include "AlgorithmSurfaceInflation.h"
 #include "AlgorithmSurfaceSmoothing.h"
@@ -28,6 +29,7 @@
 #include "CaretAssert.h"
 #include "CaretLogger.h"
 #include "SurfaceFile.h"
+#include "SurfaceSmoothingObject.h"
 
 using namespace caret;
 
@@ -138,6 +140,17 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
                                                      const float inflationFactorIn)
    : AbstractAlgorithm(myProgObj)
 {
+    if ((strength < 0.0)
+        || (strength > 1.0)) {
+        throw AlgorithmException("Invalid smoothing strength outside [0.0, 1.0]: "
+                                 + QString::number(strength, 'f', 5));
+    }
+    
+    if (iterations <= 0) {
+        throw AlgorithmException("Invalid iterations value [1, infinity]: "
+                                 + QString::number(iterations));
+    }
+    
     std::vector<ProgressObject*> subAlgProgress;
     if (myProgObj != NULL) {
         subAlgProgress.resize(cycles);
@@ -153,17 +166,26 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
      */
     LevelProgress myProgress(myProgObj, 1.0f, 0.1f);//lower the internal weight
     
-    const float inflationFactor = inflationFactorIn - 1.0;
-    
     *outputSurfaceFile = *inputSurfaceFile;
     outputSurfaceFile->translateToCenterOfMass();
     
     const BoundingBox* anatomicalBoundingBox = anatomicalSurfaceFile->getBoundingBox();
-    const float anatomicalRangeX = anatomicalBoundingBox->getDifferenceX();
-    const float anatomicalRangeY = anatomicalBoundingBox->getDifferenceY();
-    const float anatomicalRangeZ = anatomicalBoundingBox->getDifferenceZ();
+    const float anatomicalRange[3] = { anatomicalBoundingBox->getDifferenceX(),
+                                       anatomicalBoundingBox->getDifferenceY(),
+                                       anatomicalBoundingBox->getDifferenceZ() };
     
     const int32_t numberOfNodes = outputSurfaceFile->getNumberOfNodes();
+    if (numberOfNodes <= 0) {
+        return;
+    }
+    
+    /*
+     * Topology is the same for every cycle, so flatten it once and keep
+     * the coordinates in a local array until all cycles are done
+     */
+    SurfaceSmoothingObject mySmoothObj(outputSurfaceFile);
+    std::vector<float> coords(outputSurfaceFile->getCoordinateData(),
+                              outputSurfaceFile->getCoordinateData() + numberOfNodes * 3);
     
     for (int iCycle = 0; iCycle < cycles; iCycle++) {
         /*
@@ -174,39 +196,26 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
         {
             subProgress = subAlgProgress[iCycle];
         }
-        AlgorithmSurfaceSmoothing(subProgress,
-                                  outputSurfaceFile,
-                                  outputSurfaceFile,
-                                  strength,
-                                  iterations);
+        {
+            LevelProgress smoothProgress(subProgress);
+            mySmoothObj.smooth(&coords[0],
+                               strength,
+                               iterations,
+                               &smoothProgress);
+        }
         
         /*
          * Inflate
          */
-        float xyz[3];
-        for (int32_t iNode = 0; iNode < numberOfNodes; iNode++) {
-            outputSurfaceFile->getCoordinate(iNode,
-                                             xyz);
-            
-            const float x = xyz[0] / anatomicalRangeX;
-            const float y = xyz[1] / anatomicalRangeY;
-            const float z = xyz[2] / anatomicalRangeZ;
-            
-            const float radius = std::sqrt(x*x + y*y + z*z);
-            const float scale  = 1.0 + inflationFactor * (1.0 - radius);
-            
-            xyz[0] *= scale;
-            xyz[1] *= scale;
-            xyz[2] *= scale;
-            
-            outputSurfaceFile->setCoordinate(iNode,
-                                             xyz);
-        }
+        mySmoothObj.inflate(&coords[0],
+                            anatomicalRange,
+                            inflationFactorIn);
         
         myProgress.reportProgress(static_cast<float>(iCycle +1)
                                   / static_cast<float>(cycles));
     }
     
+    outputSurfaceFile->setCoordinates(&coords[0]);
     outputSurfaceFile->computeNormals();
 }
 
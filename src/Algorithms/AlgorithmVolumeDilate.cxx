@@ -25,6 +25,7 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CaretPointLocator.h"
+#include "CaretPointer.h"
 #include "FloatMatrix.h"
 #include "Vector3D.h"
 #include "VolumeFile.h"
@@ -132,31 +133,33 @@ void AlgorithmVolumeDilate::useParameters(OperationParameters* myParams, Progres
 
 namespace
 {
+    const int MAX_CACHED_MASKS = 16;//frames with yet more distinct bad masks get dilated as they are found, without keeping their stencils
     
-    inline bool badVoxel(const bool labelMode, const int32_t unlabeledKey, const int64_t i, const int64_t j, const int64_t k, const VolumeFile* volIn, const int& insubvol, const int& component,
-                         const VolumeFile* badRoi, const VolumeFile* dataRoi)
+    struct DilateStencil
+    {//everything needed to dilate any frame that has this set of bad voxels
+        vector<char> m_badMask;
+        vector<int64_t> m_toReplace;//frame indices of bad voxels
+        vector<vector<pair<int64_t, float> > > m_sources;//frame index and weight of the voxels used for each bad voxel, weight is unused in NEAREST, empty if out of range
+    };
+    
+    inline bool badVoxel(const bool labelMode, const int32_t unlabeledKey, const int64_t index, const float* frame, const float* badRoiFrame, const float* dataRoiFrame)
     {
-        if (badRoi == NULL)
+        if (badRoiFrame == NULL)
         {
             if (labelMode)
             {
-                return (dataRoi == NULL || dataRoi->getValue(i, j, k) > 0.0f) && floor(0.5f + volIn->getValue(i, j, k, insubvol, component)) == unlabeledKey;//without bad roi, bad is implicitly "data and not 0/unlabeled"
+                return (dataRoiFrame == NULL || dataRoiFrame[index] > 0.0f) && floor(0.5f + frame[index]) == unlabeledKey;//without bad roi, bad is implicitly "data and not 0/unlabeled"
             } else {
-                return (dataRoi == NULL || dataRoi->getValue(i, j, k) > 0.0f) && volIn->getValue(i, j, k, insubvol, component) == 0.0f;
+                return (dataRoiFrame == NULL || dataRoiFrame[index] > 0.0f) && frame[index] == 0.0f;
             }
         } else {
-            return badRoi->getValue(i, j, k) > 0.0f;
+            return badRoiFrame[index] > 0.0f;
         }
     }
     
-    inline bool dataVoxel(const int64_t i, const int64_t j, const int64_t k, const VolumeFile* dataRoi)
-    {
-        return dataRoi == NULL || dataRoi->getValue(i, j, k) > 0.0f;
-    }
-    
-    void dilateFrame(const bool labelMode, const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol, const VolumeFile* badRoi,
-                            const VolumeFile* dataRoi, const float& distance, const AlgorithmVolumeDilate::Method& myMethod, const float& exponent, const bool& legacyCutoff)
-    {//copy data that is outside the dataROI, replace values where badROI is > 0 (with zero if nothing else), if no badROI, pretend badROI is (data == 0 && dataROI > 0)
+    void computeStencil(DilateStencil& stencilOut, const vector<char>& badMask, const VolumeSpace& myVolSpace, const float* dataRoiFrame,
+                        const float& distance, const AlgorithmVolumeDilate::Method& myMethod, const float& exponent, const bool& legacyCutoff)
+    {//which voxels get used, and with what weights, only depends on which voxels are bad, not on their values
         int neighbors[18] = {0, 0, -1,
                            0, -1, 0,
                            -1, 0, 0,
@@ -164,225 +167,309 @@ namespace
                            0, 1, 0,
                            0, 0, 1};//special behavior: when distance is 0, it still dilates by 1 voxel
         Vector3D voxStep[3], origin;
-        const VolumeSpace& myVolSpace = volIn->getVolumeSpace();
         myVolSpace.getSpacingVectors(voxStep[0], voxStep[1], voxStep[2], origin);
         //if the distance is within 1% of excluding a neighbor, we need to additionally check the neighbors
         bool checkNeighbors = distance <= voxStep[0].length() * 1.01f || distance <= voxStep[1].length() * 1.01f || distance <= voxStep[2].length() * 1.01f;
         //the single-voxel rule means we can't just base the maximum search distance on the dilation distance
         float cutoffBase = max(2.0f * distance, 2.0f * min(min(voxStep[0].length(), voxStep[1].length()), voxStep[2].length()));
         float minKernel = 1.5f * min(min(voxStep[0].length(), voxStep[1].length()), voxStep[2].length());//small kernels are cheap, so use a minimum of face+edge neighbors in isotropic volumes in weighted mode
-        vector<int64_t> myDims = volIn->getDimensions();
-        //HACK: unlabeledKey is also used to fill bad voxels that the dilation doesn't reach in non-label mode
-        int32_t unlabeledKey = 0;
-        if (labelMode) unlabeledKey = volIn->getMapLabelTable(insubvol)->getUnassignedLabelKey();
+        const int64_t* myDims = myVolSpace.getDims();
         vector<float> validPoints;
         vector<VoxelIJK> validIndices, toReplace;
-        vector<float> scratchFrame(myDims[0] * myDims[1] * myDims[2]);//uninitialized, we will copy every voxel we don't replace
+        stencilOut.m_badMask = badMask;
+        stencilOut.m_toReplace.clear();
         for (int64_t k = 0; k < myDims[2]; ++k)
         {
             for (int64_t j = 0; j < myDims[1]; ++j)
             {
                 for (int64_t i = 0; i < myDims[0]; ++i)
                 {
-                    if (badVoxel(labelMode, unlabeledKey, i, j, k, volIn, insubvol, component, badRoi, dataRoi))
+                    int64_t index = myVolSpace.getIndex(i, j, k);
+                    if (badMask[index] != 0)
                     {
                         toReplace.push_back(VoxelIJK(i, j, k));
-                    } else {//copy it, and if it is data, add to usable set
-                        if (labelMode)
-                        {
-                            scratchFrame[myVolSpace.getIndex(i, j, k)] = floor(0.5f + volIn->getValue(i, j, k, insubvol, component));
-                        } else {
-                            scratchFrame[myVolSpace.getIndex(i, j, k)] = volIn->getValue(i, j, k, insubvol, component);
-                        }
-                        if (dataVoxel(i, j, k, dataRoi))
-                        {
-                            VoxelIJK tempVoxel(i, j, k);
-                            Vector3D tempCoord = myVolSpace.indexToSpace(tempVoxel);
-                            validPoints.push_back(tempCoord[0]);
-                            validPoints.push_back(tempCoord[1]);
-                            validPoints.push_back(tempCoord[2]);
-                            validIndices.push_back(tempVoxel);
-                        }
+                        stencilOut.m_toReplace.push_back(index);
+                    } else if (dataRoiFrame == NULL || dataRoiFrame[index] > 0.0f) {//if it is data, add to usable set
+                        VoxelIJK tempVoxel(i, j, k);
+                        Vector3D tempCoord = myVolSpace.indexToSpace(tempVoxel);
+                        validPoints.push_back(tempCoord[0]);
+                        validPoints.push_back(tempCoord[1]);
+                        validPoints.push_back(tempCoord[2]);
+                        validIndices.push_back(tempVoxel);
                     }
                 }
             }
         }
-        if (!toReplace.empty())
-        {
-            CaretPointLocator locator(validPoints);
+        stencilOut.m_sources.clear();
+        stencilOut.m_sources.resize(toReplace.size());
+        if (toReplace.empty()) return;
+        CaretPointLocator locator(validPoints);
 #pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t whichVoxel = 0; whichVoxel < (int64_t)toReplace.size(); ++whichVoxel)
+        for (int64_t whichVoxel = 0; whichVoxel < (int64_t)toReplace.size(); ++whichVoxel)
+        {
+            const VoxelIJK& iter = toReplace[whichVoxel];
+            vector<pair<int64_t, float> >& mySources = stencilOut.m_sources[whichVoxel];
+            int64_t i = iter.m_ijk[0], j = iter.m_ijk[1], k = iter.m_ijk[2];
+            Vector3D voxcoord = myVolSpace.indexToSpace(i, j, k);
+            switch (myMethod)
             {
-                const VoxelIJK& iter = toReplace[whichVoxel];
-                int64_t i = iter.m_ijk[0], j = iter.m_ijk[1], k = iter.m_ijk[2];
-                Vector3D voxcoord = myVolSpace.indexToSpace(i, j, k);
-                switch (myMethod)
+                case AlgorithmVolumeDilate::NEAREST:
                 {
-                    case AlgorithmVolumeDilate::NEAREST:
+                    int64_t index = locator.closestPointLimited(voxcoord, distance);
+                    if (index < 0)
                     {
-                        int64_t index = locator.closestPointLimited(voxcoord, distance);
-                        float bestVal = unlabeledKey;//HACK: unlabeledKey is 0 when we aren't in label mode, so can double as default value for bad voxel beyond dilate range
-                        if (index < 0)
+                        float bestDist = -1.0f;
+                        int64_t bestIndex = -1;
+                        if (checkNeighbors)
                         {
-                            float bestDist = -1.0f;
-                            if (checkNeighbors)
+                            for (int n = 0; n < 6; ++n)
                             {
-                                for (int n = 0; n < 6; ++n)
+                                int neighbase = n * 3;
+                                int64_t neighVox[3] = {i + neighbors[neighbase], j + neighbors[neighbase + 1], k + neighbors[neighbase + 2]};
+                                if (myVolSpace.indexValid(neighVox) && badMask[myVolSpace.getIndex(neighVox)] == 0)
                                 {
-                                    int neighbase = n * 3;
-                                    int64_t neighVox[3] = {i + neighbors[neighbase], j + neighbors[neighbase + 1], k + neighbors[neighbase + 2]};
-                                    if (myVolSpace.indexValid(neighVox) && ! badVoxel(labelMode, unlabeledKey, neighVox[0], neighVox[1], neighVox[2], volIn, insubvol, component, badRoi, dataRoi))
+                                    float tempdist = (myVolSpace.indexToSpace(neighbors + neighbase) - myVolSpace.indexToSpace(0, 0, 0)).length();//slightly hacky, but won't have inconsistencies from different rounding per bad voxel
+                                    if (tempdist < bestDist || bestDist == -1.0f)
                                     {
-                                        float tempdist = (myVolSpace.indexToSpace(neighbors + neighbase) - myVolSpace.indexToSpace(0, 0, 0)).length();//slightly hacky, but won't have inconsistencies from different rounding per bad voxel
-                                        if (tempdist < bestDist || bestDist == -1.0f)
-                                        {
-                                            bestDist = tempdist;
-                                            bestVal = volIn->getValue(neighVox, insubvol, component);
-                                        }
+                                        bestDist = tempdist;
+                                        bestIndex = myVolSpace.getIndex(neighVox);
                                     }
                                 }
                             }
-                        } else {
-                            bestVal = volIn->getValue(validIndices[index], insubvol, component);
                         }
-                        if (labelMode)
+                        if (bestIndex != -1)
                         {
-                            bestVal = floor(0.5f + bestVal);
+                            mySources.push_back(pair<int64_t, float>(bestIndex, 1.0f));
                         }
-                        scratchFrame[myVolSpace.getIndex(i, j, k)] = bestVal;
-                        break;
+                    } else {
+                        mySources.push_back(pair<int64_t, float>(myVolSpace.getIndex(validIndices[index].m_ijk), 1.0f));
                     }
-                    case AlgorithmVolumeDilate::WEIGHTED:
+                    break;
+                }
+                case AlgorithmVolumeDilate::WEIGHTED:
+                {
+                    vector<LocatorInfo> inRange;
+                    if (legacyCutoff)
                     {
-                        vector<LocatorInfo> inRange;
-                        if (legacyCutoff)
+                        inRange = locator.pointsInRange(voxcoord, distance);//immediate neighbor special case is handled below
+                    } else {
+                        float closeDist = -1.0f;
+                        LocatorInfo myInfo;
+                        int64_t index = locator.closestPointLimited(voxcoord, distance, &myInfo);//only need the distance
+                        bool found = false;
+                        if (index >= 0)
                         {
-                            inRange = locator.pointsInRange(voxcoord, distance);//immediate neighbor special case is handled below
+                            found = true;
+                            closeDist = (myInfo.coords - voxcoord).length();
                         } else {
-                            float closeDist = -1.0f;
-                            LocatorInfo myInfo;
-                            int64_t index = locator.closestPointLimited(voxcoord, distance, &myInfo);//only need the distance
-                            bool found = false;
-                            if (index >= 0)
-                            {
-                                found = true;
-                                closeDist = (myInfo.coords - voxcoord).length();
-                            } else {
-                                if (checkNeighbors)
-                                {//always dilate to neighbor voxels, regardless
-                                    for (int n = 0; n < 6; ++n)
+                            if (checkNeighbors)
+                            {//always dilate to neighbor voxels, regardless
+                                for (int n = 0; n < 6; ++n)
+                                {
+                                    int neighbase = n * 3;
+                                    int64_t neighVox[3] = {i + neighbors[neighbase], j + neighbors[neighbase + 1], k + neighbors[neighbase + 2]};
+                                    if (myVolSpace.indexValid(neighVox) && badMask[myVolSpace.getIndex(neighVox)] == 0)
                                     {
-                                        int neighbase = n * 3;
-                                        int64_t neighVox[3] = {i + neighbors[neighbase], j + neighbors[neighbase + 1], k + neighbors[neighbase + 2]};
-                                        if (myVolSpace.indexValid(neighVox) && ! badVoxel(labelMode, unlabeledKey, neighVox[0], neighVox[1], neighVox[2], volIn, insubvol, component, badRoi, dataRoi))
+                                        float tempdist = (myVolSpace.indexToSpace(neighbors + neighbase) - myVolSpace.indexToSpace(0, 0, 0)).length();//slightly hacky, but won't have inconsistencies from different rounding per voxel
+                                        if (tempdist < closeDist || !found)
                                         {
-                                            float tempdist = (myVolSpace.indexToSpace(neighbors + neighbase) - myVolSpace.indexToSpace(0, 0, 0)).length();//slightly hacky, but won't have inconsistencies from different rounding per voxel
-                                            if (tempdist < closeDist || !found)
-                                            {
-                                                found = true;
-                                                closeDist = tempdist;
-                                            }
+                                            found = true;
+                                            closeDist = tempdist;
                                         }
                                     }
                                 }
                             }
-                            if (found)
-                            {
-                                //find what cutoff corresponds to 98% of the total weight being found compared to an infinite kernel
-                                //to do this, assume a non-adversarial situation, where farther parts have at most equal angular area to closer ones
-                                //49 = 98/(100-98)
-                                float cutoffRatio = max(1.1f, pow(49.0f, 1.0f / (exponent - 3.0f))), cutoffDist = cutoffBase;//find what cutoff ratio corresponds to a hudredth of weight
-                                if (exponent > 3.0f && cutoffRatio < 100.0f && cutoffRatio > 1.0f)//if the ratio is sane, use it, but never exceed cutoffBase
-                                {
-                                    cutoffDist = max(min(cutoffRatio * closeDist, cutoffDist), minKernel);//but small kernels are rather cheap anyway, so have a minimum size just in case
-                                }
-                                inRange = locator.pointsInRange(voxcoord, cutoffDist);
-                            }
                         }
-                        map<int32_t, float> labelSums;
-                        double sum = 0.0, weightsum = 0.0;
-                        if (legacyCutoff && checkNeighbors)
-                        {//add valid neighbors only if they aren't already in the list, and the non-legacy mode is already handled above...
-                            set<VoxelIJK> voxelsToUse;//but looking up the neighbors' indices in validIndices is work we don't need to do, so copy the list and add to it
-                            for (auto thisInfo : inRange)
+                        if (found)
+                        {
+                            //find what cutoff corresponds to 98% of the total weight being found compared to an infinite kernel
+                            //to do this, assume a non-adversarial situation, where farther parts have at most equal angular area to closer ones
+                            //49 = 98/(100-98)
+                            float cutoffRatio = max(1.1f, pow(49.0f, 1.0f / (exponent - 3.0f))), cutoffDist = cutoffBase;//find what cutoff ratio corresponds to a hudredth of weight
+                            if (exponent > 3.0f && cutoffRatio < 100.0f && cutoffRatio > 1.0f)//if the ratio is sane, use it, but never exceed cutoffBase
                             {
-                                voxelsToUse.insert(validIndices[thisInfo.index]);
+                                cutoffDist = max(min(cutoffRatio * closeDist, cutoffDist), minKernel);//but small kernels are rather cheap anyway, so have a minimum size just in case
                             }
-                            for (int n = 0; n < 6; ++n)
-                            {
-                                int neighbase = n * 3;
-                                int64_t neighVox[3] = {i + neighbors[neighbase], j + neighbors[neighbase + 1], k + neighbors[neighbase + 2]};
-                                if (myVolSpace.indexValid(neighVox) && ! badVoxel(labelMode, unlabeledKey, neighVox[0], neighVox[1], neighVox[2], volIn, insubvol, component, badRoi, dataRoi))
-                                {
-                                    voxelsToUse.insert(neighVox);//set eliminates duplicates
-                                }
-                            }
-                            for (auto thisVoxel : voxelsToUse)//unfortunately, this means we need to write a copy of the loop for the common case not to do unneeded work
+                            inRange = locator.pointsInRange(voxcoord, cutoffDist);
+                        }
+                    }
+                    if (legacyCutoff && checkNeighbors)
+                    {//add valid neighbors only if they aren't already in the list, and the non-legacy mode is already handled above...
+                        set<VoxelIJK> voxelsToUse;//but looking up the neighbors' indices in validIndices is work we don't need to do, so copy the list and add to it
+                        for (auto thisInfo : inRange)
+                        {
+                            voxelsToUse.insert(validIndices[thisInfo.index]);
+                        }
+                        for (int n = 0; n < 6; ++n)
+                        {
+                            int neighbase = n * 3;
+                            int64_t neighVox[3] = {i + neighbors[neighbase], j + neighbors[neighbase + 1], k + neighbors[neighbase + 2]};
+                            if (myVolSpace.indexValid(neighVox) && badMask[myVolSpace.getIndex(neighVox)] == 0)
                             {
-                                float thisdist = (myVolSpace.indexToSpace(thisVoxel) - voxcoord).length();
-                                float weight = 1.0f / pow(thisdist, exponent);
-                                if (labelMode)
-                                {
-                                    int32_t thisKey = int32_t(floor(0.5f + volIn->getValue(thisVoxel, insubvol, component)));
-                                    map<int32_t, float>::iterator iter = labelSums.find(thisKey);
-                                    if (iter == labelSums.end())
-                                    {
-                                        labelSums[thisKey] = weight;
-                                    } else {
-                                        iter->second += weight;
-                                    }
-                                } else {
-                                    sum += weight * volIn->getValue(thisVoxel, insubvol, component);
-                                    weightsum += weight;
-                                }
+                                voxelsToUse.insert(neighVox);//set eliminates duplicates
                             }
-                        } else {
-                            for (auto thisInfo : inRange)
+                        }
+                        for (auto thisVoxel : voxelsToUse)//unfortunately, this means we need to write a copy of the loop for the common case not to do unneeded work
+                        {
+                            float thisdist = (myVolSpace.indexToSpace(thisVoxel) - voxcoord).length();
+                            mySources.push_back(pair<int64_t, float>(myVolSpace.getIndex(thisVoxel.m_ijk), 1.0f / pow(thisdist, exponent)));
+                        }
+                    } else {
+                        for (auto thisInfo : inRange)
+                        {
+                            float thisdist = (thisInfo.coords - voxcoord).length();
+                            mySources.push_back(pair<int64_t, float>(myVolSpace.getIndex(validIndices[thisInfo.index].m_ijk), 1.0f / pow(thisdist, exponent)));
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    
+    void applyStencil(const DilateStencil& myStencil, const bool labelMode, const int32_t unlabeledKey, const AlgorithmVolumeDilate::Method& myMethod,
+                      const float* frame, float* scratchFrame, const int64_t& frameSize)
+    {//copy data that is outside the dataROI, replace values where badROI is > 0 (with zero if nothing else)
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            if (myStencil.m_badMask[i] == 0)
+            {
+                if (labelMode)
+                {
+                    scratchFrame[i] = floor(0.5f + frame[i]);
+                } else {
+                    scratchFrame[i] = frame[i];
+                }
+            }
+        }
+        int64_t numReplace = (int64_t)myStencil.m_toReplace.size();
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t whichVoxel = 0; whichVoxel < numReplace; ++whichVoxel)
+        {
+            const vector<pair<int64_t, float> >& mySources = myStencil.m_sources[whichVoxel];
+            float& outVal = scratchFrame[myStencil.m_toReplace[whichVoxel]];
+            switch (myMethod)
+            {
+                case AlgorithmVolumeDilate::NEAREST:
+                {
+                    float bestVal = unlabeledKey;//HACK: unlabeledKey is 0 when we aren't in label mode, so can double as default value for bad voxel beyond dilate range
+                    if (!mySources.empty())
+                    {
+                        bestVal = frame[mySources[0].first];
+                    }
+                    if (labelMode)
+                    {
+                        bestVal = floor(0.5f + bestVal);
+                    }
+                    outVal = bestVal;
+                    break;
+                }
+                case AlgorithmVolumeDilate::WEIGHTED:
+                {
+                    if (labelMode)
+                    {
+                        map<int32_t, float> labelSums;
+                        for (auto thisSource : mySources)
+                        {
+                            int32_t thisKey = int32_t(floor(0.5f + frame[thisSource.first]));
+                            map<int32_t, float>::iterator iter = labelSums.find(thisKey);
+                            if (iter == labelSums.end())
                             {
-                                float thisdist = (thisInfo.coords - voxcoord).length();
-                                float weight = 1.0f / pow(thisdist, exponent);
-                                if (labelMode)
-                                {
-                                    int32_t thisKey = int32_t(floor(0.5f + volIn->getValue(validIndices[thisInfo.index], insubvol, component)));
-                                    map<int32_t, float>::iterator iter = labelSums.find(thisKey);
-                                    if (iter == labelSums.end())
-                                    {
-                                        labelSums[thisKey] = weight;
-                                    } else {
-                                        iter->second += weight;
-                                    }
-                                } else {
-                                    sum += weight * volIn->getValue(validIndices[thisInfo.index], insubvol, component);
-                                    weightsum += weight;
-                                }
+                                labelSums[thisKey] = thisSource.second;
+                            } else {
+                                iter->second += thisSource.second;
                             }
                         }
-                        if (labelMode)
+                        float bestWeight = -1.0f;//all weights should be positive, so their sums should too
+                        int32_t bestKey = unlabeledKey;
+                        for (auto iter : labelSums)
                         {
-                            float bestWeight = -1.0f;//all weights should be positive, so their sums should too
-                            int32_t bestKey = unlabeledKey;
-                            for (auto iter : labelSums)
+                            if (iter.second > bestWeight)
                             {
-                                if (iter.second > bestWeight)
-                                {
-                                    bestWeight = iter.second;
-                                    bestKey = iter.first;
-                                }
+                                bestWeight = iter.second;
+                                bestKey = iter.first;
                             }
-                            scratchFrame[myVolSpace.getIndex(i, j, k)] = bestKey;
+                        }
+                        outVal = bestKey;
+                    } else {
+                        double sum = 0.0, weightsum = 0.0;
+                        for (auto thisSource : mySources)
+                        {
+                            sum += thisSource.second * frame[thisSource.first];
+                            weightsum += thisSource.second;
+                        }
+                        if (weightsum > 0.0)
+                        {
+                            outVal = sum / weightsum;
                         } else {
-                            if (weightsum > 0.0)
-                            {
-                                scratchFrame[myVolSpace.getIndex(i, j, k)] = sum / weightsum;
-                            } else {
-                                scratchFrame[myVolSpace.getIndex(i, j, k)] = 0.0f;
-                            }
+                            outVal = 0.0f;
                         }
-                        break;
                     }
+                    break;
                 }
             }
         }
+    }
+    
+    class StencilCache
+    {//the bad mask is the same for every frame with a bad voxel roi, and often also without one (all frames zero outside the brain), so compute each distinct stencil once
+        vector<CaretPointer<DilateStencil> > m_stencils;
+        map<uint64_t, vector<int> > m_byHash;
+    public:
+        const DilateStencil* find(const vector<char>& badMask, const uint64_t& maskHash) const
+        {
+            map<uint64_t, vector<int> >::const_iterator iter = m_byHash.find(maskHash);
+            if (iter == m_byHash.end()) return NULL;
+            for (int i = 0; i < (int)iter->second.size(); ++i)
+            {
+                if (m_stencils[iter->second[i]]->m_badMask == badMask) return m_stencils[iter->second[i]];//hash collisions are possible, so check the whole mask
+            }
+            return NULL;
+        }
+        bool full() const { return (int)m_stencils.size() >= MAX_CACHED_MASKS; }
+        const DilateStencil* add(const CaretPointer<DilateStencil>& stencil, const uint64_t& maskHash)
+        {
+            m_byHash[maskHash].push_back((int)m_stencils.size());
+            m_stencils.push_back(stencil);
+            return stencil;
+        }
+    };
+    
+    void dilateFrame(const bool labelMode, const VolumeFile* volIn, const int& insubvol, const int& component, VolumeFile* volOut, const int& outsubvol, const VolumeFile* badRoi,
+                     const VolumeFile* dataRoi, const float& distance, const AlgorithmVolumeDilate::Method& myMethod, const float& exponent, const bool& legacyCutoff, StencilCache& myCache)
+    {//if no badROI, pretend badROI is (data == 0 && dataROI > 0)
+        const VolumeSpace& myVolSpace = volIn->getVolumeSpace();
+        const int64_t* myDims = myVolSpace.getDims();
+        int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+        //HACK: unlabeledKey is also used to fill bad voxels that the dilation doesn't reach in non-label mode
+        int32_t unlabeledKey = 0;
+        if (labelMode) unlabeledKey = volIn->getMapLabelTable(insubvol)->getUnassignedLabelKey();
+        const float* frame = volIn->getFrame(insubvol, component);
+        const float* badRoiFrame = NULL, *dataRoiFrame = NULL;
+        if (badRoi != NULL) badRoiFrame = badRoi->getFrame();
+        if (dataRoi != NULL) dataRoiFrame = dataRoi->getFrame();
+        vector<char> badMask(frameSize);
+        uint64_t maskHash = 14695981039346656037ULL;//FNV-1a
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            badMask[i] = badVoxel(labelMode, unlabeledKey, i, frame, badRoiFrame, dataRoiFrame) ? 1 : 0;
+            maskHash = (maskHash ^ (unsigned char)badMask[i]) * 1099511628211ULL;
+        }
+        const DilateStencil* myStencil = myCache.find(badMask, maskHash);
+        CaretPointer<DilateStencil> newStencil;
+        if (myStencil == NULL)
+        {
+            newStencil.grabNew(new DilateStencil());
+            computeStencil(*newStencil, badMask, myVolSpace, dataRoiFrame, distance, myMethod, exponent, legacyCutoff);
+            if (myCache.full())
+            {
+                myStencil = newStencil;
+            } else {
+                myStencil = myCache.add(newStencil, maskHash);
+            }
+        }
+        vector<float> scratchFrame(frameSize);//uninitialized, we will copy every voxel we don't replace
+        applyStencil(*myStencil, labelMode, unlabeledKey, myMethod, frame, scratchFrame.data(), frameSize);
         volOut->setFrame(scratchFrame.data(), outsubvol, component);
     }
 }
@@ -439,19 +526,20 @@ AlgorithmVolumeDilate::AlgorithmVolumeDilate(ProgressObject* myProgObj, const Vo
         }
         volOut->setMapName(0, volIn->getMapName(subvol) + " dilate " + AString::number(distance));
     }
+    StencilCache myCache;
     if (subvol == -1)
     {
         for (int s = 0; s < myDims[3]; ++s)
         {
             for (int c = 0; c < myDims[4]; ++c)
             {
-                dilateFrame(isLabelData, volIn, s, c, volOut, s, badRoi, dataRoi, distance, myMethod, exponent, legacyCutoff);
+                dilateFrame(isLabelData, volIn, s, c, volOut, s, badRoi, dataRoi, distance, myMethod, exponent, legacyCutoff, myCache);
             }
         }
     } else {
         for (int c = 0; c < myDims[4]; ++c)
         {
-            dilateFrame(isLabelData, volIn, subvol, c, volOut, 0, badRoi, dataRoi, distance, myMethod, exponent, legacyCutoff);
+            dilateFrame(isLabelData, volIn, subvol, c, volOut, 0, badRoi, dataRoi, distance, myMethod, exponent, legacyCutoff, myCache);
         }
     }
 }
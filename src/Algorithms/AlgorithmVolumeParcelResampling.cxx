@@ -21,10 +21,12 @@
 #include "AlgorithmVolumeParcelResampling.h"
 #include "AlgorithmException.h"
 #include "VolumeFile.h"
-#include "AlgorithmVolumeSmoothing.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "Vector3D.h"
+#include "VolumeParcelSmoother.h"
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <utility>
@@ -35,6 +37,42 @@ using namespace std;
 
 const int FIX_ZEROS_POST_ITERATIONS = 10;//number of times to do the "find remaining zeros and try to fill" code before giving up when -fix-zeros is specified
 
+namespace
+{
+    const int64_t PARCEL_RESAMPLING_BLOCK_BYTES = 64 * (int64_t)(1 << 20);//output frames are computed and written in blocks of about this size
+
+    struct ResampleParcel
+    {
+        int m_curLabelValue;
+        int m_smoothParcel;//index in the parcel smoother
+        vector<int64_t> m_newList;//i, j, k triples of the voxels to output
+        vector<int64_t> m_newToSmoothed;//without fix zeros: position of each output voxel in the smoothed values, -1 if it must be extrapolated
+        int64_t m_extrema[6];//with fix zeros: bounding box of the smoothed region
+        vector<int64_t> m_boxIndices;//with fix zeros: index in the bounding box of each smoothed voxel
+        vector<char> m_useInput;//with fix zeros: whether each smoothed voxel is in the current label
+    };
+
+    void setupOutput(const VolumeFile* inVol, VolumeFile* outVol, const int& subvolNum, vector<int64_t>& inMaps)
+    {//output map s uses input map inMaps[s]
+        vector<int64_t> myDims;
+        inVol->getDimensions(myDims);
+        inMaps.clear();
+        if (subvolNum == -1)
+        {
+            outVol->reinitialize(inVol->getOriginalDimensions(), inVol->getSform(), myDims[4], inVol->getType(), inVol->m_header);
+            for (int64_t s = 0; s < myDims[3]; ++s)
+            {
+                inMaps.push_back(s);
+            }
+        } else {
+            vector<int64_t> newDims = inVol->getOriginalDimensions();
+            newDims.resize(3);//discard nonspatial dimentions
+            outVol->reinitialize(newDims, inVol->getSform(), myDims[4], inVol->getType(), inVol->m_header);
+            inMaps.push_back(subvolNum);
+        }
+    }
+}
+
 AString AlgorithmVolumeParcelResampling::getCommandSwitch()
 {
     return "-volume-parcel-resampling";
@@ -116,6 +154,10 @@ AlgorithmVolumeParcelResampling::AlgorithmVolumeParcelResampling(ProgressObject*
     {
         throw AlgorithmException("invalid subvolume specified");
     }
+    if (kernel <= 0.0f)
+    {
+        throw AlgorithmException("kernel too small");
+    }
     vector<pair<int, int> > matchedLabels;
     matchLabels(curLabel, newLabel, matchedLabels);
     if (matchedLabels.size() == 0)
@@ -226,221 +268,135 @@ void AlgorithmVolumeParcelResampling::resample(LevelProgress& myProgress, const
     }
     vector<int64_t> myDims;
     inVol->getDimensions(myDims);
-    if (subvolNum == -1)
-    {
-        outVol->reinitialize(inVol->getOriginalDimensions(), inVol->getSform(), myDims[4], inVol->getType(), inVol->m_header);
-    } else {
-        vector<int64_t> newDims = inVol->getOriginalDimensions();
-        newDims.resize(3);//discard nonspatial dimentions
-        outVol->reinitialize(newDims, inVol->getSform(), myDims[4], inVol->getType(), inVol->m_header);
-    }
-    outVol->setValueAllVoxels(0.0f);
-    const GiftiLabelTable* curTable = curLabel->getMapLabelTable(0);
+    vector<int64_t> inMaps;
+    setupOutput(inVol, outVol, subvolNum, inMaps);
+    VolumeParcelSmoother mySmoother(inVol->getVolumeSpace(), kernel);
+    vector<ResampleParcel> parcels;
     for (int whichList = 0; whichList < numLabels; ++whichList)
     {
         int curLabelValue = matchedLabels[whichList].first;
         int newLabelValue = matchedLabels[whichList].second;
-        myProgress.reportProgress(((float)whichList) / numLabels);
-        myProgress.setTask("Processing parcel " + curTable->getLabelName(curLabelValue));
+        if (newLabelReverse[newLabelValue] != whichList) continue;//a later label with the same new key overwrites every output voxel of this one
         const vector<int64_t>& thisList = voxelLists[whichList];
         int64_t listSize = (int64_t)thisList.size();
         if (listSize > 2)//NOTE: this should NEVER be something other than a multiple of 3, but check against what we will actually access anyway
         {
-            int extrema[6] = { thisList[0],
-                                thisList[0],
-                                thisList[1],
-                                thisList[1],
-                                thisList[2],
-                                thisList[2] };
-            for (int64_t base = 3; base < listSize; base += 3)
-            {
-                if (thisList[base] < extrema[0]) extrema[0] = thisList[base];
-                if (thisList[base] > extrema[1]) extrema[1] = thisList[base];
-                if (thisList[base + 1] < extrema[2]) extrema[2] = thisList[base + 1];
-                if (thisList[base + 1] > extrema[3]) extrema[3] = thisList[base + 1];
-                if (thisList[base + 2] < extrema[4]) extrema[4] = thisList[base + 2];
-                if (thisList[base + 2] > extrema[5]) extrema[5] = thisList[base + 2];
-            }
-            vector<int64_t> boxdims;
-            boxdims.push_back(extrema[1] - extrema[0] + 1);
-            boxdims.push_back(extrema[3] - extrema[2] + 1);
-            boxdims.push_back(extrema[5] - extrema[4] + 1);
-            VolumeFile roibox(boxdims, inVol->getSform());
-            roibox.setValueAllVoxels(0.0f);
-            vector<int64_t> curList, newList;//make the 2 separate lists, so we don't need to test the label volume
-            for (int64_t base = 0; base < listSize; base += 3)//could do this when we make the merged list...maybe use member variables to cut the argument clutter
+            ResampleParcel thisParcel;
+            thisParcel.m_curLabelValue = curLabelValue;
+            vector<int64_t> curList;//smooth within only the current label, then copy or extrapolate into the new label
+            for (int64_t base = 0; base < listSize; base += 3)
             {
                 int curvalue = (int)floor(curLabel->getValue(thisList[base], thisList[base + 1], thisList[base + 2]) + 0.5f);
                 int newvalue = (int)floor(newLabel->getValue(thisList[base], thisList[base + 1], thisList[base + 2]) + 0.5f);
+                if (newvalue == newLabelValue)
+                {
+                    thisParcel.m_newList.push_back(thisList[base]);
+                    thisParcel.m_newList.push_back(thisList[base + 1]);
+                    thisParcel.m_newList.push_back(thisList[base + 2]);
+                    thisParcel.m_newToSmoothed.push_back(curvalue == curLabelValue ? (int64_t)curList.size() / 3 : -1);
+                }
                 if (curvalue == curLabelValue)
                 {
                     curList.push_back(thisList[base]);
                     curList.push_back(thisList[base + 1]);
                     curList.push_back(thisList[base + 2]);
                 }
-                if (newvalue == newLabelValue)
-                {
-                    newList.push_back(thisList[base]);
-                    newList.push_back(thisList[base + 1]);
-                    newList.push_back(thisList[base + 2]);
-                }
             }
-            int64_t curListSize = (int64_t)curList.size();
-            int64_t newListSize = (int64_t)newList.size();
-            if (subvolNum == -1)
+            thisParcel.m_smoothParcel = mySmoother.addParcel(curList);
+            parcels.push_back(thisParcel);
+        }
+    }
+    float kernelMult = -1.0f / kernel / kernel / 2.0f;//precompute the part of the kernel function that doesn't change
+    const float* labelFrame = curLabel->getFrame();
+    int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+    int64_t numMaps = (int64_t)inMaps.size(), numFrames = numMaps * myDims[4];
+    int64_t blockFrames = max((int64_t)1, PARCEL_RESAMPLING_BLOCK_BYTES / (int64_t)(frameSize * sizeof(float)));
+    int numParcels = (int)parcels.size();
+    vector<float> outBlock;
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += blockFrames)
+    {//parallel across parcels and frames, output voxels of different parcels never overlap
+        myProgress.reportProgress(((float)blockStart) / numFrames);
+        int64_t blockCount = min(blockFrames, numFrames - blockStart);
+        outBlock.assign(blockCount * frameSize, 0.0f);
+        int64_t numItems = blockCount * numParcels;
+#pragma omp CARET_PAR
+        {
+            VolumeParcelSmoother::Scratch myScratch;
+            vector<float> smoothedIn, smoothedOut;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t item = 0; item < numItems; ++item)
             {
-                boxdims.push_back(myDims[3]);
-                VolumeFile inbox(boxdims, inVol->getSform(), myDims[4]), outbox;
-                for (int c = 0; c < myDims[4]; ++c)
+                const ResampleParcel& thisParcel = parcels[item / blockCount];
+                int curLabelValue = thisParcel.m_curLabelValue;
+                int64_t frame = item % blockCount;
+                const float* inFrame = inVol->getFrame(inMaps[(blockStart + frame) % numMaps], (blockStart + frame) / numMaps);
+                float* outFrame = outBlock.data() + frame * frameSize;
+                const vector<int64_t>& curIndices = mySmoother.getParcelFrameIndices(thisParcel.m_smoothParcel);
+                int64_t curSize = (int64_t)curIndices.size();
+                smoothedIn.resize(curSize);
+                smoothedOut.resize(curSize);
+                for (int64_t v = 0; v < curSize; ++v)
                 {
-                    for (int s = 0; s < myDims[3]; ++s)
-                    {
-                        for (int64_t base = 0; base < curListSize; base += 3)
-                        {
-                            if (s == 0 && c == 0)//first, smooth within only the current label
-                            {
-                                roibox.setValue(1.0f, curList[base] - extrema[0], curList[base + 1] - extrema[2], curList[base + 2] - extrema[4]);
-                            }
-                            inbox.setValue(inVol->getValue(curList[base], curList[base + 1], curList[base + 2], s, c),
-                                curList[base] - extrema[0], curList[base + 1] - extrema[2], curList[base + 2] - extrema[4], s, c);
-                        }
-                    }
+                    smoothedIn[v] = inFrame[curIndices[v]];
                 }
-                AlgorithmVolumeSmoothing(NULL, &inbox, kernel, &outbox, &roibox, false);
-                float kernelMult = -1.0f / kernel / kernel / 2.0f;//precompute the part of the kernel function that doesn't change
-                for (int c = 0; c < myDims[4]; ++c)
+                mySmoother.smoothParcel(thisParcel.m_smoothParcel, smoothedIn.data(), smoothedOut.data(), false, myScratch);
+                const vector<int64_t>& newList = thisParcel.m_newList;
+                int64_t newListSize = (int64_t)newList.size();
+                for (int64_t base = 0; base < newListSize; base += 3)
                 {
-                    for (int s = 0; s < myDims[3]; ++s)
+                    int64_t outIndex = newList[base] + myDims[0] * (newList[base + 1] + myDims[1] * newList[base + 2]);
+                    int64_t smoothedIndex = thisParcel.m_newToSmoothed[base / 3];
+                    if (smoothedIndex >= 0)
                     {
-                        const float* inFrame = inVol->getFrame(s, c);
-                        const float* labelFrame = curLabel->getFrame();
-                        for (int64_t base = 0; base < newListSize; base += 3)
+                        outFrame[outIndex] = smoothedOut[smoothedIndex];
+                    } else {
+                        float sum = 0.0f, weightsum = 0.0f;//coded in-place for now, its a special restricted case of volume dilate, copied out of nonorth volume smoothing
+                        int i = newList[base], j = newList[base + 1], k = newList[base + 2];//special casing orthogonal would be faster, but harder to follow/debug, and more code
+                        int imin = i - irange, imax = i + irange + 1;//one-after array size convention
+                        if (imin < 0) imin = 0;
+                        if (imax > myDims[0]) imax = myDims[0];
+                        int jmin = j - jrange, jmax = j + jrange + 1;
+                        if (jmin < 0) jmin = 0;
+                        if (jmax > myDims[1]) jmax = myDims[1];
+                        int kmin = k - krange, kmax = k + krange + 1;
+                        if (kmin < 0) kmin = 0;
+                        if (kmax > myDims[2]) kmax = myDims[2];
+                        Vector3D kscratch, jscratch, iscratch;
+                        for (int kkern = kmin; kkern < kmax; ++kkern)
                         {
-                            int myCurVal = (int)floor(curLabel->getValue(newList[base], newList[base + 1], newList[base + 2]) + 0.5f);
-                            if (myCurVal == curLabelValue)
+                            kscratch = kvec * (kkern - k);
+                            int64_t kindpart = kkern * myDims[1];
+                            for (int jkern = jmin; jkern < jmax; ++jkern)
                             {
-                                outVol->setValue(outbox.getValue(newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], s, c),
-                                    newList[base], newList[base + 1], newList[base + 2], s, c);
-                            } else {
-                                float sum = 0.0f, weightsum = 0.0f;//coded in-place for now, its a special restricted case of volume dilate, copied out of nonorth volume smoothing
-                                int i = newList[base], j = newList[base + 1], k = newList[base + 2];//special casing orthogonal would be faster, but harder to follow/debug, and more code
-                                int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                                if (imin < 0) imin = 0;
-                                if (imax > myDims[0]) imax = myDims[0];
-                                int jmin = j - jrange, jmax = j + jrange + 1;
-                                if (jmin < 0) jmin = 0;
-                                if (jmax > myDims[1]) jmax = myDims[1];
-                                int kmin = k - krange, kmax = k + krange + 1;
-                                if (kmin < 0) kmin = 0;
-                                if (kmax > myDims[2]) kmax = myDims[2];
-                                Vector3D kscratch, jscratch, iscratch;
-                                for (int kkern = kmin; kkern < kmax; ++kkern)
+                                jscratch = kscratch + jvec * (jkern - j);
+                                int64_t jindpart = (kindpart + jkern) * myDims[0];
+                                for (int ikern = imin; ikern < imax; ++ikern)
                                 {
-                                    kscratch = kvec * (kkern - k);
-                                    int64_t kindpart = kkern * myDims[1];
-                                    for (int jkern = jmin; jkern < jmax; ++jkern)
+                                    int64_t thisIndex = jindpart + ikern;//somewhat optimized index computation, could remove some integer multiplies, but there aren't that many
+                                    int curVal = (int)floor(labelFrame[thisIndex] + 0.5f);
+                                    if (curVal == curLabelValue)
                                     {
-                                        jscratch = kscratch + jvec * (jkern - j);
-                                        int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                        for (int ikern = imin; ikern < imax; ++ikern)
-                                        {
-                                            int64_t thisIndex = jindpart + ikern;//somewhat optimized index computation, could remove some integer multiplies, but there aren't that many
-                                            int curVal = (int)floor(labelFrame[thisIndex] + 0.5f);
-                                            if (curVal == curLabelValue)
-                                            {
-                                                iscratch = jscratch + ivec * (ikern - i);
-                                                float tempf = iscratch.length();
-                                                float weight = exp(tempf * tempf * kernelMult);
-                                                sum += weight * inFrame[thisIndex];
-                                                weightsum += weight;
-                                            }
-                                        }
+                                        iscratch = jscratch + ivec * (ikern - i);
+                                        float tempf = iscratch.length();
+                                        float weight = exp(tempf * tempf * kernelMult);
+                                        sum += weight * inFrame[thisIndex];
+                                        weightsum += weight;
                                     }
                                 }
-                                if (weightsum != 0.0f)
-                                {
-                                    outVol->setValue(sum / weightsum, newList[base], newList[base + 1], newList[base + 2], s, c);
-                                }//should already be 0, so don't need to handle the else
                             }
                         }
-                    }
-                }
-            } else {
-                VolumeFile inbox(boxdims, inVol->getSform(), myDims[4]), outbox;
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    for (int64_t base = 0; base < curListSize; base += 3)
-                    {
-                        int myvalue = (int)floor(curLabel->getValue(curList[base], curList[base + 1], curList[base + 2]) + 0.5f);
-                        if (myvalue == matchedLabels[whichList].first)
-                        {//first, only smooth within the ROI of the current label, otherwise we would smooth in some zeros that aren't data
-                            if (c == 0)
-                            {
-                                roibox.setValue(1.0f, curList[base] - extrema[0], curList[base + 1] - extrema[2], curList[base + 2] - extrema[4]);
-                            }
-                            inbox.setValue(inVol->getValue(curList[base], curList[base + 1], curList[base + 2], subvolNum, c),
-                                curList[base] - extrema[0], curList[base + 1] - extrema[2], curList[base + 2] - extrema[4], 0, c);
-                        }
-                    }
-                }
-                AlgorithmVolumeSmoothing(NULL, &inbox, kernel, &outbox, &roibox, false);
-                float kernelMult = -1.0f / kernel / kernel / 2.0f;//precompute the part of the kernel function that doesn't change
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    const float* inFrame = inVol->getFrame(subvolNum, c);
-                    const float* labelFrame = curLabel->getFrame();
-                    for (int64_t base = 0; base < newListSize; base += 3)
-                    {
-                        int myCurVal = (int)floor(curLabel->getValue(newList[base], newList[base + 1], newList[base + 2]) + 0.5f);
-                        if (myCurVal == curLabelValue)
+                        if (weightsum != 0.0f)
                         {
-                            outVol->setValue(outbox.getValue(newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], 0, c),
-                                newList[base], newList[base + 1], newList[base + 2], 0, c);
-                        } else {
-                            float sum = 0.0f, weightsum = 0.0f;//coded in-place for now, its a special restricted case of volume dilate, copied out of nonorth volume smoothing
-                            int i = newList[base], j = newList[base + 1], k = newList[base + 2];//special casing orthogonal would be faster, but harder to follow/debug, and more code
-                            int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                            if (imin < 0) imin = 0;
-                            if (imax > myDims[0]) imax = myDims[0];
-                            int jmin = j - jrange, jmax = j + jrange + 1;
-                            if (jmin < 0) jmin = 0;
-                            if (jmax > myDims[1]) jmax = myDims[1];
-                            int kmin = k - krange, kmax = k + krange + 1;
-                            if (kmin < 0) kmin = 0;
-                            if (kmax > myDims[2]) kmax = myDims[2];
-                            Vector3D kscratch, jscratch, iscratch;
-                            for (int kkern = kmin; kkern < kmax; ++kkern)
-                            {
-                                kscratch = kvec * (kkern - k);
-                                int64_t kindpart = kkern * myDims[1];
-                                for (int jkern = jmin; jkern < jmax; ++jkern)
-                                {
-                                    jscratch = kscratch + jvec * (jkern - j);
-                                    int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                    for (int ikern = imin; ikern < imax; ++ikern)
-                                    {
-                                        int64_t thisIndex = jindpart + ikern;//somewhat optimized index computation, could remove some integer multiplies, but there aren't that many
-                                        int curVal = (int)floor(labelFrame[thisIndex] + 0.5f);
-                                        if (curVal == curLabelValue)
-                                        {
-                                            iscratch = jscratch + ivec * (ikern - i);
-                                            float tempf = iscratch.length();
-                                            float weight = exp(tempf * tempf * kernelMult);
-                                            sum += weight * inFrame[thisIndex];
-                                            weightsum += weight;
-                                        }
-                                    }
-                                }
-                            }
-                            if (weightsum != 0.0f)
-                            {
-                                outVol->setValue(sum / weightsum, newList[base], newList[base + 1], newList[base + 2], 0, c);
-                            }//should already be 0, so don't need to handle the else
-                        }
+                            outFrame[outIndex] = sum / weightsum;
+                        }//block is zeroed, so don't need to handle the else
                     }
                 }
             }
         }
+        for (int64_t frame = 0; frame < blockCount; ++frame)
+        {
+            outVol->setFrame(outBlock.data() + frame * frameSize, (blockStart + frame) % numMaps, (blockStart + frame) / numMaps);
+        }
     }
 }
 
@@ -473,256 +429,161 @@ void AlgorithmVolumeParcelResampling::resampleFixZeros(LevelProgress& myProgress
     }
     vector<int64_t> myDims;
     inVol->getDimensions(myDims);
-    if (subvolNum == -1)
-    {
-        outVol->reinitialize(inVol->getOriginalDimensions(), inVol->getSform(), myDims[4], inVol->getType(), inVol->m_header);
-    } else {
-        vector<int64_t> newDims = inVol->getOriginalDimensions();
-        newDims.resize(3);//discard nonspatial dimentions
-        outVol->reinitialize(newDims, inVol->getSform(), myDims[4], inVol->getType(), inVol->m_header);
-    }
-    outVol->setValueAllVoxels(0.0f);
-    const GiftiLabelTable* curTable = curLabel->getMapLabelTable(0);
+    vector<int64_t> inMaps;
+    setupOutput(inVol, outVol, subvolNum, inMaps);
+    VolumeParcelSmoother mySmoother(inVol->getVolumeSpace(), kernel);
+    vector<ResampleParcel> parcels;
     for (int whichList = 0; whichList < numLabels; ++whichList)
     {
         int curLabelValue = matchedLabels[whichList].first;
         int newLabelValue = matchedLabels[whichList].second;
-        myProgress.reportProgress(((float)whichList) / numLabels);
-        myProgress.setTask("Processing parcel " + curTable->getLabelName(curLabelValue));
+        if (newLabelReverse[newLabelValue] != whichList) continue;//a later label with the same new key overwrites every output voxel of this one
         const vector<int64_t>& thisList = voxelLists[whichList];
         int64_t listSize = (int64_t)thisList.size();
         if (listSize > 2)//NOTE: this should NEVER be something other than a multiple of 3, but check against what we will actually access anyway
         {
-            int extrema[6] = { thisList[0],
-                                thisList[0],
-                                thisList[1],
-                                thisList[1],
-                                thisList[2],
-                                thisList[2] };
-            for (int64_t base = 3; base < listSize; base += 3)
+            ResampleParcel thisParcel;
+            thisParcel.m_curLabelValue = curLabelValue;
+            int64_t* extrema = thisParcel.m_extrema;
+            for (int axis = 0; axis < 3; ++axis)
             {
-                if (thisList[base] < extrema[0]) extrema[0] = thisList[base];
-                if (thisList[base] > extrema[1]) extrema[1] = thisList[base];
-                if (thisList[base + 1] < extrema[2]) extrema[2] = thisList[base + 1];
-                if (thisList[base + 1] > extrema[3]) extrema[3] = thisList[base + 1];
-                if (thisList[base + 2] < extrema[4]) extrema[4] = thisList[base + 2];
-                if (thisList[base + 2] > extrema[5]) extrema[5] = thisList[base + 2];
+                extrema[axis * 2] = thisList[axis];
+                extrema[axis * 2 + 1] = thisList[axis];
             }
-            vector<int64_t> boxdims;
-            boxdims.push_back(extrema[1] - extrema[0] + 1);
-            boxdims.push_back(extrema[3] - extrema[2] + 1);
-            boxdims.push_back(extrema[5] - extrema[4] + 1);
-            VolumeFile roibox(boxdims, inVol->getSform());
-            roibox.setValueAllVoxels(0.0f);
-            vector<int64_t> newList;//make the separate new list, so we don't need to test the label volume
-            for (int64_t base = 0; base < listSize; base += 3)//could do this when we make the merged list...maybe use member variables to cut the argument clutter
+            for (int64_t base = 0; base < listSize; base += 3)//smooth within BOTH labels, but only use input data from the current label
             {
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    if (thisList[base + axis] < extrema[axis * 2]) extrema[axis * 2] = thisList[base + axis];
+                    if (thisList[base + axis] > extrema[axis * 2 + 1]) extrema[axis * 2 + 1] = thisList[base + axis];
+                }
+                int curvalue = (int)floor(curLabel->getValue(thisList[base], thisList[base + 1], thisList[base + 2]) + 0.5f);
                 int newvalue = (int)floor(newLabel->getValue(thisList[base], thisList[base + 1], thisList[base + 2]) + 0.5f);
+                thisParcel.m_useInput.push_back(curvalue == curLabelValue ? 1 : 0);
                 if (newvalue == newLabelValue)
                 {
-                    newList.push_back(thisList[base]);
-                    newList.push_back(thisList[base + 1]);
-                    newList.push_back(thisList[base + 2]);
+                    thisParcel.m_newList.push_back(thisList[base]);
+                    thisParcel.m_newList.push_back(thisList[base + 1]);
+                    thisParcel.m_newList.push_back(thisList[base + 2]);
                 }
             }
-            int64_t newListSize = (int64_t)newList.size();
-            if (subvolNum == -1)
+            int64_t boxDims[2] = { extrema[1] - extrema[0] + 1, extrema[3] - extrema[2] + 1 };
+            for (int64_t base = 0; base < listSize; base += 3)
             {
-                boxdims.push_back(myDims[3]);
-                VolumeFile inbox(boxdims, inVol->getSform(), myDims[4]), outbox;
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    for (int s = 0; s < myDims[3]; ++s)
-                    {
-                        for (int64_t base = 0; base < listSize; base += 3)
-                        {
-                            if (s == 0 && c == 0)//smooth within BOTH labels, but only copy in from current label
-                            {
-                                roibox.setValue(1.0f, thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4]);
-                            }
-                            int curValue = (int)floor(curLabel->getValue(thisList[base], thisList[base + 1], thisList[base + 2]) + 0.5f);
-                            if (curValue == curLabelValue)
-                            {
-                                inbox.setValue(inVol->getValue(thisList[base], thisList[base + 1], thisList[base + 2], s, c),
-                                    thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4], s, c);
-                            } else {
-                                inbox.setValue(0.0f, thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4], s, c);
-                            }
-                        }
-                    }
-                }
-                AlgorithmVolumeSmoothing(NULL, &inbox, kernel, &outbox, &roibox, true);
-                float kernelMult = -1.0f / kernel / kernel / 2.0f;//precompute the part of the kernel function that doesn't change
-                VolumeFile* current = &outbox, *next = &inbox, *tempvol;//reuse inbox as scratch space for iterated dilation
-                const float* labelFrame = newLabel->getFrame();
-                int fixIter;
-                for (fixIter = 0; fixIter < FIX_ZEROS_POST_ITERATIONS; ++fixIter)
-                {
-                    bool again = false;
-                    for (int c = 0; c < myDims[4]; ++c)//since fix zeros smoothing doesn't consider components as multidimensional datatypes, neither should this
-                    {
-                        for (int s = 0; s < myDims[3]; ++s)
-                        {
-                            for (int64_t base = 0; base < newListSize; base += 3)
-                            {
-                                float curVal = current->getValue(newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], s, c);
-                                if (curVal == 0.0f)
-                                {
-                                    float sum = 0.0f, weightsum = 0.0f;//coded in-place for now, its a special restricted case of volume dilate, copied out of nonorth volume smoothing
-                                    int i = newList[base], j = newList[base + 1], k = newList[base + 2];//special casing orthogonal would be faster, but harder to follow/debug, and more code
-                                    int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                                    if (imin < 0) imin = 0;
-                                    if (imax > myDims[0]) imax = myDims[0];
-                                    int jmin = j - jrange, jmax = j + jrange + 1;
-                                    if (jmin < 0) jmin = 0;
-                                    if (jmax > myDims[1]) jmax = myDims[1];
-                                    int kmin = k - krange, kmax = k + krange + 1;
-                                    if (kmin < 0) kmin = 0;
-                                    if (kmax > myDims[2]) kmax = myDims[2];
-                                    Vector3D kscratch, jscratch, iscratch;
-                                    for (int kkern = kmin; kkern < kmax; ++kkern)
-                                    {
-                                        kscratch = kvec * (kkern - k);
-                                        int64_t kindpart = kkern * myDims[1];
-                                        for (int jkern = jmin; jkern < jmax; ++jkern)
-                                        {
-                                            jscratch = kscratch + jvec * (jkern - j);
-                                            int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                            for (int ikern = imin; ikern < imax; ++ikern)
-                                            {
-                                                int64_t thisIndex = jindpart + ikern;//somewhat optimized index computation, could remove some integer multiplies, but there aren't that many
-                                                int tempi = (int)floor(labelFrame[thisIndex] + 0.5f);
-                                                if (tempi == curLabelValue)
-                                                {
-                                                    float dataVal = current->getValue(ikern - extrema[0], jkern - extrema[2], kkern - extrema[4], s, c);
-                                                    if (dataVal != 0.0f)
-                                                    {
-                                                        iscratch = jscratch + ivec * (ikern - i);
-                                                        float tempf = iscratch.length();
-                                                        float weight = exp(tempf * tempf * kernelMult);
-                                                        sum += weight * dataVal;
-                                                        weightsum += weight;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                    }
-                                    if (weightsum != 0.0f)
-                                    {
-                                        next->setValue(sum / weightsum, newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], s, c);
-                                    } else {
-                                        again = true;
-                                        next->setValue(0.0f, newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], s, c);
-                                    }
-                                } else {
-                                    next->setValue(curVal, newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], s, c);
-                                }
-                            }
-                        }
-                    }
-                    tempvol = current;
-                    current = next;
-                    next = tempvol;
-                    if (!again) break;
-                }
-                if (fixIter == FIX_ZEROS_POST_ITERATIONS)
-                {
-                    const GiftiLabelTable* curLabelTable = curLabel->getMapLabelTable(0);
-                    CaretLogWarning("unable to fix all zeros in parcel " + curLabelTable->getLabelName(curLabelValue));
-                }
-                for (int c = 0; c < myDims[4]; ++c)//copy the final result into the output valume
+                thisParcel.m_boxIndices.push_back((thisList[base] - extrema[0]) + boxDims[0] * ((thisList[base + 1] - extrema[2]) + boxDims[1] * (thisList[base + 2] - extrema[4])));
+            }
+            thisParcel.m_smoothParcel = mySmoother.addParcel(thisList);
+            parcels.push_back(thisParcel);
+        }
+    }
+    float kernelMult = -1.0f / kernel / kernel / 2.0f;//precompute the part of the kernel function that doesn't change
+    const float* labelFrame = newLabel->getFrame();
+    int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+    int64_t numMaps = (int64_t)inMaps.size(), numFrames = numMaps * myDims[4];
+    int64_t blockFrames = max((int64_t)1, PARCEL_RESAMPLING_BLOCK_BYTES / (int64_t)(frameSize * sizeof(float)));
+    int numParcels = (int)parcels.size();
+    vector<char> unfixed(numParcels, 0);
+    vector<float> outBlock;
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += blockFrames)
+    {//parallel across parcels and frames, output voxels of different parcels never overlap
+        myProgress.reportProgress(((float)blockStart) / numFrames);
+        int64_t blockCount = min(blockFrames, numFrames - blockStart);
+        outBlock.assign(blockCount * frameSize, 0.0f);
+        int64_t numItems = blockCount * numParcels;
+#pragma omp CARET_PAR
+        {
+            VolumeParcelSmoother::Scratch myScratch;
+            vector<float> smoothedIn, smoothedOut, boxes[2];
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t item = 0; item < numItems; ++item)
+            {
+                int whichParcel = (int)(item / blockCount);
+                const ResampleParcel& thisParcel = parcels[whichParcel];
+                int curLabelValue = thisParcel.m_curLabelValue;
+                const int64_t* extrema = thisParcel.m_extrema;
+                int64_t frame = item % blockCount;
+                const float* inFrame = inVol->getFrame(inMaps[(blockStart + frame) % numMaps], (blockStart + frame) / numMaps);
+                float* outFrame = outBlock.data() + frame * frameSize;
+                const vector<int64_t>& parcelIndices = mySmoother.getParcelFrameIndices(thisParcel.m_smoothParcel);
+                int64_t parcelSize = (int64_t)parcelIndices.size();
+                smoothedIn.resize(parcelSize);
+                smoothedOut.resize(parcelSize);
+                for (int64_t v = 0; v < parcelSize; ++v)
                 {
-                    for (int s = 0; s < myDims[3]; ++s)
-                    {
-                        for (int64_t base = 0; base < newListSize; base += 3)
-                        {
-                            outVol->setValue(current->getValue(newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], s, c),
-                                newList[base], newList[base + 1], newList[base + 2], s, c);
-                        }
-                    }
+                    smoothedIn[v] = (thisParcel.m_useInput[v] != 0 ? inFrame[parcelIndices[v]] : 0.0f);
                 }
-            } else {
-                VolumeFile inbox(boxdims, inVol->getSform(), myDims[4]), outbox;
-                for (int c = 0; c < myDims[4]; ++c)
+                mySmoother.smoothParcel(thisParcel.m_smoothParcel, smoothedIn.data(), smoothedOut.data(), true, myScratch);
+                int64_t boxDims[3] = { extrema[1] - extrema[0] + 1, extrema[3] - extrema[2] + 1, extrema[5] - extrema[4] + 1 };
+                int64_t boxSize = boxDims[0] * boxDims[1] * boxDims[2];
+                boxes[0].assign(boxSize, 0.0f);//smoothed result
+                boxes[1].assign(boxSize, 0.0f);//smoothing input, reused as scratch space for iterated dilation
+                for (int64_t v = 0; v < parcelSize; ++v)
                 {
-                    for (int64_t base = 0; base < listSize; base += 3)
-                    {
-                        if (c == 0)//smooth within BOTH labels, but only copy in from current label
-                        {
-                            roibox.setValue(1.0f, thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4]);
-                        }
-                        int curValue = (int)floor(curLabel->getValue(thisList[base], thisList[base + 1], thisList[base + 2]) + 0.5f);
-                        if (curValue == curLabelValue)
-                        {
-                            inbox.setValue(inVol->getValue(thisList[base], thisList[base + 1], thisList[base + 2], subvolNum, c),
-                                thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4], 0, c);
-                        }
-                    }
+                    boxes[0][thisParcel.m_boxIndices[v]] = smoothedOut[v];
+                    boxes[1][thisParcel.m_boxIndices[v]] = smoothedIn[v];
                 }
-                AlgorithmVolumeSmoothing(NULL, &inbox, kernel, &outbox, &roibox, true);
-                float kernelMult = -1.0f / kernel / kernel / 2.0f;//precompute the part of the kernel function that doesn't change
+                const vector<int64_t>& newList = thisParcel.m_newList;
+                int64_t newListSize = (int64_t)newList.size();
+                float* current = boxes[0].data(), *next = boxes[1].data(), *tempvol;
                 int fixIter;
-                VolumeFile* current = &outbox, *next = &inbox, *tempvol;//reuse inbox as scratch space for iterated dilation
-                const float* labelFrame = newLabel->getFrame();
                 for (fixIter = 0; fixIter < FIX_ZEROS_POST_ITERATIONS; ++fixIter)
                 {
                     bool again = false;
-                    for (int c = 0; c < myDims[4]; ++c)//since fix zeros smoothing doesn't consider components as multidimensional datatypes, neither should this
+                    for (int64_t base = 0; base < newListSize; base += 3)
                     {
-                        for (int64_t base = 0; base < newListSize; base += 3)
+                        int64_t boxIndex = (newList[base] - extrema[0]) + boxDims[0] * ((newList[base + 1] - extrema[2]) + boxDims[1] * (newList[base + 2] - extrema[4]));
+                        float curVal = current[boxIndex];
+                        if (curVal == 0.0f)
                         {
-                            float curVal = current->getValue(newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], 0, c);
-                            if (curVal == 0.0f)
+                            float sum = 0.0f, weightsum = 0.0f;//coded in-place for now, its a special restricted case of volume dilate, copied out of nonorth volume smoothing
+                            int i = newList[base], j = newList[base + 1], k = newList[base + 2];//special casing orthogonal would be faster, but harder to follow/debug, and more code
+                            int imin = i - irange, imax = i + irange + 1;//one-after array size convention
+                            if (imin < 0) imin = 0;
+                            if (imax > myDims[0]) imax = myDims[0];
+                            int jmin = j - jrange, jmax = j + jrange + 1;
+                            if (jmin < 0) jmin = 0;
+                            if (jmax > myDims[1]) jmax = myDims[1];
+                            int kmin = k - krange, kmax = k + krange + 1;
+                            if (kmin < 0) kmin = 0;
+                            if (kmax > myDims[2]) kmax = myDims[2];
+                            Vector3D kscratch, jscratch, iscratch;
+                            for (int kkern = kmin; kkern < kmax; ++kkern)
                             {
-                                float sum = 0.0f, weightsum = 0.0f;//coded in-place for now, its a special restricted case of volume dilate, copied out of nonorth volume smoothing
-                                int i = newList[base], j = newList[base + 1], k = newList[base + 2];//special casing orthogonal would be faster, but harder to follow/debug, and more code
-                                int imin = i - irange, imax = i + irange + 1;//one-after array size convention
-                                if (imin < 0) imin = 0;
-                                if (imax > myDims[0]) imax = myDims[0];
-                                int jmin = j - jrange, jmax = j + jrange + 1;
-                                if (jmin < 0) jmin = 0;
-                                if (jmax > myDims[1]) jmax = myDims[1];
-                                int kmin = k - krange, kmax = k + krange + 1;
-                                if (kmin < 0) kmin = 0;
-                                if (kmax > myDims[2]) kmax = myDims[2];
-                                Vector3D kscratch, jscratch, iscratch;
-                                for (int kkern = kmin; kkern < kmax; ++kkern)
+                                kscratch = kvec * (kkern - k);
+                                int64_t kindpart = kkern * myDims[1];
+                                for (int jkern = jmin; jkern < jmax; ++jkern)
                                 {
-                                    kscratch = kvec * (kkern - k);
-                                    int64_t kindpart = kkern * myDims[1];
-                                    for (int jkern = jmin; jkern < jmax; ++jkern)
+                                    jscratch = kscratch + jvec * (jkern - j);
+                                    int64_t jindpart = (kindpart + jkern) * myDims[0];
+                                    for (int ikern = imin; ikern < imax; ++ikern)
                                     {
-                                        jscratch = kscratch + jvec * (jkern - j);
-                                        int64_t jindpart = (kindpart + jkern) * myDims[0];
-                                        for (int ikern = imin; ikern < imax; ++ikern)
-                                        {
-                                            int64_t thisIndex = jindpart + ikern;//somewhat optimized index computation, could remove some integer multiplies, but there aren't that many
-                                            int tempi = (int)floor(labelFrame[thisIndex] + 0.5f);
-                                            if (tempi == curLabelValue)
+                                        int64_t thisIndex = jindpart + ikern;//somewhat optimized index computation, could remove some integer multiplies, but there aren't that many
+                                        int tempi = (int)floor(labelFrame[thisIndex] + 0.5f);
+                                        if (tempi == curLabelValue && ikern >= extrema[0] && ikern <= extrema[1] &&
+                                            jkern >= extrema[2] && jkern <= extrema[3] && kkern >= extrema[4] && kkern <= extrema[5])
+                                        {//nothing outside the box has data
+                                            float dataVal = current[(ikern - extrema[0]) + boxDims[0] * ((jkern - extrema[2]) + boxDims[1] * (kkern - extrema[4]))];
+                                            if (dataVal != 0.0f)
                                             {
-                                                float dataVal = current->getValue(ikern - extrema[0], jkern - extrema[2], kkern - extrema[4], 0, c);
-                                                if (dataVal != 0.0f)
-                                                {
-                                                    iscratch = jscratch + ivec * (ikern - i);
-                                                    float tempf = iscratch.length();
-                                                    float weight = exp(tempf * tempf * kernelMult);
-                                                    sum += weight * dataVal;
-                                                    weightsum += weight;
-                                                }
+                                                iscratch = jscratch + ivec * (ikern - i);
+                                                float tempf = iscratch.length();
+                                                float weight = exp(tempf * tempf * kernelMult);
+                                                sum += weight * dataVal;
+                                                weightsum += weight;
                                             }
                                         }
                                     }
                                 }
-                                if (weightsum != 0.0f)
-                                {
-                                    next->setValue(sum / weightsum, newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], 0, c);
-                                } else {
-                                    again = true;
-                                    next->setValue(0.0f, newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], 0, c);
-                                }
+                            }
+                            if (weightsum != 0.0f)
+                            {
+                                next[boxIndex] = sum / weightsum;
                             } else {
-                                next->setValue(curVal, newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], 0, c);
+                                again = true;
+                                next[boxIndex] = 0.0f;
                             }
+                        } else {
+                            next[boxIndex] = curVal;
                         }
                     }
                     tempvol = current;
@@ -732,19 +593,30 @@ void AlgorithmVolumeParcelResampling::resampleFixZeros(LevelProgress& myProgress
                 }
                 if (fixIter == FIX_ZEROS_POST_ITERATIONS)
                 {
-                    const GiftiLabelTable* curLabelTable = curLabel->getMapLabelTable(0);
-                    CaretLogWarning("unable to fix all zeros in parcel " + curLabelTable->getLabelName(curLabelValue));
-                }
-                for (int c = 0; c < myDims[4]; ++c)//copy the final result into the output valume
-                {
-                    for (int64_t base = 0; base < newListSize; base += 3)
+#pragma omp critical
                     {
-                        outVol->setValue(current->getValue(newList[base] - extrema[0], newList[base + 1] - extrema[2], newList[base + 2] - extrema[4], 0, c),
-                            newList[base], newList[base + 1], newList[base + 2], 0, c);
+                        unfixed[whichParcel] = 1;//warn after the loop, once per parcel
                     }
                 }
+                for (int64_t base = 0; base < newListSize; base += 3)
+                {
+                    outFrame[newList[base] + myDims[0] * (newList[base + 1] + myDims[1] * newList[base + 2])] =
+                        current[(newList[base] - extrema[0]) + boxDims[0] * ((newList[base + 1] - extrema[2]) + boxDims[1] * (newList[base + 2] - extrema[4]))];
+                }
             }
         }
+        for (int64_t frame = 0; frame < blockCount; ++frame)
+        {
+            outVol->setFrame(outBlock.data() + frame * frameSize, (blockStart + frame) % numMaps, (blockStart + frame) / numMaps);
+        }
+    }
+    const GiftiLabelTable* curLabelTable = curLabel->getMapLabelTable(0);
+    for (int whichParcel = 0; whichParcel < numParcels; ++whichParcel)
+    {
+        if (unfixed[whichParcel] != 0)
+        {
+            CaretLogWarning("unable to fix all zeros in parcel " + curLabelTable->getLabelName(parcels[whichParcel].m_curLabelValue));
+        }
     }
 }
 
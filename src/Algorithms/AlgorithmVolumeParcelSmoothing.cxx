@@ -21,13 +21,20 @@
 #include "AlgorithmVolumeParcelSmoothing.h"
 #include "AlgorithmException.h"
 #include "VolumeFile.h"
-#include "AlgorithmVolumeSmoothing.h"
+#include "CaretOMP.h"
+#include "VolumeParcelSmoother.h"
+#include <algorithm>
 #include <map>
 #include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t PARCEL_SMOOTHING_BLOCK_BYTES = 64 * (int64_t)(1 << 20);//output frames are smoothed and written in blocks of about this size
+}
+
 AString AlgorithmVolumeParcelSmoothing::getCommandSwitch()
 {
     return "-volume-parcel-smoothing";
@@ -117,7 +124,11 @@ AlgorithmVolumeParcelSmoothing::AlgorithmVolumeParcelSmoothing(ProgressObject* m
     {
         throw AlgorithmException("invalid subvolume specified");
     }
-    vector<vector<int> > voxelLists;//build all lists in a single pass, allows some short circuits and less conversion to label integers
+    if (myKernel <= 0.0f)
+    {
+        throw AlgorithmException("kernel too small");
+    }
+    vector<vector<int64_t> > voxelLists;//build all lists in a single pass, allows some short circuits and less conversion to label integers
     voxelLists.resize(numLabels);
     for (int k = 0; k < myDims[2]; ++k)
     {
@@ -138,122 +149,61 @@ AlgorithmVolumeParcelSmoothing::AlgorithmVolumeParcelSmoothing(ProgressObject* m
             }
         }
     }
-    if (subvolNum == -1)
+    VolumeParcelSmoother mySmoother(myVol->getVolumeSpace(), myKernel);//builds each parcel's box and pass lists once, for all frames
+    for (int whichList = 0; whichList < numLabels; ++whichList)
     {
-        myOutVol->reinitialize(myVol->getOriginalDimensions(), myVol->getSform(), myDims[4], myVol->getType(), myVol->m_header);
-        myOutVol->setValueAllVoxels(0.0f);
-        for (int whichList = 0; whichList < numLabels; ++whichList)
+        if (voxelLists[whichList].size() > 2)
         {
-            const vector<int>& thisList = voxelLists[whichList];
-            int64_t listSize = (int64_t)thisList.size();
-            if (listSize > 2)//NOTE: this should NEVER be something other than a multiple of 3, but check against what we will actually access anyway
-            {
-                int extrema[6] = { thisList[0],
-                                    thisList[0],
-                                    thisList[1],
-                                    thisList[1],
-                                    thisList[2],
-                                    thisList[2] };
-                for (int64_t base = 3; base < listSize; base += 3)
-                {
-                    if (thisList[base] < extrema[0]) extrema[0] = thisList[base];
-                    if (thisList[base] > extrema[1]) extrema[1] = thisList[base];
-                    if (thisList[base + 1] < extrema[2]) extrema[2] = thisList[base + 1];
-                    if (thisList[base + 1] > extrema[3]) extrema[3] = thisList[base + 1];
-                    if (thisList[base + 2] < extrema[4]) extrema[4] = thisList[base + 2];
-                    if (thisList[base + 2] > extrema[5]) extrema[5] = thisList[base + 2];
-                }
-                vector<int64_t> boxdims;
-                boxdims.push_back(extrema[1] - extrema[0] + 1);
-                boxdims.push_back(extrema[3] - extrema[2] + 1);
-                boxdims.push_back(extrema[5] - extrema[4] + 1);
-                VolumeFile roibox(boxdims, myVol->getSform());
-                boxdims.push_back(myDims[3]);
-                VolumeFile inbox(boxdims, myVol->getSform(), myDims[4]), outbox;
-                roibox.setValueAllVoxels(0.0f);
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    for (int s = 0; s < myDims[3]; ++s)
-                    {
-                        for (int64_t base = 0; base < listSize; base += 3)
-                        {
-                            if (s == 0 && c == 0) roibox.setValue(1.0f, thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4]);
-                            inbox.setValue(myVol->getValue(thisList[base], thisList[base + 1], thisList[base + 2], s, c),
-                                thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4], s, c);
-                        }
-                    }
-                }
-                AlgorithmVolumeSmoothing(NULL, &inbox, myKernel, &outbox, &roibox, fixZeros);
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    for (int s = 0; s < myDims[3]; ++s)
-                    {
-                        for (int64_t base = 0; base < listSize; base += 3)
-                        {
-                            myOutVol->setValue(outbox.getValue(thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4], s, c),
-                                            thisList[base], thisList[base + 1], thisList[base + 2], s, c);
-                        }
-                    }
-                }
-            }
+            mySmoother.addParcel(voxelLists[whichList]);
         }
+        voxelLists[whichList].clear();
+    }
+    int numParcels = mySmoother.getNumberOfParcels();
+    vector<int64_t> inMaps;//output map s uses input map inMaps[s]
+    if (subvolNum == -1)
+    {
+        myOutVol->reinitialize(myVol->getOriginalDimensions(), myVol->getSform(), myDims[4], myVol->getType(), myVol->m_header);
         for (int s = 0; s < myDims[3]; ++s)
         {
-            myOutVol->setMapName(s, myVol->getMapName(s) + ", parcel smoothed " + AString::number(myKernel));
+            inMaps.push_back(s);
         }
     } else {
         vector<int64_t> newDims = myVol->getOriginalDimensions();
         newDims.resize(3);//discard non-spatial extra dimensions
         myOutVol->reinitialize(newDims, myVol->getSform(), myDims[4], myVol->getType(), myVol->m_header);//keep components
-        myOutVol->setValueAllVoxels(0.0f);
-        for (int whichList = 0; whichList < numLabels; ++whichList)
+        inMaps.push_back(subvolNum);
+    }
+    for (int s = 0; s < (int)inMaps.size(); ++s)
+    {
+        myOutVol->setMapName(s, myVol->getMapName(inMaps[s]) + ", parcel smoothed " + AString::number(myKernel));
+    }
+    int64_t frameSize = myDims[0] * myDims[1] * myDims[2];
+    int64_t numFrames = (int64_t)inMaps.size() * myDims[4];//frame f is component f / maps, output map f % maps
+    int64_t blockFrames = max((int64_t)1, PARCEL_SMOOTHING_BLOCK_BYTES / (int64_t)(frameSize * sizeof(float)));
+    vector<float> outBlock;
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += blockFrames)
+    {//stream the output in blocks of frames, parallel across both parcels and frames within a block
+        myProgress.reportProgress(((float)blockStart) / numFrames);
+        int64_t blockCount = min(blockFrames, numFrames - blockStart);
+        outBlock.assign(blockCount * frameSize, 0.0f);
+        int64_t numItems = blockCount * numParcels;
+#pragma omp CARET_PAR
         {
-            const vector<int>& thisList = voxelLists[whichList];
-            int64_t listSize = (int64_t)thisList.size();
-            if (listSize > 2)//NOTE: this should NEVER be something other than a multiple of 3, but check against what we will actually access anyway
+            VolumeParcelSmoother::Scratch myScratch;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t item = 0; item < numItems; ++item)
             {
-                int extrema[6] = { thisList[0],
-                                    thisList[0],
-                                    thisList[1],
-                                    thisList[1],
-                                    thisList[2],
-                                    thisList[2] };
-                for (int64_t base = 3; base < listSize; base += 3)
-                {
-                    if (thisList[base] < extrema[0]) extrema[0] = thisList[base];
-                    if (thisList[base] > extrema[1]) extrema[1] = thisList[base];
-                    if (thisList[base + 1] < extrema[2]) extrema[2] = thisList[base + 1];
-                    if (thisList[base + 1] > extrema[3]) extrema[3] = thisList[base + 1];
-                    if (thisList[base + 2] < extrema[4]) extrema[4] = thisList[base + 2];
-                    if (thisList[base + 2] > extrema[5]) extrema[5] = thisList[base + 2];
-                }
-                vector<int64_t> boxdims;
-                boxdims.push_back(extrema[1] - extrema[0] + 1);
-                boxdims.push_back(extrema[3] - extrema[2] + 1);
-                boxdims.push_back(extrema[5] - extrema[4] + 1);
-                VolumeFile inbox(boxdims, myVol->getSform(), myDims[4]), roibox(boxdims, myVol->getSform()), outbox;
-                roibox.setValueAllVoxels(0.0f);
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    for (int64_t base = 0; base < listSize; base += 3)
-                    {
-                        if (c == 0) roibox.setValue(1.0f, thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4]);
-                        inbox.setValue(myVol->getValue(thisList[base], thisList[base + 1], thisList[base + 2], subvolNum, c),
-                            thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4], 0, c);
-                    }
-                }
-                AlgorithmVolumeSmoothing(NULL, &inbox, myKernel, &outbox, &roibox, fixZeros);
-                for (int c = 0; c < myDims[4]; ++c)
-                {
-                    for (int64_t base = 0; base < listSize; base += 3)
-                    {
-                        myOutVol->setValue(outbox.getValue(thisList[base] - extrema[0], thisList[base + 1] - extrema[2], thisList[base + 2] - extrema[4], 0, c),
-                                        thisList[base], thisList[base + 1], thisList[base + 2], 0, c);
-                    }
-                }
+                int parcel = (int)(item / blockCount);
+                int64_t frame = item % blockCount;
+                int64_t s = (blockStart + frame) % (int64_t)inMaps.size(), c = (blockStart + frame) / (int64_t)inMaps.size();
+                mySmoother.smoothParcelFrame(parcel, myVol->getFrame(inMaps[s], c), outBlock.data() + frame * frameSize, fixZeros, myScratch);
             }
         }
-        myOutVol->setMapName(0, myVol->getMapName(subvolNum) + ", parcel smoothed " + AString::number(myKernel));
+        for (int64_t frame = 0; frame < blockCount; ++frame)
+        {
+            int64_t s = (blockStart + frame) % (int64_t)inMaps.size(), c = (blockStart + frame) / (int64_t)inMaps.size();
+            myOutVol->setFrame(outBlock.data() + frame * frameSize, s, c);
+        }
     }
 }
 
@@ -25,9 +25,14 @@
 #include "AffineSeriesFile.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "NiftiIO.h"
+#include "VolumeSpline.h"
 #include "WarpfieldFile.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace caret;
 using namespace std;
 
@@ -194,6 +199,44 @@ AlgorithmVolumeResample::AlgorithmVolumeResample(ProgressObject* myProgObj, cons
     {
         outVol->setMapName(i, inVol->getMapName(i));
     }
+    if (!myStack.isFrameDependent())
+    {//the source coordinates are the same for every frame, so compute them and the interpolation stencil once, and stream the frames through it
+        VolumeResampleStencil myStencil(inVol->getVolumeSpace(), myStack, refSpace, myMethod);
+        int64_t numFrames = numMaps * numComponents, batchSize = 1;
+#ifdef CARET_OMP
+        if (myStencil.getMethod() == VolumeFile::CUBIC)
+        {
+            batchSize = omp_get_max_threads();//prefilter one frame per thread, instead of one frame at a time
+        }
+#endif
+        batchSize = min(batchSize, numFrames);
+        vector<vector<float> > outFrames(batchSize, vector<float>(scratchFrame.size()));
+        for (int64_t batchStart = 0; batchStart < numFrames; batchStart += batchSize)
+        {
+            int64_t batchEnd = min(batchStart + batchSize, numFrames);
+            vector<const float*> framesIn;
+            vector<float*> framesOut;
+            vector<float> outsideValues;
+            for (int64_t f = batchStart; f < batchEnd; ++f)
+            {
+                int64_t b = f % numMaps, c = f / numMaps;
+                framesIn.push_back(inVol->getFrame(b, c));
+                framesOut.push_back(outFrames[f - batchStart].data());
+                if (inVol->getType() == SubvolumeAttributes::LABEL)
+                {
+                    outsideValues.push_back(inVol->getMapLabelTable(b)->getUnassignedLabelKey());
+                } else {
+                    outsideValues.push_back(VolumeFile::INVALID_INTERP_VALUE);
+                }
+            }
+            myStencil.resampleFrames(framesIn, framesOut, outsideValues);
+            for (int64_t f = batchStart; f < batchEnd; ++f)
+            {
+                outVol->setFrame(framesOut[f - batchStart], f % numMaps, f / numMaps);
+            }
+        }
+        return;
+    }
     for (int64_t c = 0; c < numComponents; ++c)
     {
         for (int64_t b = 0; b < numMaps; ++b)
@@ -312,6 +355,15 @@ Vector3D WarpfieldXfm::xfmPoint(const Vector3D& coordIn, const int64_t /*frame*/
     return offset + coordIn;
 }
 
+bool XfmStack::isFrameDependent() const
+{
+    for (auto& xfm : m_xfmStack)
+    {
+        if (xfm->isFrameDependent()) return true;
+    }
+    return false;
+}
+
 void XfmStack::push_back(CaretPointer<const XfmBase> nextXfm)
 {
     m_xfmStack.push_back(nextXfm);
@@ -332,3 +384,173 @@ Vector3D XfmStack::xfmPoint(const Vector3D& coordIn, const int64_t frame, bool*
     if (validCoord != NULL) *validCoord = thisValid;
     return ret;
 }
+
+//VolumeResampleStencil details
+namespace
+{
+    const int64_t STENCIL_INVALID_XFM = -1, STENCIL_OUTSIDE = -2;
+    
+    bool interpIndexValid(const float index[3], const int64_t dims[3])
+    {//same rounding tolerance as VolumeFile::interpolateValue
+        for (int i = 0; i < 3; ++i)
+        {
+            int64_t low = floor(index[i] + 0.01f), high = ceil(index[i] - 0.01f);
+            if (low < 0 || low >= dims[i] || high < 0 || high >= dims[i]) return false;
+        }
+        return true;
+    }
+}
+
+VolumeResampleStencil::VolumeResampleStencil(const VolumeSpace& inSpace, const XfmBase& xfm, const VolumeSpace& outSpace, const VolumeFile::InterpType& method)
+{
+    CaretAssert(!xfm.isFrameDependent());
+    const int64_t* inDims = inSpace.getDims();
+    const int64_t* outDims = outSpace.getDims();
+    for (int i = 0; i < 3; ++i)
+    {
+        m_inDims[i] = inDims[i];
+    }
+    m_method = method;
+    if (m_inDims[0] == 1 || m_inDims[1] == 1 || m_inDims[2] == 1)
+    {
+        m_method = VolumeFile::ENCLOSING_VOXEL;//as VolumeFile does, because the others need neighboring slices
+    }
+    m_numOutVoxels = outDims[0] * outDims[1] * outDims[2];
+    m_index.resize(m_numOutVoxels);
+    if (m_method != VolumeFile::ENCLOSING_VOXEL)
+    {
+        m_params.resize(m_numOutVoxels * 3);
+    }
+    const int64_t inStride[3] = { 1, m_inDims[0], m_inDims[0] * m_inDims[1] };
+#pragma omp CARET_PARFOR schedule(guided, 10)
+    for (int64_t k = 0; k < outDims[2]; ++k)
+    {
+        for (int64_t j = 0; j < outDims[1]; ++j)
+        {
+            for (int64_t i = 0; i < outDims[0]; ++i)
+            {
+                int64_t outIndex = i + outDims[0] * (j + outDims[1] * k);
+                Vector3D outCoord;
+                outSpace.indexToSpace(i, j, k, outCoord);
+                bool validCoord = false;
+                Vector3D inCoord = xfm.xfmPoint(outCoord, 0, &validCoord);
+                if (!validCoord)
+                {
+                    m_index[outIndex] = STENCIL_INVALID_XFM;
+                    continue;
+                }
+                switch (m_method)
+                {
+                    case VolumeFile::ENCLOSING_VOXEL:
+                    {
+                        int64_t inIJK[3];
+                        inSpace.enclosingVoxel(inCoord, inIJK);
+                        if (inSpace.indexValid(inIJK))
+                        {
+                            m_index[outIndex] = inIJK[0] + inStride[1] * inIJK[1] + inStride[2] * inIJK[2];
+                        } else {
+                            m_index[outIndex] = STENCIL_OUTSIDE;
+                        }
+                        break;
+                    }
+                    case VolumeFile::TRILINEAR:
+                    {
+                        float inIndex[3];
+                        inSpace.spaceToIndex(inCoord, inIndex);
+                        if (!interpIndexValid(inIndex, m_inDims))
+                        {
+                            m_index[outIndex] = STENCIL_OUTSIDE;
+                            break;
+                        }
+                        m_index[outIndex] = 0;
+                        for (int axis = 0; axis < 3; ++axis)
+                        {
+                            int64_t low = min(max(int64_t(floor(inIndex[axis])), int64_t(0)), m_inDims[axis] - 2);
+                            m_index[outIndex] += low * inStride[axis];
+                            m_params[outIndex * 3 + axis] = inIndex[axis] - low;
+                        }
+                        break;
+                    }
+                    case VolumeFile::CUBIC:
+                    {
+                        float inIndex[3];
+                        inSpace.spaceToIndex(inCoord, inIndex);
+                        if (!interpIndexValid(inIndex, m_inDims))
+                        {
+                            m_index[outIndex] = STENCIL_OUTSIDE;
+                            break;
+                        }
+                        m_index[outIndex] = 0;
+                        for (int axis = 0; axis < 3; ++axis)
+                        {
+                            m_params[outIndex * 3 + axis] = inIndex[axis];
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void VolumeResampleStencil::resampleFrames(const vector<const float*>& framesIn, const vector<float*>& framesOut, const vector<float>& outsideValues) const
+{
+    CaretAssert(framesIn.size() == framesOut.size() && framesIn.size() == outsideValues.size());
+    int64_t numFrames = (int64_t)framesIn.size();
+    vector<VolumeSpline> splines;
+    if (m_method == VolumeFile::CUBIC)
+    {
+        splines.resize(numFrames);
+        vector<char> ignoredNonNumeric(numFrames, 0);
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t f = 0; f < numFrames; ++f)
+        {
+            splines[f] = VolumeSpline(framesIn[f], m_inDims);
+            ignoredNonNumeric[f] = splines[f].ignoredNonNumeric();
+        }
+        for (int64_t f = 0; f < numFrames; ++f)
+        {
+            if (ignoredNonNumeric[f]) CaretLogWarning("ignored non-numeric input value when calculating cubic splines");
+        }
+    }
+    const int64_t yStride = m_inDims[0], zStride = m_inDims[0] * m_inDims[1];
+    for (int64_t f = 0; f < numFrames; ++f)
+    {
+        const float* frameIn = framesIn[f];
+        float* frameOut = framesOut[f];
+        const float outsideValue = outsideValues[f];
+#pragma omp CARET_PARFOR schedule(guided, 1000)
+        for (int64_t v = 0; v < m_numOutVoxels; ++v)
+        {
+            int64_t base = m_index[v];
+            if (base < 0)
+            {
+                frameOut[v] = (base == STENCIL_INVALID_XFM ? VolumeFile::INVALID_INTERP_VALUE : outsideValue);
+                continue;
+            }
+            switch (m_method)
+            {
+                case VolumeFile::ENCLOSING_VOXEL:
+                    frameOut[v] = frameIn[base];
+                    break;
+                case VolumeFile::TRILINEAR:
+                {//same operation order as VolumeFile::interpolateValue
+                    const float* corner = frameIn + base;
+                    float xhighWeight = m_params[v * 3], yhighWeight = m_params[v * 3 + 1], zhighWeight = m_params[v * 3 + 2];
+                    float xlowWeight = 1.0f - xhighWeight, ylowWeight = 1.0f - yhighWeight, zlowWeight = 1.0f - zhighWeight;
+                    float x00 = xlowWeight * corner[0] + xhighWeight * corner[1];
+                    float x10 = xlowWeight * corner[yStride] + xhighWeight * corner[yStride + 1];
+                    float x01 = xlowWeight * corner[zStride] + xhighWeight * corner[zStride + 1];
+                    float x11 = xlowWeight * corner[zStride + yStride] + xhighWeight * corner[zStride + yStride + 1];
+                    float y0 = ylowWeight * x00 + yhighWeight * x10;
+                    float y1 = ylowWeight * x01 + yhighWeight * x11;
+                    frameOut[v] = zlowWeight * y0 + zhighWeight * y1;
+                    break;
+                }
+                case VolumeFile::CUBIC:
+                    frameOut[v] = splines[f].sample(m_params.data() + v * 3);
+                    break;
+            }
+        }
+    }
+}
@@ -52,6 +52,7 @@ namespace caret {
     struct XfmBase
     {
         virtual Vector3D xfmPoint(const Vector3D& coordIn, const int64_t frame, bool* validCoord = NULL) const = 0;
+        virtual bool isFrameDependent() const { return false; }//if false, the frame argument is ignored, so coordinates can be computed once for all frames
         virtual ~XfmBase() {};
     };
 
@@ -69,6 +70,7 @@ namespace caret {
     public:
         AffineSeriesXfm(const std::vector<FloatMatrix>& xfmList);
         Vector3D xfmPoint(const Vector3D& coordIn, const int64_t frame, bool* validCoord = NULL) const;
+        bool isFrameDependent() const { return true; }
     };
 
     class WarpfieldXfm : public XfmBase
@@ -84,8 +86,24 @@ namespace caret {
         std::vector<CaretPointer<const XfmBase> > m_xfmStack;
     public:
         Vector3D xfmPoint(const Vector3D& coordIn, const int64_t frame, bool* validCoord = NULL) const;
+        bool isFrameDependent() const;
         void push_back(CaretPointer<const XfmBase> nextXfm);
     };
+    
+    //the source location and interpolation weights of every output voxel, computed once, for resampling any number of frames through a frame-independent transform
+    //frames are passed by pointer, so callers can read and write them in whatever batches they like
+    class VolumeResampleStencil
+    {
+        VolumeFile::InterpType m_method;
+        int64_t m_inDims[3], m_numOutVoxels;
+        std::vector<int64_t> m_index;//enclosing voxel, or low corner for trilinear, negative when outside the input or the transform is invalid
+        std::vector<float> m_params;//3 per voxel: high-side weights for trilinear, index-space coordinate for cubic
+    public:
+        VolumeResampleStencil(const VolumeSpace& inSpace, const XfmBase& xfm, const VolumeSpace& outSpace, const VolumeFile::InterpType& method);
+        ///cubic splines are built in parallel across the frames, outsideValues gives the value for voxels outside the input, per frame
+        void resampleFrames(const std::vector<const float*>& framesIn, const std::vector<float*>& framesOut, const std::vector<float>& outsideValues) const;
+        const VolumeFile::InterpType& getMethod() const { return m_method; }
+    };
 
 }
 
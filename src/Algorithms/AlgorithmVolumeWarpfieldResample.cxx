@@ -21,10 +21,8 @@
 #include "AlgorithmVolumeWarpfieldResample.h"
 #include "AlgorithmException.h"
 
-#include "CaretLogger.h"
-#include "CaretOMP.h"
+#include "AlgorithmVolumeResample.h"
 #include "NiftiIO.h"
-#include "Vector3D.h"
 #include "WarpfieldFile.h"
 
 using namespace caret;
@@ -105,68 +103,9 @@ AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObjec
     vector<int64_t> warpDims;
     warpfield->getDimensions(warpDims);
     if (warpDims[3] != 3 || warpDims[4] != 1) throw AlgorithmException("provided warpfield volume has wrong number of subvolumes or components");
-    vector<int64_t> outDims = inVol->getOriginalDimensions();
-    if (outDims.size() < 3) throw AlgorithmException("input must have 3 spatial dimensions");
-    outDims[0] = refDims[0];
-    outDims[1] = refDims[1];
-    outDims[2] = refDims[2];
-    int64_t numMaps = inVol->getNumberOfMaps(), numComponents = inVol->getNumberOfComponents();
-    outVol->reinitialize(outDims, refSform, numComponents, inVol->getType(), inVol->m_header);
-    vector<float> scratchFrame(outDims[0] * outDims[1] * outDims[2], 0.0f);
-    if (inVol->isMappedWithLabelTable())
-    {
-        if (myMethod != VolumeFile::ENCLOSING_VOXEL)
-        {
-            CaretLogWarning("using interpolation type other than ENCLOSING_VOXEL on a label volume");
-        }
-        for (int64_t i = 0; i < numMaps; ++i)
-        {
-            *(outVol->getMapLabelTable(i)) = *(inVol->getMapLabelTable(i));
-        }
-    }
-    for (int64_t i = 0; i < numMaps; ++i)
-    {
-        outVol->setMapName(i, inVol->getMapName(i));
-    }
-    for (int64_t c = 0; c < numComponents; ++c)
-    {
-        for (int64_t b = 0; b < numMaps; ++b)
-        {
-            if (myMethod == VolumeFile::CUBIC)
-            {
-                inVol->validateSpline(b, c);//because deconvolve is parallel, but won't execute parallel if we are already in a parallel section
-            }
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t k = 0; k < outDims[2]; ++k)
-            {
-                for (int64_t j = 0; j < outDims[1]; ++j)
-                {
-                    for (int64_t i = 0; i < outDims[0]; ++i)
-                    {
-                        Vector3D outCoord, inCoord, displacement;
-                        outVol->indexToSpace(i, j, k, outCoord);
-                        bool validDisplacement = false;
-                        displacement[0] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, &validDisplacement, 0);
-                        if (validDisplacement)
-                        {
-                            displacement[1] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 1);
-                            displacement[2] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 2);
-                            inCoord = outCoord + displacement;
-                            float interpVal = inVol->interpolateValue(inCoord, myMethod, NULL, b, c);
-                            scratchFrame[outVol->getIndex(i, j, k)] = interpVal;
-                        } else {
-                            scratchFrame[outVol->getIndex(i, j, k)] = VolumeFile::INVALID_INTERP_VALUE;
-                        }
-                    }
-                }
-            }
-            outVol->setFrame(scratchFrame.data(), b, c);
-            if (myMethod == VolumeFile::CUBIC)
-            {
-                inVol->freeSpline(b, c);//release memory we no longer need, if we allocated it
-            }
-        }
-    }
+    XfmStack myStack;//use the precomputed stencil engine, the warpfield convention is already target to source
+    myStack.push_back(CaretPointer<XfmBase>(new WarpfieldXfm(warpfield)));
+    AlgorithmVolumeResample(NULL, inVol, myStack, VolumeSpace(refDims, refSform), myMethod, outVol);
 }
 
 float AlgorithmVolumeWarpfieldResample::getAlgorithmInternalWeight()
@@ -768,9 +768,11 @@ Brain::resetBrainKeepSceneFiles()
         }
         else {
             /*
-             * If a palette is modified by user or by showing a previous scene,
-             * then the file MUST be reloaded because the palette may be different
-             * in the new scene that is being loaded.
+             * If a palette is modified by user, then the file MUST be reloaded
+             * because the palette may be different in the new scene that is
+             * being loaded.  Palettes modified by showing a previous scene are
+             * put back to the palettes read from the file, and if that is not
+             * possible, the file is reloaded.
              */
             CaretMappableDataFile* cmdf = dynamic_cast<CaretMappableDataFile*>(caretDataFile);
             if (cmdf != NULL) {
@@ -779,7 +781,12 @@ Brain::resetBrainKeepSceneFiles()
                         continue;
                         break;
                     case PaletteModifiedStatusEnum::MODIFIED_BY_SHOW_SCENE:
-                        continue;
+                        if (caretDataFile->isModifiedSinceTimeOfLastReadOrWrite()) {
+                            continue;
+                        }
+                        if ( ! cmdf->revertPaletteColorMappingModifiedByShowScene()) {
+                            continue;
+                        }
                         break;
                     case PaletteModifiedStatusEnum::UNMODIFIED:
                         break;
@@ -24,6 +24,7 @@
 #undef __BRAIN_OPEN_G_L_CHART_TWO_DRAWING_FIXED_PIPELINE_DECLARE__
 
 #include <algorithm>
+#include <cmath>
 
 #include "AnnotationCoordinate.h"
 #include "AnnotationColorBar.h"
@@ -49,6 +50,7 @@
 #include "ChartableTwoFileMatrixChart.h"
 #include "ChartableTwoFileLineSeriesChart.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
+#include "CiftiMatrixTilePyramid.h"
 #include "DeveloperFlagsEnum.h"
 #include "EventManager.h"
 #include "EventOpenGLObjectToWindowTransform.h"
@@ -300,6 +302,105 @@ BrainOpenGLChartTwoDrawingFixedPipeline::drawChartOverlaySet(Brain* brain,
     annotationsOut = m_annotationsForDrawingOutput;
 }
 
+/**
+ * Draw the visible tiles of a matrix that is too large for a single texture.
+ * The level of the tile pyramid is chosen so that a cell of the level
+ * is about the size of a pixel at the current zoom.
+ *
+ * @param matrixChart
+ *     Matrix chart that is drawn.
+ * @param chartViewingType
+ *     Type of chart viewing.
+ */
+void
+BrainOpenGLChartTwoDrawingFixedPipeline::drawMatrixChartContentTiles(const ChartableTwoFileMatrixChart* matrixChart,
+                                                                     const ChartTwoMatrixTriangularViewingModeEnum::Enum chartViewingType)
+{
+    const CiftiMatrixTilePyramid* pyramid = matrixChart->getMatrixChartingTilePyramid();
+    if (pyramid == NULL) {
+        return;
+    }
+    
+    int32_t numberOfRows(0);
+    int32_t numberOfColumns(0);
+    matrixChart->getMatrixDimensions(numberOfRows,
+                                     numberOfColumns);
+    if ((numberOfRows <= 0)
+        || (numberOfColumns <= 0)) {
+        return;
+    }
+    
+    /*
+     * Region of the matrix (in cells) that is within the viewport
+     */
+    EventOpenGLObjectToWindowTransform transformEvent(EventOpenGLObjectToWindowTransform::SpaceType::MODEL);
+    EventManager::get()->sendEvent(transformEvent.getPointer());
+    if ( ! transformEvent.isValid()) {
+        return;
+    }
+    const std::array<int32_t, 4> viewport = transformEvent.getViewport();
+    if ((viewport[2] <= 0)
+        || (viewport[3] <= 0)) {
+        return;
+    }
+    const float windowBottomLeft[3] {
+        static_cast<float>(viewport[0]),
+        static_cast<float>(viewport[1]),
+        0.0f
+    };
+    const float windowTopRight[3] {
+        static_cast<float>(viewport[0] + viewport[2]),
+        static_cast<float>(viewport[1] + viewport[3]),
+        0.0f
+    };
+    float modelBottomLeft[3];
+    float modelTopRight[3];
+    transformEvent.inverseTransformPoint(windowBottomLeft,
+                                         modelBottomLeft);
+    transformEvent.inverseTransformPoint(windowTopRight,
+                                         modelTopRight);
+    
+    const float minX = std::max(std::min(modelBottomLeft[0], modelTopRight[0]), 0.0f);
+    const float maxX = std::min(std::max(modelBottomLeft[0], modelTopRight[0]), static_cast<float>(numberOfColumns));
+    const float minY = std::max(std::min(modelBottomLeft[1], modelTopRight[1]), 0.0f);
+    const float maxY = std::min(std::max(modelBottomLeft[1], modelTopRight[1]), static_cast<float>(numberOfRows));
+    if ((minX >= maxX)
+        || (minY >= maxY)) {
+        return;
+    }
+    
+    const float cellsPerPixelX = std::fabs(modelTopRight[0] - modelBottomLeft[0]) / viewport[2];
+    const float cellsPerPixelY = std::fabs(modelTopRight[1] - modelBottomLeft[1]) / viewport[3];
+    const int32_t level = pyramid->getLevelForCellsPerPixel(std::max(cellsPerPixelX,
+                                                                     cellsPerPixelY));
+    
+    /*
+     * Matrix row zero is at the top (maximum Y)
+     */
+    const int32_t firstRow   = static_cast<int32_t>(numberOfRows - maxY);
+    const int32_t lastRow    = std::min(static_cast<int32_t>(numberOfRows - minY), numberOfRows - 1);
+    const int32_t firstColumn = static_cast<int32_t>(minX);
+    const int32_t lastColumn  = std::min(static_cast<int32_t>(maxX), numberOfColumns - 1);
+    
+    const int64_t cellsPerTile = (static_cast<int64_t>(pyramid->getTileSize()) << level);
+    const int32_t firstTileRow    = static_cast<int32_t>(firstRow / cellsPerTile);
+    const int32_t lastTileRow     = static_cast<int32_t>(lastRow / cellsPerTile);
+    const int32_t firstTileColumn = static_cast<int32_t>(firstColumn / cellsPerTile);
+    const int32_t lastTileColumn  = static_cast<int32_t>(lastColumn / cellsPerTile);
+    
+    for (int32_t iTileRow = firstTileRow; iTileRow <= lastTileRow; iTileRow++) {
+        for (int32_t iTileColumn = firstTileColumn; iTileColumn <= lastTileColumn; iTileColumn++) {
+            GraphicsPrimitive* tilePrimitive = matrixChart->getMatrixChartingTileGraphicsPrimitive(chartViewingType,
+                                                                                                   level,
+                                                                                                   iTileRow,
+                                                                                                   iTileColumn);
+            if (tilePrimitive != NULL) {
+                drawPrimitivePrivate(tilePrimitive);
+            }
+        }
+    }
+}
+
 /**
  * Draw a histogram or line series chart.
  *
@@ -1247,8 +1348,12 @@ BrainOpenGLChartTwoDrawingFixedPipeline::drawMatrixChartContent(const ChartableT
                                                                 std::vector<MatrixRowColumnHighight*>& rowColumnHighlightingOut)
 {
     GraphicsPrimitive* matrixPrimitive(NULL);
+    const bool tiledFlag(matrixChart->isMatrixChartingTiled());
     const bool useTextureFlag(true);
-    if (useTextureFlag) {
+    if (tiledFlag) {
+        /* Tile primitives are obtained when drawing */
+    }
+    else if (useTextureFlag) {
         matrixPrimitive = matrixChart->getMatrixChartingGraphicsPrimitive(chartViewingType,
                                                                           CiftiMappableDataFile::MatrixGridMode::FILLED_TEXTURE);
     }
@@ -1257,7 +1362,8 @@ BrainOpenGLChartTwoDrawingFixedPipeline::drawMatrixChartContent(const ChartableT
                                                                           CiftiMappableDataFile::MatrixGridMode::FILLED_TRIANGLES);
     }
     
-    if (matrixPrimitive == NULL) {
+    if ((matrixPrimitive == NULL)
+        && ( ! tiledFlag)) {
         return;
     }
     
@@ -1305,12 +1411,20 @@ BrainOpenGLChartTwoDrawingFixedPipeline::drawMatrixChartContent(const ChartableT
         }
     }
     else {
-        drawPrimitivePrivate(matrixPrimitive);
+        if (tiledFlag) {
+            drawMatrixChartContentTiles(matrixChart,
+                                        chartViewingType);
+        }
+        else {
+            drawPrimitivePrivate(matrixPrimitive);
+        }
         
         const ChartTwoMatrixDisplayProperties* matrixProperties = m_browserTabContent->getChartTwoMatrixDisplayProperties();
         CaretAssert(matrixProperties);
         
-        if (matrixProperties->isGridLinesDisplayed()) {
+        /* Grid is one outline per cell, not drawn for tiled (very large) matrices */
+        if (matrixProperties->isGridLinesDisplayed()
+            && ( ! tiledFlag)) {
             GraphicsPrimitive* matrixGridPrimitive = matrixChart->getMatrixChartingGraphicsPrimitive(chartViewingType,
                                                                                                            CiftiMappableDataFile::MatrixGridMode::OUTLINE);
             drawPrimitivePrivate(matrixGridPrimitive);
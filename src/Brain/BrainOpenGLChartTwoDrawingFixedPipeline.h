@@ -235,6 +235,9 @@ namespace caret {
                                     const float zooming,
                                     std::vector<MatrixRowColumnHighight*>& rowColumnHighlightingOut);
         
+        void drawMatrixChartContentTiles(const ChartableTwoFileMatrixChart* matrixChart,
+                                         const ChartTwoMatrixTriangularViewingModeEnum::Enum chartViewingType);
+        
         void drawHistogramOrLineSeriesChart(const ChartTwoDataTypeEnum::Enum chartDataType);
         
         void drawChartGraphicsBoxAndSetViewport(const float vpX,
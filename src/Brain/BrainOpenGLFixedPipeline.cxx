@@ -31,6 +31,7 @@
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <cstring>
 
 #include <QStringList>
 #include <QImage>
@@ -50,6 +51,7 @@
 #include "BrainOpenGLVolumeObliqueSliceDrawing.h"
 #include "BrainOpenGLVolumeSliceDrawing.h"
 #include "BrainOpenGLVolumeTextureSliceDrawing.h"
+#include "BrainOpenGLVoxelCubeMesh.h"
 #include "BrainOpenGLShapeCone.h"
 #include "BrainOpenGLShapeCube.h"
 #include "BrainOpenGLShapeCylinder.h"
@@ -105,11 +107,13 @@
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "GraphicsEngineDataOpenGL.h"
+#include "GraphicsPrimitiveV3fC4f.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3fN3fC4ub.h"
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsPrimitiveV3fT3f.h"
 #include "GraphicsShape.h"
+#include "GroupAndNameHierarchyItem.h"
 #include "GroupAndNameHierarchyModel.h"
 #include "IdentifiedItemNode.h"
 #include "IdentificationManager.h"
@@ -188,6 +192,9 @@ BrainOpenGLFixedPipeline::BrainOpenGLFixedPipeline(BrainOpenGLTextRenderInterfac
     m_clippingPlaneGroup = NULL;
 
     m_tileTabsActiveFlag = false;
+    m_fiberGlyphDrawCounter = 0;
+    m_voxelCubeMeshDrawCounter = 0;
+    m_backgroundGraphicsBuildEnabled = false;
     
     setTabViewport(NULL);
 }
@@ -4398,41 +4405,15 @@ BrainOpenGLFixedPipeline::drawVolumeVoxelsAsCubesWholeBrain(std::vector<VolumeDr
     glDisable(GL_BLEND);
 }
 
-void nt(float a1, float a2, float a3,
-        float b1, float b2, float b3,
-        float c1, float c2, float c3,
-        const float normal[3],
-        const AString& name)
-{
-    const float a[3] = {a1,a2,a3};
-    const float b[3] = {b1,b2,b3};
-    const float c[3] = {c1,c2,c3};
-    float n[3];
-    MathFunctions::normalVector(a, b, c, n);
-    float t1 = normal[0] * n[0];
-    float t2 = normal[1] * n[1];
-    float t3 = normal[2] * n[2];
-    if (t1 < 0.0) {
-        std::cout << name << " X bad" << std::endl;
-    }
-    if (t2 < 0.0) {
-        std::cout << name << " Y bad" << std::endl;
-    }
-    if (t3 < 0.0) {
-        std::cout << name << " Z bad" << std::endl;
-    }
-    float n2[3] = { normal[0], normal[1], normal[2] };
-    if (MathFunctions::normalizeVector(n2) <= 0.0) {
-        std::cout << name << " Input normal invalid" << std::endl;
-    }
-    if (MathFunctions::normalizeVector(n) <= 0.0) {
-        std::cout << name << " Calculated normal invalid" << std::endl;
-    }
-}
-
 /**
  * Draw volumes a voxel cubes for whole brain view.
  *
+ * Only the exposed faces of the voxels, those between a drawn and
+ * an undrawn voxel, are drawn.  The faces are in a mesh that is
+ * cached for each volume, map, and tab and is rebuilt only when the
+ * voxel coloring (map, palette, thresholding, label selection,
+ * opacity, or clipping) changes.
+ *
  * @param volumeDrawInfoIn
  *    Describes volumes that are drawn.
  */
@@ -4526,13 +4507,8 @@ BrainOpenGLFixedPipeline::drawVolumeVoxelsAsCubesWholeBrainTwo(std::vector<Volum
         identificationIndices.reserve(10000 * idPerVoxelCount);
     }
     
-    const float minXNormal[3] = { -1.0,  0.0,  0.0 };
-    const float maxXNormal[3] = {  1.0,  0.0,  0.0 };
-    const float minYNormal[3] = {  0.0, -1.0,  0.0 };
-    const float maxYNormal[3] = {  0.0,  1.0,  0.0 };
-    const float minZNormal[3] = {  0.0,  0.0, -1.0 };
-    const float maxZNormal[3] = {  0.0,  0.0,  1.0 };
-
+    ++m_voxelCubeMeshDrawCounter;
+    
     for (int32_t iVol = 0; iVol < numberOfVolumesToDraw; iVol++) {
         VolumeDrawInfo& volInfo = volumeDrawInfo[iVol];
         if (volInfo.opacity < 1.0) {
@@ -4562,20 +4538,6 @@ BrainOpenGLFixedPipeline::drawVolumeVoxelsAsCubesWholeBrainTwo(std::vector<Volum
         const float dx = x1 - originX;
         const float dy = y1 - originY;
         const float dz = z1 - originZ;
-        const float halfAbsX(std::fabs((dx * cubeScale) / 2.0));
-        const float halfAbsY(std::fabs((dy * cubeScale) / 2.0));
-        const float halfAbsZ(std::fabs((dz * cubeScale) / 2.0));
-        
-        const bool xRightFlag(dx > 0.0);
-        const bool yAnteriorFlag(dy > 0.0);
-        const bool zSuperiorFlag(dz > 0.0);
-        
-        std::vector<float> labelMapData;
-        const CiftiBrainordinateLabelFile* ciftiLabelFile = dynamic_cast<const CiftiBrainordinateLabelFile*>(volumeFile);
-        if (ciftiLabelFile != NULL) {
-            ciftiLabelFile->getMapData(volInfo.mapIndex,
-                                       labelMapData);
-        }
         
         if ((dimI == 1)
             || (dimJ == 1)
@@ -4583,339 +4545,222 @@ BrainOpenGLFixedPipeline::drawVolumeVoxelsAsCubesWholeBrainTwo(std::vector<Volum
             glDisable(GL_LIGHTING);
         }
         
+        const int64_t dimensions[3] = { dimI, dimJ, dimK };
+        const float originXYZ[3] = { originX, originY, originZ };
+        const float spacingXYZ[3] = { dx, dy, dz };
+        
+        /*
+         * When the voxel coloring, opacity, and clipping are unchanged
+         * the cached mesh is drawn without coloring and clipping the voxels.
+         * Identification requires the coloring for each voxel.
+         */
+        BrainOpenGLVoxelCubeMesh* voxelCubeMesh = NULL;
+        if (( ! isSelect)
+            && (volInfo.wholeBrainVoxelDrawingMode == WholeBrainVoxelDrawingMode::DRAW_VOXELS_AS_THREE_D_CUBES)) {
+            voxelCubeMesh = getVoxelCubeMesh(volumeFile,
+                                             volInfo.mapIndex);
+            std::vector<uint64_t> coloringKey;
+            if (getVoxelCubeMeshColoringKey(volInfo,
+                                            displayGroup,
+                                            doClipping,
+                                            coloringKey)) {
+                const uint64_t signature = BrainOpenGLVoxelCubeMesh::computeSignature(dimensions,
+                                                                                      originXYZ,
+                                                                                      spacingXYZ,
+                                                                                      cubeScale,
+                                                                                      true,
+                                                                                      coloringKey.data(),
+                                                                                      coloringKey.size() * sizeof(uint64_t));
+                GraphicsPrimitiveV3fN3fC4ub* primitive = NULL;
+                if (voxelCubeMesh->getCachedMesh(signature,
+                                                 primitive)) {
+                    if (primitive != NULL) {
+                        if (primitive->isValid()) {
+                            GraphicsEngineDataOpenGL::draw(primitive);
+                        }
+                    }
+                    continue;
+                }
+            }
+        }
+        
         const int64_t numAxialSliceVoxels(dimI * dimJ);
         const int64_t numVoxels(numAxialSliceVoxels * dimK);
         const int64_t numAxialSizeRGBA(numAxialSliceVoxels * 4);
         const int64_t numRGBA(numVoxels * 4);
-        std::vector<uint8_t> axialSliceRGBA(numAxialSizeRGBA);
         std::vector<uint8_t> volumeRGBA(numRGBA, 0);
 
         /*
          * Get coloring for all voxels in volume
          */
         for (int64_t kVoxel = 0; kVoxel < dimK; kVoxel++) {
-            /*
-             * Voxel coloring for axial slice
-             */
+            uint8_t* axialSliceRGBA = &volumeRGBA[numAxialSizeRGBA * kVoxel];
             volumeFile->getVoxelColorsForSliceInMap(volInfo.mapIndex,
                                                     VolumeSliceViewPlaneEnum::AXIAL,
                                                     kVoxel,
                                                     displayGroup,
                                                     this->windowTabIndex,
-                                                    axialSliceRGBA.data());
+                                                    axialSliceRGBA);
             /*
              * Apply layer opacity
              */
             if (volInfo.opacity < 1.0) {
                 for (int64_t m = 0; m < numAxialSliceVoxels; m++) {
-                    CaretAssertVectorIndex(axialSliceRGBA, m * 4 + 3);
                     axialSliceRGBA[m * 4 + 3] *= volInfo.opacity;
                 }
             }
-            
-            /*
-             * Copy axial slice RGBA to Volume RGBA
-             */
-            const int64_t sliceOffset(numAxialSizeRGBA * kVoxel);
-            std::copy(axialSliceRGBA.begin(),
-                      axialSliceRGBA.end(),
-                      volumeRGBA.begin() + sliceOffset);
         }
-
-        std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub> primitive(GraphicsPrimitive::newPrimitiveV3fN3fC4ub(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES));
-
-        int64_t count(0);
-        for (int64_t iVoxel = 0; iVoxel < dimI; iVoxel++) {
-            for (int64_t jVoxel = 0; jVoxel < dimJ; jVoxel++) {
-                for (int64_t kVoxel = 0; kVoxel < dimK; kVoxel++) {
-                    const int64_t offsetRGBA((numAxialSizeRGBA * kVoxel)
-                                              + (dimI * jVoxel * 4)
-                                              + (iVoxel * 4));
-                    CaretAssertVectorIndex(volumeRGBA, offsetRGBA + 3);
-                    const uint8_t* rgba(&volumeRGBA[offsetRGBA]);
-                    
-                    if (rgba[3] > 0) {
-                        float x = 0, y = 0.0, z = 0.0;
-                        volumeFile->indexToSpace(iVoxel, jVoxel, kVoxel, x, y, z);
-                        
-                        if (doClipping) {
-                            const float xyz[3] = { x, y, z };
+        
+        /*
+         * Voxels outside of the clipping planes are not drawn so that
+         * the faces of voxels along the clipping planes are exposed
+         */
+        if (doClipping) {
+            for (int64_t kVoxel = 0; kVoxel < dimK; kVoxel++) {
+                for (int64_t jVoxel = 0; jVoxel < dimJ; jVoxel++) {
+                    for (int64_t iVoxel = 0; iVoxel < dimI; iVoxel++) {
+                        const int64_t offsetRGBA(((numAxialSliceVoxels * kVoxel)
+                                                  + (dimI * jVoxel)
+                                                  + iVoxel) * 4);
+                        CaretAssertVectorIndex(volumeRGBA, offsetRGBA + 3);
+                        if (volumeRGBA[offsetRGBA + 3] > 0) {
+                            float xyz[3];
+                            volumeFile->indexToSpace(iVoxel, jVoxel, kVoxel, xyz);
                             if ( ! isCoordinateInsideClippingPlanesForStructure(StructureEnum::ALL,
                                                                                 xyz)) {
-                                continue;
-                            }
-                        }
-                        
-                        bool drawMinXFlag(iVoxel == 0);
-                        bool drawMaxXFlag(iVoxel == (dimI - 1));
-                        bool drawMinYFlag(jVoxel == 0);
-                        bool drawMaxYFlag(jVoxel == (dimJ - 1));
-                        bool drawMinZFlag(kVoxel == 0);
-                        bool drawMaxZFlag(kVoxel == (dimK - 1));
-                        
-                        if (iVoxel > 0) {
-                            const int64_t offset(offsetRGBA - 4);
-                            CaretAssertVectorIndex(volumeRGBA, offset + 3);
-                            if (volumeRGBA[offset + 3] == 0) {
-                                /* Draw side since voxel on left side is off */
-                                if (xRightFlag) {
-                                    drawMinXFlag = true;
-                                }
-                                else {
-                                    drawMaxXFlag = true;
-                                }
+                                volumeRGBA[offsetRGBA + 3] = 0;
                             }
                         }
-                        if (iVoxel < (dimI - 1)) {
-                            const int64_t offset(offsetRGBA + 4);
-                            CaretAssertVectorIndex(volumeRGBA, offset + 3);
-                            if (volumeRGBA[offset + 3] == 0) {
-                                /* Draw side since voxel on right side is off */
-                                if (xRightFlag) {
-                                    drawMaxXFlag = true;
-                                }
-                                else {
-                                    drawMinXFlag = true;
-                                }
-                            }
-                        }
-
-                        if (jVoxel > 0) {
-                            const int64_t offset(offsetRGBA - (dimI * 4));
-                            CaretAssertVectorIndex(volumeRGBA, offset + 3);
-                            if (volumeRGBA[offset + 3] == 0) {
-                                /* Draw side since voxel on bottom side is off */
-                                if (yAnteriorFlag) {
-                                    drawMinYFlag = true;
-                                }
-                                else {
-                                    drawMaxYFlag = true;
-                                }
-                            }
-                        }
-                        if (jVoxel < (dimJ - 1)) {
-                            const int64_t offset(offsetRGBA + (dimI * 4));
-                            CaretAssertVectorIndex(volumeRGBA, offset + 3);
-                            if (volumeRGBA[offset + 3] == 0) {
-                                /* Draw side since voxel on top side is off */
-                                if (yAnteriorFlag) {
-                                    drawMaxYFlag = true;
-                                }
-                                else {
-                                    drawMinYFlag = true;
-                                }
-                            }
-                        }
-
-                        if (kVoxel > 0) {
-                            const int64_t offset(offsetRGBA - numAxialSizeRGBA);
-                            CaretAssertVectorIndex(volumeRGBA, offset + 3);
-                            if (volumeRGBA[offset + 3] == 0) {
-                                /* Draw side since voxel below is off */
-                                if (zSuperiorFlag) {
-                                    drawMinZFlag = true;
-                                }
-                                else {
-                                    drawMaxZFlag = true;
-                                }
-                            }
-                        }
-                        if (kVoxel < (dimK - 1)) {
-                            const int64_t offset(offsetRGBA + numAxialSizeRGBA);
-                            CaretAssertVectorIndex(volumeRGBA, offset + 3);
-                            if (volumeRGBA[offset + 3] == 0) {
-                                /* Draw side since voxel above is off */
-                                if (zSuperiorFlag) {
-                                    drawMaxZFlag = true;
-                                }
-                                else {
-                                    drawMinZFlag = true;
-                                }
-                            }
-                        }
-                        
-                        if (drawMinXFlag
-                            || drawMaxZFlag
-                            || drawMinYFlag
-                            || drawMaxYFlag
-                            || drawMinZFlag
-                            || drawMaxZFlag) {
-                            count++;
-                        }
-                        const float minX(x - halfAbsX);
-                        const float maxX(x + halfAbsX);
-                        const float minY(y - halfAbsY);
-                        const float maxY(y + halfAbsY);
-                        const float minZ(z - halfAbsZ);
-                        const float maxZ(z + halfAbsZ);
-                        if (drawMinXFlag) {
-//                            uint8_t rgba[4] = { 255, 0, 0, 255 };
-                            primitive->addVertex(minX, minY, minZ, minXNormal, rgba);
-                            primitive->addVertex(minX, minY, maxZ, minXNormal, rgba);
-                            primitive->addVertex(minX, maxY, maxZ, minXNormal, rgba);
-//                            nt(minX, minY, minZ, minX, minY, maxZ, minX, maxY, maxZ, minXNormal, "XMin1");
-                            primitive->addVertex(minX, minY, minZ, minXNormal, rgba);
-                            primitive->addVertex(minX, maxY, maxZ, minXNormal, rgba);
-                            primitive->addVertex(minX, maxY, minZ, minXNormal, rgba);
-//                            nt(minX, minY, minZ, minX, maxY, maxZ, minX, maxY, minZ, minXNormal, "XMin2");
-                        }
-                        if (drawMaxXFlag) {
-//                            uint8_t rgba[4] = { 0, 255, 0, 255 };
-                            primitive->addVertex(maxX, minY, minZ, maxXNormal, rgba);
-                            primitive->addVertex(maxX, maxY, minZ, maxXNormal, rgba);
-                            primitive->addVertex(maxX, minY, maxZ, maxXNormal, rgba);
-//                            nt(maxX, minY, minZ, maxX, maxY, minZ, maxX, minY, maxZ, maxXNormal, "XMax1");
-                            primitive->addVertex(maxX, minY, maxZ, maxXNormal, rgba);
-                            primitive->addVertex(maxX, maxY, minZ, maxXNormal, rgba);
-                            primitive->addVertex(maxX, maxY, maxZ, maxXNormal, rgba);
-//                            nt(maxX, minY, maxZ, maxX, maxY, minZ, maxX, maxY, maxZ, maxXNormal, "XMax2");
-                        }
-
-                        if (drawMinYFlag) {
-//                            uint8_t rgba[4] = { 0, 0, 255, 255 };
-                            primitive->addVertex(minX, minY, minZ, minYNormal, rgba);
-                            primitive->addVertex(maxX, minY, minZ, minYNormal, rgba);
-                            primitive->addVertex(maxX, minY, maxZ, minYNormal, rgba);
-//                            nt(minX, minY, minZ, maxX, minY, minZ, maxX, minY, maxZ, minYNormal, "YMin1");
-                            primitive->addVertex(minX, minY, minZ, minYNormal, rgba);
-                            primitive->addVertex(maxX, minY, maxZ, minYNormal, rgba);
-                            primitive->addVertex(minX, minY, maxZ, minYNormal, rgba);
-//                            nt(minX, minY, minZ, maxX, minY, maxZ, minX, minY, maxZ, minYNormal, "YMin2");
-                        }
-                        if (drawMaxYFlag) {
-//                            uint8_t rgba[4] = { 255, 255, 0, 255 };
-                            primitive->addVertex(maxX, maxY, minZ, maxYNormal, rgba);
-                            primitive->addVertex(minX, maxY, minZ, maxYNormal, rgba);
-                            primitive->addVertex(minX, maxY, maxZ, maxYNormal, rgba);
-//                            nt(maxX, maxY, minZ, minX, maxY, minZ, minX, maxY, maxZ, maxYNormal, "YMax1");
-                            primitive->addVertex(maxX, maxY, minZ, maxYNormal, rgba);
-                            primitive->addVertex(minX, maxY, maxZ, maxYNormal, rgba);
-                            primitive->addVertex(maxX, maxY, maxZ, maxYNormal, rgba);
-//                            nt(maxX, maxY, minZ, minX, maxY, maxZ, maxX, maxY, maxZ, maxYNormal, "YMax2");
+                    }
+                }
+            }
+        }
+        
+        /*
+         * For identification, replace each voxel's color with
+         * its identification color
+         */
+        if (isSelect) {
+            for (int64_t kVoxel = 0; kVoxel < dimK; kVoxel++) {
+                for (int64_t jVoxel = 0; jVoxel < dimJ; jVoxel++) {
+                    for (int64_t iVoxel = 0; iVoxel < dimI; iVoxel++) {
+                        const int64_t offsetRGBA(((numAxialSliceVoxels * kVoxel)
+                                                  + (dimI * jVoxel)
+                                                  + iVoxel) * 4);
+                        CaretAssertVectorIndex(volumeRGBA, offsetRGBA + 3);
+                        uint8_t* rgba = &volumeRGBA[offsetRGBA];
+                        if (rgba[3] > 0) {
+                            const int32_t idIndex = identificationIndices.size() / idPerVoxelCount;
+                            this->colorIdentification->addItem(rgba,
+                                                               SelectionItemDataTypeEnum::VOXEL,
+                                                               idIndex);
+                            identificationIndices.push_back(iVol);
+                            identificationIndices.push_back(volInfo.mapIndex);
+                            identificationIndices.push_back(iVoxel);
+                            identificationIndices.push_back(jVoxel);
+                            identificationIndices.push_back(kVoxel);
                         }
+                    }
+                }
+            }
+        }
+        
+        switch (volInfo.wholeBrainVoxelDrawingMode) {
+            case WholeBrainVoxelDrawingMode::DRAW_VOXELS_AS_THREE_D_CUBES:
+            {
+                if (isSelect) {
+                    /*
+                     * Each voxel has a unique color so faces are not merged
+                     */
+                    std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub> primitive(BrainOpenGLVoxelCubeMesh::createMesh(dimensions,
+                                                                                                                 originXYZ,
+                                                                                                                 spacingXYZ,
+                                                                                                                 cubeScale,
+                                                                                                                 false,
+                                                                                                                 volumeRGBA.data()));
+                    if (primitive->isValid()) {
+                        GraphicsEngineDataOpenGL::draw(primitive.get());
+                    }
+                }
+                else {
+                    CaretAssert(voxelCubeMesh);
                     
-                        if (drawMinZFlag) {
-//                            uint8_t rgba[4] = { 255, 0, 255, 255 };
-                            primitive->addVertex(minX, minY, minZ, minZNormal, rgba);
-                            primitive->addVertex(maxX, maxY, minZ, minZNormal, rgba);
-                            primitive->addVertex(maxX, minY, minZ, minZNormal, rgba);
-//                            nt(minX, minY, minZ,maxX, maxY, minZ,maxX, minY, minZ, minZNormal, "ZMin1");
-                            primitive->addVertex(minX, maxY, minZ, minZNormal, rgba);
-                            primitive->addVertex(maxX, maxY, minZ, minZNormal, rgba);
-                            primitive->addVertex(minX, minY, minZ, minZNormal, rgba);
-//                            nt(minX, maxY, minZ, maxX, maxY, minZ, minX, minY, minZ, minZNormal, "ZMin2");
+                    /*
+                     * Key is obtained after coloring since some files
+                     * update their coloring when the colors are retrieved.
+                     * Without a coloring version, the colors are the key.
+                     */
+                    uint64_t signature = 0;
+                    std::vector<uint64_t> coloringKey;
+                    if (getVoxelCubeMeshColoringKey(volInfo,
+                                                    displayGroup,
+                                                    doClipping,
+                                                    coloringKey)) {
+                        signature = BrainOpenGLVoxelCubeMesh::computeSignature(dimensions,
+                                                                               originXYZ,
+                                                                               spacingXYZ,
+                                                                               cubeScale,
+                                                                               true,
+                                                                               coloringKey.data(),
+                                                                               coloringKey.size() * sizeof(uint64_t));
+                    }
+                    else {
+                        signature = BrainOpenGLVoxelCubeMesh::computeSignature(dimensions,
+                                                                               originXYZ,
+                                                                               spacingXYZ,
+                                                                               cubeScale,
+                                                                               true,
+                                                                               volumeRGBA.data(),
+                                                                               volumeRGBA.size());
+                    }
+                    GraphicsPrimitiveV3fN3fC4ub* primitive = voxelCubeMesh->getMesh(dimensions,
+                                                                                    originXYZ,
+                                                                                    spacingXYZ,
+                                                                                    cubeScale,
+                                                                                    true,
+                                                                                    m_backgroundGraphicsBuildEnabled,
+                                                                                    signature,
+                                                                                    volumeRGBA);
+                    if (primitive != NULL) {
+                        if (primitive->isValid()) {
+                            GraphicsEngineDataOpenGL::draw(primitive);
                         }
-                        if (drawMaxZFlag) {
-//                            uint8_t rgba[4] = { 0, 255, 255, 255 };
-                            primitive->addVertex(minX, minY, maxZ, maxZNormal, rgba);
-                            primitive->addVertex(maxX, minY, maxZ, maxZNormal, rgba);
-                            primitive->addVertex(maxX, maxY, maxZ, maxZNormal, rgba);
-//                            nt(minX, minY, maxZ, maxX, minY, maxZ, maxX, maxY, maxZ, maxZNormal, "ZMax1");
-                            primitive->addVertex(minX, minY, maxZ, maxZNormal, rgba);
-                            primitive->addVertex(maxX, maxY, maxZ, maxZNormal, rgba);
-                            primitive->addVertex(minX, maxY, maxZ, maxZNormal, rgba);
-//                            nt(minX, minY, maxZ, maxX, maxY, maxZ, minX, maxY, maxZ, maxZNormal, "ZMax2");
+                    }
+                }
+            }
+                break;
+            case WholeBrainVoxelDrawingMode::DRAW_VOXELS_AS_ROUNDED_THREE_D_CUBES:
+            {
+                /*
+                 * Rounded cubes do not share faces so each is drawn
+                 */
+                const float cubeSizeDX = std::fabs(dx) * cubeScale;
+                const float cubeSizeDY = std::fabs(dy) * cubeScale;
+                const float cubeSizeDZ = std::fabs(dz) * cubeScale;
+                for (int64_t kVoxel = 0; kVoxel < dimK; kVoxel++) {
+                    for (int64_t jVoxel = 0; jVoxel < dimJ; jVoxel++) {
+                        for (int64_t iVoxel = 0; iVoxel < dimI; iVoxel++) {
+                            const int64_t offsetRGBA(((numAxialSliceVoxels * kVoxel)
+                                                      + (dimI * jVoxel)
+                                                      + iVoxel) * 4);
+                            CaretAssertVectorIndex(volumeRGBA, offsetRGBA + 3);
+                            const uint8_t* rgba = &volumeRGBA[offsetRGBA];
+                            if (rgba[3] > 0) {
+                                float x = 0.0, y = 0.0, z = 0.0;
+                                volumeFile->indexToSpace(iVoxel, jVoxel, kVoxel, x, y, z);
+                                glPushMatrix();
+                                glTranslatef(x, y, z);
+                                drawRoundedCuboid(rgba, cubeSizeDX, cubeSizeDY, cubeSizeDZ);
+                                glPopMatrix();
+                            }
                         }
                     }
                 }
             }
+                break;
+            case WholeBrainVoxelDrawingMode::DRAW_VOXELS_ON_TWO_D_SLICES:
+                break;
         }
-
-        std::cout << "Draw voxels NEW: " << count << " of " << (dimI * dimJ * dimK) << std::endl;
-        
-        if (primitive->isValid()) {
-            GraphicsEngineDataOpenGL::draw(primitive.get());
-        }
-//        for (int64_t iVoxel = 0; iVoxel < dimI; iVoxel++) {
-//            for (int64_t jVoxel = 0; jVoxel < dimJ; jVoxel++) {
-//                for (int64_t kVoxel = 0; kVoxel < dimK; kVoxel++) {
-//                    if (ciftiLabelFile != NULL) {
-//                        ciftiLabelFile->getVoxelColorInMapForLabelData(labelMapData,
-//                                                                       iVoxel,
-//                                                                       jVoxel,
-//                                                                       kVoxel,
-//                                                                       volInfo.mapIndex,
-//                                                                       displayGroup,
-//                                                                       this->windowTabIndex,
-//                                                                       rgba);
-//                    }
-//                    else {
-//                        volumeFile->getVoxelColorInMap(iVoxel,
-//                                                       jVoxel,
-//                                                       kVoxel,
-//                                                       volInfo.mapIndex,
-//                                                       displayGroup,
-//                                                       this->windowTabIndex,
-//                                                       rgba);
-//                    }
-//                    if (rgba[3] > 0) {
-//                        if (volInfo.opacity < 1.0) {
-//                            rgba[3] *= volInfo.opacity;
-//                        }
-//                        if (rgba[3] > 0) {
-//                            float x = 0, y = 0.0, z = 0.0;
-//                            volumeFile->indexToSpace(iVoxel, jVoxel, kVoxel, x, y, z);
-//
-//                            bool drawIt = true;
-//                            if (doClipping) {
-//                                const float xyz[3] = { x, y, z };
-//                                if ( ! isCoordinateInsideClippingPlanesForStructure(StructureEnum::ALL,
-//                                                                                    xyz)) {
-//                                    drawIt = false;
-//                                }
-//                            }
-//
-//                            if (drawIt) {
-//                                const int64_t offsetRGBA(((dimI * dimJ * kVoxel)
-//                                                          + (dimI * jVoxel)
-//                                                          + iVoxel)
-//                                                         * 4);
-//                                CaretAssertVectorIndex(volumeRGBA, offsetRGBA + 3);
-//                                volumeRGBA[offsetRGBA]     = rgba[0];
-//                                volumeRGBA[offsetRGBA + 1] = rgba[1];
-//                                volumeRGBA[offsetRGBA + 2] = rgba[2];
-//                                volumeRGBA[offsetRGBA + 3] = rgba[3];
-//                            }
-//                        }
-//                    }
-//                }
-//            }
-//        }
-        
-//        for (int64_t iVoxel = 0; iVoxel < dimI; iVoxel++) {
-//            for (int64_t jVoxel = 0; jVoxel < dimJ; jVoxel++) {
-//                for (int64_t kVoxel = 0; kVoxel < dimK; kVoxel++) {
-//                               if (isSelect) {
-//                                    const int32_t idIndex = identificationIndices.size() / idPerVoxelCount;
-//                                    this->colorIdentification->addItem(rgba,
-//                                                                       SelectionItemDataTypeEnum::VOXEL,
-//                                                                       idIndex);
-//                                    identificationIndices.push_back(iVol);
-//                                    identificationIndices.push_back(volInfo.mapIndex);
-//                                    identificationIndices.push_back(iVoxel);
-//                                    identificationIndices.push_back(jVoxel);
-//                                    identificationIndices.push_back(kVoxel);
-//                                }
-//
-//                                glPushMatrix();
-//                                glTranslatef(x, y, z);
-//                                switch (volInfo.wholeBrainVoxelDrawingMode) {
-//                                    case WholeBrainVoxelDrawingMode::DRAW_VOXELS_AS_THREE_D_CUBES:
-//                                        drawCuboid(rgba, cubeSizeDX, cubeSizeDY, cubeSizeDZ);
-//                                        break;
-//                                    case WholeBrainVoxelDrawingMode::DRAW_VOXELS_AS_ROUNDED_THREE_D_CUBES:
-//                                        drawRoundedCuboid(rgba, cubeSizeDX, cubeSizeDY, cubeSizeDZ);
-//                                        break;
-//                                    case WholeBrainVoxelDrawingMode::DRAW_VOXELS_ON_TWO_D_SLICES:
-//                                        break;
-//                                }
-//                                glPopMatrix();
-//                            }
-//                        }
-//                    }
-//                }
-//            }
-//        }
     }
     
     if (isSelect) {
@@ -4960,6 +4805,121 @@ BrainOpenGLFixedPipeline::drawVolumeVoxelsAsCubesWholeBrainTwo(std::vector<Volum
 }
 
 
+/**
+ * Get the voxel cube mesh for a volume's map in the current tab.
+ * The least recently drawn mesh is removed if there are too many meshes.
+ *
+ * @param volumeFile
+ *    The volume file.
+ * @param mapIndex
+ *    Index of the map.
+ * @return
+ *    The voxel cube mesh.
+ */
+BrainOpenGLVoxelCubeMesh*
+BrainOpenGLFixedPipeline::getVoxelCubeMesh(const VolumeMappableInterface* volumeFile,
+                                           const int32_t mapIndex)
+{
+    const std::tuple<const VolumeMappableInterface*, int32_t, int32_t> key(volumeFile,
+                                                                          mapIndex,
+                                                                          this->windowTabIndex);
+    auto iter = m_voxelCubeMeshes.find(key);
+    if (iter == m_voxelCubeMeshes.end()) {
+        if (static_cast<int32_t>(m_voxelCubeMeshes.size()) >= s_voxelCubeMeshCacheSize) {
+            auto oldestIter = m_voxelCubeMeshes.begin();
+            for (auto meshIter = m_voxelCubeMeshes.begin();
+                 meshIter != m_voxelCubeMeshes.end();
+                 meshIter++) {
+                if (meshIter->second.m_lastDrawnCounter < oldestIter->second.m_lastDrawnCounter) {
+                    oldestIter = meshIter;
+                }
+            }
+            m_voxelCubeMeshes.erase(oldestIter);
+        }
+        
+        VoxelCubeMesh voxelCubeMesh;
+        voxelCubeMesh.m_mesh.reset(new BrainOpenGLVoxelCubeMesh());
+        iter = m_voxelCubeMeshes.insert(std::make_pair(key,
+                                                       std::move(voxelCubeMesh))).first;
+    }
+    iter->second.m_lastDrawnCounter = m_voxelCubeMeshDrawCounter;
+    
+    return iter->second.m_mesh.get();
+}
+
+/**
+ * Get a key for the coloring of voxels drawn as a cube mesh.  The key
+ * is small and changes whenever the voxel coloring, label selection,
+ * layer opacity, or clipping changes so that a cached mesh may be
+ * drawn without coloring the voxels.
+ *
+ * @param volumeDrawInfo
+ *    Info for the volume.
+ * @param displayGroup
+ *    The selected display group.
+ * @param clippingFlag
+ *    True if voxels are clipped.
+ * @param coloringKeyOut
+ *    Output containing the key.
+ * @return
+ *    True if the key is valid.  False if the volume does not provide a
+ *    coloring version in which case the voxel colors must be compared.
+ */
+bool
+BrainOpenGLFixedPipeline::getVoxelCubeMeshColoringKey(const VolumeDrawInfo& volumeDrawInfo,
+                                                      const DisplayGroupEnum::Enum displayGroup,
+                                                      const bool clippingFlag,
+                                                      std::vector<uint64_t>& coloringKeyOut) const
+{
+    coloringKeyOut.clear();
+    
+    CaretAssert(volumeDrawInfo.volumeFile);
+    const int64_t coloringVersion = volumeDrawInfo.volumeFile->getVoxelColoringVersionForMap(volumeDrawInfo.mapIndex);
+    if (coloringVersion <= 0) {
+        return false;
+    }
+    
+    coloringKeyOut.push_back(coloringVersion);
+    coloringKeyOut.push_back(static_cast<uint64_t>(DisplayGroupEnum::toIntegerCode(displayGroup)));
+    coloringKeyOut.push_back(static_cast<uint64_t>(this->windowTabIndex));
+    
+    /*
+     * Voxels with labels that are not selected are not drawn
+     */
+    if ((volumeDrawInfo.mapFile == NULL)
+        || volumeDrawInfo.mapFile->isMappedWithLabelTable()) {
+        coloringKeyOut.push_back(GiftiLabel::getColoringModificationCounter());
+        coloringKeyOut.push_back(GroupAndNameHierarchyItem::getSelectionModificationCounter());
+    }
+    
+    uint32_t opacityBits = 0;
+    std::memcpy(&opacityBits, &volumeDrawInfo.opacity, sizeof(opacityBits));
+    coloringKeyOut.push_back(opacityBits);
+    
+    /*
+     * Voxels are clipped using the planes for all structures
+     */
+    coloringKeyOut.push_back(clippingFlag ? 1 : 0);
+    if (clippingFlag) {
+        CaretAssert(m_clippingPlaneGroup);
+        const std::vector<const Plane*> planes = m_clippingPlaneGroup->getActiveClippingPlanesForStructure(StructureEnum::ALL);
+        coloringKeyOut.push_back(planes.size());
+        for (std::vector<const Plane*>::const_iterator iter = planes.begin();
+             iter != planes.end();
+             iter++) {
+            double abcd[4];
+            (*iter)->getPlane(abcd[0], abcd[1], abcd[2], abcd[3]);
+            for (int32_t i = 0; i < 4; i++) {
+                uint64_t bits = 0;
+                std::memcpy(&bits, &abcd[i], sizeof(bits));
+                coloringKeyOut.push_back(bits);
+            }
+        }
+    }
+    
+    return true;
+}
+
 void
 BrainOpenGLFixedPipeline::setFiberOrientationDisplayInfo(const DisplayPropertiesFiberOrientation* dpfo,
                                                          const DisplayGroupEnum::Enum displayGroup,
@@ -5053,13 +5013,35 @@ BrainOpenGLFixedPipeline::drawFiberOrientations(const Plane* plane,
                                    &colorUseFiber,
                                    fiberOrientDispInfo);
     /*
-     * Draw the vectors from each of the connectivity files
+     * Glyphs are only recreated when the displayed files, their
+     * fiber orientations, the slice, or the display settings change
      */
+    const uint64_t fiberOrientationFilesKeyType = 0;
+    std::vector<uint64_t> glyphKey;
+    getFiberOrientationGlyphKey(&fiberOrientDispInfo,
+                                glyphKey);
+    glyphKey.push_back(fiberOrientationFilesKeyType);
+    std::vector<CiftiFiberOrientationFile*> displayedFiberOrientationFiles;
     const int32_t numFiberOrienationFiles = m_brain->getNumberOfConnectivityFiberOrientationFiles();
     for (int32_t iFile = 0; iFile < numFiberOrienationFiles; iFile++) {
         CiftiFiberOrientationFile* cfof = m_brain->getConnectivityFiberOrientationFile(iFile);
         if (cfof->isDisplayed(displayGroup,
                               this->windowTabIndex)) {
+            displayedFiberOrientationFiles.push_back(cfof);
+            glyphKey.push_back(reinterpret_cast<uintptr_t>(cfof));
+            glyphKey.push_back(cfof->getDataVersion());
+        }
+    }
+    
+    if ( ! drawCachedFiberOrientationGlyphs(glyphKey)) {
+        /*
+         * Draw the vectors from each of the connectivity files
+         */
+        for (std::vector<CiftiFiberOrientationFile*>::iterator fileIter = displayedFiberOrientationFiles.begin();
+             fileIter != displayedFiberOrientationFiles.end();
+             fileIter++) {
+            CiftiFiberOrientationFile* cfof = *fileIter;
+            
             /*
              * Draw each of the fiber orientations which may contain multiple fibers
              */
@@ -5078,11 +5060,12 @@ BrainOpenGLFixedPipeline::drawFiberOrientations(const Plane* plane,
                                               fiberOrientation);
             }
         }
+        
+        drawAllFiberOrientations(&fiberOrientDispInfo,
+                                 glyphKey,
+                                 false);
     }
     
-    drawAllFiberOrientations(&fiberOrientDispInfo,
-                             false);
-    
     /*
      * Restore status of clipping planes enabled
      */
@@ -5193,27 +5176,262 @@ BrainOpenGLFixedPipeline::sortFiberOrientationsByDepth()
     m_fiberOrientationsForDrawing.sort(fiberDepthCompare);
 }
 
+/*
+ * Bits of a float for use in a key.
+ */
+static uint64_t
+floatToKeyValue(const float value)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/*
+ * Bits of a double for use in a key.
+ */
+static uint64_t
+doubleToKeyValue(const double value)
+{
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/*
+ * Current modelview and projection matrices, which determine
+ * the depth order of fibers.
+ */
+static void
+getFiberGlyphDepthSortMatrices(std::vector<double>& matricesOut)
+{
+    matricesOut.resize(32);
+    glGetDoublev(GL_MODELVIEW_MATRIX, &matricesOut[0]);
+    glGetDoublev(GL_PROJECTION_MATRIX, &matricesOut[16]);
+}
+
 /**
  * Draw all of the fiber orienations.
  *
+ * The fiber symbols are packed into a single primitive (lines or cone
+ * triangles) that is drawn with one call.  The primitive is added to a
+ * small cache using the given key so that the fibers need not be
+ * collected or the vertex buffers rebuilt until the fiber data, the
+ * slice, or the display settings change (see drawCachedFiberOrientationGlyphs()).
+ *
+ * Sorted fibers are drawn back to front for alpha blending and that order
+ * depends upon the view, so the primitive is only reused while the
+ * modelview and projection matrices are unchanged.
+ *
  * @param fodi
  *    Parameters controlling the drawing of fiber orientations. 
+ * @param glyphKey
+ *    Key for the fibers and the display settings.
+ * @param isSortFibers
+ *    If true, sort the fibers by depth for alpha blending.
  */
 void
 BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplayInfo* fodi,
+                                                   const std::vector<uint64_t>& glyphKey,
                                                    const bool isSortFibers)
 {
     if (isSortFibers) {
         sortFiberOrientationsByDepth();
     }
     
+    /*
+     * Remove least recently drawn primitive when cache is full
+     */
+    if (static_cast<int32_t>(m_fiberGlyphPrimitives.size()) >= s_fiberGlyphPrimitiveCacheSize) {
+        std::map<std::vector<uint64_t>, FiberGlyphPrimitive>::iterator oldestIter = m_fiberGlyphPrimitives.begin();
+        for (std::map<std::vector<uint64_t>, FiberGlyphPrimitive>::iterator iter = m_fiberGlyphPrimitives.begin();
+             iter != m_fiberGlyphPrimitives.end();
+             iter++) {
+            if (iter->second.m_lastDrawnCounter < oldestIter->second.m_lastDrawnCounter) {
+                oldestIter = iter;
+            }
+        }
+        m_fiberGlyphPrimitives.erase(oldestIter);
+    }
+    
+    /*
+     * Primitive is NULL if there are no fibers to draw
+     */
+    FiberGlyphPrimitive glyphPrimitive;
+    if ( ! m_fiberOrientationsForDrawing.empty()) {
+        glyphPrimitive.m_primitive.reset(createFiberOrientationGlyphPrimitive(fodi));
+    }
+    glyphPrimitive.m_lastDrawnCounter = ++m_fiberGlyphDrawCounter;
+    
+    if (isSortFibers) {
+        getFiberGlyphDepthSortMatrices(glyphPrimitive.m_depthSortMatrices);
+    }
+    
+    GraphicsPrimitive* primitive = glyphPrimitive.m_primitive.get();
+    m_fiberGlyphPrimitives[glyphKey] = std::move(glyphPrimitive);
+    
+    if (primitive != NULL) {
+        GraphicsEngineDataOpenGL::draw(primitive);
+    }
+    
+    /*
+     * Now clear the list of fiber orientations for drawing.
+     */
+    m_fiberOrientationsForDrawing.clear();
+}
+
+/**
+ * Draw the cached fiber glyphs for the given key.
+ *
+ * @param glyphKey
+ *    Key for the fibers and the display settings.
+ * @return
+ *    True if the glyphs were in the cache and have been drawn, else
+ *    false and the fibers must be drawn with drawAllFiberOrientations().
+ */
+bool
+BrainOpenGLFixedPipeline::drawCachedFiberOrientationGlyphs(const std::vector<uint64_t>& glyphKey)
+{
+    std::map<std::vector<uint64_t>, FiberGlyphPrimitive>::iterator cacheIter = m_fiberGlyphPrimitives.find(glyphKey);
+    if (cacheIter == m_fiberGlyphPrimitives.end()) {
+        return false;
+    }
+    
+    /*
+     * Blended glyphs sorted for a different view are out of order
+     */
+    if ( ! cacheIter->second.m_depthSortMatrices.empty()) {
+        std::vector<double> matrices;
+        getFiberGlyphDepthSortMatrices(matrices);
+        if (matrices != cacheIter->second.m_depthSortMatrices) {
+            m_fiberGlyphPrimitives.erase(cacheIter);
+            return false;
+        }
+    }
+    
+    cacheIter->second.m_lastDrawnCounter = ++m_fiberGlyphDrawCounter;
+    
+    GraphicsPrimitive* primitive = cacheIter->second.m_primitive.get();
+    if (primitive != NULL) {
+        GraphicsEngineDataOpenGL::draw(primitive);
+    }
+    
+    return true;
+}
+
+/**
+ * Get the part of the key for batched fiber glyphs that is common to
+ * fiber orientations and fiber trajectories: the display settings,
+ * the slice plane, and the clipping planes.  The caller adds the
+ * files and versions of the fiber data that are drawn.
+ *
+ * @param fodi
+ *    Parameters controlling the drawing of fiber orientations.
+ * @param glyphKeyOut
+ *    Output containing the key.
+ */
+void
+BrainOpenGLFixedPipeline::getFiberOrientationGlyphKey(const FiberOrientationDisplayInfo* fodi,
+                                                      std::vector<uint64_t>& glyphKeyOut) const
+{
+    glyphKeyOut.clear();
+    
+    glyphKeyOut.push_back(static_cast<uint64_t>(fodi->symbolType));
+    glyphKeyOut.push_back(static_cast<uint64_t>(fodi->colorSource->getItemType()));
+    glyphKeyOut.push_back(static_cast<uint64_t>(fodi->colorSource->getCaretColor()));
+    glyphKeyOut.push_back(static_cast<uint64_t>(fodi->fiberOrientationColorType));
+    glyphKeyOut.push_back(fodi->isDrawWithMagnitude ? 1 : 0);
+    glyphKeyOut.push_back(floatToKeyValue(fodi->fanMultiplier));
+    glyphKeyOut.push_back(floatToKeyValue(fodi->minimumMagnitude));
+    glyphKeyOut.push_back(floatToKeyValue(fodi->magnitudeMultiplier));
+    
+    /*
+     * Fibers near the slice are drawn
+     */
+    if (fodi->plane != NULL) {
+        double abcd[4];
+        fodi->plane->getPlane(abcd[0], abcd[1], abcd[2], abcd[3]);
+        glyphKeyOut.push_back(1);
+        for (int32_t i = 0; i < 4; i++) {
+            glyphKeyOut.push_back(doubleToKeyValue(abcd[i]));
+        }
+        glyphKeyOut.push_back(floatToKeyValue(fodi->aboveLimit));
+        glyphKeyOut.push_back(floatToKeyValue(fodi->belowLimit));
+    }
+    else {
+        glyphKeyOut.push_back(0);
+    }
+    
+    /*
+     * Fibers outside the clipping planes are not drawn
+     */
+    if (isFeatureClippingEnabled()) {
+        CaretAssert(m_clippingPlaneGroup);
+        glyphKeyOut.push_back(1);
+        const StructureEnum::Enum clippingStructure = (m_mirroredClippingEnabled
+                                                       ? fodi->structure
+                                                       : StructureEnum::CORTEX_LEFT);
+        const std::vector<const Plane*> planes = m_clippingPlaneGroup->getActiveClippingPlanesForStructure(clippingStructure);
+        glyphKeyOut.push_back(planes.size());
+        for (std::vector<const Plane*>::const_iterator iter = planes.begin();
+             iter != planes.end();
+             iter++) {
+            double abcd[4];
+            (*iter)->getPlane(abcd[0], abcd[1], abcd[2], abcd[3]);
+            for (int32_t i = 0; i < 4; i++) {
+                glyphKeyOut.push_back(doubleToKeyValue(abcd[i]));
+            }
+        }
+    }
+    else {
+        glyphKeyOut.push_back(0);
+    }
+}
+
+/**
+ * Create a primitive containing the symbols for all of the fiber
+ * orientations that are in the list of fiber orientations for drawing.
+ *
+ * @param fodi
+ *    Parameters controlling the drawing of fiber orientations.
+ * @return
+ *    The primitive or NULL if there are no fibers to draw.
+ */
+GraphicsPrimitive*
+BrainOpenGLFixedPipeline::createFiberOrientationGlyphPrimitive(const FiberOrientationDisplayInfo* fodi) const
+{
+    std::unique_ptr<GraphicsPrimitiveV3fC4f> linesPrimitive;
+    std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub> conesPrimitive;
+    int32_t totalNumberOfFibers = 0;
+    for (std::list<FiberOrientation*>::const_iterator iter = m_fiberOrientationsForDrawing.begin();
+         iter != m_fiberOrientationsForDrawing.end();
+         iter++) {
+        totalNumberOfFibers += (*iter)->m_numberOfFibers;
+    }
+    switch (fodi->symbolType) {
+        case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_FANS:
+            conesPrimitive.reset(GraphicsPrimitive::newPrimitiveV3fN3fC4ub(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES));
+            conesPrimitive->setUsageTypeAll(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+            /*
+             * Two cones, each with triangles for its sides and its cap
+             */
+            conesPrimitive->reserveForNumberOfVertices(totalNumberOfFibers * 2 * 2 * 3 * s_fiberGlyphConeNumberOfSides);
+            break;
+        case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_LINES:
+            linesPrimitive.reset(GraphicsPrimitive::newPrimitiveV3fC4f(GraphicsPrimitive::PrimitiveType::OPENGL_LINES));
+            linesPrimitive->setUsageTypeAll(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+            linesPrimitive->setLineWidth(GraphicsPrimitive::LineWidthType::PIXELS, 2.0f);
+            linesPrimitive->reserveForNumberOfVertices(totalNumberOfFibers * 2);
+            break;
+    }
+    
     for (std::list<FiberOrientation*>::const_iterator iter = m_fiberOrientationsForDrawing.begin();
          iter != m_fiberOrientationsForDrawing.end();
          iter++) {
         const FiberOrientation* fiberOrientation = *iter;
 
         /*
-         * Draw each of the fibers
+         * Add each of the fibers
          */
         const int64_t numberOfFibers = fiberOrientation->m_numberOfFibers;
         for (int64_t j = 0; j < numberOfFibers; j++) {
@@ -5222,240 +5440,305 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
             /*
              * Apply display properties
              */
-            bool drawIt = true;
             if (fiber->m_meanF < fodi->minimumMagnitude) {
-                drawIt = false;
+                continue;
             }
             
-            if (drawIt) {
-                float alpha = 1.0;
-                if (j < 3) {
-                    alpha = fiber->m_opacityForDrawing;
-                    CaretAssertMessage(((alpha >= 0.0) && (alpha <= 1.0)),
-                                       ("Value=" + AString::number(alpha)));
-                    if (alpha <= 0.0) {
-                        continue;
-                    }
-                }
-                
-                /*
-                 * Length of vector
-                 */
-                float vectorLength = fodi->magnitudeMultiplier;
-                if (fodi->isDrawWithMagnitude) {
-                    vectorLength *= fiber->m_meanF;
-                }
-                
-                /*
-                 * Vector with magnitude
-                 */
-                const float magnitudeVector[3] = {
-                    fiber->m_directionUnitVector[0] * vectorLength,
-                    fiber->m_directionUnitVector[1] * vectorLength,
-                    fiber->m_directionUnitVector[2] * vectorLength
-                };
-                
-                const float halfMagnitudeVector[3] = {
-                    magnitudeVector[0] * 0.5f,
-                    magnitudeVector[1] * 0.5f,
-                    magnitudeVector[2] * 0.5f,
-                };
-                
-                /*
-                 * Start of vector
-                 */
-                float startXYZ[3] = {
-                    fiberOrientation->m_xyz[0],
-                    fiberOrientation->m_xyz[1],
-                    fiberOrientation->m_xyz[2]
-                };
-                
-                /*
-                 * When drawing lines, start of vector is offset by
-                 * have of the vector length since the vector is
-                 * bi-directional.
-                 */
-                switch (fodi->symbolType) {
-                    case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_FANS:
-                        break;
-                    case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_LINES:
-                        startXYZ[0] -= halfMagnitudeVector[0];
-                        startXYZ[1] -= halfMagnitudeVector[1];
-                        startXYZ[2] -= halfMagnitudeVector[2];
-                        break;
-                }
-                
-                
-                /*
-                 * End of vector
-                 */
-                float endXYZ[3] = { 0.0, 0.0, 0.0 };
-                
-                /*
-                 * When drawing lines, end point is the start
-                 * plus the vector with magnitude.
-                 *
-                 * When drawing fans, there are two endpoints
-                 * with the fans starting in the middle.
-                 */
-                switch (fodi->symbolType) {
-                    case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_FANS:
-                        endXYZ[0] = startXYZ[0] + halfMagnitudeVector[0];
-                        endXYZ[1] = startXYZ[1] + halfMagnitudeVector[1];
-                        endXYZ[2] = startXYZ[2] + halfMagnitudeVector[2];
-                        break;
-                    case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_LINES:
-                        endXYZ[0] = startXYZ[0] + magnitudeVector[0];
-                        endXYZ[1] = startXYZ[1] + magnitudeVector[1];
-                        endXYZ[2] = startXYZ[2] + magnitudeVector[2];
-                        break;
+            float alpha = 1.0;
+            if (j < 3) {
+                alpha = fiber->m_opacityForDrawing;
+                CaretAssertMessage(((alpha >= 0.0) && (alpha <= 1.0)),
+                                   ("Value=" + AString::number(alpha)));
+                if (alpha <= 0.0) {
+                    continue;
                 }
-                
-                float fiberRGBA[4] = { 0.0, 0.0, 0.0, 0.0 };
-                
-                /*
-                 * Color of fiber
-                 */
-                switch (fodi->colorSource->getItemType()) {
-                    case FiberTrajectoryColorModel::Item::ITEM_TYPE_FIBER_ORIENTATION_COLORING_TYPE:
-                        switch (fodi->fiberOrientationColorType) {
-                            case FiberOrientationColoringTypeEnum::FIBER_COLORING_FIBER_INDEX_AS_RGB:
-                            {
-                                const int32_t indx = j % 3;
-                                switch (indx) {
-                                    case 0: /* use RED */
-                                        glColor4f(BrainOpenGLFixedPipeline::COLOR_RED[0],
-                                                  BrainOpenGLFixedPipeline::COLOR_RED[1],
-                                                  BrainOpenGLFixedPipeline::COLOR_RED[2],
-                                                  alpha);
-                                        fiberRGBA[0] = BrainOpenGLFixedPipeline::COLOR_RED[0];
-                                        fiberRGBA[1] = BrainOpenGLFixedPipeline::COLOR_RED[1];
-                                        fiberRGBA[2] = BrainOpenGLFixedPipeline::COLOR_RED[2];
-                                        fiberRGBA[3] = alpha;
-                                        break;
-                                    case 1: /* use BLUE */
-                                        glColor4f(BrainOpenGLFixedPipeline::COLOR_BLUE[0],
-                                                  BrainOpenGLFixedPipeline::COLOR_BLUE[1],
-                                                  BrainOpenGLFixedPipeline::COLOR_BLUE[2],
-                                                  alpha);
-                                        fiberRGBA[0] = BrainOpenGLFixedPipeline::COLOR_BLUE[0];
-                                        fiberRGBA[1] = BrainOpenGLFixedPipeline::COLOR_BLUE[1];
-                                        fiberRGBA[2] = BrainOpenGLFixedPipeline::COLOR_BLUE[2];
-                                        fiberRGBA[3] = alpha;
-                                        break;
-                                    case 2: /* use GREEN */
-                                        glColor4f(BrainOpenGLFixedPipeline::COLOR_GREEN[0],
-                                                  BrainOpenGLFixedPipeline::COLOR_GREEN[1],
-                                                  BrainOpenGLFixedPipeline::COLOR_GREEN[2],
-                                                  alpha);
-                                        fiberRGBA[0] = BrainOpenGLFixedPipeline::COLOR_GREEN[0];
-                                        fiberRGBA[1] = BrainOpenGLFixedPipeline::COLOR_GREEN[1];
-                                        fiberRGBA[2] = BrainOpenGLFixedPipeline::COLOR_GREEN[2];
-                                        fiberRGBA[3] = alpha;
-                                        break;
-                                }
+            }
+            
+            /*
+             * Length of vector
+             */
+            float vectorLength = fodi->magnitudeMultiplier;
+            if (fodi->isDrawWithMagnitude) {
+                vectorLength *= fiber->m_meanF;
+            }
+            
+            /*
+             * Vector with magnitude
+             */
+            const float magnitudeVector[3] = {
+                fiber->m_directionUnitVector[0] * vectorLength,
+                fiber->m_directionUnitVector[1] * vectorLength,
+                fiber->m_directionUnitVector[2] * vectorLength
+            };
+            
+            /*
+             * Start of vector
+             */
+            float startXYZ[3] = {
+                fiberOrientation->m_xyz[0],
+                fiberOrientation->m_xyz[1],
+                fiberOrientation->m_xyz[2]
+            };
+            
+            float fiberRGBA[4] = { 0.0, 0.0, 0.0, alpha };
+            
+            /*
+             * Color of fiber
+             */
+            switch (fodi->colorSource->getItemType()) {
+                case FiberTrajectoryColorModel::Item::ITEM_TYPE_FIBER_ORIENTATION_COLORING_TYPE:
+                    switch (fodi->fiberOrientationColorType) {
+                        case FiberOrientationColoringTypeEnum::FIBER_COLORING_FIBER_INDEX_AS_RGB:
+                        {
+                            const float* rgb = NULL;
+                            const int32_t indx = j % 3;
+                            switch (indx) {
+                                case 0: /* use RED */
+                                    rgb = BrainOpenGLFixedPipeline::COLOR_RED;
+                                    break;
+                                case 1: /* use BLUE */
+                                    rgb = BrainOpenGLFixedPipeline::COLOR_BLUE;
+                                    break;
+                                default: /* use GREEN */
+                                    rgb = BrainOpenGLFixedPipeline::COLOR_GREEN;
+                                    break;
                             }
-                                break;
-                            case FiberOrientationColoringTypeEnum::FIBER_COLORING_XYZ_AS_RGB:
-                                CaretAssert((fiber->m_directionUnitVectorRGB[0] >= 0.0) && (fiber->m_directionUnitVectorRGB[0] <= 1.0));
-                                CaretAssert((fiber->m_directionUnitVectorRGB[1] >= 0.0) && (fiber->m_directionUnitVectorRGB[1] <= 1.0));
-                                CaretAssert((fiber->m_directionUnitVectorRGB[2] >= 0.0) && (fiber->m_directionUnitVectorRGB[2] <= 1.0));
-                                CaretAssert((alpha >= 0.0) && (alpha <= 1.0));
-                                glColor4f(fiber->m_directionUnitVectorRGB[0],
-                                          fiber->m_directionUnitVectorRGB[1],
-                                          fiber->m_directionUnitVectorRGB[2],
-                                          alpha);
-                                fiberRGBA[0] = fiber->m_directionUnitVectorRGB[0];
-                                fiberRGBA[1] = fiber->m_directionUnitVectorRGB[1];
-                                fiberRGBA[2] = fiber->m_directionUnitVectorRGB[2];
-                                fiberRGBA[3] = alpha;
-                                break;
+                            fiberRGBA[0] = rgb[0];
+                            fiberRGBA[1] = rgb[1];
+                            fiberRGBA[2] = rgb[2];
                         }
-                        break;
-                    case FiberTrajectoryColorModel::Item::ITEM_TYPE_CARET_COLOR:
-                    {
-                        const CaretColorEnum::Enum caretColor = fodi->colorSource->getCaretColor();
-                        const float* rgb = CaretColorEnum::toRGB(caretColor);
-                        glColor4f(rgb[0],
-                                  rgb[1],
-                                  rgb[2],
-                                  alpha);
-                        fiberRGBA[0] = rgb[0];
-                        fiberRGBA[1] = rgb[1];
-                        fiberRGBA[2] = rgb[2];
-                        fiberRGBA[3] = alpha;
+                            break;
+                        case FiberOrientationColoringTypeEnum::FIBER_COLORING_XYZ_AS_RGB:
+                            CaretAssert((fiber->m_directionUnitVectorRGB[0] >= 0.0) && (fiber->m_directionUnitVectorRGB[0] <= 1.0));
+                            CaretAssert((fiber->m_directionUnitVectorRGB[1] >= 0.0) && (fiber->m_directionUnitVectorRGB[1] <= 1.0));
+                            CaretAssert((fiber->m_directionUnitVectorRGB[2] >= 0.0) && (fiber->m_directionUnitVectorRGB[2] <= 1.0));
+                            fiberRGBA[0] = fiber->m_directionUnitVectorRGB[0];
+                            fiberRGBA[1] = fiber->m_directionUnitVectorRGB[1];
+                            fiberRGBA[2] = fiber->m_directionUnitVectorRGB[2];
+                            break;
                     }
-                        break;
+                    break;
+                case FiberTrajectoryColorModel::Item::ITEM_TYPE_CARET_COLOR:
+                {
+                    const CaretColorEnum::Enum caretColor = fodi->colorSource->getCaretColor();
+                    const float* rgb = CaretColorEnum::toRGB(caretColor);
+                    fiberRGBA[0] = rgb[0];
+                    fiberRGBA[1] = rgb[1];
+                    fiberRGBA[2] = rgb[2];
                 }
-                
-                /*
-                 * Draw the fiber
-                 */
-                switch (fodi->symbolType) {
-                    case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_FANS:
-                    {
-                        /*
-                         * Draw the cones
-                         */
-                        const float radiansToDegrees = 180.0 / M_PI;
-                        const float majorAxis = std::min((vectorLength
-                                                          * std::tan(fiber->m_fanningMajorAxisAngle)
-                                                          * fodi->fanMultiplier),
-                                                         vectorLength);
-                        const float minorAxis = std::min((vectorLength
-                                                          * std::tan(fiber->m_fanningMinorAxisAngle)
-                                                          * fodi->fanMultiplier),
-                                                         vectorLength);
-                        
-                        /*
-                         * First cone
-                         */
-                        glPushMatrix();
-                        glTranslatef(startXYZ[0], startXYZ[1], startXYZ[2]);
-                        glRotatef(-fiber->m_phi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glRotatef(-fiber->m_theta * radiansToDegrees, 0.0, 1.0, 0.0);
-                        glRotatef(-fiber->m_psi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glScalef(majorAxis * 2.0,
-                                 minorAxis * 2.0,
-                                 vectorLength);
-                        m_shapeCone->draw(fiberRGBA);
-                        glPopMatrix();
-                        
-                        /*
-                         * Second cone but pointing in opposite direction
-                         */
-                        glPushMatrix();
-                        glTranslatef(startXYZ[0], startXYZ[1], startXYZ[2]);
-                        glRotatef(-fiber->m_phi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glRotatef(180.0 -fiber->m_theta * radiansToDegrees, 0.0, 1.0, 0.0);
-                        glRotatef(fiber->m_psi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glScalef(majorAxis * 2.0,
-                                 minorAxis * 2.0,
-                                 vectorLength);
-                        m_shapeCone->draw(fiberRGBA);
-                        glPopMatrix();
-                        
-                    }
-                        break;
-                    case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_LINES:
-                    {
-                        const float radius = 2.0;
-                        setLineWidth(radius);
-                        glBegin(GL_LINES);
-                        glVertex3fv(startXYZ);
-                        glVertex3fv(endXYZ);
-                        glEnd();
-                    }
-                        break;
+                    break;
+            }
+            
+            /*
+             * Add the fiber
+             */
+            switch (fodi->symbolType) {
+                case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_FANS:
+                {
+                    /*
+                     * Two cones, with the second pointing in the
+                     * opposite direction, starting at the fiber's center
+                     */
+                    const float radiansToDegrees = 180.0 / M_PI;
+                    const float majorAxis = std::min((vectorLength
+                                                      * std::tan(fiber->m_fanningMajorAxisAngle)
+                                                      * fodi->fanMultiplier),
+                                                     vectorLength);
+                    const float minorAxis = std::min((vectorLength
+                                                      * std::tan(fiber->m_fanningMinorAxisAngle)
+                                                      * fodi->fanMultiplier),
+                                                     vectorLength);
+                    const uint8_t rgbaByte[4] = {
+                        static_cast<uint8_t>(fiberRGBA[0] * 255.0),
+                        static_cast<uint8_t>(fiberRGBA[1] * 255.0),
+                        static_cast<uint8_t>(fiberRGBA[2] * 255.0),
+                        static_cast<uint8_t>(fiberRGBA[3] * 255.0)
+                    };
+                    
+                    addFiberConeToPrimitive(conesPrimitive.get(),
+                                            startXYZ,
+                                            -fiber->m_phi * radiansToDegrees,
+                                            -fiber->m_theta * radiansToDegrees,
+                                            -fiber->m_psi * radiansToDegrees,
+                                            majorAxis,
+                                            minorAxis,
+                                            vectorLength,
+                                            rgbaByte);
+                    addFiberConeToPrimitive(conesPrimitive.get(),
+                                            startXYZ,
+                                            -fiber->m_phi * radiansToDegrees,
+                                            180.0 - fiber->m_theta * radiansToDegrees,
+                                            fiber->m_psi * radiansToDegrees,
+                                            majorAxis,
+                                            minorAxis,
+                                            vectorLength,
+                                            rgbaByte);
+                }
+                    break;
+                case FiberOrientationSymbolTypeEnum::FIBER_SYMBOL_LINES:
+                {
+                    /*
+                     * Line is bi-directional so it starts at half the
+                     * vector length before the fiber's center
+                     */
+                    startXYZ[0] -= magnitudeVector[0] * 0.5f;
+                    startXYZ[1] -= magnitudeVector[1] * 0.5f;
+                    startXYZ[2] -= magnitudeVector[2] * 0.5f;
+                    const float endXYZ[3] = {
+                        startXYZ[0] + magnitudeVector[0],
+                        startXYZ[1] + magnitudeVector[1],
+                        startXYZ[2] + magnitudeVector[2]
+                    };
+                    linesPrimitive->addVertex(startXYZ,
+                                              fiberRGBA);
+                    linesPrimitive->addVertex(endXYZ,
+                                              fiberRGBA);
                 }
+                    break;
             }
         }
     }
     
+    GraphicsPrimitive* primitive = NULL;
+    if (conesPrimitive) {
+        primitive = conesPrimitive.release();
+    }
+    else if (linesPrimitive) {
+        primitive = linesPrimitive.release();
+    }
+    
+    if (primitive != NULL) {
+        if ( ! primitive->isValid()) {
+            delete primitive;
+            primitive = NULL;
+        }
+    }
+    
+    return primitive;
+}
+
+/**
+ * Add a fiber's cone to a primitive.  The cone's apex is at the given
+ * starting coordinate and it is transformed exactly as it would be by
+ * the OpenGL rotations and scaling previously used to draw each cone.
+ *
+ * @param primitive
+ *    Primitive (triangles with normals and byte colors) to which cone is added.
+ * @param startXYZ
+ *    Location of the cone's apex.
+ * @param phiDegrees
+ *    First rotation, about the Z-axis.
+ * @param thetaDegrees
+ *    Second rotation, about the Y-axis.
+ * @param psiDegrees
+ *    Third rotation, about the Z-axis.
+ * @param majorAxis
+ *    Major axis of the cone's base.
+ * @param minorAxis
+ *    Minor axis of the cone's base.
+ * @param vectorLength
+ *    Length (height) of the cone.
+ * @param rgba
+ *    Color of the cone.
+ */
+void
+BrainOpenGLFixedPipeline::addFiberConeToPrimitive(GraphicsPrimitiveV3fN3fC4ub* primitive,
+                                                  const float startXYZ[3],
+                                                  const double phiDegrees,
+                                                  const double thetaDegrees,
+                                                  const double psiDegrees,
+                                                  const float majorAxis,
+                                                  const float minorAxis,
+                                                  const float vectorLength,
+                                                  const uint8_t rgba[4]) const
+{
+    CaretAssert(primitive);
+    
+    const float scaleX = majorAxis * 2.0;
+    const float scaleY = minorAxis * 2.0;
+    const float scaleZ = vectorLength;
+    
     /*
-     * Now clear the list of fiber orientations for drawing.
+     * Matrix4x4 applies operations in the reverse order of OpenGL
      */
-    m_fiberOrientationsForDrawing.clear();
+    Matrix4x4 coordMatrix;
+    coordMatrix.scale(scaleX, scaleY, scaleZ);
+    coordMatrix.rotateZ(psiDegrees);
+    coordMatrix.rotateY(thetaDegrees);
+    coordMatrix.rotateZ(phiDegrees);
+    coordMatrix.translate(startXYZ[0], startXYZ[1], startXYZ[2]);
+    
+    /*
+     * Normal vectors are transformed by the inverse transpose
+     * which is the rotation with the inverse of the scaling
+     */
+    const float tinyScale = 1.0e-6;
+    Matrix4x4 normalMatrix;
+    normalMatrix.scale(1.0 / std::max(scaleX, tinyScale),
+                       1.0 / std::max(scaleY, tinyScale),
+                       1.0 / std::max(scaleZ, tinyScale));
+    normalMatrix.rotateZ(psiDegrees);
+    normalMatrix.rotateY(thetaDegrees);
+    normalMatrix.rotateZ(phiDegrees);
+    
+    /*
+     * Unit cone with apex at origin, base of diameter one at Z=1
+     */
+    const int32_t numberOfSides = s_fiberGlyphConeNumberOfSides;
+    const float step = (2.0 * M_PI) / numberOfSides;
+    const float radius = 0.5;
+    std::vector<float> baseXYZ(numberOfSides * 3);
+    std::vector<float> sideNormals(numberOfSides * 3);
+    for (int32_t i = 0; i < numberOfSides; i++) {
+        const float t = step * i;
+        const int32_t i3 = i * 3;
+        baseXYZ[i3]   = radius * std::cos(t);
+        baseXYZ[i3+1] = radius * std::sin(t);
+        baseXYZ[i3+2] = 1.0;
+        
+        /*
+         * Perpendicular to the cone's side
+         */
+        sideNormals[i3]   = std::cos(t);
+        sideNormals[i3+1] = std::sin(t);
+        sideNormals[i3+2] = -radius;
+        
+        coordMatrix.multiplyPoint3(&baseXYZ[i3]);
+        normalMatrix.multiplyPoint3X3(&sideNormals[i3]);
+        MathFunctions::normalizeVector(&sideNormals[i3]);
+    }
+    float apexXYZ[3] = { 0.0, 0.0, 0.0 };
+    coordMatrix.multiplyPoint3(apexXYZ);
+    float capCenterXYZ[3] = { 0.0, 0.0, 1.0 };
+    coordMatrix.multiplyPoint3(capCenterXYZ);
+    float capNormal[3] = { 0.0, 0.0, 1.0 };
+    normalMatrix.multiplyPoint3X3(capNormal);
+    MathFunctions::normalizeVector(capNormal);
+    
+    for (int32_t i = 0; i < numberOfSides; i++) {
+        const int32_t i3 = i * 3;
+        const int32_t next3 = ((i + 1) % numberOfSides) * 3;
+        
+        /*
+         * Side triangle with apex using average of edge normals
+         */
+        float apexNormal[3] = {
+            sideNormals[i3]   + sideNormals[next3],
+            sideNormals[i3+1] + sideNormals[next3+1],
+            sideNormals[i3+2] + sideNormals[next3+2]
+        };
+        MathFunctions::normalizeVector(apexNormal);
+        primitive->addVertex(apexXYZ, apexNormal, rgba);
+        primitive->addVertex(&baseXYZ[next3], &sideNormals[next3], rgba);
+        primitive->addVertex(&baseXYZ[i3], &sideNormals[i3], rgba);
+        
+        /*
+         * Cap triangle
+         */
+        primitive->addVertex(capCenterXYZ, capNormal, rgba);
+        primitive->addVertex(&baseXYZ[i3], capNormal, rgba);
+        primitive->addVertex(&baseXYZ[next3], capNormal, rgba);
+    }
 }
 
 /**
@@ -5588,7 +5871,34 @@ BrainOpenGLFixedPipeline::drawFiberTrajectories(const Plane* plane,
                 break;
         }
         
+        /*
+         * Glyphs are only recreated when the loaded trajectories, the
+         * fiber orientations, the slice, or the display settings change
+         */
+        const uint64_t fiberTrajectoryFileKeyType = 1;
+        std::vector<uint64_t> glyphKey;
+        getFiberOrientationGlyphKey(&fiberOrientDispInfo,
+                                    glyphKey);
+        glyphKey.push_back(fiberTrajectoryFileKeyType);
+        glyphKey.push_back(reinterpret_cast<uintptr_t>(trajFile));
+        glyphKey.push_back(trajFile->getDataVersion());
+        const CiftiFiberOrientationFile* matchingFiberOrientationFile = trajFile->getMatchingFiberOrientationFile();
+        glyphKey.push_back(reinterpret_cast<uintptr_t>(matchingFiberOrientationFile));
+        glyphKey.push_back((matchingFiberOrientationFile != NULL)
+                           ? matchingFiberOrientationFile->getDataVersion()
+                           : 0);
+        glyphKey.push_back(static_cast<uint64_t>(displayMode));
+        glyphKey.push_back(floatToKeyValue(streamlineThreshold));
+        glyphKey.push_back(floatToKeyValue(proportionMinimumOpacity));
+        glyphKey.push_back(floatToKeyValue(proportionMaximumOpacity));
+        glyphKey.push_back(floatToKeyValue(countMinimumOpacity));
+        glyphKey.push_back(floatToKeyValue(countMaximumOpacity));
+        glyphKey.push_back(floatToKeyValue(distanceMinimumOpacity));
+        glyphKey.push_back(floatToKeyValue(distanceMaximumOpacity));
         
+        if (drawCachedFiberOrientationGlyphs(glyphKey)) {
+            continue;
+        }
         
         const std::vector<FiberOrientationTrajectory*>& trajectories = trajFile->getLoadedFiberOrientationTrajectories();
         const int64_t numTraj = static_cast<int64_t>(trajectories.size());
@@ -5683,6 +5993,7 @@ BrainOpenGLFixedPipeline::drawFiberTrajectories(const Plane* plane,
         }
         
         drawAllFiberOrientations(&fiberOrientDispInfo,
+                                 glyphKey,
                                  true);
     }
     
@@ -8118,6 +8429,20 @@ BrainOpenGLFixedPipeline::drawStippledBackgroundInAreasOutsideWindowAspectLockin
     }
 }
 
+/**
+ * Allow meshes, such as voxel cubes, to be rebuilt in a background thread
+ * while the previous mesh continues to be drawn.  Only enable when there
+ * is an event loop for updating graphics after a mesh is built.
+ *
+ * @param enabled
+ *    New status.
+ */
+void
+BrainOpenGLFixedPipeline::setBackgroundGraphicsBuildEnabled(const bool enabled)
+{
+    m_backgroundGraphicsBuildEnabled = enabled;
+}
+
 /**
  * @return A string containing the state of OpenGL (depth testing, lighting, etc.)
  */
@@ -22,7 +22,10 @@
  */
 /*LICENSE_END*/
 
+#include <map>
+#include <memory>
 #include <stdint.h>
+#include <tuple>
 
 #include "BrainConstants.h"
 #include "BrainOpenGL.h"
@@ -55,12 +58,15 @@ namespace caret {
     class BrainOpenGLShapeRing;
     class BrainOpenGLShapeSphere;
     class BrainOpenGLViewportContent;
+    class BrainOpenGLVoxelCubeMesh;
     class BrowserTabContent;
     class CaretMappableDataFile;
     class ClippingPlaneGroup;
     class FastStatistics;
     class DisplayPropertiesFiberOrientation;
     class FiberOrientation;
+    class GraphicsPrimitive;
+    class GraphicsPrimitiveV3fN3fC4ub;
     class SelectionItem;
     class SelectionManager;
     class IdentificationWithColor;
@@ -108,6 +114,8 @@ namespace caret {
         
         virtual AString getStateOfOpenGL() const;
         
+        void setBackgroundGraphicsBuildEnabled(const bool enabled);
+        
         static void createSubViewportSizeAndGaps(const int32_t viewportSize,
                                                  const float gapPercentage,
                                                  const int32_t gapOverride,
@@ -258,8 +266,26 @@ namespace caret {
         void sortFiberOrientationsByDepth();
         
         void drawAllFiberOrientations(const FiberOrientationDisplayInfo* fodi,
+                                      const std::vector<uint64_t>& glyphKey,
                                       const bool isSortFibers);
         
+        void getFiberOrientationGlyphKey(const FiberOrientationDisplayInfo* fodi,
+                                         std::vector<uint64_t>& glyphKeyOut) const;
+        
+        bool drawCachedFiberOrientationGlyphs(const std::vector<uint64_t>& glyphKey);
+        
+        GraphicsPrimitive* createFiberOrientationGlyphPrimitive(const FiberOrientationDisplayInfo* fodi) const;
+        
+        void addFiberConeToPrimitive(GraphicsPrimitiveV3fN3fC4ub* primitive,
+                                     const float startXYZ[3],
+                                     const double phiDegrees,
+                                     const double thetaDegrees,
+                                     const double psiDegrees,
+                                     const float majorAxis,
+                                     const float minorAxis,
+                                     const float vectorLength,
+                                     const uint8_t rgba[4]) const;
+        
         void drawSurfaceFiberTrajectories(const StructureEnum::Enum structure);
         
         void drawFiberTrajectories(const Plane* plane,
@@ -280,6 +306,14 @@ namespace caret {
         
         void drawVolumeVoxelsAsCubesWholeBrainTwo(std::vector<VolumeDrawInfo>& volumeDrawInfoIn);
         
+        BrainOpenGLVoxelCubeMesh* getVoxelCubeMesh(const VolumeMappableInterface* volumeFile,
+                                                   const int32_t mapIndex);
+        
+        bool getVoxelCubeMeshColoringKey(const VolumeDrawInfo& volumeDrawInfo,
+                                         const DisplayGroupEnum::Enum displayGroup,
+                                         const bool clippingFlag,
+                                         std::vector<uint64_t>& coloringKeyOut) const;
+        
         void drawVolumeOrthogonalSliceWholeBrain(const VolumeSliceViewPlaneEnum::Enum slicePlane,
                                        const int64_t sliceIndex,
                                        std::vector<VolumeDrawInfo>& volumeDrawInfoIn);
@@ -610,6 +644,35 @@ namespace caret {
         
         std::list<FiberOrientation*> m_fiberOrientationsForDrawing;
         
+        /** A batched fiber glyph primitive and when it was last drawn */
+        struct FiberGlyphPrimitive {
+            std::unique_ptr<GraphicsPrimitive> m_primitive;
+            int64_t m_lastDrawnCounter;
+            /** Modelview and projection matrices the glyphs were sorted by depth for, empty if not sorted */
+            std::vector<double> m_depthSortMatrices;
+        };
+        
+        /** Batched fiber glyph primitives keyed by fiber data, slice, and display settings */
+        std::map<std::vector<uint64_t>, FiberGlyphPrimitive> m_fiberGlyphPrimitives;
+        
+        /** Incremented each time batched fiber glyphs are drawn */
+        int64_t m_fiberGlyphDrawCounter;
+        
+        /** A voxel cube mesh and when it was last drawn */
+        struct VoxelCubeMesh {
+            std::unique_ptr<BrainOpenGLVoxelCubeMesh> m_mesh;
+            int64_t m_lastDrawnCounter;
+        };
+        
+        /** Voxel cube meshes keyed by volume file, map index, and tab index */
+        std::map<std::tuple<const VolumeMappableInterface*, int32_t, int32_t>, VoxelCubeMesh> m_voxelCubeMeshes;
+        
+        /** Incremented each time voxel cubes are drawn */
+        int64_t m_voxelCubeMeshDrawCounter;
+        
+        /** Allows meshes to be rebuilt in a background thread while the previous mesh is drawn */
+        bool m_backgroundGraphicsBuildEnabled;
+        
         double inverseRotationMatrix[16];
         bool inverseRotationMatrixValid;
         
@@ -635,6 +698,15 @@ namespace caret {
 
         static const float s_gluLookAtCenterFromEyeOffsetDistance;
         
+        /** Maximum number of batched fiber glyph primitives that are kept */
+        static const int32_t s_fiberGlyphPrimitiveCacheSize;
+        
+        /** Number of sides in the cones of fiber fans */
+        static const int32_t s_fiberGlyphConeNumberOfSides;
+        
+        /** Maximum number of voxel cube meshes that are kept */
+        static const int32_t s_voxelCubeMeshCacheSize;
+        
         static float COLOR_RED[3];
         static float COLOR_GREEN[3];
         static float COLOR_BLUE[3];
@@ -653,6 +725,9 @@ namespace caret {
     float BrainOpenGLFixedPipeline::COLOR_GREEN[3] = { 0.0, 1.0, 0.0 };
     float BrainOpenGLFixedPipeline::COLOR_BLUE[3]  = { 0.0, 0.0, 1.0 };
     const float BrainOpenGLFixedPipeline::s_gluLookAtCenterFromEyeOffsetDistance = 1.0;
+    const int32_t BrainOpenGLFixedPipeline::s_fiberGlyphPrimitiveCacheSize = 32;
+    const int32_t BrainOpenGLFixedPipeline::s_fiberGlyphConeNumberOfSides = 8;
+    const int32_t BrainOpenGLFixedPipeline::s_voxelCubeMeshCacheSize = 8;
 #endif //__BRAIN_OPENGL_FIXED_PIPELINE_DEFINE_H
 
 } // namespace
@@ -0,0 +1,584 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __BRAIN_OPENGL_VOXEL_CUBE_MESH_DECLARE__
+#include "BrainOpenGLVoxelCubeMesh.h"
+#undef __BRAIN_OPENGL_VOXEL_CUBE_MESH_DECLARE__
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "CaretAssert.h"
+#include "EventGraphicsMeshReady.h"
+#include "EventManager.h"
+#include "GraphicsPrimitiveV3fN3fC4ub.h"
+
+using namespace caret;
+
+/**
+ * Builds the mesh while the previous mesh continues to be drawn.
+ */
+class BrainOpenGLVoxelCubeMesh::BuildThread : public QThread
+{
+public:
+    BuildThread(BrainOpenGLVoxelCubeMesh* voxelCubeMesh)
+    : m_voxelCubeMesh(voxelCubeMesh) { }
+    
+    void run() {
+        m_voxelCubeMesh->runBuild();
+    }
+    
+private:
+    BrainOpenGLVoxelCubeMesh* m_voxelCubeMesh;
+};
+    
+/**
+ * \class caret::BrainOpenGLVoxelCubeMesh 
+ * \brief Mesh of the exposed faces of voxels drawn as cubes.
+ * \ingroup Brain
+ *
+ * Only faces between a drawn voxel and an undrawn voxel (or the edge
+ * of the volume) are created so interior faces, that can never be
+ * seen, are not drawn.  Optionally, adjacent coplanar faces with
+ * the same color are merged into larger rectangles.
+ *
+ * The mesh is kept until its signature changes.  The caller creates
+ * the signature from either the voxel coloring or, so that the voxels
+ * need not be colored to find that the mesh is current, from the
+ * version of the coloring and other state affecting it.  When a mesh
+ * exists and the coloring changes, the new mesh may be built in a
+ * background thread while the old mesh continues to be drawn.
+ */
+
+/**
+ * Constructor.
+ */
+BrainOpenGLVoxelCubeMesh::BrainOpenGLVoxelCubeMesh()
+: CaretObject(),
+m_meshSignature(0),
+m_meshValid(false),
+m_builtMeshSignature(0),
+m_builtMeshReady(false),
+m_buildThreadActive(false)
+{
+    
+}
+
+/**
+ * Destructor.
+ */
+BrainOpenGLVoxelCubeMesh::~BrainOpenGLVoxelCubeMesh()
+{
+    if (m_buildThread.getPointer() != NULL) {
+        m_buildThread->wait();
+    }
+}
+
+/**
+ * Get the mesh for the given voxel coloring.
+ *
+ * @param dimensions
+ *    Dimensions of the volume.
+ * @param originXYZ
+ *    Coordinate of the first voxel.
+ * @param spacingXYZ
+ *    Spacing of the voxels (may be negative).
+ * @param cubeScale
+ *    Scaling of the cube relative to the size of a voxel.
+ * @param mergeFacesFlag
+ *    If true, merge adjacent coplanar faces with the same color.
+ * @param backgroundFlag
+ *    If true and a mesh already exists, a mesh for changed coloring
+ *    is built in a background thread and the existing mesh is returned
+ *    until the new mesh is ready.  An EventGraphicsMeshReady is sent
+ *    when the new mesh is ready.
+ * @param signature
+ *    Signature of everything that affects the mesh (see computeSignature()).
+ * @param voxelRGBA
+ *    RGBA for each voxel, I varies fastest, voxels with zero alpha
+ *    are not drawn.  Contents may be moved to the background build.
+ * @return
+ *    The mesh (may be NULL if there are no voxels to draw).
+ */
+GraphicsPrimitiveV3fN3fC4ub*
+BrainOpenGLVoxelCubeMesh::getMesh(const int64_t dimensions[3],
+                                  const float originXYZ[3],
+                                  const float spacingXYZ[3],
+                                  const float cubeScale,
+                                  const bool mergeFacesFlag,
+                                  const bool backgroundFlag,
+                                  const uint64_t signature,
+                                  std::vector<uint8_t>& voxelRGBA)
+{
+    takeBuiltMesh();
+    
+    if (m_meshValid
+        && (m_meshSignature == signature)) {
+        return m_mesh.get();
+    }
+    
+    if (backgroundFlag
+        && m_meshValid
+        && (QCoreApplication::instance() != NULL)) {
+        QMutexLocker locker(&m_buildMutex);
+        if ( ! m_buildThreadActive) {
+            for (int32_t i = 0; i < 3; i++) {
+                m_buildInput.m_dimensions[i] = dimensions[i];
+                m_buildInput.m_originXYZ[i]  = originXYZ[i];
+                m_buildInput.m_spacingXYZ[i] = spacingXYZ[i];
+            }
+            m_buildInput.m_cubeScale      = cubeScale;
+            m_buildInput.m_mergeFacesFlag = mergeFacesFlag;
+            m_buildInput.m_signature      = signature;
+            m_buildInput.m_voxelRGBA.swap(voxelRGBA);
+            
+            if (m_buildThread.getPointer() == NULL) {
+                m_buildThread.grabNew(new BuildThread(this));
+                
+                /*
+                 * 'finished' is emitted by the build thread so queue it to
+                 * the application's thread where graphics may be updated.
+                 */
+                QObject::connect(m_buildThread.getPointer(), &QThread::finished,
+                                 QCoreApplication::instance(),
+                                 []() {
+                                     EventManager::get()->sendEvent(EventGraphicsMeshReady().getPointer());
+                                 },
+                                 Qt::QueuedConnection);
+            }
+            else {
+                /*
+                 * Previous build has finished but thread may not have exited
+                 */
+                m_buildThread->wait();
+            }
+            m_buildThreadActive = true;
+            m_buildThread->start(QThread::LowPriority);
+        }
+        
+        /*
+         * Draw existing mesh until the new mesh is ready
+         */
+        return m_mesh.get();
+    }
+    
+    m_mesh.reset(createMesh(dimensions,
+                            originXYZ,
+                            spacingXYZ,
+                            cubeScale,
+                            mergeFacesFlag,
+                            voxelRGBA.data()));
+    m_meshSignature = signature;
+    m_meshValid = true;
+    
+    return m_mesh.get();
+}
+
+/**
+ * Get the mesh if it was created with the given signature so that the
+ * caller may avoid coloring the voxels.  While a mesh for the signature
+ * is being built in the background, the existing mesh is provided.
+ *
+ * @param signature
+ *    Signature of everything that affects the mesh (see computeSignature()).
+ * @param meshOut
+ *    Output with the mesh (may be NULL if there are no voxels to draw).
+ * @return
+ *    True if the mesh is valid for the signature, else false and the
+ *    mesh must be obtained with getMesh().
+ */
+bool
+BrainOpenGLVoxelCubeMesh::getCachedMesh(const uint64_t signature,
+                                        GraphicsPrimitiveV3fN3fC4ub*& meshOut)
+{
+    meshOut = NULL;
+    
+    takeBuiltMesh();
+    
+    if ( ! m_meshValid) {
+        return false;
+    }
+    
+    if (m_meshSignature != signature) {
+        QMutexLocker locker(&m_buildMutex);
+        if ( ! m_buildThreadActive) {
+            return false;
+        }
+        if (m_buildInput.m_signature != signature) {
+            return false;
+        }
+    }
+    
+    meshOut = m_mesh.get();
+    return true;
+}
+
+/**
+ * If the build thread has completed a mesh, make it the mesh that is drawn.
+ */
+void
+BrainOpenGLVoxelCubeMesh::takeBuiltMesh()
+{
+    if (m_buildThread.getPointer() != NULL) {
+        QMutexLocker locker(&m_buildMutex);
+        if (m_builtMeshReady) {
+            m_mesh.reset(m_builtMesh.release());
+            m_meshSignature = m_builtMeshSignature;
+            m_meshValid = true;
+            m_builtMeshReady = false;
+        }
+    }
+}
+
+/**
+ * Build the mesh in the background thread.
+ */
+void
+BrainOpenGLVoxelCubeMesh::runBuild()
+{
+    MeshInput input;
+    {
+        QMutexLocker locker(&m_buildMutex);
+        for (int32_t i = 0; i < 3; i++) {
+            input.m_dimensions[i] = m_buildInput.m_dimensions[i];
+            input.m_originXYZ[i]  = m_buildInput.m_originXYZ[i];
+            input.m_spacingXYZ[i] = m_buildInput.m_spacingXYZ[i];
+        }
+        input.m_cubeScale      = m_buildInput.m_cubeScale;
+        input.m_mergeFacesFlag = m_buildInput.m_mergeFacesFlag;
+        input.m_signature      = m_buildInput.m_signature;
+        input.m_voxelRGBA.swap(m_buildInput.m_voxelRGBA);
+    }
+    
+    GraphicsPrimitiveV3fN3fC4ub* mesh = createMesh(input.m_dimensions,
+                                                   input.m_originXYZ,
+                                                   input.m_spacingXYZ,
+                                                   input.m_cubeScale,
+                                                   input.m_mergeFacesFlag,
+                                                   input.m_voxelRGBA.data());
+    
+    QMutexLocker locker(&m_buildMutex);
+    m_builtMesh.reset(mesh);
+    m_builtMeshSignature = input.m_signature;
+    m_builtMeshReady     = true;
+    m_buildThreadActive  = false;
+}
+
+/**
+ * Compute a signature (hash) of everything that affects the mesh.
+ *
+ * @param dimensions
+ *    Dimensions of the volume.
+ * @param originXYZ
+ *    Coordinate of the first voxel.
+ * @param spacingXYZ
+ *    Spacing of the voxels.
+ * @param cubeScale
+ *    Scaling of the cube relative to the size of a voxel.
+ * @param mergeFacesFlag
+ *    If true, merge adjacent coplanar faces with the same color.
+ * @param coloringData
+ *    Data that determines the voxel coloring.  This is either the RGBA
+ *    for each voxel or, when available, a small key that changes whenever
+ *    the coloring changes (such as a coloring version and the state of
+ *    the clipping planes).
+ * @param coloringDataSize
+ *    Number of bytes in the coloring data.
+ * @return
+ *    The signature.
+ */
+uint64_t
+BrainOpenGLVoxelCubeMesh::computeSignature(const int64_t dimensions[3],
+                                           const float originXYZ[3],
+                                           const float spacingXYZ[3],
+                                           const float cubeScale,
+                                           const bool mergeFacesFlag,
+                                           const void* coloringData,
+                                           const int64_t coloringDataSize)
+{
+    /*
+     * Mix eight bytes at a time since the coloring is large
+     */
+    uint64_t hash = 14695981039346656037ULL;
+    auto addWord = [&hash](const uint64_t word) {
+        hash ^= word;
+        hash *= 1099511628211ULL;
+        hash ^= (hash >> 32);
+    };
+    auto addBytes = [&addWord](const void* data, const size_t numberOfBytes) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        size_t i = 0;
+        for ( ; (i + 8) <= numberOfBytes; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            addWord(word);
+        }
+        uint64_t lastWord = 0;
+        std::memcpy(&lastWord, bytes + i, numberOfBytes - i);
+        addWord(lastWord ^ (static_cast<uint64_t>(numberOfBytes) << 56));
+    };
+    
+    const int32_t mergeValue = (mergeFacesFlag ? 1 : 0);
+    addBytes(dimensions, 3 * sizeof(int64_t));
+    addBytes(originXYZ, 3 * sizeof(float));
+    addBytes(spacingXYZ, 3 * sizeof(float));
+    addBytes(&cubeScale, sizeof(cubeScale));
+    addBytes(&mergeValue, sizeof(mergeValue));
+    if (coloringDataSize > 0) {
+        addBytes(coloringData, static_cast<size_t>(coloringDataSize));
+    }
+    
+    return hash;
+}
+
+/**
+ * Create a mesh containing the exposed faces of voxels drawn as cubes.
+ *
+ * @param dimensions
+ *    Dimensions of the volume.
+ * @param originXYZ
+ *    Coordinate of the first voxel.
+ * @param spacingXYZ
+ *    Spacing of the voxels (may be negative).
+ * @param cubeScale
+ *    Scaling of the cube relative to the size of a voxel.
+ * @param mergeFacesFlag
+ *    If true, merge adjacent coplanar faces with the same color.
+ *    Must be false when voxels are colored for identification.
+ * @param voxelRGBA
+ *    RGBA for each voxel, I varies fastest, voxels with zero alpha
+ *    are not drawn.
+ * @return
+ *    The mesh (caller takes ownership).
+ */
+GraphicsPrimitiveV3fN3fC4ub*
+BrainOpenGLVoxelCubeMesh::createMesh(const int64_t dimensions[3],
+                                     const float originXYZ[3],
+                                     const float spacingXYZ[3],
+                                     const float cubeScale,
+                                     const bool mergeFacesFlag,
+                                     const uint8_t* voxelRGBA)
+{
+    GraphicsPrimitiveV3fN3fC4ub* primitive = GraphicsPrimitive::newPrimitiveV3fN3fC4ub(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES);
+    primitive->setUsageTypeAll(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+    
+    const int64_t strides[3] = {
+        4,
+        dimensions[0] * 4,
+        dimensions[0] * dimensions[1] * 4
+    };
+    const float halfSize = cubeScale / 2.0;
+    
+    /*
+     * Faces perpendicular to an axis are in a plane containing
+     * the other two axes, U and V, where U cross V is the axis.
+     */
+    for (int32_t axis = 0; axis < 3; axis++) {
+        const int32_t uAxis = (axis + 1) % 3;
+        const int32_t vAxis = (axis + 2) % 3;
+        const int64_t dimAxis = dimensions[axis];
+        const int64_t dimU    = dimensions[uAxis];
+        const int64_t dimV    = dimensions[vAxis];
+        if ((dimAxis <= 0)
+            || (dimU <= 0)
+            || (dimV <= 0)) {
+            continue;
+        }
+        
+        /*
+         * Packed RGBA of exposed faces in a slice, zero if no face
+         */
+        std::vector<uint32_t> faceMask(dimU * dimV);
+        
+        for (int32_t side = -1; side <= 1; side += 2) {
+            /*
+             * The direction of the face's normal vector depends
+             * upon the sign of the voxel spacing
+             */
+            const float normalSign = ((spacingXYZ[axis] < 0.0) ? -side : side);
+            
+            for (int64_t a = 0; a < dimAxis; a++) {
+                const int64_t neighbor = a + side;
+                const bool neighborInVolume = ((neighbor >= 0)
+                                               && (neighbor < dimAxis));
+                bool haveFacesFlag = false;
+                for (int64_t v = 0; v < dimV; v++) {
+                    for (int64_t u = 0; u < dimU; u++) {
+                        const int64_t offset = ((a * strides[axis])
+                                                + (u * strides[uAxis])
+                                                + (v * strides[vAxis]));
+                        const uint8_t* rgba = &voxelRGBA[offset];
+                        uint32_t faceRGBA = 0;
+                        if (rgba[3] > 0) {
+                            bool exposedFlag = true;
+                            if (neighborInVolume) {
+                                const uint8_t neighborAlpha = voxelRGBA[offset + side * strides[axis] + 3];
+                                exposedFlag = (neighborAlpha == 0);
+                            }
+                            if (exposedFlag) {
+                                /* alpha is not zero so face RGBA is not zero */
+                                std::memcpy(&faceRGBA, rgba, 4);
+                                haveFacesFlag = true;
+                            }
+                        }
+                        faceMask[v * dimU + u] = faceRGBA;
+                    }
+                }
+                if ( ! haveFacesFlag) {
+                    continue;
+                }
+                
+                const float planeCoordinate = originXYZ[axis] + ((a + side * halfSize) * spacingXYZ[axis]);
+                
+                /*
+                 * Create rectangles of faces, greedily extending
+                 * along U and then along V while the color matches
+                 */
+                for (int64_t v = 0; v < dimV; v++) {
+                    for (int64_t u = 0; u < dimU; u++) {
+                        const uint32_t faceRGBA = faceMask[v * dimU + u];
+                        if (faceRGBA == 0) {
+                            continue;
+                        }
+                        
+                        int64_t width  = 1;
+                        int64_t height = 1;
+                        if (mergeFacesFlag) {
+                            while (((u + width) < dimU)
+                                   && (faceMask[v * dimU + u + width] == faceRGBA)) {
+                                width++;
+                            }
+                            bool extendFlag = true;
+                            while (extendFlag
+                                   && ((v + height) < dimV)) {
+                                const uint32_t* row = &faceMask[(v + height) * dimU + u];
+                                for (int64_t w = 0; w < width; w++) {
+                                    if (row[w] != faceRGBA) {
+                                        extendFlag = false;
+                                        break;
+                                    }
+                                }
+                                if (extendFlag) {
+                                    height++;
+                                }
+                            }
+                        }
+                        
+                        for (int64_t h = 0; h < height; h++) {
+                            std::fill(faceMask.begin() + ((v + h) * dimU + u),
+                                      faceMask.begin() + ((v + h) * dimU + u + width),
+                                      0);
+                        }
+                        
+                        const float u1 = originXYZ[uAxis] + ((u - halfSize) * spacingXYZ[uAxis]);
+                        const float u2 = originXYZ[uAxis] + ((u + width - 1 + halfSize) * spacingXYZ[uAxis]);
+                        const float v1 = originXYZ[vAxis] + ((v - halfSize) * spacingXYZ[vAxis]);
+                        const float v2 = originXYZ[vAxis] + ((v + height - 1 + halfSize) * spacingXYZ[vAxis]);
+                        uint8_t rgba[4];
+                        std::memcpy(rgba, &faceRGBA, 4);
+                        addFace(primitive,
+                                axis,
+                                planeCoordinate,
+                                normalSign,
+                                std::min(u1, u2),
+                                std::max(u1, u2),
+                                std::min(v1, v2),
+                                std::max(v1, v2),
+                                rgba);
+                    }
+                }
+            }
+        }
+    }
+    
+    return primitive;
+}
+
+/**
+ * Add a rectangular face, as two triangles, to the mesh.
+ *
+ * @param primitive
+ *    Primitive to which face is added.
+ * @param axis
+ *    Axis perpendicular to the face.
+ * @param planeCoordinate
+ *    Coordinate of the face along the axis.
+ * @param normalSign
+ *    Sign of the face's normal vector along the axis.
+ * @param uMin
+ *    Minimum coordinate along U (axis after 'axis').
+ * @param uMax
+ *    Maximum coordinate along U.
+ * @param vMin
+ *    Minimum coordinate along V (axis before 'axis').
+ * @param vMax
+ *    Maximum coordinate along V.
+ * @param rgba
+ *    Color of the face.
+ */
+void
+BrainOpenGLVoxelCubeMesh::addFace(GraphicsPrimitiveV3fN3fC4ub* primitive,
+                                  const int32_t axis,
+                                  const float planeCoordinate,
+                                  const float normalSign,
+                                  const float uMin,
+                                  const float uMax,
+                                  const float vMin,
+                                  const float vMax,
+                                  const uint8_t rgba[4])
+{
+    const int32_t uAxis = (axis + 1) % 3;
+    const int32_t vAxis = (axis + 2) % 3;
+    
+    float normal[3] = { 0.0, 0.0, 0.0 };
+    normal[axis] = normalSign;
+    
+    float p00[3], p10[3], p11[3], p01[3];
+    p00[axis] = planeCoordinate;  p00[uAxis] = uMin;  p00[vAxis] = vMin;
+    p10[axis] = planeCoordinate;  p10[uAxis] = uMax;  p10[vAxis] = vMin;
+    p11[axis] = planeCoordinate;  p11[uAxis] = uMax;  p11[vAxis] = vMax;
+    p01[axis] = planeCoordinate;  p01[uAxis] = uMin;  p01[vAxis] = vMax;
+    
+    /*
+     * Counter-clockwise when viewed from the side the normal points to
+     */
+    if (normalSign > 0.0) {
+        primitive->addVertex(p00, normal, rgba);
+        primitive->addVertex(p10, normal, rgba);
+        primitive->addVertex(p11, normal, rgba);
+        primitive->addVertex(p00, normal, rgba);
+        primitive->addVertex(p11, normal, rgba);
+        primitive->addVertex(p01, normal, rgba);
+    }
+    else {
+        primitive->addVertex(p00, normal, rgba);
+        primitive->addVertex(p11, normal, rgba);
+        primitive->addVertex(p10, normal, rgba);
+        primitive->addVertex(p00, normal, rgba);
+        primitive->addVertex(p01, normal, rgba);
+        primitive->addVertex(p11, normal, rgba);
+    }
+}
+
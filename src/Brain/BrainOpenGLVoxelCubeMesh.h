@@ -0,0 +1,145 @@
+#ifndef __BRAIN_OPENGL_VOXEL_CUBE_MESH_H__
+#define __BRAIN_OPENGL_VOXEL_CUBE_MESH_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include <QMutex>
+
+#include "CaretObject.h"
+#include "CaretPointer.h"
+
+namespace caret {
+
+    class GraphicsPrimitiveV3fN3fC4ub;
+    
+    class BrainOpenGLVoxelCubeMesh : public CaretObject {
+        
+    public:
+        BrainOpenGLVoxelCubeMesh();
+        
+        virtual ~BrainOpenGLVoxelCubeMesh();
+        
+        GraphicsPrimitiveV3fN3fC4ub* getMesh(const int64_t dimensions[3],
+                                             const float originXYZ[3],
+                                             const float spacingXYZ[3],
+                                             const float cubeScale,
+                                             const bool mergeFacesFlag,
+                                             const bool backgroundFlag,
+                                             const uint64_t signature,
+                                             std::vector<uint8_t>& voxelRGBA);
+        
+        bool getCachedMesh(const uint64_t signature,
+                           GraphicsPrimitiveV3fN3fC4ub*& meshOut);
+        
+        static uint64_t computeSignature(const int64_t dimensions[3],
+                                         const float originXYZ[3],
+                                         const float spacingXYZ[3],
+                                         const float cubeScale,
+                                         const bool mergeFacesFlag,
+                                         const void* coloringData,
+                                         const int64_t coloringDataSize);
+        
+        static GraphicsPrimitiveV3fN3fC4ub* createMesh(const int64_t dimensions[3],
+                                                       const float originXYZ[3],
+                                                       const float spacingXYZ[3],
+                                                       const float cubeScale,
+                                                       const bool mergeFacesFlag,
+                                                       const uint8_t* voxelRGBA);
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        class BuildThread;
+        
+        /** Everything needed to build a mesh in the background */
+        struct MeshInput {
+            int64_t m_dimensions[3];
+            float m_originXYZ[3];
+            float m_spacingXYZ[3];
+            float m_cubeScale;
+            bool m_mergeFacesFlag;
+            uint64_t m_signature;
+            std::vector<uint8_t> m_voxelRGBA;
+        };
+        
+        BrainOpenGLVoxelCubeMesh(const BrainOpenGLVoxelCubeMesh&);
+
+        BrainOpenGLVoxelCubeMesh& operator=(const BrainOpenGLVoxelCubeMesh&);
+        
+        void takeBuiltMesh();
+        
+        static void addFace(GraphicsPrimitiveV3fN3fC4ub* primitive,
+                            const int32_t axis,
+                            const float planeCoordinate,
+                            const float normalSign,
+                            const float uMin,
+                            const float uMax,
+                            const float vMin,
+                            const float vMax,
+                            const uint8_t rgba[4]);
+        
+        void runBuild();
+        
+        /** Mesh that is drawn */
+        std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub> m_mesh;
+        
+        /** Signature of the voxel coloring used to create the mesh */
+        uint64_t m_meshSignature;
+        
+        /** True if the mesh has been created */
+        bool m_meshValid;
+        
+        /** Thread that builds the mesh in the background */
+        CaretPointer<BuildThread> m_buildThread;
+        
+        /** Protects members shared with the build thread */
+        QMutex m_buildMutex;
+        
+        /** Input for the build thread */
+        MeshInput m_buildInput;
+        
+        /** Mesh created by the build thread */
+        std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub> m_builtMesh;
+        
+        /** Signature of the mesh created by the build thread */
+        uint64_t m_builtMeshSignature;
+        
+        /** True if the build thread has created a mesh that has not been taken */
+        bool m_builtMeshReady;
+        
+        /** True while the build thread is running */
+        bool m_buildThreadActive;
+        
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+    
+#ifdef __BRAIN_OPENGL_VOXEL_CUBE_MESH_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __BRAIN_OPENGL_VOXEL_CUBE_MESH_DECLARE__
+
+} // namespace
+#endif  //__BRAIN_OPENGL_VOXEL_CUBE_MESH_H__
@@ -25,8 +25,11 @@
 
 #include "Brain.h"
 #include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "CiftiConnectivityMatrixDenseDynamicFile.h"
 #include "CiftiConnectivityMatrixParcelFile.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
+#include "DataFileException.h"
 #include "EventBrowserTabGetAllViewed.h"
 #include "EventGetDisplayedDataFiles.h"
 #include "EventManager.h"
@@ -38,6 +41,7 @@
 #include "ScenePrimitiveArray.h"
 #include "Surface.h"
 #include "SurfaceFile.h"
+#include "TopologyHelper.h"
 
 using namespace caret;
 
@@ -290,6 +294,21 @@ CiftiConnectivityMatrixDataFileManager::loadDataForSurfaceNode(Brain* brain,
             cmf->updateScalarColoringForMap(mapIndex);
             haveData = true;
             
+            CiftiConnectivityMatrixDenseDynamicFile* denseDynamicFile = dynamic_cast<CiftiConnectivityMatrixDenseDynamicFile*>(cmf);
+            if ((denseDynamicFile != NULL)
+                && (rowIndex >= 0)) {
+                /*
+                 * Nearby vertices are the most likely next seeds when the user
+                 * moves the seed, compute them in the background
+                 */
+                std::vector<int32_t> neighborNodeIndices;
+                surfaceFile->getTopologyHelper()->getNodeNeighborsToDepth(nodeIndex,
+                                                                          2,
+                                                                          neighborNodeIndices);
+                denseDynamicFile->prefetchRowsForSurfaceNodes(surfaceFile->getStructure(),
+                                                              neighborNodeIndices);
+            }
+            
             if (rowIndex >= 0) {
                 /*
                  * Get row/column info for node
@@ -344,26 +363,70 @@ CiftiConnectivityMatrixDataFileManager::loadAverageDataForSurfaceNodes(Brain* br
     getDisplayedConnectivityMatrixFiles(brain,
                                         ciftiMatrixFiles);
     
+    std::vector<CiftiMappableConnectivityMatrixDataFile*> filesToLoad;
+    bool allowParallelFlag = true;
+    getFilesForAverageLoading(ciftiMatrixFiles,
+                              filesToLoad,
+                              allowParallelFlag);
+    
+    /*
+     * Reading the rows dominates, so read the files concurrently
+     * and then update each file's loaded data in order
+     */
+    const int32_t numFiles = static_cast<int32_t>(filesToLoad.size());
+    const int32_t surfaceNumberOfNodes = surfaceFile->getNumberOfNodes();
+    const StructureEnum::Enum structure = surfaceFile->getStructure();
+    std::vector<std::vector<float> > rowAverages(numFiles), columnAverages(numFiles);
+    std::vector<char> readFlags(numFiles, 0);
+    AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic) if (allowParallelFlag)
+    for (int32_t i = 0; i < numFiles; i++) {
+        try {
+            readFlags[i] = filesToLoad[i]->readAverageDataForSurfaceNodes(surfaceNumberOfNodes,
+                                                                         structure,
+                                                                         nodeIndices,
+                                                                         rowAverages[i],
+                                                                         columnAverages[i]);
+        }
+        catch (const DataFileException& dfe) {
+            /*
+             * Empty averages clear the file's loaded data
+             */
+            rowAverages[i].clear();
+            columnAverages[i].clear();
+            readFlags[i] = 1;
+#pragma omp critical
+            {
+                if (errorMessage.isEmpty()) {
+                    errorMessage = dfe.whatString();
+                }
+            }
+        }
+    }
+    
     bool haveData = false;
-    for (std::vector<CiftiMappableConnectivityMatrixDataFile*>::iterator iter = ciftiMatrixFiles.begin();
-         iter != ciftiMatrixFiles.end();
-         iter++) {
-        CiftiMappableConnectivityMatrixDataFile* cmf = *iter;
-        if (cmf->isEmpty() == false) {
-            const int32_t mapIndex = 0;
-            cmf->loadMapAverageDataForSurfaceNodes(mapIndex,
-                                                   surfaceFile->getNumberOfNodes(),
-                                                   surfaceFile->getStructure(),
-                                                   nodeIndices);
-            cmf->updateScalarColoringForMap(mapIndex);
-            haveData = true;
+    for (int32_t i = 0; i < numFiles; i++) {
+        CiftiMappableConnectivityMatrixDataFile* cmf = filesToLoad[i];
+        const int32_t mapIndex = 0;
+        if (readFlags[i]) {
+            cmf->setAverageDataForSurfaceNodes(surfaceNumberOfNodes,
+                                               structure,
+                                               nodeIndices,
+                                               rowAverages[i],
+                                               columnAverages[i]);
         }
+        cmf->updateScalarColoringForMap(mapIndex);
+        haveData = true;
     }
     
     if (haveData) {
         EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
     }
     
+    if ( ! errorMessage.isEmpty()) {
+        throw DataFileException(errorMessage);
+    }
+    
     return haveData;
 }
 
@@ -461,28 +524,104 @@ CiftiConnectivityMatrixDataFileManager::loadAverageDataForVoxelIndices(Brain* br
     getDisplayedConnectivityMatrixFiles(brain,
                                         ciftiMatrixFiles);
     
+    std::vector<CiftiMappableConnectivityMatrixDataFile*> filesToLoad;
+    bool allowParallelFlag = true;
+    getFilesForAverageLoading(ciftiMatrixFiles,
+                              filesToLoad,
+                              allowParallelFlag);
+    
+    /*
+     * Reading the rows dominates, so read the files concurrently
+     * and then update each file's loaded data in order
+     */
+    const int32_t numFiles = static_cast<int32_t>(filesToLoad.size());
+    std::vector<std::vector<float> > rowAverages(numFiles), columnAverages(numFiles);
+    std::vector<char> readFlags(numFiles, 0);
+    AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic) if (allowParallelFlag)
+    for (int32_t i = 0; i < numFiles; i++) {
+        try {
+            readFlags[i] = filesToLoad[i]->readAverageDataForVoxelIndices(volumeDimensionIJK,
+                                                                         voxelIndices,
+                                                                         rowAverages[i],
+                                                                         columnAverages[i]);
+        }
+        catch (const DataFileException& dfe) {
+            /*
+             * Empty averages clear the file's loaded data
+             */
+            rowAverages[i].clear();
+            columnAverages[i].clear();
+            readFlags[i] = 1;
+#pragma omp critical
+            {
+                if (errorMessage.isEmpty()) {
+                    errorMessage = dfe.whatString();
+                }
+            }
+        }
+    }
+    
     bool haveData = false;
-    for (std::vector<CiftiMappableConnectivityMatrixDataFile*>::iterator iter = ciftiMatrixFiles.begin();
+    for (int32_t i = 0; i < numFiles; i++) {
+        CiftiMappableConnectivityMatrixDataFile* cmf = filesToLoad[i];
+        const int32_t mapIndex = 0;
+        if (readFlags[i]) {
+            cmf->setAverageDataForVoxelIndices(volumeDimensionIJK,
+                                               voxelIndices,
+                                               rowAverages[i],
+                                               columnAverages[i]);
+        }
+        haveData = true;
+        
+        cmf->updateScalarColoringForMap(mapIndex);
+    }
+    
+    if (haveData) {
+        EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    }
+    
+    if ( ! errorMessage.isEmpty()) {
+        throw DataFileException(errorMessage);
+    }
+    
+    return haveData;
+}
+
+/**
+ * Get the files that average loading reads from.
+ *
+ * @param ciftiMatrixFiles
+ *    The displayed connectivity matrix files.
+ * @param filesToLoadOut
+ *    Output with the files that are not empty.
+ * @param allowParallelOut
+ *    Output true if the files may be read concurrently, false if
+ *    any of them is read from the network.
+ */
+void
+CiftiConnectivityMatrixDataFileManager::getFilesForAverageLoading(const std::vector<CiftiMappableConnectivityMatrixDataFile*>& ciftiMatrixFiles,
+                                                                  std::vector<CiftiMappableConnectivityMatrixDataFile*>& filesToLoadOut,
+                                                                  bool& allowParallelOut) const
+{
+    filesToLoadOut.clear();
+    allowParallelOut = true;
+    
+    for (std::vector<CiftiMappableConnectivityMatrixDataFile*>::const_iterator iter = ciftiMatrixFiles.begin();
          iter != ciftiMatrixFiles.end();
          iter++) {
         CiftiMappableConnectivityMatrixDataFile* cmf = *iter;
         if (cmf->isEmpty() == false) {
-            const int32_t mapIndex = 0;
-            if (cmf->loadMapAverageDataForVoxelIndices(mapIndex,
-                                                       volumeDimensionIJK,
-                                                       voxelIndices)) {
+            filesToLoadOut.push_back(cmf);
+            if (DataFile::isFileOnNetwork(cmf->getFileName())) {
+                allowParallelOut = false;
             }
-            haveData = true;
-            
-            cmf->updateScalarColoringForMap(mapIndex);
         }
     }
     
-    if (haveData) {
-        EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    if (filesToLoadOut.size() < 2) {
+        allowParallelOut = false;
     }
-    
-    return haveData;
 }
 
 /**
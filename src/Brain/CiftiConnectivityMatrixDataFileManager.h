@@ -89,6 +89,10 @@ namespace caret {
         void getDisplayedConnectivityMatrixFiles(Brain* brain,
                                                  std::vector<CiftiMappableConnectivityMatrixDataFile*>& ciftiMatrixFilesOut) const;
 
+        void getFilesForAverageLoading(const std::vector<CiftiMappableConnectivityMatrixDataFile*>& ciftiMatrixFiles,
+                                       std::vector<CiftiMappableConnectivityMatrixDataFile*>& filesToLoadOut,
+                                       bool& allowParallelOut) const;
+        
         // ADD_NEW_MEMBERS_HERE
     };
     
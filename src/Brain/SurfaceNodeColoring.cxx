@@ -23,6 +23,8 @@
 #include "SurfaceNodeColoring.h"
 #undef __SURFACE_NODE_COLORING_DECLARE__
 
+#include <algorithm>
+
 #include "Brain.h"
 #include "BrainordinateRegionOfInterest.h"
 #include "BrainStructure.h"
@@ -30,6 +32,7 @@
 #include "EventBrowserTabGet.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "CiftiBrainordinateDataSeriesFile.h"
 #include "CiftiBrainordinateLabelFile.h"
@@ -68,6 +71,11 @@
 
 using namespace caret;
 
+namespace
+{
+    const int64_t LAYER_COLORING_CACHE_MAX_BYTES = 256 * (int64_t)(1 << 20);//least recently used layers are dropped beyond about this size
+}
+
 
 /**
  * Constructor.
@@ -359,6 +367,7 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
             }
             
             bool isColoringValid = false;
+            bool thresholdOutlineAppliedFlag = false;
             switch (mapDataFileType) {
                 case DataFileTypeEnum::ANNOTATION:
                     break;
@@ -490,10 +499,12 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
                 case DataFileTypeEnum::METRIC:
                 case DataFileTypeEnum::METRIC_DYNAMIC: // same as metric
                     isColoringValid = this->assignMetricColoring(brainStructure,
+                                                                 surface,
                                                                  dynamic_cast<MetricFile*>(selectedMapFile),
                                                                  selectedMapIndex,
                                                                  numNodes, 
                                                                  overlayRGBV);
+                    thresholdOutlineAppliedFlag = true;
                     break;
                 case DataFileTypeEnum::PALETTE:
                     break;
@@ -518,111 +529,38 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
                     break;
             }
             
-            if (isColoringValid) {
+            if (isColoringValid
+                && ( ! thresholdOutlineAppliedFlag)) {
                 if (selectedMapFile->isMappedWithPalette()) {
                     const PaletteColorMapping* pcm = selectedMapFile->getMapPaletteColorMapping(selectedMapIndex);
                     CaretAssert(pcm);
-                    bool hideDataFlag    = false;
-                    bool showOutlineFlag = false;
-                    const PaletteThresholdOutlineDrawingModeEnum::Enum outlineMode = pcm->getThresholdOutlineDrawingMode();
-                    switch (outlineMode) {
-                        case PaletteThresholdOutlineDrawingModeEnum::OFF:
-                            break;
-                        case PaletteThresholdOutlineDrawingModeEnum::OUTLINE:
-                            hideDataFlag    = true;
-                            showOutlineFlag = true;
-                            break;
-                        case PaletteThresholdOutlineDrawingModeEnum::OUTLINE_AND_DATA:
-                            showOutlineFlag = true;
-                            break;
-                    }
-                    
-                    if (showOutlineFlag) {
-                        const CaretColorEnum::Enum outlineColor = pcm->getThresholdOutlineDrawingColor();
-                        float outlineRGBA[4];
-                        CaretColorEnum::toRGBAFloat(outlineColor, outlineRGBA);
-                        
-                        CaretPointer<TopologyHelper> topologyHelper = surface->getTopologyHelper();
-                        std::vector<float> rgbaCopy(numNodes * 4);
-                        for (int32_t i = 0; i < (numNodes*4); i++) {
-                            rgbaCopy[i] = overlayRGBV[i];
-                        }
-                        for (int32_t i = 0; i < numNodes; i++) {
-                            const int32_t i4 = i * 4;
-                            CaretAssertVectorIndex(rgbaCopy, i4 + 3);
-                            const float alpha = rgbaCopy[i4 + 3];
-                            if (alpha > 0.0 ) {
-                                /*
-                                 * If a node is the same color as all of its neighbors,
-                                 * use the fill color.  Otherwise, use the outline color.
-                                 */
-                                bool isLabelBoundaryNode = false;
-                                int32_t numNeighbors = 0;
-                                const int32_t* allNeighbors = topologyHelper->getNodeNeighbors(i, numNeighbors);
-                                for (int32_t n = 0; n < numNeighbors; n++) {
-                                    const int32_t neighborNodeIndex = allNeighbors[n];
-                                    const int32_t n4 = neighborNodeIndex * 4;
-                                    CaretAssertVectorIndex(rgbaCopy, n4 + 3);
-                                    const float neighborAlpha = rgbaCopy[n4 + 3];
-                                    if (neighborAlpha <= 0.0) {
-                                        isLabelBoundaryNode = true;
-                                        break;
-                                    }
-                                }
-                                CaretAssertArrayIndex(overlayRGBV, numNodes * 4, i4 + 3);
-                                if (isLabelBoundaryNode) {
-                                    overlayRGBV[i4]   = outlineRGBA[0];
-                                    overlayRGBV[i4+1] = outlineRGBA[1];
-                                    overlayRGBV[i4+2] = outlineRGBA[2];
-                                    overlayRGBV[i4+3] = 1.0;
-                                }
-                                else if (hideDataFlag) {
-                                    overlayRGBV[i4+3] = 0.0;
-                                }
-                            }
-                        }
-                    }
+                    applyThresholdOutline(pcm,
+                                          surface,
+                                          numNodes,
+                                          overlayRGBV);
                 }
             }
             
             if (isColoringValid) {
+                /*
+                 * Blend without branches on the color components so that the
+                 * compiler can vectorize the loop.  With full opacity, the
+                 * layer replaces the color.  The first layer has nothing
+                 * to blend with.
+                 */
                 const float opacity = overlay->getOpacity();
-                const float oneMinusOpacity = 1.0 - opacity;
+                const float layerWeight = ((opacity < 1.0) ? opacity : 1.0);
+                const float underWeight = (((opacity < 1.0) && ( ! firstOverlayFlag))
+                                           ? (1.0 - opacity)
+                                           : 0.0);
                 
                 for (int32_t i = 0; i < numNodes; i++) {
                     const int32_t i4 = i * 4;
-                    const float valid = overlayRGBV[i4 + 3];
-                    if (valid > 0.0 ) {
-                        if (opacity < 1.0) {
-                            if (firstOverlayFlag) {
-                                /*
-                                 * When first overlay, there is nothing to 
-                                 * blend with
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity);
-                            }
-                            else {
-                                /*
-                                 * Blend with underlaying colors
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity)
-                                + (rgbaNodeColors[i4] * oneMinusOpacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity)
-                                + (rgbaNodeColors[i4+1] * oneMinusOpacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity)
-                                + (rgbaNodeColors[i4+2] * oneMinusOpacity);
-                            }
-                        }
-                        else {
-                            /*
-                             * No opacity so simple replace coloring
-                             */
-                            rgbaNodeColors[i4] = overlayRGBV[i4];
-                            rgbaNodeColors[i4+1] = overlayRGBV[i4+1];
-                            rgbaNodeColors[i4+2] = overlayRGBV[i4+2];
-                        }
+                    const bool valid = (overlayRGBV[i4 + 3] > 0.0);
+                    for (int32_t j = 0; j < 3; j++) {
+                        const float blended = ((overlayRGBV[i4 + j] * layerWeight)
+                                               + (rgbaNodeColors[i4 + j] * underWeight));
+                        rgbaNodeColors[i4 + j] = (valid ? blended : rgbaNodeColors[i4 + j]);
                     }
                 }
                 
@@ -880,9 +818,13 @@ SurfaceNodeColoring::assignLabelTableColors(const GiftiLabelTable* labelTable,
 }
 
 /**
- * Assign metric coloring to nodes
+ * Assign metric coloring to nodes, including the threshold outline.
+ * Layers that were colored before with the same data and settings
+ * are copied from the layer cache.
  * @param brainStructure
  *    The brain structure that contains the data files.
+ * @param surface
+ *    Surface with the topology for the threshold outline.
  * @param metricFile
  *    Metric file that is selected.
  * @param metricMapUniqueID
@@ -899,6 +841,7 @@ SurfaceNodeColoring::assignLabelTableColors(const GiftiLabelTable* labelTable,
  */
 bool 
 SurfaceNodeColoring::assignMetricColoring(const BrainStructure* brainStructure,
+                                          const Surface* surface,
                                           MetricFile* metricFile,
                                           const int32_t displayColumn,
                                           const int32_t numberOfNodes,
@@ -977,19 +920,331 @@ SurfaceNodeColoring::assignMetricColoring(const BrainStructure* brainStructure,
     }
     CaretAssert(statistics);
     
-    if (statistics != NULL) {
-        NodeAndVoxelColoring::colorScalarsWithPalette(statistics, 
-                                                      paletteColorMapping, 
-                                                      metricDisplayData,
-                                                      thresholdPaletteColorMapping,
-                                                      metricThresholdData, 
-                                                      numberOfNodes, 
-                                                      rgbv);
+    if (statistics == NULL) {
+        applyThresholdOutline(paletteColorMapping,
+                              surface,
+                              numberOfNodes,
+                              rgbv);
+        return true;
+    }
+    
+    /*
+     * Reuse the layer if another tab, or an earlier coloring, has
+     * already colored the same data with the same settings
+     */
+    float paletteMappingRanges[4];
+    paletteColorMapping->getPaletteMappingRanges(statistics,
+                                                 paletteMappingRanges[0],
+                                                 paletteMappingRanges[1],
+                                                 paletteMappingRanges[2],
+                                                 paletteMappingRanges[3]);
+    CaretPointer<TopologyHelper> topologyHelper = surface->getTopologyHelper();
+    const LayerColoring* layerColoring = findLayerColoring(metricFile,
+                                                           displayColumn,
+                                                           topologyHelper,
+                                                           paletteColorMapping,
+                                                           thresholdPaletteColorMapping,
+                                                           paletteMappingRanges,
+                                                           metricDisplayData,
+                                                           metricThresholdData,
+                                                           numberOfNodes);
+    if (layerColoring != NULL) {
+        std::copy(layerColoring->m_rgba.begin(),
+                  layerColoring->m_rgba.end(),
+                  rgbv);
+        return true;
     }
     
+    NodeAndVoxelColoring::colorScalarsWithPalette(statistics, 
+                                                  paletteColorMapping, 
+                                                  metricDisplayData,
+                                                  thresholdPaletteColorMapping,
+                                                  metricThresholdData, 
+                                                  numberOfNodes, 
+                                                  rgbv);
+    applyThresholdOutline(paletteColorMapping,
+                          surface,
+                          numberOfNodes,
+                          rgbv);
+    
+    addLayerColoring(metricFile,
+                     displayColumn,
+                     topologyHelper,
+                     paletteColorMapping,
+                     thresholdPaletteColorMapping,
+                     paletteMappingRanges,
+                     metricDisplayData,
+                     metricThresholdData,
+                     numberOfNodes,
+                     rgbv);
+    
     return true;
 }
 
+/**
+ * Find a cached layer that matches the given coloring inputs.  A
+ * found layer becomes the most recently used.
+ *
+ * @param mapFile
+ *    File of the layer.
+ * @param mapIndex
+ *    Index of the map in the file.
+ * @param topologyHelper
+ *    Topology used for the threshold outline.
+ * @param paletteColorMapping
+ *    Palette color mapping of the map.
+ * @param thresholdPaletteColorMapping
+ *    Palette color mapping providing the thresholds.
+ * @param paletteMappingRanges
+ *    Data values mapped to the ends of the palette.
+ * @param data
+ *    Data of the map.
+ * @param thresholdData
+ *    Data that is thresholded.
+ * @param numberOfNodes
+ *    Number of nodes in surface.
+ * @return
+ *    The matching layer or NULL if there is no match.
+ */
+const SurfaceNodeColoring::LayerColoring*
+SurfaceNodeColoring::findLayerColoring(const CaretMappableDataFile* mapFile,
+                                       const int32_t mapIndex,
+                                       const TopologyHelper* topologyHelper,
+                                       const PaletteColorMapping* paletteColorMapping,
+                                       const PaletteColorMapping* thresholdPaletteColorMapping,
+                                       const float paletteMappingRanges[4],
+                                       const float* data,
+                                       const float* thresholdData,
+                                       const int32_t numberOfNodes)
+{
+    const bool thresholdWithDataFlag = (thresholdData == data);
+    
+    for (std::list<LayerColoring>::iterator iter = m_layerColoringCache.begin();
+         iter != m_layerColoringCache.end();
+         iter++) {
+        const LayerColoring& layer = *iter;
+        if ((layer.m_mapFile != mapFile)
+            || (layer.m_mapIndex != mapIndex)
+            || (layer.m_topologyHelper != topologyHelper)
+            || (static_cast<int32_t>(layer.m_data.size()) != numberOfNodes)
+            || (layer.m_thresholdData.empty() != thresholdWithDataFlag)) {
+            continue;
+        }
+        if ( ! std::equal(paletteMappingRanges,
+                          paletteMappingRanges + 4,
+                          layer.m_paletteMappingRanges)) {
+            continue;
+        }
+        if ((*layer.m_paletteColorMapping != *paletteColorMapping)
+            || (*layer.m_thresholdPaletteColorMapping != *thresholdPaletteColorMapping)) {
+            continue;
+        }
+        
+        /*
+         * Data may have been changed in place, so compare the values
+         */
+        if ( ! std::equal(layer.m_data.begin(),
+                          layer.m_data.end(),
+                          data)) {
+            continue;
+        }
+        if ( ! thresholdWithDataFlag) {
+            if ( ! std::equal(layer.m_thresholdData.begin(),
+                              layer.m_thresholdData.end(),
+                              thresholdData)) {
+                continue;
+            }
+        }
+        
+        m_layerColoringCache.splice(m_layerColoringCache.begin(),
+                                    m_layerColoringCache,
+                                    iter);
+        return &m_layerColoringCache.front();
+    }
+    
+    return NULL;
+}
+
+/**
+ * Add a layer to the cache, replacing any earlier coloring of the
+ * same map and dropping the least recently used layers when the
+ * cache is too large.
+ *
+ * @param mapFile
+ *    File of the layer.
+ * @param mapIndex
+ *    Index of the map in the file.
+ * @param topologyHelper
+ *    Topology used for the threshold outline.
+ * @param paletteColorMapping
+ *    Palette color mapping of the map.
+ * @param thresholdPaletteColorMapping
+ *    Palette color mapping providing the thresholds.
+ * @param paletteMappingRanges
+ *    Data values mapped to the ends of the palette.
+ * @param data
+ *    Data of the map.
+ * @param thresholdData
+ *    Data that is thresholded.
+ * @param numberOfNodes
+ *    Number of nodes in surface.
+ * @param rgbv
+ *    Coloring of the layer.
+ */
+void
+SurfaceNodeColoring::addLayerColoring(const CaretMappableDataFile* mapFile,
+                                      const int32_t mapIndex,
+                                      const CaretPointer<TopologyHelper>& topologyHelper,
+                                      const PaletteColorMapping* paletteColorMapping,
+                                      const PaletteColorMapping* thresholdPaletteColorMapping,
+                                      const float paletteMappingRanges[4],
+                                      const float* data,
+                                      const float* thresholdData,
+                                      const int32_t numberOfNodes,
+                                      const float* rgbv)
+{
+    /*
+     * Other tabs usually display the same settings, so an earlier
+     * coloring of this map is unlikely to be used again
+     */
+    for (std::list<LayerColoring>::iterator iter = m_layerColoringCache.begin();
+         iter != m_layerColoringCache.end(); ) {
+        if ((iter->m_mapFile == mapFile)
+            && (iter->m_mapIndex == mapIndex)
+            && (iter->m_topologyHelper == topologyHelper)) {
+            iter = m_layerColoringCache.erase(iter);
+        }
+        else {
+            iter++;
+        }
+    }
+    
+    m_layerColoringCache.push_front(LayerColoring());
+    LayerColoring& layer = m_layerColoringCache.front();
+    layer.m_mapFile        = mapFile;
+    layer.m_mapIndex       = mapIndex;
+    layer.m_topologyHelper = topologyHelper;
+    layer.m_paletteColorMapping.grabNew(new PaletteColorMapping(*paletteColorMapping));
+    layer.m_thresholdPaletteColorMapping.grabNew(new PaletteColorMapping(*thresholdPaletteColorMapping));
+    std::copy(paletteMappingRanges,
+              paletteMappingRanges + 4,
+              layer.m_paletteMappingRanges);
+    layer.m_data.assign(data,
+                        data + numberOfNodes);
+    if (thresholdData != data) {
+        layer.m_thresholdData.assign(thresholdData,
+                                     thresholdData + numberOfNodes);
+    }
+    layer.m_rgba.assign(rgbv,
+                        rgbv + (numberOfNodes * 4));
+    
+    int64_t cacheBytes = 0;
+    for (std::list<LayerColoring>::iterator iter = m_layerColoringCache.begin();
+         iter != m_layerColoringCache.end(); ) {
+        const int64_t layerBytes = ((iter->m_data.size()
+                                     + iter->m_thresholdData.size()
+                                     + iter->m_rgba.size())
+                                    * sizeof(float));
+        if ((iter != m_layerColoringCache.begin())
+            && ((cacheBytes + layerBytes) > LAYER_COLORING_CACHE_MAX_BYTES)) {
+            iter = m_layerColoringCache.erase(iter);
+        }
+        else {
+            cacheBytes += layerBytes;
+            iter++;
+        }
+    }
+}
+
+/**
+ * Apply the threshold outline drawing mode of a palette mapped layer.
+ * Nodes with color that have a neighbor without color become the
+ * outline color.  Runs in parallel over the nodes' neighbor lists.
+ *
+ * @param paletteColorMapping
+ *    Palette color mapping with the outline drawing mode.
+ * @param surface
+ *    Surface with the topology for neighbors.
+ * @param numberOfNodes
+ *    Number of nodes in surface.
+ * @param rgbv
+ *    Coloring of the layer that is updated.
+ */
+void
+SurfaceNodeColoring::applyThresholdOutline(const PaletteColorMapping* paletteColorMapping,
+                                           const Surface* surface,
+                                           const int32_t numberOfNodes,
+                                           float* rgbv)
+{
+    CaretAssert(paletteColorMapping);
+    bool hideDataFlag    = false;
+    bool showOutlineFlag = false;
+    const PaletteThresholdOutlineDrawingModeEnum::Enum outlineMode = paletteColorMapping->getThresholdOutlineDrawingMode();
+    switch (outlineMode) {
+        case PaletteThresholdOutlineDrawingModeEnum::OFF:
+            break;
+        case PaletteThresholdOutlineDrawingModeEnum::OUTLINE:
+            hideDataFlag    = true;
+            showOutlineFlag = true;
+            break;
+        case PaletteThresholdOutlineDrawingModeEnum::OUTLINE_AND_DATA:
+            showOutlineFlag = true;
+            break;
+    }
+    
+    if ( ! showOutlineFlag) {
+        return;
+    }
+    
+    const CaretColorEnum::Enum outlineColor = paletteColorMapping->getThresholdOutlineDrawingColor();
+    float outlineRGBA[4];
+    CaretColorEnum::toRGBAFloat(outlineColor, outlineRGBA);
+    
+    CaretPointer<TopologyHelper> topologyHelper = surface->getTopologyHelper();
+    const TopologyHelper* topologyHelperPointer = topologyHelper;
+    
+    /*
+     * Neighbors are tested with the alpha before outlining
+     */
+    std::vector<float> alphaCopy(numberOfNodes);
+    for (int32_t i = 0; i < numberOfNodes; i++) {
+        alphaCopy[i] = rgbv[i * 4 + 3];
+    }
+    
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+    for (int32_t i = 0; i < numberOfNodes; i++) {
+        const int32_t i4 = i * 4;
+        CaretAssertVectorIndex(alphaCopy, i);
+        if (alphaCopy[i] > 0.0) {
+            /*
+             * If a node is the same color as all of its neighbors,
+             * use the fill color.  Otherwise, use the outline color.
+             */
+            bool isLabelBoundaryNode = false;
+            int32_t numNeighbors = 0;
+            const int32_t* allNeighbors = topologyHelperPointer->getNodeNeighbors(i, numNeighbors);
+            for (int32_t n = 0; n < numNeighbors; n++) {
+                const int32_t neighborNodeIndex = allNeighbors[n];
+                CaretAssertVectorIndex(alphaCopy, neighborNodeIndex);
+                if (alphaCopy[neighborNodeIndex] <= 0.0) {
+                    isLabelBoundaryNode = true;
+                    break;
+                }
+            }
+            CaretAssertArrayIndex(rgbv, numberOfNodes * 4, i4 + 3);
+            if (isLabelBoundaryNode) {
+                rgbv[i4]   = outlineRGBA[0];
+                rgbv[i4+1] = outlineRGBA[1];
+                rgbv[i4+2] = outlineRGBA[2];
+                rgbv[i4+3] = 1.0;
+            }
+            else if (hideDataFlag) {
+                rgbv[i4+3] = 0.0;
+            }
+        }
+    }
+}
+
 /**
  * Assign cifti scalar coloring to nodes
  * @param brainStructure
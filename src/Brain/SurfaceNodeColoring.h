@@ -22,6 +22,8 @@
 /*LICENSE_END*/
 
 #include <array>
+#include <list>
+#include <vector>
 
 #include "CaretColorEnum.h"
 #include "CaretObject.h"
@@ -34,6 +36,7 @@ namespace caret {
     class Brain;
     class BrainStructure;
     class BrowserTabContent;
+    class CaretMappableDataFile;
     class CiftiMappableConnectivityMatrixDataFile;
     class CiftiBrainordinateDataSeriesFile;
     class CiftiBrainordinateLabelFile;
@@ -146,6 +149,7 @@ namespace caret {
                                                    float* rgbv);
         
         bool assignMetricColoring(const BrainStructure* brainStructure,
+                                  const Surface* surface,
                                   MetricFile* metricFile,
                                   const int32_t mapIndex,
                                   const int32_t numberOfNodes,
@@ -170,6 +174,64 @@ namespace caret {
         void showBrainordinateHighlightRegionOfInterest(const Brain* brain,
                                                         const Surface* surface,
                                                         float* rgbaNodeColors);
+        
+        void applyThresholdOutline(const PaletteColorMapping* paletteColorMapping,
+                                   const Surface* surface,
+                                   const int32_t numberOfNodes,
+                                   float* rgbv);
+        
+        /**
+         * Coloring of a palette mapped overlay layer, including the threshold outline.
+         * The coloring depends only on what is compared here, so a layer is reused
+         * by any tab that displays it until its data or palette settings change.
+         */
+        struct LayerColoring {
+            /** only used to find the layer, never dereferenced */
+            const CaretMappableDataFile* m_mapFile;
+            
+            int32_t m_mapIndex;
+            
+            /** kept so that its address is not reused while in the cache */
+            CaretPointer<TopologyHelper> m_topologyHelper;
+            
+            CaretPointer<PaletteColorMapping> m_paletteColorMapping;
+            
+            CaretPointer<PaletteColorMapping> m_thresholdPaletteColorMapping;
+            
+            /** data values mapped to the ends of the palette */
+            float m_paletteMappingRanges[4];
+            
+            std::vector<float> m_data;
+            
+            /** empty when the data thresholds itself */
+            std::vector<float> m_thresholdData;
+            
+            std::vector<float> m_rgba;
+        };
+        
+        const LayerColoring* findLayerColoring(const CaretMappableDataFile* mapFile,
+                                               const int32_t mapIndex,
+                                               const TopologyHelper* topologyHelper,
+                                               const PaletteColorMapping* paletteColorMapping,
+                                               const PaletteColorMapping* thresholdPaletteColorMapping,
+                                               const float paletteMappingRanges[4],
+                                               const float* data,
+                                               const float* thresholdData,
+                                               const int32_t numberOfNodes);
+        
+        void addLayerColoring(const CaretMappableDataFile* mapFile,
+                              const int32_t mapIndex,
+                              const CaretPointer<TopologyHelper>& topologyHelper,
+                              const PaletteColorMapping* paletteColorMapping,
+                              const PaletteColorMapping* thresholdPaletteColorMapping,
+                              const float paletteMappingRanges[4],
+                              const float* data,
+                              const float* thresholdData,
+                              const int32_t numberOfNodes,
+                              const float* rgbv);
+        
+        /** most recently used first */
+        std::list<LayerColoring> m_layerColoringCache;
     };
     
 #ifdef __SURFACE_NODE_COLORING_DECLARE__
@@ -25,6 +25,7 @@
 #include <QStringList>
 
 #include <algorithm>
+#include <cstring>
 
 using namespace std;
 using namespace caret;
@@ -405,6 +406,131 @@ const vector<int64_t>& CiftiBrainModelsMap::getVoxelList(const StructureEnum::En
     return m_modelsInfo[iter->second].m_voxelIndicesIJK;
 }
 
+const vector<int64_t>& CiftiBrainModelsMap::getNodeToIndexLookup(const StructureEnum::Enum& structure) const
+{
+    map<StructureEnum::Enum, int>::const_iterator iter = m_surfUsed.find(structure);
+    if (iter == m_surfUsed.end())
+    {
+        throw DataFileException("getNodeToIndexLookup called for nonexistant structure");//no reference to return
+    }
+    CaretAssertVectorIndex(m_modelsInfo, iter->second);
+    return m_modelsInfo[iter->second].m_nodeToIndexLookup;
+}
+
+vector<CiftiBrainModelsMap::IndexRange> CiftiBrainModelsMap::getSurfaceRanges(const StructureEnum::Enum& structure) const
+{
+    vector<IndexRange> ret;
+    map<StructureEnum::Enum, int>::const_iterator iter = m_surfUsed.find(structure);
+    if (iter == m_surfUsed.end())
+    {
+        throw DataFileException("getSurfaceRanges called for nonexistant structure");
+    }
+    CaretAssertVectorIndex(m_modelsInfo, iter->second);
+    const BrainModelPriv& myModel = m_modelsInfo[iter->second];
+    int64_t numUsed = (int64_t)myModel.m_nodeIndices.size();
+    for (int64_t i = 0; i < numUsed; ++i)
+    {
+        if (ret.empty() || ret.back().m_elementStart + ret.back().m_count != myModel.m_nodeIndices[i])
+        {
+            IndexRange temp;
+            temp.m_ciftiStart = myModel.m_modelStart + i;
+            temp.m_elementStart = myModel.m_nodeIndices[i];
+            temp.m_count = 1;
+            ret.push_back(temp);
+        } else {
+            ++(ret.back().m_count);//cifti indices within a model are always consecutive
+        }
+    }
+    return ret;
+}
+
+void CiftiBrainModelsMap::getVolumeRanges(const BrainModelPriv& myModel, const int64_t* dims, const int64_t* offset, vector<IndexRange>& rangesOut) const
+{
+    CaretAssert(myModel.m_type == VOXELS);
+    if (dims == NULL) dims = getVolumeSpace().getDims();
+    const int64_t zeros[3] = { 0, 0, 0 };
+    if (offset == NULL) offset = zeros;
+    int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
+    CaretAssert(listSize % 3 == 0);
+    int64_t numUsed = listSize / 3;
+    bool startNew = true;
+    for (int64_t i = 0; i < numUsed; ++i)
+    {
+        int64_t i3 = i * 3;
+        int64_t ijk[3] = { myModel.m_voxelIndicesIJK[i3] - offset[0], myModel.m_voxelIndicesIJK[i3 + 1] - offset[1], myModel.m_voxelIndicesIJK[i3 + 2] - offset[2] };
+        CaretAssert(ijk[0] >= 0 && ijk[0] < dims[0] && ijk[1] >= 0 && ijk[1] < dims[1] && ijk[2] >= 0 && ijk[2] < dims[2]);
+        int64_t element = ijk[0] + dims[0] * (ijk[1] + dims[1] * ijk[2]);
+        if (startNew || rangesOut.back().m_elementStart + rangesOut.back().m_count != element)
+        {//a range may continue onto the next line of voxels, it only needs to be contiguous in memory
+            IndexRange temp;
+            temp.m_ciftiStart = myModel.m_modelStart + i;
+            temp.m_elementStart = element;
+            temp.m_count = 1;
+            rangesOut.push_back(temp);
+            startNew = false;
+        } else {
+            ++(rangesOut.back().m_count);
+        }
+    }
+}
+
+vector<CiftiBrainModelsMap::IndexRange> CiftiBrainModelsMap::getVolumeStructureRanges(const StructureEnum::Enum& structure, const int64_t* dims, const int64_t* offset) const
+{
+    vector<IndexRange> ret;
+    map<StructureEnum::Enum, int>::const_iterator iter = m_volUsed.find(structure);
+    if (iter == m_volUsed.end())
+    {
+        throw DataFileException("getVolumeStructureRanges called for nonexistant structure");
+    }
+    CaretAssertVectorIndex(m_modelsInfo, iter->second);
+    getVolumeRanges(m_modelsInfo[iter->second], dims, offset, ret);
+    return ret;
+}
+
+vector<CiftiBrainModelsMap::IndexRange> CiftiBrainModelsMap::getFullVolumeRanges(const int64_t* dims, const int64_t* offset) const
+{
+    vector<IndexRange> ret;
+    int numModels = (int)m_modelsInfo.size();
+    for (int i = 0; i < numModels; ++i)
+    {
+        if (m_modelsInfo[i].m_type == VOXELS)
+        {
+            getVolumeRanges(m_modelsInfo[i], dims, offset, ret);
+        }
+    }
+    return ret;
+}
+
+void CiftiBrainModelsMap::copyCiftiToElements(const vector<IndexRange>& ranges, const float* ciftiData, float* elementData)
+{
+    int64_t numRanges = (int64_t)ranges.size();
+    for (int64_t i = 0; i < numRanges; ++i)
+    {
+        const IndexRange& thisRange = ranges[i];
+        if (thisRange.m_count == 1)
+        {
+            elementData[thisRange.m_elementStart] = ciftiData[thisRange.m_ciftiStart];
+        } else {
+            memcpy(elementData + thisRange.m_elementStart, ciftiData + thisRange.m_ciftiStart, thisRange.m_count * sizeof(float));
+        }
+    }
+}
+
+void CiftiBrainModelsMap::copyElementsToCifti(const vector<IndexRange>& ranges, const float* elementData, float* ciftiData)
+{
+    int64_t numRanges = (int64_t)ranges.size();
+    for (int64_t i = 0; i < numRanges; ++i)
+    {
+        const IndexRange& thisRange = ranges[i];
+        if (thisRange.m_count == 1)
+        {
+            ciftiData[thisRange.m_ciftiStart] = elementData[thisRange.m_elementStart];
+        } else {
+            memcpy(ciftiData + thisRange.m_ciftiStart, elementData + thisRange.m_elementStart, thisRange.m_count * sizeof(float));
+        }
+    }
+}
+
 bool CiftiBrainModelsMap::hasVolumeData() const
 {
     return (m_volUsed.size() != 0);
@@ -70,6 +70,12 @@ namespace caret
             int64_t m_surfaceNode;//only one of these two will be valid
             int64_t m_ijk[3];
         };
+        struct IndexRange
+        {//consecutive cifti indices that map to consecutive vertices, or to consecutive offsets within a volume frame
+            int64_t m_ciftiStart;
+            int64_t m_elementStart;
+            int64_t m_count;
+        };
         bool hasVolumeData() const;
         bool hasVolumeData(const StructureEnum::Enum& structure) const;
         bool hasSurfaceData(const StructureEnum::Enum& structure) const;
@@ -88,6 +94,17 @@ namespace caret
         const std::vector<int64_t>& getVoxelList(const StructureEnum::Enum& structure) const;
         std::vector<ModelInfo> getModelInfo() const;
         
+        ///bulk index translation, for whole-structure copies without per-element lookups
+        const std::vector<int64_t>& getNodeToIndexLookup(const StructureEnum::Enum& structure) const;//cifti index for every vertex of the structure, -1 if not used
+        std::vector<IndexRange> getSurfaceRanges(const StructureEnum::Enum& structure) const;
+        ///voxel elements are offsets into a frame of dimensions dims, after subtracting offset from the ijk (for cropped volumes), dims defaults to the volume space dimensions
+        std::vector<IndexRange> getVolumeStructureRanges(const StructureEnum::Enum& structure, const int64_t* dims = NULL, const int64_t* offset = NULL) const;
+        std::vector<IndexRange> getFullVolumeRanges(const int64_t* dims = NULL, const int64_t* offset = NULL) const;
+        ///elementData[m_elementStart + i] = ciftiData[m_ciftiStart + i] for every range
+        static void copyCiftiToElements(const std::vector<IndexRange>& ranges, const float* ciftiData, float* elementData);
+        ///ciftiData[m_ciftiStart + i] = elementData[m_elementStart + i] for every range
+        static void copyElementsToCifti(const std::vector<IndexRange>& ranges, const float* elementData, float* ciftiData);
+        
         CiftiBrainModelsMap() { m_haveVolumeSpace = false; m_ignoreVolSpace = false; }
         void addSurfaceModel(const int64_t& numberOfNodes, const StructureEnum::Enum& structure, const float* roi = NULL);
         void addSurfaceModel(const int64_t& numberOfNodes, const StructureEnum::Enum& structure, const std::vector<int64_t>& nodeList);
@@ -126,6 +143,7 @@ namespace caret
         std::map<StructureEnum::Enum, int> m_surfUsed, m_volUsed;
         CaretCompact3DLookup<std::pair<int64_t, StructureEnum::Enum> > m_voxelToIndexLookup;//make one unified lookup rather than separate lookups per volume structure
         int64_t getNextStart() const;
+        void getVolumeRanges(const BrainModelPriv& myModel, const int64_t* dims, const int64_t* offset, std::vector<IndexRange>& rangesOut) const;
         struct ParseHelperModel
         {//specifically to allow the parsed elements to be sorted before using addSurfaceModel/addVolumeModel
             ModelType m_type;
@@ -47,6 +47,7 @@ namespace
                         const int16_t& datatype, const bool& rescale, const double& minval, const double& maxval);//make new empty file with read/write
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;
         const CiftiXML& getCiftiXML() const { return m_xml; }
         QString getFilename() const { return m_nifti.getFilename(); }
         bool isSwapped() const { return m_nifti.getHeader().isSwapped(); }
@@ -63,6 +64,7 @@ namespace
         CiftiMemoryImpl(const CiftiXML& xml);
         void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const;
         void getColumn(float* dataOut, const int64_t& index) const;
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;
         bool isInMemory() const { return true; }
         void setRow(const float* dataIn, const std::vector<int64_t>& indexSelect);
         void setColumn(const float* dataIn, const int64_t& index);
@@ -105,6 +107,16 @@ CiftiFile::ReadImplInterface::~ReadImplInterface()
 {
 }
 
+void CiftiFile::ReadImplInterface::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    vector<int64_t> indexSelect(1);
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        indexSelect[0] = firstRow + i;
+        getRow(dataOut + i * rowLength, indexSelect, false);
+    }
+}
+
 CiftiFile::WriteImplInterface::~WriteImplInterface()
 {
 }
@@ -358,6 +370,16 @@ void CiftiFile::getRow(float* dataOut, const int64_t& index) const
     getRow(dataOut, index, false);//once CiftiInterface is gone, we can collapse this into a default value
 }
 
+void CiftiFile::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows) const
+{
+    if (m_dims.empty()) throw DataFileException("getRows called on uninitialized CiftiFile");
+    if (m_dims.size() != 2) throw DataFileException("getRows called on non-2D CiftiFile");
+    if (firstRow < 0 || numRows < 0 || firstRow + numRows > m_dims[1]) throw DataFileException("getRows called with invalid row range");
+    if (m_readingImpl == NULL) return;//NOT an error because we are pretending to have a matrix already, while we are waiting for setRow to actually start writing the file
+    if (numRows == 0) return;
+    m_readingImpl->getRows(dataOut, firstRow, numRows, m_dims[0]);
+}
+
 int64_t CiftiFile::getNumberOfRows() const
 {
     if (m_dims.empty()) throw DataFileException("getNumberOfRows called on uninitialized CiftiFile");
@@ -445,6 +467,17 @@ void CiftiMemoryImpl::getRow(float* dataOut, const vector<int64_t>& indexSelect,
     }
 }
 
+void CiftiMemoryImpl::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const
+{
+    CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
+    const float* ref = m_array.get(2, vector<int64_t>()) + firstRow * rowLength;
+    int64_t numElems = numRows * rowLength;
+    for (int64_t i = 0; i < numElems; ++i)
+    {
+        dataOut[i] = ref[i];
+    }
+}
+
 void CiftiMemoryImpl::getColumn(float* dataOut, const int64_t& index) const
 {
     CaretAssert(m_array.getDimensions().size() == 2);//otherwise, CiftiFile shouldn't have called this
@@ -711,6 +744,13 @@ void CiftiOnDiskImpl::getColumn(float* dataOut, const int64_t& index) const
     }
 }
 
+void CiftiOnDiskImpl::getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t&) const
+{
+    CaretAssert(m_matrixDims.size() == 2);//otherwise this shouldn't be called
+    vector<int64_t> indexSelect(1, firstRow);
+    m_nifti.readDataRange(dataOut, 5, indexSelect, numRows);//rows are adjacent in the file, so read them all at once
+}
+
 void CiftiOnDiskImpl::setRow(const float* dataIn, const vector<int64_t>& indexSelect)
 {
     m_nifti.writeData(dataIn, 5, indexSelect);
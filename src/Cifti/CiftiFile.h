@@ -82,6 +82,7 @@ namespace caret
         
         void getRow(float* dataOut, const int64_t& index, const bool& tolerateShortRead) const;//backwards compatibility for old CiftiFile/CiftiInterface
         void getRow(float* dataOut, const int64_t& index) const;
+        void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows) const;//for 2D only, consecutive rows, read with a single read if on disk
         int64_t getNumberOfRows() const;
         int64_t getNumberOfColumns() const;
         
@@ -94,6 +95,7 @@ namespace caret
         public:
             virtual void getRow(float* dataOut, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead) const = 0;
             virtual void getColumn(float* dataOut, const int64_t& index) const = 0;
+            virtual void getRows(float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) const;//2D only, default calls getRow for each row
             virtual bool isInMemory() const { return false; }
             virtual ~ReadImplInterface();
         };
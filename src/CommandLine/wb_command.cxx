@@ -30,6 +30,7 @@
 #include "CaretCommandLine.h"
 #include "CaretLogger.h"
 #include "CommandOperationManager.h"
+#include "PerformanceProfile.h"
 #include "ProgramParameters.h"
 #include "SessionManager.h"
 #include "SystemUtilities.h"
@@ -81,6 +82,13 @@ static int runCommand(int argc, char* argv[]) {
         throw;//rethrow, the runtime might print the type
     }
     
+    try {
+        PerformanceProfile::writeProfile(caret_global_commandLine, ret == 0);//does nothing unless -profile was given
+    } catch (CaretException& e) {
+        cerr << "\nERROR: " << e.whatString().toLocal8Bit().constData() << endl << endl;
+        ret = -1;
+    }
+    
     if (commandManager != NULL) {
         CommandOperationManager::deleteCommandOperationManager();
     }
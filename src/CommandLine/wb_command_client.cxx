@@ -0,0 +1,218 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+/*
+ * Sends a command to a running "wb_command -server", along with the working directory,
+ * environment, and standard input/output/error, then exits with the command's exit code.
+ * Runs wb_command directly if no server is listening.  Uses only POSIX, so that it starts quickly.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace std;
+
+namespace
+{
+    //must match CommandServer.cxx
+    const uint32_t REQUEST_MAGIC = 0x57424331;
+    
+    void appendUInt(string& buffer, const uint32_t value)
+    {
+        buffer.append((const char*)&value, sizeof(value));
+    }
+    
+    void appendString(string& buffer, const string& value)
+    {
+        appendUInt(buffer, (uint32_t)value.size());
+        buffer.append(value);
+    }
+    
+    bool writeAll(const int fd, const char* buffer, size_t count)
+    {
+        while (count > 0)
+        {
+            ssize_t result = write(fd, buffer, count);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) return false;
+            buffer += result;
+            count -= result;
+        }
+        return true;
+    }
+    
+    bool readAll(const int fd, char* buffer, size_t count)
+    {
+        while (count > 0)
+        {
+            ssize_t result = read(fd, buffer, count);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) return false;
+            buffer += result;
+            count -= result;
+        }
+        return true;
+    }
+    
+    int connectToServer(const char* socketName)
+    {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (strlen(socketName) >= sizeof(address.sun_path)) return -1;
+        strcpy(address.sun_path, socketName);
+        int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (conn < 0) return -1;
+        if (connect(conn, (sockaddr*)&address, sizeof(address)) != 0)
+        {
+            close(conn);
+            return -1;
+        }
+        return conn;
+    }
+    
+    bool sendDescriptors(const int conn)
+    {
+        char tag = 'W';
+        iovec myIov;
+        myIov.iov_base = &tag;
+        myIov.iov_len = 1;
+        union
+        {
+            cmsghdr m_align;
+            char m_buffer[CMSG_SPACE(3 * sizeof(int))];
+        } control;
+        memset(&control, 0, sizeof(control));
+        msghdr myMessage;
+        memset(&myMessage, 0, sizeof(myMessage));
+        myMessage.msg_iov = &myIov;
+        myMessage.msg_iovlen = 1;
+        myMessage.msg_control = control.m_buffer;
+        myMessage.msg_controllen = sizeof(control.m_buffer);
+        cmsghdr* myControl = CMSG_FIRSTHDR(&myMessage);
+        myControl->cmsg_level = SOL_SOCKET;
+        myControl->cmsg_type = SCM_RIGHTS;
+        myControl->cmsg_len = CMSG_LEN(3 * sizeof(int));
+        const int descriptors[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+        memcpy(CMSG_DATA(myControl), descriptors, sizeof(descriptors));
+        ssize_t result;
+        do
+        {
+            result = sendmsg(conn, &myMessage, 0);
+        } while (result < 0 && errno == EINTR);
+        return result == 1;
+    }
+    
+    int runLocally(const char* clientPath, const int numArgs, char* args[])
+    {
+        vector<char*> myArgv;
+        myArgv.push_back((char*)"wb_command");
+        for (int i = 0; i < numArgs; ++i)
+        {
+            myArgv.push_back(args[i]);
+        }
+        myArgv.push_back(NULL);
+        string clientDir(clientPath);
+        size_t slashPos = clientDir.rfind('/');
+        if (slashPos != string::npos)
+        {//prefer the wb_command installed next to this client
+            string sibling = clientDir.substr(0, slashPos + 1) + "wb_command";
+            if (access(sibling.c_str(), X_OK) == 0)
+            {
+                execv(sibling.c_str(), myArgv.data());
+            }
+        }
+        execvp("wb_command", myArgv.data());
+        cerr << "wb_command_client: no server is listening, and failed to run wb_command: " << strerror(errno) << endl;
+        return 127;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* socketName = getenv("WB_COMMAND_SERVER");
+    int firstArg = 1;
+    if (argc > 2 && strcmp(argv[1], "-socket") == 0)
+    {
+        socketName = argv[2];
+        firstArg = 3;
+    }
+    const bool stopServer = (argc - firstArg == 1 && strcmp(argv[firstArg], "-stop-server") == 0);
+    int conn = -1;
+    if (socketName != NULL && socketName[0] != '\0')
+    {
+        conn = connectToServer(socketName);
+    }
+    if (conn < 0)
+    {
+        if (stopServer)
+        {
+            cerr << "wb_command_client: no server is listening" << endl;
+            return 1;
+        }
+        return runLocally(argv[0], argc - firstArg, argv + firstArg);
+    }
+    string request;
+    appendUInt(request, REQUEST_MAGIC);
+    appendUInt(request, (uint32_t)(argc - firstArg));
+    for (int i = firstArg; i < argc; ++i)
+    {
+        appendString(request, argv[i]);
+    }
+    char* workingDir = getcwd(NULL, 0);
+    if (workingDir == NULL)
+    {
+        cerr << "wb_command_client: failed to get working directory: " << strerror(errno) << endl;
+        return 1;
+    }
+    appendString(request, workingDir);
+    free(workingDir);
+    vector<string> environment;
+    for (char** iter = environ; *iter != NULL; ++iter)
+    {
+        environment.push_back(*iter);
+    }
+    appendUInt(request, (uint32_t)environment.size());
+    for (size_t i = 0; i < environment.size(); ++i)
+    {
+        appendString(request, environment[i]);
+    }
+    int32_t exitCode;
+    if (!sendDescriptors(conn) || !writeAll(conn, request.data(), request.size()) || !readAll(conn, (char*)&exitCode, sizeof(exitCode)))
+    {//once the request may have been received, running it again locally could do the work twice
+        cerr << "wb_command_client: lost connection to server" << endl;
+        close(conn);
+        return 1;
+    }
+    close(conn);
+    return exitCode;
+}
@@ -0,0 +1,234 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CommandInputCache.h"
+
+#include "CaretLogger.h"
+#include "LabelFile.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+
+using namespace caret;
+using namespace std;
+
+CommandInputCache::CommandInputCache(const int64_t& maxBytes)
+{
+    m_maxBytes = maxBytes;
+    m_useCounter = 0;
+}
+
+bool CommandInputCache::getContentHash(const AString& fileName, QByteArray& hashOut)
+{
+    QFileInfo myInfo(fileName);
+    if (!myInfo.isFile()) return false;
+    AString canonical = myInfo.canonicalFilePath();
+    int64_t size = myInfo.size(), modified = myInfo.lastModified().toMSecsSinceEpoch();
+    map<AString, Stamp>::iterator iter = m_stamps.find(canonical);
+    if (iter != m_stamps.end() && iter->second.m_size == size && iter->second.m_modifiedMSecs == modified)
+    {
+        hashOut = iter->second.m_hash;
+        return true;
+    }
+    QFile myFile(canonical);
+    if (!myFile.open(QIODevice::ReadOnly)) return false;
+    QCryptographicHash myHash(QCryptographicHash::Md5);
+    if (!myHash.addData(&myFile)) return false;
+    Stamp& myStamp = m_stamps[canonical];
+    myStamp.m_size = size;
+    myStamp.m_modifiedMSecs = modified;
+    myStamp.m_hash = myHash.result();
+    hashOut = myStamp.m_hash;
+    return true;
+}
+
+template <typename T>
+bool CommandInputCache::getFile(map<QByteArray, Entry<T> >& fileMap, const AString& fileName, CaretPointer<T>& fileOut)
+{
+    CaretMutexLocker locked(&m_mutex);
+    QByteArray myHash;
+    if (!getContentHash(fileName, myHash)) return false;
+    typename map<QByteArray, Entry<T> >::iterator iter = fileMap.find(myHash);
+    if (iter == fileMap.end()) return false;
+    iter->second.m_lastUse = ++m_useCounter;
+    fileOut = iter->second.m_file;
+    fileOut->setFileName(fileName);//same contents may have been read under another name
+    fileOut->clearModified();
+    CaretLogFine("reusing cached input file '" + fileName + "'");
+    return true;
+}
+
+template <typename T>
+void CommandInputCache::setFile(map<QByteArray, Entry<T> >& fileMap, const AString& fileName, const CaretPointer<T>& file, const int64_t& bytes)
+{
+    if (bytes > m_maxBytes) return;
+    CaretMutexLocker locked(&m_mutex);
+    QByteArray myHash;
+    if (!getContentHash(fileName, myHash)) return;
+    Entry<T>& myEntry = fileMap[myHash];
+    myEntry.m_file = file;
+    myEntry.m_bytes = bytes;
+    myEntry.m_lastUse = ++m_useCounter;
+    file->clearModified();//anything that changes it before the end of the command gets it dropped
+}
+
+bool CommandInputCache::getLabel(const AString& fileName, CaretPointer<LabelFile>& fileOut)
+{
+    return getFile(m_labelFiles, fileName, fileOut);
+}
+
+bool CommandInputCache::getMetric(const AString& fileName, CaretPointer<MetricFile>& fileOut)
+{
+    return getFile(m_metricFiles, fileName, fileOut);
+}
+
+bool CommandInputCache::getSurface(const AString& fileName, CaretPointer<SurfaceFile>& fileOut)
+{
+    return getFile(m_surfaceFiles, fileName, fileOut);
+}
+
+bool CommandInputCache::getVolume(const AString& fileName, CaretPointer<VolumeFile>& fileOut)
+{
+    return getFile(m_volumeFiles, fileName, fileOut);
+}
+
+void CommandInputCache::setLabel(const AString& fileName, const CaretPointer<LabelFile>& file)
+{
+    setFile(m_labelFiles, fileName, file, int64_t(file->getNumberOfNodes()) * file->getNumberOfColumns() * sizeof(int32_t));
+}
+
+void CommandInputCache::setMetric(const AString& fileName, const CaretPointer<MetricFile>& file)
+{
+    setFile(m_metricFiles, fileName, file, int64_t(file->getNumberOfNodes()) * file->getNumberOfColumns() * sizeof(float));
+}
+
+void CommandInputCache::setSurface(const AString& fileName, const CaretPointer<SurfaceFile>& file)
+{//count the coordinates and triangles twice, as an allowance for the helpers built later
+    setFile(m_surfaceFiles, fileName, file, 2 * (int64_t(file->getNumberOfNodes()) * 3 * sizeof(float) + int64_t(file->getNumberOfTriangles()) * 3 * sizeof(int32_t)));
+}
+
+void CommandInputCache::setVolume(const AString& fileName, const CaretPointer<VolumeFile>& file)
+{
+    vector<int64_t> dims = file->getDimensions();
+    int64_t bytes = sizeof(float);
+    for (size_t i = 0; i < dims.size(); ++i)
+    {
+        bytes *= dims[i];
+    }
+    setFile(m_volumeFiles, fileName, file, bytes);
+}
+
+template <typename T>
+void CommandInputCache::dropModified(map<QByteArray, Entry<T> >& fileMap)
+{
+    typename map<QByteArray, Entry<T> >::iterator iter = fileMap.begin();
+    while (iter != fileMap.end())
+    {
+        if (iter->second.m_file->isModified())
+        {
+            fileMap.erase(iter++);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+template <typename T>
+int64_t CommandInputCache::sumBytes(const map<QByteArray, Entry<T> >& fileMap)
+{
+    int64_t ret = 0;
+    for (typename map<QByteArray, Entry<T> >::const_iterator iter = fileMap.begin(); iter != fileMap.end(); ++iter)
+    {
+        ret += iter->second.m_bytes;
+    }
+    return ret;
+}
+
+template <typename T>
+bool CommandInputCache::findOldest(map<QByteArray, Entry<T> >& fileMap, int64_t& oldestUse, QByteArray& keyOut)
+{
+    bool ret = false;
+    for (typename map<QByteArray, Entry<T> >::iterator iter = fileMap.begin(); iter != fileMap.end(); ++iter)
+    {
+        if (oldestUse < 0 || iter->second.m_lastUse < oldestUse)
+        {
+            oldestUse = iter->second.m_lastUse;
+            keyOut = iter->first;
+            ret = true;
+        }
+    }
+    return ret;
+}
+
+void CommandInputCache::endCommand()
+{
+    CaretMutexLocker locked(&m_mutex);
+    dropModified(m_labelFiles);
+    dropModified(m_metricFiles);
+    dropModified(m_surfaceFiles);
+    dropModified(m_volumeFiles);
+    int64_t total = sumBytes(m_labelFiles) + sumBytes(m_metricFiles) + sumBytes(m_surfaceFiles) + sumBytes(m_volumeFiles);
+    while (total > m_maxBytes)
+    {
+        int64_t oldestUse = -1;
+        QByteArray key;
+        int which = -1;
+        if (findOldest(m_labelFiles, oldestUse, key)) which = 0;
+        if (findOldest(m_metricFiles, oldestUse, key)) which = 1;
+        if (findOldest(m_surfaceFiles, oldestUse, key)) which = 2;
+        if (findOldest(m_volumeFiles, oldestUse, key)) which = 3;
+        switch (which)
+        {
+            case 0:
+                total -= m_labelFiles[key].m_bytes;
+                m_labelFiles.erase(key);
+                break;
+            case 1:
+                total -= m_metricFiles[key].m_bytes;
+                m_metricFiles.erase(key);
+                break;
+            case 2:
+                total -= m_surfaceFiles[key].m_bytes;
+                m_surfaceFiles.erase(key);
+                break;
+            case 3:
+                total -= m_volumeFiles[key].m_bytes;
+                m_volumeFiles.erase(key);
+                break;
+            default:
+                return;
+        }
+    }
+    if (m_stamps.size() > 4096)//only a shortcut, forgetting it costs one rehash
+    {
+        m_stamps.clear();
+    }
+}
+
+int64_t CommandInputCache::getCachedBytes()
+{
+    CaretMutexLocker locked(&m_mutex);
+    return sumBytes(m_labelFiles) + sumBytes(m_metricFiles) + sumBytes(m_surfaceFiles) + sumBytes(m_volumeFiles);
+}
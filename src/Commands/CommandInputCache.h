@@ -0,0 +1,105 @@
+#ifndef __COMMAND_INPUT_CACHE_H__
+#define __COMMAND_INPUT_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretMutex.h"
+#include "CaretPointer.h"
+
+#include <QByteArray>
+
+#include <map>
+#include <stdint.h>
+
+namespace caret {
+
+    class LabelFile;
+    class MetricFile;
+    class SurfaceFile;
+    class VolumeFile;
+    
+    ///read-only input files kept between the commands run by a wb_command server, keyed by a hash of the file contents,
+    ///so a file that is unchanged on disk is not parsed again, and surfaces keep their topology and geodesic helpers
+    class CommandInputCache
+    {
+    public:
+        explicit CommandInputCache(const int64_t& maxBytes);
+        
+        ///on success, the cached file is renamed to fileName and marked unmodified
+        bool getLabel(const AString& fileName, CaretPointer<LabelFile>& fileOut);
+        bool getMetric(const AString& fileName, CaretPointer<MetricFile>& fileOut);
+        bool getSurface(const AString& fileName, CaretPointer<SurfaceFile>& fileOut);
+        bool getVolume(const AString& fileName, CaretPointer<VolumeFile>& fileOut);
+        
+        ///call right after reading the file
+        void setLabel(const AString& fileName, const CaretPointer<LabelFile>& file);
+        void setMetric(const AString& fileName, const CaretPointer<MetricFile>& file);
+        void setSurface(const AString& fileName, const CaretPointer<SurfaceFile>& file);
+        void setVolume(const AString& fileName, const CaretPointer<VolumeFile>& file);
+        
+        ///drop files that the command changed in memory, then the least recently used files until under the size limit
+        void endCommand();
+        
+        int64_t getCachedBytes();
+    private:
+        template <typename T>
+        struct Entry
+        {
+            CaretPointer<T> m_file;
+            int64_t m_bytes, m_lastUse;
+        };
+        
+        struct Stamp
+        {
+            int64_t m_size, m_modifiedMSecs;
+            QByteArray m_hash;
+        };
+        
+        CaretMutex m_mutex;
+        int64_t m_maxBytes, m_useCounter;
+        std::map<AString, Stamp> m_stamps;//canonical file name to contents hash, so unchanged files are not hashed again
+        std::map<QByteArray, Entry<LabelFile> > m_labelFiles;
+        std::map<QByteArray, Entry<MetricFile> > m_metricFiles;
+        std::map<QByteArray, Entry<SurfaceFile> > m_surfaceFiles;
+        std::map<QByteArray, Entry<VolumeFile> > m_volumeFiles;
+        
+        bool getContentHash(const AString& fileName, QByteArray& hashOut);
+        
+        template <typename T>
+        bool getFile(std::map<QByteArray, Entry<T> >& fileMap, const AString& fileName, CaretPointer<T>& fileOut);
+        
+        template <typename T>
+        void setFile(std::map<QByteArray, Entry<T> >& fileMap, const AString& fileName, const CaretPointer<T>& file, const int64_t& bytes);
+        
+        template <typename T>
+        static void dropModified(std::map<QByteArray, Entry<T> >& fileMap);
+        
+        template <typename T>
+        static int64_t sumBytes(const std::map<QByteArray, Entry<T> >& fileMap);
+        
+        template <typename T>
+        static bool findOldest(std::map<QByteArray, Entry<T> >& fileMap, int64_t& oldestUse, QByteArray& keyOut);
+    };
+    
+}
+
+#endif //__COMMAND_INPUT_CACHE_H__
@@ -66,6 +66,8 @@ CommandOperation::execute(ProgramParameters& parameters, const bool& preventProv
     if (preventProvenance)
     {
         disableProvenance();//let provenance-ignorant commands not need to deal with an unused parameter
+    } else {
+        enableProvenance();
     }
     this->executeOperation(parameters);
 }
@@ -74,6 +76,10 @@ void CommandOperation::disableProvenance()
 {
 }
 
+void CommandOperation::enableProvenance()
+{
+}
+
 void CommandOperation::setCiftiOutputDTypeAndScale(const int16_t&, const double&, const double&)
 {
 }
@@ -66,6 +66,9 @@ namespace caret {
         
         virtual void disableProvenance();
         
+        ///undoes disableProvenance, for when the same instance runs another command (wb_command -server)
+        virtual void enableProvenance();
+        
         CommandOperation(const AString& commandLineSwitch,
                          const AString& operationShortDescription);
         
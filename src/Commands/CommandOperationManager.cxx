@@ -236,7 +236,11 @@
 #include "AlgorithmException.h"
 #include "ApplicationInformation.h"
 #include "CommandParser.h"
+#include "CommandPipeline.h"
+#include "CommandServer.h"
+#include "GiftiFile.h"
 #include "OperationException.h"
+#include "PerformanceProfile.h"
 
 #include "CommandClassAddMember.h"
 #include "CommandClassCreate.h"
@@ -498,6 +502,8 @@ CommandOperationManager::CommandOperationManager()
     this->commandOperations.push_back(new CommandClassCreateAlgorithm());
     this->commandOperations.push_back(new CommandClassCreateEnum());
     this->commandOperations.push_back(new CommandClassCreateOperation());
+    this->commandOperations.push_back(new CommandPipeline());
+    this->commandOperations.push_back(new CommandServer());
 #ifdef WORKBENCH_HAVE_C11X
     this->commandOperations.push_back(new CommandC11xTesting());
 #endif // WORKBENCH_HAVE_C11X
@@ -578,6 +584,10 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         if (!valid) throw CommandException("unrecognized logging level: '" + globalOptionArgs[0] + "'");
         CaretLogger::getLogger()->setLevel(level);
     }
+    if (getGlobalOption(parameters, "-profile", 1, globalOptionArgs))
+    {
+        PerformanceProfile::enable(globalOptionArgs[0]);
+    }
     if (getGlobalOption(parameters, "-simd", 1, globalOptionArgs))
     {
         bool valid = false;
@@ -589,6 +599,23 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
         }
     }
+    GiftiEncodingEnum::Enum giftiEncoding = GiftiEncodingEnum::GZIP_BASE64_BINARY;
+    int32_t giftiCompressionLevel = -1;
+    if (getGlobalOption(parameters, "-gifti-output-compression", 1, globalOptionArgs))
+    {
+        bool valid = false;
+        giftiCompressionLevel = globalOptionArgs[0].toInt(&valid);
+        if (!valid || giftiCompressionLevel < 0 || giftiCompressionLevel > 9)
+        {
+            throw CommandException("-gifti-output-compression requires an integer from 0 to 9, got '" + globalOptionArgs[0] + "'");
+        }
+        if (giftiCompressionLevel == 0)
+        {
+            giftiEncoding = GiftiEncodingEnum::BASE64_BINARY;
+        }
+    }
+    GiftiFile::setDefaultEncodingForWriting(giftiEncoding);//set every time, so they don't carry over to later commands of -pipeline or -server
+    GiftiFile::setCompressionLevelForWriting(giftiCompressionLevel);
     int16_t ciftiDType = NIFTI_TYPE_FLOAT32, niftiDType = NIFTI_TYPE_FLOAT32;
     bool ciftiScale = false, niftiScale = false;
     double ciftiMin = -1.0, ciftiMax = -1.0, niftiMin = -1.0, niftiMax = -1.0;
@@ -729,6 +756,11 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         }
         return ret;
     }
+    OptionInfo profileInfo = parseGlobalOption(parameters, "-profile", 1, globalOptionArgs, true);
+    if (profileInfo.specified && !profileInfo.complete)
+    {
+        return "fileglob *";
+    }
     OptionInfo simdInfo = parseGlobalOption(parameters, "-simd", 1, globalOptionArgs, true);//the previous option doesn't take arguments, doesn't need completion testing
     if (simdInfo.specified && !simdInfo.complete)
     {//user is tab completing the logging option, and as it only takes one argument, we know what the completions are
@@ -741,6 +773,11 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
         }
         return ret;
     }
+    OptionInfo giftiCompressionInfo = parseGlobalOption(parameters, "-gifti-output-compression", 1, globalOptionArgs, true);
+    if (giftiCompressionInfo.specified && !giftiCompressionInfo.complete)
+    {
+        return "wordlist 0\\ 1\\ 2\\ 3\\ 4\\ 5\\ 6\\ 7\\ 8\\ 9";
+    }
     OptionInfo ciftiDTypeInfo = parseGlobalOption(parameters, "-cifti-output-datatype", 1, globalOptionArgs, true);
     if (ciftiDTypeInfo.specified && !ciftiDTypeInfo.complete)
     {
@@ -761,7 +798,7 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
     {
         return "";
     }
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range\\ -nifti-output-datatype\\ -nifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    ret = "wordlist -disable-provenance\\ -logging\\ -profile\\ -simd\\ -gifti-output-compression\\ -cifti-output-datatype\\ -cifti-output-range\\ -nifti-output-datatype\\ -nifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
@@ -1151,6 +1188,16 @@ void CommandOperationManager::printGlobalOptions()
     }
     cout << endl;//add a line after the logging types for readability
     //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -profile <file>                   write a JSON performance profile of the" << endl;
+    cout << "                                        run to <file>: time and cpu use of each" << endl;
+    cout << "                                        phase (parsing, computing, writing," << endl;
+    cout << "                                        surface helper construction), sizes and" << endl;
+    cout << "                                        times of files read and written, peak" << endl;
+    cout << "                                        memory, and thread utilization" << endl;
+    cout << "                                        (in-memory -pipeline files are marked" << endl;
+    cout << "                                        as in memory, with no bytes counted)" << endl;
+    cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
     cout << "   -simd <type>                      set the SIMD implementation to use" << endl;
     cout << "                                        (currently used only for correlation," << endl;
     cout << "                                        default AUTO which selects fastest" << endl;
@@ -1162,6 +1209,12 @@ void CommandOperationManager::printGlobalOptions()
         cout << "         " << DotSIMDEnum::toName(*iter) << endl;
     }
     cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -gifti-output-compression <level> zlib compression level for gifti outputs," << endl;
+    cout << "                                        from 1 (fastest) to 9 (smallest), or 0" << endl;
+    cout << "                                        to write uncompressed Base64Binary" << endl;
+    cout << "                                        (default 6)" << endl;
+    cout << endl;
     cout << "   -cifti-output-datatype <type>     deprecated, only affects cifti outputs" << endl;
     cout << "   -cifti-output-range <min> <max>   deprecated, only affects cifti outputs" << endl;
     cout << endl;
@@ -29,6 +29,8 @@
 #include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
 #include "CiftiFile.h"
+#include "CommandInputCache.h"
+#include "CommandPipelineFiles.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "FociFile.h"
@@ -36,6 +38,7 @@
 #include "LabelFile.h"
 #include "MetricFile.h"
 #include "OperationException.h"
+#include "PerformanceProfile.h"
 #include "SurfaceFile.h"
 #include "VolumeFile.h"
 
@@ -46,10 +49,28 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    bool isFileType(const OperationParametersEnum::Enum type)
+    {
+        switch (type)
+        {
+            case OperationParametersEnum::BOOL:
+            case OperationParametersEnum::DOUBLE:
+            case OperationParametersEnum::INT:
+            case OperationParametersEnum::STRING:
+                return false;
+            default:
+                return true;
+        }
+    }
+}
+
 const AString CommandParser::PROVENANCE_NAME = "Provenance";
 const AString CommandParser::PARENT_PROVENANCE_NAME = "ParentProvenance";
 const AString CommandParser::PROGRAM_PROVENANCE_NAME = "ProgramProvenance";
 const AString CommandParser::CWD_PROVENANCE_NAME = "WorkingDirectory";
+CommandInputCache* CommandParser::s_inputCache = NULL;
 
 CommandParser::CommandParser(AutoOperationInterface* myAutoOper) :
     CommandOperation(myAutoOper->getCommandSwitch(), myAutoOper->getShortDescription()),
@@ -60,6 +81,7 @@ CommandParser::CommandParser(AutoOperationInterface* myAutoOper) :
     m_volumeDType = m_ciftiDType = NIFTI_TYPE_FLOAT32;
     m_volumeMax = m_ciftiMax = -1.0;//these values won't get used, but don't leave them uninitialized
     m_volumeMin = m_ciftiMin = -1.0;
+    m_pipelineFiles = NULL;
 }
 
 void CommandParser::disableProvenance()
@@ -67,6 +89,16 @@ void CommandParser::disableProvenance()
     m_doProvenance = false;
 }
 
+void CommandParser::enableProvenance()
+{
+    m_doProvenance = true;
+}
+
+void CommandParser::setInputCache(CommandInputCache* inputCache)
+{
+    s_inputCache = inputCache;
+}
+
 void CommandParser::setCiftiOutputDTypeAndScale(const int16_t& dtype, const double& minVal, const double& maxVal)
 {
     m_ciftiDType = dtype;
@@ -103,18 +135,30 @@ void CommandParser::executeOperation(ProgramParameters& parameters)
 {
     CaretPointer<OperationParameters> myAlgParams(m_autoOper->getParameters());//could be an autopointer, but this is safer
     vector<OutputAssoc> myOutAssoc;
-    m_provenance = caret_global_commandLine;
+    m_inputCiftiNames.clear();//don't keep pointers to files from a previous pipeline step
+    if (m_pipelineFiles != NULL)
+    {
+        m_provenance = m_pipelineCommandLine;
+    } else {
+        m_provenance = caret_global_commandLine;
+    }
     //the idea is to have m_provenance set before the command executes, so it can be overridden, but have m_parentProvenance set AFTER the processing is complete
     //the parent provenance should never be generated manually
     m_parentProvenance = "";//in case someone tries to use the same instance more than once
     m_workingDir = QDir::currentPath();//get the current path, in case some stupid command changes the working directory
     //these get set on output files during writeOutput (and for on-disk in provenanceBeforeOperation)
-    parseComponent(myAlgParams.getPointer(), parameters, myOutAssoc);//parsing block
-    parameters.verifyAllParametersProcessed();
-    makeOnDiskOutputs(myOutAssoc);//check for input on-disk files used as output on-disk files
+    {
+        PerformanceProfile::PhaseTimer phaseTimer(getCommandLineSwitch() + " parse");//includes reading input files
+        parseComponent(myAlgParams.getPointer(), parameters, myOutAssoc);//parsing block
+        parameters.verifyAllParametersProcessed();
+        makeOnDiskOutputs(myOutAssoc);//check for input on-disk files used as output on-disk files
+    }
     //code to show what arguments map to what parameters should go here
     if (m_doProvenance) provenanceBeforeOperation(myOutAssoc);
-    m_autoOper->useParameters(myAlgParams.getPointer(), NULL);//TODO: progress status for caret_command? would probably get messed up by any command info output
+    {
+        PerformanceProfile::PhaseTimer phaseTimer(getCommandLineSwitch() + " compute");
+        m_autoOper->useParameters(myAlgParams.getPointer(), NULL);//TODO: progress status for caret_command? would probably get messed up by any command info output
+    }
     vector<AString> uncheckedWarnings = myAlgParams->findUncheckedParams("the command");
     for (size_t i = 0; i < uncheckedWarnings.size(); ++i)
     {
@@ -122,9 +166,25 @@ void CommandParser::executeOperation(ProgramParameters& parameters)
     }
     if (m_doProvenance) provenanceAfterOperation(myOutAssoc);
     //TODO: deallocate input files - give abstract parameter a virtual deallocate method? use CaretPointer and rely on reference counting?
+    PerformanceProfile::PhaseTimer phaseTimer(getCommandLineSwitch() + " write");
     writeOutput(myOutAssoc);
 }
 
+void CommandParser::executePipelineStep(ProgramParameters& parameters, CommandPipelineFiles* pipelineFiles, const AString& stepCommandLine)
+{
+    CaretAssert(pipelineFiles != NULL);
+    m_pipelineFiles = pipelineFiles;
+    m_pipelineCommandLine = stepCommandLine;
+    try
+    {
+        executeOperation(parameters);
+    } catch (...) {
+        m_pipelineFiles = NULL;
+        throw;
+    }
+    m_pipelineFiles = NULL;
+}
+
 void CommandParser::showParsedOperation(ProgramParameters& parameters)
 {
     CaretPointer<OperationParameters> myAlgParams(m_autoOper->getParameters());//could be an autopointer, but this is safer
@@ -168,6 +228,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
             }
         }
         const OperationParametersEnum::Enum nextType = myComponent->m_paramList[i]->getType();// need in catch statement below
+        const double readStartSeconds = (PerformanceProfile::isEnabled() ? PerformanceProfile::getWallSeconds() : 0.0);
         try {
             switch (myComponent->m_paramList[i]->getType())
             {
@@ -232,6 +293,16 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::CIFTI:
                 {
+                    if (m_pipelineFiles != NULL && CommandPipelineFiles::isInMemoryName(nextArg))
+                    {
+                        CaretPointer<CiftiFile>& myFile = ((CiftiParameter*)myComponent->m_paramList[i])->m_parameter;
+                        if (!m_pipelineFiles->getCifti(nextArg, myFile))
+                        {
+                            throw ProgramParametersException("in-memory cifti file '" + nextArg + "' was not created by an earlier step");
+                        }
+                        if (m_doProvenance) addParentProvenance(nextArg, myFile->getCiftiXML().getFileMetaData());
+                        break;
+                    }
                     FileInformation myInfo(nextArg);
                     CaretPointer<CiftiFile> myFile(new CiftiFile());
                     myFile->openFile(nextArg);
@@ -307,8 +378,23 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::LABEL:
                 {
-                    CaretPointer<LabelFile> myFile(new LabelFile());
-                    myFile->readFile(nextArg);
+                    if (m_pipelineFiles != NULL && CommandPipelineFiles::isInMemoryName(nextArg))
+                    {
+                        CaretPointer<LabelFile>& myFile = ((LabelParameter*)myComponent->m_paramList[i])->m_parameter;
+                        if (!m_pipelineFiles->getLabel(nextArg, myFile))
+                        {
+                            throw ProgramParametersException("in-memory label file '" + nextArg + "' was not created by an earlier step");
+                        }
+                        if (m_doProvenance) addParentProvenance(nextArg, myFile->getFileMetaData());
+                        break;
+                    }
+                    CaretPointer<LabelFile> myFile;
+                    if (s_inputCache == NULL || !s_inputCache->getLabel(nextArg, myFile))
+                    {
+                        myFile.grabNew(new LabelFile());
+                        myFile->readFile(nextArg);
+                        if (s_inputCache != NULL) s_inputCache->setLabel(nextArg, myFile);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -331,8 +417,23 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::METRIC:
                 {
-                    CaretPointer<MetricFile> myFile(new MetricFile());
-                    myFile->readFile(nextArg);
+                    if (m_pipelineFiles != NULL && CommandPipelineFiles::isInMemoryName(nextArg))
+                    {
+                        CaretPointer<MetricFile>& myFile = ((MetricParameter*)myComponent->m_paramList[i])->m_parameter;
+                        if (!m_pipelineFiles->getMetric(nextArg, myFile))
+                        {
+                            throw ProgramParametersException("in-memory metric file '" + nextArg + "' was not created by an earlier step");
+                        }
+                        if (m_doProvenance) addParentProvenance(nextArg, myFile->getFileMetaData());
+                        break;
+                    }
+                    CaretPointer<MetricFile> myFile;
+                    if (s_inputCache == NULL || !s_inputCache->getMetric(nextArg, myFile))
+                    {
+                        myFile.grabNew(new MetricFile());
+                        myFile->readFile(nextArg);
+                        if (s_inputCache != NULL) s_inputCache->setMetric(nextArg, myFile);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -365,8 +466,30 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::SURFACE:
                 {
-                    CaretPointer<SurfaceFile> myFile(new SurfaceFile());
-                    myFile->readFile(nextArg);
+                    if (m_pipelineFiles != NULL)
+                    {//surfaces read from disk are also shared, so their topology and geodesic helpers are only built once
+                        CaretPointer<SurfaceFile>& myFile = ((SurfaceParameter*)myComponent->m_paramList[i])->m_parameter;
+                        if (m_pipelineFiles->getSurface(nextArg, myFile))
+                        {
+                            if (m_doProvenance) addParentProvenance(nextArg, myFile->getFileMetaData());
+                            break;
+                        }
+                        if (CommandPipelineFiles::isInMemoryName(nextArg))
+                        {
+                            throw ProgramParametersException("in-memory surface file '" + nextArg + "' was not created by an earlier step");
+                        }
+                    }
+                    CaretPointer<SurfaceFile> myFile;
+                    if (s_inputCache == NULL || !s_inputCache->getSurface(nextArg, myFile))
+                    {
+                        myFile.grabNew(new SurfaceFile());
+                        myFile->readFile(nextArg);
+                        if (s_inputCache != NULL) s_inputCache->setSurface(nextArg, myFile);
+                    }
+                    if (m_pipelineFiles != NULL)
+                    {
+                        m_pipelineFiles->setSurface(nextArg, myFile);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -389,8 +512,23 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::VOLUME:
                 {
-                    CaretPointer<VolumeFile> myFile(new VolumeFile());
-                    myFile->readFile(nextArg);
+                    if (m_pipelineFiles != NULL && CommandPipelineFiles::isInMemoryName(nextArg))
+                    {
+                        CaretPointer<VolumeFile>& myFile = ((VolumeParameter*)myComponent->m_paramList[i])->m_parameter;
+                        if (!m_pipelineFiles->getVolume(nextArg, myFile))
+                        {
+                            throw ProgramParametersException("in-memory volume file '" + nextArg + "' was not created by an earlier step");
+                        }
+                        if (m_doProvenance) addParentProvenance(nextArg, myFile->getFileMetaData());
+                        break;
+                    }
+                    CaretPointer<VolumeFile> myFile;
+                    if (s_inputCache == NULL || !s_inputCache->getVolume(nextArg, myFile))
+                    {
+                        myFile.grabNew(new VolumeFile());
+                        myFile->readFile(nextArg);
+                        if (s_inputCache != NULL) s_inputCache->setVolume(nextArg, myFile);
+                    }
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -412,6 +550,11 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                     break;
                 }
             };
+            if (PerformanceProfile::isEnabled() && isFileType(nextType))
+            {//in-memory pipeline files don't exist on disk, so they are marked instead of showing as empty files
+                const bool inMemoryFlag = (m_pipelineFiles != NULL && CommandPipelineFiles::isInMemoryName(nextArg));
+                PerformanceProfile::addFileRead(nextArg, PerformanceProfile::getWallSeconds() - readStartSeconds, inMemoryFlag);
+            }
         }
         catch (const bad_alloc&) {
             switch (nextType)
@@ -467,6 +610,26 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
         OutputAssoc tempItem;
         tempItem.m_fileName = nextArg;
         tempItem.m_param = myComponent->m_outputList[i];
+        tempItem.m_inMemory = (m_pipelineFiles != NULL && CommandPipelineFiles::isInMemoryName(nextArg));
+        if (tempItem.m_inMemory)
+        {
+            switch (myComponent->m_outputList[i]->getType())
+            {
+                case OperationParametersEnum::CIFTI:
+                case OperationParametersEnum::LABEL:
+                case OperationParametersEnum::METRIC:
+                case OperationParametersEnum::SURFACE:
+                case OperationParametersEnum::VOLUME:
+                    break;
+                default:
+                    throw ProgramParametersException("output <" + myComponent->m_outputList[i]->m_shortName + "> can't be kept in memory as '" + nextArg +
+                                                     "', only cifti, label, metric, surface, and volume files can be pipeline intermediates");
+            }
+            if (m_pipelineFiles->hasFile(nextArg))
+            {
+                throw ProgramParametersException("in-memory file '" + nextArg + "' was already created by an earlier step");
+            }
+        }
         switch (myComponent->m_outputList[i]->getType())//allocate outputs that only have in-memory implementations
         {
             case OperationParametersEnum::ANNOTATION:
@@ -883,6 +1046,103 @@ CommandParser::CompletionInfo CommandParser::completionRemainingOptions(Paramete
     return prev;//no parameters remain, return whatever was found
 }
 
+void CommandParser::addParentProvenance(const AString& fileName, const GiftiMetaData* md)
+{
+    if (md != NULL)
+    {
+        AString prov = md->get(PROVENANCE_NAME);
+        if (prov != "")
+        {
+            m_parentProvenance += fileName + ":\n" + prov + "\n\n";
+        }
+    }
+}
+
+void CommandParser::getFileArguments(ProgramParameters& parameters, vector<AString>& inputsOut, vector<AString>& outputsOut)
+{
+    CaretPointer<OperationParameters> myAlgParams(m_autoOper->getParameters());
+    inputsOut.clear();
+    outputsOut.clear();
+    scanComponent(myAlgParams.getPointer(), parameters, inputsOut, outputsOut);
+}
+
+void CommandParser::scanComponent(ParameterComponent* myComponent, ProgramParameters& parameters, vector<AString>& inputsOut, vector<AString>& outputsOut)
+{//walks the arguments like parseComponent(), without opening anything, to find what files a pipeline step reads and writes
+    for (int i = 0; i < (int)myComponent->m_paramList.size(); ++i)
+    {
+        if (!parameters.hasNext()) return;//let the real parsing report the error
+        AString nextArg = parameters.nextString(myComponent->m_paramList[i]->m_shortName).fixUnicodeHyphens();
+        if (!nextArg.isEmpty() && nextArg[0] == '-')
+        {
+            if (scanOption(nextArg, myComponent, parameters, inputsOut, outputsOut))
+            {
+                --i;
+                continue;
+            }
+        }
+        switch (myComponent->m_paramList[i]->getType())
+        {
+            case OperationParametersEnum::BOOL:
+            case OperationParametersEnum::DOUBLE:
+            case OperationParametersEnum::INT:
+                break;
+            case OperationParametersEnum::STRING:
+                if (CommandPipelineFiles::isInMemoryName(nextArg))
+                {//a string isn't a file unless it names an in-memory file, otherwise any label name or expression with a '.' would serialize the steps
+                    inputsOut.push_back(nextArg);
+                }
+                break;
+            default:
+                inputsOut.push_back(nextArg);
+                break;
+        }
+    }
+    for (int i = 0; i < (int)myComponent->m_outputList.size(); ++i)
+    {
+        if (!parameters.hasNext()) return;
+        AString nextArg = parameters.nextString(myComponent->m_outputList[i]->m_shortName).fixUnicodeHyphens();
+        if (!nextArg.isEmpty() && nextArg[0] == '-')
+        {
+            if (scanOption(nextArg, myComponent, parameters, inputsOut, outputsOut))
+            {
+                --i;
+                continue;
+            }
+        }
+        outputsOut.push_back(nextArg);
+    }
+    while (parameters.hasNext())
+    {
+        AString nextArg = parameters.nextString("option").fixUnicodeHyphens();
+        if (nextArg.isEmpty() || nextArg[0] != '-' || !scanOption(nextArg, myComponent, parameters, inputsOut, outputsOut))
+        {
+            parameters.backup();
+            return;
+        }
+    }
+}
+
+bool CommandParser::scanOption(const AString& mySwitch, ParameterComponent* myComponent, ProgramParameters& parameters, vector<AString>& inputsOut, vector<AString>& outputsOut)
+{
+    for (uint32_t i = 0; i < myComponent->m_optionList.size(); ++i)
+    {
+        if (mySwitch == myComponent->m_optionList[i]->m_optionSwitch)
+        {
+            scanComponent(myComponent->m_optionList[i], parameters, inputsOut, outputsOut);
+            return true;
+        }
+    }
+    for (uint32_t i = 0; i < myComponent->m_repeatableOptions.size(); ++i)
+    {
+        if (mySwitch == myComponent->m_repeatableOptions[i]->m_optionSwitch)
+        {
+            scanComponent(&(myComponent->m_repeatableOptions[i]->m_template), parameters, inputsOut, outputsOut);
+            return true;
+        }
+    }
+    return false;
+}
+
 void CommandParser::provenanceBeforeOperation(const vector<OutputAssoc>& outAssociation)
 {
     vector<AString> versionInfo;//need this for on-disk outputs, because we have to set it before the command executes
@@ -1005,6 +1265,11 @@ void CommandParser::makeOnDiskOutputs(const vector<OutputAssoc>& outAssociation)
             case OperationParametersEnum::CIFTI:
             {
                 CiftiParameter* myCiftiParam = (CiftiParameter*)myParam;
+                if (outAssociation[i].m_inMemory)
+                {//pipeline intermediate, never written
+                    myCiftiParam->m_parameter.grabNew(new CiftiFile());
+                    break;
+                }
                 FileInformation myInfo(outAssociation[i].m_fileName);
                 map<AString, const CiftiFile*>::iterator iter = m_inputCiftiNames.find(myInfo.getCanonicalFilePath());
                 if (iter != m_inputCiftiNames.end())
@@ -1043,6 +1308,38 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
     for (uint32_t i = 0; i < outAssociation.size(); ++i)
     {
         AbstractParameter* myParam = outAssociation[i].m_param;
+        if (outAssociation[i].m_inMemory)
+        {
+            CaretAssert(m_pipelineFiles != NULL);
+            switch (myParam->getType())
+            {
+                case OperationParametersEnum::CIFTI:
+                    m_pipelineFiles->setCifti(outAssociation[i].m_fileName, ((CiftiParameter*)myParam)->m_parameter);
+                    break;
+                case OperationParametersEnum::LABEL:
+                    m_pipelineFiles->setLabel(outAssociation[i].m_fileName, ((LabelParameter*)myParam)->m_parameter);
+                    break;
+                case OperationParametersEnum::METRIC:
+                    m_pipelineFiles->setMetric(outAssociation[i].m_fileName, ((MetricParameter*)myParam)->m_parameter);
+                    break;
+                case OperationParametersEnum::SURFACE:
+                    m_pipelineFiles->setSurface(outAssociation[i].m_fileName, ((SurfaceParameter*)myParam)->m_parameter);
+                    break;
+                case OperationParametersEnum::VOLUME:
+                    m_pipelineFiles->setVolume(outAssociation[i].m_fileName, ((VolumeParameter*)myParam)->m_parameter);
+                    break;
+                default:
+                    CaretAssertMessage(false, "in-memory output type was not rejected during parsing");
+                    throw CommandException("Internal parsing error, please let the developers know what you just tried to do");
+            }
+            PerformanceProfile::addFileWritten(outAssociation[i].m_fileName, 0.0, true);//nothing is written, only handed to later steps
+            continue;
+        }
+        if (m_pipelineFiles != NULL)
+        {
+            m_pipelineFiles->remove(outAssociation[i].m_fileName);//don't give later steps a stale copy of a shared surface
+        }
+        const double writeStartSeconds = (PerformanceProfile::isEnabled() ? PerformanceProfile::getWallSeconds() : 0.0);
         switch (myParam->getType())
         {
             case OperationParametersEnum::BOOL://ignores the name you give the output for now, but what gives primitive type output and how is it used?
@@ -1110,6 +1407,10 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
                 CaretAssertMessage(false, "Writing of this parameter type has not been implemented in this parser");//assert instead of throw because this is a code error, not a user error
                 throw CommandException("Internal parsing error, please let the developers know what you just tried to do");//but don't let release pass by it either
         }
+        if (PerformanceProfile::isEnabled() && isFileType(myParam->getType()))
+        {
+            PerformanceProfile::addFileWritten(outAssociation[i].m_fileName, PerformanceProfile::getWallSeconds() - writeStartSeconds);
+        }
     }
 }
 
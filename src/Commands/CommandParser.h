@@ -32,6 +32,10 @@
 #include <set>
 
 namespace caret {
+    
+    class CommandInputCache;
+    class CommandPipelineFiles;
+    class GiftiMetaData;
 
     class CommandParser : public CommandOperation, OperationParserInterface
     {
@@ -42,10 +46,14 @@ namespace caret {
         int16_t m_ciftiDType, m_volumeDType;
         const static AString PROVENANCE_NAME, PARENT_PROVENANCE_NAME, PROGRAM_PROVENANCE_NAME, CWD_PROVENANCE_NAME;//TODO: put this elsewhere?
         std::map<AString, const CiftiFile*> m_inputCiftiNames;
+        CommandPipelineFiles* m_pipelineFiles;//only set while running a step of a pipeline
+        AString m_pipelineCommandLine;
+        static CommandInputCache* s_inputCache;//only set by wb_command -server
         struct OutputAssoc
         {//how the output is stored is up to the parser, in the GUI it should load into memory without writing to disk
             AString m_fileName;
             AbstractParameter* m_param;
+            bool m_inMemory;//pipeline intermediate, handed to later steps instead of written
         };
         struct CompletionInfo
         {
@@ -60,6 +68,9 @@ namespace caret {
         void provenanceAfterOperation(const std::vector<OutputAssoc>& outAssociation);
         void makeOnDiskOutputs(const std::vector<OutputAssoc>& outAssociation);//ensures on-disk inputs aren't used as on-disk outputs, keeping outputs in-memory when needed
         void writeOutput(const std::vector<OutputAssoc>& outAssociation);
+        void addParentProvenance(const AString& fileName, const GiftiMetaData* md);
+        void scanComponent(ParameterComponent* myComponent, ProgramParameters& parameters, std::vector<AString>& inputsOut, std::vector<AString>& outputsOut);
+        bool scanOption(const AString& mySwitch, ParameterComponent* myComponent, ProgramParameters& parameters, std::vector<AString>& inputsOut, std::vector<AString>& outputsOut);
         AString getIndentString(int desired);
         void addHelpComponent(AString& info, ParameterComponent* myComponent, int curIndent);
         void addHelpOptions(AString& info, ParameterComponent* myAlgParams, int curIndent);
@@ -74,11 +85,16 @@ namespace caret {
     public:
         CommandParser(AutoOperationInterface* myAutoOper);
         void disableProvenance();
+        void enableProvenance();
+        ///on-disk label, metric, surface and volume inputs are looked up in and added to this cache, NULL to read every input from disk
+        static void setInputCache(CommandInputCache* inputCache);
         void setCiftiOutputDTypeAndScale(const int16_t& dtype, const double& minVal, const double& maxVal);
         void setCiftiOutputDTypeNoScale(const int16_t& dtype);
         void setVolumeOutputDTypeAndScale(const int16_t& dtype, const double& minVal, const double& maxVal);
         void setVolumeOutputDTypeNoScale(const int16_t& dtype);
         void executeOperation(ProgramParameters& parameters);
+        void executePipelineStep(ProgramParameters& parameters, CommandPipelineFiles* pipelineFiles, const AString& stepCommandLine);
+        void getFileArguments(ProgramParameters& parameters, std::vector<AString>& inputsOut, std::vector<AString>& outputsOut);
         void showParsedOperation(ProgramParameters& parameters);
         AString doCompletion(ProgramParameters& parameters, const bool& useExtGlob);
         AString getHelpInformation(const AString& programName);
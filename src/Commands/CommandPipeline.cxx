@@ -0,0 +1,507 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CommandPipeline.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "CommandOperationManager.h"
+#include "CommandParser.h"
+#include "ProgramParameters.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QTextStream>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+using namespace caret;
+using namespace std;
+
+/**
+ * Runs one step of the pipeline in its own thread.
+ */
+class CommandPipeline::StepThread : public QThread
+{
+public:
+    StepThread(CommandPipeline* pipeline, const int stepIndex, const int numThreads,
+               QMutex* mutex, QWaitCondition* finished, vector<int>* stepState, int* numRunning, AString* errorMessage)
+    : m_pipeline(pipeline), m_stepIndex(stepIndex), m_numThreads(numThreads),
+      m_mutex(mutex), m_finished(finished), m_stepState(stepState), m_numRunning(numRunning), m_errorMessage(errorMessage) { }
+    
+    void run()
+    {
+#ifdef CARET_OMP
+        omp_set_num_threads(m_numThreads);//share the cores between the steps that are running
+#endif
+        AString error;
+        try
+        {
+            m_pipeline->runStep(m_stepIndex);
+        } catch (CaretException& e) {
+            error = e.whatString();
+        } catch (std::exception& e) {
+            error = e.what();
+        } catch (...) {
+            error = "unknown exception";
+        }
+        QMutexLocker locker(m_mutex);
+        if (!error.isEmpty() && m_errorMessage->isEmpty())
+        {
+            const Step& myStep = m_pipeline->m_steps[m_stepIndex];
+            *m_errorMessage = "pipeline step on line " + AString::number(myStep.m_lineNumber) + " failed: " + error;
+        }
+        (*m_stepState)[m_stepIndex] = 2;
+        --(*m_numRunning);
+        m_finished->wakeAll();
+    }
+    
+private:
+    CommandPipeline* m_pipeline;
+    int m_stepIndex, m_numThreads;
+    QMutex* m_mutex;
+    QWaitCondition* m_finished;
+    vector<int>* m_stepState;
+    int* m_numRunning;
+    AString* m_errorMessage;
+};
+
+/**
+ * Constructor.
+ */
+CommandPipeline::CommandPipeline()
+: CommandOperation("-pipeline",
+                   "RUN A SCRIPT OF COMMANDS IN ONE PROCESS")
+{
+    m_preventProvenance = false;
+    m_volumeScale = m_ciftiScale = false;
+    m_volumeDType = m_ciftiDType = NIFTI_TYPE_FLOAT32;
+    m_volumeMax = m_ciftiMax = -1.0;
+    m_volumeMin = m_ciftiMin = -1.0;
+}
+
+/**
+ * Destructor.
+ */
+CommandPipeline::~CommandPipeline()
+{
+    
+}
+
+AString
+CommandPipeline::getHelpInformation(const AString& programName)
+{
+    AString helpInfo = ("RUN A SCRIPT OF COMMANDS IN ONE PROCESS\n"
+                        "   " + programName + " -pipeline\n"
+                        "      <script> - text file of commands, one per line\n"
+                        "\n"
+                        "      [-concurrent] - run independent commands at the same time\n"
+                        "         <number> - the most commands to run at once\n"
+                        "\n"
+                        "      Each line of the script is the arguments of one processing command, as\n"
+                        "      they would be given to " + programName + " (a leading '" + programName + "' is\n"
+                        "      allowed).  Arguments can be quoted with ' or \", a line ending in \\\n"
+                        "      continues on the next line, and # starts a comment.  Global options\n"
+                        "      given before -pipeline apply to every command.\n"
+                        "\n"
+                        "      An output file name that starts with @ (such as @smoothed) is not\n"
+                        "      written, the file is kept in memory and is used directly by later\n"
+                        "      commands that use the same name as an input, and freed after the last\n"
+                        "      command that uses it.  This works for cifti, volume, metric, label, and\n"
+                        "      surface files.  Surface files read from disk are also kept, so each\n"
+                        "      surface is read, and its topology and geodesic information computed,\n"
+                        "      only once.\n"
+                        "\n"
+                        "      With -concurrent, a command can start before earlier commands have\n"
+                        "      finished if it doesn't use their outputs or write their inputs or\n"
+                        "      outputs, and if it isn't the same command as an earlier one that is\n"
+                        "      still running.  The available cores are divided between the running\n"
+                        "      commands.\n");
+    return helpInfo;
+}
+
+void
+CommandPipeline::setCiftiOutputDTypeAndScale(const int16_t& dtype, const double& minVal, const double& maxVal)
+{
+    m_ciftiDType = dtype;
+    m_ciftiMin = minVal;
+    m_ciftiMax = maxVal;
+    m_ciftiScale = true;
+}
+
+void
+CommandPipeline::setCiftiOutputDTypeNoScale(const int16_t& dtype)
+{
+    m_ciftiDType = dtype;
+    m_ciftiScale = false;
+}
+
+void
+CommandPipeline::setVolumeOutputDTypeAndScale(const int16_t& dtype, const double& minVal, const double& maxVal)
+{
+    m_volumeDType = dtype;
+    m_volumeMin = minVal;
+    m_volumeMax = maxVal;
+    m_volumeScale = true;
+}
+
+void
+CommandPipeline::setVolumeOutputDTypeNoScale(const int16_t& dtype)
+{
+    m_volumeDType = dtype;
+    m_volumeScale = false;
+}
+
+void
+CommandPipeline::disableProvenance()
+{
+    m_preventProvenance = true;
+}
+
+void
+CommandPipeline::enableProvenance()
+{
+    m_preventProvenance = false;
+}
+
+/**
+ * Execute the operation.
+ * 
+ * @param parameters
+ *   Parameters for the operation.
+ * @throws CommandException
+ *   If the command failed.
+ * @throws ProgramParametersException
+ *   If there is an error in the parameters.
+ */
+void 
+CommandPipeline::executeOperation(ProgramParameters& parameters)
+{
+    AString scriptFileName = parameters.nextString("script");
+    int maxConcurrent = 1;
+    while (parameters.hasNext())
+    {
+        AString option = parameters.nextString("option");
+        if (option == "-concurrent")
+        {
+            maxConcurrent = (int)parameters.nextLong("number");
+            if (maxConcurrent < 1) throw ProgramParametersException("-concurrent must be given a positive number");
+        } else {
+            throw ProgramParametersException("unrecognized option to -pipeline: '" + option + "'");
+        }
+    }
+    m_files.clear();//surfaces from a previous run may have changed on disk
+    readScript(scriptFileName);
+    findDependencies();
+    set<CommandParser*> parsersUsed;
+    for (int i = 0; i < (int)m_steps.size(); ++i)
+    {
+        parsersUsed.insert(m_steps[i].m_parser);
+    }
+    for (set<CommandParser*>::iterator iter = parsersUsed.begin(); iter != parsersUsed.end(); ++iter)
+    {
+        if (m_ciftiScale)
+        {
+            (*iter)->setCiftiOutputDTypeAndScale(m_ciftiDType, m_ciftiMin, m_ciftiMax);
+        } else {
+            (*iter)->setCiftiOutputDTypeNoScale(m_ciftiDType);
+        }
+        if (m_volumeScale)
+        {
+            (*iter)->setVolumeOutputDTypeAndScale(m_volumeDType, m_volumeMin, m_volumeMax);
+        } else {
+            (*iter)->setVolumeOutputDTypeNoScale(m_volumeDType);
+        }
+        if (m_preventProvenance)
+        {
+            (*iter)->disableProvenance();
+        } else {
+            (*iter)->enableProvenance();//the parsers are shared, a previous command may have disabled it
+        }
+    }
+    if (maxConcurrent == 1)
+    {
+        for (int i = 0; i < (int)m_steps.size(); ++i)
+        {
+            try
+            {
+                runStep(i);
+            } catch (CaretException& e) {
+                throw CommandException("pipeline step on line " + AString::number(m_steps[i].m_lineNumber) + " failed: " + e.whatString());
+            }
+        }
+    } else {
+        runConcurrently(maxConcurrent);
+    }
+}
+
+vector<AString>
+CommandPipeline::splitLine(const AString& line, const int& lineNumber, bool& continuedOut)
+{
+    vector<AString> ret;
+    AString current;
+    bool inToken = false, quoted = false;
+    QChar quote;
+    continuedOut = false;
+    for (int i = 0; i < line.size(); ++i)
+    {
+        QChar c = line[i];
+        if (quoted)
+        {
+            if (c == quote)
+            {
+                quoted = false;
+            } else if (c == '\\' && quote == '"' && i + 1 < line.size()) {
+                current += line[++i];
+            } else {
+                current += c;
+            }
+            continue;
+        }
+        if (c == '\'' || c == '"')
+        {
+            quote = c;
+            quoted = true;
+            inToken = true;
+        } else if (c == '\\') {
+            if (i + 1 == line.size())
+            {
+                continuedOut = true;
+            } else {
+                current += line[++i];
+                inToken = true;
+            }
+        } else if (c.isSpace()) {
+            if (inToken)
+            {
+                ret.push_back(current);
+                current = "";
+                inToken = false;
+            }
+        } else if (c == '#' && !inToken) {
+            break;
+        } else {
+            current += c;
+            inToken = true;
+        }
+    }
+    if (quoted) throw CommandException("unterminated quote on line " + AString::number(lineNumber) + " of pipeline script");
+    if (inToken) ret.push_back(current);
+    return ret;
+}
+
+void
+CommandPipeline::readScript(const AString& scriptFileName)
+{
+    QFile scriptFile(scriptFileName);
+    if (!scriptFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        throw CommandException("failed to open pipeline script '" + scriptFileName + "': " + scriptFile.errorString());
+    }
+    vector<CommandOperation*> allOperations = CommandOperationManager::getCommandOperationManager()->getCommandOperations();
+    map<AString, CommandOperation*> operationLookup;
+    for (int i = 0; i < (int)allOperations.size(); ++i)
+    {
+        operationLookup[allOperations[i]->getCommandLineSwitch()] = allOperations[i];
+    }
+    m_steps.clear();
+    QTextStream myStream(&scriptFile);
+    int lineNumber = 0, stepLine = 0;
+    vector<AString> arguments;
+    bool continued = false;
+    while (!myStream.atEnd())
+    {
+        AString line = myStream.readLine();
+        ++lineNumber;
+        if (!continued)
+        {
+            stepLine = lineNumber;
+        }
+        vector<AString> lineArgs = splitLine(line, lineNumber, continued);
+        arguments.insert(arguments.end(), lineArgs.begin(), lineArgs.end());
+        if (continued && !myStream.atEnd()) continue;
+        if (!arguments.empty() && arguments[0] == "wb_command")
+        {
+            arguments.erase(arguments.begin());
+        }
+        if (arguments.empty()) continue;
+        Step myStep;
+        myStep.m_lineNumber = stepLine;
+        map<AString, CommandOperation*>::iterator iter = operationLookup.find(arguments[0]);
+        if (iter == operationLookup.end())
+        {
+            throw CommandException("unknown command '" + arguments[0] + "' on line " + AString::number(stepLine) + " of pipeline script");
+        }
+        myStep.m_parser = dynamic_cast<CommandParser*>(iter->second);
+        if (myStep.m_parser == NULL)
+        {
+            throw CommandException("command '" + arguments[0] + "' on line " + AString::number(stepLine) + " can't be used in a pipeline");
+        }
+        myStep.m_commandLine = "wb_command";
+        for (int i = 0; i < (int)arguments.size(); ++i)
+        {
+            myStep.m_commandLine += " " + arguments[i];
+        }
+        myStep.m_arguments.assign(arguments.begin() + 1, arguments.end());
+        m_steps.push_back(myStep);
+        arguments.clear();
+    }
+}
+
+void
+CommandPipeline::findDependencies()
+{
+    set<AString> producer;
+    m_remainingUses.clear();
+    for (int j = 0; j < (int)m_steps.size(); ++j)
+    {
+        Step& myStep = m_steps[j];
+        ProgramParameters myParams;
+        for (int i = 0; i < (int)myStep.m_arguments.size(); ++i)
+        {
+            myParams.addParameter(myStep.m_arguments[i]);
+        }
+        myStep.m_parser->getFileArguments(myParams, myStep.m_inputs, myStep.m_outputs);
+        for (int i = 0; i < (int)myStep.m_inputs.size(); ++i)
+        {
+            myStep.m_inputs[i] = CommandPipelineFiles::getLookupName(myStep.m_inputs[i]);
+            if (CommandPipelineFiles::isInMemoryName(myStep.m_inputs[i]))
+            {
+                if (producer.find(myStep.m_inputs[i]) == producer.end())
+                {
+                    throw CommandException("in-memory file '" + myStep.m_inputs[i] + "' on line " + AString::number(myStep.m_lineNumber) +
+                                           " is used before any earlier command creates it");
+                }
+            }
+        }
+        for (int i = 0; i < (int)myStep.m_outputs.size(); ++i)
+        {
+            myStep.m_outputs[i] = CommandPipelineFiles::getLookupName(myStep.m_outputs[i]);
+            if (CommandPipelineFiles::isInMemoryName(myStep.m_outputs[i]))
+            {
+                producer.insert(myStep.m_outputs[i]);
+            }
+        }
+        set<AString> myFiles(myStep.m_inputs.begin(), myStep.m_inputs.end());
+        myFiles.insert(myStep.m_outputs.begin(), myStep.m_outputs.end());
+        myStep.m_inMemoryUsed.clear();
+        for (set<AString>::iterator iter = myFiles.begin(); iter != myFiles.end(); ++iter)
+        {//steps that only read the same file don't depend on each other, so with -concurrent the last one listed may not finish last
+            if (CommandPipelineFiles::isInMemoryName(*iter))
+            {
+                myStep.m_inMemoryUsed.push_back(*iter);
+                ++m_remainingUses[*iter];
+            }
+        }
+        set<AString> myOutputs(myStep.m_outputs.begin(), myStep.m_outputs.end());
+        for (int i = 0; i < j; ++i)
+        {
+            const Step& earlier = m_steps[i];
+            bool dependent = (earlier.m_parser == myStep.m_parser);//a parser can only run one command at a time
+            for (int k = 0; !dependent && k < (int)earlier.m_outputs.size(); ++k)
+            {
+                dependent = (myFiles.find(earlier.m_outputs[k]) != myFiles.end());
+            }
+            for (int k = 0; !dependent && k < (int)earlier.m_inputs.size(); ++k)
+            {
+                dependent = (myOutputs.find(earlier.m_inputs[k]) != myOutputs.end());
+            }
+            if (dependent) myStep.m_dependencies.push_back(i);
+        }
+    }
+}
+
+void
+CommandPipeline::runStep(const int stepIndex)
+{
+    CaretAssertVectorIndex(m_steps, stepIndex);
+    Step& myStep = m_steps[stepIndex];
+    CaretLogFine("pipeline: " + myStep.m_commandLine);
+    ProgramParameters myParams;
+    for (int i = 0; i < (int)myStep.m_arguments.size(); ++i)
+    {
+        myParams.addParameter(myStep.m_arguments[i]);
+    }
+    myStep.m_parser->executePipelineStep(myParams, &m_files, myStep.m_commandLine);
+    CaretMutexLocker locker(&m_remainingUsesMutex);
+    for (int i = 0; i < (int)myStep.m_inMemoryUsed.size(); ++i)
+    {
+        map<AString, int>::iterator iter = m_remainingUses.find(myStep.m_inMemoryUsed[i]);
+        CaretAssert(iter != m_remainingUses.end() && iter->second > 0);
+        if (--(iter->second) == 0)
+        {
+            m_files.remove(iter->first);
+        }
+    }
+}
+
+void
+CommandPipeline::runConcurrently(const int maxConcurrent)
+{
+    const int numSteps = (int)m_steps.size();
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = max(1, omp_get_max_threads() / maxConcurrent);
+#endif
+    QMutex myMutex;
+    QWaitCondition stepFinished;
+    vector<int> stepState(numSteps, 0);//0 waiting, 1 running, 2 finished
+    vector<CaretPointer<StepThread> > myThreads(numSteps);
+    int numRunning = 0, numStarted = 0;
+    AString errorMessage;
+    {
+        QMutexLocker locker(&myMutex);
+        while (true)
+        {
+            for (int i = 0; errorMessage.isEmpty() && numRunning < maxConcurrent && i < numSteps; ++i)
+            {
+                if (stepState[i] != 0) continue;
+                bool ready = true;
+                for (int j = 0; j < (int)m_steps[i].m_dependencies.size(); ++j)
+                {
+                    if (stepState[m_steps[i].m_dependencies[j]] != 2)
+                    {
+                        ready = false;
+                        break;
+                    }
+                }
+                if (!ready) continue;
+                stepState[i] = 1;
+                ++numRunning;
+                ++numStarted;
+                myThreads[i].grabNew(new StepThread(this, i, numThreads, &myMutex, &stepFinished, &stepState, &numRunning, &errorMessage));
+                myThreads[i]->start();
+            }
+            if (numRunning == 0 && (numStarted == numSteps || !errorMessage.isEmpty())) break;
+            stepFinished.wait(&myMutex);
+        }
+    }
+    for (int i = 0; i < numSteps; ++i)
+    {
+        if (myThreads[i].getPointer() != NULL) myThreads[i]->wait();//they have all signaled, make sure they have returned before deleting them
+    }
+    if (!errorMessage.isEmpty()) throw CommandException(errorMessage);
+}
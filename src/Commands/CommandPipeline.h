@@ -0,0 +1,106 @@
+#ifndef __COMMAND_PIPELINE_H__
+#define __COMMAND_PIPELINE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include "CaretMutex.h"
+#include "CommandOperation.h"
+#include "CommandPipelineFiles.h"
+
+#include <map>
+#include <vector>
+
+namespace caret {
+
+    class CommandParser;
+    
+    /// Runs a script of processing commands in one process, keeping intermediate files in memory.
+    class CommandPipeline : public CommandOperation {
+        
+    public:
+        CommandPipeline();
+        
+        virtual ~CommandPipeline();
+
+        virtual void executeOperation(ProgramParameters& parameters);
+        
+        AString getHelpInformation(const AString& programName);
+        
+        virtual void setCiftiOutputDTypeAndScale(const int16_t& dtype, const double& minVal, const double& maxVal);
+        
+        virtual void setCiftiOutputDTypeNoScale(const int16_t& dtype);
+        
+        virtual void setVolumeOutputDTypeAndScale(const int16_t& dtype, const double& minVal, const double& maxVal);
+        
+        virtual void setVolumeOutputDTypeNoScale(const int16_t& dtype);
+        
+    protected:
+        virtual void disableProvenance();
+        
+        virtual void enableProvenance();
+        
+    private:
+        struct Step
+        {
+            int m_lineNumber;
+            std::vector<AString> m_arguments;//the command switch is not included
+            AString m_commandLine;//for provenance
+            CommandParser* m_parser;
+            std::vector<AString> m_inputs, m_outputs;//lookup names of files
+            std::vector<int> m_dependencies;//earlier steps that must finish first
+            std::vector<AString> m_inMemoryUsed;//in-memory files this step reads or writes, each listed once
+        };
+        
+        class StepThread;
+        
+        CommandPipeline(const CommandPipeline&);
+
+        CommandPipeline& operator=(const CommandPipeline&);
+        
+        void readScript(const AString& scriptFileName);
+        
+        void findDependencies();
+        
+        void runStep(const int stepIndex);
+        
+        void runConcurrently(const int maxConcurrent);
+        
+        static std::vector<AString> splitLine(const AString& line, const int& lineNumber, bool& continuedOut);
+        
+        std::vector<Step> m_steps;
+        
+        CommandPipelineFiles m_files;
+        
+        std::map<AString, int> m_remainingUses;//steps that still have to use each in-memory file, it is freed at zero
+        
+        CaretMutex m_remainingUsesMutex;
+        
+        bool m_preventProvenance, m_ciftiScale, m_volumeScale;
+        
+        int16_t m_ciftiDType, m_volumeDType;
+        
+        double m_ciftiMin, m_ciftiMax, m_volumeMin, m_volumeMax;
+    };
+    
+} // namespace
+
+#endif // __COMMAND_PIPELINE_H__
@@ -0,0 +1,138 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CommandPipelineFiles.h"
+
+#include "CiftiFile.h"
+#include "FileInformation.h"
+#include "LabelFile.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <QDir>
+
+using namespace caret;
+using namespace std;
+
+AString CommandPipelineFiles::getLookupName(const AString& name)
+{
+    if (isInMemoryName(name)) return name;
+    return QDir::cleanPath(FileInformation(name).getAbsoluteFilePath());
+}
+
+template <typename T>
+bool CommandPipelineFiles::getFile(map<AString, CaretPointer<T> >& fileMap, const AString& name, CaretPointer<T>& fileOut)
+{
+    CaretMutexLocker locked(&m_mutex);
+    typename map<AString, CaretPointer<T> >::iterator iter = fileMap.find(getLookupName(name));
+    if (iter == fileMap.end()) return false;
+    fileOut = iter->second;
+    return true;
+}
+
+template <typename T>
+void CommandPipelineFiles::setFile(map<AString, CaretPointer<T> >& fileMap, const AString& name, const CaretPointer<T>& file)
+{
+    CaretMutexLocker locked(&m_mutex);
+    fileMap[getLookupName(name)] = file;
+}
+
+bool CommandPipelineFiles::getCifti(const AString& name, CaretPointer<CiftiFile>& fileOut)
+{
+    return getFile(m_ciftiFiles, name, fileOut);
+}
+
+bool CommandPipelineFiles::getLabel(const AString& name, CaretPointer<LabelFile>& fileOut)
+{
+    return getFile(m_labelFiles, name, fileOut);
+}
+
+bool CommandPipelineFiles::getMetric(const AString& name, CaretPointer<MetricFile>& fileOut)
+{
+    return getFile(m_metricFiles, name, fileOut);
+}
+
+bool CommandPipelineFiles::getSurface(const AString& name, CaretPointer<SurfaceFile>& fileOut)
+{
+    return getFile(m_surfaceFiles, name, fileOut);
+}
+
+bool CommandPipelineFiles::getVolume(const AString& name, CaretPointer<VolumeFile>& fileOut)
+{
+    return getFile(m_volumeFiles, name, fileOut);
+}
+
+void CommandPipelineFiles::setCifti(const AString& name, const CaretPointer<CiftiFile>& file)
+{
+    setFile(m_ciftiFiles, name, file);
+}
+
+void CommandPipelineFiles::setLabel(const AString& name, const CaretPointer<LabelFile>& file)
+{
+    setFile(m_labelFiles, name, file);
+}
+
+void CommandPipelineFiles::setMetric(const AString& name, const CaretPointer<MetricFile>& file)
+{
+    setFile(m_metricFiles, name, file);
+}
+
+void CommandPipelineFiles::setSurface(const AString& name, const CaretPointer<SurfaceFile>& file)
+{
+    setFile(m_surfaceFiles, name, file);
+}
+
+void CommandPipelineFiles::setVolume(const AString& name, const CaretPointer<VolumeFile>& file)
+{
+    setFile(m_volumeFiles, name, file);
+}
+
+bool CommandPipelineFiles::hasFile(const AString& name)
+{
+    AString lookupName = getLookupName(name);
+    CaretMutexLocker locked(&m_mutex);
+    return m_ciftiFiles.find(lookupName) != m_ciftiFiles.end() ||
+           m_labelFiles.find(lookupName) != m_labelFiles.end() ||
+           m_metricFiles.find(lookupName) != m_metricFiles.end() ||
+           m_surfaceFiles.find(lookupName) != m_surfaceFiles.end() ||
+           m_volumeFiles.find(lookupName) != m_volumeFiles.end();
+}
+
+void CommandPipelineFiles::remove(const AString& name)
+{
+    AString lookupName = getLookupName(name);
+    CaretMutexLocker locked(&m_mutex);
+    m_ciftiFiles.erase(lookupName);//when the last step using a file finishes, this frees it
+    m_labelFiles.erase(lookupName);
+    m_metricFiles.erase(lookupName);
+    m_surfaceFiles.erase(lookupName);
+    m_volumeFiles.erase(lookupName);
+}
+
+void CommandPipelineFiles::clear()
+{
+    CaretMutexLocker locked(&m_mutex);
+    m_ciftiFiles.clear();
+    m_labelFiles.clear();
+    m_metricFiles.clear();
+    m_surfaceFiles.clear();
+    m_volumeFiles.clear();
+}
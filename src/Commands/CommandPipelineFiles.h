@@ -0,0 +1,83 @@
+#ifndef __COMMAND_PIPELINE_FILES_H__
+#define __COMMAND_PIPELINE_FILES_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretMutex.h"
+#include "CaretPointer.h"
+
+#include <map>
+
+namespace caret {
+
+    class CiftiFile;
+    class LabelFile;
+    class MetricFile;
+    class SurfaceFile;
+    class VolumeFile;
+    
+    ///files kept in memory between the steps of a pipeline - outputs named with a leading '@' are stored here instead of written,
+    ///and are given to later steps that use the same name as an input, surfaces read from disk are also kept, so their helpers are only built once
+    class CommandPipelineFiles
+    {
+    public:
+        static bool isInMemoryName(const AString& name) { return name.startsWith("@"); }
+        
+        ///name used to look up or remove a file, in-memory names are unchanged, file names become an absolute, cleaned path
+        static AString getLookupName(const AString& name);
+        
+        bool getCifti(const AString& name, CaretPointer<CiftiFile>& fileOut);
+        bool getLabel(const AString& name, CaretPointer<LabelFile>& fileOut);
+        bool getMetric(const AString& name, CaretPointer<MetricFile>& fileOut);
+        bool getSurface(const AString& name, CaretPointer<SurfaceFile>& fileOut);
+        bool getVolume(const AString& name, CaretPointer<VolumeFile>& fileOut);
+        
+        void setCifti(const AString& name, const CaretPointer<CiftiFile>& file);
+        void setLabel(const AString& name, const CaretPointer<LabelFile>& file);
+        void setMetric(const AString& name, const CaretPointer<MetricFile>& file);
+        void setSurface(const AString& name, const CaretPointer<SurfaceFile>& file);
+        void setVolume(const AString& name, const CaretPointer<VolumeFile>& file);
+        
+        bool hasFile(const AString& name);
+        
+        ///release an in-memory file, or forget a surface read from disk (because the file was rewritten)
+        void remove(const AString& name);
+        
+        void clear();
+    private:
+        CaretMutex m_mutex;//steps may run concurrently
+        std::map<AString, CaretPointer<CiftiFile> > m_ciftiFiles;
+        std::map<AString, CaretPointer<LabelFile> > m_labelFiles;
+        std::map<AString, CaretPointer<MetricFile> > m_metricFiles;
+        std::map<AString, CaretPointer<SurfaceFile> > m_surfaceFiles;
+        std::map<AString, CaretPointer<VolumeFile> > m_volumeFiles;
+        
+        template <typename T>
+        bool getFile(std::map<AString, CaretPointer<T> >& fileMap, const AString& name, CaretPointer<T>& fileOut);
+        
+        template <typename T>
+        void setFile(std::map<AString, CaretPointer<T> >& fileMap, const AString& name, const CaretPointer<T>& file);
+    };
+    
+}
+
+#endif //__COMMAND_PIPELINE_FILES_H__
@@ -0,0 +1,473 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CommandServer.h"
+
+#include "CaretCommandLine.h"
+#include "CaretException.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "CommandException.h"
+#include "CommandInputCache.h"
+#include "CommandOperationManager.h"
+#include "CommandParser.h"
+#include "PerformanceProfile.h"
+#include "ProgramParameters.h"
+#include "dot_wrapper.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef CARET_OS_WINDOWS
+#include <signal.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+using namespace caret;
+using namespace std;
+
+#ifndef CARET_OS_WINDOWS
+namespace
+{
+    //must match wb_command_client.cxx
+    const uint32_t REQUEST_MAGIC = 0x57424331;
+    const uint32_t MAX_STRING_BYTES = 1 << 26;
+    const uint32_t MAX_STRINGS = 1 << 20;
+    
+    struct Request
+    {
+        vector<string> m_arguments, m_environment;
+        string m_workingDir;
+        int m_descriptors[3];//client's stdin, stdout, stderr
+        Request() { m_descriptors[0] = m_descriptors[1] = m_descriptors[2] = -1; }
+        ~Request()
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                if (m_descriptors[i] >= 0) close(m_descriptors[i]);
+            }
+        }
+    };
+    
+    bool readAll(const int fd, void* buffer, size_t count)
+    {
+        char* pos = (char*)buffer;
+        while (count > 0)
+        {
+            ssize_t result = read(fd, pos, count);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) return false;
+            pos += result;
+            count -= result;
+        }
+        return true;
+    }
+    
+    bool writeAll(const int fd, const void* buffer, size_t count)
+    {
+        const char* pos = (const char*)buffer;
+        while (count > 0)
+        {
+            ssize_t result = write(fd, pos, count);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) return false;
+            pos += result;
+            count -= result;
+        }
+        return true;
+    }
+    
+    bool readString(const int fd, string& stringOut)
+    {
+        uint32_t length;
+        if (!readAll(fd, &length, sizeof(length)) || length > MAX_STRING_BYTES) return false;
+        stringOut.resize(length);
+        return length == 0 || readAll(fd, &(stringOut[0]), length);
+    }
+    
+    bool readStrings(const int fd, vector<string>& stringsOut)
+    {
+        uint32_t count;
+        if (!readAll(fd, &count, sizeof(count)) || count > MAX_STRINGS) return false;
+        stringsOut.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (!readString(fd, stringsOut[i])) return false;
+        }
+        return true;
+    }
+    
+    bool receiveRequest(const int conn, Request& requestOut)
+    {
+        char tag;
+        iovec myIov;
+        myIov.iov_base = &tag;
+        myIov.iov_len = 1;
+        union
+        {
+            cmsghdr m_align;
+            char m_buffer[CMSG_SPACE(3 * sizeof(int))];
+        } control;
+        msghdr myMessage;
+        memset(&myMessage, 0, sizeof(myMessage));
+        myMessage.msg_iov = &myIov;
+        myMessage.msg_iovlen = 1;
+        myMessage.msg_control = control.m_buffer;
+        myMessage.msg_controllen = sizeof(control.m_buffer);
+        if (recvmsg(conn, &myMessage, 0) != 1) return false;
+        cmsghdr* myControl = CMSG_FIRSTHDR(&myMessage);
+        if (myControl == NULL || myControl->cmsg_level != SOL_SOCKET || myControl->cmsg_type != SCM_RIGHTS ||
+            myControl->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+        {
+            return false;
+        }
+        memcpy(requestOut.m_descriptors, CMSG_DATA(myControl), 3 * sizeof(int));
+        uint32_t magic;
+        if (!readAll(conn, &magic, sizeof(magic)) || magic != REQUEST_MAGIC) return false;
+        return readStrings(conn, requestOut.m_arguments) && readString(conn, requestOut.m_workingDir) && readStrings(conn, requestOut.m_environment);
+    }
+    
+    bool peerIsSameUser(const int conn)
+    {
+#ifdef CARET_OS_MACOSX
+        uid_t peerUid;
+        gid_t peerGid;
+        if (getpeereid(conn, &peerUid, &peerGid) != 0) return false;
+        return peerUid == geteuid();
+#elif defined(SO_PEERCRED)
+        ucred peerCred;
+        socklen_t credLength = sizeof(peerCred);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &peerCred, &credLength) != 0) return false;
+        return peerCred.uid == geteuid();
+#else
+        return true;//the socket file is only accessible by this user
+#endif
+    }
+    
+    vector<string> getEnvironment()
+    {
+        vector<string> ret;
+        for (char** iter = environ; *iter != NULL; ++iter)
+        {
+            ret.push_back(*iter);
+        }
+        return ret;
+    }
+    
+    void setEnvironment(const vector<string>& newEnvironment)
+    {
+        vector<string> oldEnvironment = getEnvironment();//copy, unsetenv changes environ
+        vector<string> newNames(newEnvironment.size());
+        for (size_t i = 0; i < newEnvironment.size(); ++i)
+        {
+            newNames[i] = newEnvironment[i].substr(0, newEnvironment[i].find('='));
+        }
+        for (size_t i = 0; i < oldEnvironment.size(); ++i)
+        {
+            string name = oldEnvironment[i].substr(0, oldEnvironment[i].find('='));
+            bool found = false;
+            for (size_t j = 0; j < newNames.size(); ++j)
+            {
+                if (newNames[j] == name)
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) unsetenv(name.c_str());
+        }
+        for (size_t i = 0; i < newEnvironment.size(); ++i)
+        {
+            size_t equalPos = newEnvironment[i].find('=');
+            if (equalPos == string::npos || equalPos == 0) continue;
+            setenv(newNames[i].c_str(), newEnvironment[i].c_str() + equalPos + 1, 1);
+        }
+    }
+    
+    int runRequest(const vector<string>& arguments)
+    {
+        vector<const char*> myArgv(1, "wb_command");
+        for (size_t i = 0; i < arguments.size(); ++i)
+        {
+            myArgv.push_back(arguments[i].c_str());
+        }
+        ProgramParameters parameters((int)myArgv.size(), myArgv.data());
+        caret_global_commandLine_init(parameters);
+        CaretLogFine("Server running: " + caret_global_commandLine);
+        int ret = 0;
+        try
+        {
+            for (size_t i = 0; i < arguments.size(); ++i)
+            {
+                if (arguments[i] == "-server") throw CommandException("a server can't be started from inside a server");
+            }
+            CommandOperationManager::getCommandOperationManager()->runCommand(parameters);
+        } catch (CaretException& e) {
+            cerr << "\nWhile running:\n" << caret_global_commandLine.toLocal8Bit().constData() << "\n\nERROR: " << e.whatString().toLocal8Bit().constData() << endl << endl;
+            ret = -1;
+        } catch (bad_alloc& e) {
+            cerr << "\nWhile running:\n" << caret_global_commandLine.toLocal8Bit().constData() << "\n\nERROR: " << e.what() << endl;
+            cerr << endl << "OUT OF MEMORY" << endl << endl;
+            ret = -1;
+        } catch (exception& e) {
+            cerr << "\nWhile running:\n" << caret_global_commandLine.toLocal8Bit().constData() << "\n\nERROR: " << e.what() << endl << endl;
+            ret = -1;
+        } catch (...) {//keep serving, the next command starts from a clean slate anyway
+            cerr << "\nWhile running:\n" << caret_global_commandLine.toLocal8Bit().constData() << "\n\nERROR: caught unknown exception type" << endl << endl;
+            ret = -1;
+        }
+        try
+        {
+            PerformanceProfile::writeProfile(caret_global_commandLine, ret == 0);//does nothing unless -profile was given
+        } catch (CaretException& e) {
+            cerr << "\nERROR: " << e.whatString().toLocal8Bit().constData() << endl << endl;
+            ret = -1;
+        }
+        return ret;
+    }
+    
+    void flushOutput()
+    {
+        cout.flush();
+        cerr.flush();
+        fflush(stdout);
+        fflush(stderr);
+    }
+    
+    ///runs one request with the client's working directory, environment, and standard streams, returns false for -stop-server
+    bool serveConnection(const int conn, const LogLevelEnum::Enum serverLogLevel, const int serverNumThreads)
+    {
+        Request myRequest;
+        if (!receiveRequest(conn, myRequest))
+        {
+            CaretLogWarning("ignoring malformed request to wb_command server");
+            return true;
+        }
+        bool keepServing = !(myRequest.m_arguments.size() == 1 && myRequest.m_arguments[0] == "-stop-server");
+        char* serverDir = getcwd(NULL, 0);
+        vector<string> serverEnvironment = getEnvironment();
+        int savedDescriptors[3];
+        flushOutput();
+        for (int i = 0; i < 3; ++i)
+        {
+            savedDescriptors[i] = dup(i);
+            dup2(myRequest.m_descriptors[i], i);
+        }
+        int32_t ret = 0;
+        if (chdir(myRequest.m_workingDir.c_str()) != 0)
+        {
+            cerr << "\nERROR: could not change to working directory '" << myRequest.m_workingDir << "': " << strerror(errno) << endl << endl;
+            ret = -1;
+        } else if (keepServing) {
+            setEnvironment(myRequest.m_environment);
+#ifdef CARET_OMP
+            const char* numThreads = getenv("OMP_NUM_THREADS");
+            if (numThreads != NULL && atoi(numThreads) > 0) omp_set_num_threads(atoi(numThreads));
+#endif
+            ret = runRequest(myRequest.m_arguments);
+        }
+        flushOutput();
+        for (int i = 0; i < 3; ++i)
+        {
+            dup2(savedDescriptors[i], i);
+            close(savedDescriptors[i]);
+        }
+        //global options only apply to the command they were given with
+        CaretLogger::getLogger()->setLevel(serverLogLevel);
+        PerformanceProfile::disable();
+        dot_set_impl(DOT_AUTO);
+#ifdef CARET_OMP
+        omp_set_num_threads(serverNumThreads);
+#else
+        (void)serverNumThreads;
+#endif
+        setEnvironment(serverEnvironment);
+        if (serverDir != NULL)
+        {
+            if (chdir(serverDir) != 0) CaretLogWarning("could not return to server working directory '" + AString(serverDir) + "'");
+            free(serverDir);
+        }
+        writeAll(conn, &ret, sizeof(ret));//if the client went away, there is no one to tell
+        return keepServing;
+    }
+}
+#endif
+
+/**
+ * Constructor.
+ */
+CommandServer::CommandServer()
+: CommandOperation("-server",
+                   "RUN COMMANDS FROM WB_COMMAND_CLIENT IN ONE PROCESS")
+{
+}
+
+/**
+ * Destructor.
+ */
+CommandServer::~CommandServer()
+{
+    
+}
+
+AString
+CommandServer::getHelpInformation(const AString& programName)
+{
+    AString helpInfo = ("RUN COMMANDS FROM WB_COMMAND_CLIENT IN ONE PROCESS\n"
+                        "   " + programName + " -server\n"
+                        "      <socket> - file name for the local socket to listen on\n"
+                        "\n"
+                        "      [-max-cache-mb] - limit the memory used by cached input files\n"
+                        "         <megabytes> - the limit, default 2048\n"
+                        "\n"
+                        "      Waits for commands sent by wb_command_client, and runs them one at a\n"
+                        "      time in this process, avoiding the startup cost of a new process for\n"
+                        "      each command.  To use it, start the server in the background, and run\n"
+                        "      wb_command_client with the same arguments you would give to\n"
+                        "      " + programName + ", with the WB_COMMAND_SERVER environment variable set to the\n"
+                        "      socket name, or with '-socket <socket>' as its first arguments.  The\n"
+                        "      client's working directory, environment, and standard input and output\n"
+                        "      are used for the command, and the client exits with the command's exit\n"
+                        "      code.  If no server is listening, the client runs " + programName + "\n"
+                        "      instead.\n"
+                        "\n"
+                        "      Label, metric, surface, and volume files read by a command are kept in\n"
+                        "      memory, and are reused by later commands when the file contents have\n"
+                        "      not changed, so surfaces also keep their topology and geodesic\n"
+                        "      information.  A file that a command modifies is not kept.\n"
+                        "\n"
+                        "      Only the user who started the server may send it commands.  To stop\n"
+                        "      the server, run 'wb_command_client -stop-server'.  This command is not\n"
+                        "      available on windows.\n");
+    return helpInfo;
+}
+
+void
+CommandServer::executeOperation(ProgramParameters& parameters)
+{
+    AString socketName = parameters.nextString("socket");
+    int64_t maxCacheMB = 2048;
+    while (parameters.hasNext())
+    {
+        AString option = parameters.nextString("option");
+        if (option == "-max-cache-mb")
+        {
+            maxCacheMB = parameters.nextLong("megabytes");
+            if (maxCacheMB < 0) throw ProgramParametersException("-max-cache-mb must not be negative");
+        } else {
+            throw ProgramParametersException("unrecognized option to -server: '" + option + "'");
+        }
+    }
+#ifdef CARET_OS_WINDOWS
+    throw CommandException("-server is not available on windows");
+#else
+    QByteArray socketBytes = socketName.toLocal8Bit();
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketBytes.size() >= (int)sizeof(address.sun_path))
+    {
+        throw CommandException("socket name '" + socketName + "' is too long, use a shorter path");
+    }
+    strcpy(address.sun_path, socketBytes.constData());
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket < 0) throw CommandException("failed to create socket: " + AString(strerror(errno)));
+    struct stat socketStat;
+    if (lstat(address.sun_path, &socketStat) == 0)
+    {
+        if (!S_ISSOCK(socketStat.st_mode))
+        {
+            close(listenSocket);
+            throw CommandException("'" + socketName + "' exists and is not a socket");
+        }
+        if (connect(listenSocket, (sockaddr*)&address, sizeof(address)) == 0)
+        {
+            close(listenSocket);
+            throw CommandException("a server is already listening on '" + socketName + "'");
+        }
+        unlink(address.sun_path);//left behind by a server that didn't exit cleanly
+        close(listenSocket);
+        listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenSocket < 0) throw CommandException("failed to create socket: " + AString(strerror(errno)));
+    }
+    if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0)
+    {
+        int bindError = errno;
+        close(listenSocket);
+        throw CommandException("failed to bind socket '" + socketName + "': " + AString(strerror(bindError)));
+    }
+    chmod(address.sun_path, S_IRUSR | S_IWUSR);
+    if (listen(listenSocket, 16) != 0)
+    {
+        int listenError = errno;
+        close(listenSocket);
+        unlink(address.sun_path);
+        throw CommandException("failed to listen on socket '" + socketName + "': " + AString(strerror(listenError)));
+    }
+    signal(SIGPIPE, SIG_IGN);//a client that exits early shouldn't take the server with it
+    CommandInputCache myCache(maxCacheMB * 1024 * 1024);
+    CommandParser::setInputCache(&myCache);
+    const LogLevelEnum::Enum serverLogLevel = CaretLogger::getLogger()->getLevel();
+    int serverNumThreads = 1;
+#ifdef CARET_OMP
+    serverNumThreads = omp_get_max_threads();
+#endif
+    CaretLogInfo("wb_command server listening on '" + socketName + "'");
+    bool keepServing = true;
+    while (keepServing)
+    {
+        int conn = accept(listenSocket, NULL, NULL);
+        if (conn < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            int acceptError = errno;
+            CommandParser::setInputCache(NULL);
+            close(listenSocket);
+            unlink(address.sun_path);
+            throw CommandException("failed to accept connection: " + AString(strerror(acceptError)));
+        }
+        if (peerIsSameUser(conn))
+        {//one at a time, commands use the process-wide working directory and standard streams
+            keepServing = serveConnection(conn, serverLogLevel, serverNumThreads);
+            myCache.endCommand();
+            CaretLogFine("wb_command server cache holds " + AString::number(myCache.getCachedBytes() / (1024 * 1024)) + " MB");
+        } else {
+            CaretLogWarning("rejected connection from another user");
+        }
+        close(conn);
+    }
+    CommandParser::setInputCache(NULL);
+    close(listenSocket);
+    unlink(address.sun_path);
+#endif
+}
@@ -0,0 +1,49 @@
+#ifndef __COMMAND_SERVER_H__
+#define __COMMAND_SERVER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+
+#include "CommandOperation.h"
+
+namespace caret {
+
+    /// Runs commands sent by wb_command_client in one long-lived process, keeping input files read by earlier commands.
+    class CommandServer : public CommandOperation {
+        
+    public:
+        CommandServer();
+        
+        virtual ~CommandServer();
+
+        virtual void executeOperation(ProgramParameters& parameters);
+        
+        AString getHelpInformation(const AString& programName);
+        
+    private:
+        CommandServer(const CommandServer&);
+
+        CommandServer& operator=(const CommandServer&);
+    };
+    
+} // namespace
+
+#endif // __COMMAND_SERVER_H__
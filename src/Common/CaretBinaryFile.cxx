@@ -28,12 +28,15 @@
 #include "CaretAssert.h"
 #include "CaretBinaryFile.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
 
 #include <QFile>
 #include "zlib.h"
 
 #include <algorithm>
+#include <cstring>
+#include <vector>
 
 using namespace caret;
 using namespace std;
@@ -42,23 +45,63 @@ using namespace std;
 namespace caret
 {
 #ifdef ZLIB_VERSION
+    //writes compressed data as a series of independent gzip members (like BGZF), so blocks can be deflated in parallel,
+    //each member header has an extra field with its compressed and uncompressed sizes, so reading can find every member start without inflating
+    //concatenated members are still a valid gzip file, and files from other programs get an index of resume points built as they are read
     class ZFileImpl : public CaretBinaryFile::ImplInterface
     {
-        gzFile m_zfile;
-        const static int64_t CHUNK_SIZE;
+        struct AccessPoint
+        {
+            int64_t m_compressedPos, m_uncompressedPos;
+            int m_bits;//number of bits from the byte before m_compressedPos that belong to the next deflate block
+            bool m_memberStart;//if true, start a new gzip member at m_compressedPos instead of using bits and window
+            vector<unsigned char> m_window;//last 32KB of output before this point, for resuming inside a deflate stream
+        };
+        QFile m_file;
+        bool m_writing;
+        int64_t m_uncompressedPos, m_uncompressedSize;//size is -1 when unknown
+        //reading
+        z_stream m_stream;
+        bool m_streamInit, m_rawMode, m_atEnd, m_transparent;
+        vector<unsigned char> m_inBuffer, m_history, m_skipBuffer;//history is a circular buffer of the most recent output
+        int64_t m_historyTotal;
+        vector<AccessPoint> m_index;
+        //writing
+        vector<vector<char> > m_pendingBlocks;
+        vector<char> m_curBlock;
+        int m_maxPending;
+        bool m_wroteMember;
+        
+        const static int64_t CHUNK_SIZE, BLOCK_SIZE, INDEX_SPAN, WINDOW_SIZE, INPUT_SIZE, MEMBER_HEADER_SIZE;
+        
+        void buildIndexFromHeaders();
+        bool fillInput();
+        bool skipInput(int64_t count);
+        int64_t inflateData(char* dataOut, const int64_t& count);
+        void finishMember();
+        void addAccessPoint(const bool& memberStart);
+        void restartAt(const AccessPoint& point);
+        void appendHistory(const char* data, int64_t count);
+        void flushPending();
+        static bool compressMember(const vector<char>& dataIn, vector<unsigned char>& memberOut);
     public:
-        ZFileImpl() { m_zfile = NULL; }
+        ZFileImpl();
         void open(const QString& filename, const CaretBinaryFile::OpenMode& opmode);
         void close();
         void seek(const int64_t& position);
         int64_t pos();
-        int64_t size() { return -1; }
+        int64_t size();
         void read(void* dataOut, const int64_t& count, int64_t* numRead);
         void write(const void* dataIn, const int64_t& count);
         ~ZFileImpl();
     };
     
     const int64_t ZFileImpl::CHUNK_SIZE = 1<<26;//64MiB, large enough for good performance, small enough for zlib, must convert to uint32
+    const int64_t ZFileImpl::BLOCK_SIZE = 1<<20;//1MiB of uncompressed data per member, compression ratio is nearly the same as a single stream
+    const int64_t ZFileImpl::INDEX_SPAN = 1<<22;//for files without member sizes, save a resume point (with a 32KB window) about every 4MiB of output
+    const int64_t ZFileImpl::WINDOW_SIZE = 1<<15;
+    const int64_t ZFileImpl::INPUT_SIZE = 1<<18;
+    const int64_t ZFileImpl::MEMBER_HEADER_SIZE = 24;//10 byte gzip header, 2 byte XLEN, 4 byte subfield header, 8 bytes of sizes
 #endif //ZLIB_VERSION
 
     class QFileImpl : public CaretBinaryFile::ImplInterface
@@ -163,29 +206,68 @@ void CaretBinaryFile::write(const void* dataIn, const int64_t& count)
 }
 
 #ifdef ZLIB_VERSION
+namespace
+{
+    void putLE16(unsigned char* out, const uint32_t& value)
+    {
+        out[0] = value & 0xff;
+        out[1] = (value >> 8) & 0xff;
+    }
+    
+    void putLE32(unsigned char* out, const uint32_t& value)
+    {
+        putLE16(out, value & 0xffff);
+        putLE16(out + 2, value >> 16);
+    }
+    
+    uint32_t getLE16(const unsigned char* in)
+    {
+        return ((uint32_t)in[1] << 8) | in[0];
+    }
+    
+    uint32_t getLE32(const unsigned char* in)
+    {
+        return (getLE16(in + 2) << 16) | getLE16(in);
+    }
+}
+
+ZFileImpl::ZFileImpl()
+{
+    m_writing = false;
+    m_uncompressedPos = 0;
+    m_uncompressedSize = -1;
+    m_streamInit = false;
+    m_rawMode = false;
+    m_atEnd = false;
+    m_transparent = false;
+    m_historyTotal = 0;
+    m_maxPending = 1;
+    m_wroteMember = false;
+}
+
 void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& opmode)
 {
     close();//don't need to, but just because
     m_fileName = filename;
-    const char* mode = NULL;
-    switch (opmode)//we only support a limited number of combinations, and the string modes are quirky
+    m_uncompressedPos = 0;
+    m_uncompressedSize = -1;
+    QIODevice::OpenMode mode = QIODevice::NotOpen;
+    switch (opmode)//we only support a limited number of combinations
     {
         case CaretBinaryFile::READ:
-            mode = "rb";
+            m_writing = false;
+            mode = QIODevice::ReadOnly;
             break;
         case CaretBinaryFile::WRITE_TRUNCATE:
             QFile::remove(filename);//attempt to remove file rather than truncating, to improve behavior with file symlinks
-            mode = "wb";//you have to do "w+b" in order to ask it to not truncate, which zlib doesn't support anyway
+            m_writing = true;
+            mode = QIODevice::WriteOnly | QIODevice::Truncate;
             break;
         default:
             throw DataFileException("compressed file only supports READ and WRITE_TRUNCATE modes");
     }
-#if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
-    m_zfile = gzopen64(filename.toLocal8Bit().constData(), mode);
-#else
-    m_zfile = gzopen(filename.toLocal8Bit().constData(), mode);
-#endif
-    if (m_zfile == NULL)
+    m_file.setFileName(filename);
+    if (!m_file.open(mode))
     {
         if (!QFile::exists(filename))
         {
@@ -195,35 +277,287 @@ void ZFileImpl::open(const QString& filename, const CaretBinaryFile::OpenMode& o
             } else {//use same logic as QFile impl for now
                 throw DataFileException("failed to open compressed file '" + filename + "', unable to create file");
             }
-        }//TODO: check gzerror and errno for more informative error messages
+        }
         throw DataFileException("failed to open compressed file '" + filename + "'");
     }
+    if (m_writing)
+    {
+        m_pendingBlocks.clear();
+        m_curBlock.clear();
+        m_curBlock.reserve(BLOCK_SIZE);
+        m_wroteMember = false;
+        m_maxPending = 1;
+#ifdef CARET_OMP
+        m_maxPending = 2 * omp_get_max_threads();//enough blocks to keep every thread busy
+#endif
+        return;
+    }
+    m_inBuffer.resize(INPUT_SIZE);
+    m_history.resize(WINDOW_SIZE);
+    m_historyTotal = 0;
+    m_rawMode = false;
+    m_atEnd = false;
+    unsigned char magic[2];
+    m_transparent = (m_file.peek((char*)magic, 2) != 2 || magic[0] != 0x1f || magic[1] != 0x8b);//like gzread, pass data through if it isn't gzip
+    if (m_transparent)
+    {
+        m_uncompressedSize = m_file.size();
+        return;
+    }
+    memset(&m_stream, 0, sizeof(z_stream));
+    if (inflateInit2(&m_stream, 15 + 16) != Z_OK) throw DataFileException("failed to initialize decompression for file '" + filename + "'");
+    m_streamInit = true;
+    buildIndexFromHeaders();
+    if (!m_file.seek(0)) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    m_stream.avail_in = 0;
+}
+
+void ZFileImpl::buildIndexFromHeaders()
+{//files we wrote have the member sizes in every header, so the whole file can be indexed without inflating anything
+    m_index.clear();
+    int64_t fileSize = m_file.size(), compressedPos = 0, uncompressedPos = 0;
+    unsigned char header[MEMBER_HEADER_SIZE];
+    while (compressedPos < fileSize)
+    {
+        if (!m_file.seek(compressedPos) || m_file.read((char*)header, MEMBER_HEADER_SIZE) != MEMBER_HEADER_SIZE) break;
+        if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || header[3] != 4 || getLE16(header + 10) != 12 ||
+            header[12] != 'W' || header[13] != 'B' || getLE16(header + 14) != 8) break;//not one of ours, index while reading instead
+        int64_t memberSize = getLE32(header + 16);
+        if (memberSize < MEMBER_HEADER_SIZE + 8 || compressedPos + memberSize > fileSize) break;
+        m_index.push_back(AccessPoint());
+        AccessPoint& point = m_index.back();
+        point.m_compressedPos = compressedPos;
+        point.m_uncompressedPos = uncompressedPos;
+        point.m_bits = 0;
+        point.m_memberStart = true;
+        compressedPos += memberSize;
+        uncompressedPos += getLE32(header + 20);
+    }
+    if (m_index.empty())
+    {
+        m_index.push_back(AccessPoint());
+        AccessPoint& point = m_index.back();
+        point.m_compressedPos = 0;
+        point.m_uncompressedPos = 0;
+        point.m_bits = 0;
+        point.m_memberStart = true;
+    } else if (compressedPos == fileSize) {
+        m_uncompressedSize = uncompressedPos;
+    }
+}
+
+bool ZFileImpl::fillInput()
+{//only call when zlib has used all the input, returns false at end of file
+    CaretAssert(m_stream.avail_in == 0);
+    int64_t readret = m_file.read((char*)&m_inBuffer[0], INPUT_SIZE);
+    if (readret < 0) throw DataFileException("error while reading compressed file '" + m_fileName + "'");
+    m_stream.next_in = &m_inBuffer[0];
+    m_stream.avail_in = (uInt)readret;
+    return readret > 0;
+}
+
+bool ZFileImpl::skipInput(int64_t count)
+{
+    while (count > 0)
+    {
+        if (m_stream.avail_in == 0 && !fillInput()) return false;
+        uInt skip = (uInt)min(count, (int64_t)m_stream.avail_in);
+        m_stream.next_in += skip;
+        m_stream.avail_in -= skip;
+        count -= skip;
+    }
+    return true;
+}
+
+void ZFileImpl::appendHistory(const char* data, int64_t count)
+{
+    if (count <= 0) return;
+    m_historyTotal += count;
+    if (count > WINDOW_SIZE)
+    {
+        data += count - WINDOW_SIZE;
+        count = WINDOW_SIZE;
+    }
+    int64_t start = (m_historyTotal - count) % WINDOW_SIZE;
+    int64_t firstPart = min(count, WINDOW_SIZE - start);
+    memcpy(&m_history[start], data, firstPart);
+    if (firstPart < count) memcpy(&m_history[0], data + firstPart, count - firstPart);
+}
+
+void ZFileImpl::addAccessPoint(const bool& memberStart)
+{
+    if (!m_index.empty())
+    {
+        const AccessPoint& last = m_index.back();
+        if (m_uncompressedPos <= last.m_uncompressedPos) return;//we have been here before
+        if (!memberStart && m_uncompressedPos - last.m_uncompressedPos < INDEX_SPAN) return;//member starts are cheap, windows are not
+    }
+    m_index.push_back(AccessPoint());
+    AccessPoint& point = m_index.back();
+    point.m_compressedPos = m_file.pos() - m_stream.avail_in;
+    point.m_uncompressedPos = m_uncompressedPos;
+    point.m_memberStart = memberStart;
+    point.m_bits = 0;
+    if (!memberStart)
+    {
+        point.m_bits = m_stream.data_type & 7;
+        int64_t windowSize = min(m_historyTotal, WINDOW_SIZE);
+        if (windowSize > 0)
+        {
+            point.m_window.resize(windowSize);
+            int64_t start = (m_historyTotal - windowSize) % WINDOW_SIZE;
+            int64_t firstPart = min(windowSize, WINDOW_SIZE - start);
+            memcpy(&point.m_window[0], &m_history[start], firstPart);
+            if (firstPart < windowSize) memcpy(&point.m_window[firstPart], &m_history[0], windowSize - firstPart);
+        }
+    }
+}
+
+void ZFileImpl::restartAt(const AccessPoint& point)
+{
+    if (!m_file.seek(point.m_compressedPos - (point.m_bits != 0 ? 1 : 0))) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    m_stream.avail_in = 0;
+    m_atEnd = false;
+    m_historyTotal = 0;
+    if (point.m_memberStart)
+    {
+        m_rawMode = false;
+        if (inflateReset2(&m_stream, 15 + 16) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");
+    } else {//resume inside a deflate stream, zlib needs the partial byte and the previous 32KB of output
+        m_rawMode = true;
+        if (inflateReset2(&m_stream, -15) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");
+        if (point.m_bits != 0)
+        {
+            if (!fillInput()) throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
+            int partial = *m_stream.next_in;
+            ++m_stream.next_in;
+            --m_stream.avail_in;
+            if (inflatePrime(&m_stream, point.m_bits, partial >> (8 - point.m_bits)) != Z_OK)
+            {
+                throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");
+            }
+        }
+        if (!point.m_window.empty())
+        {
+            if (inflateSetDictionary(&m_stream, &point.m_window[0], point.m_window.size()) != Z_OK)
+            {
+                throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");
+            }
+            appendHistory((const char*)&point.m_window[0], point.m_window.size());
+        }
+    }
+    m_uncompressedPos = point.m_uncompressedPos;
+}
+
+void ZFileImpl::finishMember()
+{
+    if (m_rawMode)
+    {//when resuming inside a member, zlib doesn't know about the gzip trailer, so skip it without checking
+        m_rawMode = false;
+        if (!skipInput(8)) m_atEnd = true;
+    }
+    if (!m_atEnd && m_stream.avail_in == 0 && !fillInput()) m_atEnd = true;
+    if (!m_atEnd && *m_stream.next_in != 0x1f) m_atEnd = true;//like gzip, ignore trailing garbage (usually zero padding)
+    if (m_atEnd)
+    {
+        m_uncompressedSize = m_uncompressedPos;
+        return;
+    }
+    if (inflateReset2(&m_stream, 15 + 16) != Z_OK) throw DataFileException("failed to reset decompression for file '" + m_fileName + "'");
+    m_historyTotal = 0;
+    addAccessPoint(true);
+}
+
+int64_t ZFileImpl::inflateData(char* dataOut, const int64_t& count)
+{//returns less than count only at the end of the data
+    int64_t total = 0;
+    while (total < count && !m_atEnd)
+    {
+        if (m_stream.avail_in == 0 && !fillInput())
+        {//truncated file, let the caller decide whether that is an error
+            m_atEnd = true;
+            break;
+        }
+        uInt iterSize = (uInt)min(count - total, CHUNK_SIZE);
+        m_stream.next_out = (Bytef*)(dataOut + total);
+        m_stream.avail_out = iterSize;
+        int ret = inflate(&m_stream, Z_BLOCK);//stop at deflate block boundaries, so we can save resume points
+        int64_t produced = iterSize - m_stream.avail_out;
+        appendHistory(dataOut + total, produced);
+        total += produced;
+        m_uncompressedPos += produced;
+        switch (ret)
+        {
+            case Z_OK:
+                if ((m_stream.data_type & 128) && !(m_stream.data_type & 64)) addAccessPoint(false);
+                break;
+            case Z_STREAM_END:
+                finishMember();
+                break;
+            case Z_BUF_ERROR://needs more input
+                break;
+            default:
+                throw DataFileException("error while decompressing file '" + m_fileName + "'" + (m_stream.msg != NULL ? QString(": ") + m_stream.msg : QString("")));
+        }
+    }
+    return total;
 }
 
 void ZFileImpl::close()
 {
-    if (m_zfile == NULL) return;//happens when closed and then destroyed, error opening
-    if (gzclose(m_zfile) != 0) throw DataFileException("error closing compressed file '" + m_fileName + "'");
-    m_zfile = NULL;
+    if (!m_file.isOpen()) return;//happens when closed and then destroyed, error opening
+    if (m_writing)
+    {
+        if (!m_curBlock.empty() || (!m_wroteMember && m_pendingBlocks.empty()))//an empty file still needs one member to be valid gzip
+        {
+            m_pendingBlocks.push_back(vector<char>());
+            m_pendingBlocks.back().swap(m_curBlock);
+        }
+        try
+        {
+            flushPending();
+        } catch (...) {
+            m_pendingBlocks.clear();
+            m_file.close();
+            throw;
+        }
+        bool flushed = m_file.flush();
+        m_file.close();
+        if (!flushed) throw DataFileException("error closing compressed file '" + m_fileName + "'");
+    } else {
+        if (m_streamInit) inflateEnd(&m_stream);
+        m_streamInit = false;
+        m_index.clear();
+        m_file.close();
+    }
 }
 
 void ZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
 {
-    if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
+    if (!m_file.isOpen() || m_writing) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
     int64_t totalRead = 0;
-    int readret = 0;//to preserve the info of the read that broke early
-    while (totalRead < count)
+    bool error = false;
+    if (m_transparent)
     {
-        int64_t iterSize = min(count - totalRead, CHUNK_SIZE);
-        readret = gzread(m_zfile, ((char*)dataOut) + totalRead, iterSize);
-        if (readret < 1) break;//0 or -1 indicate eof or error
-        totalRead += readret;
+        while (totalRead < count)
+        {
+            int64_t readret = m_file.read(((char*)dataOut) + totalRead, min(count - totalRead, CHUNK_SIZE));
+            if (readret < 1)//0 or -1 indicate eof or error
+            {
+                error = (readret < 0);
+                break;
+            }
+            totalRead += readret;
+        }
+        m_uncompressedPos += totalRead;
+    } else {
+        totalRead = inflateData((char*)dataOut, count);
     }
     if (numRead == NULL)
     {
         if (totalRead != count)
         {
-            if (readret < 0) throw DataFileException("error while reading compressed file '" + m_fileName + "'");
+            if (error) throw DataFileException("error while reading compressed file '" + m_fileName + "'");
             throw DataFileException("premature end of file in compressed file '" + m_fileName + "'");
         }
     } else {
@@ -233,38 +567,140 @@ void ZFileImpl::read(void* dataOut, const int64_t& count, int64_t* numRead)
 
 void ZFileImpl::seek(const int64_t& position)
 {
-    if (m_zfile == NULL) throw DataFileException("seek called on unopened ZFileImpl");//shouldn't happen
-    if (pos() == position) return;//slight hack, since gzseek is slow or nonfunctional for some cases, so don't try it unless necessary
-#if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
-    int64_t ret = gzseek64(m_zfile, position, SEEK_SET);
-#else
-    int64_t ret = gzseek(m_zfile, position, SEEK_SET);
-#endif
-    if (ret != position) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    if (!m_file.isOpen()) throw DataFileException("seek called on unopened ZFileImpl");//shouldn't happen
+    if (position == m_uncompressedPos) return;
+    if (m_writing)
+    {//like gzseek, only allow moving forward, and fill with zeros
+        if (position < m_uncompressedPos) throw DataFileException("can't seek backwards while writing compressed file '" + m_fileName + "'");
+        vector<char> zeros(min(position - m_uncompressedPos, BLOCK_SIZE), 0);
+        while (m_uncompressedPos < position)
+        {
+            write(&zeros[0], min(position - m_uncompressedPos, (int64_t)zeros.size()));
+        }
+        return;
+    }
+    if (m_transparent)
+    {
+        if (!m_file.seek(position)) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+        m_uncompressedPos = position;
+        return;
+    }
+    if (m_uncompressedSize >= 0 && position > m_uncompressedSize) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
+    int low = 0, high = (int)m_index.size();//find the last resume point at or before the position, first point is always the start of the file
+    CaretAssert(high > 0 && m_index[0].m_uncompressedPos == 0);
+    while (high - low > 1)
+    {
+        int mid = (low + high) / 2;
+        if (m_index[mid].m_uncompressedPos <= position)
+        {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    if (position < m_uncompressedPos || m_index[low].m_uncompressedPos > m_uncompressedPos)
+    {
+        restartAt(m_index[low]);
+    }
+    m_skipBuffer.resize(INPUT_SIZE);
+    while (m_uncompressedPos < position)
+    {
+        if (inflateData((char*)&m_skipBuffer[0], min(position - m_uncompressedPos, (int64_t)INPUT_SIZE)) == 0) break;
+    }
+    if (m_uncompressedPos != position) throw DataFileException("seek failed in compressed file '" + m_fileName + "'");
 }
 
 int64_t ZFileImpl::pos()
 {
-    if (m_zfile == NULL) throw DataFileException("pos called on unopened ZFileImpl");//shouldn't happen
-#if !defined(CARET_OS_MACOSX) && ZLIB_VERNUM > 0x1232
-    return gztell64(m_zfile);
-#else
-    return gztell(m_zfile);
-#endif
+    if (!m_file.isOpen()) throw DataFileException("pos called on unopened ZFileImpl");//shouldn't happen
+    return m_uncompressedPos;
+}
+
+int64_t ZFileImpl::size()
+{
+    if (m_writing) return -1;
+    return m_uncompressedSize;
 }
 
 void ZFileImpl::write(const void* dataIn, const int64_t& count)
 {
-    if (m_zfile == NULL) throw DataFileException("read called on unopened ZFileImpl");//shouldn't happen
+    if (!m_file.isOpen() || !m_writing) throw DataFileException("write called on unopened ZFileImpl");//shouldn't happen
     int64_t totalWritten = 0;
     while (totalWritten < count)
     {
-        int64_t iterSize = min(count - totalWritten, CHUNK_SIZE);
-        int writeret = gzwrite(m_zfile, ((const char*)dataIn) + totalWritten, iterSize);
-        if (writeret < 1) break;//0 or -1 indicate eof or error
-        totalWritten += writeret;
+        int64_t iterSize = min(count - totalWritten, BLOCK_SIZE - (int64_t)m_curBlock.size());
+        m_curBlock.insert(m_curBlock.end(), ((const char*)dataIn) + totalWritten, ((const char*)dataIn) + totalWritten + iterSize);
+        totalWritten += iterSize;
+        if ((int64_t)m_curBlock.size() == BLOCK_SIZE)
+        {
+            m_pendingBlocks.push_back(vector<char>());
+            m_pendingBlocks.back().swap(m_curBlock);
+            m_curBlock.reserve(BLOCK_SIZE);
+            if ((int)m_pendingBlocks.size() >= m_maxPending) flushPending();
+        }
+    }
+    m_uncompressedPos += count;
+}
+
+void ZFileImpl::flushPending()
+{
+    int numBlocks = (int)m_pendingBlocks.size();
+    if (numBlocks == 0) return;
+    vector<vector<unsigned char> > members(numBlocks);
+    vector<char> success(numBlocks, 0);//can't throw from inside omp
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int i = 0; i < numBlocks; ++i)
+    {
+        success[i] = compressMember(m_pendingBlocks[i], members[i]);
+    }
+    m_pendingBlocks.clear();
+    for (int i = 0; i < numBlocks; ++i)
+    {
+        if (!success[i]) throw DataFileException("failed to compress data for file '" + m_fileName + "'");
+        if (m_file.write((const char*)&members[i][0], members[i].size()) != (int64_t)members[i].size())
+        {
+            throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+        }
     }
-    if (totalWritten != count) throw DataFileException("failed to write to compressed file '" + m_fileName + "'");
+    m_wroteMember = true;
+}
+
+bool ZFileImpl::compressMember(const vector<char>& dataIn, vector<unsigned char>& memberOut)
+{//each member is a complete gzip stream, with our sizes in a header extra field
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    uLong bound = deflateBound(&stream, dataIn.size());
+    memberOut.resize(MEMBER_HEADER_SIZE + bound + 8);
+    stream.next_in = (Bytef*)(dataIn.empty() ? NULL : &dataIn[0]);
+    stream.avail_in = (uInt)dataIn.size();
+    stream.next_out = &memberOut[MEMBER_HEADER_SIZE];
+    stream.avail_out = (uInt)bound;
+    int ret = deflate(&stream, Z_FINISH);//output has room for the worst case, so this always finishes
+    uLong deflatedSize = bound - stream.avail_out;
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END) return false;
+    uint32_t memberSize = MEMBER_HEADER_SIZE + deflatedSize + 8;
+    unsigned char* header = &memberOut[0];
+    header[0] = 0x1f;//gzip magic
+    header[1] = 0x8b;
+    header[2] = 8;//deflate
+    header[3] = 4;//FEXTRA
+    putLE32(header + 4, 0);//no modification time
+    header[8] = 0;
+    header[9] = 255;//unknown OS
+    putLE16(header + 10, 12);//XLEN
+    header[12] = 'W';//subfield ID
+    header[13] = 'B';
+    putLE16(header + 14, 8);//subfield length
+    putLE32(header + 16, memberSize);
+    putLE32(header + 20, dataIn.size());
+    uLong crc = crc32(0L, Z_NULL, 0);
+    if (!dataIn.empty()) crc = crc32(crc, (const Bytef*)&dataIn[0], dataIn.size());
+    putLE32(&memberOut[MEMBER_HEADER_SIZE + deflatedSize], crc);
+    putLE32(&memberOut[MEMBER_HEADER_SIZE + deflatedSize + 4], dataIn.size());
+    memberOut.resize(memberSize);
+    return true;
 }
 
 ZFileImpl::~ZFileImpl()
@@ -99,6 +99,12 @@ CaretPreferences::CaretPreferences()
                                                                                    CaretPreferenceDataValue::SavedInScene::SAVE_NO,
                                                                                    FileOpenFromOpSysTypeEnum::toName(FileOpenFromOpSysTypeEnum::ASK_USER)));
     
+    m_matrixTileCacheSizeGigabytesPreference.reset(new CaretPreferenceDataValue(this->qSettings,
+                                                                                "matrixTileCacheSizeGigabytes",
+                                                                                CaretPreferenceDataValue::DataType::INTEGER,
+                                                                                CaretPreferenceDataValue::SavedInScene::SAVE_NO,
+                                                                                0));
+    
     m_identificationDisplayModePreference.reset(new CaretPreferenceDataValue(this->qSettings,
                                                                              "identificationDisplayMode",
                                                                              CaretPreferenceDataValue::DataType::STRING,
@@ -1397,6 +1403,28 @@ CaretPreferences::setFileOpenFromOpSysType(const FileOpenFromOpSysTypeEnum::Enum
     m_fileOpenFromOperatingSystemTypePreference->setValue(stringValue);
 }
 
+/**
+ * @return Maximum size of the matrix tile cache files written to the
+ * user's cache directory in gigabytes, zero if the cache is off.
+ */
+int32_t
+CaretPreferences::getMatrixTileCacheSizeGigabytes() const
+{
+    return m_matrixTileCacheSizeGigabytesPreference->getValue().toInt();
+}
+
+/**
+ * Set the maximum size of the matrix tile cache files.
+ *
+ * @param sizeGigabytes
+ *     New size in gigabytes, zero turns the cache off.
+ */
+void
+CaretPreferences::setMatrixTileCacheSizeGigabytes(const int32_t sizeGigabytes)
+{
+    m_matrixTileCacheSizeGigabytesPreference->setValue(sizeGigabytes);
+}
+
 /**
  * @return The identification display mode
  */
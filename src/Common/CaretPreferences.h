@@ -103,6 +103,10 @@ namespace caret {
         
         void setFileOpenFromOpSysType(const FileOpenFromOpSysTypeEnum::Enum openType);
         
+        int32_t getMatrixTileCacheSizeGigabytes() const;
+        
+        void setMatrixTileCacheSizeGigabytes(const int32_t sizeGigabytes);
+        
         IdentificationDisplayModeEnum::Enum getIdentificationDisplayMode() const;
         
         void setIdentificationDisplayMode(const IdentificationDisplayModeEnum::Enum identificationDisplayMode);
@@ -337,6 +341,8 @@ namespace caret {
         
         std::unique_ptr<CaretPreferenceDataValue> m_fileOpenFromOperatingSystemTypePreference;
         
+        std::unique_ptr<CaretPreferenceDataValue> m_matrixTileCacheSizeGigabytesPreference;
+        
         std::vector<CaretPreferenceDataValue*> m_preferenceStoredInSceneDataValues;
         
         bool splashScreenEnabled;
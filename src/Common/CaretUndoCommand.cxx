@@ -198,3 +198,15 @@ CaretUndoCommand::mergeWith(const CaretUndoCommand* /*command*/)
     return false;
 }
 
+/**
+ * @return Approximate memory used by this command, in bytes.
+ *
+ * Used by CaretUndoStack to enforce its memory limit.  Subclasses
+ * that hold large amounts of data should override this method;
+ * the default implementation returns only the size of the base object.
+ */
+int64_t
+CaretUndoCommand::getSizeInBytes() const
+{
+    return sizeof(CaretUndoCommand) + m_description.size() * sizeof(QChar);
+}
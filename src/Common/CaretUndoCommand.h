@@ -91,6 +91,8 @@ namespace caret {
         
         virtual bool mergeWith(const CaretUndoCommand* command);
 
+        virtual int64_t getSizeInBytes() const;
+
         int32_t getWindowIndex() const;
         
         void setWindowIndex(const int32_t windowIndex);
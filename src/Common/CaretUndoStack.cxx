@@ -110,6 +110,7 @@ CaretUndoStack::CaretUndoStack()
 {
     m_undoLimit      =  0;
     m_undoStackIndex =  0;
+    m_memoryLimit    =  0;
 }
 
 /**
@@ -343,6 +344,11 @@ CaretUndoStack::push(CaretUndoCommand* newCommand)
             CaretAssert(command);
             if (command->mergeWith(newCommand)) {
                 delete newCommand;
+                /*
+                 * Merged command may now use more memory
+                 */
+                m_undoStackIndex = count();
+                applyMemoryLimit();
                 return;
             }
         }
@@ -362,6 +368,8 @@ CaretUndoStack::push(CaretUndoCommand* newCommand)
     }
     
     m_undoStackIndex = count();
+    
+    applyMemoryLimit();
 }
 
 /**
@@ -577,6 +585,80 @@ CaretUndoStack::setUndoLimit(const int32_t undoLimit)
     }
 }
 
+/**
+ * @return The memory limit, in bytes, for commands on the stack.
+ * Zero indicates that there is no limit.
+ */
+int64_t
+CaretUndoStack::getMemoryLimit() const
+{
+    return m_memoryLimit;
+}
+
+/**
+ * When the memory used by the commands on the stack exceeds the memory
+ * limit, the oldest commands are deleted from the bottom of the stack
+ * until the stack is within the limit.  The most recent command is
+ * never deleted, nor are commands that have been undone (and may be
+ * redone).  The default value is 0, which means that there is no limit.
+ *
+ * Unlike setUndoLimit(), this may be called on a non-empty stack.
+ *
+ * @param memoryLimitInBytes
+ *     New value for the maximum memory used by commands on the stack.
+ */
+void
+CaretUndoStack::setMemoryLimit(const int64_t memoryLimitInBytes)
+{
+    if (memoryLimitInBytes >= 0) {
+        m_memoryLimit = memoryLimitInBytes;
+        applyMemoryLimit();
+    }
+    else {
+        CaretLogWarning("CaretUndoStack::setMemoryLimit() called with invalid value="
+                        + AString::number(memoryLimitInBytes));
+    }
+}
+
+/**
+ * @return Approximate memory, in bytes, used by the commands on the stack.
+ */
+int64_t
+CaretUndoStack::getSizeInBytes() const
+{
+    int64_t totalSize = 0;
+    for (std::deque<CaretUndoCommand*>::const_iterator iter = m_undoStack.begin();
+         iter != m_undoStack.end();
+         iter++) {
+        totalSize += (*iter)->getSizeInBytes();
+    }
+    
+    return totalSize;
+}
+
+/**
+ * Delete the oldest command(s) that have been redone while the commands
+ * on the stack use more memory than the memory limit.
+ */
+void
+CaretUndoStack::applyMemoryLimit()
+{
+    if (m_memoryLimit <= 0) {
+        return;
+    }
+    
+    int64_t totalSize = getSizeInBytes();
+    while ((totalSize > m_memoryLimit)
+           && (count() > 1)
+           && (m_undoStackIndex > 0)) {
+        CaretUndoCommand* oldestCommand = m_undoStack.front();
+        totalSize -= oldestCommand->getSizeInBytes();
+        delete oldestCommand;
+        m_undoStack.pop_front();
+        --m_undoStackIndex;
+    }
+}
+
 /**
  * Apply a 'redo' using the given command.
  *
@@ -122,6 +122,12 @@ namespace caret {
         
         void setUndoLimit(const int32_t undoLimit);
         
+        int64_t getMemoryLimit() const;
+        
+        void setMemoryLimit(const int64_t memoryLimitInBytes);
+        
+        int64_t getSizeInBytes() const;
+        
         // ADD_NEW_METHODS_HERE
 
     protected:
@@ -136,6 +142,8 @@ namespace caret {
 
         CaretUndoStack& operator=(const CaretUndoStack&);
         
+        void applyMemoryLimit();
+        
         /** 
          * The undo "stack".  A deque is used so that items
          * can be removed when the size of the "stack" exceeds
@@ -150,6 +158,11 @@ namespace caret {
         
         int32_t m_undoLimit;
         
+        /**
+         * Maximum memory, in bytes, used by commands on the stack (zero is no limit).
+         */
+        int64_t m_memoryLimit;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
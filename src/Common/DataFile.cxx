@@ -85,6 +85,7 @@ DataFile::copyHelperDataFile(const DataFile& df)
     m_fileReadWarnings = df.m_fileReadWarnings;
     m_modifiedFlag = false;
     m_timeOfLastReadOrWrite = QDateTime();
+    m_sizeOfLastReadOrWrite = -1;
 }
 
 /**
@@ -97,6 +98,7 @@ DataFile::initializeMembersDataFile()
     m_fileReadWarnings.clear();
     m_modifiedFlag = false;
     m_timeOfLastReadOrWrite = QDateTime();
+    m_sizeOfLastReadOrWrite = -1;
 }
 
 /**
@@ -331,17 +333,23 @@ DataFile::getFileReadWarnings() const
 
 /**
  * Set the time this file was last read or written to the current time.
+ * The size of the file is also saved since a file may be replaced
+ * without a change in its modification time.
  */
 void
 DataFile::setTimeOfLastReadOrWrite()
 {
     m_timeOfLastReadOrWrite = getLastModifiedTime();
+    m_sizeOfLastReadOrWrite = getFileSizeOnDisk();
 }
 
 /**
  * @return True if this file been modified since it was last read or written.
  * (modified by an external program)?
  *
+ * The file's modification time and its size must both match
+ * their values when the file was last read or written.
+ *
  * If any of these conditions are met, false is returned:
  * (1) The name is empty; (2) The file is on the network;
  * (3) The file does not exist; (4) The modified time
@@ -377,6 +385,16 @@ DataFile::isModifiedSinceTimeOfLastReadOrWrite() const
         return true;
     }
     
+    /*
+     * Same time but a different size (file replaced or
+     * modified within the file system's time resolution)
+     */
+    if (m_sizeOfLastReadOrWrite >= 0) {
+        if (getFileSizeOnDisk() != m_sizeOfLastReadOrWrite) {
+            return true;
+        }
+    }
+    
     return false;
 }
 
@@ -413,4 +431,28 @@ DataFile::getLastModifiedTime() const
     return lastModTime;
 }
 
+/**
+ * @return Size of the file in bytes, or negative if the size is not
+ * available for the same reasons as getLastModifiedTime().
+ */
+int64_t
+DataFile::getFileSizeOnDisk() const
+{
+    const AString name = getFileName();
+    if (name.isEmpty()) {
+        return -1;
+    }
+    
+    if (isFileOnNetwork(name)) {
+        return -1;
+    }
+    
+    QFileInfo fileInfo(name);
+    if ( ! fileInfo.exists()) {
+        return -1;
+    }
+    
+    return fileInfo.size();
+}
+
 
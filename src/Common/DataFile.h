@@ -110,6 +110,8 @@ namespace caret {
         
         QDateTime getLastModifiedTime() const;
         
+        int64_t getFileSizeOnDisk() const;
+        
         /** name of data file */
         AString m_filename;
         
@@ -120,6 +122,8 @@ namespace caret {
         bool m_modifiedFlag;
         
         QDateTime m_timeOfLastReadOrWrite;
+        
+        int64_t m_sizeOfLastReadOrWrite;
     };
     
 } // namespace
@@ -241,6 +241,10 @@ EventTypeEnum::initialize()
     enumData.push_back(EventTypeEnum(EVENT_CHART_MATRIX_YOKING_VALIDATION,
                                      "EVENT_CHART_MATRIX_YOKING_VALIDATION",
                                      "Validate Yoking of matrix chart's rows/columns"));
+    
+    enumData.push_back(EventTypeEnum(EVENT_GRAPHICS_MESH_READY,
+                                     "EVENT_GRAPHICS_MESH_READY",
+                                     "Graphics mesh built in background is ready"));
     enumData.push_back(EventTypeEnum(EVENT_GRAPHICS_OPENGL_CREATE_BUFFER_OBJECT,
                                      "EVENT_GRAPHICS_OPENGL_CREATE_BUFFER_OBJECT",
                                      "Create an OpenGL Buffer Object for an OpenGL Context"));
@@ -154,6 +154,8 @@ public:
         EVENT_GET_USER_INPUT_MODE,
         /** Get the viewport size for model, tab, window */
         EVENT_GET_VIEWPORT_SIZE,
+        /** A graphics mesh built in the background is ready for drawing */
+        EVENT_GRAPHICS_MESH_READY,
         /** Create a buffer object for an OpenGL context */
         EVENT_GRAPHICS_OPENGL_CREATE_BUFFER_OBJECT,
         /** Create a texture name for an OpenGL context */
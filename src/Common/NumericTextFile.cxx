@@ -0,0 +1,337 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "NumericTextFile.h"
+
+#include "CaretOMP.h"
+#include "DataFileException.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //powers of ten that are exact as doubles
+    const double EXACT_POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    
+    bool isDigit(const char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+    
+    bool matchesWord(const char* pos, const char* end, const char* word)
+    {//case insensitive, word must be lowercase
+        int64_t length = strlen(word);
+        if (end - pos < length) return false;
+        for (int64_t i = 0; i < length; ++i)
+        {
+            char c = pos[i];
+            if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+            if (c != word[i]) return false;
+        }
+        return true;
+    }
+    
+    int getNumPieces()
+    {
+#ifdef CARET_OMP
+        return omp_get_max_threads() * 4;//some extra for load balancing
+#else
+        return 1;
+#endif
+    }
+}
+
+void NumericTextFile::open(const AString& fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        throw DataFileException(fileName, "failed to open text file: " + m_file.errorString());
+    }
+    m_size = m_file.size();
+    if (m_size == 0)
+    {
+        m_data = "";
+        return;
+    }
+    m_data = (const char*)m_file.map(0, m_size);
+    if (m_data == NULL)
+    {//some filesystems don't support mapping
+        m_fallback = m_file.readAll();
+        if ((int64_t)m_fallback.size() != m_size)
+        {
+            QString errorString = m_file.errorString();
+            close();
+            throw DataFileException(fileName, "failed to read text file: " + errorString);
+        }
+        m_data = m_fallback.constData();
+    }
+}
+
+void NumericTextFile::close()
+{
+    m_file.close();//also unmaps
+    m_fallback.clear();
+    m_data = NULL;
+    m_size = 0;
+}
+
+vector<NumericTextFile::Range> NumericTextFile::getLineAlignedRanges(const int64_t& numPieces) const
+{
+    vector<Range> ret;
+    if (m_size == 0) return ret;
+    const int64_t pieces = max(numPieces, (int64_t)1);
+    int64_t start = 0;
+    for (int64_t i = 1; i <= pieces && start < m_size; ++i)
+    {
+        int64_t target = (i == pieces ? m_size : m_size * i / pieces);
+        if (target <= start) continue;
+        int64_t end = m_size;
+        if (target < m_size)
+        {//the previous character may already be a newline
+            const char* newline = (const char*)memchr(m_data + target - 1, '\n', m_size - target + 1);
+            if (newline != NULL) end = newline - m_data + 1;
+        }
+        Range myRange;
+        myRange.m_start = start;
+        myRange.m_end = end;
+        ret.push_back(myRange);
+        start = end;
+    }
+    return ret;
+}
+
+vector<NumericTextFile::Range> NumericTextFile::findLines() const
+{
+    vector<Range> pieces = getLineAlignedRanges(getNumPieces());
+    vector<vector<Range> > pieceLines(pieces.size());
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < (int64_t)pieces.size(); ++i)
+    {
+        int64_t pos = pieces[i].m_start;
+        const int64_t end = pieces[i].m_end;
+        while (pos < end)
+        {
+            const char* newline = (const char*)memchr(m_data + pos, '\n', end - pos);
+            Range myLine;
+            myLine.m_start = pos;
+            myLine.m_end = (newline == NULL ? end : newline - m_data);
+            pos = myLine.m_end + 1;
+            if (myLine.m_end > myLine.m_start && m_data[myLine.m_end - 1] == '\r') --myLine.m_end;
+            if (newline == NULL && myLine.m_end == myLine.m_start) break;//trailing empty text after the last newline isn't a line
+            pieceLines[i].push_back(myLine);
+        }
+    }
+    vector<Range> ret;
+    for (size_t i = 0; i < pieceLines.size(); ++i)
+    {
+        ret.insert(ret.end(), pieceLines[i].begin(), pieceLines[i].end());
+    }
+    return ret;
+}
+
+bool NumericTextFile::parseInt(const char*& pos, const char* end, int64_t& valueOut)
+{
+    const char* myPos = pos;
+    bool negative = false;
+    if (myPos < end && (*myPos == '-' || *myPos == '+'))
+    {
+        negative = (*myPos == '-');
+        ++myPos;
+    }
+    if (myPos >= end || !isDigit(*myPos)) return false;
+    uint64_t value = 0;
+    const uint64_t limit = uint64_t(numeric_limits<int64_t>::max());
+    while (myPos < end && isDigit(*myPos))
+    {
+        uint64_t digit = *myPos - '0';
+        if (value > (limit - digit) / 10) return false;
+        value = value * 10 + digit;
+        ++myPos;
+    }
+    valueOut = (negative ? -int64_t(value) : int64_t(value));
+    pos = myPos;
+    return true;
+}
+
+bool NumericTextFile::parseDouble(const char*& pos, const char* end, double& valueOut)
+{
+    const char* myPos = pos;
+    bool negative = false;
+    if (myPos < end && (*myPos == '-' || *myPos == '+'))
+    {
+        negative = (*myPos == '-');
+        ++myPos;
+    }
+    if (myPos < end && !isDigit(*myPos) && *myPos != '.')
+    {
+        if (matchesWord(myPos, end, "nan"))
+        {
+            valueOut = numeric_limits<double>::quiet_NaN();
+            pos = myPos + 3;
+            return true;
+        }
+        if (matchesWord(myPos, end, "inf"))
+        {
+            valueOut = (negative ? -numeric_limits<double>::infinity() : numeric_limits<double>::infinity());
+            pos = myPos + (matchesWord(myPos, end, "infinity") ? 8 : 3);
+            return true;
+        }
+        return false;
+    }
+    uint64_t mantissa = 0;
+    int numDigits = 0, exponent = 0;
+    bool anyDigits = false, exact = true;
+    while (myPos < end && isDigit(*myPos))
+    {
+        anyDigits = true;
+        if (mantissa != 0 || *myPos != '0')
+        {
+            if (numDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*myPos - '0');
+                ++numDigits;
+            } else {
+                ++exponent;
+                if (*myPos != '0') exact = false;
+            }
+        }
+        ++myPos;
+    }
+    if (myPos < end && *myPos == '.')
+    {
+        ++myPos;
+        while (myPos < end && isDigit(*myPos))
+        {
+            anyDigits = true;
+            if (mantissa == 0 && *myPos == '0')
+            {
+                --exponent;
+            } else if (numDigits < 19) {
+                mantissa = mantissa * 10 + (*myPos - '0');
+                ++numDigits;
+                --exponent;
+            } else if (*myPos != '0') {
+                exact = false;
+            }
+            ++myPos;
+        }
+    }
+    if (!anyDigits) return false;
+    if (myPos < end && (*myPos == 'e' || *myPos == 'E'))
+    {
+        const char* expPos = myPos + 1;
+        int64_t expValue;
+        if (expPos < end && (isDigit(*expPos) || *expPos == '-' || *expPos == '+') && parseInt(expPos, end, expValue))
+        {
+            if (expValue > 100000 || expValue < -100000)
+            {
+                exact = false;
+            } else {
+                exponent += (int)expValue;
+            }
+            myPos = expPos;
+        }//otherwise, the 'e' isn't part of the number
+    }
+    if (mantissa == 0)
+    {
+        valueOut = (negative ? -0.0 : 0.0);
+    } else if (exact && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double value = double(mantissa);//exact, so a single multiply or divide gives the correctly rounded result
+        if (exponent < 0)
+        {
+            value /= EXACT_POWERS_OF_TEN[-exponent];
+        } else {
+            value *= EXACT_POWERS_OF_TEN[exponent];
+        }
+        valueOut = (negative ? -value : value);
+    } else {//rare, let Qt do the correct rounding, it doesn't depend on locale
+        bool ok = false;
+        valueOut = QByteArray(pos, myPos - pos).toDouble(&ok);
+        if (!ok) return false;
+    }
+    pos = myPos;
+    return true;
+}
+
+void NumericTextFile::appendNumber(string& text, const float value)
+{
+    const double myValue = value;
+    if (std::isnan(myValue))
+    {
+        text += "nan";
+        return;
+    }
+    if (std::isinf(myValue))
+    {
+        text += (myValue > 0.0 ? "inf" : "-inf");
+        return;
+    }
+    if (myValue != 0.0 && myValue == std::floor(myValue) && std::abs(myValue) < 1e6)
+    {//integers below a million have no exponent or decimal point in 'g' format with precision 6
+        char buffer[24];
+        char* start = buffer + sizeof(buffer);
+        int64_t intValue = (int64_t)myValue;
+        uint64_t digits = (intValue < 0 ? -intValue : intValue);
+        do
+        {
+            *(--start) = '0' + digits % 10;
+            digits /= 10;
+        } while (digits != 0);
+        if (intValue < 0) *(--start) = '-';
+        text.append(start, buffer + sizeof(buffer) - start);
+        return;
+    }
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "%g", myValue);
+    for (int i = 0; i < length; ++i)
+    {//the C library may use the decimal separator of the current locale
+        char c = buffer[i];
+        if (!isDigit(c) && c != '-' && c != '+' && c != 'e' && c != '.') buffer[i] = '.';
+    }
+    text.append(buffer, length);
+}
+
+void NumericTextFile::formatRows(const float* data, const int64_t& numRows, const int64_t& rowLength, const string& delim, vector<string>& rowTextOut)
+{
+    rowTextOut.resize(numRows);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        string& myText = rowTextOut[i];
+        myText.clear();
+        myText.reserve(rowLength * (8 + delim.size()));
+        const float* myRow = data + i * rowLength;
+        for (int64_t j = 0; j < rowLength; ++j)
+        {
+            if (j != 0) myText += delim;
+            appendNumber(myText, myRow[j]);
+        }
+        myText += '\n';
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef __NUMERIC_TEXT_FILE_H__
+#define __NUMERIC_TEXT_FILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include <QByteArray>
+#include <QFile>
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace caret {
+    
+    //read-only view of a whole text file (memory mapped when possible) for parsing numbers in parallel, and locale-independent number parsing and formatting
+    class NumericTextFile
+    {
+    public:
+        struct Range
+        {
+            int64_t m_start, m_end;//byte offsets, end is exclusive
+        };
+        NumericTextFile() : m_data(NULL), m_size(0) { }
+        ~NumericTextFile() { close(); }
+        void open(const AString& fileName);//throws DataFileException
+        void close();
+        const char* getData() const { return m_data; }
+        int64_t getSize() const { return m_size; }
+        ///splits the file into at most numPieces ranges that each start at the beginning of a line and end after a newline (or at end of file)
+        std::vector<Range> getLineAlignedRanges(const int64_t& numPieces) const;
+        ///all lines, without the newline or a carriage return before it, found in parallel - a final line with no newline is included if it isn't empty
+        std::vector<Range> findLines() const;
+        
+        static bool isSpace(const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; }
+        ///parse an integer that starts exactly at pos, on success pos is moved past it
+        static bool parseInt(const char*& pos, const char* end, int64_t& valueOut);
+        ///parse a floating point number (including nan and inf) that starts exactly at pos, on success pos is moved past it
+        static bool parseDouble(const char*& pos, const char* end, double& valueOut);
+        ///appends the same text as AString::number(value)
+        static void appendNumber(std::string& text, const float value);
+        ///formats each row as text in parallel, elements separated by delim, each row ending in a newline
+        static void formatRows(const float* data, const int64_t& numRows, const int64_t& rowLength, const std::string& delim, std::vector<std::string>& rowTextOut);
+    private:
+        NumericTextFile(const NumericTextFile&);
+        NumericTextFile& operator=(const NumericTextFile&);
+        QFile m_file;
+        QByteArray m_fallback;//file contents, if mapping isn't possible
+        const char* m_data;
+        int64_t m_size;
+    };
+    
+} //namespace caret
+
+#endif //__NUMERIC_TEXT_FILE_H__
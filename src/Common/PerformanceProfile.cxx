@@ -0,0 +1,361 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PerformanceProfile.h"
+
+#include "CaretMutex.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+#ifdef CARET_OS_WINDOWS
+#include "windows.h"
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+bool PerformanceProfile::s_enabled = false;
+
+namespace
+{
+    struct PhaseRecord
+    {
+        AString m_name;
+        int64_t m_calls;
+        double m_wallSeconds, m_cpuSeconds;
+        PhaseRecord() : m_calls(0), m_wallSeconds(0.0), m_cpuSeconds(0.0) { }
+    };
+    
+    struct FileRecord
+    {
+        AString m_name;
+        int64_t m_bytesRead, m_bytesWritten;
+        double m_readSeconds, m_writeSeconds;
+        bool m_inMemory;//pipeline @name files are handed between steps without touching the disk
+        FileRecord() : m_bytesRead(0), m_bytesWritten(0), m_readSeconds(0.0), m_writeSeconds(0.0), m_inMemory(false) { }
+    };
+    
+    //records are kept in the order they were first seen, maps give their index
+    struct ProfileData
+    {
+        CaretMutex m_mutex;
+        AString m_outputFileName;
+        chrono::steady_clock::time_point m_startTime;
+        double m_startCpuSeconds;
+        vector<PhaseRecord> m_phases;
+        map<AString, size_t> m_phaseIndex;
+        vector<FileRecord> m_files;
+        map<AString, size_t> m_fileIndex;
+        ProfileData() : m_startTime(chrono::steady_clock::now()), m_startCpuSeconds(0.0) { }
+    };
+    
+    ProfileData& getData()
+    {
+        static ProfileData theData;
+        return theData;
+    }
+    
+    FileRecord& getFileRecord(ProfileData& data, const AString& fileName, const bool inMemoryFlag)
+    {//call with the mutex locked
+        const AString absName = (inMemoryFlag ? fileName : QFileInfo(fileName).absoluteFilePath());
+        map<AString, size_t>::iterator iter = data.m_fileIndex.find(absName);
+        if (iter != data.m_fileIndex.end())
+        {
+            return data.m_files[iter->second];
+        }
+        data.m_fileIndex[absName] = data.m_files.size();
+        data.m_files.push_back(FileRecord());
+        data.m_files.back().m_name = absName;
+        data.m_files.back().m_inMemory = inMemoryFlag;
+        return data.m_files.back();
+    }
+    
+    double utilization(const double cpuSeconds, const double wallSeconds, const int numThreads)
+    {
+        if (wallSeconds <= 0.0 || numThreads < 1) return 0.0;
+        return cpuSeconds / (wallSeconds * numThreads);
+    }
+}
+
+/**
+ * Start collecting a profile, to be written to a file by writeProfile().
+ * Records from any previous profile are discarded.
+ *
+ * @param outputFileName
+ *    Name of the JSON file to write.
+ */
+void PerformanceProfile::enable(const AString& outputFileName)
+{
+    ProfileData& data = getData();
+    CaretMutexLocker locked(&data.m_mutex);
+    data.m_outputFileName = outputFileName;
+    data.m_startTime = chrono::steady_clock::now();
+    data.m_startCpuSeconds = getProcessCpuSeconds();
+    data.m_phases.clear();
+    data.m_phaseIndex.clear();
+    data.m_files.clear();
+    data.m_fileIndex.clear();
+    s_enabled = true;
+}
+
+/**
+ * Stop collecting, for when the process runs more than one command (wb_command -server).
+ */
+void PerformanceProfile::disable()
+{
+    ProfileData& data = getData();
+    CaretMutexLocker locked(&data.m_mutex);
+    s_enabled = false;
+}
+
+/**
+ * Add time to a named phase.  Repeated phases accumulate, and count the calls.
+ *
+ * @param phaseName
+ *    Name of the phase.
+ * @param wallSeconds
+ *    Elapsed time of the phase.
+ * @param cpuSeconds
+ *    CPU time used by the process (all threads) during the phase.
+ */
+void PerformanceProfile::addPhaseTime(const AString& phaseName, const double wallSeconds, const double cpuSeconds)
+{
+    if (!s_enabled) return;
+    ProfileData& data = getData();
+    CaretMutexLocker locked(&data.m_mutex);
+    map<AString, size_t>::iterator iter = data.m_phaseIndex.find(phaseName);
+    if (iter == data.m_phaseIndex.end())
+    {
+        iter = data.m_phaseIndex.insert(make_pair(phaseName, data.m_phases.size())).first;
+        data.m_phases.push_back(PhaseRecord());
+        data.m_phases.back().m_name = phaseName;
+    }
+    PhaseRecord& record = data.m_phases[iter->second];
+    ++record.m_calls;
+    record.m_wallSeconds += wallSeconds;
+    record.m_cpuSeconds += cpuSeconds;
+}
+
+/**
+ * Record that a file was read, using its size on disk as the number of bytes.
+ *
+ * @param fileName
+ *    Name of the file.
+ * @param seconds
+ *    Time taken to read the file.
+ * @param inMemoryFlag
+ *    True if the file is an in-memory file of a pipeline, it is marked
+ *    as in memory and no bytes are counted.
+ */
+void PerformanceProfile::addFileRead(const AString& fileName, const double seconds, const bool inMemoryFlag)
+{
+    if (!s_enabled) return;
+    ProfileData& data = getData();
+    CaretMutexLocker locked(&data.m_mutex);
+    FileRecord& record = getFileRecord(data, fileName, inMemoryFlag);
+    if (!inMemoryFlag)
+    {
+        record.m_bytesRead += QFileInfo(fileName).size();
+    }
+    record.m_readSeconds += seconds;
+}
+
+/**
+ * Record that a file was written, using its size on disk as the number of bytes.
+ *
+ * @param fileName
+ *    Name of the file.
+ * @param seconds
+ *    Time taken to write the file.
+ * @param inMemoryFlag
+ *    True if the file is an in-memory file of a pipeline, it is marked
+ *    as in memory and no bytes are counted.
+ */
+void PerformanceProfile::addFileWritten(const AString& fileName, const double seconds, const bool inMemoryFlag)
+{
+    if (!s_enabled) return;
+    ProfileData& data = getData();
+    CaretMutexLocker locked(&data.m_mutex);
+    FileRecord& record = getFileRecord(data, fileName, inMemoryFlag);
+    if (!inMemoryFlag)
+    {
+        record.m_bytesWritten += QFileInfo(fileName).size();
+    }
+    record.m_writeSeconds += seconds;
+}
+
+/**
+ * Write the profile as JSON to the file given to enable().  Does nothing if not enabled.
+ *
+ * @param commandLine
+ *    The command line of the run.
+ * @param successFlag
+ *    Whether the command completed without error.
+ */
+void PerformanceProfile::writeProfile(const AString& commandLine, const bool successFlag)
+{
+    if (!s_enabled) return;
+    ProfileData& data = getData();
+    CaretMutexLocker locked(&data.m_mutex);
+    const double wallSeconds = getWallSeconds();
+    const double cpuSeconds = getProcessCpuSeconds() - data.m_startCpuSeconds;
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    QJsonObject root;
+    root["command_line"] = commandLine;
+    root["status"] = (successFlag ? "success" : "error");
+    root["wall_seconds"] = wallSeconds;
+    root["cpu_seconds"] = cpuSeconds;
+    root["omp_threads"] = numThreads;
+    root["thread_utilization"] = utilization(cpuSeconds, wallSeconds, numThreads);
+    const int64_t peakRSS = getPeakResidentBytes();
+    if (peakRSS >= 0)
+    {
+        root["peak_rss_bytes"] = (double)peakRSS;//JSON numbers are doubles anyway
+    }
+    QJsonArray phases;
+    for (size_t i = 0; i < data.m_phases.size(); ++i)
+    {
+        const PhaseRecord& record = data.m_phases[i];
+        QJsonObject phase;
+        phase["name"] = record.m_name;
+        phase["calls"] = (double)record.m_calls;
+        phase["wall_seconds"] = record.m_wallSeconds;
+        phase["cpu_seconds"] = record.m_cpuSeconds;
+        phase["thread_utilization"] = utilization(record.m_cpuSeconds, record.m_wallSeconds, numThreads);
+        phases.append(phase);
+    }
+    root["phases"] = phases;
+    QJsonArray files;
+    for (size_t i = 0; i < data.m_files.size(); ++i)
+    {
+        const FileRecord& record = data.m_files[i];
+        QJsonObject file;
+        file["name"] = record.m_name;
+        file["in_memory"] = record.m_inMemory;
+        file["bytes_read"] = (double)record.m_bytesRead;
+        file["read_seconds"] = record.m_readSeconds;
+        file["bytes_written"] = (double)record.m_bytesWritten;
+        file["write_seconds"] = record.m_writeSeconds;
+        files.append(file);
+    }
+    root["files"] = files;
+    QFile outFile(data.m_outputFileName);
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        throw DataFileException(data.m_outputFileName, "failed to open profile output file: " + outFile.errorString());
+    }
+    const QByteArray json = QJsonDocument(root).toJson();
+    if (outFile.write(json) != json.size())
+    {
+        throw DataFileException(data.m_outputFileName, "failed to write profile output file: " + outFile.errorString());
+    }
+}
+
+/**
+ * @return Elapsed time since the profile was enabled (or since first use).
+ */
+double PerformanceProfile::getWallSeconds()
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - getData().m_startTime).count();
+}
+
+/**
+ * @return CPU time (user and system, all threads) used by the process so far.
+ */
+double PerformanceProfile::getProcessCpuSeconds()
+{
+#ifdef CARET_OS_WINDOWS
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0.0;
+    const uint64_t kernel100ns = (((uint64_t)kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+    const uint64_t user100ns = (((uint64_t)userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+    return (kernel100ns + user100ns) * 1e-7;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+/**
+ * @return Peak resident memory of the process in bytes, or -1 if not available on this platform.
+ */
+int64_t PerformanceProfile::getPeakResidentBytes()
+{
+#ifdef CARET_OS_WINDOWS
+    return -1;//would need psapi
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef CARET_OS_MACOSX
+    return usage.ru_maxrss;//bytes on mac
+#else
+    return ((int64_t)usage.ru_maxrss) * 1024;//kilobytes on linux
+#endif
+#endif
+}
+
+/**
+ * Start timing a phase, if profiling is enabled.
+ *
+ * @param phaseName
+ *    Name of the phase.
+ */
+PerformanceProfile::PhaseTimer::PhaseTimer(const AString& phaseName)
+{
+    m_active = PerformanceProfile::isEnabled();
+    m_startWallSeconds = 0.0;
+    m_startCpuSeconds = 0.0;
+    if (m_active)
+    {
+        m_phaseName = phaseName;
+        m_startWallSeconds = PerformanceProfile::getWallSeconds();
+        m_startCpuSeconds = PerformanceProfile::getProcessCpuSeconds();
+    }
+}
+
+/**
+ * Add the elapsed time to the phase, including when leaving the scope due to an exception.
+ */
+PerformanceProfile::PhaseTimer::~PhaseTimer()
+{
+    if (m_active)
+    {
+        PerformanceProfile::addPhaseTime(m_phaseName,
+                                         PerformanceProfile::getWallSeconds() - m_startWallSeconds,
+                                         PerformanceProfile::getProcessCpuSeconds() - m_startCpuSeconds);
+    }
+}
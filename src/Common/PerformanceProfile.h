@@ -0,0 +1,97 @@
+#ifndef __PERFORMANCE_PROFILE_H__
+#define __PERFORMANCE_PROFILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+
+#include "AString.h"
+
+namespace caret {
+
+    /**
+     * \brief Collects timings, file sizes, and resource usage of a wb_command run.
+     *
+     * Enabled with the -profile global option.  When disabled, all recording
+     * methods return immediately, so instrumentation may be left in place.
+     * Phase times are inclusive: a helper built during "compute" is counted
+     * in both phases.  Recording methods are thread safe.
+     */
+    class PerformanceProfile {
+        
+    public:
+        /// Records the time between construction and destruction as a phase
+        class PhaseTimer {
+        public:
+            PhaseTimer(const AString& phaseName);
+            
+            ~PhaseTimer();
+            
+        private:
+            PhaseTimer(const PhaseTimer&);
+            
+            PhaseTimer& operator=(const PhaseTimer&);
+            
+            AString m_phaseName;
+            
+            double m_startWallSeconds;
+            
+            double m_startCpuSeconds;
+            
+            bool m_active;
+        };
+        
+        static void enable(const AString& outputFileName);
+        
+        static void disable();
+        
+        static bool isEnabled() { return s_enabled; }
+        
+        static void addPhaseTime(const AString& phaseName,
+                                 const double wallSeconds,
+                                 const double cpuSeconds);
+        
+        static void addFileRead(const AString& fileName,
+                                const double seconds,
+                                const bool inMemoryFlag = false);
+        
+        static void addFileWritten(const AString& fileName,
+                                   const double seconds,
+                                   const bool inMemoryFlag = false);
+        
+        static void writeProfile(const AString& commandLine,
+                                 const bool successFlag);
+        
+        static double getWallSeconds();
+        
+        static double getProcessCpuSeconds();
+        
+        static int64_t getPeakResidentBytes();
+        
+    private:
+        PerformanceProfile();
+        
+        static bool s_enabled;
+    };
+    
+} // namespace
+
+#endif  //__PERFORMANCE_PROFILE_H__
@@ -618,6 +618,17 @@ CaretMappableDataFile::restoreFileDataFromScene(const SceneAttributes* sceneAttr
                         pcm.decodeFromStringXML(pcmString);
                         
                         PaletteColorMapping* pcmMap = getMapPaletteColorMapping(restoreMapIndex);
+                        
+                        /*
+                         * Keep the palette from the file so that it can be put
+                         * back if this file is kept in memory when another
+                         * scene is shown.
+                         */
+                        if ((pcmMap->getModifiedStatus() == PaletteModifiedStatusEnum::UNMODIFIED)
+                            && (m_paletteColorMappingBeforeShowScene.find(restoreMapIndex) == m_paletteColorMappingBeforeShowScene.end())) {
+                            m_paletteColorMappingBeforeShowScene[restoreMapIndex].reset(new PaletteColorMapping(*pcmMap));
+                        }
+                        
                         pcmMap->copy(pcm,
                                      true);
                         pcmMap->clearModified();
@@ -1040,6 +1051,50 @@ CaretMappableDataFile::getPaletteColorMappingModifiedStatus() const
     return modStatus;
 }
 
+/**
+ * Put back the palettes that were replaced by palettes from a scene
+ * to the palettes that were read from the file.  This allows the file
+ * to be kept in memory, instead of read again, when another scene is
+ * shown.
+ *
+ * @return True if, afterwards, no palette in this file has a modified
+ * status (of any kind).
+ */
+bool
+CaretMappableDataFile::revertPaletteColorMappingModifiedByShowScene()
+{
+    if (isMappedWithPalette()) {
+        const int32_t numMaps = getNumberOfMaps();
+        for (auto& mapIndexAndPalette : m_paletteColorMappingBeforeShowScene) {
+            const int32_t mapIndex = mapIndexAndPalette.first;
+            if (mapIndex >= numMaps) {
+                continue;
+            }
+            
+            PaletteColorMapping* pcmMap = getMapPaletteColorMapping(mapIndex);
+            if (pcmMap->getModifiedStatus() != PaletteModifiedStatusEnum::MODIFIED_BY_SHOW_SCENE) {
+                continue;
+            }
+            
+            pcmMap->copy(*mapIndexAndPalette.second,
+                         true);
+            pcmMap->clearModified();
+            
+            VolumeFile* volumeFile = dynamic_cast<VolumeFile*>(this);
+            if (volumeFile != NULL) {
+                volumeFile->updateScalarColoringForMap(mapIndex);
+            }
+        }
+    }
+    m_paletteColorMappingBeforeShowScene.clear();
+    
+    /*
+     * Not virtual since subclasses with encapsulated files
+     * check them after reverting them.
+     */
+    return (CaretMappableDataFile::getPaletteColorMappingModifiedStatus() == PaletteModifiedStatusEnum::UNMODIFIED);
+}
+
 /**
  * @return True if the file is modified in any way EXCEPT for
  * the palette color mapping.  Also see isModified().
@@ -1099,6 +1154,12 @@ CaretMappableDataFile::clearModified()
 {
     CaretDataFile::clearModified();
     
+    /*
+     * Palettes are no longer modified so those
+     * saved prior to showing a scene are not needed
+     */
+    m_paletteColorMappingBeforeShowScene.clear();
+    
     if (m_chartingDelegate != NULL) {
         m_chartingDelegate->clearModified();
     }
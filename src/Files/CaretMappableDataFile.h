@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include <map>
 #include <memory>
 
 #include "CaretDataFile.h"
@@ -460,6 +461,9 @@ namespace caret {
         /* documented in cxx file. */
         virtual PaletteModifiedStatusEnum::Enum getPaletteColorMappingModifiedStatus() const;
         
+        /* documented in cxx file. */
+        virtual bool revertPaletteColorMappingModifiedByShowScene();
+        
         /**
          * Check whether the file contains Cifti XML (all cifti types and also wbsparse have it)
          */
@@ -559,6 +563,12 @@ namespace caret {
         
         std::unique_ptr<FileIdentificationAttributes> m_fileIdentificationAttributes;
         
+        /**
+         * Palettes of maps, as read from the file, before they were replaced
+         * by palettes from a scene.  Key is the map index.  NOT copied.
+         */
+        std::map<int32_t, std::unique_ptr<PaletteColorMapping>> m_paletteColorMappingBeforeShowScene;
+        
         /** 
          * Added by WB-781 Apply to All Maps for ColorBar.
          * This value is saved to scenes but NOT to the data file.
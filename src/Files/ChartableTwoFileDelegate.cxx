@@ -88,7 +88,10 @@ ChartableTwoFileDelegate::updateAfterFileChanged()
     
     switch (m_caretMappableDataFile->getDataFileType()) {
         case DataFileTypeEnum::CONNECTIVITY_DENSE:
+            /* Dense matrix is always drawn from tiles (never read entirely) */
             histogramType = ChartTwoHistogramContentTypeEnum::HISTOGRAM_CONTENT_TYPE_MAP_DATA;
+            matrixType = ChartTwoMatrixContentTypeEnum::MATRIX_CONTENT_BRAINORDINATE_MAPPABLE;
+            validMatrixRowColumnSelectionDimensions.push_back(ChartTwoMatrixLoadingDimensionEnum::CHART_MATRIX_LOADING_BY_ROW);
             break;
         case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
             histogramType = ChartTwoHistogramContentTypeEnum::HISTOGRAM_CONTENT_TYPE_MAP_DATA;
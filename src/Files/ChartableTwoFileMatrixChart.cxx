@@ -24,6 +24,7 @@
 #undef __CHARTABLE_TWO_FILE_MATRIX_CHART_DECLARE__
 
 #include "CaretAssert.h"
+#include "CiftiConnectivityMatrixDenseFile.h"
 #include "CiftiConnectivityMatrixParcelFile.h"
 #include "CiftiParcelLabelFile.h"
 #include "CiftiParcelReordering.h"
@@ -80,6 +81,8 @@ m_validRowColumnSelectionDimensions(validRowColumnSelectionDimensions)
                                                 m_parcelScalarFileSelectedColumn);
     m_sceneAssistant->addTabIndexedIntegerArray("m_parcelSeriesFileSelectedColumn",
                                                 m_parcelSeriesFileSelectedColumn);
+    m_sceneAssistant->add("m_matrixTileMaximumAbsoluteFlag",
+                          &m_matrixTileMaximumAbsoluteFlag);
     
     if (m_matrixContentType != ChartTwoMatrixContentTypeEnum::MATRIX_CONTENT_UNSUPPORTED) {
         CiftiMappableDataFile* ciftiMapFile = getCiftiMappableDataFile();
@@ -95,6 +98,7 @@ m_validRowColumnSelectionDimensions(validRowColumnSelectionDimensions)
             case DataFileTypeEnum::BORDER:
                 break;
             case DataFileTypeEnum::CONNECTIVITY_DENSE:
+                m_matrixDataFileType = MatrixDataFileType::DENSE;
                 break;
             case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
                 break;
@@ -165,6 +169,15 @@ m_validRowColumnSelectionDimensions(validRowColumnSelectionDimensions)
                 CaretAssert(0);
                 return;
                 break;
+            case MatrixDataFileType::DENSE:
+                /*
+                 * Rows are loaded one at a time, there are too many
+                 * brainordinates to create names for all rows.
+                 */
+                m_denseFile = dynamic_cast<CiftiConnectivityMatrixDenseFile*>(ciftiMapFile);
+                CaretAssert(m_denseFile);
+                m_hasRowSelectionFlag = true;
+                break;
             case MatrixDataFileType::PARCEL:
                 m_parcelFile = dynamic_cast<CiftiConnectivityMatrixParcelFile*>(ciftiMapFile);
                 CaretAssert(m_parcelFile);
@@ -469,6 +482,84 @@ ChartableTwoFileMatrixChart::getMatrixChartGraphicsPrimitiveGridColorIdentifier(
     return ciftiMapFile->getMatrixChartGraphicsPrimitiveGridColorIdentifier();
 }
 
+/**
+ * @return True if the matrix is too large for a single texture and is
+ * drawn using tiles from a multi-resolution pyramid.
+ */
+bool
+ChartableTwoFileMatrixChart::isMatrixChartingTiled() const
+{
+    const CiftiMappableDataFile* ciftiMapFile = getCiftiMappableDataFile();
+    CaretAssert(ciftiMapFile);
+    
+    return ciftiMapFile->isMatrixChartingTiled();
+}
+
+/**
+ * @return The tile pyramid for a tiled matrix (NULL if not tiled).
+ */
+const CiftiMatrixTilePyramid*
+ChartableTwoFileMatrixChart::getMatrixChartingTilePyramid() const
+{
+    const CiftiMappableDataFile* ciftiMapFile = getCiftiMappableDataFile();
+    CaretAssert(ciftiMapFile);
+    
+    return ciftiMapFile->getMatrixChartingTilePyramid(getMatrixTileDownsampleMode());
+}
+
+/**
+ * @return How cells are combined in the coarser levels of a tiled matrix.
+ */
+CiftiMatrixTilePyramid::DownsampleMode
+ChartableTwoFileMatrixChart::getMatrixTileDownsampleMode() const
+{
+    return (m_matrixTileMaximumAbsoluteFlag
+            ? CiftiMatrixTilePyramid::DownsampleMode::MAXIMUM_ABSOLUTE
+            : CiftiMatrixTilePyramid::DownsampleMode::MEAN);
+}
+
+/**
+ * Set how cells are combined in the coarser levels of a tiled matrix.
+ * The mean shows overall structure, the largest magnitude keeps
+ * isolated strong connections visible when zoomed out.
+ *
+ * @param downsampleMode
+ *     New downsample mode.
+ */
+void
+ChartableTwoFileMatrixChart::setMatrixTileDownsampleMode(const CiftiMatrixTilePyramid::DownsampleMode downsampleMode)
+{
+    m_matrixTileMaximumAbsoluteFlag = (downsampleMode == CiftiMatrixTilePyramid::DownsampleMode::MAXIMUM_ABSOLUTE);
+}
+
+/**
+ * @return The graphics primitive for one tile of a tiled matrix.
+ * All full resolution cells are of dimension 1.0 x 1.0
+ *
+ * @param matrixViewMode
+ *     The matrix visualization mode (upper/lower).
+ * @param level
+ *     Level in the tile pyramid.
+ * @param tileRow
+ *     Tile index vertically (zero is top).
+ * @param tileColumn
+ *     Tile index horizontally.
+ */
+GraphicsPrimitive*
+ChartableTwoFileMatrixChart::getMatrixChartingTileGraphicsPrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
+                                                                    const int32_t level,
+                                                                    const int32_t tileRow,
+                                                                    const int32_t tileColumn) const
+{
+    const CiftiMappableDataFile* ciftiMapFile = getCiftiMappableDataFile();
+    CaretAssert(ciftiMapFile);
+    
+    return ciftiMapFile->getMatrixChartingTileGraphicsPrimitive(matrixViewMode,
+                                                                level,
+                                                                tileRow,
+                                                                tileColumn);
+}
+
 /**
  * @return The selected row/column dimension.
  */
@@ -481,6 +572,9 @@ ChartableTwoFileMatrixChart::getSelectedRowColumnDimension() const
         case MatrixDataFileType::INVALID:
             CaretAssert(0);
             break;
+        case MatrixDataFileType::DENSE:
+            CaretAssert(m_denseFile);
+            break;
         case MatrixDataFileType::PARCEL:
             CaretAssert(m_parcelFile);
             switch (m_parcelFile->getMatrixLoadingDimension()) {
@@ -525,6 +619,9 @@ ChartableTwoFileMatrixChart::setSelectedRowColumnDimension(const ChartTwoMatrixL
         case MatrixDataFileType::INVALID:
             CaretAssert(0);
             break;
+        case MatrixDataFileType::DENSE:
+            CaretAssert(m_denseFile);
+            break;
         case MatrixDataFileType::PARCEL:
         {
             CaretAssert(m_parcelFile);
@@ -594,6 +691,21 @@ ChartableTwoFileMatrixChart::getSelectedRowColumnIndices(const int32_t tabIndex,
         case MatrixDataFileType::INVALID:
             CaretAssert(0);
             break;
+        case MatrixDataFileType::DENSE:
+        {
+            CaretAssert(m_denseFile);
+            const ConnectivityDataLoaded* connDataLoaded = m_denseFile->getConnectivityDataLoaded();
+            if (connDataLoaded != NULL) {
+                int64_t loadedRowIndex = -1;
+                int64_t loadedColumnIndex = -1;
+                connDataLoaded->getRowColumnLoading(loadedRowIndex,
+                                                    loadedColumnIndex);
+                if (loadedRowIndex >= 0) {
+                    rowIndicesSet.insert(loadedRowIndex);
+                }
+            }
+        }
+            break;
         case MatrixDataFileType::PARCEL:
         {
             CaretAssert(m_parcelFile);
@@ -681,6 +793,19 @@ ChartableTwoFileMatrixChart::setSelectedRowColumnIndex(const int32_t tabIndex,
         case MatrixDataFileType::INVALID:
             CaretAssert(0);
             break;
+        case MatrixDataFileType::DENSE:
+        {
+            CaretAssert(m_denseFile);
+            int32_t numRows = -1;
+            int32_t numCols = -1;
+            getMatrixDimensions(numRows, numCols);
+            if ((rowColumnIndex >= 0)
+                && (rowColumnIndex < numRows)) {
+                m_denseFile->loadDataForRowIndex(rowColumnIndex);
+                m_denseFile->invalidateColoringInAllMaps();
+            }
+        }
+            break;
         case MatrixDataFileType::PARCEL:
         {
             CaretAssert(m_parcelFile);
@@ -750,7 +875,14 @@ ChartableTwoFileMatrixChart::loadDefaultRowOrColumn()
     if (m_matrixDataFileType == MatrixDataFileType::INVALID) {
         return;
     }
-    
+    /*
+     * Loading a dense row also changes the brainordinate coloring
+     * so it is only loaded when the user selects a row.
+     */
+    if (m_matrixDataFileType == MatrixDataFileType::DENSE) {
+        return;
+    }
+
     const int32_t tabIndex = BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS - 1;
     ChartTwoMatrixLoadingDimensionEnum::Enum rowColumnDimension = getSelectedRowColumnDimension();
     std::vector<int32_t> selectedRowIndices;
@@ -30,6 +30,7 @@
 
 namespace caret {
 
+    class CiftiConnectivityMatrixDenseFile;
     class CiftiConnectivityMatrixParcelFile;
     class CiftiParcelLabelFile;
     class CiftiParcelScalarFile;
@@ -64,6 +65,19 @@ namespace caret {
         
         int32_t getMatrixChartGraphicsPrimitiveGridColorIdentifier() const;
         
+        bool isMatrixChartingTiled() const;
+        
+        const CiftiMatrixTilePyramid* getMatrixChartingTilePyramid() const;
+        
+        CiftiMatrixTilePyramid::DownsampleMode getMatrixTileDownsampleMode() const;
+        
+        void setMatrixTileDownsampleMode(const CiftiMatrixTilePyramid::DownsampleMode downsampleMode);
+        
+        GraphicsPrimitive* getMatrixChartingTileGraphicsPrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
+                                                                  const int32_t level,
+                                                                  const int32_t tileRow,
+                                                                  const int32_t tileColumn) const;
+        
         bool isMatrixTriangularViewingModeSupported() const;
 
         // ADD_NEW_METHODS_HERE
@@ -99,6 +113,7 @@ namespace caret {
     protected:
         enum class MatrixDataFileType {
             INVALID,
+            DENSE,
             PARCEL,
             PARCEL_LABEL,
             PARCEL_SCALAR,
@@ -143,6 +158,7 @@ namespace caret {
         
         MatrixDataFileType m_matrixDataFileType = MatrixDataFileType::INVALID;
         
+        CiftiConnectivityMatrixDenseFile* m_denseFile = NULL;
         CiftiConnectivityMatrixParcelFile *m_parcelFile = NULL;
         CiftiParcelLabelFile* m_parcelLabelFile = NULL;
         CiftiParcelScalarFile* m_parcelScalarFile = NULL;
@@ -153,6 +169,9 @@ namespace caret {
         int32_t m_parcelScalarFileSelectedColumn[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
         int32_t m_parcelSeriesFileSelectedColumn[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
         
+        /** True if coarser levels of a tiled matrix show the largest magnitude, else the mean (saved to scene) */
+        bool m_matrixTileMaximumAbsoluteFlag = false;
+        
         static const int32_t ROW_COLUMN_INDEX_BASE_OFFSET = 1;
         
         // ADD_NEW_MEMBERS_HERE
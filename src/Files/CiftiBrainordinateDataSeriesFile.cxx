@@ -471,5 +471,25 @@ CiftiBrainordinateDataSeriesFile::getPaletteColorMappingModifiedStatus() const
     return modStatus;
 }
 
+/**
+ * Put back palettes replaced by palettes from a scene, including
+ * those in the encapsulated dense dynamic file.
+ *
+ * @return True if, afterwards, no palette has a modified status.
+ */
+bool
+CiftiBrainordinateDataSeriesFile::revertPaletteColorMappingModifiedByShowScene()
+{
+    bool unmodifiedFlag = CiftiMappableDataFile::revertPaletteColorMappingModifiedByShowScene();
+    
+    if (m_lazyInitializedDenseDynamicFile != NULL) {
+        if ( ! m_lazyInitializedDenseDynamicFile->revertPaletteColorMappingModifiedByShowScene()) {
+            unmodifiedFlag = false;
+        }
+    }
+    
+    return unmodifiedFlag;
+}
+
 
 
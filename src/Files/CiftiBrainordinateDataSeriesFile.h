@@ -69,6 +69,8 @@ namespace caret {
         
         virtual PaletteModifiedStatusEnum::Enum getPaletteColorMappingModifiedStatus() const override;
         
+        virtual bool revertPaletteColorMappingModifiedByShowScene() override;
+        
     private:
         CiftiBrainordinateDataSeriesFile(const CiftiBrainordinateDataSeriesFile&);
 
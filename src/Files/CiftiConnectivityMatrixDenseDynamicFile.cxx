@@ -19,8 +19,10 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <new>
 
 #define __CIFTI_CONNECTIVITY_MATRIX_DENSE_DYNAMIC_FILE_DECLARE__
 #include "CiftiConnectivityMatrixDenseDynamicFile.h"
@@ -35,8 +37,43 @@
 #include "SceneClassAssistant.h"
 #include "dot_wrapper.h"
 
+#include <QThread>
+
 using namespace caret;
 
+namespace
+{
+    /** largest normalized copy of the time series that is kept in memory, larger files correlate from the file's rows */
+    const int64_t MAX_NORMALIZED_DATA_BYTES = int64_t(4) * 1024 * 1024 * 1024;
+    
+    /** number of computed correlation rows kept, each is one float per brainordinate */
+    const int32_t ROW_CACHE_SIZE = 64;
+    
+    /** most rows computed in one prefetch pass */
+    const int32_t MAX_PREFETCH_ROWS = 32;
+    
+    /** rows of the matrix between checks for a cancelled prefetch */
+    const int64_t CORRELATION_CHUNK_ROWS = 4096;
+}
+
+/**
+ * Computes correlation rows for likely upcoming seeds while the user is
+ * looking at the current one.
+ */
+class CiftiConnectivityMatrixDenseDynamicFile::PrefetchThread : public QThread
+{
+public:
+    PrefetchThread(CiftiConnectivityMatrixDenseDynamicFile* denseDynamicFile)
+    : m_denseDynamicFile(denseDynamicFile) { }
+    
+    void run() {
+        m_denseDynamicFile->runPrefetch();
+    }
+    
+private:
+    CiftiConnectivityMatrixDenseDynamicFile* m_denseDynamicFile;
+};
+
 /**
  * \class caret::CiftiConnectivityMatrixDenseDynamicFile 
  * \brief Connectivity Dynamic Dense x Dense File version of data-series
@@ -62,7 +99,11 @@ m_numberOfBrainordinates(-1),
 m_numberOfTimePoints(-1),
 m_validDataFlag(false),
 m_enabledAsLayer(true),
-m_cacheDataFlag(false)
+m_cacheDataFlag(false),
+m_normalizedData(NULL),
+m_normalizedRowStride(0),
+m_prefetchCancelFlag(false),
+m_prefetchThreadActive(false)
 {
     CaretAssert(m_parentDataSeriesFile);
 
@@ -76,6 +117,7 @@ m_cacheDataFlag(false)
  */
 CiftiConnectivityMatrixDenseDynamicFile::~CiftiConnectivityMatrixDenseDynamicFile()
 {
+    stopPrefetch();
 }
 
 /**
@@ -148,6 +190,12 @@ CiftiConnectivityMatrixDenseDynamicFile::updateAfterReading(const CiftiFile* cif
 {
     m_validDataFlag = false;
     
+    stopPrefetch();
+    clearRowCache();
+    m_normalizedData = NULL;
+    m_normalizedRowStride = 0;
+    std::vector<float>().swap(m_normalizedStorage);
+    
     m_parentDataSeriesCiftiFile = const_cast<CiftiFile*>(ciftiFile);
     
     AString path, nameNoExt, ext;
@@ -186,9 +234,11 @@ CiftiConnectivityMatrixDenseDynamicFile::updateAfterReading(const CiftiFile* cif
                 m_parentDataSeriesCiftiFile->getRow(&m_rowData[i].m_data[0],
                                                     i);
             }
+            preComputeRowMeanAndSumSquared();
+        }
+        else if ( ! loadNormalizedData()) {
+            preComputeRowMeanAndSumSquared();
         }
-        
-        preComputeRowMeanAndSumSquared();
         
         m_validDataFlag = true;
     }
@@ -228,6 +278,26 @@ CiftiConnectivityMatrixDenseDynamicFile::getDataForRow(float* dataOut,
                                         index);
 }
 
+/**
+ * Load data for consecutive rows.
+ *
+ * @param dataOut
+ *     Output with data, one row after another.
+ * @param firstIndex
+ *     Index of the first row.
+ * @param numberOfRows
+ *     Number of rows.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::getDataForRows(float* dataOut,
+                                                        const int64_t& firstIndex,
+                                                        const int64_t& numberOfRows) const
+{
+    m_parentDataSeriesCiftiFile->getRows(dataOut,
+                                         firstIndex,
+                                         numberOfRows);
+}
+
 /**
  * Load PROCESSED data for the given column.
  *
@@ -268,6 +338,37 @@ CiftiConnectivityMatrixDenseDynamicFile::getProcessedDataForRow(float* dataOut,
         return;
     }
     
+    if (m_normalizedData != NULL) {
+        {
+            /*
+             * A row that the prefetch is still computing is computed here, the
+             * prefetch uses a single core so waiting for it would be slower
+             */
+            QMutexLocker locker(&m_prefetchMutex);
+            for (std::list<std::pair<int64_t, std::vector<float> > >::iterator iter = m_rowCache.begin();
+                 iter != m_rowCache.end();
+                 iter++) {
+                if (iter->first == index) {
+                    CaretAssert(static_cast<int32_t>(iter->second.size()) == m_numberOfBrainordinates);
+                    std::copy(iter->second.begin(), iter->second.end(), dataOut);
+                    m_rowCache.splice(m_rowCache.begin(), m_rowCache, iter);
+                    return;
+                }
+            }
+        }
+        
+        std::vector<std::vector<float> > rows;
+        computeCorrelationRows(std::vector<int64_t>(1, index),
+                               rows,
+                               false);
+        CaretAssert(rows.size() == 1);
+        std::copy(rows[0].begin(), rows[0].end(), dataOut);
+        
+        QMutexLocker locker(&m_prefetchMutex);
+        addRowToCache(index, rows[0]);
+        return;
+    }
+    
     std::vector<float> rowData(m_numberOfTimePoints);
     m_parentDataSeriesCiftiFile->getRow(&rowData[0], index);
     const float mean = m_rowData[index].m_mean;
@@ -325,6 +426,23 @@ CiftiConnectivityMatrixDenseDynamicFile::processRowAverageData(std::vector<float
     
     std::vector<float> processedRowAverageData(m_numberOfBrainordinates);
     
+    if (m_normalizedData != NULL) {
+        std::vector<float> normalizedAverage(dataLength, 0.0f);
+        if (sumSquared > 0.0) {
+            for (int32_t i = 0; i < dataLength; i++) {
+                normalizedAverage[i] = (rowAverageDataInOut[i] - mean) / sumSquared;
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+        for (int32_t iRow = 0; iRow < m_numberOfBrainordinates; iRow++) {
+            processedRowAverageData[iRow] = dsdot(&normalizedAverage[0],
+                                                  m_normalizedData + iRow * m_normalizedRowStride,
+                                                  dataLength);
+        }
+        rowAverageDataInOut = processedRowAverageData;
+        return;
+    }
+    
     /*
      * TSC: hyperthreading means some cores end up "faster" than others, so "static" scheduling is generally not as fast
      * there is almost no overhead to dynamic scheduling
@@ -418,6 +536,330 @@ CiftiConnectivityMatrixDenseDynamicFile::preComputeRowMeanAndSumSquared()
     }
 }
 
+/**
+ * Read all of the time series once into one contiguous matrix with each row
+ * demeaned and divided by its root sum of squares, so that the correlation
+ * of two rows is the dot product of their normalized rows.  Also sets the
+ * mean and sum-squared of each row.
+ *
+ * @return
+ *     True if the matrix was loaded, false if it would be too large.
+ */
+bool
+CiftiConnectivityMatrixDenseDynamicFile::loadNormalizedData()
+{
+    CaretAssert(m_numberOfBrainordinates > 0);
+    CaretAssert(m_numberOfTimePoints > 0);
+    
+    const int64_t floatsPerCacheLine = 16;
+    const int64_t rowStride = ((m_numberOfTimePoints + floatsPerCacheLine - 1) / floatsPerCacheLine) * floatsPerCacheLine;
+    const int64_t numberOfFloats = rowStride * m_numberOfBrainordinates;
+    if (numberOfFloats * static_cast<int64_t>(sizeof(float)) > MAX_NORMALIZED_DATA_BYTES) {
+        CaretLogInfo("Time series of "
+                     + m_parentDataSeriesCiftiFile->getFileName()
+                     + " is too large to keep in memory for dynamic connectivity, rows will be read as needed");
+        return false;
+    }
+    try {
+        m_normalizedStorage.resize(numberOfFloats + floatsPerCacheLine, 0.0f);
+    }
+    catch (const std::bad_alloc&) {
+        std::vector<float>().swap(m_normalizedStorage);
+        CaretLogWarning("Unable to allocate memory for dynamic connectivity of "
+                        + m_parentDataSeriesCiftiFile->getFileName()
+                        + ", rows will be read as needed");
+        return false;
+    }
+    const int64_t misalignment = (reinterpret_cast<uintptr_t>(&m_normalizedStorage[0]) % (floatsPerCacheLine * sizeof(float))) / sizeof(float);
+    float* normalizedData = &m_normalizedStorage[0] + ((floatsPerCacheLine - misalignment) % floatsPerCacheLine);
+    
+    const int64_t blockRows = 1024;
+    std::vector<float> blockData(blockRows * m_numberOfTimePoints);
+    for (int64_t blockStart = 0; blockStart < m_numberOfBrainordinates; blockStart += blockRows) {
+        const int64_t blockEnd = std::min(blockStart + blockRows, static_cast<int64_t>(m_numberOfBrainordinates));
+        for (int64_t iRow = blockStart; iRow < blockEnd; iRow++) {
+            //TSC: this can do disk access, which is not currently thread-safe
+            m_parentDataSeriesCiftiFile->getRow(&blockData[(iRow - blockStart) * m_numberOfTimePoints], iRow);
+        }
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t iRow = blockStart; iRow < blockEnd; iRow++) {
+            const float* data = &blockData[(iRow - blockStart) * m_numberOfTimePoints];
+            CaretAssertVectorIndex(m_rowData, iRow);
+            RowData& rowData = m_rowData[iRow];
+            computeDataMeanAndSumSquared(data,
+                                         m_numberOfTimePoints,
+                                         rowData.m_mean,
+                                         rowData.m_sqrt_ssxx);
+            /*
+             * A row without variance (or with NaNs) is left as zeros, so it
+             * correlates as zero, same as the unnormalized correlation
+             */
+            if (rowData.m_sqrt_ssxx > 0.0) {
+                float* normalizedRow = normalizedData + iRow * rowStride;
+                for (int32_t i = 0; i < m_numberOfTimePoints; i++) {
+                    normalizedRow[i] = (data[i] - rowData.m_mean) / rowData.m_sqrt_ssxx;
+                }
+            }
+        }
+    }
+    
+    m_normalizedRowStride = rowStride;
+    m_normalizedData = normalizedData;
+    return true;
+}
+
+/**
+ * Compute correlation rows for several seeds in one pass over the normalized
+ * data, each row of the matrix is used for all of the seeds while it is in cache.
+ *
+ * @param rowIndices
+ *     Indices of the seed rows.
+ * @param rowsOut
+ *     Output with a correlation row for each seed.
+ * @param prefetchFlag
+ *     If true, the rows are computed for the prefetch thread: stop early when
+ *     the prefetch is cancelled (output is incomplete) and compute serially
+ *     so that the background thread does not add a full set of OpenMP threads
+ *     on top of those loading rows in the foreground.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::computeCorrelationRows(const std::vector<int64_t>& rowIndices,
+                                                                std::vector<std::vector<float> >& rowsOut,
+                                                                const bool prefetchFlag) const
+{
+    CaretAssert(m_normalizedData != NULL);
+    const int64_t numberOfSeeds = static_cast<int64_t>(rowIndices.size());
+    rowsOut.resize(numberOfSeeds);
+    std::vector<const float*> seedData(numberOfSeeds);
+    for (int64_t k = 0; k < numberOfSeeds; k++) {
+        CaretAssert((rowIndices[k] >= 0) && (rowIndices[k] < m_numberOfBrainordinates));
+        rowsOut[k].resize(m_numberOfBrainordinates);
+        seedData[k] = m_normalizedData + rowIndices[k] * m_normalizedRowStride;
+    }
+    
+    for (int64_t chunkStart = 0; chunkStart < m_numberOfBrainordinates; chunkStart += CORRELATION_CHUNK_ROWS) {
+        if (prefetchFlag
+            && isPrefetchCancelled()) {
+            return;
+        }
+        const int64_t chunkEnd = std::min(chunkStart + CORRELATION_CHUNK_ROWS, static_cast<int64_t>(m_numberOfBrainordinates));
+#pragma omp CARET_PARFOR schedule(dynamic, 16) if ( ! prefetchFlag)
+        for (int64_t iRow = chunkStart; iRow < chunkEnd; iRow++) {
+            const float* rowData = m_normalizedData + iRow * m_normalizedRowStride;
+            for (int64_t k = 0; k < numberOfSeeds; k++) {
+                float coefficient = 1.0;
+                if (iRow != rowIndices[k]) {
+                    coefficient = dsdot(rowData, seedData[k], m_numberOfTimePoints);
+                }
+                rowsOut[k][iRow] = coefficient;
+            }
+        }
+    }
+}
+
+/**
+ * Request correlation rows for likely upcoming seeds to be computed in the
+ * background.  Replaces any rows requested earlier that have not been started.
+ *
+ * @param rowIndices
+ *     Indices of the rows, in order of likelihood.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::prefetchRows(const std::vector<int64_t>& rowIndices)
+{
+    if (m_normalizedData == NULL) {
+        return;
+    }
+    
+    QMutexLocker locker(&m_prefetchMutex);
+    m_prefetchQueue.clear();
+    for (std::vector<int64_t>::const_iterator rowIter = rowIndices.begin();
+         rowIter != rowIndices.end();
+         rowIter++) {
+        const int64_t rowIndex = *rowIter;
+        if ((rowIndex < 0)
+            || (rowIndex >= m_numberOfBrainordinates)) {
+            continue;
+        }
+        if (m_prefetchInProgress.find(rowIndex) != m_prefetchInProgress.end()) {
+            continue;
+        }
+        if (std::find(m_prefetchQueue.begin(), m_prefetchQueue.end(), rowIndex) != m_prefetchQueue.end()) {
+            continue;
+        }
+        bool cachedFlag = false;
+        for (std::list<std::pair<int64_t, std::vector<float> > >::const_iterator cacheIter = m_rowCache.begin();
+             cacheIter != m_rowCache.end();
+             cacheIter++) {
+            if (cacheIter->first == rowIndex) {
+                cachedFlag = true;
+                break;
+            }
+        }
+        if (cachedFlag) {
+            continue;
+        }
+        m_prefetchQueue.push_back(rowIndex);
+        if (static_cast<int32_t>(m_prefetchQueue.size()) >= MAX_PREFETCH_ROWS) {
+            break;
+        }
+    }
+    
+    if (m_prefetchQueue.empty()
+        || m_prefetchThreadActive) {
+        return;
+    }
+    
+    if (m_prefetchThread.getPointer() == NULL) {
+        m_prefetchThread.grabNew(new PrefetchThread(this));
+    }
+    else {
+        /*
+         * Thread has decided to exit but may not have returned yet
+         */
+        m_prefetchThread->wait();
+    }
+    m_prefetchCancelFlag = false;
+    m_prefetchThreadActive = true;
+    m_prefetchThread->start(QThread::LowPriority);
+}
+
+/**
+ * Request correlation rows for surface nodes that are likely upcoming seeds
+ * (such as the neighbors of the current seed) to be computed in the background.
+ *
+ * @param structure
+ *     Structure of the surface.
+ * @param nodeIndices
+ *     Indices of the nodes, in order of likelihood.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::prefetchRowsForSurfaceNodes(const StructureEnum::Enum structure,
+                                                                     const std::vector<int32_t>& nodeIndices)
+{
+    if (m_normalizedData == NULL) {
+        return;
+    }
+    
+    const CiftiBrainModelsMap& brainModelsMap = getCiftiFile()->getCiftiXML().getBrainModelsMap(CiftiXML::ALONG_COLUMN);
+    std::vector<int64_t> rowIndices;
+    for (std::vector<int32_t>::const_iterator iter = nodeIndices.begin();
+         iter != nodeIndices.end();
+         iter++) {
+        if (*iter < 0) {
+            continue;
+        }
+        const int64_t rowIndex = brainModelsMap.getIndexForNode(*iter, structure);
+        if (rowIndex >= 0) {
+            rowIndices.push_back(rowIndex);
+        }
+    }
+    
+    prefetchRows(rowIndices);
+}
+
+/**
+ * Runs in the prefetch thread, computing queued rows until the queue is
+ * empty or the prefetch is cancelled.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::runPrefetch()
+{
+    while (true) {
+        std::vector<int64_t> batch;
+        {
+            QMutexLocker locker(&m_prefetchMutex);
+            if (m_prefetchCancelFlag
+                || m_prefetchQueue.empty()) {
+                m_prefetchThreadActive = false;
+                return;
+            }
+            batch.swap(m_prefetchQueue);
+            m_prefetchInProgress.insert(batch.begin(), batch.end());
+        }
+        
+        std::vector<std::vector<float> > rows;
+        computeCorrelationRows(batch,
+                               rows,
+                               true);
+        
+        QMutexLocker locker(&m_prefetchMutex);
+        if ( ! m_prefetchCancelFlag) {
+            for (int64_t k = 0; k < static_cast<int64_t>(batch.size()); k++) {
+                addRowToCache(batch[k], rows[k]);
+            }
+        }
+        m_prefetchInProgress.clear();
+    }
+}
+
+/**
+ * @return True if the prefetch has been cancelled.
+ */
+bool
+CiftiConnectivityMatrixDenseDynamicFile::isPrefetchCancelled() const
+{
+    QMutexLocker locker(&m_prefetchMutex);
+    return m_prefetchCancelFlag;
+}
+
+/**
+ * Cancel any prefetching and wait for the prefetch thread to finish.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::stopPrefetch()
+{
+    {
+        QMutexLocker locker(&m_prefetchMutex);
+        m_prefetchCancelFlag = true;
+        m_prefetchQueue.clear();
+    }
+    if (m_prefetchThread.getPointer() != NULL) {
+        m_prefetchThread->wait();
+    }
+    QMutexLocker locker(&m_prefetchMutex);
+    m_prefetchCancelFlag = false;
+    m_prefetchThreadActive = false;
+}
+
+/**
+ * Remove all computed rows from the row cache.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::clearRowCache()
+{
+    QMutexLocker locker(&m_prefetchMutex);
+    m_rowCache.clear();
+}
+
+/**
+ * Add a computed row to the front of the row cache, removing the least
+ * recently used rows when the cache is full.  Caller must hold m_prefetchMutex.
+ *
+ * @param rowIndex
+ *     Index of the row.
+ * @param rowData
+ *     Correlation row, its content is taken (swapped) by the cache.
+ */
+void
+CiftiConnectivityMatrixDenseDynamicFile::addRowToCache(const int64_t rowIndex,
+                                                       std::vector<float>& rowData) const
+{
+    for (std::list<std::pair<int64_t, std::vector<float> > >::iterator iter = m_rowCache.begin();
+         iter != m_rowCache.end();
+         iter++) {
+        if (iter->first == rowIndex) {
+            m_rowCache.erase(iter);
+            break;
+        }
+    }
+    m_rowCache.push_front(std::make_pair(rowIndex, std::vector<float>()));
+    m_rowCache.front().second.swap(rowData);
+    while (static_cast<int32_t>(m_rowCache.size()) > ROW_CACHE_SIZE) {
+        m_rowCache.pop_back();
+    }
+}
+
 /**
  * Compute data's mean and sum-squared
  *
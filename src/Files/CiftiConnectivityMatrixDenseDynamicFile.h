@@ -21,8 +21,14 @@
  */
 /*LICENSE_END*/
 
+#include <list>
+#include <set>
+
+#include <QMutex>
+
 #include "CaretPointer.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
+#include "StructureEnum.h"
 
 namespace caret {
     class CiftiBrainordinateDataSeriesFile;
@@ -49,6 +55,11 @@ namespace caret {
         
         const CiftiBrainordinateDataSeriesFile* getParentBrainordinateDataSeriesFile() const;
         
+        void prefetchRows(const std::vector<int64_t>& rowIndices);
+        
+        void prefetchRowsForSurfaceNodes(const StructureEnum::Enum structure,
+                                         const std::vector<int32_t>& nodeIndices);
+        
     private:
         CiftiConnectivityMatrixDenseDynamicFile(const CiftiConnectivityMatrixDenseDynamicFile&);
 
@@ -58,6 +69,8 @@ namespace caret {
         virtual void getDataForColumn(float* dataOut, const int64_t& index) const;
         
         virtual void getDataForRow(float* dataOut, const int64_t& index) const;
+        
+        virtual void getDataForRows(float* dataOut, const int64_t& firstIndex, const int64_t& numberOfRows) const;
                 
         virtual void getProcessedDataForColumn(float* dataOut, const int64_t& index) const;
         
@@ -95,6 +108,25 @@ namespace caret {
         
         void preComputeRowMeanAndSumSquared();
         
+        bool loadNormalizedData();
+        
+        void computeCorrelationRows(const std::vector<int64_t>& rowIndices,
+                                    std::vector<std::vector<float> >& rowsOut,
+                                    const bool prefetchFlag) const;
+        
+        bool isPrefetchCancelled() const;
+        
+        void runPrefetch();
+        
+        void stopPrefetch();
+        
+        void clearRowCache();
+        
+        void addRowToCache(const int64_t rowIndex,
+                           std::vector<float>& rowData) const;
+        
+        class PrefetchThread;
+        
         void computeDataMeanAndSumSquared(const float* data,
                                           const int32_t dataLength,
                                           float& meanOut,
@@ -118,6 +150,30 @@ namespace caret {
         
         CaretPointer<SceneClassAssistant> m_sceneAssistant;
         
+        /** all time series, each row demeaned and scaled to unit length, so correlation is a dot product, NULL if too large */
+        float* m_normalizedData;
+        
+        /** floats per row of m_normalizedData, padded so that each row starts on a 64 byte boundary */
+        int64_t m_normalizedRowStride;
+        
+        std::vector<float> m_normalizedStorage;
+        
+        /** protects the members below, they are shared with the prefetch thread */
+        mutable QMutex m_prefetchMutex;
+        
+        /** recently computed correlation rows, most recent first */
+        mutable std::list<std::pair<int64_t, std::vector<float> > > m_rowCache;
+        
+        std::vector<int64_t> m_prefetchQueue;
+        
+        std::set<int64_t> m_prefetchInProgress;
+        
+        bool m_prefetchCancelFlag;
+        
+        bool m_prefetchThreadActive;
+        
+        CaretPointer<PrefetchThread> m_prefetchThread;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
@@ -24,6 +24,7 @@
 #undef __CIFTI_FIBER_ORIENTATION_FILE_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CiftiFile.h"
 #include "CiftiMappableDataFile.h"
 #include "CaretLogger.h"
@@ -37,7 +38,11 @@
 
 using namespace caret;
 
-
+namespace
+{
+    CaretMutex s_dataVersionMutex;
+    int64_t s_dataVersion = 0;
+}
     
 /**
  * \class caret::CiftiFiberOrientationFile 
@@ -59,6 +64,7 @@ CiftiFiberOrientationFile::CiftiFiberOrientationFile()
     for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
         m_displayStatusInTab[i] = true;
     }
+    updateDataVersion();
 }
 
 /**
@@ -101,6 +107,30 @@ CiftiFiberOrientationFile::clearPrivate()
     }
     
     m_fiberOrientations.clear();
+    
+    updateDataVersion();
+}
+
+/**
+ * @return Version of the fiber orientations.  The version changes
+ * whenever the fiber orientations are replaced and is unique among
+ * all fiber orientation files so that graphics created from the
+ * fiber orientations may be kept until they change.
+ */
+int64_t
+CiftiFiberOrientationFile::getDataVersion() const
+{
+    return m_dataVersion;
+}
+
+/**
+ * Assign a new version to the fiber orientations.
+ */
+void
+CiftiFiberOrientationFile::updateDataVersion()
+{
+    CaretMutexLocker locker(&s_dataVersionMutex);
+    m_dataVersion = ++s_dataVersion;
 }
 
 
@@ -267,6 +297,8 @@ CiftiFiberOrientationFile::initializeWithTestData()
         
         m_fiberOrientations.push_back(fiberOrientation);
     }
+    
+    updateDataVersion();
 }
 
 /**
@@ -490,6 +522,8 @@ CiftiFiberOrientationFile::readFile(const AString& filename)
         
         setFileName(filename);
         
+        updateDataVersion();
+        
         clearModified();
     }
     catch (const DataFileException& dfe) {
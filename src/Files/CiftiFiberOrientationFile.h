@@ -79,6 +79,8 @@ namespace caret {
         
         void addToDataFileContentInformation(DataFileContentInformation& dataFileInformation);
         
+        int64_t getDataVersion() const;
+        
         // ADD_NEW_METHODS_HERE
         
     private:
@@ -90,6 +92,8 @@ namespace caret {
 
         void clearPrivate();
         
+        void updateDataVersion();
+        
         CiftiXML* m_ciftiXML;
         
         GiftiMetaData* m_metadata;
@@ -104,6 +108,9 @@ namespace caret {
         
         float m_volumeSpacing[3];
         
+        /** Version of the fiber orientations, changed when they are replaced */
+        int64_t m_dataVersion;
+        
         // ADD_NEW_MEMBERS_HERE
     };
     
@@ -30,6 +30,7 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
 #include "CaretSparseFile.h"
 #include "CiftiFiberOrientationFile.h"
 #include "CiftiMappableDataFile.h"
@@ -47,7 +48,11 @@
 
 using namespace caret;
 
-
+namespace
+{
+    CaretMutex s_dataVersionMutex;
+    int64_t s_dataVersion = 0;
+}
     
 /**
  * \class caret::CiftiFiberTrajectoryFile 
@@ -68,6 +73,7 @@ CiftiFiberTrajectoryFile::CiftiFiberTrajectoryFile()
     m_matchingFiberOrientationFileName = "";
     m_dataLoadingEnabled = true;
     m_fiberTrajectoryFileType = FIBER_TRAJECTORY_LOAD_BY_BRAINORDINATE;
+    updateDataVersion();
     
     m_sceneAssistant = new SceneClassAssistant();
     m_sceneAssistant->add("m_dataLoadingEnabled",
@@ -1035,6 +1041,30 @@ CiftiFiberTrajectoryFile::clearLoadedFiberOrientations()
     m_loadedDataDescriptionForFileCopy = "";
     
     m_connectivityDataLoaded->reset();
+    
+    updateDataVersion();
+}
+
+/**
+ * @return Version of the loaded fiber orientation trajectories.  The
+ * version changes whenever trajectories are loaded or cleared and is
+ * unique among all fiber trajectory files so that graphics created
+ * from the trajectories may be kept until they change.
+ */
+int64_t
+CiftiFiberTrajectoryFile::getDataVersion() const
+{
+    return m_dataVersion;
+}
+
+/**
+ * Assign a new version to the loaded fiber orientation trajectories.
+ */
+void
+CiftiFiberTrajectoryFile::updateDataVersion()
+{
+    CaretMutexLocker locker(&s_dataVersionMutex);
+    m_dataVersion = ++s_dataVersion;
 }
 
 /**
@@ -1254,6 +1284,8 @@ CiftiFiberTrajectoryFile::loadDataForSurfaceNode(const StructureEnum::Enum struc
             }
         }
         
+        updateDataVersion();
+        
         m_loadedDataDescriptionForMapName = ("Row: "
                                              + AString::number(rowIndex)
                                              + ", Node Index: "
@@ -1286,6 +1318,8 @@ CiftiFiberTrajectoryFile::finishFiberOrientationTrajectoriesAveraging()
         FiberOrientationTrajectory* fot = *iter;
         fot->finishAveraging();
     }
+    
+    updateDataVersion();
 }
 
 /**
@@ -1523,6 +1557,8 @@ CiftiFiberTrajectoryFile::loadMapDataForVoxelAtCoordinate(const float xyz[3])
             }
         }
         
+        updateDataVersion();
+        
         m_loadedDataDescriptionForMapName = ("Row: "
                                              + AString::number(rowIndex)
                                              + ", Voxel XYZ: "
@@ -1645,6 +1681,8 @@ CiftiFiberTrajectoryFile::loadDataForRowIndex(const int64_t rowIndex)
             }
         }
         
+        updateDataVersion();
+        
         m_loadedDataDescriptionForMapName = ("Row: "
                                              + AString::number(rowIndex));
         m_loadedDataDescriptionForFileCopy = ("Row_"
@@ -144,6 +144,8 @@ namespace caret {
         
         void clearLoadedFiberOrientations();
         
+        int64_t getDataVersion() const;
+        
         FiberTrajectoryMapProperties* getFiberTrajectoryMapProperties();
         
         const FiberTrajectoryMapProperties* getFiberTrajectoryMapProperties() const;
@@ -213,6 +215,8 @@ namespace caret {
         void validateAssignedMatchingFiberOrientationFile();
         
         void finishFiberOrientationTrajectoriesAveraging();
+        
+        void updateDataVersion();
        
         void writeLoadedDataToFile(const AString& filename) const;
         
@@ -228,6 +232,9 @@ namespace caret {
         AString m_matchingFiberOrientationFileNameFromRestoredScene;
         
         std::vector<FiberOrientationTrajectory*> m_fiberOrientationTrajectories;
+        
+        /** Version of the loaded trajectories, changed when they are loaded or cleared */
+        int64_t m_dataVersion;
 
         FiberTrajectoryMapProperties* m_fiberTrajectoryMapProperties;
         
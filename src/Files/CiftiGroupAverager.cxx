@@ -0,0 +1,326 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiGroupAverager.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+#include "MathFunctions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+using namespace caret;
+using namespace std;
+
+CiftiGroupAverager::CiftiGroupAverager(const int64_t& maxBufferBytes, const int& maxOpenFiles)
+{
+    m_maxBufferBytes = maxBufferBytes;
+    m_maxOpenFiles = max(1, maxOpenFiles);
+    m_excludeOutliers = false;
+    m_sigmaBelow = 0.0f;
+    m_sigmaAbove = 0.0f;
+}
+
+void CiftiGroupAverager::addInput(const CiftiFile* input, const float& weight)
+{
+    CaretAssert(input != NULL);
+    Input toAdd;
+    toAdd.m_file = input;
+    toAdd.m_weight = weight;
+    m_inputs.push_back(toAdd);
+}
+
+void CiftiGroupAverager::addInput(const AString& fileName, const float& weight)
+{
+    Input toAdd;
+    toAdd.m_fileName = fileName;
+    toAdd.m_weight = weight;
+    m_inputs.push_back(toAdd);
+}
+
+void CiftiGroupAverager::setOutlierExclusion(const float& sigmaBelow, const float& sigmaAbove)
+{
+    m_excludeOutliers = true;
+    m_sigmaBelow = sigmaBelow;
+    m_sigmaAbove = sigmaAbove;
+}
+
+void CiftiGroupAverager::openInput(Input& input)
+{
+    CaretAssert(!input.m_fileName.isEmpty());
+    CaretPointer<CiftiFile> newFile(new CiftiFile());
+    newFile->openFile(input.m_fileName);
+    input.m_ownedFile = newFile;
+    input.m_file = newFile;
+}
+
+void CiftiGroupAverager::readRows(Input& input, float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength, const bool& keepOpen)
+{
+    if (input.m_file == NULL) openInput(input);
+    for (int64_t row = 0; row < numRows; ++row)
+    {
+        input.m_file->getRow(dataOut + row * rowLength, firstRow + row);
+    }
+    if (!keepOpen && !input.m_fileName.isEmpty())
+    {
+        input.m_file = NULL;
+        input.m_ownedFile.grabNew(NULL);
+    }
+}
+
+void CiftiGroupAverager::accumulate(const float* window, const int& firstInput, const int& numInputs, const int64_t& blockElements,
+                                    const int64_t& start, const int64_t& end, double* accum, double* weightAccum) const
+{//inputs in order, so the sums are the same as adding one whole file at a time
+    for (int j = 0; j < numInputs; ++j)
+    {
+        const float* slot = window + j * blockElements;
+        const float weight = m_inputs[firstInput + j].m_weight;
+        const double doubleWeight = weight;
+        for (int64_t k = start; k < end; ++k)
+        {//no branches, so the compiler can vectorize this - value - value is zero only for finite values
+            const float value = slot[k];
+            const bool numeric = (value - value == 0.0f);
+            accum[k] += (numeric ? (double)(value * weight) : 0.0);
+            weightAccum[k] += (numeric ? doubleWeight : 0.0);
+        }
+    }
+}
+
+bool CiftiGroupAverager::excludeOutliers(const float* window, const int64_t& blockElements, const int64_t& start, const int64_t& end, float* dataOut) const
+{
+    const int numInputs = (int)m_inputs.size();
+    bool foundLowCount = false;
+    for (int64_t k = start; k < end; ++k)
+    {
+        double accum = 0.0;
+        double weightaccum = 0.0;
+        int nonnumeric = 0;
+        for (int j = 0; j < numInputs; ++j)
+        {
+            const float value = window[j * blockElements + k];
+            if (MathFunctions::isNumeric(value))
+            {
+                accum += value;
+            } else {
+                ++nonnumeric;
+            }
+        }
+        if (nonnumeric >= numInputs - 1)
+        {
+            foundLowCount = true;
+            dataOut[k] = 0.0f;
+            continue;
+        }
+        float mean = accum / (numInputs - nonnumeric);
+        accum = 0.0;
+        for (int j = 0; j < numInputs; ++j)
+        {
+            const float value = window[j * blockElements + k];
+            if (MathFunctions::isNumeric(value))
+            {
+                float temp = value - mean;
+                accum += temp * temp;
+            }
+        }
+        float stdev = sqrt(accum / (numInputs - 1 - nonnumeric));
+        float cutoffLow = mean - m_sigmaBelow * stdev;
+        float cutoffHigh = mean + m_sigmaAbove * stdev;
+        accum = 0.0;
+        for (int j = 0; j < numInputs; ++j)
+        {
+            const float value = window[j * blockElements + k];
+            if (value > cutoffLow && value < cutoffHigh)//implicitly excludes NaN and inf
+            {
+                float weight = m_inputs[j].m_weight;
+                accum += value * weight;
+                weightaccum += weight;
+            }
+        }
+        if (weightaccum != 0.0)
+        {
+            dataOut[k] = accum / weightaccum;
+        } else {
+            dataOut[k] = 0.0f;
+        }
+    }
+    return foundLowCount;
+}
+
+void CiftiGroupAverager::run(CiftiFile* output)
+{
+    CaretAssert(output != NULL);
+    const int numInputs = (int)m_inputs.size();
+    if (numInputs == 0)
+    {
+        throw DataFileException("no files specified");
+    }
+    if (m_excludeOutliers && numInputs < 2)
+    {
+        throw DataFileException("fewer than 2 files specified with outlier exclusion");
+    }
+    int numByName = 0;
+    for (int i = 0; i < numInputs; ++i)
+    {
+        if (!m_inputs[i].m_fileName.isEmpty()) ++numByName;
+    }
+    const bool keepOpen = (numByName <= m_maxOpenFiles);//otherwise, inputs added by name are opened for each block and closed after reading it
+    CiftiXML baseXML;
+    for (int i = 0; i < numInputs; ++i)
+    {
+        Input& thisInput = m_inputs[i];
+        const bool byName = !thisInput.m_fileName.isEmpty();
+        if (byName && thisInput.m_file == NULL) openInput(thisInput);
+        if (i == 0)
+        {
+            baseXML = thisInput.m_file->getCiftiXML();
+            if (baseXML.getNumberOfDimensions() != 2) throw DataFileException("cifti average currently only supports 2D files");
+        } else {
+            if (!baseXML.approximateMatch(thisInput.m_file->getCiftiXML()))//requires at least length to match, often more restrictive
+            {
+                throw DataFileException("cifti file '" + thisInput.m_file->getFileName() + "' does not match earlier inputs");
+            }
+        }
+        if (byName && !keepOpen)
+        {
+            thisInput.m_file = NULL;
+            thisInput.m_ownedFile.grabNew(NULL);
+        }
+    }
+    output->setCiftiXML(baseXML);
+    const int64_t numRows = baseXML.getDimensionLength(CiftiXML::ALONG_COLUMN), rowLength = baseXML.getDimensionLength(CiftiXML::ALONG_ROW);
+    if (numRows < 1 || rowLength < 1) return;
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    //outlier exclusion needs every input at each element, otherwise a window of inputs is accumulated while the next window is read
+    const int windowInputs = (m_excludeOutliers ? numInputs : min(numInputs, max(4, 2 * numThreads)));
+    const int64_t rowBytes = rowLength * (int64_t)sizeof(float);
+    const int64_t bytesPerBlockRow = rowBytes * (2 * windowInputs + 2) + (m_excludeOutliers ? 0 : rowLength * 2 * (int64_t)sizeof(double));//two windows, two output blocks, accumulators
+    const int64_t blockRows = min(numRows, max((int64_t)1, m_maxBufferBytes / bytesPerBlockRow));
+    const int64_t blockElements = blockRows * rowLength;
+    const int64_t numBlocks = (numRows + blockRows - 1) / blockRows;
+    const int64_t numWindows = (numInputs + windowInputs - 1) / windowInputs;
+    const int64_t numSteps = numBlocks * numWindows;
+    const int64_t PIECE_ELEMENTS = 1 << 16;
+    vector<float> windows[2], outBlocks[2];
+    windows[0].resize(windowInputs * blockElements);
+    if (numSteps > 1) windows[1].resize(windowInputs * blockElements);
+    outBlocks[0].resize(blockElements);
+    if (numBlocks > 1) outBlocks[1].resize(blockElements);
+    vector<double> accum, weightAccum;
+    if (!m_excludeOutliers)
+    {
+        accum.resize(blockElements, 0.0);
+        weightAccum.resize(blockElements, 0.0);
+    }
+    bool haveWarned = false;
+    int64_t pendingWriteBlock = -1;
+    AString errorMessage;
+    for (int64_t step = 0; step <= numSteps + 1; ++step)
+    {//each step reads window "step", processes window "step - 1", and writes the block completed by the previous step, all as items of one parallel loop
+        const bool haveRead = (step < numSteps), haveCompute = (step > 0 && step <= numSteps);
+        const int64_t readBlock = step / numWindows, readWindow = step % numWindows;
+        const int64_t readStart = readBlock * blockRows, readCount = min(blockRows, numRows - readStart);
+        const int readFirstInput = (int)(readWindow * windowInputs), readInputs = min(windowInputs, numInputs - readFirstInput);
+        const int64_t computeBlock = (step - 1) / numWindows, computeWindow = (step - 1) % numWindows;
+        const int64_t computeElements = min(blockRows, numRows - computeBlock * blockRows) * rowLength;
+        const int computeFirstInput = (int)(computeWindow * windowInputs), computeInputs = min(windowInputs, numInputs - computeFirstInput);
+        const int writeItems = (pendingWriteBlock >= 0 ? 1 : 0);
+        const int computeItems = (haveCompute ? (int)((computeElements + PIECE_ELEMENTS - 1) / PIECE_ELEMENTS) : 0);
+        const int numItems = writeItems + computeItems + (haveRead ? readInputs : 0);
+        float* readWindowData = windows[step % 2].data();
+        const float* computeWindowData = windows[(step + 1) % 2].data();
+        bool foundLowCount = false;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int item = 0; item < numItems; ++item)
+        {
+            try
+            {
+                if (item < writeItems)
+                {
+                    const int64_t writeStart = pendingWriteBlock * blockRows, writeCount = min(blockRows, numRows - writeStart);
+                    const float* writeData = outBlocks[pendingWriteBlock % 2].data();
+                    for (int64_t row = 0; row < writeCount; ++row)
+                    {
+                        output->setRow(writeData + row * rowLength, writeStart + row);
+                    }
+                } else if (item < writeItems + computeItems) {
+                    const int64_t start = (item - writeItems) * PIECE_ELEMENTS, end = min(computeElements, start + PIECE_ELEMENTS);
+                    if (m_excludeOutliers)
+                    {
+                        if (excludeOutliers(computeWindowData, blockElements, start, end, outBlocks[computeBlock % 2].data()))
+                        {
+#pragma omp critical
+                            foundLowCount = true;
+                        }
+                    } else {
+                        accumulate(computeWindowData, computeFirstInput, computeInputs, blockElements, start, end, accum.data(), weightAccum.data());
+                    }
+                } else {
+                    const int slot = item - writeItems - computeItems;
+                    readRows(m_inputs[readFirstInput + slot], readWindowData + slot * blockElements, readStart, readCount, rowLength, keepOpen);
+                }
+            } catch (CaretException& e) {
+#pragma omp critical
+                {
+                    if (errorMessage.isEmpty()) errorMessage = e.whatString();
+                }
+            } catch (std::exception& e) {
+#pragma omp critical
+                {
+                    if (errorMessage.isEmpty()) errorMessage = e.what();
+                }
+            }
+        }
+        if (!errorMessage.isEmpty()) throw DataFileException(errorMessage);
+        if (foundLowCount && !haveWarned)
+        {
+            CaretLogWarning("found element where less than 2 files have numeric values");
+            haveWarned = true;
+        }
+        pendingWriteBlock = -1;
+        if (haveCompute && computeWindow == numWindows - 1)
+        {//block is complete, write it during the next step
+            if (!m_excludeOutliers)
+            {
+                float* outData = outBlocks[computeBlock % 2].data();
+                for (int64_t k = 0; k < computeElements; ++k)
+                {
+                    if (weightAccum[k] != 0.0)
+                    {
+                        outData[k] = accum[k] / weightAccum[k];
+                    } else {
+                        outData[k] = 0.0f;
+                    }
+                    accum[k] = 0.0;
+                    weightAccum[k] = 0.0;
+                }
+            }
+            pendingWriteBlock = computeBlock;
+        }
+    }
+    CaretAssert(pendingWriteBlock == -1);
+}
@@ -0,0 +1,79 @@
+#ifndef __CIFTI_GROUP_AVERAGER_H__
+#define __CIFTI_GROUP_AVERAGER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretPointer.h"
+
+#include <vector>
+
+namespace caret
+{
+
+    class CiftiFile;
+
+    ///averages many matching 2D cifti files, row by row in blocks: the rows of a block are read from a window of inputs concurrently
+    ///while the previously read window is accumulated in double precision, so memory is bounded regardless of the number of inputs
+    class CiftiGroupAverager
+    {
+    public:
+        ///maxBufferBytes bounds the memory of the two input windows, maxOpenFiles bounds how many inputs added by name are kept open
+        CiftiGroupAverager(const int64_t& maxBufferBytes = 1024 * (int64_t)(1 << 20), const int& maxOpenFiles = 256);
+
+        ///an input that is already open, not owned
+        void addInput(const CiftiFile* input, const float& weight = 1.0f);
+
+        ///an input that is opened when needed, if there are more than maxOpenFiles of these, each is opened only while a block is read from it,
+        ///so at most one per thread is open
+        void addInput(const AString& fileName, const float& weight = 1.0f);
+
+        ///at each element, exclude values outside the unweighted mean +/- the given numbers of sample standard deviations across inputs
+        void setOutlierExclusion(const float& sigmaBelow, const float& sigmaAbove);
+
+        ///check that the inputs match, set the output XML to that of the first input, and write all rows of the average
+        void run(CiftiFile* output);
+    private:
+        struct Input
+        {
+            const CiftiFile* m_file;//NULL when closed
+            CaretPointer<CiftiFile> m_ownedFile;
+            AString m_fileName;
+            float m_weight;
+            Input() { m_file = NULL; m_weight = 1.0f; }
+        };
+        std::vector<Input> m_inputs;
+        int64_t m_maxBufferBytes;
+        int m_maxOpenFiles;
+        bool m_excludeOutliers;
+        float m_sigmaBelow, m_sigmaAbove;
+        void openInput(Input& input);
+        void readRows(Input& input, float* dataOut, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength, const bool& keepOpen);
+        void accumulate(const float* window, const int& firstInput, const int& numInputs, const int64_t& blockElements,
+                        const int64_t& start, const int64_t& end, double* accum, double* weightAccum) const;
+        bool excludeOutliers(const float* window, const int64_t& blockElements, const int64_t& start, const int64_t& end, float* dataOut) const;
+        CiftiGroupAverager(const CiftiGroupAverager&);
+        CiftiGroupAverager& operator=(const CiftiGroupAverager&);
+    };
+
+}
+
+#endif //__CIFTI_GROUP_AVERAGER_H__
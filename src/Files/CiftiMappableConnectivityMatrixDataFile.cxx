@@ -23,6 +23,8 @@
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #undef __CIFTI_MAPPABLE_CONNECTIVITY_MATRIX_DATA_FILE_DECLARE__
 
+#include <algorithm>
+
 #include "CaretAssert.h"
 #include "CiftiFile.h"
 #include "CaretLogger.h"
@@ -37,6 +39,11 @@
 
 using namespace caret;
 
+namespace
+{
+    const int64_t ROW_AVERAGE_READ_BLOCK_BYTES = 64 * (int64_t)(1 << 20);//consecutive rows of an average are read in blocks of about this size
+}
+
 
     
 /**
@@ -336,6 +343,10 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnIndicesForNodesWhenLoading(
 /**
  * Get the average for or column for the given row/column indices.
  *
+ * Rows are sorted so that each run of consecutive rows is read with
+ * a single read, and a row given more than once is read once and
+ * weighted by its count.
+ *
  * @param rowIndices
  *     Indices of the row.
  * @param columnIndices
@@ -370,33 +381,76 @@ CiftiMappableConnectivityMatrixDataFile::getRowColumnAverageForIndices(const std
     
     const int64_t numIndices = static_cast<int64_t>(indices.size());
     if (numIndices > 0) {
+        CaretAssert(dataLength > 0);
         std::vector<double> sum(dataLength, 0.0);
-        std::vector<float>  data(dataLength);
+        double* sumPointer = &sum[0];
         
-        for (std::vector<int64_t>::const_iterator iter = indices.begin();
-             iter != indices.end();
-             iter++) {
-            if (doRowsFlag) {
-                getDataForRow(&data[0], *iter);
+        if (doRowsFlag) {
+            std::sort(indices.begin(),
+                      indices.end());
+            
+            const int64_t maxRowsPerRead = std::max(static_cast<int64_t>(1),
+                                                    std::min(numIndices,
+                                                             ROW_AVERAGE_READ_BLOCK_BYTES / static_cast<int64_t>(dataLength * sizeof(float))));
+            std::vector<float> data(maxRowsPerRead * dataLength);
+            std::vector<double> rowWeights(maxRowsPerRead);
+            
+            int64_t iIndex = 0;
+            while (iIndex < numIndices) {
+                /*
+                 * Gather the run of consecutive rows starting at this index
+                 */
+                const int64_t firstRow = indices[iIndex];
+                int64_t numRows = 0;
+                while (iIndex < numIndices) {
+                    const int64_t offset = indices[iIndex] - firstRow;
+                    if (offset == (numRows - 1)) {
+                        rowWeights[offset] += 1.0;
+                    }
+                    else if ((offset == numRows)
+                             && (numRows < maxRowsPerRead)) {
+                        rowWeights[numRows] = 1.0;
+                        numRows++;
+                    }
+                    else {
+                        break;
+                    }
+                    iIndex++;
+                }
+                
+                getDataForRows(&data[0],
+                               firstRow,
+                               numRows);
+                
+                for (int64_t iRow = 0; iRow < numRows; iRow++) {
+                    const float* rowData = &data[iRow * dataLength];
+                    const double weight = rowWeights[iRow];
+                    for (int64_t i = 0; i < dataLength; i++) {
+                        sumPointer[i] += weight * rowData[i];
+                    }
+                }
             }
-            else {
+        }
+        else {
+            std::vector<float> data(dataLength);
+            for (std::vector<int64_t>::const_iterator iter = indices.begin();
+                 iter != indices.end();
+                 iter++) {
                 getDataForColumn(&data[0], *iter);
-            }
-            
-            for (int64_t i = 0; i < dataLength; i++) {
-                CaretAssertVectorIndex(sum, i);
-                CaretAssertVectorIndex(data, i);
-                sum[i] += data[i];
+                
+                const float* columnData = &data[0];
+                for (int64_t i = 0; i < dataLength; i++) {
+                    sumPointer[i] += columnData[i];
+                }
             }
         }
 
-        CaretAssert(dataLength > 0);
         std::vector<float> average(dataLength);
-        const float floatNumIndices = numIndices; //dataLength;
+        const double doubleNumIndices = numIndices;
         for (int64_t i = 0; i < dataLength; i++) {
             CaretAssertVectorIndex(average, i);
             CaretAssertVectorIndex(sum, i);
-            average[i] = sum[i] / floatNumIndices;
+            average[i] = sum[i] / doubleNumIndices;
         }
 
         if (doRowsFlag) {
@@ -602,6 +656,24 @@ CiftiMappableConnectivityMatrixDataFile::getDataForRow(float* dataOut, const int
                         index);
 }
 
+/**
+ * Load data for consecutive rows.
+ *
+ * @param dataOut
+ *     Output with data, one row after another.
+ * @param firstIndex
+ *     Index of the first row.
+ * @param numberOfRows
+ *     Number of rows.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::getDataForRows(float* dataOut, const int64_t& firstIndex, const int64_t& numberOfRows) const
+{
+    m_ciftiFile->getRows(dataOut,
+                         firstIndex,
+                         numberOfRows);
+}
+
 /**
  * Load PROCESSED data for the given column.
  *
@@ -920,28 +992,64 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForSurfaceNodes(const
                                                                    const StructureEnum::Enum structure,
                                                                    const std::vector<int32_t>& nodeIndices)
 {
+    std::vector<float> rowAverage, columnAverage;
+    if (readAverageDataForSurfaceNodes(surfaceNumberOfNodes,
+                                       structure,
+                                       nodeIndices,
+                                       rowAverage,
+                                       columnAverage)) {
+        setAverageDataForSurfaceNodes(surfaceNumberOfNodes,
+                                      structure,
+                                      nodeIndices,
+                                      rowAverage,
+                                      columnAverage);
+    }
+}
+
+/**
+ * Read and average the connectivity data for the surface's nodes without
+ * changing the loaded data.  Only reads this file's data, so it may be
+ * called for different files at the same time.  Use
+ * setAverageDataForSurfaceNodes() to make the average the loaded data.
+ *
+ * @param surfaceNumberOfNodes
+ *    Number of nodes in surface.
+ * @param structure
+ *    Surface's structure.
+ * @param nodeIndices
+ *    Indices of nodes.
+ * @param rowAverageOut
+ *    Average of rows, empty if the nodes are not rows of this file.
+ * @param columnAverageOut
+ *    Average of columns, empty if the nodes are not columns of this file.
+ * @return
+ *    False if loading of data is disabled, else true.
+ * @throw
+ *    DataFileException if there is an error.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::readAverageDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                                                        const StructureEnum::Enum structure,
+                                                                        const std::vector<int32_t>& nodeIndices,
+                                                                        std::vector<float>& rowAverageOut,
+                                                                        std::vector<float>& columnAverageOut)
+{
+    rowAverageOut.clear();
+    columnAverageOut.clear();
+    
     if (m_ciftiFile == NULL) {
-        setLoadedRowDataToAllZeros();
-        return;
+        return true;
     }
     
     /*
      * Loading of data disabled?
      */
     if (m_dataLoadingEnabled == false) {
-        return;
+        return false;
     }
     
-    /*
-     * Zero out here so that data only gets cleared when data
-     * is to be loaded.
-     */
-    setLoadedRowDataToAllZeros();
-    
-    
-    const int32_t numberOfNodeIndices = static_cast<int32_t>(nodeIndices.size());
-    if (numberOfNodeIndices <= 0) {
-        return;
+    if (nodeIndices.empty()) {
+        return true;
     }
     
     std::vector<int64_t> rowIndices, columnIndices;
@@ -952,15 +1060,56 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForSurfaceNodes(const
                                            columnIndices);
     if (rowIndices.empty()
         && columnIndices.empty()) {
-        return;
+        return true;
     }
     
-    std::vector<float> rowAverage, columnAverage;
     getRowColumnAverageForIndices(rowIndices,
                                   columnIndices,
-                                  rowAverage,
-                                  columnAverage);
+                                  rowAverageOut,
+                                  columnAverageOut);
+    return true;
+}
 
+/**
+ * Make the average from readAverageDataForSurfaceNodes() the loaded data.
+ *
+ * NOTE: Afterwards, it will be necessary to update this file's color mapping
+ * with updateScalarColoringForMap().
+ *
+ * @param surfaceNumberOfNodes
+ *    Number of nodes in surface.
+ * @param structure
+ *    Surface's structure.
+ * @param nodeIndices
+ *    Indices of nodes.
+ * @param rowAverage
+ *    Average of rows, may be processed by this method.
+ * @param columnAverage
+ *    Average of columns.
+ */
+void
+CiftiMappableConnectivityMatrixDataFile::setAverageDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                                                       const StructureEnum::Enum structure,
+                                                                       const std::vector<int32_t>& nodeIndices,
+                                                                       std::vector<float>& rowAverage,
+                                                                       const std::vector<float>& columnAverage)
+{
+    /*
+     * Zero out here so that data only gets cleared when data
+     * is to be loaded.
+     */
+    setLoadedRowDataToAllZeros();
+    
+    if (m_ciftiFile == NULL) {
+        return;
+    }
+    
+    const int32_t numberOfNodeIndices = static_cast<int32_t>(nodeIndices.size());
+    if (rowAverage.empty()
+        && columnAverage.empty()) {
+        return;
+    }
+    
     /*
      * Update the viewed data
      */
@@ -1203,9 +1352,49 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForVoxelIndices(const
         setLoadedRowDataToAllZeros();
     }
     
+    std::vector<float> rowAverage, columnAverage;
+    if (readAverageDataForVoxelIndices(volumeDimensionIJK,
+                                       voxelIndices,
+                                       rowAverage,
+                                       columnAverage)) {
+        return setAverageDataForVoxelIndices(volumeDimensionIJK,
+                                             voxelIndices,
+                                             rowAverage,
+                                             columnAverage);
+    }
+    return false;
+}
+
+/**
+ * Read and average the connectivity data for the voxel indices without
+ * changing the loaded data.  Only reads this file's data, so it may be
+ * called for different files at the same time.  Use
+ * setAverageDataForVoxelIndices() to make the average the loaded data.
+ *
+ * @param volumeDimensionIJK
+ *    Dimensions of the volume.
+ * @param voxelIndices
+ *    Indices of voxels.
+ * @param rowAverageOut
+ *    Average of rows, empty if the voxels are not rows of this file.
+ * @param columnAverageOut
+ *    Average of columns, empty if the voxels are not columns of this file.
+ * @return
+ *    False if loading of data is disabled, else true.
+ * @throw
+ *    DataFileException if there is an error.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::readAverageDataForVoxelIndices(const int64_t volumeDimensionIJK[3],
+                                                                        const std::vector<VoxelIJK>& voxelIndices,
+                                                                        std::vector<float>& rowAverageOut,
+                                                                        std::vector<float>& columnAverageOut)
+{
+    rowAverageOut.clear();
+    columnAverageOut.clear();
+    
     if (m_ciftiFile == NULL) {
-        setLoadedRowDataToAllZeros();
-        return false;
+        return true;
     }
     
     /*
@@ -1215,13 +1404,6 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForVoxelIndices(const
         return false;
     }
     
-    /*
-     * Zero out here so that data only gets cleared when data
-     * is to be loaded.
-     */
-    setLoadedRowDataToAllZeros();
-    
-    
     std::vector<int64_t> rowIndices, columnIndices;
     getRowColumnIndicesForVoxelsWhenLoading(volumeDimensionIJK,
                                             voxelIndices,
@@ -1229,14 +1411,53 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForVoxelIndices(const
                                             columnIndices);
     if (rowIndices.empty()
         && columnIndices.empty()) {
-        return false;
+        return true;
     }
 
-    std::vector<float> rowAverage, columnAverage;
     getRowColumnAverageForIndices(rowIndices,
                                   columnIndices,
-                                  rowAverage,
-                                  columnAverage);
+                                  rowAverageOut,
+                                  columnAverageOut);
+    return true;
+}
+
+/**
+ * Make the average from readAverageDataForVoxelIndices() the loaded data.
+ *
+ * NOTE: Afterwards, it will be necessary to update this file's color mapping
+ * with updateScalarColoringForMap().
+ *
+ * @param volumeDimensionIJK
+ *    Dimensions of the volume.
+ * @param voxelIndices
+ *    Indices of voxels.
+ * @param rowAverage
+ *    Average of rows, may be processed by this method.
+ * @param columnAverage
+ *    Average of columns.
+ * @return
+ *    True if data was loaded, else false.
+ */
+bool
+CiftiMappableConnectivityMatrixDataFile::setAverageDataForVoxelIndices(const int64_t volumeDimensionIJK[3],
+                                                                       const std::vector<VoxelIJK>& voxelIndices,
+                                                                       std::vector<float>& rowAverage,
+                                                                       const std::vector<float>& columnAverage)
+{
+    /*
+     * Zero out here so that data only gets cleared when data
+     * is to be loaded.
+     */
+    setLoadedRowDataToAllZeros();
+    
+    if (m_ciftiFile == NULL) {
+        return false;
+    }
+    
+    if (rowAverage.empty()
+        && columnAverage.empty()) {
+        return false;
+    }
     
     bool dataWasLoadedFlag = false;
     if ( ! rowAverage.empty()) {
@@ -1248,15 +1469,8 @@ CiftiMappableConnectivityMatrixDataFile::loadMapAverageDataForVoxelIndices(const
         m_loadedRowData = columnAverage;
         dataWasLoadedFlag = true;
     }
-//    if (userCancelled) {
-//        m_loadedRowData.clear();
-//        m_loadedRowData.resize(dataCount, 0.0);
-//    }
+
     if (dataWasLoadedFlag) {
-//        progressEvent.setProgress(numberOfVoxelIndices - 1,
-//                                  "Averaging voxel data");
-//        EventManager::get()->sendEvent(progressEvent.getPointer());
-        
         const int32_t numberOfVoxelIndices = static_cast<int32_t>(voxelIndices.size());
         m_rowLoadedTextForMapName = ("Averaged Voxel Count: "
                                      + AString::number(numberOfVoxelIndices));
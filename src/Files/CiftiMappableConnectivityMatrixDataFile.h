@@ -68,6 +68,28 @@ namespace caret {
                                                        const int64_t volumeDimensionIJK[3],
                                                        const std::vector<VoxelIJK>& voxelIndices);
         
+        bool readAverageDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                            const StructureEnum::Enum structure,
+                                            const std::vector<int32_t>& nodeIndices,
+                                            std::vector<float>& rowAverageOut,
+                                            std::vector<float>& columnAverageOut);
+        
+        void setAverageDataForSurfaceNodes(const int32_t surfaceNumberOfNodes,
+                                           const StructureEnum::Enum structure,
+                                           const std::vector<int32_t>& nodeIndices,
+                                           std::vector<float>& rowAverage,
+                                           const std::vector<float>& columnAverage);
+        
+        bool readAverageDataForVoxelIndices(const int64_t volumeDimensionIJK[3],
+                                            const std::vector<VoxelIJK>& voxelIndices,
+                                            std::vector<float>& rowAverageOut,
+                                            std::vector<float>& columnAverageOut);
+        
+        bool setAverageDataForVoxelIndices(const int64_t volumeDimensionIJK[3],
+                                           const std::vector<VoxelIJK>& voxelIndices,
+                                           std::vector<float>& rowAverage,
+                                           const std::vector<float>& columnAverage);
+        
         void loadDataForRowIndex(const int64_t rowIndex);
         
         void loadDataForColumnIndex(const int64_t rowIndex);
@@ -132,6 +154,8 @@ namespace caret {
         
         virtual void getDataForRow(float* dataOut, const int64_t& index) const;
         
+        virtual void getDataForRows(float* dataOut, const int64_t& firstIndex, const int64_t& numberOfRows) const;
+        
         virtual void processRowAverageData(std::vector<float>& rowAverageData);
         
     private:
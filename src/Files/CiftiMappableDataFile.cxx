@@ -18,8 +18,12 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
+#include <iterator>
 #include <set>
 
+#include <QCoreApplication>
+
 #define __CIFTI_MAPPABLE_DATA_FILE_DECLARE__
 #include "CiftiMappableDataFile.h"
 #undef __CIFTI_MAPPABLE_DATA_FILE_DECLARE__
@@ -36,6 +40,8 @@
 #include "CiftiFiberTrajectoryFile.h"
 #include "CiftiFile.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
+#include "CiftiMatrixTilePyramid.h"
+#include "CiftiMatrixTilePyramidBuilder.h"
 #include "CaretMappableDataFileAndMapSelectionModel.h"
 #include "CiftiParcelLabelFile.h"
 #include "CiftiParcelReordering.h"
@@ -46,6 +52,7 @@
 #include "CiftiXML.h"
 #include "ConnectivityDataLoaded.h"
 #include "DataFileContentInformation.h"
+#include "DataFileException.h"
 #include "EventManager.h"
 #include "EventCaretPreferencesGet.h"
 #include "EventSurfaceColoringInvalidate.h"
@@ -468,6 +475,13 @@ CiftiMappableDataFile::clearPrivate()
      * m_fileMapDataType
      */
     
+    /* pyramid refers to the CIFTI file */
+    m_matrixTileGraphicsPrimitives.clear();
+    m_matrixTileGraphicsPrimitivesUsage.clear();
+    m_matrixTilePyramid.reset();
+    m_matrixTilePyramidBuilder.reset();
+    m_matrixTileRemoteFileWarningFlag = false;
+    
     m_ciftiFile.grabNew(NULL);
     
     resetDataLoadingMembers();
@@ -1483,6 +1497,8 @@ CiftiMappableDataFile::invalidateColoringInAllMaps()
     m_matrixGraphicsTrianglesPrimitive.reset();
     m_matrixGraphicsTexturePrimitive.reset();
     m_matrixGraphicsOutlinePrimitive.reset();
+    m_matrixTileGraphicsPrimitives.clear();
+    m_matrixTileGraphicsPrimitivesUsage.clear();
     invalidateHistogramChartColoring();
 }
 
@@ -1907,6 +1923,293 @@ CiftiMappableDataFile::getMatrixChartingGraphicsPrimitive(const ChartTwoMatrixTr
     return matrixPrimitive;
 }
 
+/**
+ * @return True if the matrix is too large for a single texture and is
+ * drawn from tiles of a multi-resolution pyramid, visible tiles only.
+ * Only supported by files whose matrix rows are the rows of the
+ * CIFTI file, parcel reordering is not applied to tiled matrices.
+ * A dense connectivity matrix is always tiled since it is read
+ * one row at a time and is never read entirely.
+ */
+bool
+CiftiMappableDataFile::isMatrixChartingTiled() const
+{
+    bool alwaysTiledFlag(false);
+    switch (getDataFileType()) {
+        case DataFileTypeEnum::CONNECTIVITY_DENSE:
+            alwaysTiledFlag = true;
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+        case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+            break;
+        default:
+            return false;
+            break;
+    }
+    
+    if ( ! isMappedWithPalette()) {
+        return false;
+    }
+    
+    if (alwaysTiledFlag) {
+        return true;
+    }
+    
+    CaretAssert(m_ciftiFile);
+    const int64_t maximumWidthHeight = GraphicsUtilitiesOpenGL::getTextureWidthHeightMaximumDimension();
+    if ((m_ciftiFile->getNumberOfRows() > maximumWidthHeight)
+        || (m_ciftiFile->getNumberOfColumns() > maximumWidthHeight)) {
+        return true;
+    }
+    
+    return false;
+}
+
+/**
+ * @return The tile pyramid for matrix charting, created on first use
+ * (NULL if the matrix is not tiled or the pyramid is not yet available).
+ *
+ * For a local file, the pyramid is built in a background thread and,
+ * until it is complete, a preview of the coarsest level is provided.
+ * The coarser levels are cached in the user's cache directory when the
+ * matrix tile cache size preference is not zero.  Other
+ * files are built in memory when first used, except for a dense
+ * connectivity file as its entire matrix would need to be read.
+ *
+ * The returned pyramid remains valid until the next call to this method.
+ *
+ * @param downsampleMode
+ *     How cells are combined in the coarser levels.  The pyramid is
+ *     created again when the mode changes.
+ */
+const CiftiMatrixTilePyramid*
+CiftiMappableDataFile::getMatrixChartingTilePyramid(const CiftiMatrixTilePyramid::DownsampleMode downsampleMode) const
+{
+    if ( ! isMatrixChartingTiled()) {
+        return NULL;
+    }
+    
+    if ((m_matrixTilePyramidBuilder
+         && (m_matrixTilePyramidBuilder->getDownsampleMode() != downsampleMode))
+        || (m_matrixTilePyramid
+            && (m_matrixTilePyramid->getDownsampleMode() != downsampleMode))) {
+        m_matrixTileGraphicsPrimitives.clear();
+        m_matrixTileGraphicsPrimitivesUsage.clear();
+        m_matrixTilePyramid.reset();
+        m_matrixTilePyramidBuilder.reset();
+    }
+    
+    if (m_matrixTilePyramidBuilder) {
+        return m_matrixTilePyramidBuilder->updatePyramid();
+    }
+    if (m_matrixTilePyramid) {
+        return m_matrixTilePyramid.get();
+    }
+    
+    FileInformation fileInfo(getFileName());
+    if (fileInfo.isLocalFile()
+        && fileInfo.exists()
+        && (QCoreApplication::instance() != NULL)) {
+        EventCaretPreferencesGet preferencesEvent;
+        EventManager::get()->sendEvent(preferencesEvent.getPointer());
+        const CaretPreferences* caretPreferences = preferencesEvent.getCaretPreferences();
+        const int64_t oneGigabyte = 1024 * 1024 * 1024;
+        const int64_t maximumCacheBytes = ((caretPreferences != NULL)
+                                           ? (caretPreferences->getMatrixTileCacheSizeGigabytes() * oneGigabyte)
+                                           : 0);
+        m_matrixTilePyramidBuilder.reset(new CiftiMatrixTilePyramidBuilder(getFileName(),
+                                                                           downsampleMode,
+                                                                           maximumCacheBytes));
+        return m_matrixTilePyramidBuilder->updatePyramid();
+    }
+    
+    if (getDataFileType() == DataFileTypeEnum::CONNECTIVITY_DENSE) {
+        if ( ! m_matrixTileRemoteFileWarningFlag) {
+            m_matrixTileRemoteFileWarningFlag = true;
+            CaretLogWarning("Matrix of a dense connectivity file is only charted for a local file: "
+                            + getFileName());
+        }
+        return NULL;
+    }
+    
+    CaretAssert(m_ciftiFile);
+    m_matrixTilePyramid.reset(new CiftiMatrixTilePyramid(m_ciftiFile,
+                                                         downsampleMode));
+    m_matrixTilePyramid->build("");
+    
+    return m_matrixTilePyramid.get();
+}
+
+/**
+ * @return The graphics primitive for one tile of a tiled matrix.  Cells
+ * of the full resolution matrix are of dimension 1.0 x 1.0 so that tiles
+ * of all levels align with the non-tiled matrix.  Primitives of recently
+ * drawn tiles are kept, the least recently used are released.
+ *
+ * @param matrixViewMode
+ *     The matrix visualization mode (upper/lower).
+ * @param level
+ *     Level in the pyramid.
+ * @param tileRow
+ *     Tile index vertically (zero is top).
+ * @param tileColumn
+ *     Tile index horizontally.
+ */
+GraphicsPrimitive*
+CiftiMappableDataFile::getMatrixChartingTileGraphicsPrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
+                                                              const int32_t level,
+                                                              const int32_t tileRow,
+                                                              const int32_t tileColumn) const
+{
+    /*
+     * Do not update the pyramid, the caller obtained the level from
+     * the current pyramid with getMatrixChartingTilePyramid().
+     */
+    const CiftiMatrixTilePyramid* pyramid = (m_matrixTilePyramidBuilder
+                                             ? m_matrixTilePyramidBuilder->getPyramid()
+                                             : m_matrixTilePyramid.get());
+    if (pyramid == NULL) {
+        return NULL;
+    }
+    
+    /*
+     * Tiles of the preview are replaced when the pyramid is complete
+     */
+    const MatrixTileKey key {
+        static_cast<int32_t>(matrixViewMode),
+        (pyramid->isPreview() ? 1 : 0),
+        level,
+        tileRow,
+        tileColumn
+    };
+    
+    auto primitiveIter = m_matrixTileGraphicsPrimitives.find(key);
+    if (primitiveIter != m_matrixTileGraphicsPrimitives.end()) {
+        /* Move to most recently used */
+        m_matrixTileGraphicsPrimitivesUsage.splice(m_matrixTileGraphicsPrimitivesUsage.end(),
+                                                   m_matrixTileGraphicsPrimitivesUsage,
+                                                   primitiveIter->second.m_usageIter);
+        return primitiveIter->second.m_primitive.get();
+    }
+    
+    std::vector<float> data;
+    int32_t tileNumberOfRows(0);
+    int32_t tileNumberOfColumns(0);
+    if ( ! pyramid->getTileData(level, tileRow, tileColumn, data, tileNumberOfRows, tileNumberOfColumns)) {
+        return NULL;
+    }
+    const int64_t numberOfCells = static_cast<int64_t>(tileNumberOfRows) * tileNumberOfColumns;
+    if (numberOfCells <= 0) {
+        return NULL;
+    }
+    
+    /*
+     * Color with the file's palette using statistics of the pyramid's
+     * coarsest level.  Statistics of the file are not used since, for
+     * a dense connectivity file, they are those of the loaded row and
+     * tile colors would change when a different row is loaded.
+     */
+    const PaletteColorMapping* pcm = m_ciftiFile->getCiftiXML().getFilePalette();
+    CaretAssert(pcm);
+    const FastStatistics* fileFastStats = pyramid->getStatistics();
+    if (fileFastStats == NULL) {
+        return NULL;
+    }
+    std::vector<uint8_t> cellRGBA(numberOfCells * 4);
+    NodeAndVoxelColoring::colorScalarsWithPalette(fileFastStats,
+                                                  pcm,
+                                                  &data[0],
+                                                  pcm,
+                                                  &data[0],
+                                                  numberOfCells,
+                                                  &cellRGBA[0]);
+    
+    int32_t levelNumberOfRows(0), levelNumberOfColumns(0);
+    pyramid->getLevelDimensions(level, levelNumberOfRows, levelNumberOfColumns);
+    const bool triangularFlag = ((matrixViewMode != ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL)
+                                 && (levelNumberOfRows == levelNumberOfColumns));
+    
+    /*
+     * Texture row zero is at the bottom, matrix row zero is at the top
+     */
+    const int32_t tileSize = pyramid->getTileSize();
+    const int32_t firstLevelRow = tileRow * tileSize;
+    const int32_t firstLevelColumn = tileColumn * tileSize;
+    std::vector<uint8_t> textureRGBA(numberOfCells * 4);
+    for (int32_t i = 0; i < tileNumberOfRows; i++) {
+        const int32_t levelRow = firstLevelRow + i;
+        const int32_t textureRow = tileNumberOfRows - 1 - i;
+        for (int32_t j = 0; j < tileNumberOfColumns; j++) {
+            const int32_t levelColumn = firstLevelColumn + j;
+            bool drawCellFlag = true;
+            if (triangularFlag) {
+                switch (matrixViewMode) {
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL:
+                        break;
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL_NO_DIAGONAL:
+                        drawCellFlag = (levelRow != levelColumn);
+                        break;
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_LOWER_NO_DIAGONAL:
+                        drawCellFlag = (levelRow > levelColumn);
+                        break;
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_UPPER_NO_DIAGONAL:
+                        drawCellFlag = (levelRow < levelColumn);
+                        break;
+                }
+            }
+            const int64_t cellOffset = (static_cast<int64_t>(i) * tileNumberOfColumns + j) * 4;
+            const int64_t textureOffset = (static_cast<int64_t>(textureRow) * tileNumberOfColumns + j) * 4;
+            for (int32_t k = 0; k < 4; k++) {
+                textureRGBA[textureOffset + k] = (drawCellFlag ? cellRGBA[cellOffset + k] : 0);
+            }
+        }
+    }
+    
+    /*
+     * Position of the tile in full resolution cells, cells at the right
+     * and bottom edges of coarse levels may extend past the matrix and
+     * are clamped to it.
+     */
+    const int32_t numberOfRows = static_cast<int32_t>(m_ciftiFile->getNumberOfRows());
+    const int32_t numberOfColumns = static_cast<int32_t>(m_ciftiFile->getNumberOfColumns());
+    const int64_t cellsPerLevelCell = (static_cast<int64_t>(1) << level);
+    const float minX = static_cast<float>(firstLevelColumn * cellsPerLevelCell);
+    const float maxX = static_cast<float>(std::min(static_cast<int64_t>(firstLevelColumn + tileNumberOfColumns) * cellsPerLevelCell,
+                                                   static_cast<int64_t>(numberOfColumns)));
+    const float maxY = static_cast<float>(numberOfRows - firstLevelRow * cellsPerLevelCell);
+    const float minY = static_cast<float>(numberOfRows - std::min(static_cast<int64_t>(firstLevelRow + tileNumberOfRows) * cellsPerLevelCell,
+                                                                  static_cast<int64_t>(numberOfRows)));
+    
+    GraphicsPrimitiveV3fT3f* tilePrimitive = GraphicsPrimitive::newPrimitiveV3fT3f(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLE_STRIP,
+                                                                                   &textureRGBA[0],
+                                                                                   tileNumberOfColumns,
+                                                                                   tileNumberOfRows,
+                                                                                   GraphicsPrimitive::TextureWrappingType::CLAMP,
+                                                                                   GraphicsPrimitive::TextureFilteringType::NEAREST);
+    tilePrimitive->addVertex(minX, maxY, 0, 1);  /* Top Left */
+    tilePrimitive->addVertex(minX, minY, 0, 0);  /* Bottom Left */
+    tilePrimitive->addVertex(maxX, maxY, 1, 1);  /* Top Right */
+    tilePrimitive->addVertex(maxX, minY, 1, 0);  /* Bottom Right */
+    tilePrimitive->setUsageTypeAll(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+    tilePrimitive->setReleaseInstanceDataMode(GraphicsPrimitive::ReleaseInstanceDataMode::ENABLED);
+    
+    m_matrixTileGraphicsPrimitivesUsage.push_back(key);
+    MatrixTilePrimitive& matrixTilePrimitive = m_matrixTileGraphicsPrimitives[key];
+    matrixTilePrimitive.m_primitive.reset(tilePrimitive);
+    matrixTilePrimitive.m_usageIter = std::prev(m_matrixTileGraphicsPrimitivesUsage.end());
+    
+    /*
+     * Limit the number of tile textures, least recently used are first
+     */
+    const int32_t maximumNumberOfTilePrimitives = 256;
+    while (static_cast<int32_t>(m_matrixTileGraphicsPrimitivesUsage.size()) > maximumNumberOfTilePrimitives) {
+        m_matrixTileGraphicsPrimitives.erase(m_matrixTileGraphicsPrimitivesUsage.front());
+        m_matrixTileGraphicsPrimitivesUsage.pop_front();
+    }
+    
+    return tilePrimitive;
+}
+
 
 /**
  * Get the matrix RGBA coloring for this matrix data creator.
@@ -2763,6 +3066,8 @@ CiftiMappableDataFile::updateScalarColoringForMap(const int32_t mapIndex)
     m_matrixGraphicsTrianglesPrimitive.reset();
     m_matrixGraphicsTexturePrimitive.reset();
     m_matrixGraphicsOutlinePrimitive.reset();
+    m_matrixTileGraphicsPrimitives.clear();
+    m_matrixTileGraphicsPrimitivesUsage.clear();
 }
 
 /**
@@ -2783,6 +3088,27 @@ CiftiMappableDataFile::isMapColoringValid(const int32_t mapIndex) const
     return m_mapContent[mapIndex]->m_rgbaValid;
 }
 
+/**
+ * Get the version of the voxel coloring for a map.  The version
+ * changes each time the map's coloring is updated.
+ *
+ * @param mapIndex
+ *    Index of the map.
+ * @return
+ *    Version of coloring or zero if the coloring is not valid
+ *    since it is updated when the voxel colors are retrieved.
+ */
+int64_t
+CiftiMappableDataFile::getVoxelColoringVersionForMap(const int32_t mapIndex) const
+{
+    CaretAssertVectorIndex(m_mapContent,
+                           mapIndex);
+    if (m_mapContent[mapIndex]->m_rgbaValid) {
+        return m_mapContent[mapIndex]->m_rgbaVersion;
+    }
+    return 0;
+}
+
 /**
  * Get the node ins the parcel of the given index.
  * @param parcelNodes
@@ -7798,6 +8124,7 @@ m_mapIndex(mapIndex)
     
     m_dataCount = 0;
     m_rgbaValid = false; 
+    m_rgbaVersion = 0;
     m_dataIsMappedWithLabelTable = false;
     
     const CiftiXML& ciftiXML = m_ciftiFile->getCiftiXML();
@@ -8382,6 +8709,7 @@ CiftiMappableDataFile::MapContent::updateColoring(const std::vector<float>& data
     }
     
     m_rgbaValid = true;
+    m_rgbaVersion = VolumeMappableInterface::newVoxelColoringVersion();
 }
 
 bool CiftiMappableDataFile::hasCiftiXML() const
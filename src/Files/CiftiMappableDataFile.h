@@ -26,11 +26,15 @@
 #include "CaretObjectTracksModification.h"
 #include "ChartTwoMatrixTriangularViewingModeEnum.h"
 #include "CiftiMappingType.h"
+#include "CiftiMatrixTilePyramid.h"
 #include "CiftiXMLElements.h"
 #include "DisplayGroupEnum.h"
 #include "EventListenerInterface.h"
 #include "VolumeMappableInterface.h"
 
+#include <array>
+#include <list>
+#include <map>
 #include <memory>
 #include <set>
 
@@ -39,6 +43,7 @@ namespace caret {
     class ChartData;
     class ChartDataCartesian;
     class CiftiFile;
+    class CiftiMatrixTilePyramidBuilder;
     class CiftiParcelsMap;
     class CiftiScalarsMap;
     class CiftiXML;
@@ -358,6 +363,8 @@ namespace caret {
                                         const int32_t tabIndex,
                                         uint8_t rgbaOut[4]) const override;
         
+        virtual int64_t getVoxelColoringVersionForMap(const int32_t mapIndex) const override;
+        
         virtual void getVoxelColorInMapForLabelData(const std::vector<float>& dataForMap,
                                         const int64_t indexIn1,
                                         const int64_t indexIn2,
@@ -539,6 +546,15 @@ namespace caret {
         /** Identifier for the matrix primitives alternative color used for the grid coloring */
         int32_t getMatrixChartGraphicsPrimitiveGridColorIdentifier() const { return 1; }
         
+        bool isMatrixChartingTiled() const;
+        
+        const CiftiMatrixTilePyramid* getMatrixChartingTilePyramid(const CiftiMatrixTilePyramid::DownsampleMode downsampleMode) const;
+        
+        GraphicsPrimitive* getMatrixChartingTileGraphicsPrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
+                                                                  const int32_t level,
+                                                                  const int32_t tileRow,
+                                                                  const int32_t tileColumn) const;
+        
         virtual void getFileData(std::vector<float>& data) const;
         
         const CiftiFile* getCiftiFile() const { return m_ciftiFile; }
@@ -672,6 +688,9 @@ namespace caret {
             /** RGBA coloring is valid */
             bool m_rgbaValid;
             
+            /** Version of RGBA coloring, changed each time coloring is updated */
+            int64_t m_rgbaVersion;
+            
             /** fast statistics for map */
             CaretPointer<FastStatistics> m_fastStatistics;
             
@@ -808,6 +827,30 @@ namespace caret {
         
         mutable uint8_t m_previousMatrixGridRGBA[4] = { 0, 1, 2, 3 };
         
+        /** Multi-resolution tiles for matrices too large for a single texture (built in this thread) */
+        mutable std::unique_ptr<CiftiMatrixTilePyramid> m_matrixTilePyramid;
+        
+        /** Builds the multi-resolution tiles in a background thread (local files) */
+        mutable std::unique_ptr<CiftiMatrixTilePyramidBuilder> m_matrixTilePyramidBuilder;
+        
+        /** Warning that the matrix of a remote dense file is not charted is logged once for the file */
+        mutable bool m_matrixTileRemoteFileWarningFlag = false;
+        
+        /** Key of a matrix tile primitive (view mode, preview, level, tile row, tile column) */
+        typedef std::array<int32_t, 5> MatrixTileKey;
+        
+        /** A matrix tile primitive and its position in the least recently used order */
+        struct MatrixTilePrimitive {
+            std::unique_ptr<GraphicsPrimitiveV3fT3f> m_primitive;
+            std::list<MatrixTileKey>::iterator m_usageIter;
+        };
+        
+        /** Primitives for matrix tiles */
+        mutable std::map<MatrixTileKey, MatrixTilePrimitive> m_matrixTileGraphicsPrimitives;
+        
+        /** Least recently used order of the matrix tile primitives, most recent is last */
+        mutable std::list<MatrixTileKey> m_matrixTileGraphicsPrimitivesUsage;
+        
         int32_t m_fileHistogramNumberOfBuckets = 100;
         
         /** Histogram with limited values used when statistics computed on all data in file */
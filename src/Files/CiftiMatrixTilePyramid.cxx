@@ -0,0 +1,1093 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __CIFTI_MATRIX_TILE_PYRAMID_DECLARE__
+#include "CiftiMatrixTilePyramid.h"
+#undef __CIFTI_MATRIX_TILE_PYRAMID_DECLARE__
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#endif
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+#include "ElapsedTimer.h"
+#include "FastStatistics.h"
+#include "FileInformation.h"
+
+using namespace caret;
+
+/**
+ * \class caret::CiftiMatrixTilePyramid 
+ * \brief Multi-resolution tiles of a CIFTI matrix for charting
+ * \ingroup Files
+ *
+ * Level zero is the full resolution matrix and is always read from the
+ * CIFTI file on demand, one tile (a band of rows) at a time.  Each
+ * following level halves the number of rows and columns, combining
+ * 2x2 cells of the previous level using the downsample mode.  All
+ * coarser levels are built in one pass that streams the rows of the
+ * CIFTI file, so the full matrix is never held in memory.
+ *
+ * When a cache file is given, the coarser levels are written to it
+ * and later builds with an unchanged CIFTI file only read its header.
+ * Cache files named by getCacheFileNameForCiftiFile() are in the
+ * user's cache directory so nothing is written next to the CIFTI file,
+ * and removeLeastRecentlyUsedCacheFiles() limits their total size.
+ * Without a cache file, only the small coarse levels are kept in
+ * memory and the next coarser level is used in place of the others.
+ *
+ * An instance created with a file name opens its own CIFTI file so
+ * that it may be built in a background thread.  Building may then be
+ * cancelled from another thread with requestCancel().
+ */
+
+/**
+ * Constructor.
+ *
+ * @param ciftiFile
+ *     The CIFTI file whose matrix is tiled.
+ * @param downsampleMode
+ *     How cells are combined in the coarser levels.
+ * @param tileSize
+ *     Number of rows and columns in a tile.
+ */
+CiftiMatrixTilePyramid::CiftiMatrixTilePyramid(const CiftiFile* ciftiFile,
+                                               const DownsampleMode downsampleMode,
+                                               const int32_t tileSize)
+: CaretObject(),
+m_ciftiFile(ciftiFile),
+m_downsampleMode(downsampleMode),
+m_tileSize(tileSize)
+{
+    createLevels();
+}
+
+/**
+ * Constructor that opens the CIFTI file for reading from disk.
+ *
+ * @param ciftiFileName
+ *     Name of the CIFTI file whose matrix is tiled.
+ * @param downsampleMode
+ *     How cells are combined in the coarser levels.
+ * @param tileSize
+ *     Number of rows and columns in a tile.
+ * @throw DataFileException
+ *     If the CIFTI file cannot be opened.
+ */
+CiftiMatrixTilePyramid::CiftiMatrixTilePyramid(const AString& ciftiFileName,
+                                               const DownsampleMode downsampleMode,
+                                               const int32_t tileSize)
+: CaretObject(),
+m_ownedCiftiFile(new CiftiFile(ciftiFileName)),
+m_ciftiFile(m_ownedCiftiFile.get()),
+m_downsampleMode(downsampleMode),
+m_tileSize(tileSize)
+{
+    createLevels();
+}
+
+/**
+ * Destructor.
+ */
+CiftiMatrixTilePyramid::~CiftiMatrixTilePyramid()
+{
+    if (m_cacheFile) {
+        m_cacheFile->close();
+    }
+}
+
+/**
+ * Create the levels, only level zero is available until built.
+ */
+void
+CiftiMatrixTilePyramid::createLevels()
+{
+    CaretAssert(m_ciftiFile);
+    CaretAssert(m_tileSize > 0);
+    
+    const int32_t numberOfRows    = static_cast<int32_t>(m_ciftiFile->getNumberOfRows());
+    const int32_t numberOfColumns = static_cast<int32_t>(m_ciftiFile->getNumberOfColumns());
+    
+    /*
+     * Add levels until the entire matrix fits in one tile
+     */
+    int32_t levelRows = numberOfRows;
+    int32_t levelColumns = numberOfColumns;
+    while (true) {
+        Level level;
+        level.m_numberOfRows        = levelRows;
+        level.m_numberOfColumns     = levelColumns;
+        level.m_numberOfTileRows    = (levelRows + m_tileSize - 1) / m_tileSize;
+        level.m_numberOfTileColumns = (levelColumns + m_tileSize - 1) / m_tileSize;
+        m_levels.push_back(level);
+        
+        if ((levelRows <= m_tileSize)
+            && (levelColumns <= m_tileSize)) {
+            break;
+        }
+        levelRows    = (levelRows + 1) / 2;
+        levelColumns = (levelColumns + 1) / 2;
+    }
+    
+    /*
+     * Full resolution is always read from the CIFTI file
+     */
+    m_levels[0].m_availableFlag = true;
+}
+
+/**
+ * @return The downsample mode.
+ */
+CiftiMatrixTilePyramid::DownsampleMode
+CiftiMatrixTilePyramid::getDownsampleMode() const
+{
+    return m_downsampleMode;
+}
+
+/**
+ * @return Number of rows and columns in a tile.
+ */
+int32_t
+CiftiMatrixTilePyramid::getTileSize() const
+{
+    return m_tileSize;
+}
+
+/**
+ * @return Number of levels, level zero is full resolution.
+ */
+int32_t
+CiftiMatrixTilePyramid::getNumberOfLevels() const
+{
+    return static_cast<int32_t>(m_levels.size());
+}
+
+/**
+ * Get the number of cells in a level.
+ *
+ * @param level
+ *     Index of the level.
+ * @param numberOfRowsOut
+ *     Output with number of rows.
+ * @param numberOfColumnsOut
+ *     Output with number of columns.
+ */
+void
+CiftiMatrixTilePyramid::getLevelDimensions(const int32_t level,
+                                           int32_t& numberOfRowsOut,
+                                           int32_t& numberOfColumnsOut) const
+{
+    CaretAssertVectorIndex(m_levels, level);
+    numberOfRowsOut    = m_levels[level].m_numberOfRows;
+    numberOfColumnsOut = m_levels[level].m_numberOfColumns;
+}
+
+/**
+ * Get the number of tiles in a level.
+ *
+ * @param level
+ *     Index of the level.
+ * @param numberOfTileRowsOut
+ *     Output with number of tiles vertically.
+ * @param numberOfTileColumnsOut
+ *     Output with number of tiles horizontally.
+ */
+void
+CiftiMatrixTilePyramid::getLevelNumberOfTiles(const int32_t level,
+                                              int32_t& numberOfTileRowsOut,
+                                              int32_t& numberOfTileColumnsOut) const
+{
+    CaretAssertVectorIndex(m_levels, level);
+    numberOfTileRowsOut    = m_levels[level].m_numberOfTileRows;
+    numberOfTileColumnsOut = m_levels[level].m_numberOfTileColumns;
+}
+
+/**
+ * @return True if tiles for the given level can be retrieved.
+ *
+ * @param level
+ *     Index of the level.
+ */
+bool
+CiftiMatrixTilePyramid::isLevelAvailable(const int32_t level) const
+{
+    if ((level < 0)
+        || (level >= getNumberOfLevels())) {
+        return false;
+    }
+    return m_levels[level].m_availableFlag;
+}
+
+/**
+ * Get the level that best matches the current zoom.
+ *
+ * @param cellsPerPixel
+ *     Number of full resolution cells covered by one screen pixel.
+ * @return
+ *     Finest available level with no more than one cell per pixel,
+ *     or a coarser level if that level is not available.
+ */
+int32_t
+CiftiMatrixTilePyramid::getLevelForCellsPerPixel(const float cellsPerPixel) const
+{
+    if (cellsPerPixel <= 1.0f) {
+        return 0;
+    }
+    
+    const int32_t lastLevel = getNumberOfLevels() - 1;
+    int32_t level = std::min(static_cast<int32_t>(std::floor(std::log2(cellsPerPixel))),
+                             lastLevel);
+    while ((level < lastLevel)
+           && ( ! m_levels[level].m_availableFlag)) {
+        ++level;
+    }
+    return level;
+}
+
+/**
+ * Get the first row/column and size of a tile.
+ */
+void
+CiftiMatrixTilePyramid::getTileExtent(const int32_t level,
+                                      const int32_t tileRow,
+                                      const int32_t tileColumn,
+                                      int32_t& firstRowOut,
+                                      int32_t& numberOfRowsOut,
+                                      int32_t& firstColumnOut,
+                                      int32_t& numberOfColumnsOut) const
+{
+    CaretAssertVectorIndex(m_levels, level);
+    const Level& lev = m_levels[level];
+    firstRowOut        = tileRow * m_tileSize;
+    numberOfRowsOut    = std::min(m_tileSize, lev.m_numberOfRows - firstRowOut);
+    firstColumnOut     = tileColumn * m_tileSize;
+    numberOfColumnsOut = std::min(m_tileSize, lev.m_numberOfColumns - firstColumnOut);
+}
+
+/**
+ * @return Byte offset of a tile in the cache file.  A level is stored
+ * as its tile rows, each tile row as its tiles (which all have the
+ * height of the tile row).
+ */
+int64_t
+CiftiMatrixTilePyramid::getTileCacheFileOffset(const int32_t level,
+                                               const int32_t tileRow,
+                                               const int32_t tileColumn) const
+{
+    CaretAssertVectorIndex(m_levels, level);
+    const Level& lev = m_levels[level];
+    int32_t firstRow(0), numRows(0), firstColumn(0), numColumns(0);
+    getTileExtent(level, tileRow, tileColumn, firstRow, numRows, firstColumn, numColumns);
+    const int64_t floatOffset = (static_cast<int64_t>(firstRow) * lev.m_numberOfColumns
+                                 + static_cast<int64_t>(firstColumn) * numRows);
+    return lev.m_cacheFileOffset + floatOffset * static_cast<int64_t>(sizeof(float));
+}
+
+/**
+ * Get the data for a tile.
+ *
+ * @param level
+ *     Index of the level.
+ * @param tileRow
+ *     Tile index vertically.
+ * @param tileColumn
+ *     Tile index horizontally.
+ * @param dataOut
+ *     Output with tile data in row major order.
+ * @param numberOfRowsOut
+ *     Output with number of rows in the tile.
+ * @param numberOfColumnsOut
+ *     Output with number of columns in the tile.
+ * @return
+ *     True if the tile data is valid.
+ */
+bool
+CiftiMatrixTilePyramid::getTileData(const int32_t level,
+                                    const int32_t tileRow,
+                                    const int32_t tileColumn,
+                                    std::vector<float>& dataOut,
+                                    int32_t& numberOfRowsOut,
+                                    int32_t& numberOfColumnsOut) const
+{
+    dataOut.clear();
+    numberOfRowsOut = 0;
+    numberOfColumnsOut = 0;
+    if ( ! isLevelAvailable(level)) {
+        return false;
+    }
+    const Level& lev = m_levels[level];
+    if ((tileRow < 0)
+        || (tileRow >= lev.m_numberOfTileRows)
+        || (tileColumn < 0)
+        || (tileColumn >= lev.m_numberOfTileColumns)) {
+        return false;
+    }
+    
+    int32_t firstRow(0), firstColumn(0);
+    getTileExtent(level, tileRow, tileColumn, firstRow, numberOfRowsOut, firstColumn, numberOfColumnsOut);
+    
+    if (level == 0) {
+        readFullResolutionTile(tileRow,
+                               tileColumn,
+                               dataOut);
+        return true;
+    }
+    
+    if (lev.m_cacheFileOffset >= 0) {
+        CaretAssert(m_cacheFile);
+        const int64_t numBytes = (static_cast<int64_t>(numberOfRowsOut) * numberOfColumnsOut
+                                  * static_cast<int64_t>(sizeof(float)));
+        dataOut.resize(static_cast<int64_t>(numberOfRowsOut) * numberOfColumnsOut);
+        if (( ! m_cacheFile->seek(getTileCacheFileOffset(level, tileRow, tileColumn)))
+            || (m_cacheFile->read(reinterpret_cast<char*>(&dataOut[0]), numBytes) != numBytes)) {
+            CaretLogWarning("Failed to read matrix tile from "
+                            + m_cacheFile->fileName()
+                            + ": "
+                            + m_cacheFile->errorString());
+            dataOut.clear();
+            return false;
+        }
+        return true;
+    }
+    
+    const int32_t tileIndex = tileRow * lev.m_numberOfTileColumns + tileColumn;
+    CaretAssertVectorIndex(lev.m_memoryTiles, tileIndex);
+    dataOut = lev.m_memoryTiles[tileIndex];
+    return ( ! dataOut.empty());
+}
+
+/**
+ * Read a full resolution tile from the CIFTI file.
+ */
+void
+CiftiMatrixTilePyramid::readFullResolutionTile(const int32_t tileRow,
+                                               const int32_t tileColumn,
+                                               std::vector<float>& dataOut) const
+{
+    int32_t firstRow(0), numRows(0), firstColumn(0), numColumns(0);
+    getTileExtent(0, tileRow, tileColumn, firstRow, numRows, firstColumn, numColumns);
+    
+    std::vector<float> rowData(m_levels[0].m_numberOfColumns);
+    dataOut.resize(static_cast<int64_t>(numRows) * numColumns);
+    for (int32_t i = 0; i < numRows; i++) {
+        m_ciftiFile->getRow(&rowData[0],
+                            firstRow + i);
+        std::memcpy(&dataOut[static_cast<int64_t>(i) * numColumns],
+                    &rowData[firstColumn],
+                    numColumns * sizeof(float));
+    }
+}
+
+/**
+ * @return Name of the cache file for the tiles of a CIFTI file in the
+ * user's cache directory (empty if there is no cache directory or the
+ * CIFTI file is not a local file).  The name contains a hash of the
+ * CIFTI file's path so that files with the same name do not collide,
+ * and the downsample mode so that both modes may be cached.
+ *
+ * @param ciftiFileName
+ *     Name of the CIFTI file.
+ * @param downsampleMode
+ *     How cells are combined in the coarser levels.
+ */
+AString
+CiftiMatrixTilePyramid::getCacheFileNameForCiftiFile(const AString& ciftiFileName,
+                                                     const DownsampleMode downsampleMode)
+{
+    FileInformation ciftiFileInfo(ciftiFileName);
+    if (( ! ciftiFileInfo.isLocalFile())
+        || ( ! ciftiFileInfo.exists())) {
+        return "";
+    }
+    
+#if QT_VERSION >= 0x050000
+    const QString cacheDirectoryName = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+    const QString cacheDirectoryName;
+#endif
+    if (cacheDirectoryName.isEmpty()) {
+        return "";
+    }
+    
+    QDir tilesDirectory(cacheDirectoryName + "/matrix_tiles");
+    if ( ! tilesDirectory.exists()) {
+        if ( ! tilesDirectory.mkpath(".")) {
+            CaretLogWarning("Unable to create matrix tile cache directory "
+                            + tilesDirectory.absolutePath());
+            return "";
+        }
+    }
+    
+    AString modeName;
+    switch (downsampleMode) {
+        case DownsampleMode::MEAN:
+            modeName = "mean";
+            break;
+        case DownsampleMode::MAXIMUM_ABSOLUTE:
+            modeName = "maxabs";
+            break;
+    }
+    
+    const QByteArray pathHash = QCryptographicHash::hash(ciftiFileInfo.getAbsoluteFilePath().toUtf8(),
+                                                         QCryptographicHash::Md5).toHex();
+    return tilesDirectory.filePath(ciftiFileInfo.getFileName()
+                                   + "_"
+                                   + QString(pathHash)
+                                   + "_"
+                                   + modeName
+                                   + ".wbtiles");
+}
+
+/**
+ * Remove the cache files that were used least recently, other than the
+ * given cache file, until the total size of the cache files in its
+ * directory is no more than the given size.  Opening a cache file
+ * updates its modification time, which orders the files by use.
+ *
+ * @param cacheFileName
+ *     Name of the cache file that is kept (it is not counted).
+ * @param maximumBytes
+ *     Maximum size of the other cache files.
+ */
+void
+CiftiMatrixTilePyramid::removeLeastRecentlyUsedCacheFiles(const AString& cacheFileName,
+                                                          const int64_t maximumBytes)
+{
+    const QFileInfo cacheFileInfo(cacheFileName);
+    const QDir tilesDirectory = cacheFileInfo.absoluteDir();
+    
+    /*
+     * Most recently modified are first
+     */
+    const QFileInfoList cacheFiles = tilesDirectory.entryInfoList(QStringList("*.wbtiles"),
+                                                                  QDir::Files,
+                                                                  QDir::Time);
+    int64_t totalBytes = 0;
+    for (const QFileInfo& fileInfo : cacheFiles) {
+        if (fileInfo.absoluteFilePath() == cacheFileInfo.absoluteFilePath()) {
+            continue;
+        }
+        totalBytes += fileInfo.size();
+        if (totalBytes > maximumBytes) {
+            if (QFile::remove(fileInfo.absoluteFilePath())) {
+                CaretLogInfo("Removed least recently used matrix tile cache "
+                             + fileInfo.absoluteFilePath());
+            }
+            else {
+                CaretLogWarning("Unable to remove matrix tile cache "
+                                + fileInfo.absoluteFilePath());
+            }
+        }
+    }
+}
+
+/**
+ * @return Size, in bytes, of the cache file containing all coarser levels.
+ */
+int64_t
+CiftiMatrixTilePyramid::getCacheFileSize() const
+{
+    const int64_t headerSize = 64;
+    int64_t numberOfBytes = headerSize;
+    for (int32_t iLevel = 1; iLevel < getNumberOfLevels(); iLevel++) {
+        numberOfBytes += (static_cast<int64_t>(m_levels[iLevel].m_numberOfRows)
+                          * m_levels[iLevel].m_numberOfColumns
+                          * static_cast<int64_t>(sizeof(float)));
+    }
+    return numberOfBytes;
+}
+
+/**
+ * Update the size and modification time of the CIFTI file that are
+ * used to validate a cache file.
+ *
+ * @return True if the CIFTI file is a local file that exists.
+ */
+bool
+CiftiMatrixTilePyramid::updateSourceFileInformation()
+{
+    const AString ciftiFileName = m_ciftiFile->getFileName();
+    if (ciftiFileName.isEmpty()) {
+        return false;
+    }
+    FileInformation ciftiFileInfo(ciftiFileName);
+    if (( ! ciftiFileInfo.isLocalFile())
+        || ( ! ciftiFileInfo.exists())) {
+        return false;
+    }
+    m_sourceFileSize         = ciftiFileInfo.size();
+    m_sourceFileModifiedTime = ciftiFileInfo.getLastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+/**
+ * Set the offsets of the coarser levels in the cache file.
+ *
+ * @param cacheFileFlag
+ *     If true, levels are in the cache file, else they are not cached.
+ */
+void
+CiftiMatrixTilePyramid::setCacheFileLevelOffsets(const bool cacheFileFlag)
+{
+    const int64_t headerSize = 64;
+    int64_t levelOffset = headerSize;
+    for (int32_t iLevel = 1; iLevel < getNumberOfLevels(); iLevel++) {
+        if (cacheFileFlag) {
+            m_levels[iLevel].m_cacheFileOffset = levelOffset;
+            levelOffset += (static_cast<int64_t>(m_levels[iLevel].m_numberOfRows)
+                            * m_levels[iLevel].m_numberOfColumns
+                            * static_cast<int64_t>(sizeof(float)));
+        }
+        else {
+            m_levels[iLevel].m_cacheFileOffset = -1;
+        }
+    }
+}
+
+/**
+ * Use the levels in an existing cache file.
+ *
+ * @param cacheFileName
+ *     Name of the cache file.
+ * @return
+ *     True if the cache file exists and matches the CIFTI file in
+ *     which case all levels are available.
+ */
+bool
+CiftiMatrixTilePyramid::openCacheFile(const AString& cacheFileName)
+{
+    if (cacheFileName.isEmpty()
+        || ( ! updateSourceFileInformation())) {
+        return false;
+    }
+    
+    m_cacheFile.reset(new QFile(cacheFileName));
+    if (m_cacheFile->exists()
+        && m_cacheFile->open(QFile::ReadOnly)) {
+        if (readCacheFileHeader()) {
+#if QT_VERSION >= 0x050A00
+            /*
+             * Modification time orders the cache files by use
+             */
+            m_cacheFile->setFileTime(QDateTime::currentDateTime(),
+                                     QFileDevice::FileModificationTime);
+#endif
+            setCacheFileLevelOffsets(true);
+            for (int32_t iLevel = 1; iLevel < getNumberOfLevels(); iLevel++) {
+                m_levels[iLevel].m_availableFlag = true;
+            }
+            m_previewFlag = false;
+            updateStatistics();
+            CaretLogInfo("Using matrix tile cache "
+                         + cacheFileName);
+            return true;
+        }
+        m_cacheFile->close();
+    }
+    m_cacheFile.reset();
+    
+    return false;
+}
+
+/**
+ * Build the coarser levels of the pyramid.
+ *
+ * @param cacheFileName
+ *     Name of the cache file.  If empty, or the file cannot be written,
+ *     the levels are kept in memory.  If the cache file exists and
+ *     matches the CIFTI file, the levels are read from it.
+ * @throw DataFileException
+ *     If reading the CIFTI file fails.
+ */
+void
+CiftiMatrixTilePyramid::build(const AString& cacheFileName)
+{
+    if (openCacheFile(cacheFileName)) {
+        return;
+    }
+    
+    bool useCacheFlag = false;
+    if (( ! cacheFileName.isEmpty())
+        && updateSourceFileInformation()) {
+        m_cacheFile.reset(new QFile(cacheFileName));
+        if (m_cacheFile->open(QFile::ReadWrite | QFile::Truncate)) {
+            useCacheFlag = true;
+        }
+        else {
+            CaretLogWarning("Unable to create matrix tile cache "
+                            + cacheFileName
+                            + ", tiles are kept in memory: "
+                            + m_cacheFile->errorString());
+        }
+    }
+    
+    if ( ! useCacheFlag) {
+        m_cacheFile.reset();
+    }
+    setCacheFileLevelOffsets(useCacheFlag);
+    
+    ElapsedTimer timer;
+    timer.start();
+    
+    bool cacheWrittenFlag = buildFromCiftiFile(useCacheFlag);
+    if (isCancelRequested()) {
+        /*
+         * Header is not written so that the incomplete cache file is not used
+         */
+        return;
+    }
+    
+    if (useCacheFlag
+        && cacheWrittenFlag) {
+        /*
+         * Header is written last so that an interrupted build is not used
+         */
+        cacheWrittenFlag = (writeCacheFileHeader()
+                            && m_cacheFile->flush());
+    }
+    
+    if (useCacheFlag
+        && ( ! cacheWrittenFlag)) {
+        /*
+         * Errors reading the CIFTI file are thrown, only a failure
+         * writing the cache file (such as a full disk) is built again
+         */
+        CaretLogWarning("Failed writing matrix tile cache "
+                        + cacheFileName
+                        + ", tiles are kept in memory: "
+                        + m_cacheFile->errorString());
+        m_cacheFile->remove();
+        m_cacheFile.reset();
+        resetCoarserLevels();
+        setCacheFileLevelOffsets(false);
+        buildFromCiftiFile(false);
+        if (isCancelRequested()) {
+            return;
+        }
+    }
+    m_previewFlag = false;
+    updateStatistics();
+    
+    CaretLogInfo("Time to build matrix tiles for "
+                 + m_ciftiFile->getFileName()
+                 + " was "
+                 + AString::number(timer.getElapsedTimeSeconds())
+                 + " seconds");
+}
+
+/**
+ * Quickly create an approximation of the coarsest level so that the
+ * matrix may be displayed while the pyramid is built.  Only one row of
+ * the CIFTI file is read for each row of the coarsest level.
+ */
+void
+CiftiMatrixTilePyramid::buildPreview()
+{
+    const int32_t level = getNumberOfLevels() - 1;
+    if (level <= 0) {
+        return;
+    }
+    
+    Level& lev = m_levels[level];
+    CaretAssert((lev.m_numberOfTileRows == 1)
+                && (lev.m_numberOfTileColumns == 1));
+    const int32_t numberOfRows    = m_levels[0].m_numberOfRows;
+    const int32_t numberOfColumns = m_levels[0].m_numberOfColumns;
+    const int32_t rowsPerLevelRow = (1 << level);
+    
+    std::vector<float> rowData(numberOfColumns);
+    std::vector<float> tileData(static_cast<int64_t>(lev.m_numberOfRows) * lev.m_numberOfColumns, 0.0f);
+    std::vector<double> sum(lev.m_numberOfColumns);
+    std::vector<float> maxAbs(lev.m_numberOfColumns);
+    std::vector<int32_t> count(lev.m_numberOfColumns);
+    for (int32_t i = 0; i < lev.m_numberOfRows; i++) {
+        if (isCancelRequested()) {
+            return;
+        }
+        
+        /*
+         * Use the middle row of the rows combined into this row of the level
+         */
+        const int32_t ciftiRow = std::min(i * rowsPerLevelRow + rowsPerLevelRow / 2,
+                                          numberOfRows - 1);
+        m_ciftiFile->getRow(&rowData[0],
+                            ciftiRow);
+        
+        std::fill(sum.begin(), sum.end(), 0.0);
+        std::fill(maxAbs.begin(), maxAbs.end(), 0.0f);
+        std::fill(count.begin(), count.end(), 0);
+        for (int32_t j = 0; j < numberOfColumns; j++) {
+            const float value = rowData[j];
+            if ( ! std::isfinite(value)) {
+                continue;
+            }
+            const int32_t levelColumn = (j >> level);
+            if ((count[levelColumn] == 0)
+                || (std::fabs(value) > std::fabs(maxAbs[levelColumn]))) {
+                maxAbs[levelColumn] = value;
+            }
+            sum[levelColumn] += value;
+            count[levelColumn]++;
+        }
+        
+        float* tileRow = &tileData[static_cast<int64_t>(i) * lev.m_numberOfColumns];
+        for (int32_t j = 0; j < lev.m_numberOfColumns; j++) {
+            if (count[j] > 0) {
+                switch (m_downsampleMode) {
+                    case DownsampleMode::MEAN:
+                        tileRow[j] = static_cast<float>(sum[j] / count[j]);
+                        break;
+                    case DownsampleMode::MAXIMUM_ABSOLUTE:
+                        tileRow[j] = maxAbs[j];
+                        break;
+                }
+            }
+        }
+    }
+    
+    lev.m_memoryTiles.resize(1);
+    lev.m_memoryTiles[0].swap(tileData);
+    lev.m_cacheFileOffset = -1;
+    lev.m_availableFlag = true;
+    m_previewFlag = true;
+    updateStatistics();
+}
+
+/**
+ * Update the statistics from the coarsest level.  The coarsest level is
+ * a single tile that covers the whole matrix so it is a good
+ * approximation of the distribution of all values in the matrix.
+ */
+void
+CiftiMatrixTilePyramid::updateStatistics()
+{
+    const int32_t level = getNumberOfLevels() - 1;
+    std::vector<float> data;
+    int32_t numberOfRows(0);
+    int32_t numberOfColumns(0);
+    if ((level >= 0)
+        && getTileData(level, 0, 0, data, numberOfRows, numberOfColumns)
+        && ( ! data.empty())) {
+        m_statistics.reset(new FastStatistics(&data[0],
+                                              static_cast<int64_t>(data.size())));
+    }
+    else {
+        m_statistics.reset();
+    }
+}
+
+/**
+ * @return Statistics of the coarsest level for coloring the tiles so
+ * that all tiles use the same statistics.  NULL if not available.
+ */
+const FastStatistics*
+CiftiMatrixTilePyramid::getStatistics() const
+{
+    return m_statistics.get();
+}
+
+/**
+ * @return True if the only coarse level is the approximation
+ * created by buildPreview().
+ */
+bool
+CiftiMatrixTilePyramid::isPreview() const
+{
+    return m_previewFlag;
+}
+
+/**
+ * Request that a build in progress (in another thread) stop.
+ * The pyramid should not be used after the build is cancelled.
+ */
+void
+CiftiMatrixTilePyramid::requestCancel()
+{
+    QMutexLocker locker(&m_cancelMutex);
+    m_cancelRequestedFlag = true;
+}
+
+/**
+ * @return True if cancelling the build has been requested.
+ */
+bool
+CiftiMatrixTilePyramid::isCancelRequested() const
+{
+    QMutexLocker locker(&m_cancelMutex);
+    return m_cancelRequestedFlag;
+}
+
+/**
+ * Make the coarser levels unavailable and release their tiles.
+ */
+void
+CiftiMatrixTilePyramid::resetCoarserLevels()
+{
+    for (int32_t iLevel = 1; iLevel < getNumberOfLevels(); iLevel++) {
+        Level& lev = m_levels[iLevel];
+        lev.m_memoryTiles.clear();
+        lev.m_cacheFileOffset = -1;
+        lev.m_availableFlag = false;
+    }
+}
+
+/**
+ * Compute the coarser levels by streaming the rows of the CIFTI file.
+ * Each level is computed directly from the full resolution rows, and
+ * a level's tiles are emitted as soon as a band of tile rows is complete.
+ * Building stops when cancellation is requested.
+ *
+ * @param writeCacheFlag
+ *     If true, tiles are written to the cache file, else kept in memory.
+ * @return
+ *     False if writing to the cache file failed, else true.
+ * @throw DataFileException
+ *     If reading the CIFTI file fails.
+ */
+bool
+CiftiMatrixTilePyramid::buildFromCiftiFile(const bool writeCacheFlag)
+{
+    const int32_t numLevels = getNumberOfLevels();
+    const int32_t numberOfRows    = m_levels[0].m_numberOfRows;
+    const int32_t numberOfColumns = m_levels[0].m_numberOfColumns;
+    
+    class Accumulator {
+    public:
+        int32_t m_level = 0;
+        std::vector<double> m_sum;
+        std::vector<float> m_maxAbs;
+        std::vector<int32_t> m_count;
+        std::vector<float> m_band;
+        int32_t m_bandRows = 0;
+        int32_t m_tileRow = 0;
+        bool m_bandFullFlag = false;
+    };
+    
+    std::vector<Accumulator> accumulators;
+    for (int32_t iLevel = 1; iLevel < numLevels; iLevel++) {
+        Level& lev = m_levels[iLevel];
+        const int64_t numCells = static_cast<int64_t>(lev.m_numberOfRows) * lev.m_numberOfColumns;
+        if (writeCacheFlag
+            || (numCells <= s_maximumInMemoryLevelCells)) {
+            lev.m_availableFlag = true;
+            if ( ! writeCacheFlag) {
+                lev.m_memoryTiles.resize(static_cast<int64_t>(lev.m_numberOfTileRows) * lev.m_numberOfTileColumns);
+            }
+            
+            Accumulator acc;
+            acc.m_level = iLevel;
+            acc.m_sum.resize(lev.m_numberOfColumns, 0.0);
+            acc.m_maxAbs.resize(lev.m_numberOfColumns, 0.0f);
+            acc.m_count.resize(lev.m_numberOfColumns, 0);
+            acc.m_band.resize(static_cast<int64_t>(m_tileSize) * lev.m_numberOfColumns, 0.0f);
+            accumulators.push_back(acc);
+        }
+    }
+    const int32_t numAccumulators = static_cast<int32_t>(accumulators.size());
+    if (numAccumulators <= 0) {
+        return true;
+    }
+    
+    std::vector<float> rowData(numberOfColumns);
+    std::vector<float> tileData;
+    for (int32_t iRow = 0; iRow < numberOfRows; iRow++) {
+        if (isCancelRequested()) {
+            return true;
+        }
+        m_ciftiFile->getRow(&rowData[0],
+                            iRow);
+        
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int32_t iAcc = 0; iAcc < numAccumulators; iAcc++) {
+            Accumulator& acc = accumulators[iAcc];
+            const int32_t level = acc.m_level;
+            const int32_t levelColumns = m_levels[level].m_numberOfColumns;
+            for (int32_t j = 0; j < numberOfColumns; j++) {
+                const float value = rowData[j];
+                if ( ! std::isfinite(value)) {
+                    continue;
+                }
+                const int32_t levelColumn = (j >> level);
+                switch (m_downsampleMode) {
+                    case DownsampleMode::MEAN:
+                        acc.m_sum[levelColumn] += value;
+                        break;
+                    case DownsampleMode::MAXIMUM_ABSOLUTE:
+                        if ((acc.m_count[levelColumn] == 0)
+                            || (std::fabs(value) > std::fabs(acc.m_maxAbs[levelColumn]))) {
+                            acc.m_maxAbs[levelColumn] = value;
+                        }
+                        break;
+                }
+                acc.m_count[levelColumn]++;
+            }
+            
+            /*
+             * Row of the level is complete
+             */
+            const int32_t rowsPerLevelRow = (1 << level);
+            if ((((iRow + 1) % rowsPerLevelRow) == 0)
+                || (iRow == (numberOfRows - 1))) {
+                float* bandRow = &acc.m_band[static_cast<int64_t>(acc.m_bandRows) * levelColumns];
+                for (int32_t j = 0; j < levelColumns; j++) {
+                    float value = 0.0f;
+                    if (acc.m_count[j] > 0) {
+                        switch (m_downsampleMode) {
+                            case DownsampleMode::MEAN:
+                                value = static_cast<float>(acc.m_sum[j] / acc.m_count[j]);
+                                break;
+                            case DownsampleMode::MAXIMUM_ABSOLUTE:
+                                value = acc.m_maxAbs[j];
+                                break;
+                        }
+                    }
+                    bandRow[j] = value;
+                    acc.m_sum[j]    = 0.0;
+                    acc.m_maxAbs[j] = 0.0f;
+                    acc.m_count[j]  = 0;
+                }
+                acc.m_bandRows++;
+                if ((acc.m_bandRows == m_tileSize)
+                    || (iRow == (numberOfRows - 1))) {
+                    acc.m_bandFullFlag = true;
+                }
+            }
+        }
+        
+        /*
+         * Cut completed bands into tiles, file writes are serial
+         */
+        for (Accumulator& acc : accumulators) {
+            if ( ! acc.m_bandFullFlag) {
+                continue;
+            }
+            Level& lev = m_levels[acc.m_level];
+            for (int32_t iTileColumn = 0; iTileColumn < lev.m_numberOfTileColumns; iTileColumn++) {
+                int32_t firstRow(0), numRows(0), firstColumn(0), numColumns(0);
+                getTileExtent(acc.m_level, acc.m_tileRow, iTileColumn, firstRow, numRows, firstColumn, numColumns);
+                CaretAssert(numRows == acc.m_bandRows);
+                tileData.resize(static_cast<int64_t>(numRows) * numColumns);
+                for (int32_t i = 0; i < numRows; i++) {
+                    std::memcpy(&tileData[static_cast<int64_t>(i) * numColumns],
+                                &acc.m_band[static_cast<int64_t>(i) * lev.m_numberOfColumns + firstColumn],
+                                numColumns * sizeof(float));
+                }
+                
+                if (writeCacheFlag) {
+                    const int64_t numBytes = tileData.size() * sizeof(float);
+                    if (( ! m_cacheFile->seek(getTileCacheFileOffset(acc.m_level, acc.m_tileRow, iTileColumn)))
+                        || (m_cacheFile->write(reinterpret_cast<const char*>(&tileData[0]), numBytes) != numBytes)) {
+                        return false;
+                    }
+                }
+                else {
+                    lev.m_memoryTiles[acc.m_tileRow * lev.m_numberOfTileColumns + iTileColumn] = tileData;
+                }
+            }
+            acc.m_bandRows = 0;
+            acc.m_tileRow++;
+            acc.m_bandFullFlag = false;
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Read and validate the header of an existing cache file.
+ *
+ * @return True if the cache file matches the CIFTI file and tiling.
+ */
+bool
+CiftiMatrixTilePyramid::readCacheFileHeader()
+{
+    CaretAssert(m_cacheFile);
+    char header[64];
+    if (m_cacheFile->read(header, sizeof(header)) != static_cast<int64_t>(sizeof(header))) {
+        return false;
+    }
+    
+    int32_t ints[8];
+    int64_t longs[2];
+    std::memcpy(ints, header + 8, sizeof(ints));
+    std::memcpy(longs, header + 40, sizeof(longs));
+    
+    if ((std::memcmp(header, "WBMTILES", 8) != 0)
+        || (ints[0] != 0x01020304)  /* byte order */
+        || (ints[1] != s_cacheFileVersion)
+        || (ints[2] != m_levels[0].m_numberOfRows)
+        || (ints[3] != m_levels[0].m_numberOfColumns)
+        || (ints[4] != m_tileSize)
+        || (ints[5] != static_cast<int32_t>(m_downsampleMode))
+        || (ints[6] != getNumberOfLevels())
+        || (longs[0] != m_sourceFileSize)
+        || (longs[1] != m_sourceFileModifiedTime)) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Write the header of the cache file.
+ *
+ * @return True if the header was written.
+ */
+bool
+CiftiMatrixTilePyramid::writeCacheFileHeader()
+{
+    CaretAssert(m_cacheFile);
+    char header[64];
+    std::memset(header, 0, sizeof(header));
+    std::memcpy(header, "WBMTILES", 8);
+    
+    const int32_t ints[8] = {
+        0x01020304,
+        s_cacheFileVersion,
+        m_levels[0].m_numberOfRows,
+        m_levels[0].m_numberOfColumns,
+        m_tileSize,
+        static_cast<int32_t>(m_downsampleMode),
+        getNumberOfLevels(),
+        0
+    };
+    const int64_t longs[2] = {
+        m_sourceFileSize,
+        m_sourceFileModifiedTime
+    };
+    std::memcpy(header + 8, ints, sizeof(ints));
+    std::memcpy(header + 40, longs, sizeof(longs));
+    
+    return (m_cacheFile->seek(0)
+            && (m_cacheFile->write(header, sizeof(header)) == static_cast<int64_t>(sizeof(header))));
+}
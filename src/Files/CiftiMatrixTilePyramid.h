@@ -0,0 +1,203 @@
+#ifndef __CIFTI_MATRIX_TILE_PYRAMID_H__
+#define __CIFTI_MATRIX_TILE_PYRAMID_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+
+#include "CaretObject.h"
+
+class QFile;
+
+namespace caret {
+
+    class CiftiFile;
+    class FastStatistics;
+    
+    class CiftiMatrixTilePyramid : public CaretObject {
+        
+    public:
+        /**
+         * How cells of a level are combined into one cell of the next coarser level
+         */
+        enum class DownsampleMode {
+            /** Mean of the finite values */
+            MEAN,
+            /** Value with the largest magnitude (sign is kept) */
+            MAXIMUM_ABSOLUTE
+        };
+        
+        CiftiMatrixTilePyramid(const CiftiFile* ciftiFile,
+                               const DownsampleMode downsampleMode,
+                               const int32_t tileSize = 256);
+        
+        CiftiMatrixTilePyramid(const AString& ciftiFileName,
+                               const DownsampleMode downsampleMode,
+                               const int32_t tileSize = 256);
+        
+        virtual ~CiftiMatrixTilePyramid();
+        
+        bool openCacheFile(const AString& cacheFileName);
+        
+        void build(const AString& cacheFileName);
+        
+        void buildPreview();
+        
+        bool isPreview() const;
+        
+        void requestCancel();
+        
+        bool isCancelRequested() const;
+        
+        static AString getCacheFileNameForCiftiFile(const AString& ciftiFileName,
+                                                    const DownsampleMode downsampleMode);
+        
+        static void removeLeastRecentlyUsedCacheFiles(const AString& cacheFileName,
+                                                      const int64_t maximumBytes);
+        
+        int64_t getCacheFileSize() const;
+        
+        DownsampleMode getDownsampleMode() const;
+        
+        int32_t getTileSize() const;
+        
+        int32_t getNumberOfLevels() const;
+        
+        void getLevelDimensions(const int32_t level,
+                                int32_t& numberOfRowsOut,
+                                int32_t& numberOfColumnsOut) const;
+        
+        void getLevelNumberOfTiles(const int32_t level,
+                                   int32_t& numberOfTileRowsOut,
+                                   int32_t& numberOfTileColumnsOut) const;
+        
+        bool isLevelAvailable(const int32_t level) const;
+        
+        int32_t getLevelForCellsPerPixel(const float cellsPerPixel) const;
+        
+        bool getTileData(const int32_t level,
+                         const int32_t tileRow,
+                         const int32_t tileColumn,
+                         std::vector<float>& dataOut,
+                         int32_t& numberOfRowsOut,
+                         int32_t& numberOfColumnsOut) const;
+        
+        const FastStatistics* getStatistics() const;
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        class Level {
+        public:
+            int32_t m_numberOfRows = 0;
+            int32_t m_numberOfColumns = 0;
+            int32_t m_numberOfTileRows = 0;
+            int32_t m_numberOfTileColumns = 0;
+            /** Tiles held in memory (row major by tile), empty when on disk or not available */
+            std::vector<std::vector<float>> m_memoryTiles;
+            /** Offset of the first tile of this level in the cache file, negative if not cached */
+            int64_t m_cacheFileOffset = -1;
+            bool m_availableFlag = false;
+        };
+        
+        CiftiMatrixTilePyramid(const CiftiMatrixTilePyramid&);
+
+        CiftiMatrixTilePyramid& operator=(const CiftiMatrixTilePyramid&);
+        
+        void createLevels();
+        
+        bool updateSourceFileInformation();
+        
+        void setCacheFileLevelOffsets(const bool cacheFileFlag);
+        
+        void getTileExtent(const int32_t level,
+                           const int32_t tileRow,
+                           const int32_t tileColumn,
+                           int32_t& firstRowOut,
+                           int32_t& numberOfRowsOut,
+                           int32_t& firstColumnOut,
+                           int32_t& numberOfColumnsOut) const;
+        
+        int64_t getTileCacheFileOffset(const int32_t level,
+                                       const int32_t tileRow,
+                                       const int32_t tileColumn) const;
+        
+        bool readCacheFileHeader();
+        
+        bool writeCacheFileHeader();
+        
+        void resetCoarserLevels();
+        
+        void updateStatistics();
+        
+        bool buildFromCiftiFile(const bool writeCacheFlag);
+        
+        void readFullResolutionTile(const int32_t tileRow,
+                                    const int32_t tileColumn,
+                                    std::vector<float>& dataOut) const;
+        
+        /** CIFTI file opened by this instance so that it may be read in another thread */
+        std::unique_ptr<CiftiFile> m_ownedCiftiFile;
+        
+        const CiftiFile* m_ciftiFile;
+        
+        const DownsampleMode m_downsampleMode;
+        
+        const int32_t m_tileSize;
+        
+        std::vector<Level> m_levels;
+        
+        int64_t m_sourceFileSize = 0;
+        
+        int64_t m_sourceFileModifiedTime = 0;
+        
+        mutable std::unique_ptr<QFile> m_cacheFile;
+        
+        /** Statistics of the coarsest level, used for coloring all levels */
+        std::unique_ptr<FastStatistics> m_statistics;
+        
+        /** True if only an approximation of the coarsest level is available */
+        bool m_previewFlag = false;
+        
+        /** Protects the cancel request that is made from another thread */
+        mutable QMutex m_cancelMutex;
+        
+        bool m_cancelRequestedFlag = false;
+        
+        /** Levels with more cells than this are not retained in memory (no cache file), only the small coarse levels are kept */
+        static const int64_t s_maximumInMemoryLevelCells;
+        
+        static const int32_t s_cacheFileVersion;
+        
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+    
+#ifdef __CIFTI_MATRIX_TILE_PYRAMID_DECLARE__
+    const int64_t CiftiMatrixTilePyramid::s_maximumInMemoryLevelCells = 16 * 1024 * 1024;
+    const int32_t CiftiMatrixTilePyramid::s_cacheFileVersion = 1;
+#endif // __CIFTI_MATRIX_TILE_PYRAMID_DECLARE__
+
+} // namespace
+#endif  //__CIFTI_MATRIX_TILE_PYRAMID_H__
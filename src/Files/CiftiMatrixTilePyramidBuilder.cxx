@@ -0,0 +1,302 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __CIFTI_MATRIX_TILE_PYRAMID_BUILDER_DECLARE__
+#include "CiftiMatrixTilePyramidBuilder.h"
+#undef __CIFTI_MATRIX_TILE_PYRAMID_BUILDER_DECLARE__
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "EventGraphicsMeshReady.h"
+#include "EventManager.h"
+
+using namespace caret;
+
+/**
+ * Builds the pyramid while the matrix continues to be drawn.
+ */
+class CiftiMatrixTilePyramidBuilder::BuildThread : public QThread
+{
+public:
+    BuildThread(CiftiMatrixTilePyramidBuilder* builder)
+    : m_builder(builder) { }
+    
+    void run() {
+        m_builder->runBuild();
+    }
+    
+private:
+    CiftiMatrixTilePyramidBuilder* m_builder;
+};
+
+/**
+ * \class caret::CiftiMatrixTilePyramidBuilder 
+ * \brief Builds a matrix tile pyramid in a background thread
+ * \ingroup Files
+ *
+ * Building the coarser levels of a pyramid reads every row of the CIFTI
+ * file, which takes minutes for a dense connectivity file.  The build
+ * is done in two steps in a background thread.  First, a preview of
+ * the coarsest level is created from a few rows (or the levels are
+ * read from a cache file), then all levels are built.  The matrix is
+ * drawn from the preview until the build is complete.  An
+ * EventGraphicsMeshReady is sent when each step completes.
+ *
+ * The levels are written to a cache file only when a cache size is
+ * given and the file fits within it.  Cache files of other CIFTI files
+ * that were used least recently are removed to stay within the size.
+ *
+ * The build thread opens its own instance of the CIFTI file, so the
+ * CIFTI file must be a local file.
+ */
+
+/**
+ * Constructor.  The build starts immediately.
+ *
+ * @param ciftiFileName
+ *     Name of the CIFTI file whose matrix is tiled.
+ * @param downsampleMode
+ *     How cells are combined in the coarser levels.
+ * @param maximumCacheBytes
+ *     Maximum size of all matrix tile cache files, zero if the
+ *     levels are only kept in memory.
+ */
+CiftiMatrixTilePyramidBuilder::CiftiMatrixTilePyramidBuilder(const AString& ciftiFileName,
+                                                             const CiftiMatrixTilePyramid::DownsampleMode downsampleMode,
+                                                             const int64_t maximumCacheBytes)
+: CaretObject(),
+m_ciftiFileName(ciftiFileName),
+m_downsampleMode(downsampleMode),
+m_maximumCacheBytes(maximumCacheBytes),
+m_pyramidCompleteFlag(false),
+m_buildPreviewFlag(true),
+m_buildingPyramid(NULL),
+m_builtPyramidCompleteFlag(false),
+m_buildThreadActive(false),
+m_buildFailedFlag(false),
+m_cancelRequestedFlag(false)
+{
+    CaretAssert(QCoreApplication::instance() != NULL);
+    startBuild();
+}
+
+/**
+ * Destructor.  A build in progress is cancelled.
+ */
+CiftiMatrixTilePyramidBuilder::~CiftiMatrixTilePyramidBuilder()
+{
+    if (m_buildThread.getPointer() != NULL) {
+        {
+            QMutexLocker locker(&m_buildMutex);
+            m_cancelRequestedFlag = true;
+            if (m_buildingPyramid != NULL) {
+                m_buildingPyramid->requestCancel();
+            }
+        }
+        m_buildThread->wait();
+    }
+}
+
+/**
+ * Use a pyramid that the build thread has completed and, if the pyramid
+ * is not complete, start the next build step.
+ *
+ * @return
+ *     The pyramid that is drawn (NULL until the preview is available).
+ *     The returned pyramid remains valid until the next call to this
+ *     method.
+ */
+const CiftiMatrixTilePyramid*
+CiftiMatrixTilePyramidBuilder::updatePyramid()
+{
+    takeBuiltPyramid();
+    
+    if ( ! m_pyramidCompleteFlag) {
+        startBuild();
+    }
+    
+    return m_pyramid.get();
+}
+
+/**
+ * @return How cells are combined in the coarser levels.
+ */
+CiftiMatrixTilePyramid::DownsampleMode
+CiftiMatrixTilePyramidBuilder::getDownsampleMode() const
+{
+    return m_downsampleMode;
+}
+
+/**
+ * @return The pyramid that is drawn (NULL until the preview is available).
+ */
+const CiftiMatrixTilePyramid*
+CiftiMatrixTilePyramidBuilder::getPyramid() const
+{
+    return m_pyramid.get();
+}
+
+/**
+ * Start the next build step unless a step is running or has failed.
+ */
+void
+CiftiMatrixTilePyramidBuilder::startBuild()
+{
+    QMutexLocker locker(&m_buildMutex);
+    if (m_buildThreadActive
+        || m_buildFailedFlag
+        || m_builtPyramid) {
+        return;
+    }
+    
+    m_buildPreviewFlag = ( ! m_pyramid);
+    
+    if (m_buildThread.getPointer() == NULL) {
+        m_buildThread.grabNew(new BuildThread(this));
+        
+        /*
+         * 'finished' is emitted by the build thread so queue it to
+         * the application's thread where graphics may be updated.
+         */
+        QObject::connect(m_buildThread.getPointer(), &QThread::finished,
+                         QCoreApplication::instance(),
+                         []() {
+                             EventManager::get()->sendEvent(EventGraphicsMeshReady().getPointer());
+                         },
+                         Qt::QueuedConnection);
+    }
+    else {
+        /*
+         * Previous step has finished but thread may not have exited
+         */
+        m_buildThread->wait();
+    }
+    m_buildThreadActive = true;
+    m_buildThread->start(QThread::LowPriority);
+}
+
+/**
+ * If the build thread has completed a pyramid, make it the pyramid that is drawn.
+ */
+void
+CiftiMatrixTilePyramidBuilder::takeBuiltPyramid()
+{
+    if (m_buildThread.getPointer() != NULL) {
+        QMutexLocker locker(&m_buildMutex);
+        if (m_builtPyramid) {
+            m_pyramid.reset(m_builtPyramid.release());
+            m_pyramidCompleteFlag = m_builtPyramidCompleteFlag;
+        }
+    }
+}
+
+/**
+ * Run a build step in the background thread.
+ */
+void
+CiftiMatrixTilePyramidBuilder::runBuild()
+{
+    bool previewFlag(false);
+    {
+        QMutexLocker locker(&m_buildMutex);
+        previewFlag = m_buildPreviewFlag;
+    }
+    
+    std::unique_ptr<CiftiMatrixTilePyramid> pyramid;
+    bool completeFlag(false);
+    bool failedFlag(false);
+    try {
+        CiftiMatrixTilePyramid* newPyramid = new CiftiMatrixTilePyramid(m_ciftiFileName,
+                                                                        m_downsampleMode);
+        pyramid.reset(newPyramid);
+        {
+            QMutexLocker locker(&m_buildMutex);
+            m_buildingPyramid = newPyramid;
+            if (m_cancelRequestedFlag) {
+                newPyramid->requestCancel();
+            }
+        }
+        
+        /*
+         * A failure writing the cache file is handled by the pyramid
+         * which then keeps the tiles in memory, any exception is an
+         * error reading the CIFTI file and is not retried
+         */
+        AString cacheFileName;
+        if (m_maximumCacheBytes > 0) {
+            cacheFileName = CiftiMatrixTilePyramid::getCacheFileNameForCiftiFile(m_ciftiFileName,
+                                                                                 m_downsampleMode);
+        }
+        if ( ! pyramid->isCancelRequested()) {
+            if (previewFlag) {
+                if (pyramid->openCacheFile(cacheFileName)) {
+                    completeFlag = true;
+                }
+                else {
+                    pyramid->buildPreview();
+                }
+            }
+            else {
+                if ( ! cacheFileName.isEmpty()) {
+                    const int64_t cacheFileSize = pyramid->getCacheFileSize();
+                    if (cacheFileSize > m_maximumCacheBytes) {
+                        CaretLogInfo("Matrix tiles for "
+                                     + m_ciftiFileName
+                                     + " are larger than the matrix tile cache size and are not cached");
+                        cacheFileName = "";
+                    }
+                    else {
+                        CiftiMatrixTilePyramid::removeLeastRecentlyUsedCacheFiles(cacheFileName,
+                                                                                  m_maximumCacheBytes - cacheFileSize);
+                    }
+                }
+                pyramid->build(cacheFileName);
+                completeFlag = true;
+            }
+        }
+    }
+    catch (const CaretException& e) {
+        QMutexLocker locker(&m_buildMutex);
+        if ( ! m_cancelRequestedFlag) {
+            CaretLogWarning("Unable to build matrix tiles for "
+                            + m_ciftiFileName
+                            + ": "
+                            + e.whatString());
+            failedFlag = true;
+        }
+    }
+    
+    QMutexLocker locker(&m_buildMutex);
+    m_buildingPyramid = NULL;
+    if (failedFlag
+        || m_cancelRequestedFlag) {
+        pyramid.reset();
+    }
+    else {
+        m_builtPyramid.reset(pyramid.release());
+        m_builtPyramidCompleteFlag = completeFlag;
+    }
+    m_buildFailedFlag = failedFlag;
+    m_buildThreadActive = false;
+}
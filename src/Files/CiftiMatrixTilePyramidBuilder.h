@@ -0,0 +1,113 @@
+#ifndef __CIFTI_MATRIX_TILE_PYRAMID_BUILDER_H__
+#define __CIFTI_MATRIX_TILE_PYRAMID_BUILDER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <memory>
+
+#include <QMutex>
+
+#include "CaretObject.h"
+#include "CaretPointer.h"
+#include "CiftiMatrixTilePyramid.h"
+
+namespace caret {
+
+    class CiftiMatrixTilePyramidBuilder : public CaretObject {
+        
+    public:
+        CiftiMatrixTilePyramidBuilder(const AString& ciftiFileName,
+                                      const CiftiMatrixTilePyramid::DownsampleMode downsampleMode,
+                                      const int64_t maximumCacheBytes);
+        
+        virtual ~CiftiMatrixTilePyramidBuilder();
+        
+        const CiftiMatrixTilePyramid* updatePyramid();
+        
+        const CiftiMatrixTilePyramid* getPyramid() const;
+        
+        CiftiMatrixTilePyramid::DownsampleMode getDownsampleMode() const;
+        
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        class BuildThread;
+        
+        CiftiMatrixTilePyramidBuilder(const CiftiMatrixTilePyramidBuilder&);
+
+        CiftiMatrixTilePyramidBuilder& operator=(const CiftiMatrixTilePyramidBuilder&);
+        
+        void startBuild();
+        
+        void takeBuiltPyramid();
+        
+        void runBuild();
+        
+        const AString m_ciftiFileName;
+        
+        const CiftiMatrixTilePyramid::DownsampleMode m_downsampleMode;
+        
+        /** Maximum size of all cache files, zero if tiles are not cached */
+        const int64_t m_maximumCacheBytes;
+        
+        /** Pyramid that is drawn (NULL until the preview is built) */
+        std::unique_ptr<CiftiMatrixTilePyramid> m_pyramid;
+        
+        /** True when the pyramid that is drawn is complete */
+        bool m_pyramidCompleteFlag;
+        
+        /** Thread that builds the pyramid in the background */
+        CaretPointer<BuildThread> m_buildThread;
+        
+        /** Protects members shared with the build thread */
+        QMutex m_buildMutex;
+        
+        /** True if the build thread is building only the preview */
+        bool m_buildPreviewFlag;
+        
+        /** Pyramid being built, so that the build may be cancelled */
+        CiftiMatrixTilePyramid* m_buildingPyramid;
+        
+        /** Pyramid created by the build thread */
+        std::unique_ptr<CiftiMatrixTilePyramid> m_builtPyramid;
+        
+        /** True if the pyramid created by the build thread is complete */
+        bool m_builtPyramidCompleteFlag;
+        
+        /** True while the build thread is running */
+        bool m_buildThreadActive;
+        
+        /** True if building failed (the CIFTI file could not be read) */
+        bool m_buildFailedFlag;
+        
+        /** True when the builder is destroyed and the build must stop */
+        bool m_cancelRequestedFlag;
+        
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+    
+#ifdef __CIFTI_MATRIX_TILE_PYRAMID_BUILDER_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __CIFTI_MATRIX_TILE_PYRAMID_BUILDER_DECLARE__
+
+} // namespace
+#endif  //__CIFTI_MATRIX_TILE_PYRAMID_BUILDER_H__
@@ -0,0 +1,138 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiStreamingMerger.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace caret;
+using namespace std;
+
+CiftiStreamingMerger::RowSource::~RowSource()
+{
+}
+
+CiftiStreamingMerger::CiftiColumnSource::CiftiColumnSource(const CiftiFile* input, const vector<int64_t>& columns, const int64_t& outColumnOffset)
+{
+    CaretAssert(input != NULL);
+    m_input = input;
+    m_columns = columns;
+    m_outColumnOffset = outColumnOffset;
+    int64_t inputRowLength = input->getNumberOfColumns();
+    m_wholeRow = ((int64_t)columns.size() == inputRowLength);
+    for (int64_t i = 0; m_wholeRow && i < inputRowLength; ++i)
+    {
+        if (columns[i] != i) m_wholeRow = false;
+    }
+    if (!m_wholeRow)
+    {
+        m_scratchRow.resize(inputRowLength);
+    }
+}
+
+void CiftiStreamingMerger::CiftiColumnSource::fillRows(float* block, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength)
+{
+    int64_t numColumns = (int64_t)m_columns.size();
+    CaretAssert(m_outColumnOffset + numColumns <= rowLength);
+    for (int64_t row = 0; row < numRows; ++row)
+    {
+        float* outRow = block + row * rowLength + m_outColumnOffset;
+        if (m_wholeRow)
+        {
+            m_input->getRow(outRow, firstRow + row);//read directly into the output row
+        } else {
+            m_input->getRow(m_scratchRow.data(), firstRow + row);
+            for (int64_t i = 0; i < numColumns; ++i)
+            {
+                outRow[i] = m_scratchRow[m_columns[i]];
+            }
+        }
+    }
+}
+
+CiftiStreamingMerger::CiftiStreamingMerger(CiftiFile* output, const int64_t& maxBufferBytes)
+{
+    CaretAssert(output != NULL);
+    m_output = output;
+    m_maxBufferBytes = maxBufferBytes;
+}
+
+void CiftiStreamingMerger::addSource(RowSource* source)
+{
+    CaretAssert(source != NULL);
+    m_sources.push_back(CaretPointer<RowSource>(source));
+}
+
+void CiftiStreamingMerger::run()
+{
+    const int64_t numRows = m_output->getNumberOfRows(), rowLength = m_output->getNumberOfColumns();
+    if (numRows < 1 || rowLength < 1) return;
+    const int64_t rowBytes = rowLength * (int64_t)sizeof(float);
+    const int64_t blockRows = min(numRows, max((int64_t)1, m_maxBufferBytes / 2 / rowBytes));//two blocks: one being filled, one being written
+    const int64_t numBlocks = (numRows + blockRows - 1) / blockRows;
+    const int numSources = (int)m_sources.size();
+    vector<float> buffers[2];
+    buffers[0].resize(blockRows * rowLength);//sources are expected to cover every element of every row, buffers are reused without clearing
+    if (numBlocks > 1) buffers[1].resize(blockRows * rowLength);
+    AString errorMessage;
+    for (int64_t block = 0; block <= numBlocks; ++block)
+    {//each pass fills block "block" from all sources while writing block "block - 1", item 0 is the writer when there is a previous block
+        const bool haveWrite = (block > 0), haveFill = (block < numBlocks);
+        const int writeItems = (haveWrite ? 1 : 0);
+        const int numItems = writeItems + (haveFill ? numSources : 0);
+        const int64_t fillStart = block * blockRows, fillCount = min(blockRows, numRows - fillStart);
+        const int64_t writeStart = (block - 1) * blockRows, writeCount = min(blockRows, numRows - writeStart);
+        float* fillBuffer = buffers[block % 2].data();
+        const float* writeBuffer = buffers[(block + 1) % 2].data();
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int item = 0; item < numItems; ++item)
+        {
+            try
+            {
+                if (item < writeItems)
+                {
+                    for (int64_t row = 0; row < writeCount; ++row)
+                    {
+                        m_output->setRow(writeBuffer + row * rowLength, writeStart + row);
+                    }
+                } else {
+                    m_sources[item - writeItems]->fillRows(fillBuffer, fillStart, fillCount, rowLength);
+                }
+            } catch (CaretException& e) {
+#pragma omp critical
+                {
+                    if (errorMessage.isEmpty()) errorMessage = e.whatString();
+                }
+            } catch (std::exception& e) {
+#pragma omp critical
+                {
+                    if (errorMessage.isEmpty()) errorMessage = e.what();
+                }
+            }
+        }
+        if (!errorMessage.isEmpty()) throw DataFileException(errorMessage);
+    }
+}
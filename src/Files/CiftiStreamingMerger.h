@@ -0,0 +1,79 @@
+#ifndef __CIFTI_STREAMING_MERGER_H__
+#define __CIFTI_STREAMING_MERGER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretPointer.h"
+
+#include <vector>
+
+namespace caret
+{
+    
+    class CiftiFile;
+    
+    ///writes a 2D cifti file whose rows are assembled from several sources, a bounded block of output rows is filled by all sources
+    ///concurrently while the previous block is written in row order, so memory use does not grow with the size of the inputs
+    class CiftiStreamingMerger
+    {
+    public:
+        ///something that provides part of the output rows, different sources must not write the same elements
+        class RowSource
+        {
+        public:
+            virtual ~RowSource();
+            ///fill this source's part of rows [firstRow, firstRow + numRows), row r starts at block + (r - firstRow) * rowLength
+            virtual void fillRows(float* block, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength) = 0;
+        };
+        
+        ///provides a list of columns of an input cifti file, in the given order, starting at outColumnOffset in the output rows
+        class CiftiColumnSource : public RowSource
+        {
+            const CiftiFile* m_input;
+            std::vector<int64_t> m_columns;
+            int64_t m_outColumnOffset;
+            bool m_wholeRow;
+            std::vector<float> m_scratchRow;
+        public:
+            CiftiColumnSource(const CiftiFile* input, const std::vector<int64_t>& columns, const int64_t& outColumnOffset);
+            void fillRows(float* block, const int64_t& firstRow, const int64_t& numRows, const int64_t& rowLength);
+        };
+        
+        ///the cifti XML of output must already be set, maxBufferBytes bounds the memory of the two row blocks
+        CiftiStreamingMerger(CiftiFile* output, const int64_t& maxBufferBytes = 128 * (int64_t)(1 << 20));
+        
+        ///takes ownership of the source
+        void addSource(RowSource* source);
+        
+        ///fill and write all rows of the output
+        void run();
+    private:
+        CiftiFile* m_output;
+        int64_t m_maxBufferBytes;
+        std::vector<CaretPointer<RowSource> > m_sources;
+        CiftiStreamingMerger();
+        CiftiStreamingMerger(const CiftiStreamingMerger&);
+        CiftiStreamingMerger& operator=(const CiftiStreamingMerger&);
+    };
+    
+}
+
+#endif //__CIFTI_STREAMING_MERGER_H__
@@ -25,6 +25,7 @@
 
 #include "AStringNaturalComparison.h"
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "GroupAndNameHierarchyGroup.h"
 #include "GroupAndNameHierarchyName.h"
 #include "SceneAttributes.h"
@@ -36,6 +37,11 @@
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_selectionModificationCounterMutex;
+}
+
 
 
 /**
@@ -128,6 +134,7 @@ GroupAndNameHierarchyItem::clearPrivate()
     for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {
         m_selectedInTab[i] = true;
     }
+    incrementSelectionModificationCounter();
     
     bool defaultExpandStatus = false;
     switch (m_itemType) {
@@ -530,6 +537,29 @@ GroupAndNameHierarchyItem::setSelected(const DisplayGroupEnum::Enum displayGroup
     else {
         m_selectedInDisplayGroup[displayIndex] = status;
     }
+    incrementSelectionModificationCounter();
+}
+
+/**
+ * @return A counter that changes whenever the selection status of any
+ * item may have changed, so that results that depend on selections,
+ * such as label coloring, can be cached until it changes.
+ */
+int64_t
+GroupAndNameHierarchyItem::getSelectionModificationCounter()
+{
+    CaretMutexLocker locker(&s_selectionModificationCounterMutex);
+    return s_selectionModificationCounter;
+}
+
+/**
+ * Increment the selection modification counter.
+ */
+void
+GroupAndNameHierarchyItem::incrementSelectionModificationCounter()
+{
+    CaretMutexLocker locker(&s_selectionModificationCounterMutex);
+    s_selectionModificationCounter++;
 }
 
 /**
@@ -721,6 +751,7 @@ GroupAndNameHierarchyItem::copySelections(const int32_t sourceTabIndex,
 {
     m_selectedInTab[targetTabIndex] = m_selectedInTab[sourceTabIndex];
     m_expandedStatusInTab[targetTabIndex] = m_expandedStatusInTab[sourceTabIndex];
+    incrementSelectionModificationCounter();
 
     for (std::vector<GroupAndNameHierarchyItem*>::const_iterator iter = m_children.begin();
          iter != m_children.end();
@@ -931,6 +962,7 @@ GroupAndNameHierarchyItem::restoreFromScene(const SceneAttributes* sceneAttribut
     sceneClass->getStringValue("m_name"); // prevents "failed to restore"
     m_sceneAssistant->restoreMembers(sceneAttributes,
                                      sceneClass);
+    incrementSelectionModificationCounter();
     
     for (std::vector<GroupAndNameHierarchyItem*>::iterator iter = m_children.begin();
          iter != m_children.end();
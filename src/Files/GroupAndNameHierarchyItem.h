@@ -93,6 +93,8 @@ namespace caret {
                                  const int32_t tabIndex,
                                  const bool status);
         
+        static int64_t getSelectionModificationCounter();
+        
         void setDescendantsSelected(const DisplayGroupEnum::Enum displayGroup,
                                          const int32_t tabIndex,
                                          const bool status);
@@ -238,10 +240,16 @@ namespace caret {
         /** Assists with scenes */
         SceneClassAssistant* m_sceneAssistant;
 
+        static void incrementSelectionModificationCounter();
+        
+        /** Incremented whenever the selection of any item may have changed */
+        static int64_t s_selectionModificationCounter;
+        
         // ADD_NEW_MEMBERS_HERE
     };
     
 #ifdef __GROUP_AND_NAME_HIERARCHY_ITEM_DECLARE__
+    int64_t GroupAndNameHierarchyItem::s_selectionModificationCounter = 0;
 #endif // __GROUP_AND_NAME_HIERARCHY_ITEM_DECLARE__
 
 } // namespace
@@ -19,8 +19,10 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <list>
 
 //#include <QRunnable>
 //#include <QSemaphore>
@@ -32,11 +34,13 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
 #include "CaretOMP.h"
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "GroupAndNameHierarchyItem.h"
 #include "Palette.h"
+#include "PaletteColorLookup.h"
 #include "PaletteColorMapping.h"
 #include "MathFunctions.h"
 
@@ -111,6 +115,13 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
     const Palette* palette = paletteColorMapping->getPalette();
     CaretAssert(palette);
     
+    /*
+     * Compiled palette is cached in the palette, hold a reference so
+     * it stays valid even if the palette is modified while coloring
+     */
+    const CaretPointer<const PaletteColorLookup> paletteLookupPointer = palette->getColorLookup();
+    const PaletteColorLookup* paletteLookup = paletteLookupPointer;
+    
     CaretAssert(statistics);
     CaretAssert(paletteColorMapping);
     CaretAssert(scalarValues);
@@ -294,9 +305,9 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
              * Color scalar using palette
              */
             float rgba[4];
-            palette->getPaletteColor(normalValue,
-                                     interpolateFlag,
-                                     rgba);
+            paletteLookup->getPaletteColor(normalValue,
+                                           interpolateFlag,
+                                           rgba);
             if (rgba[3] > 0.0f) {
                 rgbaOut[0] = rgba[0];
                 rgbaOut[1] = rgba[1];
@@ -670,6 +681,161 @@ NodeAndVoxelColoring::colorIndicesWithLabelTableForDisplayGroupTab(const GiftiLa
                                                             (void*)rgbv);
 }
 
+/**
+ * Colors of a label table compiled into a table indexed by key.
+ */
+struct NodeAndVoxelColoring::CompiledLabelColors {
+    /** Label table, display group, and tab that were compiled */
+    const GiftiLabelTable* m_labelTable;
+    DisplayGroupEnum::Enum m_displayGroup;
+    int32_t m_tabIndex;
+    
+    /** Label and selection modification counters when compiled */
+    int64_t m_labelModificationCounter;
+    int64_t m_selectionModificationCounter;
+    
+    /** Key of the first element in the table */
+    int32_t m_minimumKey;
+    
+    /** Number of keys in the table, negative if the keys are too sparse for a table */
+    int64_t m_numberOfKeys;
+    
+    /** Four elements per key, keys without a label or not selected have zero alpha */
+    std::vector<float> m_keyRGBA;
+};
+
+/**
+ * Get the compiled colors of a label table.  They are cached and only
+ * compiled again after a label or a label selection has changed.
+ *
+ * @param labelTable
+ *     Label table that is compiled.
+ * @param displayGroup
+ *    The selected display group.
+ * @param tabIndex
+ *    Index of selected tab, or INVALID_TAB_INDEX to ignore selection.
+ * @return
+ *    The compiled colors, not changed by later recompiling.
+ */
+CaretPointer<const NodeAndVoxelColoring::CompiledLabelColors>
+NodeAndVoxelColoring::getCompiledLabelColors(const GiftiLabelTable* labelTable,
+                                             const DisplayGroupEnum::Enum displayGroup,
+                                             const int32_t tabIndex)
+{
+    /*
+     * One entry per label table, group, and tab recently colored,
+     * most recently used first
+     */
+    static const int32_t MAXIMUM_CACHED_LABEL_TABLES = 32;
+    static CaretMutex cacheMutex;
+    static std::list<CaretPointer<const CompiledLabelColors> > cache;
+    
+    /*
+     * Get the counters before compiling, so a change while compiling
+     * causes another compile next time
+     */
+    const int64_t labelModificationCounter = GiftiLabel::getColoringModificationCounter();
+    const int64_t selectionModificationCounter = GroupAndNameHierarchyItem::getSelectionModificationCounter();
+    
+    CaretMutexLocker locker(&cacheMutex);
+    for (std::list<CaretPointer<const CompiledLabelColors> >::iterator iter = cache.begin();
+         iter != cache.end();
+         iter++) {
+        const CompiledLabelColors* compiled = *iter;
+        if ((compiled->m_labelTable == labelTable)
+            && (compiled->m_displayGroup == displayGroup)
+            && (compiled->m_tabIndex == tabIndex)) {
+            if ((compiled->m_labelModificationCounter == labelModificationCounter)
+                && (compiled->m_selectionModificationCounter == selectionModificationCounter)) {
+                cache.splice(cache.begin(), cache, iter);
+                return cache.front();
+            }
+            cache.erase(iter);
+            break;
+        }
+    }
+    
+    CompiledLabelColors* compiled = new CompiledLabelColors();
+    CaretPointer<const CompiledLabelColors> compiledPointer(compiled);
+    compiled->m_labelTable = labelTable;
+    compiled->m_displayGroup = displayGroup;
+    compiled->m_tabIndex = tabIndex;
+    compiled->m_labelModificationCounter = labelModificationCounter;
+    compiled->m_selectionModificationCounter = selectionModificationCounter;
+    compileLabelColors(labelTable,
+                       displayGroup,
+                       tabIndex,
+                       *compiled);
+    
+    cache.push_front(compiledPointer);
+    while (static_cast<int32_t>(cache.size()) > MAXIMUM_CACHED_LABEL_TABLES) {
+        cache.pop_back();
+    }
+    
+    return compiledPointer;
+}
+
+/**
+ * Compile the colors of a label table, with labels that are not selected
+ * in the display group/tab given zero alpha, into a table indexed by key.
+ *
+ * @param labelTable
+ *     Label table that is compiled.
+ * @param displayGroup
+ *    The selected display group.
+ * @param tabIndex
+ *    Index of selected tab, or INVALID_TAB_INDEX to ignore selection.
+ * @param compiledOut
+ *    Output with the minimum key, number of keys, and colors.  The number of
+ *    keys is negative if the keys are too sparse for a table and the label
+ *    table should be used directly.
+ */
+void
+NodeAndVoxelColoring::compileLabelColors(const GiftiLabelTable* labelTable,
+                                         const DisplayGroupEnum::Enum displayGroup,
+                                         const int32_t tabIndex,
+                                         CompiledLabelColors& compiledOut)
+{
+    std::vector<int32_t> keys;
+    labelTable->getKeys(keys);
+    compiledOut.m_minimumKey = 0;
+    compiledOut.m_numberOfKeys = 0;
+    compiledOut.m_keyRGBA.clear();
+    if (keys.empty()) {
+        return;
+    }
+    const int32_t minimumKey = *std::min_element(keys.begin(), keys.end());
+    const int32_t maximumKey = *std::max_element(keys.begin(), keys.end());
+    const int64_t numberOfKeys = static_cast<int64_t>(maximumKey) - minimumKey + 1;
+    const int64_t maximumTableSize = std::max(static_cast<int64_t>(1 << 16),
+                                              static_cast<int64_t>(keys.size()) * 16);
+    if (numberOfKeys > maximumTableSize) {
+        compiledOut.m_numberOfKeys = -1;
+        return;
+    }
+    
+    compiledOut.m_minimumKey = minimumKey;
+    compiledOut.m_numberOfKeys = numberOfKeys;
+    std::vector<float>& keyRGBA = compiledOut.m_keyRGBA;
+    keyRGBA.assign(numberOfKeys * 4, 0.0f);
+    for (std::vector<int32_t>::const_iterator iter = keys.begin();
+         iter != keys.end();
+         iter++) {
+        const GiftiLabel* gl = labelTable->getLabel(*iter);
+        if (gl == NULL) {
+            continue;
+        }
+        const GroupAndNameHierarchyItem* item = gl->getGroupNameSelectionItem();
+        if ((item != NULL)
+            && (tabIndex != NodeAndVoxelColoring::INVALID_TAB_INDEX)) {
+            if ( ! item->isSelected(displayGroup, tabIndex)) {
+                continue;
+            }
+        }
+        gl->getColor(&keyRGBA[(*iter - minimumKey) * 4]);
+    }
+}
+
 /**
  * Assign colors to label indices using a GIFTI label table.
  *
@@ -715,6 +881,58 @@ NodeAndVoxelColoring::colorIndicesWithLabelTableForDisplayGroupTabPrivate(const
     }
     
     
+    /*
+     * Use the label colors and the selection status compiled into a table
+     * indexed by key, so that each index needs neither a map lookup
+     * nor a selection test.  Unless the keys are very sparse.
+     */
+    const CaretPointer<const CompiledLabelColors> compiledLabelColors = getCompiledLabelColors(labelTable,
+                                                                                              displayGroup,
+                                                                                              tabIndex);
+    const int64_t numberOfKeys = compiledLabelColors->m_numberOfKeys;
+    const int32_t minimumKey = compiledLabelColors->m_minimumKey;
+    const float* keyRGBA = compiledLabelColors->m_keyRGBA.data();
+    if (numberOfKeys >= 0) {
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
+        for (int64_t i = 0; i < numberOfIndices; i++) {
+            const int64_t i4 = i * 4;
+            const int64_t keyOffset = static_cast<int64_t>(labelIndices[i]) - minimumKey;
+            const float* labelRGBA = NULL;
+            if ((keyOffset >= 0)
+                && (keyOffset < numberOfKeys)) {
+                labelRGBA = &keyRGBA[keyOffset * 4];
+                if (labelRGBA[3] <= 0.0) {
+                    labelRGBA = NULL;
+                }
+            }
+            switch (colorDataType) {
+                case COLOR_TYPE_FLOAT:
+                    if (labelRGBA != NULL) {
+                        rgbaFloat[i4]   = labelRGBA[0];
+                        rgbaFloat[i4+1] = labelRGBA[1];
+                        rgbaFloat[i4+2] = labelRGBA[2];
+                        rgbaFloat[i4+3] = labelRGBA[3];
+                    }
+                    else {
+                        rgbaFloat[i4+3] = 0.0;
+                    }
+                    break;
+                case COLOR_TYPE_UNSIGNED_BTYE:
+                    if (labelRGBA != NULL) {
+                        rgbaUnsignedByte[i4]   = labelRGBA[0] * 255.0;
+                        rgbaUnsignedByte[i4+1] = labelRGBA[1] * 255.0;
+                        rgbaUnsignedByte[i4+2] = labelRGBA[2] * 255.0;
+                        rgbaUnsignedByte[i4+3] = labelRGBA[3] * 255.0;
+                    }
+                    else {
+                        rgbaUnsignedByte[i4+3] = 0;
+                    }
+                    break;
+            }
+        }
+        return;
+    }
+    
     /*
      * Invalidate all coloring.
      */
@@ -22,8 +22,10 @@
 /*LICENSE_END*/
 
 #include <stdint.h>
+#include <vector>
 
 #include "CaretColorEnum.h"
+#include "CaretPointer.h"
 #include "DisplayGroupEnum.h"
 #include "LabelDrawingTypeEnum.h"
 #include "PaletteThresholdOutlineDrawingModeEnum.h"
@@ -125,6 +127,17 @@ namespace caret {
                                                       const ColorDataType colorDataType,
                                                       void* rgbaOutPointer);
         
+        struct CompiledLabelColors;
+        
+        static CaretPointer<const CompiledLabelColors> getCompiledLabelColors(const GiftiLabelTable* labelTable,
+                                                                              const DisplayGroupEnum::Enum displayGroup,
+                                                                              const int32_t tabIndex);
+        
+        static void compileLabelColors(const GiftiLabelTable* labelTable,
+                                       const DisplayGroupEnum::Enum displayGroup,
+                                       const int32_t tabIndex,
+                                       CompiledLabelColors& compiledOut);
+        
         static void colorScalarsWithRGBAPrivate(const float* redComponents,
                                                 const float* greenComponents,
                                                 const float* blueComponents,
@@ -45,6 +45,7 @@
 
 #include "CaretPointLocator.h"
 #include "GeodesicHelper.h"
+#include "PerformanceProfile.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
 #include "TopologyHelper.h"
@@ -778,6 +779,7 @@ void SurfaceFile::getGeodesicHelper(CaretPointer<GeodesicHelper>& helpOut) const
         {
             m_geoHelpers.clear();//just to be sure
             m_geoHelperIndex = 0;
+            PerformanceProfile::PhaseTimer phaseTimer("helper geodesic");
             m_geoBase.grabNew(new GeodesicHelperBase(this));//yes, this takes some time, and is single threaded at the moment
         }//keep locked while searching
         int32_t& myIndex = m_geoHelperIndex;
@@ -826,6 +828,7 @@ void SurfaceFile::getTopologyHelper(CaretPointer<TopologyHelper>& helpOut, bool
         }
         if (m_topoBase == NULL || (infoSorted && !m_topoBase->isNodeInfoSorted()))
         {
+            PerformanceProfile::PhaseTimer phaseTimer("helper topology");
             m_topoBase.grabNew(new TopologyHelperBase(this, infoSorted));
         }
     }
@@ -861,6 +864,7 @@ void SurfaceFile::getSignedDistanceHelper(CaretPointer<SignedDistanceHelper>& he
         }
         if (m_distBase == NULL)
         {
+            PerformanceProfile::PhaseTimer phaseTimer("helper signed distance");
             m_distBase.grabNew(new SignedDistanceHelperBase(this));
         }
     }
@@ -1394,6 +1398,7 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
         CaretMutexLocker myLock(&m_locatorMutex);
         if (m_locator == NULL)//test again AFTER lock to avoid race conditions
         {
+            PerformanceProfile::PhaseTimer phaseTimer("helper point locator");
             m_locator.grabNew(new CaretPointLocator(getCoordinateData(), getNumberOfNodes()));
         }
     }
@@ -0,0 +1,178 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceSmoothingObject.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "MathFunctions.h"
+#include "ProgressObject.h"
+#include "SurfaceFile.h"
+#include "TopologyHelper.h"
+
+#include <cmath>
+
+using namespace std;
+using namespace caret;
+
+SurfaceSmoothingObject::SurfaceSmoothingObject(const SurfaceFile* mySurf)
+{
+    CaretAssert(mySurf != NULL);
+    m_numNodes = mySurf->getNumberOfNodes();
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper(true);//sorted neighbors, consecutive neighbors form triangles
+    m_neighborOffsets.resize(m_numNodes + 1);
+    m_neighborOffsets[0] = 0;
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeighbors = 0;
+        myTopoHelp->getNodeNeighbors(i, numNeighbors);
+        m_neighborOffsets[i + 1] = m_neighborOffsets[i] + numNeighbors;
+    }
+    m_neighbors.resize(m_neighborOffsets[m_numNodes]);
+    for (int32_t i = 0; i < m_numNodes; ++i)
+    {
+        int32_t numNeighbors = 0;
+        const int32_t* neighbors = myTopoHelp->getNodeNeighbors(i, numNeighbors);
+        int32_t* dest = m_neighbors.data() + m_neighborOffsets[i];
+        for (int32_t j = 0; j < numNeighbors; ++j)
+        {
+            dest[j] = neighbors[j];
+        }
+    }
+}
+
+void SurfaceSmoothingObject::smoothSurface(SurfaceFile* surfaceInOut, const float& strength, const int32_t& iterations, LevelProgress* myProgress) const
+{
+    CaretAssert(surfaceInOut != NULL);
+    if (surfaceInOut->getNumberOfNodes() != m_numNodes)
+    {
+        throw CaretException("surface does not match smoothing object number of nodes");
+    }
+    if (m_numNodes <= 0) return;
+    vector<float> coords(surfaceInOut->getCoordinateData(), surfaceInOut->getCoordinateData() + m_numNodes * 3);
+    smooth(coords.data(), strength, iterations, myProgress);
+    surfaceInOut->setCoordinates(coords.data());
+}
+
+void SurfaceSmoothingObject::smooth(float* coordsInOut, const float& strength, const int32_t& iterations, LevelProgress* myProgress) const
+{
+    CaretAssert(coordsInOut != NULL);
+    if (m_numNodes <= 0 || iterations <= 0) return;
+    vector<float> scratch(m_numNodes * 3);
+    float* coordsIn = coordsInOut;//swap buffer pointers instead of copying the whole surface every iteration
+    float* coordsOut = scratch.data();
+    for (int32_t iter = 1; iter <= iterations; ++iter)
+    {
+        smoothIteration(coordsIn, coordsOut, strength);
+        std::swap(coordsIn, coordsOut);
+        if (myProgress != NULL)
+        {
+            myProgress->reportProgress(((float)iter) / iterations);
+        }
+    }
+    if (coordsIn != coordsInOut)//result ended up in scratch
+    {
+        const int64_t numFloats = m_numNodes * 3;
+        for (int64_t i = 0; i < numFloats; ++i)
+        {
+            coordsInOut[i] = coordsIn[i];
+        }
+    }
+}
+
+void SurfaceSmoothingObject::smoothIteration(const float* coordsIn, float* coordsOut, const float& strength) const
+{
+    const float inverseStrength = 1.0f - strength;
+    const int32_t* offsets = m_neighborOffsets.data();
+    const int32_t* allNeighbors = m_neighbors.data();
+#pragma omp CARET_PAR
+    {
+        vector<float> triangleAreas(100), triangleCenters(100 * 3);//per-thread scratch, grows if a node has more neighbors
+#pragma omp CARET_FOR schedule(static, 1024)
+        for (int32_t iNode = 0; iNode < m_numNodes; ++iNode)
+        {
+            const int32_t numNeighbors = offsets[iNode + 1] - offsets[iNode];
+            const float* c1 = coordsIn + iNode * 3;
+            if (numNeighbors < 2)
+            {
+                coordsOut[iNode * 3] = c1[0];
+                coordsOut[iNode * 3 + 1] = c1[1];
+                coordsOut[iNode * 3 + 2] = c1[2];
+                continue;
+            }
+            if (numNeighbors > (int32_t)triangleAreas.size())
+            {
+                triangleAreas.resize(numNeighbors);
+                triangleCenters.resize(numNeighbors * 3);
+            }
+            const int32_t* neighbors = allNeighbors + offsets[iNode];
+            double totalArea = 0.0;
+            for (int32_t jn = 0; jn < numNeighbors; ++jn)
+            {//consecutive neighbors form a triangle with the center node
+                const int32_t n1 = neighbors[jn];
+                const int32_t n2 = neighbors[(jn + 1 < numNeighbors) ? jn + 1 : 0];
+                const float* c2 = coordsIn + n1 * 3;
+                const float* c3 = coordsIn + n2 * 3;
+                const float area = MathFunctions::triangleArea(c1, c2, c3);
+                triangleAreas[jn] = area;
+                totalArea += area;
+                for (int32_t k = 0; k < 3; ++k)
+                {
+                    triangleCenters[jn * 3 + k] = (c1[k] + c2[k] + c3[k]) / 3.0;
+                }
+            }
+            float neighborAverage[3] = { 0.0f, 0.0f, 0.0f };
+            for (int32_t j = 0; j < numNeighbors; ++j)
+            {
+                if (triangleAreas[j] > 0.0f)
+                {
+                    const float weight = triangleAreas[j] / totalArea;
+                    neighborAverage[0] += weight * triangleCenters[j * 3];
+                    neighborAverage[1] += weight * triangleCenters[j * 3 + 1];
+                    neighborAverage[2] += weight * triangleCenters[j * 3 + 2];
+                }
+            }
+            for (int32_t k = 0; k < 3; ++k)
+            {
+                coordsOut[iNode * 3 + k] = c1[k] * inverseStrength + neighborAverage[k] * strength;
+            }
+        }
+    }
+}
+
+void SurfaceSmoothingObject::inflate(float* coordsInOut, const float rangeXYZ[3], const float& inflationFactor) const
+{
+    CaretAssert(coordsInOut != NULL);
+    const float factor = inflationFactor - 1.0;
+#pragma omp CARET_PARFOR schedule(static, 4096)
+    for (int32_t iNode = 0; iNode < m_numNodes; ++iNode)
+    {//no dependencies between nodes and no branches, the compiler can vectorize this
+        float* xyz = coordsInOut + iNode * 3;
+        const float x = xyz[0] / rangeXYZ[0];
+        const float y = xyz[1] / rangeXYZ[1];
+        const float z = xyz[2] / rangeXYZ[2];
+        const float radius = sqrt(x * x + y * y + z * z);
+        const float scale = 1.0 + factor * (1.0 - radius);
+        xyz[0] *= scale;
+        xyz[1] *= scale;
+        xyz[2] *= scale;
+    }
+}
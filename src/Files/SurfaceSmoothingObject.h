@@ -0,0 +1,65 @@
+#ifndef __SURFACE_SMOOTHING_OBJECT_H__
+#define __SURFACE_SMOOTHING_OBJECT_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//NOTE: this is the iterative coordinate relaxation shared by -surface-smoothing, -surface-inflation and -surface-generate-inflated.
+//      The constructor flattens the topology neighbor lists into a single offset/index array (CSR layout), so that
+//      every iteration reads contiguous memory instead of chasing one std::vector per node, and it can be reused for
+//      any number of smoothing and inflation passes on surfaces with the same topology.
+//
+//NOTE: this object contains no mutable members, multiple threads can use the same instance concurrently, as long as they
+//      pass different coordinate arrays.
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+    
+    class LevelProgress;
+    class SurfaceFile;
+    
+    class SurfaceSmoothingObject
+    {
+    public:
+        SurfaceSmoothingObject(const SurfaceFile* mySurf);
+        
+        ///smooth coordinates (numNodes * 3, interleaved xyz) in place, iterations are double buffered
+        void smooth(float* coordsInOut, const float& strength, const int32_t& iterations, LevelProgress* myProgress = NULL) const;
+        
+        ///smooth a surface in place (coordinates only, normals are not recomputed)
+        void smoothSurface(SurfaceFile* surfaceInOut, const float& strength, const int32_t& iterations, LevelProgress* myProgress = NULL) const;
+        
+        ///the radial correction step of inflation, rangeXYZ is the bounding box size of the anatomical surface
+        void inflate(float* coordsInOut, const float rangeXYZ[3], const float& inflationFactor) const;
+        
+        int32_t getNumberOfNodes() const { return m_numNodes; }
+    private:
+        int32_t m_numNodes;
+        std::vector<int32_t> m_neighborOffsets;//size m_numNodes + 1, neighbors of node i are [m_neighborOffsets[i], m_neighborOffsets[i + 1])
+        std::vector<int32_t> m_neighbors;
+        void smoothIteration(const float* coordsIn, float* coordsOut, const float& strength) const;
+        SurfaceSmoothingObject();
+    };
+    
+}
+
+#endif //__SURFACE_SMOOTHING_OBJECT_H__
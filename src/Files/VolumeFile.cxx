@@ -1846,6 +1846,26 @@ VolumeFile::clearVoxelColoringForMap(const int64_t mapIndex)
     }
 }
 
+/**
+ * Get the version of the voxel coloring for a map.  The version
+ * changes each time the map's voxel coloring is updated or cleared.
+ *
+ * @param mapIndex
+ *    Index of map.
+ * @return
+ *    Version of coloring or zero if coloring is not enabled.
+ */
+int64_t
+VolumeFile::getVoxelColoringVersionForMap(const int32_t mapIndex) const
+{
+    if (s_voxelColoringEnabled == false) {
+        return 0;
+    }
+    CaretAssert(m_voxelColorizer);
+    
+    return m_voxelColorizer->getVoxelColoringVersionForMap(mapIndex);
+}
+
 /**
  * Get the minimum and maximum values from ALL maps in this file.
  * Note that not all files (due to size of file) are able to provide
@@ -2717,3 +2737,23 @@ VolumeFile::getPaletteColorMappingModifiedStatus() const
     return modStatus;
 }
 
+/**
+ * Put back palettes replaced by palettes from a scene, including
+ * those in the encapsulated dynamic connectivity file.
+ *
+ * @return True if, afterwards, no palette has a modified status.
+ */
+bool
+VolumeFile::revertPaletteColorMappingModifiedByShowScene()
+{
+    bool unmodifiedFlag = CaretMappableDataFile::revertPaletteColorMappingModifiedByShowScene();
+    
+    if (m_lazyInitializedDynamicConnectivityFile != NULL) {
+        if ( ! m_lazyInitializedDynamicConnectivityFile->revertPaletteColorMappingModifiedByShowScene()) {
+            unmodifiedFlag = false;
+        }
+    }
+    
+    return unmodifiedFlag;
+}
+
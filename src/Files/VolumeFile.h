@@ -355,6 +355,8 @@ namespace caret {
         
         void clearVoxelColoringForMap(const int64_t mapIndex);
         
+        virtual int64_t getVoxelColoringVersionForMap(const int32_t mapIndex) const override;
+        
         virtual bool getDataRangeFromAllMaps(float& dataRangeMinimumOut,
                                              float& dataRangeMaximumOut) const;
         
@@ -406,6 +408,8 @@ namespace caret {
         
         virtual PaletteModifiedStatusEnum::Enum getPaletteColorMappingModifiedStatus() const override;
         
+        virtual bool revertPaletteColorMappingModifiedByShowScene() override;
+        
     };
 
 }
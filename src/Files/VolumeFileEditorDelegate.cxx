@@ -362,6 +362,11 @@ void
 VolumeFileEditorDelegate::addToMapUndoStacks(const int32_t mapIndex,
                                              VolumeMapUndoCommand* modifiedVoxels)
 {
+    /*
+     * Removes voxels that did not change and minimizes memory
+     */
+    modifiedVoxels->compact();
+    
     if (modifiedVoxels->count() <= 0) {
         delete modifiedVoxels;
         return;
@@ -383,7 +388,9 @@ VolumeFileEditorDelegate::updateIfVolumeFileChangedNumberOfMaps()
     
     if (numMapsToAdd > 0) {
         for (int32_t i = 0; i < numMapsToAdd; i++) {
-            m_volumeMapUndoStacks.push_back(new CaretUndoStack());
+            CaretUndoStack* undoStack = new CaretUndoStack();
+            undoStack->setMemoryLimit(s_undoStackMemoryLimit);
+            m_volumeMapUndoStacks.push_back(undoStack);
             m_volumeMapEditingLocked.push_back(true);
         }
     }
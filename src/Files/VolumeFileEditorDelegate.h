@@ -189,13 +189,18 @@ namespace caret {
          */
         std::vector<bool> m_volumeMapEditingLocked;
         
+        /**
+         * Memory limit for each map's undo stack; oldest edits are discarded beyond it.
+         */
+        static const int64_t s_undoStackMemoryLimit;
+        
         // ADD_NEW_MEMBERS_HERE
 
     };
     
     
 #ifdef __VOLUME_FILE_EDITOR_DELEGATE_DECLARE__
-    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+    const int64_t VolumeFileEditorDelegate::s_undoStackMemoryLimit = 256 * 1024 * 1024;
 #endif // __VOLUME_FILE_EDITOR_DELEGATE_DECLARE__
 
 } // namespace
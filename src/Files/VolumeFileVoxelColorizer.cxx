@@ -68,6 +68,7 @@ VolumeFileVoxelColorizer::VolumeFileVoxelColorizer(VolumeFile* volumeFile)
     for (int64_t i = 0; i < m_mapCount; i++) {
         m_mapRGBA.push_back(new uint8_t[m_mapRGBACount]);
         m_mapColoringValid.push_back(false);
+        m_mapColoringVersion.push_back(VolumeMappableInterface::newVoxelColoringVersion());
     }
 }
 
@@ -239,6 +240,12 @@ VolumeFileVoxelColorizer::assignVoxelColorsForMap(const int32_t mapIndex)
             break;
     }
     
+    /*
+     * RGBA may have changed even if coloring failed
+     */
+    CaretAssertVectorIndex(m_mapColoringVersion, mapIndex);
+    m_mapColoringVersion[mapIndex] = VolumeMappableInterface::newVoxelColoringVersion();
+    
     CaretLogFine("Time to color map named \""
                    + m_volumeFile->getMapName(mapIndex)
                    + " in volume file "
@@ -731,5 +738,24 @@ VolumeFileVoxelColorizer::clearVoxelColoringForMap(const int64_t mapIndex)
     
     CaretAssertVectorIndex(m_mapColoringValid, mapIndex);
     m_mapColoringValid[mapIndex] = false;
+    
+    CaretAssertVectorIndex(m_mapColoringVersion, mapIndex);
+    m_mapColoringVersion[mapIndex] = VolumeMappableInterface::newVoxelColoringVersion();
+}
+
+/**
+ * Get the version of the voxel coloring for a map.  A new version is
+ * created each time the map's RGBA is assigned or cleared.
+ *
+ * @param mapIndex
+ *     Index of map.
+ * @return
+ *     Version of the map's coloring.
+ */
+int64_t
+VolumeFileVoxelColorizer::getVoxelColoringVersionForMap(const int32_t mapIndex) const
+{
+    CaretAssertVectorIndex(m_mapColoringVersion, mapIndex);
+    return m_mapColoringVersion[mapIndex];
 }
 
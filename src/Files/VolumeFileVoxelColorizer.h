@@ -76,6 +76,8 @@ namespace caret {
         
         void clearVoxelColoringForMap(const int64_t mapIndex);
         
+        int64_t getVoxelColoringVersionForMap(const int32_t mapIndex) const;
+        
         void invalidateColoring();
         
     private:
@@ -115,6 +117,7 @@ namespace caret {
         int64_t m_mapRGBACount;
         
         std::vector<bool> m_mapColoringValid;
+        std::vector<int64_t> m_mapColoringVersion;
         std::vector<uint8_t*> m_mapRGBA;
     };
     
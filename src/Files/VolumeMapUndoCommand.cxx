@@ -28,12 +28,23 @@
 
 using namespace caret;
 
+/** Voxels along each axis of a brick */
+static const int64_t BRICK_DIM = 8;
+
+/** Voxels in a brick */
+static const int32_t BRICK_SIZE = BRICK_DIM * BRICK_DIM * BRICK_DIM;
 
     
 /**
  * \class caret::VolumeMapUndoCommand 
  * \brief Command pattern for volume map modifications that undo and redo.
  * \ingroup Files
+ *
+ * Modified voxels are grouped into 8x8x8 bricks so that large edits
+ * (flood fills, big brushes) do not need an allocation per voxel.
+ * After editing is complete, compact() reduces each brick to the
+ * modified voxels with run-length encoded values, which is very
+ * effective for label and ROI volumes.
  */
 
 /**
@@ -47,6 +58,13 @@ m_mapIndex(mapIndex)
 {
     CaretAssert(volumeFile);
     CaretAssert((mapIndex >= 0) && (mapIndex < volumeFile->getNumberOfMaps()));
+    
+    const int64_t* dims = volumeFile->getDimensionsPtr();
+    m_bricksDimI = (dims[0] + BRICK_DIM - 1) / BRICK_DIM;
+    m_bricksDimJ = (dims[1] + BRICK_DIM - 1) / BRICK_DIM;
+    m_lastBrick = NULL;
+    m_lastBrickKey = -1;
+    m_compactedFlag = false;
 }
 
 /**
@@ -54,12 +72,12 @@ m_mapIndex(mapIndex)
  */
 VolumeMapUndoCommand::~VolumeMapUndoCommand()
 {
-    for (std::vector<VoxelMemento*>::iterator iter = m_voxelMementos.begin();
-         iter != m_voxelMementos.end();
+    for (std::map<int64_t, VoxelBrick*>::iterator iter = m_bricks.begin();
+         iter != m_bricks.end();
          iter++) {
-        delete *iter;
+        delete iter->second;
     }
-    m_voxelMementos.clear();
+    m_bricks.clear();
 }
 
 /**
@@ -75,14 +93,7 @@ VolumeMapUndoCommand::redo(AString& errorMessageOut)
 {
     errorMessageOut.clear();
     
-    for (std::vector<VoxelMemento*>::iterator iter = m_voxelMementos.begin();
-         iter != m_voxelMementos.end();
-         iter++) {
-        const VoxelMemento* voxelMod = *iter;
-        m_volumeFile->setValue(voxelMod->m_redoValue,
-                               voxelMod->m_ijk,
-                               m_mapIndex);
-    }
+    applyValues(true);
     
     return true;
 }
@@ -95,31 +106,74 @@ VolumeMapUndoCommand::undo(AString& errorMessageOut)
 {
     errorMessageOut.clear();
     
-    for (std::vector<VoxelMemento*>::iterator iter = m_voxelMementos.begin();
-         iter != m_voxelMementos.end();
-         iter++) {
-        const VoxelMemento* voxelMod = *iter;
-        m_volumeFile->setValue(voxelMod->m_undoValue,
-                               voxelMod->m_ijk,
-                               m_mapIndex);
-    }
+    applyValues(false);
     
     return true;
 }
 
+/**
+ * Set the redo or undo values of all modified voxels.
+ *
+ * @param redoFlag
+ *     If true, set the redo values, else the undo values.
+ */
+void
+VolumeMapUndoCommand::applyValues(const bool redoFlag)
+{
+    compact();
+    
+    for (std::map<int64_t, VoxelBrick*>::const_iterator iter = m_bricks.begin();
+         iter != m_bricks.end();
+         iter++) {
+        iter->second->apply(m_volumeFile,
+                            m_mapIndex,
+                            redoFlag);
+    }
+}
+
 /**
  * @return Number of modified voxels.
  */
 int32_t
 VolumeMapUndoCommand::count() const
 {
-    return m_voxelMementos.size();
+    int64_t numVoxels = 0;
+    for (std::map<int64_t, VoxelBrick*>::const_iterator iter = m_bricks.begin();
+         iter != m_bricks.end();
+         iter++) {
+        numVoxels += iter->second->m_numberOfVoxels;
+    }
+    
+    return numVoxels;
 }
 
+/**
+ * @return Approximate memory used by this command, in bytes.
+ */
+int64_t
+VolumeMapUndoCommand::getSizeInBytes() const
+{
+    /*
+     * Approximate overhead of a node in std::map
+     */
+    const int64_t mapNodeSize = 4 * sizeof(void*) + sizeof(int64_t) + sizeof(VoxelBrick*);
+    
+    int64_t totalSize = CaretUndoCommand::getSizeInBytes() - sizeof(CaretUndoCommand) + sizeof(VolumeMapUndoCommand);
+    for (std::map<int64_t, VoxelBrick*>::const_iterator iter = m_bricks.begin();
+         iter != m_bricks.end();
+         iter++) {
+        totalSize += mapNodeSize + iter->second->getSizeInBytes();
+    }
+    
+    return totalSize;
+}
 
 /**
  * Add the redo and undo values for a voxel.
  * 
+ * If the voxel was already added, the original undo value is kept
+ * and the redo value is replaced.
+ *
  * @param ijk
  *     The voxel's indices.
  * @param redoValue
@@ -132,9 +186,38 @@ VolumeMapUndoCommand::addVoxelRedoUndo(const int64_t ijk[3],
                                        const float redoValue,
                                        const float undoValue)
 {
-    m_voxelMementos.push_back(new VoxelMemento(ijk,
-                                               redoValue,
-                                               undoValue));
+    CaretAssert(m_volumeFile->indexValid(ijk));
+    
+    const int64_t brickI = ijk[0] / BRICK_DIM;
+    const int64_t brickJ = ijk[1] / BRICK_DIM;
+    const int64_t brickK = ijk[2] / BRICK_DIM;
+    const int64_t brickKey = brickI + m_bricksDimI * (brickJ + m_bricksDimJ * brickK);
+    
+    if (brickKey != m_lastBrickKey) {
+        std::map<int64_t, VoxelBrick*>::iterator iter = m_bricks.find(brickKey);
+        if (iter != m_bricks.end()) {
+            m_lastBrick = iter->second;
+        }
+        else {
+            const int64_t firstVoxelIJK[3] = {
+                brickI * BRICK_DIM,
+                brickJ * BRICK_DIM,
+                brickK * BRICK_DIM
+            };
+            m_lastBrick = new VoxelBrick(firstVoxelIJK);
+            m_bricks.insert(std::make_pair(brickKey, m_lastBrick));
+        }
+        m_lastBrickKey = brickKey;
+    }
+    
+    CaretAssert(m_lastBrick);
+    const int32_t offset = ((ijk[0] - m_lastBrick->m_firstVoxelIJK[0])
+                            + BRICK_DIM * ((ijk[1] - m_lastBrick->m_firstVoxelIJK[1])
+                                           + BRICK_DIM * (ijk[2] - m_lastBrick->m_firstVoxelIJK[2])));
+    m_lastBrick->addVoxel(offset,
+                          redoValue,
+                          undoValue);
+    m_compactedFlag = false;
 }
 
 /**
@@ -161,33 +244,281 @@ VolumeMapUndoCommand::addVoxelRedoUndo(const int64_t i,
     const int64_t ijk[3] = { i, j, k };
     addVoxelRedoUndo(ijk, redoValue, undoValue);
 }
+
+/**
+ * Reduce memory used by the command.  Each brick keeps only the
+ * voxels whose value was changed, and the values are run-length
+ * encoded when that is smaller.  Bricks without changed voxels are
+ * removed.  Voxels may still be added after compacting but it is
+ * best to call this once all voxels have been added.
+ */
+void
+VolumeMapUndoCommand::compact()
+{
+    if (m_compactedFlag) {
+        return;
+    }
+    
+    std::map<int64_t, VoxelBrick*>::iterator iter = m_bricks.begin();
+    while (iter != m_bricks.end()) {
+        VoxelBrick* brick = iter->second;
+        brick->compact();
+        if (brick->m_numberOfVoxels <= 0) {
+            delete brick;
+            m_bricks.erase(iter++);
+        }
+        else {
+            ++iter;
+        }
+    }
+    
+    m_lastBrick = NULL;
+    m_lastBrickKey = -1;
+    m_compactedFlag = true;
+}
+
 /* ------------------------------------------------------------------ */
 /**
  * Constructor.
  *
- * @param ijk
- *     The voxel's indices.
+ * @param firstVoxelIJK
+ *     Indices of the first voxel in the brick.
+ */
+VolumeMapUndoCommand::VoxelBrick::VoxelBrick(const int64_t firstVoxelIJK[3])
+{
+    m_firstVoxelIJK[0] = firstVoxelIJK[0];
+    m_firstVoxelIJK[1] = firstVoxelIJK[1];
+    m_firstVoxelIJK[2] = firstVoxelIJK[2];
+    m_numberOfVoxels = 0;
+    for (int32_t i = 0; i < 8; i++) {
+        m_addedMask[i] = 0;
+    }
+}
+
+/**
+ * Add the redo and undo values for a voxel in the brick.
+ *
+ * @param offset
+ *     Offset of the voxel in the brick.
  * @param redoValue
  *     Value for redo operation.
  * @param undoValue
  *     Value for undo operation.
  */
-VolumeMapUndoCommand::VoxelMemento::VoxelMemento(const int64_t ijk[3],
-                                                 const float redoValue,
-                                                 const float undoValue)
+void
+VolumeMapUndoCommand::VoxelBrick::addVoxel(const int32_t offset,
+                                           const float redoValue,
+                                           const float undoValue)
 {
-    m_ijk[0] = ijk[0];
-    m_ijk[1] = ijk[1];
-    m_ijk[2] = ijk[2];
+    CaretAssert((offset >= 0) && (offset < BRICK_SIZE));
+    
+    if (m_denseRedoValues.empty()) {
+        expand();
+    }
     
-    m_redoValue = redoValue;
-    m_undoValue = undoValue;
+    const uint64_t bit = (static_cast<uint64_t>(1) << (offset & 63));
+    uint64_t& maskWord = m_addedMask[offset >> 6];
+    if ((maskWord & bit) == 0) {
+        maskWord |= bit;
+        m_denseUndoValues[offset] = undoValue;
+        ++m_numberOfVoxels;
+    }
+    m_denseRedoValues[offset] = redoValue;
 }
 
-VolumeMapUndoCommand::VoxelMemento::~VoxelMemento()
+/**
+ * Keep only the voxels whose redo and undo values differ and
+ * release the dense arrays.
+ */
+void
+VolumeMapUndoCommand::VoxelBrick::compact()
 {
+    if (m_denseRedoValues.empty()) {
+        return;
+    }
+    
+    std::vector<float> redoValues;
+    std::vector<float> undoValues;
+    m_offsets.clear();
+    for (int32_t offset = 0; offset < BRICK_SIZE; offset++) {
+        if (m_addedMask[offset >> 6] & (static_cast<uint64_t>(1) << (offset & 63))) {
+            const float redoValue = m_denseRedoValues[offset];
+            const float undoValue = m_denseUndoValues[offset];
+            if (redoValue != undoValue) {
+                m_offsets.push_back(offset);
+                redoValues.push_back(redoValue);
+                undoValues.push_back(undoValue);
+            }
+        }
+    }
+    
+    m_redoValues.encode(redoValues);
+    m_undoValues.encode(undoValues);
+    m_numberOfVoxels = m_offsets.size();
+    
+    std::vector<float>().swap(m_denseRedoValues);
+    std::vector<float>().swap(m_denseUndoValues);
+    for (int32_t i = 0; i < 8; i++) {
+        m_addedMask[i] = 0;
+    }
+}
+
+/**
+ * Restore the dense arrays from the compacted voxels so that
+ * more voxels may be added.
+ */
+void
+VolumeMapUndoCommand::VoxelBrick::expand()
+{
+    if ( ! m_denseRedoValues.empty()) {
+        return;
+    }
+    
+    m_denseRedoValues.resize(BRICK_SIZE, 0.0f);
+    m_denseUndoValues.resize(BRICK_SIZE, 0.0f);
     
+    std::vector<float> redoValues;
+    std::vector<float> undoValues;
+    m_redoValues.decode(redoValues);
+    m_undoValues.decode(undoValues);
+    CaretAssert(redoValues.size() == m_offsets.size());
+    CaretAssert(undoValues.size() == m_offsets.size());
+    
+    const int32_t numOffsets = m_offsets.size();
+    for (int32_t i = 0; i < numOffsets; i++) {
+        const int32_t offset = m_offsets[i];
+        m_addedMask[offset >> 6] |= (static_cast<uint64_t>(1) << (offset & 63));
+        m_denseRedoValues[offset] = redoValues[i];
+        m_denseUndoValues[offset] = undoValues[i];
+    }
+    m_numberOfVoxels = numOffsets;
+    
+    std::vector<uint16_t>().swap(m_offsets);
+    m_redoValues = ValueRuns();
+    m_undoValues = ValueRuns();
+}
+
+/**
+ * Set the voxels in the volume file to the redo or undo values.
+ *
+ * @param volumeFile
+ *     The volume file.
+ * @param mapIndex
+ *     Index of the map.
+ * @param redoFlag
+ *     If true, set the redo values, else the undo values.
+ */
+void
+VolumeMapUndoCommand::VoxelBrick::apply(VolumeFile* volumeFile,
+                                        const int32_t mapIndex,
+                                        const bool redoFlag) const
+{
+    CaretAssert(m_denseRedoValues.empty());
+    
+    const ValueRuns& valueRuns = (redoFlag ? m_redoValues : m_undoValues);
+    const int32_t numRuns = valueRuns.m_values.size();
+    const bool encodedFlag = ( ! valueRuns.m_runLengths.empty());
+    
+    int32_t offsetIndex = 0;
+    for (int32_t iRun = 0; iRun < numRuns; iRun++) {
+        const float value = valueRuns.m_values[iRun];
+        const int32_t runLength = (encodedFlag ? valueRuns.m_runLengths[iRun] : 1);
+        for (int32_t n = 0; n < runLength; n++) {
+            CaretAssertVectorIndex(m_offsets, offsetIndex);
+            const int32_t offset = m_offsets[offsetIndex];
+            ++offsetIndex;
+            volumeFile->setValue(value,
+                                 m_firstVoxelIJK[0] + (offset % BRICK_DIM),
+                                 m_firstVoxelIJK[1] + ((offset / BRICK_DIM) % BRICK_DIM),
+                                 m_firstVoxelIJK[2] + (offset / (BRICK_DIM * BRICK_DIM)),
+                                 mapIndex);
+        }
+    }
+    CaretAssert(offsetIndex == static_cast<int32_t>(m_offsets.size()));
+}
+
+/**
+ * @return Approximate memory used by the brick, in bytes.
+ */
+int64_t
+VolumeMapUndoCommand::VoxelBrick::getSizeInBytes() const
+{
+    return (sizeof(VoxelBrick)
+            + (m_denseRedoValues.capacity() + m_denseUndoValues.capacity()) * sizeof(float)
+            + m_offsets.capacity() * sizeof(uint16_t)
+            + m_redoValues.getSizeInBytes()
+            + m_undoValues.getSizeInBytes());
 }
 
+/* ------------------------------------------------------------------ */
+/**
+ * Store the values, run-length encoded if that uses less memory.
+ *
+ * @param values
+ *     The values.
+ */
+void
+VolumeMapUndoCommand::ValueRuns::encode(const std::vector<float>& values)
+{
+    m_values.clear();
+    m_runLengths.clear();
+    
+    const int32_t numValues = values.size();
+    for (int32_t i = 0; i < numValues; i++) {
+        if (( ! m_values.empty())
+            && (values[i] == m_values.back())) {
+            ++m_runLengths.back();
+        }
+        else {
+            m_values.push_back(values[i]);
+            m_runLengths.push_back(1);
+        }
+    }
+    
+    /*
+     * A run costs a value and a length so encoding only
+     * helps when runs average more than 1.5 voxels.
+     */
+    const int64_t encodedSize = m_values.size() * (sizeof(float) + sizeof(uint16_t));
+    const int64_t plainSize   = numValues * sizeof(float);
+    if (encodedSize >= plainSize) {
+        m_values = values;
+        m_runLengths.clear();
+    }
+    
+    std::vector<float>(m_values).swap(m_values);
+    std::vector<uint16_t>(m_runLengths).swap(m_runLengths);
+}
 
+/**
+ * Get the values that were stored.
+ *
+ * @param valuesOut
+ *     Output containing the values.
+ */
+void
+VolumeMapUndoCommand::ValueRuns::decode(std::vector<float>& valuesOut) const
+{
+    if (m_runLengths.empty()) {
+        valuesOut = m_values;
+        return;
+    }
+    
+    valuesOut.clear();
+    const int32_t numRuns = m_values.size();
+    for (int32_t iRun = 0; iRun < numRuns; iRun++) {
+        valuesOut.insert(valuesOut.end(),
+                         m_runLengths[iRun],
+                         m_values[iRun]);
+    }
+}
 
+/**
+ * @return Approximate memory used by the values, in bytes.
+ */
+int64_t
+VolumeMapUndoCommand::ValueRuns::getSizeInBytes() const
+{
+    return (m_values.capacity() * sizeof(float)
+            + m_runLengths.capacity() * sizeof(uint16_t));
+}
@@ -22,6 +22,9 @@
 /*LICENSE_END*/
 
 
+#include <map>
+#include <vector>
+
 #include "CaretUndoCommand.h"
 
 
@@ -42,6 +45,8 @@ namespace caret {
         
         virtual bool undo(AString& errorMessageOut);
         
+        virtual int64_t getSizeInBytes() const;
+        
         int32_t count() const;
         
         void addVoxelRedoUndo(const int64_t ijk[3],
@@ -54,33 +59,96 @@ namespace caret {
                               const float redoValue,
                               const float undoValue);
         
+        void compact();
+        
         // ADD_NEW_METHODS_HERE
 
     private:
-        class VoxelMemento {
+        /**
+         * Values are run-length encoded when it saves memory.
+         */
+        class ValueRuns {
         public:
-            VoxelMemento(const int64_t ijk[3],
-                         const float redoValue,
-                         const float undoValue);
+            void encode(const std::vector<float>& values);
             
-            ~VoxelMemento();
+            void decode(std::vector<float>& valuesOut) const;
             
-            int64_t m_ijk[3];
+            int64_t getSizeInBytes() const;
             
-            float m_redoValue;
+            /** Value of each run (or of each voxel when m_runLengths is empty) */
+            std::vector<float> m_values;
             
-            float m_undoValue;
+            /** Number of voxels in each run, empty when values are not encoded */
+            std::vector<uint16_t> m_runLengths;
+        };
+        
+        /**
+         * Modified voxels in an 8x8x8 block of the volume.  While
+         * voxels are being added, values are kept in dense arrays.
+         * Once compacted, only modified voxels are kept.
+         */
+        class VoxelBrick {
+        public:
+            VoxelBrick(const int64_t firstVoxelIJK[3]);
+            
+            void addVoxel(const int32_t offset,
+                          const float redoValue,
+                          const float undoValue);
+            
+            void compact();
+            
+            void expand();
+            
+            void apply(VolumeFile* volumeFile,
+                       const int32_t mapIndex,
+                       const bool redoFlag) const;
+            
+            int64_t getSizeInBytes() const;
+            
+            int64_t m_firstVoxelIJK[3];
+            
+            int32_t m_numberOfVoxels;
+            
+            /** Bit for each voxel that has been added (dense only) */
+            uint64_t m_addedMask[8];
+            
+            /** Dense values for all voxels in brick (empty when compacted) */
+            std::vector<float> m_denseRedoValues;
+            
+            std::vector<float> m_denseUndoValues;
+            
+            /** Offset in brick of each modified voxel, increasing (compacted only) */
+            std::vector<uint16_t> m_offsets;
+            
+            ValueRuns m_redoValues;
+            
+            ValueRuns m_undoValues;
         };
         
         VolumeMapUndoCommand(const VolumeMapUndoCommand&);
 
         VolumeMapUndoCommand& operator=(const VolumeMapUndoCommand&);
         
+        void applyValues(const bool redoFlag);
+        
         VolumeFile* m_volumeFile;
         
         const int32_t m_mapIndex;
         
-        std::vector<VoxelMemento*> m_voxelMementos;
+        /** Number of bricks along the first and second volume axes */
+        int64_t m_bricksDimI;
+        
+        int64_t m_bricksDimJ;
+        
+        /** Bricks keyed by their index in the volume's grid of bricks */
+        std::map<int64_t, VoxelBrick*> m_bricks;
+        
+        /** Brick that most recently received a voxel (voxels tend to be added in order) */
+        VoxelBrick* m_lastBrick;
+        
+        int64_t m_lastBrickKey;
+        
+        bool m_compactedFlag;
         
         // ADD_NEW_MEMBERS_HERE
 
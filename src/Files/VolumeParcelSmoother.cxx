@@ -0,0 +1,398 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "VolumeParcelSmoother.h"
+
+#include "CaretAssert.h"
+#include "CaretLogger.h"
+#include "Vector3D.h"
+#include "VolumeSpace.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+VolumeParcelSmoother::VolumeParcelSmoother(const VolumeSpace& volSpace, const float& kernel)
+{
+    CaretAssert(kernel > 0.0f);
+    const int64_t* dims = volSpace.getDims();
+    m_dims[0] = dims[0];
+    m_dims[1] = dims[1];
+    m_dims[2] = dims[2];
+    float kernBox = kernel * 3.0f;//kernel setup copied from volume smoothing, so that results match it exactly
+    Vector3D ivec, jvec, kvec, origin;
+    volSpace.getSpacingVectors(ivec, jvec, kvec, origin);
+    const float ORTH_TOLERANCE = 0.001f;
+    m_orthogonal = (abs(ivec.dot(jvec.normal())) / ivec.length() < ORTH_TOLERANCE && abs(jvec.dot(kvec.normal())) / jvec.length() < ORTH_TOLERANCE && abs(kvec.dot(ivec.normal())) / kvec.length() < ORTH_TOLERANCE);
+    if (m_orthogonal)
+    {
+        float ispace = ivec.length(), jspace = jvec.length(), kspace = kvec.length();
+        m_irange = (int)floor(kernBox / ispace);
+        m_jrange = (int)floor(kernBox / jspace);
+        m_krange = (int)floor(kernBox / kspace);
+        if (m_irange < 1) m_irange = 1;//don't underflow
+        if (m_jrange < 1) m_jrange = 1;
+        if (m_krange < 1) m_krange = 1;
+        m_iweights.resize(m_irange * 2 + 1);
+        m_jweights.resize(m_jrange * 2 + 1);
+        m_kweights.resize(m_krange * 2 + 1);
+        for (int i = 0; i < (int)m_iweights.size(); ++i)
+        {
+            float tempf = ispace * (i - m_irange) / kernel;
+            m_iweights[i] = exp(-tempf * tempf / 2.0f);
+        }
+        for (int j = 0; j < (int)m_jweights.size(); ++j)
+        {
+            float tempf = jspace * (j - m_jrange) / kernel;
+            m_jweights[j] = exp(-tempf * tempf / 2.0f);
+        }
+        for (int k = 0; k < (int)m_kweights.size(); ++k)
+        {
+            float tempf = kspace * (k - m_krange) / kernel;
+            m_kweights[k] = exp(-tempf * tempf / 2.0f);
+        }
+    } else {
+        CaretLogWarning("input volume is not orthogonal, smoothing will take longer");
+        Vector3D ijorth = ivec.cross(jvec).normal();//find the bounding box that encloses a sphere of radius kernBox
+        Vector3D jkorth = jvec.cross(kvec).normal();
+        Vector3D kiorth = kvec.cross(ivec).normal();
+        m_irange = (int)floor(abs(kernBox / ivec.dot(jkorth)));
+        m_jrange = (int)floor(abs(kernBox / jvec.dot(kiorth)));
+        m_krange = (int)floor(abs(kernBox / kvec.dot(ijorth)));
+        if (m_irange < 1) m_irange = 1;
+        if (m_jrange < 1) m_jrange = 1;
+        if (m_krange < 1) m_krange = 1;
+        int isize = m_irange * 2 + 1, jsize = m_jrange * 2 + 1, ksize = m_krange * 2 + 1;
+        m_weights.resize(isize * jsize * ksize);
+        Vector3D kscratch, jscratch, iscratch;
+        for (int k = 0; k < ksize; ++k)
+        {
+            kscratch = kvec * (k - m_krange);
+            for (int j = 0; j < jsize; ++j)
+            {
+                jscratch = kscratch + jvec * (j - m_jrange);
+                for (int i = 0; i < isize; ++i)
+                {
+                    iscratch = jscratch + ivec * (i - m_irange);
+                    float tempf = iscratch.length();
+                    if (tempf > kernBox)
+                    {
+                        m_weights[(k * jsize + j) * isize + i] = 0.0f;
+                    } else {
+                        m_weights[(k * jsize + j) * isize + i] = exp(-tempf * tempf / kernel / kernel / 2.0f);
+                    }
+                }
+            }
+        }
+    }
+}
+
+int VolumeParcelSmoother::addParcel(const vector<int64_t>& voxelList)
+{
+    int ret = (int)m_parcels.size();
+    m_parcels.push_back(Parcel());
+    Parcel& thisParcel = m_parcels.back();
+    int64_t listSize = (int64_t)voxelList.size() / 3;
+    if (listSize == 0)
+    {
+        thisParcel.m_boxDims[0] = 0;
+        thisParcel.m_boxDims[1] = 0;
+        thisParcel.m_boxDims[2] = 0;
+        return ret;
+    }
+    int64_t extrema[6] = { voxelList[0], voxelList[0], voxelList[1], voxelList[1], voxelList[2], voxelList[2] };
+    for (int64_t v = 1; v < listSize; ++v)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            int64_t index = voxelList[v * 3 + axis];
+            CaretAssert(index >= 0 && index < m_dims[axis]);
+            if (index < extrema[axis * 2]) extrema[axis * 2] = index;
+            if (index > extrema[axis * 2 + 1]) extrema[axis * 2 + 1] = index;
+        }
+    }
+    const int64_t* boxDims = thisParcel.m_boxDims;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        thisParcel.m_boxDims[axis] = extrema[axis * 2 + 1] - extrema[axis * 2] + 1;
+    }
+    int64_t boxSize = boxDims[0] * boxDims[1] * boxDims[2];
+    thisParcel.m_roi.resize(boxSize, 0);
+    thisParcel.m_frameIndices.resize(listSize);
+    thisParcel.m_boxIndices.resize(listSize);
+    for (int64_t v = 0; v < listSize; ++v)
+    {
+        int64_t i = voxelList[v * 3], j = voxelList[v * 3 + 1], k = voxelList[v * 3 + 2];
+        thisParcel.m_frameIndices[v] = i + m_dims[0] * (j + m_dims[1] * k);
+        int64_t boxIndex = (i - extrema[0]) + boxDims[0] * ((j - extrema[2]) + boxDims[1] * (k - extrema[4]));
+        thisParcel.m_boxIndices[v] = boxIndex;
+        thisParcel.m_roi[boxIndex] = 1;
+    }
+    if (!m_orthogonal) return ret;
+    thisParcel.m_iTouched.resize(boxSize, 0);//voxels whose i-kernel intersects the roi, the only ones with nonzero i pass weights
+    thisParcel.m_jTouched.resize(boxSize, 0);//voxels whose j-kernel intersects an i-touched voxel
+    for (int64_t v = 0; v < listSize; ++v)
+    {
+        int64_t boxIndex = thisParcel.m_boxIndices[v];
+        int64_t i = boxIndex % boxDims[0];
+        int64_t rowBase = boxIndex - i;
+        int64_t imin = max(i - m_irange, (int64_t)0), imax = min(i + m_irange + 1, boxDims[0]);
+        for (int64_t ikern = imin; ikern < imax; ++ikern)
+        {
+            thisParcel.m_iTouched[rowBase + ikern] = 1;
+        }
+    }
+    for (int64_t k = 0; k < boxDims[2]; ++k)
+    {
+        for (int64_t j = 0; j < boxDims[1]; ++j)
+        {
+            for (int64_t i = 0; i < boxDims[0]; ++i)
+            {
+                if (thisParcel.m_iTouched[i + boxDims[0] * (j + boxDims[1] * k)] == 0) continue;
+                thisParcel.m_iList.push_back(i);
+                thisParcel.m_iList.push_back(j);
+                thisParcel.m_iList.push_back(k);
+                int64_t jmin = max(j - m_jrange, (int64_t)0), jmax = min(j + m_jrange + 1, boxDims[1]);
+                for (int64_t jkern = jmin; jkern < jmax; ++jkern)
+                {
+                    thisParcel.m_jTouched[i + boxDims[0] * (jkern + boxDims[1] * k)] = 1;
+                }
+            }
+        }
+    }
+    for (int64_t k = 0; k < boxDims[2]; ++k)
+    {
+        for (int64_t j = 0; j < boxDims[1]; ++j)
+        {
+            for (int64_t i = 0; i < boxDims[0]; ++i)
+            {
+                if (thisParcel.m_jTouched[i + boxDims[0] * (j + boxDims[1] * k)] == 0) continue;
+                thisParcel.m_jList.push_back(i);
+                thisParcel.m_jList.push_back(j);
+                thisParcel.m_jList.push_back(k);
+            }
+        }
+    }
+    return ret;
+}
+
+int64_t VolumeParcelSmoother::getParcelSize(const int& parcel) const
+{
+    CaretAssertVectorIndex(m_parcels, parcel);
+    return (int64_t)m_parcels[parcel].m_frameIndices.size();
+}
+
+const vector<int64_t>& VolumeParcelSmoother::getParcelFrameIndices(const int& parcel) const
+{
+    CaretAssertVectorIndex(m_parcels, parcel);
+    return m_parcels[parcel].m_frameIndices;
+}
+
+void VolumeParcelSmoother::smoothParcel(const int& parcel, const float* valuesIn, float* valuesOut, const bool& fixZeros, Scratch& scratch) const
+{
+    CaretAssertVectorIndex(m_parcels, parcel);
+    const Parcel& thisParcel = m_parcels[parcel];
+    if (thisParcel.m_frameIndices.empty()) return;
+    if (m_orthogonal)
+    {
+        smoothOrthogonal(thisParcel, valuesIn, valuesOut, fixZeros, scratch);
+    } else {
+        smoothNonOrthogonal(thisParcel, valuesIn, valuesOut, fixZeros, scratch);
+    }
+}
+
+void VolumeParcelSmoother::smoothParcelFrame(const int& parcel, const float* frameIn, float* frameOut, const bool& fixZeros, Scratch& scratch) const
+{
+    CaretAssertVectorIndex(m_parcels, parcel);
+    const vector<int64_t>& frameIndices = m_parcels[parcel].m_frameIndices;
+    int64_t parcelSize = (int64_t)frameIndices.size();
+    scratch.m_valuesIn.resize(parcelSize);
+    scratch.m_valuesOut.resize(parcelSize);
+    for (int64_t v = 0; v < parcelSize; ++v)
+    {
+        scratch.m_valuesIn[v] = frameIn[frameIndices[v]];
+    }
+    smoothParcel(parcel, scratch.m_valuesIn.data(), scratch.m_valuesOut.data(), fixZeros, scratch);
+    for (int64_t v = 0; v < parcelSize; ++v)
+    {
+        frameOut[frameIndices[v]] = scratch.m_valuesOut[v];
+    }
+}
+
+void VolumeParcelSmoother::smoothOrthogonal(const Parcel& thisParcel, const float* valuesIn, float* valuesOut, const bool& fixZeros, Scratch& scratch) const
+{//same passes and order of operations as the roi case of orthogonal volume smoothing, restricted to the bounding box
+    const int64_t* boxDims = thisParcel.m_boxDims;
+    int64_t boxSize = boxDims[0] * boxDims[1] * boxDims[2];
+    if ((int64_t)scratch.m_boxValues.size() < boxSize)
+    {//only voxels in the roi or the touched masks are ever read, so the contents don't need to be cleared
+        scratch.m_boxValues.resize(boxSize);
+        scratch.m_boxSums.resize(boxSize);
+        scratch.m_boxWeights.resize(boxSize);
+        scratch.m_boxSums2.resize(boxSize);
+        scratch.m_boxWeights2.resize(boxSize);
+    }
+    float* boxValues = scratch.m_boxValues.data(), *boxSums = scratch.m_boxSums.data(), *boxWeights = scratch.m_boxWeights.data();
+    float* boxSums2 = scratch.m_boxSums2.data(), *boxWeights2 = scratch.m_boxWeights2.data();
+    const char* roi = thisParcel.m_roi.data(), *iTouched = thisParcel.m_iTouched.data(), *jTouched = thisParcel.m_jTouched.data();
+    int64_t parcelSize = (int64_t)thisParcel.m_boxIndices.size();
+    for (int64_t v = 0; v < parcelSize; ++v)
+    {
+        boxValues[thisParcel.m_boxIndices[v]] = valuesIn[v];
+    }
+    int64_t ibasesize = (int64_t)thisParcel.m_iList.size();
+    for (int64_t ibase = 0; ibase < ibasesize; ibase += 3)
+    {
+        int i = thisParcel.m_iList[ibase];
+        int j = thisParcel.m_iList[ibase + 1];
+        int k = thisParcel.m_iList[ibase + 2];
+        int imin = i - m_irange, imax = i + m_irange + 1;//one-after array size convention
+        if (imin < 0) imin = 0;
+        if (imax > boxDims[0]) imax = boxDims[0];
+        float sum = 0.0f, weightsum = 0.0f;
+        int64_t baseInd = boxDims[0] * (j + boxDims[1] * k);
+        for (int ikern = imin; ikern < imax; ++ikern)
+        {
+            int64_t thisIndex = baseInd + ikern;
+            if (roi[thisIndex] != 0 && (!fixZeros || boxValues[thisIndex] != 0.0f))
+            {
+                float weight = m_iweights[ikern - i + m_irange];
+                weightsum += weight;
+                sum += weight * boxValues[thisIndex];
+            }
+        }
+        boxWeights[baseInd + i] = weightsum;
+        boxSums[baseInd + i] = sum;//don't divide until the k pass
+    }
+    int64_t jbasesize = (int64_t)thisParcel.m_jList.size();
+    for (int64_t jbase = 0; jbase < jbasesize; jbase += 3)
+    {
+        int i = thisParcel.m_jList[jbase];
+        int j = thisParcel.m_jList[jbase + 1];
+        int k = thisParcel.m_jList[jbase + 2];
+        int jmin = j - m_jrange, jmax = j + m_jrange + 1;
+        if (jmin < 0) jmin = 0;
+        if (jmax > boxDims[1]) jmax = boxDims[1];
+        float sum = 0.0f, weightsum = 0.0f;
+        int64_t baseInd = i + boxDims[0] * boxDims[1] * k;
+        for (int jkern = jmin; jkern < jmax; ++jkern)
+        {
+            int64_t thisIndex = baseInd + jkern * boxDims[0];
+            if (iTouched[thisIndex] != 0)
+            {
+                float weight = m_jweights[jkern - j + m_jrange];
+                weightsum += weight * boxWeights[thisIndex];
+                sum += weight * boxSums[thisIndex];
+            }
+        }
+        boxWeights2[baseInd + j * boxDims[0]] = weightsum;
+        boxSums2[baseInd + j * boxDims[0]] = sum;
+    }
+    int64_t sliceSize = boxDims[0] * boxDims[1];
+    for (int64_t v = 0; v < parcelSize; ++v)
+    {
+        int64_t boxIndex = thisParcel.m_boxIndices[v];
+        int k = (int)(boxIndex / sliceSize);
+        int64_t baseInd = boxIndex - k * sliceSize;
+        int kmin = k - m_krange, kmax = k + m_krange + 1;
+        if (kmin < 0) kmin = 0;
+        if (kmax > boxDims[2]) kmax = boxDims[2];
+        float sum = 0.0f, weightsum = 0.0f;
+        for (int kkern = kmin; kkern < kmax; ++kkern)
+        {
+            int64_t thisIndex = baseInd + kkern * sliceSize;
+            if (jTouched[thisIndex] != 0)
+            {
+                float weight = m_kweights[kkern - k + m_krange];
+                weightsum += weight * boxWeights2[thisIndex];
+                sum += weight * boxSums2[thisIndex];
+            }
+        }
+        if (weightsum != 0.0f)
+        {
+            valuesOut[v] = sum / weightsum;
+        } else {
+            valuesOut[v] = 0.0f;
+        }
+    }
+}
+
+void VolumeParcelSmoother::smoothNonOrthogonal(const Parcel& thisParcel, const float* valuesIn, float* valuesOut, const bool& fixZeros, Scratch& scratch) const
+{
+    const int64_t* boxDims = thisParcel.m_boxDims;
+    int64_t boxSize = boxDims[0] * boxDims[1] * boxDims[2];
+    if ((int64_t)scratch.m_boxValues.size() < boxSize)
+    {
+        scratch.m_boxValues.resize(boxSize);
+    }
+    float* boxValues = scratch.m_boxValues.data();
+    const char* roi = thisParcel.m_roi.data();
+    int64_t parcelSize = (int64_t)thisParcel.m_boxIndices.size();
+    for (int64_t v = 0; v < parcelSize; ++v)
+    {
+        boxValues[thisParcel.m_boxIndices[v]] = valuesIn[v];
+    }
+    int isize = m_irange * 2 + 1, jsize = m_jrange * 2 + 1;
+    int64_t sliceSize = boxDims[0] * boxDims[1];
+    for (int64_t v = 0; v < parcelSize; ++v)
+    {
+        int64_t boxIndex = thisParcel.m_boxIndices[v];
+        int k = (int)(boxIndex / sliceSize);
+        int j = (int)((boxIndex - k * sliceSize) / boxDims[0]);
+        int i = (int)(boxIndex % boxDims[0]);
+        int imin = i - m_irange, imax = i + m_irange + 1;
+        if (imin < 0) imin = 0;
+        if (imax > boxDims[0]) imax = boxDims[0];
+        int jmin = j - m_jrange, jmax = j + m_jrange + 1;
+        if (jmin < 0) jmin = 0;
+        if (jmax > boxDims[1]) jmax = boxDims[1];
+        int kmin = k - m_krange, kmax = k + m_krange + 1;
+        if (kmin < 0) kmin = 0;
+        if (kmax > boxDims[2]) kmax = boxDims[2];
+        float sum = 0.0f, weightsum = 0.0f;
+        for (int kkern = kmin; kkern < kmax; ++kkern)
+        {
+            int64_t kindpart = kkern * boxDims[1];
+            int kkernpart = kkern - k + m_krange;
+            for (int jkern = jmin; jkern < jmax; ++jkern)
+            {
+                int64_t jindpart = (kindpart + jkern) * boxDims[0];
+                const float* weightRow = m_weights.data() + (kkernpart * jsize + jkern - j + m_jrange) * isize;
+                for (int ikern = imin; ikern < imax; ++ikern)
+                {
+                    int64_t thisIndex = jindpart + ikern;
+                    float weight = weightRow[ikern - i + m_irange];
+                    if (weight != 0.0f && roi[thisIndex] != 0 && (!fixZeros || boxValues[thisIndex] != 0.0f))
+                    {
+                        weightsum += weight;
+                        sum += weight * boxValues[thisIndex];
+                    }
+                }
+            }
+        }
+        if (weightsum != 0.0f)
+        {
+            valuesOut[v] = sum / weightsum;
+        } else {
+            valuesOut[v] = 0.0f;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef __VOLUME_PARCEL_SMOOTHER_H__
+#define __VOLUME_PARCEL_SMOOTHER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+
+    class VolumeSpace;
+
+    ///smooths each parcel of a volume using only the data inside that parcel, giving the same result as -volume-smoothing with the parcel as the roi
+    ///the bounding box, roi mask, and voxel lists of the separable passes are built once per parcel, then frames can be smoothed from multiple threads
+    class VolumeParcelSmoother
+    {
+    public:
+        ///working memory for smoothing, give each thread its own
+        struct Scratch
+        {
+            std::vector<float> m_boxValues, m_boxSums, m_boxWeights, m_boxSums2, m_boxWeights2;
+            std::vector<float> m_valuesIn, m_valuesOut;
+        };
+        VolumeParcelSmoother(const VolumeSpace& volSpace, const float& kernel);
+
+        ///voxelList is i, j, k triples, returns the index of the new parcel
+        int addParcel(const std::vector<int64_t>& voxelList);
+        int getNumberOfParcels() const { return (int)m_parcels.size(); }
+
+        ///number of voxels in the parcel
+        int64_t getParcelSize(const int& parcel) const;
+
+        ///index into a full frame of each parcel voxel, in the order of the voxel list
+        const std::vector<int64_t>& getParcelFrameIndices(const int& parcel) const;
+
+        ///valuesIn and valuesOut have one value per parcel voxel, in the order of the voxel list
+        void smoothParcel(const int& parcel, const float* valuesIn, float* valuesOut, const bool& fixZeros, Scratch& scratch) const;
+
+        ///reads the parcel voxels from a full input frame, and writes only the parcel voxels of a full output frame
+        void smoothParcelFrame(const int& parcel, const float* frameIn, float* frameOut, const bool& fixZeros, Scratch& scratch) const;
+    private:
+        struct Parcel
+        {
+            int64_t m_boxDims[3];
+            std::vector<int64_t> m_frameIndices, m_boxIndices;//per parcel voxel
+            std::vector<char> m_roi, m_iTouched, m_jTouched;//masks in the box, the touched masks are only used when orthogonal
+            std::vector<int> m_iList, m_jList;//i, j, k triples in the box of voxels that the i pass and j pass must compute
+        };
+        std::vector<Parcel> m_parcels;
+        int64_t m_dims[3];
+        bool m_orthogonal;
+        int m_irange, m_jrange, m_krange;
+        std::vector<float> m_iweights, m_jweights, m_kweights;//orthogonal
+        std::vector<float> m_weights;//non-orthogonal, full box kernel with k slowest
+        void smoothOrthogonal(const Parcel& thisParcel, const float* valuesIn, float* valuesOut, const bool& fixZeros, Scratch& scratch) const;
+        void smoothNonOrthogonal(const Parcel& thisParcel, const float* valuesIn, float* valuesOut, const bool& fixZeros, Scratch& scratch) const;
+    };
+
+}
+
+#endif //__VOLUME_PARCEL_SMOOTHER_H__
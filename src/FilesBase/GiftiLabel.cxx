@@ -25,9 +25,15 @@
 #undef __GIFTI_LABEL_DECLARE__
 
 #include "CaretLogger.h"
+#include "CaretMutex.h"
 
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_coloringModificationCounterMutex;
+}
+
 /**
  * Constructor.
  *
@@ -239,6 +245,7 @@ GiftiLabel::GiftiLabel(
  */
 GiftiLabel::~GiftiLabel()
 {
+    incrementColoringModificationCounter();
 }
 
 float GiftiLabel::colorClamp(const float& in)
@@ -318,6 +325,7 @@ GiftiLabel::initializeMembersGiftiLabel()
     this->z = 0.0;
     this->count = 0;
     m_groupNameSelectionItem = NULL;
+    incrementColoringModificationCounter();
 }
 
 /**
@@ -656,6 +664,7 @@ void
 GiftiLabel::setModified()
 {
     this->modifiedFlag = true;
+    incrementColoringModificationCounter();
 }
 
 /**
@@ -777,6 +786,29 @@ void
 GiftiLabel::setGroupNameSelectionItem(GroupAndNameHierarchyItem* item)
 {
     m_groupNameSelectionItem = item;
+    incrementColoringModificationCounter();
+}
+
+/**
+ * @return A counter that changes whenever any label is created, destroyed,
+ * or modified, so that results that depend on label keys and colors, such
+ * as compiled label coloring, can be cached until it changes.
+ */
+int64_t
+GiftiLabel::getColoringModificationCounter()
+{
+    CaretMutexLocker locker(&s_coloringModificationCounterMutex);
+    return s_coloringModificationCounter;
+}
+
+/**
+ * Increment the coloring modification counter.
+ */
+void
+GiftiLabel::incrementColoringModificationCounter()
+{
+    CaretMutexLocker locker(&s_coloringModificationCounterMutex);
+    s_coloringModificationCounter++;
 }
 
 /**
@@ -189,9 +189,13 @@ namespace caret {
          */
         static inline int32_t getInvalidLabelKey() { return s_invalidLabelKey; }
         
+        static int64_t getColoringModificationCounter();
+        
     private:
         void setNamePrivate(const AString& name);
         
+        static void incrementColoringModificationCounter();
+        
         /**tracks modification status (DO NOT CLONE) */
         bool modifiedFlag;
         
@@ -231,10 +235,14 @@ namespace caret {
         
         /** The invalid label key */
         const static int32_t s_invalidLabelKey;
+        
+        /** Incremented whenever any label is created, destroyed, or modified */
+        static int64_t s_coloringModificationCounter;
     };
     
 #ifdef __GIFTI_LABEL_DECLARE__
     const int32_t GiftiLabel::s_invalidLabelKey =  std::numeric_limits<int32_t>::min(); 
+    int64_t GiftiLabel::s_coloringModificationCounter = 0;
     //const int32_t GiftiLabel::s_invalidLabelKey = -2147483648;
 #endif // __GIFTI_LABEL_DECLARE__
 } // namespace
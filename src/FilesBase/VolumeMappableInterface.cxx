@@ -24,8 +24,15 @@
 #undef __VOLUME_MAPPABLE_INTERFACE_DECLARE__
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 using namespace caret;
 
+namespace
+{
+    CaretMutex s_voxelColoringVersionMutex;
+    int64_t s_voxelColoringVersion = 0;
+}
+
 
     
 /**
@@ -125,3 +132,32 @@ VolumeMappableInterface::limitIndicesToValidIndices(int64_t& index1,
     }
 }
 
+/**
+ * Get a version of the voxel coloring of a map.  The version changes
+ * whenever the map's voxel colors are reassigned (map data, palette,
+ * or thresholding changed) so that graphics created from the colors
+ * may be kept until the colors change.  Label selection, which may be
+ * applied when the colors are retrieved, is not part of the version.
+ *
+ * @param mapIndex
+ *     Index of the map.
+ * @return
+ *     The version, or zero if versions are not available, in which
+ *     case the colors must be compared to detect a change.
+ */
+int64_t
+VolumeMappableInterface::getVoxelColoringVersionForMap(const int32_t /*mapIndex*/) const
+{
+    return 0;
+}
+
+/**
+ * @return A new voxel coloring version, unique among all volumes
+ * so that a version is never reused by another volume.
+ */
+int64_t
+VolumeMappableInterface::newVoxelColoringVersion()
+{
+    CaretMutexLocker locker(&s_voxelColoringVersionMutex);
+    return ++s_voxelColoringVersion;
+}
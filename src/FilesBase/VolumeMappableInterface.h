@@ -352,6 +352,10 @@ namespace caret {
                                                        const int32_t tabIndex,
                                                        uint8_t* rgbaOut) const = 0;
         
+        virtual int64_t getVoxelColoringVersionForMap(const int32_t mapIndex) const;
+        
+        static int64_t newVoxelColoringVersion();
+        
         /**
          * Get the voxel coloring for the voxel at the given indices.
          *
@@ -995,6 +995,74 @@ GiftiDataArray::convertArrayIndexingOrder()
     }
 }
 
+/**
+ * Encode the data for the DATA element of a Base64Binary or
+ * GZipBase64Binary data array.  Does not modify this data array, so
+ * different data arrays may be encoded at the same time.
+ * @param encodingForWriting
+ *    GIFTI encoding, must be BASE64_BINARY or GZIP_BASE64_BINARY.
+ * @param compressionLevel
+ *    ZLIB compression level (0 to 9), negative for the ZLIB default.
+ * @param encodedDataOut
+ *    Output containing the encoded characters (not NULL terminated).
+ */
+void
+GiftiDataArray::encodeDataForWriting(const GiftiEncodingEnum::Enum encodingForWriting,
+                                     const int32_t compressionLevel,
+                                     std::vector<char>& encodedDataOut) const
+{
+    encodedDataOut.clear();
+
+    //
+    // Nothing to encode if data array is empty, writeAsXML() skips it
+    //
+    if (data.empty()) {
+        return;
+    }
+
+    const unsigned char* dataToEncode = data.data();
+    uint64_t dataToEncodeLength = data.size();
+    std::vector<unsigned char> compressedDataBuffer;
+    switch (encodingForWriting) {
+        case GiftiEncodingEnum::BASE64_BINARY:
+            break;
+        case GiftiEncodingEnum::GZIP_BASE64_BINARY:
+        {
+            //
+            // Compress the data with VTK's ZLIB algorithm
+            //
+            DataCompressZLib compressor;
+            if (compressionLevel >= 0) {
+                compressor.setCompressionLevel(compressionLevel);
+            }
+            uint64_t compressedDataBufferLength =
+                             compressor.getMaximumCompressionSpace(data.size());
+            compressedDataBuffer.resize(compressedDataBufferLength);
+            dataToEncodeLength = compressor.compressData(&data[0],
+                                                         data.size(),
+                                                         compressedDataBuffer.data(),
+                                                         compressedDataBufferLength);
+            dataToEncode = compressedDataBuffer.data();
+        }
+            break;
+        default:
+            CaretAssert(0);
+            throw GiftiException("PROGRAMMER ERROR: encoding " + GiftiEncodingEnum::toName(encodingForWriting)
+                                 + " is not a base64 encoding");
+    }
+    
+    //
+    // Encode the data with VTK's Base64 algorithm
+    //
+    encodedDataOut.resize(dataToEncodeLength + dataToEncodeLength / 3 + 10);//generous constant for partial bytes, integer rounding, and possible "=" formatting
+    const uint64_t encodedLength =
+       Base64::encode(dataToEncode,
+                      dataToEncodeLength,
+                      (unsigned char*)encodedDataOut.data());
+    CaretAssert(encodedLength <= encodedDataOut.size());
+    encodedDataOut.resize(encodedLength);
+}
+
 /**
  * write the data as XML.
  * @param stream
@@ -1003,11 +1071,19 @@ GiftiDataArray::convertArrayIndexingOrder()
  *    Stream for external binary file.
  * @param encodingForWriting
  *    GIFTI encoding used when writing the data.
+ * @param compressionLevel
+ *    ZLIB compression level (0 to 9) for GZIP_BASE64_BINARY, negative for the ZLIB default.
+ * @param encodedData
+ *    If not NULL, data previously encoded with encodeDataForWriting() for
+ *    BASE64_BINARY or GZIP_BASE64_BINARY, which is written instead of
+ *    encoding the data here.
  */
 void 
 GiftiDataArray::writeAsXML(std::ostream& stream, 
                            std::ostream* externalBinaryOutputStream,
-                           GiftiEncodingEnum::Enum encodingForWriting) 
+                           GiftiEncodingEnum::Enum encodingForWriting,
+                           const int32_t compressionLevel,
+                           const std::vector<char>* encodedData)
                                                
 {
     this->encoding = encodingForWriting;
@@ -1164,66 +1240,22 @@ GiftiDataArray::writeAsXML(std::ostream& stream,
          }
          break;
        case GiftiEncodingEnum::BASE64_BINARY:
-         {
-            //
-            // Encode the data with VTK's Base64 algorithm
-            //
-            const uint64_t bufferLength = static_cast<uint64_t>(data.size() * 1.5);
-            char* buffer = new char[bufferLength];
-            const uint64_t compressedLength =
-               Base64::encode(&data[0],
-                                          data.size(),
-                                          (unsigned char*)buffer);
-            if (compressedLength >= bufferLength) {
-               throw GiftiException(
-                     "Base64 encoding buffer length ("
-                     + AString::number(bufferLength)
-                     + ") is too small but needs to be "
-                                    + AString::number(compressedLength));
-            }
-            buffer[compressedLength] = '\0';
-            
-            //
-            // Write the data  MUST BE NO space around data
-            //
-            xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA, buffer);
-            
-            //
-            // Free memory
-            //
-            delete[] buffer;
-         }
-         break;
        case GiftiEncodingEnum::GZIP_BASE64_BINARY:
          {
-            //
-            // Compress the data with VTK's ZLIB algorithm
-            //
-             DataCompressZLib compressor;
-             uint64_t compressedDataBufferLength =
-                              compressor.getMaximumCompressionSpace(data.size());
-            std::vector<unsigned char> compressedDataBuffer(compressedDataBufferLength);
-            uint64_t compressedDataLength =
-                          compressor.compressData(&data[0], 
-                                               data.size(),
-                                               compressedDataBuffer.data(),
-                                               compressedDataBufferLength);
-            
-            //
-            // Encode the data with VTK's Base64 algorithm
-            //
-            std::vector<unsigned char> buffer(compressedDataLength + compressedDataLength / 3 + 10);//generous constant for partial bytes, integer rounding, and possible "=" formatting
-            const uint64_t compressedLength =
-               Base64::encode(compressedDataBuffer.data(),
-                                          compressedDataLength,
-                                          buffer.data());
-            buffer[compressedLength] = '\0';
-            
+             std::vector<char> encodedHere;
+             if (encodedData == NULL) {
+                 encodeDataForWriting(encoding,
+                                      compressionLevel,
+                                      encodedHere);
+                 encodedData = &encodedHere;
+             }
+             
              //
              // Write the data  MUST BE NO space around data
              //
-             xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA, (char*)buffer.data());
-             
+             xmlWriter.writeElementNoSpace(GiftiXmlElements::TAG_DATA,
+                                           encodedData->data(),
+                                           encodedData->size());
          }
          break;
        case GiftiEncodingEnum::EXTERNAL_FILE_BINARY:
@@ -126,7 +126,17 @@ namespace caret {
         // write the data as XML
         void writeAsXML(std::ostream& stream, 
                         std::ostream* externalBinaryOutputStream,
-                        GiftiEncodingEnum::Enum encodingForWriting);
+                        GiftiEncodingEnum::Enum encodingForWriting,
+                        const int32_t compressionLevel = -1,
+                        const std::vector<char>* encodedData = NULL);
+        
+        // encode the data for the DATA element of a Base64Binary or GZipBase64Binary data array
+        void encodeDataForWriting(const GiftiEncodingEnum::Enum encodingForWriting,
+                                  const int32_t compressionLevel,
+                                  std::vector<char>& encodedDataOut) const;
+        
+        /// get the size of the data in bytes
+        int64_t getDataSizeInBytes() const { return data.size(); }
         
         /// get endian
         GiftiEndianEnum::Enum getEndian() const { return endian; }
@@ -911,6 +911,7 @@ GiftiFile::writeFile(const AString& filename)
         //
         GiftiFileWriter giftiFileWriter(filename,
                             this->encodingForWriting);
+        giftiFileWriter.setCompressionLevel(GiftiFile::compressionLevelForWriting);
         
         //
         // Start writing the file
@@ -921,11 +922,9 @@ GiftiFile::writeFile(const AString& filename)
                               &this->labelTable);
         
         //
-        // Write the data arrays
+        // Write the data arrays, encoded concurrently
         //
-        for (int i = 0; i < numberOfDataArrays; i++) {
-            giftiFileWriter.writeDataArray(this->getDataArray(i));
-        }
+        giftiFileWriter.writeDataArrays(this->dataArrays);
         
         //
         // Finish writing the file
@@ -1240,6 +1239,48 @@ GiftiFile::setEncodingForWriting(const GiftiEncodingEnum::Enum encoding)
     this->encodingForWriting = encoding;
 }
 
+/**
+ * @return The encoding for writing given to GIFTI files when they are created.
+ */
+GiftiEncodingEnum::Enum
+GiftiFile::getDefaultEncodingForWriting()
+{
+    return GiftiFile::defaultEncodingForWriting;
+}
+
+/**
+ * Set the encoding for writing given to GIFTI files when they are created.
+ * Does not change files that already exist.
+ * @param encoding
+ *    New default encoding.
+ */
+void
+GiftiFile::setDefaultEncodingForWriting(const GiftiEncodingEnum::Enum encoding)
+{
+    GiftiFile::defaultEncodingForWriting = encoding;
+}
+
+/**
+ * @return The ZLIB compression level used when writing GZipBase64Binary
+ * data, negative for the ZLIB default.
+ */
+int32_t
+GiftiFile::getCompressionLevelForWriting()
+{
+    return GiftiFile::compressionLevelForWriting;
+}
+
+/**
+ * Set the ZLIB compression level used when writing GZipBase64Binary data.
+ * @param compressionLevel
+ *    Level from 0 (fastest) to 9 (smallest), negative for the ZLIB default.
+ */
+void
+GiftiFile::setCompressionLevelForWriting(const int32_t compressionLevel)
+{
+    GiftiFile::compressionLevelForWriting = compressionLevel;
+}
+
 
     
 /**
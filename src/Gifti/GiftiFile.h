@@ -191,6 +191,14 @@ class GiftiFile : public DataFile {
     
     void setEncodingForWriting(const GiftiEncodingEnum::Enum encoding);
     
+    static GiftiEncodingEnum::Enum getDefaultEncodingForWriting();
+    
+    static void setDefaultEncodingForWriting(const GiftiEncodingEnum::Enum encoding);
+    
+    static int32_t getCompressionLevelForWriting();
+    
+    static void setCompressionLevelForWriting(const int32_t compressionLevel);
+    
     virtual void clearModified();
     
     virtual bool isModified() const;
@@ -242,6 +250,9 @@ class GiftiFile : public DataFile {
     /** The default encoding for writing a GIFTI file. */
     static GiftiEncodingEnum::Enum defaultEncodingForWriting;
     
+    /** ZLIB compression level for writing GZipBase64Binary data, negative for the ZLIB default. */
+    static int32_t compressionLevelForWriting;
+    
       /*!!!! be sure to update copyHelperGiftiFile if new member added !!!!*/
    
    // 
@@ -251,6 +262,7 @@ class GiftiFile : public DataFile {
 
 #ifdef __GIFTI_FILE_MAIN__
     GiftiEncodingEnum::Enum GiftiFile::defaultEncodingForWriting = GiftiEncodingEnum::GZIP_BASE64_BINARY;
+    int32_t GiftiFile::compressionLevelForWriting = -1;
 #endif // __GIFTI_FILE_MAIN__
     
 
@@ -19,6 +19,8 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
+#include <exception>
 #include <fstream>
 #include <memory>
 
@@ -26,6 +28,7 @@
 #include "GiftiFileWriter.h"
 #undef __GIFTI_FILE_WRITER_DECLARE__
 
+#include "CaretOMP.h"
 #include "FileInformation.h"
 #include "GiftiDataArray.h"
 #include "GiftiXmlElements.h"
@@ -63,6 +66,8 @@ GiftiFileWriter::GiftiFileWriter(const AString& filename,
     this->encoding = encoding;
     this->xmlWriter = NULL;
     this->dataArraysWrittenCounter = 0;
+    this->compressionLevel = -1;
+    this->maximumEncodingBufferSize = 256 * 1024 * 1024;
 }
 
 /**
@@ -221,7 +226,8 @@ GiftiFileWriter::writeDataArray(GiftiDataArray* gda)
         //
         gda->writeAsXML(*this->xmlFileOutputStream, 
                         this->externalFileOutputStream,
-                        this->encoding);
+                        this->encoding,
+                        this->compressionLevel);
         
         //
         // Increment counter of data arrays written
@@ -238,6 +244,156 @@ GiftiFileWriter::writeDataArray(GiftiDataArray* gda)
     }    
 }
 
+/**
+ * Write GIFTI Data Arrays, in order.
+ *
+ * For the Base64Binary and GZipBase64Binary encodings, the arrays are
+ * grouped into batches whose encoded data is bounded by the maximum
+ * encoding buffer size.  The arrays in a batch are compressed and
+ * encoded by several threads while the previous batch is written.
+ * Other encodings write the arrays one at a time.
+ *
+ * @param dataArrays - The data arrays.
+ * @throws GiftiException - If an error occurs.
+ */
+void
+GiftiFileWriter::writeDataArrays(const std::vector<GiftiDataArray*>& dataArrays)
+{
+    const int32_t numArrays = static_cast<int32_t>(dataArrays.size());
+    if ((this->encoding != GiftiEncodingEnum::BASE64_BINARY)
+        && (this->encoding != GiftiEncodingEnum::GZIP_BASE64_BINARY)) {
+        for (int32_t i = 0; i < numArrays; i++) {
+            this->writeDataArray(dataArrays[i]);
+        }
+        return;
+    }
+    
+    this->verifyOpened();
+    
+    if ((this->dataArraysWrittenCounter + numArrays) > this->numberOfDataArrays) {
+        this->closeFiles();
+        throw GiftiException("PROGRAMMER ERROR: the number of data arrays "
+                                 "written exceeds the number of data arrays in the file "
+                                 "passed to start.");
+    }
+    
+    /*
+     * Batches of arrays, base64 is 4/3 of the (possibly compressed) size
+     */
+    std::vector<int32_t> batchStarts(1, 0);
+    int64_t batchBytes = 0;
+    for (int32_t i = 0; i < numArrays; i++) {
+        const int64_t encodedBytes = dataArrays[i]->getDataSizeInBytes() * 4 / 3;
+        if ((batchBytes > 0)
+            && ((batchBytes + encodedBytes) > this->maximumEncodingBufferSize)) {
+            batchStarts.push_back(i);
+            batchBytes = 0;
+        }
+        batchBytes += encodedBytes;
+    }
+    batchStarts.push_back(numArrays);
+    const int32_t numBatches = static_cast<int32_t>(batchStarts.size()) - 1;
+    
+    std::vector<std::vector<char> > encodedData(numArrays);
+    AString errorMessage;
+    for (int32_t batch = 0; batch <= numBatches; batch++) {
+        /*
+         * Item 0 writes the previous batch, when there is one, the other
+         * items encode the arrays of this batch
+         */
+        const int32_t writeItems = ((batch > 0) ? 1 : 0);
+        const int32_t encodeStart = batchStarts[std::min(batch, numBatches)];
+        const int32_t encodeCount = ((batch < numBatches) ? (batchStarts[batch + 1] - encodeStart) : 0);
+        const int32_t numItems = writeItems + encodeCount;
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int32_t item = 0; item < numItems; item++) {
+            try {
+                if (item < writeItems) {
+                    for (int32_t i = batchStarts[batch - 1]; i < batchStarts[batch]; i++) {
+                        dataArrays[i]->writeAsXML(*this->xmlFileOutputStream,
+                                                  this->externalFileOutputStream,
+                                                  this->encoding,
+                                                  this->compressionLevel,
+                                                  &encodedData[i]);
+                        std::vector<char>().swap(encodedData[i]);
+                    }
+                }
+                else {
+                    const int32_t arrayIndex = encodeStart + item - writeItems;
+                    dataArrays[arrayIndex]->encodeDataForWriting(this->encoding,
+                                                                 this->compressionLevel,
+                                                                 encodedData[arrayIndex]);
+                }
+            }
+            catch (const CaretException& e) {
+#pragma omp critical
+                {
+                    if (errorMessage.isEmpty()) errorMessage = e.whatString();
+                }
+            }
+            catch (const std::exception& e) {
+#pragma omp critical
+                {
+                    if (errorMessage.isEmpty()) errorMessage = e.what();
+                }
+            }
+        }
+        if ( ! errorMessage.isEmpty()) {
+            this->closeFiles();
+            throw GiftiException(errorMessage);
+        }
+        if (writeItems > 0) {
+            this->dataArraysWrittenCounter += (batchStarts[batch] - batchStarts[batch - 1]);
+        }
+    }
+}
+
+/**
+ * @return The ZLIB compression level used for GZipBase64Binary data,
+ * negative for the ZLIB default.
+ */
+int32_t
+GiftiFileWriter::getCompressionLevel() const
+{
+    return this->compressionLevel;
+}
+
+/**
+ * Set the ZLIB compression level used for GZipBase64Binary data.
+ *
+ * @param compressionLevel
+ *    Level from 0 (fastest) to 9 (smallest), negative for the ZLIB default.
+ */
+void
+GiftiFileWriter::setCompressionLevel(const int32_t compressionLevel)
+{
+    this->compressionLevel = compressionLevel;
+}
+
+/**
+ * @return Bound on the encoded data of the data arrays encoded at the
+ * same time by writeDataArrays().
+ */
+int64_t
+GiftiFileWriter::getMaximumEncodingBufferSize() const
+{
+    return this->maximumEncodingBufferSize;
+}
+
+/**
+ * Set the bound on the encoded data of the data arrays encoded at the
+ * same time by writeDataArrays().  A single data array larger than this
+ * is still encoded.
+ *
+ * @param size
+ *    Size in bytes.
+ */
+void
+GiftiFileWriter::setMaximumEncodingBufferSize(const int64_t size)
+{
+    this->maximumEncodingBufferSize = size;
+}
+
 /**
  * Finish writing the file. Closes any open files.
  * @throws GiftiException If file error or number of data arrays written
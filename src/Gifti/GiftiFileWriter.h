@@ -22,6 +22,7 @@
 /*LICENSE_END*/
 
 #include <fstream>
+#include <vector>
 
 #include "CaretObject.h"
 #include "GiftiFile.h"
@@ -47,12 +48,22 @@ namespace caret {
                    GiftiLabelTable* labelTable);
         void writeDataArray(GiftiDataArray* gda);
         
+        void writeDataArrays(const std::vector<GiftiDataArray*>& dataArrays);
+        
         void finish();
         
         long getMaximumExternalFileSize() const;
         
         void setMaximumExternalFileSize(const long size);
         
+        int32_t getCompressionLevel() const;
+        
+        void setCompressionLevel(const int32_t compressionLevel);
+        
+        int64_t getMaximumEncodingBufferSize() const;
+        
+        void setMaximumEncodingBufferSize(const int64_t size);
+        
     private:
         GiftiFileWriter(const GiftiFileWriter&);
 
@@ -96,6 +107,12 @@ namespace caret {
         /** Counts the number of data arrays that have been written. */
         int dataArraysWrittenCounter;
         
+        /** ZLIB compression level, negative for the ZLIB default. */
+        int32_t compressionLevel;
+        
+        /** Bounds the encoded data of a batch of data arrays encoded at the same time. */
+        int64_t maximumEncodingBufferSize;
+        
     };
     
 #ifdef __GIFTI_FILE_WRITER_DECLARE__
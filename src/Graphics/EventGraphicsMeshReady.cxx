@@ -0,0 +1,55 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __EVENT_GRAPHICS_MESH_READY_DECLARE__
+#include "EventGraphicsMeshReady.h"
+#undef __EVENT_GRAPHICS_MESH_READY_DECLARE__
+
+#include "CaretAssert.h"
+#include "EventTypeEnum.h"
+
+using namespace caret;
+
+
+    
+/**
+ * \class caret::EventGraphicsMeshReady 
+ * \brief Event issued when graphics data (such as a mesh or matrix
+ * tiles) built in a background thread is ready so that the graphics
+ * are updated to display it.
+ * \ingroup Graphics
+ */
+
+/**
+ * Constructor.
+ */
+EventGraphicsMeshReady::EventGraphicsMeshReady()
+: Event(EventTypeEnum::EVENT_GRAPHICS_MESH_READY)
+{
+    
+}
+
+/**
+ * Destructor.
+ */
+EventGraphicsMeshReady::~EventGraphicsMeshReady()
+{
+}
+
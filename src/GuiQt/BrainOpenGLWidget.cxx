@@ -276,7 +276,9 @@ BrainOpenGLWidget::initializeGL()
         }
         CaretAssert(textRenderer);
         
-        s_singletonOpenGL = new BrainOpenGLFixedPipeline(textRenderer);
+        BrainOpenGLFixedPipeline* fixedPipeline = new BrainOpenGLFixedPipeline(textRenderer);
+        fixedPipeline->setBackgroundGraphicsBuildEnabled(true);
+        s_singletonOpenGL = fixedPipeline;
     }
     
     s_singletonOpenGL->initializeOpenGL();
@@ -869,6 +869,8 @@ ChartTwoOverlayViewController::updateViewController(ChartTwoOverlay* chartOverla
      * Update matrix triangular view mode
      */
     m_matrixTriangularViewModeAction->setEnabled(false);
+    m_matrixTileMaximumAbsoluteAction->setEnabled(false);
+    m_matrixTileMaximumAbsoluteAction->setChecked(false);
     if (validOverlayAndFileFlag) {
         const ChartTwoMatrixTriangularViewingModeEnum::Enum viewMode = m_chartOverlay->getMatrixTriangularViewingMode();
         
@@ -880,7 +882,22 @@ ChartTwoOverlayViewController::updateViewController(ChartTwoOverlay* chartOverla
             }
         }
         
-        if (m_chartOverlay->isMatrixTriangularViewingModeSupported()) {
+        const bool triangularSupportedFlag = m_chartOverlay->isMatrixTriangularViewingModeSupported();
+        for (auto& mvmd : m_matrixViewMenuData) {
+            std::get<1>(mvmd)->setEnabled(triangularSupportedFlag);
+        }
+        
+        const ChartableTwoFileMatrixChart* matrixChart = getSelectedMatrixChart();
+        const bool tiledFlag = ((matrixChart != NULL)
+                                && matrixChart->isMatrixChartingTiled());
+        if (tiledFlag) {
+            m_matrixTileMaximumAbsoluteAction->setEnabled(true);
+            m_matrixTileMaximumAbsoluteAction->setChecked(matrixChart->getMatrixTileDownsampleMode()
+                                                          == CiftiMatrixTilePyramid::DownsampleMode::MAXIMUM_ABSOLUTE);
+        }
+        
+        if (triangularSupportedFlag
+            || tiledFlag) {
             m_matrixTriangularViewModeAction->setEnabled(true);
         }
     }
@@ -903,6 +920,33 @@ ChartTwoOverlayViewController::updateViewController(ChartTwoOverlay* chartOverla
     }
 }
 
+/**
+ * @return The matrix chart of the file selected in this overlay,
+ * NULL if the overlay is not a matrix chart.
+ */
+ChartableTwoFileMatrixChart*
+ChartTwoOverlayViewController::getSelectedMatrixChart()
+{
+    if (m_chartOverlay == NULL) {
+        return NULL;
+    }
+    if (m_chartOverlay->getChartTwoDataType() != ChartTwoDataTypeEnum::CHART_DATA_TYPE_MATRIX) {
+        return NULL;
+    }
+    
+    CaretMappableDataFile* mapFile = NULL;
+    ChartTwoOverlay::SelectedIndexType selectedIndexType = ChartTwoOverlay::SelectedIndexType::INVALID;
+    int32_t selectedIndex = -1;
+    m_chartOverlay->getSelectionData(mapFile,
+                                     selectedIndexType,
+                                     selectedIndex);
+    if (mapFile == NULL) {
+        return NULL;
+    }
+    
+    return mapFile->getChartingDelegate()->getMatrixCharting();
+}
+
 /**
  * Update the matrix triangular view mode button.
  *
@@ -1034,6 +1078,20 @@ ChartTwoOverlayViewController::createMatrixTriangularViewModeMenu(QWidget* paren
         m_matrixViewMenuData.push_back(std::make_tuple(viewMode, action, pixmap));
     }
     
+    menu->addSeparator();
+    
+    m_matrixTileMaximumAbsoluteAction = menu->addAction("Zoomed Out Show Largest Magnitude");
+    m_matrixTileMaximumAbsoluteAction->setCheckable(true);
+    WuQtUtilities::setWordWrappedToolTip(m_matrixTileMaximumAbsoluteAction,
+                                         "For large matrices (such as dense connectivity) drawn with "
+                                         "downsampled tiles, show the value with the largest magnitude "
+                                         "of the cells combined into a pixel so that isolated strong "
+                                         "values remain visible.  Otherwise the mean is shown.");
+    m_matrixTileMaximumAbsoluteAction->setObjectName(parentObjectName
+                                                     + "ZoomedOutShowLargestMagnitude");
+    WuQMacroManager::instance()->addMacroSupportToObject(m_matrixTileMaximumAbsoluteAction,
+                                                         "Show largest magnitude when zoomed out in " + descriptivePrefix);
+    
     return menu;
 }
 
@@ -1046,6 +1104,17 @@ ChartTwoOverlayViewController::createMatrixTriangularViewModeMenu(QWidget* paren
 void
 ChartTwoOverlayViewController::menuMatrixTriangularViewModeTriggered(QAction* action)
 {
+    if (action == m_matrixTileMaximumAbsoluteAction) {
+        ChartableTwoFileMatrixChart* matrixChart = getSelectedMatrixChart();
+        if (matrixChart != NULL) {
+            matrixChart->setMatrixTileDownsampleMode(m_matrixTileMaximumAbsoluteAction->isChecked()
+                                                     ? CiftiMatrixTilePyramid::DownsampleMode::MAXIMUM_ABSOLUTE
+                                                     : CiftiMatrixTilePyramid::DownsampleMode::MEAN);
+            this->updateGraphicsWindow();
+        }
+        return;
+    }
+    
     const QVariant itemData = action->data();
     CaretAssert(itemData.isValid());
     bool valid = false;
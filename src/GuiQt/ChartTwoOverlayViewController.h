@@ -38,6 +38,7 @@ class QToolButton;
 
 namespace caret {
     class ChartTwoOverlay;
+    class ChartableTwoFileMatrixChart;
     class MapYokingGroupComboBox;
     class WuQGridLayoutGroup;
 
@@ -146,6 +147,8 @@ namespace caret {
         
         void updateMatrixTriangularViewModeAction(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode);
         
+        ChartableTwoFileMatrixChart* getSelectedMatrixChart();
+        
         void updateAxisLocationAction(const ChartAxisLocationEnum::Enum axisLocation);
         
         const int32_t m_browserWindowIndex;
@@ -172,6 +175,8 @@ namespace caret {
         
         QAction* m_matrixTriangularViewModeAction;
         
+        QAction* m_matrixTileMaximumAbsoluteAction;
+        
         QAction* m_axisLocationAction;
         
         QToolButton* m_axisLocationToolButton;
@@ -70,6 +70,7 @@
 #include "EventBrowserTabReopenClosed.h"
 #include "EventBrowserWindowNew.h"
 #include "EventShowDataFileReadWarningsDialog.h"
+#include "EventGraphicsMeshReady.h"
 #include "EventGraphicsUpdateAllWindows.h"
 #include "EventGraphicsUpdateOneWindow.h"
 #include "EventHelpViewerDisplay.h"
@@ -342,6 +343,7 @@ GuiManager::initializeGuiManager()
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_ALERT_USER);
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_ANNOTATION_GET_DRAWN_IN_WINDOW);
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_BROWSER_WINDOW_NEW);
+    EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_GRAPHICS_MESH_READY);
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_GRAPHICS_UPDATE_ALL_WINDOWS);
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_GRAPHICS_UPDATE_ONE_WINDOW);
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_HELP_VIEWER_DISPLAY);
@@ -1434,6 +1436,16 @@ GuiManager::receiveEvent(Event* event)
                                preferredMaxHeight);
         bbw->resize(w, h);
     }
+    else if (event->getEventType() == EventTypeEnum::EVENT_GRAPHICS_MESH_READY) {
+        EventGraphicsMeshReady* meshEvent = dynamic_cast<EventGraphicsMeshReady*>(event);
+        CaretAssert(meshEvent);
+        meshEvent->setEventProcessed();
+        
+        /*
+         * A mesh built in the background is ready so redraw
+         */
+        EventManager::get()->sendEvent(EventGraphicsUpdateAllWindows().getPointer());
+    }
     else if ((event->getEventType() == EventTypeEnum::EVENT_GRAPHICS_UPDATE_ALL_WINDOWS)
              || (event->getEventType() == EventTypeEnum::EVENT_GRAPHICS_UPDATE_ONE_WINDOW)) {
         for (auto overlayEditor : m_overlaySettingsEditors) {
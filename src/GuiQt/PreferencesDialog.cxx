@@ -461,6 +461,26 @@ PreferencesDialog::createMiscellaneousWidget()
     QObject::connect(m_fileOpenFromOpSysTypeComboBox, &EnumComboBoxTemplate::itemActivated,
                      this, &PreferencesDialog::miscFileOpenFromOpSysTypeComboBoxItemActivated);
     
+    /*
+     * Matrix tile cache size
+     */
+    const QString matrixTileCacheTip("Downsampled tiles of large matrices (such as dense connectivity) are "
+                                     "kept in files in the user's cache directory so that the matrix "
+                                     "is displayed quickly when the file is loaded again.  When the files "
+                                     "exceed this size, those used least recently are removed.  When off, "
+                                     "only the most downsampled tiles are built and kept in memory.  "
+                                     "Applies to files loaded after the change.");
+    m_miscMatrixTileCacheSizeSpinBox = WuQFactory::newSpinBoxWithMinMaxStepSignalInt(0,
+                                                                                     1000,
+                                                                                     1,
+                                                                                     this,
+                                                                                     SLOT(miscMatrixTileCacheSizeChanged(int)));
+    m_miscMatrixTileCacheSizeSpinBox->setSpecialValueText("Off");
+    m_miscMatrixTileCacheSizeSpinBox->setSuffix(" GB");
+    WuQtUtilities::setWordWrappedToolTip(m_miscMatrixTileCacheSizeSpinBox,
+                                         matrixTileCacheTip);
+    m_allWidgets->add(m_miscMatrixTileCacheSizeSpinBox);
+    
     QGridLayout* gridLayout = new QGridLayout();
     addWidgetToLayout(gridLayout,
                       "Dynconn As Layer Default: ",
@@ -468,6 +488,9 @@ PreferencesDialog::createMiscellaneousWidget()
     addWidgetToLayout(gridLayout,
                       "Logging Level: ",
                       m_miscLoggingLevelComboBox);
+    addWidgetToLayout(gridLayout,
+                      "Matrix Tile Cache Size: ",
+                      m_miscMatrixTileCacheSizeSpinBox);
     addWidgetToLayout(gridLayout,
                       "Save/Manage View Files: ",
                       m_miscSpecFileDialogViewFilesTypeEnumComboBox->getWidget());
@@ -521,6 +544,8 @@ PreferencesDialog::updateMiscellaneousWidget(CaretPreferences* prefs)
 
     m_guiGesturesEnabledComboBox->setStatus(prefs->isGuiGesturesEnabled());
     
+    m_miscMatrixTileCacheSizeSpinBox->setValue(prefs->getMatrixTileCacheSizeGigabytes());
+    
     m_windowToolBarWidthModeComboBox->setSelectedItem<ToolBarWidthModeEnum, ToolBarWidthModeEnum::Enum>(prefs->getToolBarWidthMode());
     
     m_fileOpenFromOpSysTypeComboBox->setSelectedItem<FileOpenFromOpSysTypeEnum, FileOpenFromOpSysTypeEnum::Enum>(prefs->getFileOpenFromOpSysType());
@@ -1221,6 +1246,19 @@ PreferencesDialog::miscWindowToolBarWidthModeComboBoxItemActivated()
     EventManager::get()->sendEvent(EventUserInterfaceUpdate().getPointer());
 }
 
+/**
+ * Gets called when the matrix tile cache size is changed.
+ *
+ * @param value
+ *     New size in gigabytes, zero is off.
+ */
+void
+PreferencesDialog::miscMatrixTileCacheSizeChanged(int value)
+{
+    CaretPreferences* prefs = SessionManager::get()->getCaretPreferences();
+    prefs->setMatrixTileCacheSizeGigabytes(value);
+}
+
 /**
  * Gets called when file open from O/S type is changed
  */
@@ -63,6 +63,7 @@ namespace caret {
         void miscDynamicConnectivityComboBoxChanged(bool value);
         void miscWindowToolBarWidthModeComboBoxItemActivated();
         void miscFileOpenFromOpSysTypeComboBoxItemActivated();
+        void miscMatrixTileCacheSizeChanged(int value);
         void openGLDrawingMethodEnumComboBoxItemActivated();
         void openGLImageCaptureMethodEnumComboBoxItemActivated();
         
@@ -145,6 +146,7 @@ namespace caret {
         WuQTrueFalseComboBox* m_guiGesturesEnabledComboBox;
         EnumComboBoxTemplate* m_windowToolBarWidthModeComboBox;
         EnumComboBoxTemplate* m_fileOpenFromOpSysTypeComboBox;
+        QSpinBox* m_miscMatrixTileCacheSizeSpinBox;
         
         EnumComboBoxTemplate* m_openGLDrawingMethodEnumComboBox;
         EnumComboBoxTemplate* m_openGLImageCaptureMethodEnumComboBox;
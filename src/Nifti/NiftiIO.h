@@ -65,15 +65,25 @@ namespace caret
         //NOTE: you need to provide storage for all components within the range, if getNumComponents() == 3 and fullDims == 0, you need 3 elements allocated
         template<typename T>
         void readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead = false);
+        //same as readData, but reads rangeLength consecutive indices of the first selected dimension, starting at indexSelect[0], with a single read
+        template<typename T>
+        void readDataRange(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& rangeLength, const bool& tolerateShortRead = false);
         template<typename T>
         void writeData(const T* dataIn, const int& fullDims, const std::vector<int64_t>& indexSelect);
     };
     
     template<typename T>
     void NiftiIO::readData(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const bool& tolerateShortRead)
+    {
+        readDataRange(dataOut, fullDims, indexSelect, 1, tolerateShortRead);
+    }
+    
+    template<typename T>
+    void NiftiIO::readDataRange(T* dataOut, const int& fullDims, const std::vector<int64_t>& indexSelect, const int64_t& rangeLength, const bool& tolerateShortRead)
     {
         CaretAssert(fullDims >= 0 && fullDims <= (int)m_dims.size());
         CaretAssert((size_t)fullDims + indexSelect.size() == m_dims.size());//could be >=, but should catch more stupid mistakes as ==
+        CaretAssert(rangeLength >= 1 && (rangeLength == 1 || !indexSelect.empty()));
         int64_t numElems = getNumComponents();//for now, calculate read size on the fly, as the read call will be the slowest part
         int curDim;
         for (curDim = 0; curDim < fullDims; ++curDim)
@@ -87,6 +97,8 @@ namespace caret
             numSkip += indexSelect[curDim - fullDims] * numDimSkip;
             numDimSkip *= m_dims[curDim];
         }
+        CaretAssert(indexSelect.empty() || indexSelect[0] + rangeLength <= m_dims[fullDims]);
+        numElems *= rangeLength;//consecutive indices of the first selected dimension are adjacent on disk
         CaretMutexLocker locked(&m_mutex);//protect starting with resizing until we are done converting, because we use an internal variable for scratch space
         //we can't guarantee that the output memory is enough to use as scratch space, as we might be doing a narrowing conversion
         //we are doing FILE ACCESS, so cpu performance isn't really something to worry about
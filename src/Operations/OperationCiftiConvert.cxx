@@ -23,13 +23,16 @@
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
 #include "CiftiXML.h"
 #include "FloatMatrix.h"
 #include "GiftiFile.h"
+#include "NumericTextFile.h"
 #include "VolumeFile.h"
 
+#include <algorithm>
 #include <fstream>
 #include <cmath>
 #include <string>
@@ -37,7 +40,6 @@
 #include <vector>
 
 #include <QFile>
-#include <QStringList>
 
 using namespace caret;
 using namespace std;
@@ -135,18 +137,18 @@ namespace
     
     bool haveWarned = false;
     
-    float toFloat(const AString& input)
+    float toFloat(const double converted, const char* textStart, const char* textEnd)
     {
-        bool ok = false;
-        double converted = input.toDouble(&ok);
-        if (!ok) throw OperationException("failed to convert text to number: '" + input + "'");
         float ret = float(converted);//this will turn some non-inf values into +/- inf, so let's fix that
         if (!std::isinf(converted) && (abs(converted) > numeric_limits<float>::max() || abs(converted) < numeric_limits<float>::denorm_min()))
         {
-            if (!haveWarned)
+#pragma omp critical
             {
-                CaretLogWarning("input number(s) changed to fit range of float32, first instance: '" + input + "'");
-                haveWarned = true;
+                if (!haveWarned)
+                {
+                    CaretLogWarning("input number(s) changed to fit range of float32, first instance: '" + AString::fromLocal8Bit(textStart, textEnd - textStart) + "'");
+                    haveWarned = true;
+                }
             }
             if (std::isinf(ret))
             {
@@ -160,6 +162,49 @@ namespace
         }
         return ret;
     }
+    
+    //split on the delimiter (or any whitespace, if empty), skipping empty fields, and convert each field
+    //returns the number of fields, or -1 and sets errorOut if a field isn't a number
+    int64_t parseTextRow(const char* pos, const char* end, const string& delim, float* rowOut, const int64_t& maxFields, AString& errorOut)
+    {
+        int64_t numFields = 0;
+        while (pos < end)
+        {
+            const char* fieldEnd;
+            if (delim.empty())
+            {
+                while (pos < end && NumericTextFile::isSpace(*pos)) ++pos;
+                if (pos == end) break;
+                fieldEnd = pos;
+                while (fieldEnd < end && !NumericTextFile::isSpace(*fieldEnd)) ++fieldEnd;
+            } else {
+                fieldEnd = search(pos, end, delim.begin(), delim.end());
+                if (fieldEnd == pos)
+                {
+                    pos += delim.size();
+                    continue;
+                }
+            }
+            if (numFields < maxFields)
+            {
+                const char* numStart = pos, *numEnd = fieldEnd;//surrounding whitespace is allowed, as with QString::toDouble
+                while (numStart < numEnd && NumericTextFile::isSpace(*numStart)) ++numStart;
+                while (numEnd > numStart && NumericTextFile::isSpace(numEnd[-1])) --numEnd;
+                const char* parsePos = numStart;
+                double converted;
+                if (!NumericTextFile::parseDouble(parsePos, numEnd, converted) || parsePos != numEnd)
+                {
+                    errorOut = "failed to convert text to number: '" + AString::fromLocal8Bit(pos, fieldEnd - pos) + "'";
+                    return -1;
+                }
+                rowOut[numFields] = toFloat(converted, pos, fieldEnd);
+            }
+            ++numFields;
+            pos = fieldEnd;
+            if (!delim.empty() && pos < end) pos += delim.size();
+        }
+        return numFields;
+    }
 }
 
 void OperationCiftiConvert::useParameters(OperationParameters* myParams, ProgressObject* myProgObj)
@@ -470,17 +515,26 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
         if (myXML.getNumberOfDimensions() != 2) throw OperationException("conversion only supported for 2D cifti");
         if (myXML.getDimensionLength(0) < 1) throw OperationException("input cifti has zero-length rows");
         vector<int64_t> dims = myXML.getDimensions();
-        vector<float> scratchRow(dims[0]);
+        const int64_t rowLength = dims[0], numRows = dims[1];
+        const string delimBytes = delim.toStdString();
         fstream textOut(textOutName.toLocal8Bit().constData(), fstream::out | fstream::trunc | fstream::binary);//write the same file, no newline translation, regardless of OS
-        for (int64_t i = 0; i < dims[1]; ++i)
+        if (!textOut.good()) throw OperationException("failed to open output text file '" + textOutName + "'");
+        const int64_t rowsPerBlock = max(int64_t(1), min(numRows, int64_t(1 << 22) / rowLength));//format about 4 million values at a time
+        vector<float> blockData(rowsPerBlock * rowLength);
+        vector<string> rowText;
+        for (int64_t blockStart = 0; blockStart < numRows; blockStart += rowsPerBlock)
         {
-            ciftiIn->getRow(scratchRow.data(), i);
-            textOut << AString::number(scratchRow[0]);
-            for (int64_t j = 1; j < dims[0]; ++j)
+            const int64_t blockRows = min(rowsPerBlock, numRows - blockStart);
+            for (int64_t i = 0; i < blockRows; ++i)
+            {
+                ciftiIn->getRow(blockData.data() + i * rowLength, blockStart + i);
+            }
+            NumericTextFile::formatRows(blockData.data(), blockRows, rowLength, delimBytes, rowText);
+            for (int64_t i = 0; i < blockRows; ++i)
             {
-                textOut << delim << AString::number(scratchRow[j]);
+                textOut.write(rowText[i].data(), rowText[i].size());
             }
-            textOut << "\n";
+            if (!textOut.good()) throw OperationException("failed to write to output text file '" + textOutName + "'");
         }
     }
     if (fromText->m_present)
@@ -498,18 +552,16 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
         CiftiXML outXML = ciftiTemplate->getCiftiXML();
         if (outXML.getNumberOfDimensions() != 2) throw OperationException("conversion only supported for 2D cifti");
         int64_t numRows = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        fstream textIn(textInName.toLocal8Bit().constData(), fstream::in);//do newline translation on input
-        string templine;//need to extract a row from the file first to set the row length
-        if (!getline(textIn, templine)) throw OperationException("failed to read from input text file");
-        QStringList entries;
-        if (delim.isEmpty())
-        {
-            entries = QString(templine.c_str()).split(QRegExp("\\s+"), QString::SkipEmptyParts);
-        } else {
-            entries = QString(templine.c_str()).split(delim, QString::SkipEmptyParts);
-        }
+        const string delimBytes = delim.toStdString();
+        NumericTextFile textIn;
+        textIn.open(textInName);
+        vector<NumericTextFile::Range> lines = textIn.findLines();//handles windows newlines
+        if (lines.empty()) throw OperationException("failed to read from input text file");
+        const char* textData = textIn.getData();
+        AString parseError;
+        const int64_t textRowLength = parseTextRow(textData + lines[0].m_start, textData + lines[0].m_end, delimBytes, NULL, 0, parseError);
+        if (textRowLength < 0) throw OperationException(parseError);
         if (numRows < 1) throw OperationException("template cifti file has no data");//this probably throws an exception in CiftiFile, but double check
-        int textRowLength = entries.size();
         OptionalParameter* ftresetTimeOpt = fromText->getOptionalParameter(5);
         if (ftresetTimeOpt->m_present)
         {
@@ -536,27 +588,25 @@ void OperationCiftiConvert::useParameters(OperationParameters* myParams, Progres
                                      ", cifti XML says " + AString::number(outXML.getDimensionLength(CiftiXML::ALONG_ROW)) + ")");
         }
         ciftiOut->setCiftiXML(outXML);
-        vector<float> temprow(textRowLength);
-        for (int i = 0; i < textRowLength; ++i)
+        if ((int64_t)lines.size() < numRows) throw OperationException("failed to read from input text file (not enough rows)");
+        const int64_t rowsPerBlock = max(int64_t(1), min(numRows, int64_t(1 << 22) / max(textRowLength, int64_t(1))));//parse about 4 million values at a time
+        vector<float> blockData(rowsPerBlock * textRowLength);
+        for (int64_t blockStart = 0; blockStart < numRows; blockStart += rowsPerBlock)
         {
-            temprow[i] = toFloat(entries[i]);
-        }
-        ciftiOut->setRow(temprow.data(), 0);
-        for (int64_t j = 1; j < numRows; ++j)
-        {
-            if (!getline(textIn, templine)) throw OperationException("failed to read from input text file (not enough rows)");
-            if (delim.isEmpty())
+            const int64_t blockRows = min(rowsPerBlock, numRows - blockStart);
+            vector<AString> rowErrors(blockRows);
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int64_t i = 0; i < blockRows; ++i)
             {
-                entries = QString(templine.c_str()).split(QRegExp("\\s+"), QString::SkipEmptyParts);
-            } else {
-                entries = QString(templine.c_str()).split(delim, QString::SkipEmptyParts);
+                const NumericTextFile::Range& myLine = lines[blockStart + i];
+                int64_t numFields = parseTextRow(textData + myLine.m_start, textData + myLine.m_end, delimBytes, blockData.data() + i * textRowLength, textRowLength, rowErrors[i]);
+                if (numFields >= 0 && numFields != textRowLength) rowErrors[i] = "text file has inconsistent line length";
             }
-            if (entries.size() != textRowLength) throw OperationException("text file has inconsistent line length");
-            for (int i = 0; i < textRowLength; ++i)
+            for (int64_t i = 0; i < blockRows; ++i)
             {
-                temprow[i] = toFloat(entries[i]);
+                if (!rowErrors[i].isEmpty()) throw OperationException(rowErrors[i]);
+                ciftiOut->setRow(blockData.data() + i * textRowLength, blockStart + i);
             }
-            ciftiOut->setRow(temprow.data(), j);
         }
     }
 }
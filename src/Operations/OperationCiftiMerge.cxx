@@ -24,6 +24,7 @@
 #include "CaretAssert.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiStreamingMerger.h"
 
 #include <algorithm>
 
@@ -86,6 +87,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             throw OperationException("row mapping type must be series, scalars, or labels");
     }
+    vector<vector<int64_t> > inputColumns(numInputs);//the plan: which columns of each input, in order, make up the output rows
     int64_t numOutColumns = 0;//output row length
     for (int i = 0; i < numInputs; ++i)
     {
@@ -101,6 +103,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         if (thisXML.getMappingType(CiftiXML::ALONG_ROW) != baseRowMapping.getType()) throw OperationException("file '" + ciftiIn->getFileName() + "' has different mapping type along rows");
         const vector<ParameterComponent*>& columnOpts = myInputs[i]->getRepeatableParameterInstances(2);
         int numColumnOpts = (int)columnOpts.size();
+        vector<int64_t>& thisColumns = inputColumns[i];
         if (numColumnOpts > 0)
         {
             for (int j = 0; j < numColumnOpts; ++j)
@@ -110,17 +113,33 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
                 OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);
                 if (upToOpt->m_present)
                 {
-                    int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
+                    int64_t finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
                     if (finalColumn < 0 || finalColumn >= thisDims[0]) throw OperationException("ending column '" + columnOpts[j]->getString(1) + "' not valid in file '" + ciftiIn->getFileName() + "'");
                     if (finalColumn < initialColumn) throw OperationException("ending column occurs before starting column in file '" + ciftiIn->getFileName() + "'");
-                    numOutColumns += finalColumn - initialColumn + 1;//inclusive - we don't need to worry about reversing for counting, though
+                    bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                    if (reverse)
+                    {
+                        for (int64_t c = finalColumn; c >= initialColumn; --c)
+                        {
+                            thisColumns.push_back(c);
+                        }
+                    } else {
+                        for (int64_t c = initialColumn; c <= finalColumn; ++c)
+                        {
+                            thisColumns.push_back(c);
+                        }
+                    }
                 } else {
-                    numOutColumns += 1;
+                    thisColumns.push_back(initialColumn);
                 }
             }
         } else {
-            numOutColumns += thisDims[0];
+            for (int64_t c = 0; c < thisDims[0]; ++c)
+            {
+                thisColumns.push_back(c);
+            }
         }
+        numOutColumns += (int64_t)thisColumns.size();
         if (i != 0)//don't mess with the first file, we use its mapping for the output file
         {
             ciftiList[i].forgetMapping(CiftiXML::ALONG_COLUMN);//HACK: release the memory being used to store the dense or parcel mapping, to deal with thousands of inputs
@@ -149,106 +168,36 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             CaretAssert(false);
     }
-    int64_t curCol = 0, scratchRowLength = 0;
-    for (int i = 0; i < numInputs; ++i)
-    {
-        const CiftiFile* ciftiIn = &(ciftiList[i]);
-        vector<int64_t> thisDims = ciftiIn->getDimensions();
-        const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-        const vector<ParameterComponent*>& columnOpts = myInputs[i]->getRepeatableParameterInstances(2);
-        int numColumnOpts = (int)columnOpts.size();
-        if (numColumnOpts > 0)
+    int64_t curCol = 0;
+    CiftiXML outXML;
+    outXML.setNumberOfDimensions(2);
+    outXML.setMap(CiftiXML::ALONG_COLUMN, baseColMapping);
+    if (doLoop)
+    {//map names, palettes or label tables, and metadata follow their columns
+        for (int i = 0; i < numInputs; ++i)
         {
-            scratchRowLength = max(scratchRowLength, thisXML.getDimensionLength(CiftiXML::ALONG_ROW));//if we use the entire row, we don't need a separate scratch row for it
-            if (doLoop)
+            const CiftiXML& thisXML = ciftiList[i].getCiftiXML();
+            const vector<int64_t>& thisColumns = inputColumns[i];
+            for (int64_t j = 0; j < (int64_t)thisColumns.size(); ++j)
             {
-                for (int j = 0; j < numColumnOpts; ++j)
+                int64_t c = thisColumns[j];
+                if (isLabel)
                 {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
-                    {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
-                        {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                if (isLabel)
-                                {
-                                    const CiftiLabelsMap& thisLabelMap = thisXML.getLabelsMap(CiftiXML::ALONG_ROW);
-                                    outLabelMap.setMapName(curCol, thisLabelMap.getMapName(c));
-                                    *(outLabelMap.getMapLabelTable(curCol)) = *(thisLabelMap.getMapLabelTable(c));
-                                    *(outLabelMap.getMapMetadata(curCol)) = *(thisLabelMap.getMapMetadata(c));
-                                } else {
-                                    const CiftiScalarsMap& thisScalarMap = thisXML.getScalarsMap(CiftiXML::ALONG_ROW);
-                                    outScalarMap.setMapName(curCol, thisScalarMap.getMapName(c));
-                                    *(outScalarMap.getMapPalette(curCol)) = *(thisScalarMap.getMapPalette(c));
-                                    *(outScalarMap.getMapMetadata(curCol)) = *(thisScalarMap.getMapMetadata(c));
-                                }
-                                ++curCol;
-                            }
-                        } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
-                            {
-                                if (isLabel)
-                                {
-                                    const CiftiLabelsMap& thisLabelMap = thisXML.getLabelsMap(CiftiXML::ALONG_ROW);
-                                    outLabelMap.setMapName(curCol, thisLabelMap.getMapName(c));
-                                    *(outLabelMap.getMapLabelTable(curCol)) = *(thisLabelMap.getMapLabelTable(c));
-                                    *(outLabelMap.getMapMetadata(curCol)) = *(thisLabelMap.getMapMetadata(c));
-                                } else {
-                                    const CiftiScalarsMap& thisScalarMap = thisXML.getScalarsMap(CiftiXML::ALONG_ROW);
-                                    outScalarMap.setMapName(curCol, thisScalarMap.getMapName(c));
-                                    *(outScalarMap.getMapPalette(curCol)) = *(thisScalarMap.getMapPalette(c));
-                                    *(outScalarMap.getMapMetadata(curCol)) = *(thisScalarMap.getMapMetadata(c));
-                                }
-                                ++curCol;
-                            }
-                        }
-                    } else {
-                        if (isLabel)
-                        {
-                            const CiftiLabelsMap& thisLabelMap = thisXML.getLabelsMap(CiftiXML::ALONG_ROW);
-                            outLabelMap.setMapName(curCol, thisLabelMap.getMapName(initialColumn));
-                            *(outLabelMap.getMapLabelTable(curCol)) = *(thisLabelMap.getMapLabelTable(initialColumn));
-                            *(outLabelMap.getMapMetadata(curCol)) = *(thisLabelMap.getMapMetadata(initialColumn));
-                        } else {
-                            const CiftiScalarsMap& thisScalarMap = thisXML.getScalarsMap(CiftiXML::ALONG_ROW);
-                            outScalarMap.setMapName(curCol, thisScalarMap.getMapName(initialColumn));
-                            *(outScalarMap.getMapPalette(curCol)) = *(thisScalarMap.getMapPalette(initialColumn));
-                            *(outScalarMap.getMapMetadata(curCol)) = *(thisScalarMap.getMapMetadata(initialColumn));
-                        }
-                        ++curCol;
-                    }
-                }
-            }
-        } else {
-            if (doLoop)
-            {
-                for (int64_t j = 0; j < thisDims[0]; ++j)
-                {
-                    if (isLabel)
-                    {
-                        const CiftiLabelsMap& thisLabelMap = thisXML.getLabelsMap(CiftiXML::ALONG_ROW);
-                        outLabelMap.setMapName(curCol, thisLabelMap.getMapName(j));
-                        *(outLabelMap.getMapLabelTable(curCol)) = *(thisLabelMap.getMapLabelTable(j));
-                        *(outLabelMap.getMapMetadata(curCol)) = *(thisLabelMap.getMapMetadata(j));
-                    } else {
-                        const CiftiScalarsMap& thisScalarMap = thisXML.getScalarsMap(CiftiXML::ALONG_ROW);
-                        outScalarMap.setMapName(curCol, thisScalarMap.getMapName(j));
-                        *(outScalarMap.getMapPalette(curCol)) = *(thisScalarMap.getMapPalette(j));
-                        *(outScalarMap.getMapMetadata(curCol)) = *(thisScalarMap.getMapMetadata(j));
-                    }
-                    ++curCol;
+                    const CiftiLabelsMap& thisLabelMap = thisXML.getLabelsMap(CiftiXML::ALONG_ROW);
+                    outLabelMap.setMapName(curCol, thisLabelMap.getMapName(c));
+                    *(outLabelMap.getMapLabelTable(curCol)) = *(thisLabelMap.getMapLabelTable(c));
+                    *(outLabelMap.getMapMetadata(curCol)) = *(thisLabelMap.getMapMetadata(c));
+                } else {
+                    const CiftiScalarsMap& thisScalarMap = thisXML.getScalarsMap(CiftiXML::ALONG_ROW);
+                    outScalarMap.setMapName(curCol, thisScalarMap.getMapName(c));
+                    *(outScalarMap.getMapPalette(curCol)) = *(thisScalarMap.getMapPalette(c));
+                    *(outScalarMap.getMapMetadata(curCol)) = *(thisScalarMap.getMapMetadata(c));
                 }
+                ++curCol;
             }
         }
+        CaretAssert(curCol == numOutColumns);
     }
-    CaretAssert(!doLoop || curCol == numOutColumns);
-    CiftiXML outXML;
-    outXML.setNumberOfDimensions(2);
-    outXML.setMap(CiftiXML::ALONG_COLUMN, baseColMapping);
     switch (baseRowMapping.getType())
     {
         case CiftiMappingType::LABELS:
@@ -264,54 +213,13 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
             CaretAssert(false);
     }
     ciftiOut->setCiftiXML(outXML);
-    int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    CiftiStreamingMerger myMerger(ciftiOut);//reads blocks of rows from all inputs concurrently, writes them in order
+    curCol = 0;
+    for (int i = 0; i < numInputs; ++i)
     {
-        curCol = 0;
-        for (int i = 0; i < numInputs; ++i)
-        {
-            const CiftiFile* ciftiIn = &(ciftiList[i]);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-            const vector<ParameterComponent*>& columnOpts = myInputs[i]->getRepeatableParameterInstances(2);
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
-            {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
-                {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
-                    {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
-                        {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        }
-                    } else {
-                        outRow[curCol] = scratchRow[initialColumn];
-                        ++curCol;
-                    }
-                }
-            } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
-            }
-        }
-        CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
+        myMerger.addSource(new CiftiStreamingMerger::CiftiColumnSource(&(ciftiList[i]), inputColumns[i], curCol));
+        curCol += (int64_t)inputColumns[i].size();
     }
+    CaretAssert(curCol == numOutColumns);
+    myMerger.run();
 }
@@ -21,6 +21,7 @@
 #include "OperationMetricMerge.h"
 #include "OperationException.h"
 #include "CaretLogger.h"
+#include "GiftiMetaData.h"
 #include "MetricFile.h"
 #include "PaletteColorMapping.h"
 
@@ -58,7 +59,9 @@ OperationParameters* OperationMetricMerge::getParameters()
         "The input metric files must have the same number of vertices and same structure.\n\n" +
         "Example: wb_command -metric-merge out.func.gii -metric first.func.gii -column 1 -metric second.func.gii\n\n" +
         "This example would take the first column from first.func.gii, followed by all columns from second.func.gii, " +
-        "and write these columns to out.func.gii."
+        "and write these columns to out.func.gii.\n\n" +
+        "Unlike -cifti-merge, the inputs are not streamed: all input metric files are read into memory before the output is created, " +
+        "so the memory needed is about the size of the inputs plus the size of the output."
     );
     return ret;
 }
@@ -71,9 +74,9 @@ void OperationMetricMerge::useParameters(OperationParameters* myParams, Progress
     int numInputs = (int)myInputs.size();
     if (numInputs == 0) throw OperationException("no inputs specified");
     const MetricFile* firstMetric = myInputs[0]->getMetric(1);
-    int numOutColumns = 0;
     int numNodes = firstMetric->getNumberOfNodes();
     StructureEnum::Enum myStruct = firstMetric->getStructure();
+    vector<pair<const MetricFile*, int> > columnPlan;//input and column for each output column, so the output is allocated once and filled directly from the inputs
     for (int i = 0; i < numInputs; ++i)
     {
         const MetricFile* inputMetric = myInputs[i]->getMetric(1);
@@ -94,68 +97,41 @@ void OperationMetricMerge::useParameters(OperationParameters* myParams, Progress
                     if (finalColumn < 0) throw OperationException("ending column '" + upToOpt->getString(1) + "' not found in file '" + inputMetric->getFileName() + "'");
                     if (finalColumn < initialColumn) throw OperationException("ending column '" + upToOpt->getString(1) + "' occurs before starting column '"
                                                                             + columnOpts[j]->getString(1) + "' in file '" + inputMetric->getFileName() + "'");
-                    numOutColumns += finalColumn - initialColumn + 1;//inclusive - we don't need to worry about reversing for counting, though
-                } else {
-                    numOutColumns += 1;
-                }
-            }
-        } else {
-            numOutColumns += inputMetric->getNumberOfColumns();
-        }
-    }
-    myMetricOut->setNumberOfNodesAndColumns(numNodes, numOutColumns);
-    myMetricOut->setStructure(myStruct);
-    int curColumn = 0;
-    for (int i = 0; i < numInputs; ++i)
-    {
-        const MetricFile* inputMetric = myInputs[i]->getMetric(1);
-        const vector<ParameterComponent*>& columnOpts = myInputs[i]->getRepeatableParameterInstances(2);
-        int numColumnOpts = (int)columnOpts.size();
-        if (numColumnOpts > 0)
-        {
-            for (int j = 0; j < numColumnOpts; ++j)
-            {
-                int initialColumn = inputMetric->getMapIndexFromNameOrNumber(columnOpts[j]->getString(1));
-                OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);
-                if (upToOpt->m_present)
-                {
-                    int finalColumn = inputMetric->getMapIndexFromNameOrNumber(upToOpt->getString(1));
                     bool reverse = upToOpt->getOptionalParameter(2)->m_present;
                     if (reverse)
                     {
                         for (int c = finalColumn; c >= initialColumn; --c)
                         {
-                            myMetricOut->setValuesForColumn(curColumn, inputMetric->getValuePointerForColumn(c));
-                            myMetricOut->setColumnName(curColumn, inputMetric->getColumnName(c));
-                            *(myMetricOut->getMapPaletteColorMapping(curColumn)) = *(inputMetric->getMapPaletteColorMapping(c));
-                            ++curColumn;
+                            columnPlan.push_back(make_pair(inputMetric, c));
                         }
                     } else {
                         for (int c = initialColumn; c <= finalColumn; ++c)
                         {
-                            myMetricOut->setValuesForColumn(curColumn, inputMetric->getValuePointerForColumn(c));
-                            myMetricOut->setColumnName(curColumn, inputMetric->getColumnName(c));
-                            *(myMetricOut->getMapPaletteColorMapping(curColumn)) = *(inputMetric->getMapPaletteColorMapping(c));
-                            ++curColumn;
+                            columnPlan.push_back(make_pair(inputMetric, c));
                         }
                     }
                 } else {
-                    myMetricOut->setValuesForColumn(curColumn, inputMetric->getValuePointerForColumn(initialColumn));
-                    myMetricOut->setColumnName(curColumn, inputMetric->getColumnName(initialColumn));
-                    *(myMetricOut->getMapPaletteColorMapping(curColumn)) = *(inputMetric->getMapPaletteColorMapping(initialColumn));
-                    ++curColumn;
+                    columnPlan.push_back(make_pair(inputMetric, initialColumn));
                 }
             }
         } else {
             int numColumns = inputMetric->getNumberOfColumns();
-            for (int j = 0; j < numColumns; ++j)
+            for (int c = 0; c < numColumns; ++c)
             {
-                myMetricOut->setValuesForColumn(curColumn, inputMetric->getValuePointerForColumn(j));
-                myMetricOut->setColumnName(curColumn, inputMetric->getColumnName(j));
-                *(myMetricOut->getMapPaletteColorMapping(curColumn)) = *(inputMetric->getMapPaletteColorMapping(j));
-                ++curColumn;
+                columnPlan.push_back(make_pair(inputMetric, c));
             }
         }
     }
-    CaretAssert(curColumn == numOutColumns);
+    int numOutColumns = (int)columnPlan.size();
+    myMetricOut->setNumberOfNodesAndColumns(numNodes, numOutColumns);
+    myMetricOut->setStructure(myStruct);
+    for (int i = 0; i < numOutColumns; ++i)
+    {
+        const MetricFile* inputMetric = columnPlan[i].first;
+        int c = columnPlan[i].second;
+        myMetricOut->setValuesForColumn(i, inputMetric->getValuePointerForColumn(c));
+        *(myMetricOut->getMapMetaData(i)) = *(inputMetric->getMapMetaData(c));
+        myMetricOut->setColumnName(i, inputMetric->getColumnName(c));
+        *(myMetricOut->getMapPaletteColorMapping(i)) = *(inputMetric->getMapPaletteColorMapping(c));
+    }
 }
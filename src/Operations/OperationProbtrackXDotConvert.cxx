@@ -21,8 +21,10 @@
 #include "OperationProbtrackXDotConvert.h"
 #include "OperationException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CiftiFile.h"
 #include "MetricFile.h"
+#include "NumericTextFile.h"
 #include "StructureEnum.h"
 #include "VolumeFile.h"
 
@@ -34,16 +36,114 @@
 using namespace caret;
 using namespace std;
 
-//specifically for the purpose of sorting the input .dot file to the order required, in case it isn't initially ordered correctly
-struct SparseValue
+namespace
 {
-    int32_t index[2];//save some memory
-    float value;
-    bool operator<(const SparseValue& rhs) const
+    //one line of the .dot file, after -transpose is applied
+    struct SparseValue
     {
-        return (index[1] < rhs.index[1]);//NOTE: this specifically avoids minor ordering by the other index to make the sort faster (less swapping because more "equals" cases)
+        int32_t index[2];//save some memory
+        float value;
+    };
+    
+    //a value after grouping by row (index[1]), the row is implied by its position
+    struct RowElement
+    {
+        int32_t column;
+        float value;
+    };
+    
+    //a line-aligned piece of the .dot file, parsed independently of the others
+    struct DotPiece
+    {
+        vector<SparseValue> m_values;
+        vector<int64_t> m_rowCounts;//values per row, then turned into where this piece's next value of each row goes
+        int64_t m_numLines, m_numZeros, m_badLine;//m_badLine is 1-based within the piece, 0 if no line failed to parse
+        bool m_hasData, m_afterZero;
+        AString m_error;
+        DotPiece() : m_numLines(0), m_numZeros(0), m_badLine(0), m_hasData(false), m_afterZero(false) { }
+    };
+    
+    void skipBlanks(const char*& pos, const char* end)
+    {
+        while (pos < end && *pos != '\n' && NumericTextFile::isSpace(*pos)) ++pos;
+    }
+    
+    bool parseDotLine(const char*& pos, const char* end, int64_t& firstOut, int64_t& secondOut, double& valueOut)
+    {
+        if (!NumericTextFile::parseInt(pos, end, firstOut) || pos == end || !NumericTextFile::isSpace(*pos)) return false;
+        skipBlanks(pos, end);
+        if (!NumericTextFile::parseInt(pos, end, secondOut) || pos == end || !NumericTextFile::isSpace(*pos)) return false;
+        skipBlanks(pos, end);
+        if (!NumericTextFile::parseDouble(pos, end, valueOut)) return false;
+        skipBlanks(pos, end);
+        return pos == end || *pos == '\n';
     }
-};
+    
+    void parseDotPiece(const char* pos, const char* end, const bool transpose, const bool halfMatrix, const int32_t rowSize, const int32_t colSize, DotPiece& piece)
+    {
+        piece.m_rowCounts.resize(colSize, 0);
+        while (pos < end)
+        {
+            ++piece.m_numLines;
+            skipBlanks(pos, end);
+            if (pos == end || *pos == '\n')
+            {
+                if (pos < end) ++pos;
+                continue;
+            }
+            int64_t first, second;
+            double value;
+            if (!parseDotLine(pos, end, first, second, value))
+            {
+                piece.m_badLine = piece.m_numLines;
+                return;
+            }
+            if (pos < end) ++pos;//past the newline
+            int64_t index[2];
+            if (transpose)
+            {
+                index[1] = first;
+                index[0] = second;
+            } else {
+                index[0] = first;
+                index[1] = second;
+            }
+            SparseValue tempValue;
+            tempValue.value = float(value);
+            if (tempValue.value == 0.0f)
+            {
+                if (index[0] != rowSize || index[1] != colSize)
+                {
+                    piece.m_error = "dimensions line in .dot file doesn't agree with provided row/column spaces";
+                    return;
+                }
+                ++piece.m_numZeros;//ignore, we expect one line (last in file) to have this
+                continue;
+            }
+            if (index[0] < 1 || index[0] > rowSize ||
+                index[1] < 1 || index[1] > colSize)
+            {
+                piece.m_error = "found invalid index pair in dot file: " + AString::number(index[0]) + ", " + AString::number(index[1]) +
+                    (transpose ? ", perhaps you need to remove -transpose" : ", perhaps you need to use -transpose");
+                return;
+            }
+            if (piece.m_numZeros != 0) piece.m_afterZero = true;
+            piece.m_hasData = true;
+            tempValue.index[0] = int32_t(index[0] - 1);//fix for 1-indexing
+            tempValue.index[1] = int32_t(index[1] - 1);
+            piece.m_values.push_back(tempValue);
+            ++piece.m_rowCounts[tempValue.index[1]];
+            if (halfMatrix && tempValue.index[0] != tempValue.index[1])
+            {
+                int32_t tempIndex = tempValue.index[0];
+                tempValue.index[0] = tempValue.index[1];
+                tempValue.index[1] = tempIndex;
+                piece.m_values.push_back(tempValue);
+                ++piece.m_rowCounts[tempValue.index[1]];
+            }
+        }
+    }
+}
 
 AString OperationProbtrackXDotConvert::getCommandSwitch()
 {
@@ -88,7 +188,6 @@ OperationParameters* OperationProbtrackXDotConvert::getParameters()
     ret->createOptionalParameter(8, "-make-symmetric", "transform half-square input into full matrix output");
     
     AString myText = AString("NOTE: exactly one -row option and one -col option must be used.\n\n") +
-        "If the input file does not have its indexes sorted in the correct ordering, this command may take longer than expected.  " +
         "Specifying -transpose will transpose the input matrix before trying to put its values into the cifti file, which is currently needed for at least matrix2 " +
         "in order to display it as intended.  " +
         "How the cifti file is displayed is based on which -row option is specified: if -row-voxels is specified, then it will display data on volume slices.  " +
@@ -181,13 +280,8 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
         }
         myXML.copyMapping(CiftiXMLOld::ALONG_COLUMN, colCiftiOpt->getCifti(1)->getCiftiXMLOld(), myDir);
     }
-    fstream dotFile(dotFileName.toLatin1().constData(), fstream::in);
-    if (!dotFile.good())
-    {
-        throw OperationException("error opening text file '" + dotFileName + "'");
-    }
-    SparseValue tempValue;
-    vector<SparseValue> dotFileContents;
+    NumericTextFile dotFile;
+    dotFile.open(dotFileName);
     int32_t rowSize = myXML.getNumberOfColumns(), colSize = myXML.getNumberOfRows();
     if (halfMatrix && rowSize != colSize)
     {
@@ -197,70 +291,33 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
     {
         CaretLogInfo("-transpose is not needed with -make-symmetric");
     }
-    int64_t numZeros = 0;
-    bool afterZero = false;
-    if (transpose)
+    int numPieces = 1;
+#ifdef CARET_OMP
+    numPieces = omp_get_max_threads();//each piece has a count per row, so don't make too many
+#endif
+    vector<NumericTextFile::Range> pieceRanges = dotFile.getLineAlignedRanges(numPieces);
+    vector<DotPiece> dotPieces(pieceRanges.size());
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < (int64_t)pieceRanges.size(); ++i)
     {
-        while (dotFile >> tempValue.index[1] >> tempValue.index[0] >> tempValue.value)//this is the only line that is different for transpose
-        {
-            if (tempValue.value == 0.0f)
-            {
-                if (tempValue.index[0] != rowSize || tempValue.index[1] != colSize)
-                {
-                    throw OperationException("dimensions line in .dot file doesn't agree with provided row/column spaces");
-                }
-                ++numZeros;//ignore, we expect one line (last in file) to have this
-            } else {
-                if (tempValue.index[0] < 1 || tempValue.index[0] > rowSize ||
-                    tempValue.index[1] < 1 || tempValue.index[1] > colSize)
-                {
-                    throw OperationException("found invalid index pair in dot file: " + AString::number(tempValue.index[0]) + ", " + AString::number(tempValue.index[1]) +
-                        ", perhaps you need to remove -transpose");
-                }
-                if (numZeros != 0) afterZero = true;
-                tempValue.index[0] -= 1;//fix for 1-indexing
-                tempValue.index[1] -= 1;
-                dotFileContents.push_back(tempValue);
-                if (halfMatrix && tempValue.index[0] != tempValue.index[1])
-                {
-                    int32_t tempIndex = tempValue.index[0];
-                    tempValue.index[0] = tempValue.index[1];
-                    tempValue.index[1] = tempIndex;
-                    dotFileContents.push_back(tempValue);
-                }
-            }
-        }
-    } else {
-        while (dotFile >> tempValue.index[0] >> tempValue.index[1] >> tempValue.value)
+        parseDotPiece(dotFile.getData() + pieceRanges[i].m_start, dotFile.getData() + pieceRanges[i].m_end, transpose, halfMatrix, rowSize, colSize, dotPieces[i]);
+    }
+    int64_t numZeros = 0, linesBefore = 0;
+    bool afterZero = false;
+    for (size_t i = 0; i < dotPieces.size(); ++i)
+    {//report the first problem in the file
+        const DotPiece& myPiece = dotPieces[i];
+        if (myPiece.m_badLine != 0)
         {
-            if (tempValue.value == 0.0f)
-            {
-                if (tempValue.index[0] != rowSize || tempValue.index[1] != colSize)
-                {
-                    throw OperationException("dimensions line in .dot file doesn't agree with provided row/column spaces");
-                }
-                ++numZeros;
-            } else {
-                if (tempValue.index[0] < 1 || tempValue.index[0] > rowSize ||
-                    tempValue.index[1] < 1 || tempValue.index[1] > colSize)
-                {
-                    throw OperationException("found invalid index pair in dot file: " + AString::number(tempValue.index[0]) + ", " + AString::number(tempValue.index[1]) +
-                        ", perhaps you need to use -transpose");
-                }
-                if (numZeros != 0) afterZero = true;
-                tempValue.index[0] -= 1;//fix for 1-indexing
-                tempValue.index[1] -= 1;
-                dotFileContents.push_back(tempValue);
-                if (halfMatrix && tempValue.index[0] != tempValue.index[1])
-                {
-                    int32_t tempIndex = tempValue.index[0];
-                    tempValue.index[0] = tempValue.index[1];
-                    tempValue.index[1] = tempIndex;
-                    dotFileContents.push_back(tempValue);
-                }
-            }
+            throw OperationException("failed to parse line " + AString::number(linesBefore + myPiece.m_badLine) + " of dot file, expected two indexes and a value");
         }
+        if (!myPiece.m_error.isEmpty()) throw OperationException(myPiece.m_error);
+        if (numZeros != 0 && myPiece.m_hasData) afterZero = true;
+        if (myPiece.m_afterZero) afterZero = true;
+        numZeros += myPiece.m_numZeros;
+        linesBefore += myPiece.m_numLines;
     }
+    dotFile.close();
     if (numZeros != 1)
     {
         CaretLogWarning("found (and ignored) " + AString::number(numZeros) + " lines with zero for value, expected 1");
@@ -269,47 +326,53 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
     {
         CaretLogWarning("found data lines after dimensionality line (which should be the last line of the file)");
     }
-    bool sorted = true;
-    int64_t numValues = (int64_t)dotFileContents.size();
-    for (int64_t i = 1; i < numValues; ++i)
+    //group the values by row with a counting sort, this is stable, so the order within a row is the order in the file
+    vector<int64_t> rowStart(colSize + 1, 0);
+    for (int32_t row = 0; row < colSize; ++row)
     {
-        if (dotFileContents[i - 1].index[1] > dotFileContents[i].index[1])
+        int64_t next = rowStart[row];
+        for (size_t i = 0; i < dotPieces.size(); ++i)
         {
-            sorted = false;
-            if (!halfMatrix)
-            {
-                CaretLogInfo("dot file indexes are not correctly sorted, sorting them may take a minute or so...");
-            }
-            break;
+            int64_t count = dotPieces[i].m_rowCounts[row];
+            dotPieces[i].m_rowCounts[row] = next;
+            next += count;
         }
+        rowStart[row + 1] = next;
     }
-    if (!sorted) sort(dotFileContents.begin(), dotFileContents.end());
-    if (!sorted && !halfMatrix)
+    vector<RowElement> dotFileContents(rowStart[colSize]);
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int64_t i = 0; i < (int64_t)dotPieces.size(); ++i)
     {
-        CaretLogInfo("sorting finished");
+        DotPiece& myPiece = dotPieces[i];
+        for (size_t j = 0; j < myPiece.m_values.size(); ++j)
+        {
+            const SparseValue& myValue = myPiece.m_values[j];
+            RowElement& myElement = dotFileContents[myPiece.m_rowCounts[myValue.index[1]]++];
+            myElement.column = myValue.index[0];
+            myElement.value = myValue.value;
+        }
+        vector<SparseValue>().swap(myPiece.m_values);//free memory as we go
     }
     myCiftiOut->setCiftiXML(myXML);
-    int64_t cur = 0, end = (int64_t)dotFileContents.size();
     vector<float> scratchRow(myXML.getNumberOfColumns(), 0.0f);
     vector<bool> checkDuplicate(myXML.getNumberOfColumns(), false);
     int64_t whichRow = 0;//set all rows, in case initial allocation doesn't give a zeroed matrix
     while (whichRow < myXML.getNumberOfRows())
     {
-        int64_t next = cur;
-        while (next < end && dotFileContents[next].index[1] == whichRow) ++next;
+        const int64_t cur = rowStart[whichRow], next = rowStart[whichRow + 1];
         if (rowVoxelOpt->m_present)
         {
             for (int64_t i = cur; i < next; ++i)
             {
-                int64_t outIndex = rowReorderMap[dotFileContents[i].index[0]];
+                int64_t outIndex = rowReorderMap[dotFileContents[i].column];
                 if (checkDuplicate[outIndex])
                 {
                     AString elemString;
                     if (transpose)
                     {
-                        elemString = AString::number(dotFileContents[i].index[1] + 1) + ", " + AString::number(dotFileContents[i].index[0] + 1);
+                        elemString = AString::number(whichRow + 1) + ", " + AString::number(dotFileContents[i].column + 1);
                     } else {
-                        elemString = AString::number(dotFileContents[i].index[0] + 1) + ", " + AString::number(dotFileContents[i].index[1] + 1);
+                        elemString = AString::number(dotFileContents[i].column + 1) + ", " + AString::number(whichRow + 1);
                     }
                     if (halfMatrix)
                     {
@@ -324,15 +387,15 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
         } else {
             for (int64_t i = cur; i < next; ++i)
             {
-                int64_t outIndex = dotFileContents[i].index[0];
+                int64_t outIndex = dotFileContents[i].column;
                 if (checkDuplicate[outIndex])
                 {
                     AString elemString;
                     if (transpose)
                     {
-                        elemString = AString::number(dotFileContents[i].index[1] + 1) + ", " + AString::number(dotFileContents[i].index[0] + 1);
+                        elemString = AString::number(whichRow + 1) + ", " + AString::number(dotFileContents[i].column + 1);
                     } else {
-                        elemString = AString::number(dotFileContents[i].index[0] + 1) + ", " + AString::number(dotFileContents[i].index[1] + 1);
+                        elemString = AString::number(dotFileContents[i].column + 1) + ", " + AString::number(whichRow + 1);
                     }
                     if (halfMatrix)
                     {
@@ -355,19 +418,18 @@ void OperationProbtrackXDotConvert::useParameters(OperationParameters* myParams,
         {
             for (int64_t i = cur; i < next; ++i)
             {
-                int64_t outIndex = rowReorderMap[dotFileContents[i].index[0]];
+                int64_t outIndex = rowReorderMap[dotFileContents[i].column];
                 scratchRow[outIndex] = 0.0f;
                 checkDuplicate[outIndex] = false;
             }
         } else {
             for (int64_t i = cur; i < next; ++i)
             {
-                int64_t outIndex = dotFileContents[i].index[0];
+                int64_t outIndex = dotFileContents[i].column;
                 scratchRow[outIndex] = 0.0f;
                 checkDuplicate[outIndex] = false;
             }
         }
-        cur = next;
         ++whichRow;
     }
 }
@@ -110,6 +110,8 @@ void OperationSurfaceGeodesicDistanceAllToAll::useParameters(OperationParameters
     myMap.addSurfaceModel(mySurf->getNumberOfNodes(), structure, roiData);
     int64_t mapLength = myMap.getLength();
     vector<CiftiBrainModelsMap::SurfaceMap> surfMap = myMap.getSurfaceMap(structure);
+    const vector<int64_t>& nodeToIndex = myMap.getNodeToIndexLookup(structure);//-1 if outside ROI
+    vector<CiftiBrainModelsMap::IndexRange> surfRanges = myMap.getSurfaceRanges(structure);
     CiftiXML myXML;
     myXML.setNumberOfDimensions(2);
     myXML.setMap(CiftiXML::ALONG_ROW, myMap);
@@ -134,15 +136,12 @@ void OperationSurfaceGeodesicDistanceAllToAll::useParameters(OperationParameters
                 privHelper->getNodesToGeoDist(surfMap[i].m_surfaceNode, distLimit, outNodes, outDists, !naive);
                 for (int j = 0; j < int(outNodes.size()); ++j)
                 {
-                    int64_t index = myMap.getIndexForNode(outNodes[j], structure);//-1 if outside ROI
+                    int64_t index = nodeToIndex[outNodes[j]];
                     if (index >= 0) outRow[index] = outDists[j];
                 }
             } else {
                 privHelper->getGeoFromNode(surfMap[i].m_surfaceNode, outDists, !naive);
-                for (int64_t j = 0; j < mapLength; ++j)
-                {
-                    outRow[j] = outDists[surfMap[j].m_surfaceNode];
-                }
+                CiftiBrainModelsMap::copyElementsToCifti(surfRanges, outDists.data(), outRow.data());
             }
 #pragma omp critical
             {
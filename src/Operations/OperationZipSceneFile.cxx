@@ -25,6 +25,7 @@
 #include "FileInformation.h"
 #include "OperationZipSceneFile.h"
 #include "OperationException.h"
+#include "ParallelZipWriter.h"
 #include "Scene.h"
 #include "SceneAttributes.h"
 #include "SceneClass.h"
@@ -32,10 +33,8 @@
 #include "SceneFile.h"
 #include "SpecFile.h"
 
-#include "quazip.h"
-#include "quazipfile.h"
-
 #include <QDir>
+#include <QFile>
 
 #include <iostream>
 #include <set>
@@ -66,10 +65,15 @@ OperationParameters* OperationZipSceneFile::getParameters()
     baseOpt->addStringParameter(1, "directory", "the directory");
     
     ret->createOptionalParameter(5, "-skip-missing", "any missing files will generate only warnings, and the zip file will be created anyway");
+    
+    OptionalParameter* levelOpt = ret->createOptionalParameter(6, "-compression-level", "set the zlib compression level, default 6");
+    levelOpt->addIntegerParameter(1, "level", "compression level from 0 (store only) to 9 (smallest)");
 
     ret->setHelpText("If zip-file already exists, it will be overwritten.  "
         "If -base-dir is not specified, the base directory will be automatically set to the lowest level directory containing all files.  "
-        "The scene file must contain only relative paths, and no data files may be outside the base directory.");
+        "The scene file must contain only relative paths, and no data files may be outside the base directory.  "
+        "Large files are compressed in blocks using all available cores.  "
+        "Files that are already compressed (.gz, .png, etc), and files that do not shrink when compressed, are stored without compression.");
     return ret;
 }
 
@@ -85,6 +89,13 @@ void OperationZipSceneFile::useParameters(OperationParameters* myParams, Progres
         myBaseDir = QDir::cleanPath(QDir(baseOpt->getString(1)).absolutePath());
     }
     bool skipMissing = myParams->getOptionalParameter(5)->m_present;
+    int compressionLevel = -1;
+    OptionalParameter* levelOpt = myParams->getOptionalParameter(6);
+    if (levelOpt->m_present)
+    {
+        compressionLevel = (int)levelOpt->getInteger(1);
+        if (compressionLevel < 0 || compressionLevel > 9) throw OperationException("compression level must be from 0 to 9");
+    }
     
     OperationZipSceneFile::createZipFile(myProgObj,
                                          sceneFileName,
@@ -92,7 +103,8 @@ void OperationZipSceneFile::useParameters(OperationParameters* myParams, Progres
                                          zipFileName,
                                          myBaseDir,
                                          PROGRESS_COMMAND_LINE,
-                                         skipMissing);
+                                         skipMissing,
+                                         compressionLevel);
 }
 
 void OperationZipSceneFile::createZipFile(ProgressObject* myProgObj,
@@ -101,7 +113,8 @@ void OperationZipSceneFile::createZipFile(ProgressObject* myProgObj,
                                           const AString& zipFileName,
                                           const AString& baseDirectory,
                                           const ProgressMode progressMode,
-                                          const bool skipMissing)
+                                          const bool skipMissing,
+                                          const int compressionLevel)
 {
     LevelProgress myProgress(myProgObj);
     FileInformation sceneFileInfo(sceneFileName);
@@ -219,15 +232,7 @@ void OperationZipSceneFile::createZipFile(ProgressObject* myProgObj,
     EventProgressUpdate progressEvent(0, allFiles.size(), 0, "Creating ZIP File");
     EventManager::get()->sendEvent(progressEvent.getPointer());
 
-    QFile zipFileObject(zipFileName);
-    zipFileObject.remove();//delete it if it exists, to play better with file symlinks
-    QuaZip zipFile(&zipFileObject);
-    if (!zipFile.open(QuaZip::mdCreate))
-    {
-        throw OperationException("Unable to open ZIP File \""
-                                 + zipFileName
-                                 + "\" for writing.");
-    }
+    ParallelZipWriter zipFile(zipFileName, compressionLevel);
     int32_t fileIndex = 1;
     static const char *myUnits[9] = {" B    ", " KB", " MB", " GB", " TB", " PB", " EB", " ZB", " YB"};
     int goodFileCount = 0;
@@ -246,6 +251,7 @@ void OperationZipSceneFile::createZipFile(ProgressObject* myProgObj,
             }
         }
         float fileSize = (float)dataFileIn.size();
+        dataFileIn.close();//the zip writer reopens it
         int unit = 0;
         while (unit < 8 && fileSize >= 1000.0f)//don't let there be 4 digits to the left of decimal point
         {
@@ -275,29 +281,7 @@ void OperationZipSceneFile::createZipFile(ProgressObject* myProgObj,
                 break;
         }
         
-        QuaZipNewInfo zipNewInfo(unzippedDataFileName,
-                                 dataFileName);
-        zipNewInfo.externalAttr |= (6 << 22L) | (6 << 19L) | (4 << 16L);//make permissions 664
-        
-        QuaZipFile dataFileOut(&zipFile);
-        if (!dataFileOut.open(QIODevice::WriteOnly, zipNewInfo)) {
-            throw OperationException("Unable to open zip output for \"" + dataFileName + "\"");
-        }
-        
-        const qint64 BUFFER_SIZE = 1024 * 1024;
-        vector<char> buffer(BUFFER_SIZE);
-        
-        while (dataFileIn.atEnd() == false) {
-            const qint64 numRead = dataFileIn.read(buffer.data(), BUFFER_SIZE);
-            if (numRead < 0) throw OperationException("Error reading from data file");
-            if (numRead > 0) {
-                qint64 result = dataFileOut.write(buffer.data(), numRead);
-                if (result != numRead) throw OperationException("Error writing to zip file");
-            }
-        }
-        
-        dataFileIn.close();
-        dataFileOut.close();
+        zipFile.addFile(dataFileName, unzippedDataFileName);
         switch (progressMode) {
             case PROGRESS_COMMAND_LINE:
                 cout << endl;
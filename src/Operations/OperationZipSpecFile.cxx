@@ -23,13 +23,12 @@
 #include "FileInformation.h"
 #include "OperationZipSpecFile.h"
 #include "OperationException.h"
+#include "ParallelZipWriter.h"
 #include "SpecFile.h"
 
-#include "quazip.h"
-#include "quazipfile.h"
-
 //for cleanPath
 #include <QDir>
+#include <QFile>
 
 //to print file sizes as it makes the zip
 #include <iostream>
@@ -62,10 +61,15 @@ OperationParameters* OperationZipSpecFile::getParameters()
     
     ret->createOptionalParameter(5, "-skip-missing", "any missing files will generate only warnings, and the zip file will be created anyway");
     
+    OptionalParameter* levelOpt = ret->createOptionalParameter(6, "-compression-level", "set the zlib compression level, default 6");
+    levelOpt->addIntegerParameter(1, "level", "compression level from 0 (store only) to 9 (smallest)");
+    
     ret->setHelpText(AString("If zip-file already exists, it will be overwritten.  ") +
         "If -base-dir is not specified, the directory containing the spec file is used for the base directory.  " +
         "The spec file must contain only relative paths, and no data files may be outside the base directory.  " +
-        "Scene files inside spec files are not checked for what files they reference, ensure that all data files referenced by the scene files are also referenced by the spec file.");
+        "Scene files inside spec files are not checked for what files they reference, ensure that all data files referenced by the scene files are also referenced by the spec file.  " +
+        "Large files are compressed in blocks using all available cores.  " +
+        "Files that are already compressed (.gz, .png, etc), and files that do not shrink when compressed, are stored without compression.");
     return ret;
 }
 
@@ -89,6 +93,13 @@ void OperationZipSpecFile::useParameters(OperationParameters* myParams, Progress
         myBaseDir += "/";//so, add the trailing slash to the path
     }
     bool skipMissing = myParams->getOptionalParameter(5)->m_present;
+    int compressionLevel = -1;
+    OptionalParameter* levelOpt = myParams->getOptionalParameter(6);
+    if (levelOpt->m_present)
+    {
+        compressionLevel = (int)levelOpt->getInteger(1);
+        if (compressionLevel < 0 || compressionLevel > 9) throw OperationException("compression level must be from 0 to 9");
+    }
 
     if (outputSubDirectory.isEmpty()) {
         throw OperationException("extract-dir must contain characters");
@@ -170,14 +181,7 @@ void OperationZipSpecFile::useParameters(OperationParameters* myParams, Progress
     /*
      * Create the ZIP file
      */
-    QFile zipFileObject(zipFileName);
-    zipFileObject.remove();//delete it if it exists, to play better with file symlinks
-    QuaZip zipFile(&zipFileObject);
-    if (zipFile.open(QuaZip::mdCreate) == false) {
-        throw OperationException("Unable to open ZIP File \""
-                                 + zipFileName
-                                 + "\" for writing.");
-    }
+    ParallelZipWriter zipFile(zipFileName, compressionLevel);
     
     /*
      * Compress each of the files and add them to the zip file
@@ -187,20 +191,12 @@ void OperationZipSpecFile::useParameters(OperationParameters* myParams, Progress
     for (int32_t i = 0; i < numberOfDataFiles; i++) {
         AString dataFileName = allDataFileNames[i];
         AString unzippedDataFileName = outputSubDirectory + "/" + dataFileName.mid(myBaseDir.size());//we know the string matches to the length of myBaseDir, and is cleaned, so we can just chop the right number of characters off
-        QFile dataFileIn(dataFileName);
-        if (dataFileIn.open(QFile::ReadOnly) == false) {
-            if (skipMissing)
-            {
-                continue;
-            } else {
-                errorMessage = "Unable to open \""
-                                    + dataFileName
-                                    + "\" for reading: "
-                                    + dataFileIn.errorString();
-                break;
-            }
+        FileInformation dataFileInfo(dataFileName);
+        if (!dataFileInfo.exists() && skipMissing)
+        {
+            continue;
         }
-        float fileSize = (float)dataFileIn.size();
+        float fileSize = (float)dataFileInfo.size();
         int unit = 0;
         while (unit < 8 && fileSize >= 1000.0f)//don't let there be 4 digits to the left of decimal point
         {
@@ -216,42 +212,13 @@ void OperationZipSpecFile::useParameters(OperationParameters* myParams, Progress
         cout << myUnits[unit] << "     \t" << unzippedDataFileName;
         cout.flush();//don't endl until it finishes
         
-        QuaZipNewInfo zipNewInfo(unzippedDataFileName,
-                                 dataFileName);
-        zipNewInfo.externalAttr |= (6 << 22L) | (6 << 19L) | (4 << 16L);//make permissions 664
-        
-        QuaZipFile dataFileOut(&zipFile);
-        if (dataFileOut.open(QIODevice::WriteOnly,
-                             zipNewInfo) == false) {
-            errorMessage = "Unable to open zip output for \""
-                            + dataFileName
-                            + "\"";
+        try
+        {
+            zipFile.addFile(dataFileName, unzippedDataFileName);
+        } catch (OperationException& e) {
+            errorMessage = e.whatString();
             break;
         }
-        
-        const qint64 BUFFER_SIZE = 1024 * 1024;
-        vector<char> buffer(BUFFER_SIZE);
-        
-        while (dataFileIn.atEnd() == false) {
-            const qint64 numRead = dataFileIn.read(buffer.data(), BUFFER_SIZE);
-            if (numRead < 0)
-            {
-                errorMessage = "Error reading from data file";
-                break;
-            }
-            if (numRead > 0) {
-                qint64 result = dataFileOut.write(buffer.data(), numRead);
-                if (result != numRead)
-                {
-                    errorMessage = "Error writing to zip file";
-                    break;
-                }
-            }
-        }
-        if (!errorMessage.isEmpty()) break;
-        
-        dataFileIn.close();
-        dataFileOut.close();
         cout << endl;
     }
     
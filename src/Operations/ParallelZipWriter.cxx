@@ -0,0 +1,246 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ParallelZipWriter.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "OperationException.h"
+
+#include "quazip.h"
+#include "quazipnewinfo.h"
+#include "zip.h"
+#include "zlib.h"
+
+#include <QFile>
+#include <QTextCodec>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    const int64_t BLOCK_SIZE = 4 * 1024 * 1024;
+    const int64_t DICTIONARY_SIZE = 32 * 1024;//deflate window, blocks are primed with the end of the previous block so the ratio is nearly that of a single stream
+    const double STORE_RATIO = 0.98;//if the first blocks don't compress better than this, store the entry
+}
+
+ParallelZipWriter::ParallelZipWriter(const AString& zipFileName, const int& compressionLevel)
+{
+    if (compressionLevel < -1 || compressionLevel > 9)
+    {
+        throw OperationException("compression level must be from 0 to 9, or -1 for the default");
+    }
+    m_compressionLevel = compressionLevel;
+    m_zipFileObject.grabNew(new QFile(zipFileName));
+    m_zipFileObject->remove();//delete it if it exists, to play better with file symlinks
+    m_zip.grabNew(new QuaZip(m_zipFileObject));
+    if (!m_zip->open(QuaZip::mdCreate))
+    {
+        throw OperationException("Unable to open ZIP File \"" + zipFileName + "\" for writing.");
+    }
+    m_open = true;
+}
+
+ParallelZipWriter::~ParallelZipWriter()
+{
+    close();
+}
+
+void ParallelZipWriter::close()
+{
+    if (m_open)
+    {
+        m_zip->close();
+        m_open = false;
+    }
+}
+
+bool ParallelZipWriter::isCompressedFileName(const AString& fileName)
+{
+    static const char* compressedExtensions[] = { ".gz", ".bz2", ".xz", ".zip", ".png", ".jpg", ".jpeg", ".gif", ".mp4", ".mpg", ".mpeg", ".avi", ".mov" };
+    const AString lowerName = fileName.toLower();
+    for (const char* extension : compressedExtensions)
+    {
+        if (lowerName.endsWith(extension)) return true;
+    }
+    return false;
+}
+
+void ParallelZipWriter::compressBlock(Block& block, const char* dictionary, const int64_t& dictionarySize, const bool& lastBlock) const
+{
+    block.m_crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)block.m_input.data(), (uInt)block.m_inputSize);
+    block.m_outputSize = -1;//error marker, exceptions can't leave the parallel loop
+    z_stream myStream;
+    memset(&myStream, 0, sizeof(myStream));
+    int level = (m_compressionLevel < 0 ? Z_DEFAULT_COMPRESSION : m_compressionLevel);
+    if (deflateInit2(&myStream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return;//raw deflate, zip has its own headers
+    if (dictionarySize > 0)
+    {
+        deflateSetDictionary(&myStream, (const Bytef*)dictionary, (uInt)dictionarySize);
+    }
+    block.m_output.resize(deflateBound(&myStream, block.m_inputSize) + 64);//room for the sync flush marker
+    myStream.next_in = (Bytef*)block.m_input.data();
+    myStream.avail_in = (uInt)block.m_inputSize;
+    myStream.next_out = (Bytef*)block.m_output.data();
+    myStream.avail_out = (uInt)block.m_output.size();
+    //sync flush ends the block on a byte boundary without marking the stream final, so the blocks concatenate into one valid deflate stream
+    int ret = deflate(&myStream, lastBlock ? Z_FINISH : Z_SYNC_FLUSH);
+    bool good = (lastBlock ? (ret == Z_STREAM_END) : (ret == Z_OK && myStream.avail_in == 0 && myStream.avail_out > 0));
+    if (good)
+    {
+        block.m_outputSize = myStream.total_out;
+    }
+    deflateEnd(&myStream);
+}
+
+int64_t ParallelZipWriter::addFile(const AString& dataFileName, const AString& entryName)
+{
+    CaretAssert(m_open);
+    QFile dataFileIn(dataFileName);
+    if (!dataFileIn.open(QFile::ReadOnly))
+    {
+        throw OperationException("Unable to open \"" + dataFileName + "\" for reading: " + dataFileIn.errorString());
+    }
+    const int64_t fileSize = dataFileIn.size();
+    bool storeFlag = (m_compressionLevel == 0 || isCompressedFileName(dataFileName));
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    const int windowBlocks = max(2, 2 * numThreads);//bounds memory to a few blocks per thread, regardless of file size
+    vector<Block> window(windowBlocks);
+    vector<char> dictionary;//end of the input preceding the current window
+    zipFile myZipFile = m_zip->getZipFile();
+    bool entryOpen = false, done = false, firstWindow = true;
+    uLong entryCrc = crc32(0L, Z_NULL, 0);
+    int64_t totalIn = 0, totalOut = 0;
+    while (!done)
+    {
+        int numBlocks = 0;
+        while (numBlocks < windowBlocks)
+        {//reading is serial, the disk doesn't like parallel reads of one file
+            Block& thisBlock = window[numBlocks];
+            thisBlock.m_input.resize(BLOCK_SIZE);
+            int64_t numRead = 0;
+            while (numRead < BLOCK_SIZE)
+            {
+                qint64 result = dataFileIn.read(thisBlock.m_input.data() + numRead, BLOCK_SIZE - numRead);
+                if (result < 0) throw OperationException("Error reading from data file \"" + dataFileName + "\": " + dataFileIn.errorString());
+                if (result == 0) break;
+                numRead += result;
+            }
+            thisBlock.m_inputSize = numRead;
+            ++numBlocks;
+            if (numRead < BLOCK_SIZE)
+            {
+                done = true;
+                break;
+            }
+        }
+        if (storeFlag)
+        {
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                window[i].m_crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)window[i].m_input.data(), (uInt)window[i].m_inputSize);
+            }
+        } else {
+#pragma omp CARET_PARFOR schedule(dynamic)
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                const char* dictStart = NULL;
+                int64_t dictSize = 0;
+                if (i == 0)
+                {
+                    dictStart = dictionary.data();
+                    dictSize = (int64_t)dictionary.size();
+                } else {
+                    dictSize = min(DICTIONARY_SIZE, window[i - 1].m_inputSize);
+                    dictStart = window[i - 1].m_input.data() + window[i - 1].m_inputSize - dictSize;
+                }
+                compressBlock(window[i], dictStart, dictSize, done && i == numBlocks - 1);
+            }
+            int64_t windowIn = 0, windowOut = 0;
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                if (window[i].m_outputSize < 0) throw OperationException("zlib error while compressing \"" + dataFileName + "\"");
+                windowIn += window[i].m_inputSize;
+                windowOut += window[i].m_outputSize;
+            }
+            if (firstWindow && windowIn > 0 && windowOut >= windowIn * STORE_RATIO)
+            {//doesn't shrink, most likely compressed data without a telltale extension
+                storeFlag = true;
+            }
+        }
+        if (!entryOpen)
+        {
+            QuaZipNewInfo zipNewInfo(entryName, dataFileName);
+            zipNewInfo.externalAttr |= (6 << 22L) | (6 << 19L) | (4 << 16L);//make permissions 664
+            zip_fileinfo info_z;
+            memset(&info_z, 0, sizeof(info_z));
+            info_z.tmz_date.tm_year = zipNewInfo.dateTime.date().year();
+            info_z.tmz_date.tm_mon = zipNewInfo.dateTime.date().month() - 1;
+            info_z.tmz_date.tm_mday = zipNewInfo.dateTime.date().day();
+            info_z.tmz_date.tm_hour = zipNewInfo.dateTime.time().hour();
+            info_z.tmz_date.tm_min = zipNewInfo.dateTime.time().minute();
+            info_z.tmz_date.tm_sec = zipNewInfo.dateTime.time().second();
+            info_z.internal_fa = (uLong)zipNewInfo.internalAttr;
+            info_z.external_fa = (uLong)zipNewInfo.externalAttr;
+            if (!m_zip->isDataDescriptorWritingEnabled()) zipClearFlags(myZipFile, ZIP_WRITE_DATA_DESCRIPTOR);
+            const int zip64 = ((fileSize >= 0xffffffffLL || m_zip->isZip64Enabled()) ? 1 : 0);
+            const int level = (storeFlag ? 0 : (m_compressionLevel < 0 ? Z_DEFAULT_COMPRESSION : m_compressionLevel));
+            //raw: the data is written as given (already deflated, or stored), and the crc and size are provided when closing
+            if (zipOpenNewFileInZip3_64(myZipFile, m_zip->getFileNameCodec()->fromUnicode(entryName).constData(), &info_z,
+                                        NULL, 0, NULL, 0, NULL,
+                                        (storeFlag ? 0 : Z_DEFLATED), level, 1,
+                                        -MAX_WBITS, 8, Z_DEFAULT_STRATEGY, NULL, 0, zip64) != ZIP_OK)
+            {
+                throw OperationException("Unable to open zip output for \"" + dataFileName + "\"");
+            }
+            entryOpen = true;
+        }
+        for (int i = 0; i < numBlocks; ++i)
+        {//append in order
+            const Block& thisBlock = window[i];
+            const char* outData = (storeFlag ? thisBlock.m_input.data() : thisBlock.m_output.data());
+            const int64_t outSize = (storeFlag ? thisBlock.m_inputSize : thisBlock.m_outputSize);
+            if (outSize > 0 && zipWriteInFileInZip(myZipFile, outData, (unsigned)outSize) != ZIP_OK)
+            {
+                throw OperationException("Error writing to zip file");
+            }
+            entryCrc = crc32_combine(entryCrc, thisBlock.m_crc, thisBlock.m_inputSize);
+            totalIn += thisBlock.m_inputSize;
+            totalOut += outSize;
+        }
+        const Block& lastBlock = window[numBlocks - 1];
+        const int64_t keep = min(DICTIONARY_SIZE, lastBlock.m_inputSize);
+        dictionary.assign(lastBlock.m_input.data() + lastBlock.m_inputSize - keep, lastBlock.m_input.data() + lastBlock.m_inputSize);
+        firstWindow = false;
+    }
+    if (zipCloseFileInZipRaw64(myZipFile, totalIn, entryCrc) != ZIP_OK)
+    {
+        throw OperationException("Error finishing zip entry for \"" + dataFileName + "\"");
+    }
+    return totalOut;
+}
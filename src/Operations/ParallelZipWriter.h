@@ -0,0 +1,70 @@
+#ifndef __PARALLEL_ZIP_WRITER_H__
+#define __PARALLEL_ZIP_WRITER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2019  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretPointer.h"
+
+#include <vector>
+
+class QFile;
+class QuaZip;
+
+namespace caret {
+    
+    ///writes zip entries whose deflate data is produced by compressing independent blocks of each file on all cores (like pigz),
+    ///entries are appended in the order they are added, and files that are already compressed, or that do not shrink, are stored
+    class ParallelZipWriter
+    {
+    public:
+        ///compressionLevel is the zlib level, 0 stores every entry without compression, -1 is the zlib default
+        ParallelZipWriter(const AString& zipFileName, const int& compressionLevel = -1);
+        ~ParallelZipWriter();
+        
+        ///add a file to the zip file, returns the number of bytes of compressed data written for the entry
+        int64_t addFile(const AString& dataFileName, const AString& entryName);
+        
+        ///finish the zip file, also done by the destructor
+        void close();
+        
+        ///true if the file name has an extension of an already compressed format, such as .gz or .png
+        static bool isCompressedFileName(const AString& fileName);
+    private:
+        struct Block
+        {
+            std::vector<char> m_input, m_output;
+            int64_t m_inputSize, m_outputSize;
+            uint32_t m_crc;
+        };
+        CaretPointer<QFile> m_zipFileObject;
+        CaretPointer<QuaZip> m_zip;
+        int m_compressionLevel;
+        bool m_open;
+        void compressBlock(Block& block, const char* dictionary, const int64_t& dictionarySize, const bool& lastBlock) const;
+        ParallelZipWriter();
+        ParallelZipWriter(const ParallelZipWriter&);
+        ParallelZipWriter& operator=(const ParallelZipWriter&);
+    };
+    
+}
+
+#endif //__PARALLEL_ZIP_WRITER_H__
@@ -26,6 +26,7 @@
 #include "Palette.h"
 #undef __PALETTE_DEFINE__
 
+#include "PaletteColorLookup.h"
 #include "PaletteScalarAndColor.h"
 
 using namespace caret;
@@ -84,6 +85,7 @@ void
 Palette::copyHelper(const Palette& o)
 {
     this->name = o.name;
+    this->invalidateColorLookup();
     this->paletteScalars.clear();
     uint64_t num = o.paletteScalars.size();
     for (uint64_t i = 0; i < num; i++) {
@@ -483,6 +485,35 @@ Palette::getPaletteColor(
     }
 }
 
+/**
+ * @return A compiled version of this palette for coloring many values,
+ * with the same results as getPaletteColor().  It is created when first
+ * needed and recompiled when the palette's scalars or colors no longer
+ * match it.  Safe to call from several threads, a returned lookup is
+ * not changed by later modifications to the palette.
+ */
+CaretPointer<const PaletteColorLookup>
+Palette::getColorLookup() const
+{
+    CaretMutexLocker locker(&m_colorLookupMutex);
+    if ((m_colorLookup == NULL)
+        || ( ! m_colorLookup->isCompiledFrom(this))) {
+        m_colorLookup.grabNew(new PaletteColorLookup(this));
+    }
+    
+    return m_colorLookup;
+}
+
+/**
+ * Discard the compiled lookup, it is recompiled when next needed.
+ */
+void
+Palette::invalidateColorLookup()
+{
+    CaretMutexLocker locker(&m_colorLookupMutex);
+    m_colorLookup = CaretPointer<const PaletteColorLookup>();
+}
+
 /**
  * Set this object has been modified.
  *
@@ -491,6 +522,7 @@ void
 Palette::setModified()
 {
     this->modifiedFlag = true;
+    this->invalidateColorLookup();
 }
 
 /**
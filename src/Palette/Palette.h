@@ -26,12 +26,15 @@
 #include <vector>
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretObject.h"
+#include "CaretPointer.h"
 #include "TracksModificationInterface.h"
 
 
 namespace caret {
 
+    class PaletteColorLookup;
     class PaletteScalarAndColor;
 
     /**
@@ -97,6 +100,8 @@ namespace caret {
                              const bool interpolateColorFlag,
                              float rgbaOut[4]) const;
         
+        CaretPointer<const PaletteColorLookup> getColorLookup() const;
+        
         void setModified();
         
         void clearModified();
@@ -127,6 +132,8 @@ namespace caret {
     private:
         Palette* createSignSeparateInvertedPalette() const;
         
+        void invalidateColorLookup();
+        
         /**has this object been modified. (DO NOT CLONE) */
         bool modifiedFlag;
         
@@ -144,6 +151,12 @@ namespace caret {
         
         /** The inverted palette with negative inverted separate from positive */
         mutable std::unique_ptr<Palette> m_noneSeparateInvertedPalette;
+        
+        /** Compiled copy for coloring, lazily initialized and recompiled when out of date */
+        mutable CaretPointer<const PaletteColorLookup> m_colorLookup;
+        
+        /** Protects m_colorLookup, palettes may be used for coloring from several threads */
+        mutable CaretMutex m_colorLookupMutex;
     };
 
     
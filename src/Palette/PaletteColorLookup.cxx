@@ -0,0 +1,201 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PaletteColorLookup.h"
+
+#include "CaretAssert.h"
+#include "Palette.h"
+#include "PaletteScalarAndColor.h"
+
+using namespace caret;
+
+const int32_t PaletteColorLookup::NUMBER_OF_BINS = 2048;
+
+/**
+ * Constructor.
+ *
+ * @param palette
+ *    Palette that is compiled.  Later changes to the palette are
+ *    not seen, use isCompiledFrom() to test if it is still current.
+ */
+PaletteColorLookup::PaletteColorLookup(const Palette* palette)
+{
+    CaretAssert(palette);
+    const int32_t numScalarColors = palette->getNumberOfScalarsAndColors();
+    m_entries.resize(numScalarColors);
+    for (int32_t i = 0; i < numScalarColors; i++) {
+        const PaletteScalarAndColor* psac = palette->getScalarAndColor(i);
+        m_entries[i].m_scalar = psac->getScalar();
+        psac->getColor(m_entries[i].m_rgba);
+        m_entries[i].m_noneColor = psac->isNoneColor();
+    }
+    
+    /*
+     * The search finds the first index whose scalar is below the value.
+     * For all values in a bin, that index is at least the one found for
+     * the top of the bin.
+     */
+    m_binSearchStart.resize(NUMBER_OF_BINS, 1);
+    if (numScalarColors > 2) {
+        for (int32_t iBin = 0; iBin < NUMBER_OF_BINS; iBin++) {
+            const float binTop = -1.0f + (2.0f * (iBin + 1)) / NUMBER_OF_BINS;
+            int32_t start = numScalarColors - 1;
+            for (int32_t i = 1; i < numScalarColors; i++) {
+                if (binTop > m_entries[i].m_scalar) {
+                    start = i;
+                    break;
+                }
+            }
+            m_binSearchStart[iBin] = start;
+        }
+    }
+}
+
+/**
+ * Is this lookup still current for a palette?  Scalars and colors
+ * may be edited without going through the palette, so compare them.
+ *
+ * @param palette
+ *    Palette that is tested.
+ * @return
+ *    True if the palette's scalars and colors match those compiled.
+ */
+bool
+PaletteColorLookup::isCompiledFrom(const Palette* palette) const
+{
+    CaretAssert(palette);
+    const int32_t numScalarColors = palette->getNumberOfScalarsAndColors();
+    if (numScalarColors != static_cast<int32_t>(m_entries.size())) {
+        return false;
+    }
+    for (int32_t i = 0; i < numScalarColors; i++) {
+        const PaletteScalarAndColor* psac = palette->getScalarAndColor(i);
+        const float* rgba = psac->getColor();
+        const Entry& entry = m_entries[i];
+        if ((entry.m_scalar != psac->getScalar())
+            || (entry.m_noneColor != psac->isNoneColor())
+            || (entry.m_rgba[0] != rgba[0])
+            || (entry.m_rgba[1] != rgba[1])
+            || (entry.m_rgba[2] != rgba[2])
+            || (entry.m_rgba[3] != rgba[3])) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Get the color for a normalized value, same as Palette::getPaletteColor().
+ *
+ * @param scalarIn
+ *    Normalized value ranging -1.0 to 1.0.
+ * @param interpolateColorFlagIn
+ *    If true, interpolate between palette colors.
+ * @param rgbaOut
+ *    Output color, alpha is zero for the 'none' color.
+ */
+void
+PaletteColorLookup::getPaletteColor(const float scalarIn,
+                                    const bool interpolateColorFlagIn,
+                                    float rgbaOut[4]) const
+{
+    rgbaOut[0] = 0.0f;
+    rgbaOut[1] = 0.0f;
+    rgbaOut[2] = 0.0f;
+    rgbaOut[3] = 1.0f;
+    
+    const int32_t numScalarColors = static_cast<int32_t>(m_entries.size());
+    if (numScalarColors <= 0) {
+        return;
+    }
+    
+    bool interpolateColorFlag = interpolateColorFlagIn;
+    
+    float scalar = scalarIn;
+    if (scalar < -1.0) scalar = -1.0;
+    if (scalar >  1.0) scalar = 1.0;
+    
+    int32_t paletteIndex = -1;
+    if (numScalarColors == 1) {
+        paletteIndex = 0;
+        interpolateColorFlag = false;
+    }
+    else if (scalar >= m_entries[0].m_scalar) {
+        paletteIndex = 0;
+        interpolateColorFlag = false;
+    }
+    else if (scalar <= m_entries[numScalarColors - 1].m_scalar) {
+        paletteIndex = numScalarColors - 1;
+        interpolateColorFlag = false;
+    }
+    else if (numScalarColors == 2) {
+        paletteIndex = 0;
+        interpolateColorFlag = true;
+    }
+    else {
+        int32_t iBin = 0;
+        if ((scalar >= -1.0f) && (scalar <= 1.0f)) { /* false for NaN */
+            iBin = static_cast<int32_t>((scalar + 1.0f) * 0.5f * NUMBER_OF_BINS);
+            if (iBin >= NUMBER_OF_BINS) iBin = NUMBER_OF_BINS - 1;
+        }
+        int32_t start = m_binSearchStart[iBin];
+        if ((start > 1) && (scalar > m_entries[start - 1].m_scalar)) {
+            start = 1; /* rounding put the value in the wrong bin, search everything */
+        }
+        for (int32_t i = start; i < numScalarColors; i++) {
+            if (scalar > m_entries[i].m_scalar) {
+                paletteIndex = i - 1;
+                break;
+            }
+        }
+    }
+    
+    if (paletteIndex >= 0) {
+        const Entry& above = m_entries[paletteIndex];
+        if (above.m_noneColor) {
+            rgbaOut[3] = 0.0;
+        }
+        else {
+            rgbaOut[0] = above.m_rgba[0];
+            rgbaOut[1] = above.m_rgba[1];
+            rgbaOut[2] = above.m_rgba[2];
+            rgbaOut[3] = above.m_rgba[3];
+            if (interpolateColorFlag &&
+                (paletteIndex < (numScalarColors - 1))) {
+                const Entry& below = m_entries[paletteIndex + 1];
+                float totalDiff = above.m_scalar - below.m_scalar;
+                if (totalDiff != 0.0) {
+                    float offset = scalar - below.m_scalar;
+                    float percentAbove = offset / totalDiff;
+                    float percentBelow = 1.0f - percentAbove;
+                    if ( ! below.m_noneColor) {
+                        rgbaOut[0] = (percentAbove * above.m_rgba[0]
+                                      + percentBelow * below.m_rgba[0]);
+                        rgbaOut[1] = (percentAbove * above.m_rgba[1]
+                                      + percentBelow * below.m_rgba[1]);
+                        rgbaOut[2] = (percentAbove * above.m_rgba[2]
+                                      + percentBelow * below.m_rgba[2]);
+                    }
+                }
+            }
+        }
+    }
+}
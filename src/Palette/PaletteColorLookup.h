@@ -0,0 +1,67 @@
+#ifndef __PALETTE_COLOR_LOOKUP_H__
+#define __PALETTE_COLOR_LOOKUP_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret {
+
+    class Palette;
+    
+    /**
+     * A palette compiled for coloring many values.  The scalars and colors
+     * are copied into contiguous storage, and a table over the normalized
+     * range gives where the search for each value's palette interval starts,
+     * so coloring a value usually takes one or two comparisons.
+     * Colors are identical to those from Palette::getPaletteColor().
+     */
+    class PaletteColorLookup {
+        
+    public:
+        PaletteColorLookup(const Palette* palette);
+        
+        void getPaletteColor(const float scalar,
+                             const bool interpolateColorFlag,
+                             float rgbaOut[4]) const;
+        
+        bool isCompiledFrom(const Palette* palette) const;
+        
+    private:
+        struct Entry {
+            float m_scalar;
+            float m_rgba[4];
+            bool m_noneColor;
+        };
+        
+        /** the palette's scalars and colors, scalars are in DESCENDING ORDER */
+        std::vector<Entry> m_entries;
+        
+        /** for each bin of the normalized range, the first index the linear search needs to test */
+        std::vector<int32_t> m_binSearchStart;
+        
+        static const int32_t NUMBER_OF_BINS;
+    };
+    
+} // namespace
+
+#endif // __PALETTE_COLOR_LOOKUP_H__
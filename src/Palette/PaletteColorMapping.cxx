@@ -1841,6 +1841,68 @@ PaletteColorMapping::setSceneModified()
     this->modifiedStatus = PaletteModifiedStatusEnum::MODIFIED_BY_SHOW_SCENE;
 }
 
+/**
+ * Get the data values that map to the ends of the palette, from
+ * the scale mode and, for the auto scale modes, the statistics.
+ * Inversion of the palette is not applied to these values.
+ *
+ * @param statistics
+ *    Statistics containing min.max values.
+ * @param mostNegativeOut
+ *    Value mapped to the most negative palette color.
+ * @param leastNegativeOut
+ *    Value mapped to the least negative palette color.
+ * @param leastPositiveOut
+ *    Value mapped to the least positive palette color.
+ * @param mostPositiveOut
+ *    Value mapped to the most positive palette color.
+ */
+void
+PaletteColorMapping::getPaletteMappingRanges(const FastStatistics* statistics,
+                                             float& mostNegativeOut,
+                                             float& leastNegativeOut,
+                                             float& leastPositiveOut,
+                                             float& mostPositiveOut) const
+{
+    mostNegativeOut  = 0.0;
+    leastNegativeOut = 0.0;
+    leastPositiveOut = 0.0;
+    mostPositiveOut  = 0.0;
+    switch (this->getScaleMode()) {
+        case PaletteScaleModeEnum::MODE_AUTO_SCALE:
+            statistics->getNonzeroRanges(mostNegativeOut, leastNegativeOut, leastPositiveOut, mostPositiveOut);
+            break;
+        case PaletteScaleModeEnum::MODE_AUTO_SCALE_ABSOLUTE_PERCENTAGE:
+        {
+            const float mostPercentage  = this->getAutoScaleAbsolutePercentageMaximum();
+            const float leastPercentage = this->getAutoScaleAbsolutePercentageMinimum();
+            mostNegativeOut  = -statistics->getApproxAbsolutePercentile(mostPercentage);
+            leastNegativeOut = -statistics->getApproxAbsolutePercentile(leastPercentage);
+            leastPositiveOut =  statistics->getApproxAbsolutePercentile(leastPercentage);
+            mostPositiveOut  =  statistics->getApproxAbsolutePercentile(mostPercentage);
+        }
+            break;
+        case PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE:
+        {
+            const float mostNegativePercentage  = this->getAutoScalePercentageNegativeMaximum();
+            const float leastNegativePercentage = this->getAutoScalePercentageNegativeMinimum();
+            const float leastPositivePercentage = this->getAutoScalePercentagePositiveMinimum();
+            const float mostPositivePercentage  = this->getAutoScalePercentagePositiveMaximum();
+            mostNegativeOut  = statistics->getApproxNegativePercentile(mostNegativePercentage);
+            leastNegativeOut = statistics->getApproxNegativePercentile(leastNegativePercentage);
+            leastPositiveOut = statistics->getApproxPositivePercentile(leastPositivePercentage);
+            mostPositiveOut  = statistics->getApproxPositivePercentile(mostPositivePercentage);
+        }
+            break;
+        case PaletteScaleModeEnum::MODE_USER_SCALE:
+            mostNegativeOut  = this->getUserScaleNegativeMaximum();
+            leastNegativeOut = this->getUserScaleNegativeMinimum();
+            leastPositiveOut = this->getUserScalePositiveMinimum();
+            mostPositiveOut  = this->getUserScalePositiveMaximum();
+            break;
+    }
+}
+
 /**
  * Map data values to palette normalized values using the
  * settings in this palette color mapping.
@@ -1897,39 +1959,11 @@ PaletteColorMapping::mapDataToPaletteNormalizedValues(const FastStatistics* stat
     float mappingLeastNegative = 0.0;
     float mappingLeastPositive  = 0.0;
     float mappingMostPositive  = 0.0;
-    switch (this->getScaleMode()) {
-        case PaletteScaleModeEnum::MODE_AUTO_SCALE:
-            statistics->getNonzeroRanges(mappingMostNegative, mappingLeastNegative, mappingLeastPositive, mappingMostPositive);
-            break;
-        case PaletteScaleModeEnum::MODE_AUTO_SCALE_ABSOLUTE_PERCENTAGE:
-        {
-            const float mostPercentage  = this->getAutoScaleAbsolutePercentageMaximum();
-            const float leastPercentage = this->getAutoScaleAbsolutePercentageMinimum();
-            mappingMostNegative  = -statistics->getApproxAbsolutePercentile(mostPercentage);
-            mappingLeastNegative = -statistics->getApproxAbsolutePercentile(leastPercentage);
-            mappingLeastPositive =  statistics->getApproxAbsolutePercentile(leastPercentage);
-            mappingMostPositive  =  statistics->getApproxAbsolutePercentile(mostPercentage);
-        }
-            break;
-        case PaletteScaleModeEnum::MODE_AUTO_SCALE_PERCENTAGE:
-        {
-            const float mostNegativePercentage  = this->getAutoScalePercentageNegativeMaximum();
-            const float leastNegativePercentage = this->getAutoScalePercentageNegativeMinimum();
-            const float leastPositivePercentage = this->getAutoScalePercentagePositiveMinimum();
-            const float mostPositivePercentage  = this->getAutoScalePercentagePositiveMaximum();
-            mappingMostNegative  = statistics->getApproxNegativePercentile(mostNegativePercentage);
-            mappingLeastNegative = statistics->getApproxNegativePercentile(leastNegativePercentage);
-            mappingLeastPositive = statistics->getApproxPositivePercentile(leastPositivePercentage);
-            mappingMostPositive  = statistics->getApproxPositivePercentile(mostPositivePercentage);
-        }
-            break;
-        case PaletteScaleModeEnum::MODE_USER_SCALE:
-            mappingMostNegative  = this->getUserScaleNegativeMaximum();
-            mappingLeastNegative = this->getUserScaleNegativeMinimum();
-            mappingLeastPositive = this->getUserScalePositiveMinimum();
-            mappingMostPositive  = this->getUserScalePositiveMaximum();
-            break;
-    }
+    getPaletteMappingRanges(statistics,
+                            mappingMostNegative,
+                            mappingLeastNegative,
+                            mappingLeastPositive,
+                            mappingMostPositive);
     //TSC: hack to do the min/max inversion without extra conditionals: swap most and least
     if (enable_normalization_flipping && invert_min_max)
     {
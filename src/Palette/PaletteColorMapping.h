@@ -288,6 +288,12 @@ namespace caret {
         
         PaletteModifiedStatusEnum::Enum getModifiedStatus() const;
         
+        void getPaletteMappingRanges(const FastStatistics* statistics,
+                                     float& mostNegativeOut,
+                                     float& leastNegativeOut,
+                                     float& leastPositiveOut,
+                                     float& mostPositiveOut) const;
+        
         void mapDataToPaletteNormalizedValues(const FastStatistics* statistics,
                                               const float* dataValues,
                                               float* normalizedValuesOut,
@@ -0,0 +1,221 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "BenchmarkData.h"
+
+#include "CaretAssert.h"
+#include "CiftiFile.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <QCoreApplication>
+#include <QDir>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //vertices and outward-facing triangles of a regular icosahedron
+    const double PHI = 1.618033988749895;
+    const double ICOSA_VERTS[12][3] = {
+        { -1.0,  PHI,  0.0 }, {  1.0,  PHI,  0.0 }, { -1.0, -PHI,  0.0 }, {  1.0, -PHI,  0.0 },
+        {  0.0, -1.0,  PHI }, {  0.0,  1.0,  PHI }, {  0.0, -1.0, -PHI }, {  0.0,  1.0, -PHI },
+        {  PHI,  0.0, -1.0 }, {  PHI,  0.0,  1.0 }, { -PHI,  0.0, -1.0 }, { -PHI,  0.0,  1.0 }
+    };
+    const int ICOSA_TRIS[20][3] = {
+        { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+        { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+        { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+        { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+    };
+    
+    //a subdivision point is identified exactly by its integer barycentric weights on icosahedron vertices,
+    //so points on shared edges get the same key (and the same computed coordinate) from either face
+    typedef vector<pair<int, int> > PointKey;
+    
+    PointKey makeKey(const int verts[3], const int weights[3])
+    {
+        PointKey ret;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (weights[i] > 0) ret.push_back(make_pair(verts[i], weights[i]));
+        }
+        sort(ret.begin(), ret.end());
+        return ret;
+    }
+    
+    CiftiBrainModelsMap makeCortexModels(const int64_t& numVertices)
+    {
+        CiftiBrainModelsMap ret;
+        ret.addSurfaceModel(numVertices, StructureEnum::CORTEX_LEFT);
+        return ret;
+    }
+    
+    int s_tempCounter = 0;
+}
+
+void BenchmarkData::makeSphere(SurfaceFile& surfOut, const int& frequency, const float& radius)
+{
+    CaretAssert(frequency > 0);
+    map<PointKey, int32_t> keyToVertex;
+    vector<float> coords;
+    vector<int32_t> triangles;
+    vector<int32_t> faceVerts;
+    for (int face = 0; face < 20; ++face)
+    {
+        const int* tri = ICOSA_TRIS[face];
+        faceVerts.resize((frequency + 1) * (frequency + 1));
+        for (int i = 0; i <= frequency; ++i)
+        {
+            for (int j = 0; i + j <= frequency; ++j)
+            {
+                const int weights[3] = { frequency - i - j, i, j };
+                PointKey key = makeKey(tri, weights);
+                map<PointKey, int32_t>::iterator iter = keyToVertex.find(key);
+                int32_t vertex;
+                if (iter == keyToVertex.end())
+                {
+                    vertex = coords.size() / 3;
+                    double point[3] = { 0.0, 0.0, 0.0 };
+                    for (size_t k = 0; k < key.size(); ++k)
+                    {
+                        for (int axis = 0; axis < 3; ++axis)
+                        {
+                            point[axis] += ICOSA_VERTS[key[k].first][axis] * key[k].second;
+                        }
+                    }
+                    const double length = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        coords.push_back(point[axis] * radius / length);
+                    }
+                    keyToVertex[key] = vertex;
+                } else {
+                    vertex = iter->second;
+                }
+                faceVerts[i * (frequency + 1) + j] = vertex;
+            }
+        }
+        for (int i = 0; i < frequency; ++i)
+        {
+            for (int j = 0; i + j < frequency; ++j)
+            {//same winding as the icosahedron face
+                triangles.push_back(faceVerts[i * (frequency + 1) + j]);
+                triangles.push_back(faceVerts[(i + 1) * (frequency + 1) + j]);
+                triangles.push_back(faceVerts[i * (frequency + 1) + j + 1]);
+                if (i + j + 1 < frequency)
+                {
+                    triangles.push_back(faceVerts[(i + 1) * (frequency + 1) + j]);
+                    triangles.push_back(faceVerts[(i + 1) * (frequency + 1) + j + 1]);
+                    triangles.push_back(faceVerts[i * (frequency + 1) + j + 1]);
+                }
+            }
+        }
+    }
+    const int32_t numVertices = coords.size() / 3;
+    const int32_t numTriangles = triangles.size() / 3;
+    CaretAssert(numVertices == 10 * frequency * frequency + 2);
+    CaretAssert(numTriangles == 20 * frequency * frequency);
+    surfOut.setNumberOfNodesAndTriangles(numVertices, numTriangles);
+    surfOut.setCoordinates(coords.data());
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        surfOut.setTriangle(i, triangles.data() + i * 3);
+    }
+    surfOut.setStructure(StructureEnum::CORTEX_LEFT);
+    surfOut.setSurfaceType(SurfaceTypeEnum::SPHERICAL);
+}
+
+void BenchmarkData::makeRandomData(vector<float>& dataOut, const int64_t& count, const unsigned int& seed)
+{
+    mt19937 generator(seed);
+    normal_distribution<float> distribution(0.0f, 1.0f);
+    dataOut.resize(count);
+    for (int64_t i = 0; i < count; ++i)
+    {
+        dataOut[i] = distribution(generator);
+    }
+}
+
+void BenchmarkData::writeDenseTimeseries(const AString& fileName, const int64_t& numVertices, const int64_t& numTimepoints, const unsigned int& seed)
+{
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    myXML.setMap(CiftiXML::ALONG_ROW, CiftiSeriesMap(numTimepoints));
+    myXML.setMap(CiftiXML::ALONG_COLUMN, makeCortexModels(numVertices));
+    CiftiFile myCifti;
+    myCifti.setWritingFile(fileName);
+    myCifti.setCiftiXML(myXML);
+    vector<float> row;
+    for (int64_t i = 0; i < numVertices; ++i)
+    {
+        makeRandomData(row, numTimepoints, seed + i);
+        myCifti.setRow(row.data(), i);
+    }
+    myCifti.close();
+}
+
+void BenchmarkData::writeDenseConnectivity(const AString& fileName, const int64_t& numVertices, const unsigned int& seed)
+{
+    CiftiXML myXML;
+    myXML.setNumberOfDimensions(2);
+    const CiftiBrainModelsMap models = makeCortexModels(numVertices);
+    myXML.setMap(CiftiXML::ALONG_ROW, models);
+    myXML.setMap(CiftiXML::ALONG_COLUMN, models);
+    CiftiFile myCifti;
+    myCifti.setWritingFile(fileName);
+    myCifti.setCiftiXML(myXML);
+    vector<float> row;
+    for (int64_t i = 0; i < numVertices; ++i)
+    {
+        makeRandomData(row, numVertices, seed + i);
+        myCifti.setRow(row.data(), i);
+    }
+    myCifti.close();
+}
+
+void BenchmarkData::writeVolumeSeries(const AString& fileName, const int64_t& numFrames, const unsigned int& seed)
+{
+    vector<int64_t> dims(3);
+    dims[0] = 91; dims[1] = 109; dims[2] = 91;
+    dims.push_back(numFrames);
+    vector<vector<float> > sform(3, vector<float>(4, 0.0f));
+    sform[0][0] = -2.0f; sform[0][3] = 90.0f;
+    sform[1][1] = 2.0f; sform[1][3] = -126.0f;
+    sform[2][2] = 2.0f; sform[2][3] = -72.0f;
+    VolumeFile myVol(dims, sform);
+    vector<float> frame;
+    for (int64_t t = 0; t < numFrames; ++t)
+    {
+        makeRandomData(frame, dims[0] * dims[1] * dims[2], seed + t);
+        myVol.setFrame(frame.data(), t);
+    }
+    myVol.writeFile(fileName);
+}
+
+AString BenchmarkData::getTempFileName(const AString& suffix)
+{
+    return QDir::tempPath() + "/wb_benchmark_" + AString::number(QCoreApplication::applicationPid()) + "_" + AString::number(s_tempCounter++) + suffix;
+}
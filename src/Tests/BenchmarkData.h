@@ -0,0 +1,51 @@
+#ifndef __BENCHMARK_DATA_H__
+#define __BENCHMARK_DATA_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "AString.h"
+
+#include <random>
+#include <vector>
+
+namespace caret {
+
+   class SurfaceFile;
+
+   ///reproducible synthetic inputs for benchmarks, everything is seeded so runs on different builds see identical data
+   class BenchmarkData
+   {
+      BenchmarkData();
+   public:
+      ///geodesic icosahedron with 10 * frequency^2 + 2 vertices: 57 gives 32492 (32k), 128 gives 163842 (164k)
+      static void makeSphere(SurfaceFile& surfOut, const int& frequency, const float& radius = 100.0f);
+      static void makeRandomData(std::vector<float>& dataOut, const int64_t& count, const unsigned int& seed);
+      ///dtseries with a single left cortex surface model
+      static void writeDenseTimeseries(const AString& fileName, const int64_t& numVertices, const int64_t& numTimepoints, const unsigned int& seed);
+      ///symmetric-sized dconn with a single left cortex surface model
+      static void writeDenseConnectivity(const AString& fileName, const int64_t& numVertices, const unsigned int& seed);
+      ///2mm MNI-sized 4D volume
+      static void writeVolumeSeries(const AString& fileName, const int64_t& numFrames, const unsigned int& seed);
+      ///unique name in the temporary directory, caller should remove the file
+      static AString getTempFileName(const AString& suffix);
+   };
+
+}
+#endif //__BENCHMARK_DATA_H__
@@ -0,0 +1,54 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "BenchmarkInterface.h"
+
+#include "CaretAssert.h"
+
+#include <iostream>
+
+using namespace caret;
+using namespace std;
+
+BenchmarkInterface::~BenchmarkInterface()
+{
+}
+
+void BenchmarkInterface::addResult(const AString& caseName, vector<double> times, const double& itemsPerRun, const AString& itemUnit)
+{
+   CaretAssert(!times.empty());
+   BenchmarkResult result;
+   result.m_case = caseName;
+   result.m_itemUnit = itemUnit;
+   result.m_itemsPerRun = itemsPerRun;
+   result.m_repetitions = (int)times.size();
+   sort(times.begin(), times.end());
+   result.m_minSeconds = times[0];
+   result.m_medianSeconds = times[times.size() / 2];
+   double sum = 0.0;
+   for (size_t i = 0; i < times.size(); ++i) sum += times[i];
+   result.m_meanSeconds = sum / times.size();
+   m_results.push_back(result);
+   cout << m_identifier << " " << caseName << ": median " << result.m_medianSeconds << " s";
+   if (itemsPerRun > 0.0 && result.m_medianSeconds > 0.0)
+   {
+      cout << ", " << itemsPerRun / result.m_medianSeconds << " " << itemUnit << "/s";
+   }
+   cout << endl;
+}
@@ -0,0 +1,84 @@
+#ifndef __BENCHMARK_INTERFACE_H__
+#define __BENCHMARK_INTERFACE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "AString.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace caret {
+
+   struct BenchmarkResult
+   {
+      AString m_case, m_itemUnit;
+      int m_repetitions;
+      double m_minSeconds, m_medianSeconds, m_meanSeconds, m_itemsPerRun;
+   };
+
+   class BenchmarkInterface
+   {
+      AString m_identifier;
+      std::vector<BenchmarkResult> m_results;
+      BenchmarkInterface();//deny construction without arguments
+      BenchmarkInterface& operator=(const BenchmarkInterface& right);//deny assignment
+   protected:
+      bool m_quick;//use smaller synthetic data, for a fast sanity run
+      BenchmarkInterface(const AString& identifier)
+      {
+         m_identifier = identifier;
+         m_quick = false;
+      }
+      ///run func once untimed (to warm caches and lazy initialization), then time it the given number of times
+      template<typename F>
+      void timeCase(const AString& caseName, const int& repetitions, const double& itemsPerRun, const AString& itemUnit, F func)
+      {
+         func();
+         std::vector<double> times;
+         for (int i = 0; i < repetitions; ++i)
+         {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            func();
+            times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+         }
+         addResult(caseName, times, itemsPerRun, itemUnit);
+      }
+      void addResult(const AString& caseName, std::vector<double> times, const double& itemsPerRun, const AString& itemUnit);
+   public:
+      const AString& getIdentifier() const
+      {
+         return m_identifier;
+      }
+      const std::vector<BenchmarkResult>& getResults() const
+      {
+         return m_results;
+      }
+      void setQuick(const bool& quick)
+      {
+         m_quick = quick;
+      }
+      virtual void execute() = 0;//override this
+      virtual ~BenchmarkInterface();
+   };
+
+}
+#endif //__BENCHMARK_INTERFACE_H__
@@ -0,0 +1,99 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiBenchmark.h"
+
+#include "BenchmarkData.h"
+#include "CiftiFile.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <random>
+
+using namespace caret;
+using namespace std;
+
+CiftiBenchmark::CiftiBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+void CiftiBenchmark::execute()
+{
+    const int64_t numVertices = 32492;
+    const int64_t numTimepoints = (m_quick ? 200 : 1200);
+    const AString dtseriesName = BenchmarkData::getTempFileName(".dtseries.nii");
+    const int64_t dconnVertices = (m_quick ? 2000 : 8000);
+    const AString dconnName = BenchmarkData::getTempFileName(".dconn.nii");
+    try
+    {
+        BenchmarkData::writeDenseTimeseries(dtseriesName, numVertices, numTimepoints, 10);
+        BenchmarkData::writeDenseConnectivity(dconnName, dconnVertices, 20);
+        vector<float> scratch(max(numVertices, max(numTimepoints, dconnVertices)));
+        
+        CiftiFile dtseries(dtseriesName);//on-disk reading
+        timeCase("dtseries all rows on disk", 3, numVertices * numTimepoints * sizeof(float), "bytes", [&]()
+        {
+            for (int64_t i = 0; i < numVertices; ++i)
+            {
+                dtseries.getRow(scratch.data(), i);
+            }
+        });
+        const int64_t numColumns = 10;
+        timeCase("dtseries columns on disk", 3, numColumns, "columns", [&]()
+        {
+            for (int64_t i = 0; i < numColumns; ++i)
+            {
+                dtseries.getColumn(scratch.data(), i * numTimepoints / numColumns);
+            }
+        });
+        timeCase("dtseries read to memory", 3, numVertices * numTimepoints * sizeof(float), "bytes", [&]()
+        {
+            CiftiFile inMemory(dtseriesName);
+            inMemory.convertToInMemory();
+        });
+        CiftiFile inMemory(dtseriesName);
+        inMemory.convertToInMemory();
+        timeCase("dtseries columns in memory", 5, numTimepoints, "columns", [&]()
+        {
+            for (int64_t i = 0; i < numTimepoints; ++i)
+            {
+                inMemory.getColumn(scratch.data(), i);
+            }
+        });
+        
+        CiftiFile dconn(dconnName);
+        mt19937 generator(5);
+        vector<int64_t> randomRows(1000);
+        for (size_t i = 0; i < randomRows.size(); ++i) randomRows[i] = generator() % dconnVertices;
+        timeCase("dconn random rows on disk", 5, randomRows.size(), "rows", [&]()
+        {
+            for (size_t i = 0; i < randomRows.size(); ++i)
+            {
+                dconn.getRow(scratch.data(), randomRows[i]);
+            }
+        });
+    } catch (...) {
+        QFile::remove(dtseriesName);
+        QFile::remove(dconnName);
+        throw;
+    }
+    QFile::remove(dtseriesName);
+    QFile::remove(dconnName);
+}
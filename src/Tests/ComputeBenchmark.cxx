@@ -0,0 +1,78 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "ComputeBenchmark.h"
+
+#include "BenchmarkData.h"
+#include "CaretMathExpression.h"
+#include "dot_wrapper.h"
+
+using namespace caret;
+using namespace std;
+
+ComputeBenchmark::ComputeBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+void ComputeBenchmark::execute()
+{
+    const int rowLength = (m_quick ? 300 : 1200);
+    const int numRows = 2000, numSeeds = (m_quick ? 20 : 200);
+    vector<float> rows;
+    BenchmarkData::makeRandomData(rows, (int64_t)rowLength * numRows, 40);
+    vector<DotSIMDEnum::Enum> impls = DotSIMDEnum::getAllEnums();
+    double checksum = 0.0;//keep the compiler from dropping the dot products
+    for (size_t whichImpl = 0; whichImpl < impls.size(); ++whichImpl)
+    {
+        const DotSIMDEnum::Enum used = dot_set_impl(impls[whichImpl]);
+        if (impls[whichImpl] != DOT_AUTO && used != impls[whichImpl]) continue;//not supported by this cpu or build
+        timeCase("correlation dot " + DotSIMDEnum::toName(impls[whichImpl]), 5, (double)numSeeds * numRows, "dots", [&]()
+        {
+            for (int seed = 0; seed < numSeeds; ++seed)
+            {
+                const float* seedRow = rows.data() + (int64_t)seed * rowLength;
+                for (int row = 0; row < numRows; ++row)
+                {
+                    checksum += dsdot(seedRow, rows.data() + (int64_t)row * rowLength, rowLength);
+                }
+            }
+        });
+    }
+    dot_set_impl(DOT_AUTO);
+    
+    CaretMathExpression myExpr("sin(x) * y + exp(-x^2) / 2");
+    const vector<AString> varNames = myExpr.getVarNames();
+    const int64_t numValues = (m_quick ? 100000 : 1000000);
+    vector<vector<float> > varData(varNames.size());
+    for (size_t i = 0; i < varNames.size(); ++i)
+    {
+        BenchmarkData::makeRandomData(varData[i], numValues, 50 + i);
+    }
+    vector<float> values(varNames.size());
+    timeCase("math expression evaluate", 5, numValues, "evaluations", [&]()
+    {
+        for (int64_t j = 0; j < numValues; ++j)
+        {
+            for (size_t i = 0; i < varNames.size(); ++i) values[i] = varData[i][j];
+            checksum += myExpr.evaluate(values);
+        }
+    });
+    volatile double sink = checksum;//use the checksum
+    (void)sink;
+}
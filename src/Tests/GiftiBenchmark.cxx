@@ -0,0 +1,78 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "GiftiBenchmark.h"
+
+#include "BenchmarkData.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+
+#include <QFile>
+
+using namespace caret;
+using namespace std;
+
+GiftiBenchmark::GiftiBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+void GiftiBenchmark::execute()
+{
+    const int32_t numNodes = (m_quick ? 32492 : 163842);
+    const int32_t numColumns = 20;
+    const AString metricName = BenchmarkData::getTempFileName(".func.gii");
+    const AString surfaceName = BenchmarkData::getTempFileName(".surf.gii");
+    try
+    {
+        MetricFile myMetric;
+        myMetric.setNumberOfNodesAndColumns(numNodes, numColumns);
+        myMetric.setStructure(StructureEnum::CORTEX_LEFT);
+        vector<float> values;
+        for (int32_t i = 0; i < numColumns; ++i)
+        {
+            BenchmarkData::makeRandomData(values, numNodes, 60 + i);
+            myMetric.setValuesForColumn(i, values.data());
+        }
+        const double metricBytes = (double)numNodes * numColumns * sizeof(float);
+        timeCase("metric write", 3, metricBytes, "bytes", [&]()
+        {
+            myMetric.writeFile(metricName);
+        });
+        timeCase("metric decode", 5, metricBytes, "bytes", [&]()
+        {
+            MetricFile readMetric;
+            readMetric.readFile(metricName);
+        });
+        
+        SurfaceFile mySurf;
+        BenchmarkData::makeSphere(mySurf, (m_quick ? 57 : 128));
+        mySurf.writeFile(surfaceName);
+        timeCase("surface decode", 5, mySurf.getNumberOfNodes(), "vertices", [&]()
+        {
+            SurfaceFile readSurf;
+            readSurf.readFile(surfaceName);
+        });
+    } catch (...) {
+        QFile::remove(metricName);
+        QFile::remove(surfaceName);
+        throw;
+    }
+    QFile::remove(metricName);
+    QFile::remove(surfaceName);
+}
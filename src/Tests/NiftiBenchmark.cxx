@@ -0,0 +1,82 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "NiftiBenchmark.h"
+
+#include "BenchmarkData.h"
+#include "NiftiIO.h"
+#include "VolumeFile.h"
+
+#include <QFile>
+
+using namespace caret;
+using namespace std;
+
+NiftiBenchmark::NiftiBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+void NiftiBenchmark::execute()
+{
+    const int64_t numFrames = (m_quick ? 10 : 50);
+    vector<AString> extensions;
+    extensions.push_back(".nii");
+    extensions.push_back(".nii.gz");
+    for (size_t whichExt = 0; whichExt < extensions.size(); ++whichExt)
+    {
+        const AString fileName = BenchmarkData::getTempFileName(extensions[whichExt]);
+        const AString outName = BenchmarkData::getTempFileName(extensions[whichExt]);
+        try
+        {
+            BenchmarkData::writeVolumeSeries(fileName, numFrames, 30);
+            NiftiIO myIO;
+            myIO.openRead(fileName);
+            const vector<int64_t>& dims = myIO.getDimensions();
+            const int64_t frameSize = dims[0] * dims[1] * dims[2];
+            vector<float> frame(frameSize);
+            vector<int64_t> indexSelect(1);
+            timeCase("readData frames " + extensions[whichExt], 3, numFrames * frameSize * sizeof(float), "bytes", [&]()
+            {
+                for (int64_t t = 0; t < numFrames; ++t)
+                {
+                    indexSelect[0] = t;
+                    myIO.readData(frame.data(), 3, indexSelect);
+                }
+            });
+            myIO.close();
+            timeCase("VolumeFile read " + extensions[whichExt], 3, numFrames * frameSize * sizeof(float), "bytes", [&]()
+            {
+                VolumeFile myVol;
+                myVol.readFile(fileName);
+            });
+            VolumeFile myVol;
+            myVol.readFile(fileName);
+            timeCase("VolumeFile write " + extensions[whichExt], 3, numFrames * frameSize * sizeof(float), "bytes", [&]()
+            {
+                myVol.writeFile(outName);
+            });
+        } catch (...) {
+            QFile::remove(fileName);
+            QFile::remove(outName);
+            throw;
+        }
+        QFile::remove(fileName);
+        QFile::remove(outName);
+    }
+}
@@ -0,0 +1,152 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "SurfaceBenchmark.h"
+
+#include "BenchmarkData.h"
+#include "CaretPointLocator.h"
+#include "GeodesicHelper.h"
+#include "MetricFile.h"
+#include "MetricSmoothingObject.h"
+#include "SurfaceFile.h"
+#include "SurfaceResamplingHelper.h"
+
+#include <cmath>
+#include <random>
+
+using namespace caret;
+using namespace std;
+
+SurfaceBenchmark::SurfaceBenchmark(const AString& identifier) : BenchmarkInterface(identifier)
+{
+}
+
+namespace
+{
+    AString sizeName(const SurfaceFile& mySurf)
+    {
+        return AString::number((mySurf.getNumberOfNodes() + 500) / 1000) + "k";
+    }
+    
+    void randomSpherePoints(vector<float>& pointsOut, const int64_t& count, const float& radius, const unsigned int& seed)
+    {
+        BenchmarkData::makeRandomData(pointsOut, count * 3, seed);
+        for (int64_t i = 0; i < count; ++i)
+        {
+            float* point = pointsOut.data() + i * 3;
+            const float length = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+            for (int axis = 0; axis < 3; ++axis) point[axis] *= radius / length;
+        }
+    }
+}
+
+void SurfaceBenchmark::execute()
+{
+    vector<int> frequencies;
+    frequencies.push_back(57);//32k
+    if (!m_quick) frequencies.push_back(128);//164k
+    vector<CaretPointer<SurfaceFile> > spheres;
+    for (size_t whichSize = 0; whichSize < frequencies.size(); ++whichSize)
+    {
+        CaretPointer<SurfaceFile> mySurf(new SurfaceFile());
+        BenchmarkData::makeSphere(*mySurf, frequencies[whichSize]);
+        spheres.push_back(mySurf);
+        const int32_t numNodes = mySurf->getNumberOfNodes();
+        const AString size = sizeName(*mySurf);
+        
+        timeCase("geodesic helper build " + size, 3, numNodes, "vertices", [&]()
+        {
+            CaretPointer<GeodesicHelperBase> myBase(new GeodesicHelperBase(mySurf));
+        });
+        CaretPointer<GeodesicHelper> myGeoHelp = mySurf->getGeodesicHelper();
+        mt19937 generator(1);
+        vector<int32_t> seedNodes(m_quick ? 50 : 500);
+        for (size_t i = 0; i < seedNodes.size(); ++i) seedNodes[i] = generator() % numNodes;
+        vector<int32_t> nodes;
+        vector<float> dists;
+        timeCase("geodesic 10mm " + size, 5, seedNodes.size(), "searches", [&]()
+        {
+            for (size_t i = 0; i < seedNodes.size(); ++i)
+            {
+                myGeoHelp->getNodesToGeoDist(seedNodes[i], 10.0f, nodes, dists);
+            }
+        });
+        
+        timeCase("point locator build " + size, 5, numNodes, "vertices", [&]()
+        {
+            CaretPointLocator myLocator(mySurf->getCoordinateData(), numNodes);
+        });
+        CaretPointLocator myLocator(mySurf->getCoordinateData(), numNodes);
+        vector<float> queries;
+        const int64_t numQueries = (m_quick ? 10000 : 100000);
+        randomSpherePoints(queries, numQueries, 100.0f, 2);
+        timeCase("closest point " + size, 5, numQueries, "queries", [&]()
+        {
+            for (int64_t i = 0; i < numQueries; ++i)
+            {
+                myLocator.closestPoint(queries.data() + i * 3);
+            }
+        });
+        
+        MetricFile myMetric, smoothedMetric;
+        myMetric.setNumberOfNodesAndColumns(numNodes, 1);
+        myMetric.setStructure(StructureEnum::CORTEX_LEFT);
+        vector<float> values;
+        BenchmarkData::makeRandomData(values, numNodes, 3);
+        myMetric.setValuesForColumn(0, values.data());
+        timeCase("metric smoothing setup 4mm " + size, 3, numNodes, "vertices", [&]()
+        {
+            MetricSmoothingObject mySmooth(mySurf, 4.0f);
+        });
+        MetricSmoothingObject mySmooth(mySurf, 4.0f);
+        timeCase("metric smoothing column 4mm " + size, 5, numNodes, "vertices", [&]()
+        {
+            mySmooth.smoothColumn(&myMetric, 0, &smoothedMetric);
+        });
+    }
+    
+    //resample from the largest sphere to the smallest, or to a 16k sphere in quick mode
+    CaretPointer<SurfaceFile> fromSphere = spheres.back(), toSphere = spheres.front();
+    if (spheres.size() == 1)
+    {
+        toSphere.grabNew(new SurfaceFile());
+        BenchmarkData::makeSphere(*toSphere, 40);
+    }
+    vector<float> fromAreas, toAreas;
+    fromSphere->computeNodeAreas(fromAreas);
+    toSphere->computeNodeAreas(toAreas);
+    const AString resampleName = sizeName(*fromSphere) + " to " + sizeName(*toSphere);
+    vector<SurfaceResamplingMethodEnum::Enum> methods;
+    SurfaceResamplingMethodEnum::getAllEnums(methods);
+    vector<float> input, output(toSphere->getNumberOfNodes());
+    BenchmarkData::makeRandomData(input, fromSphere->getNumberOfNodes(), 4);
+    for (size_t i = 0; i < methods.size(); ++i)
+    {
+        const AString methodName = SurfaceResamplingMethodEnum::toName(methods[i]);
+        timeCase("resampling setup " + methodName + " " + resampleName, 3, toSphere->getNumberOfNodes(), "vertices", [&]()
+        {
+            SurfaceResamplingHelper myHelp(methods[i], fromSphere, toSphere, fromAreas.data(), toAreas.data());
+        });
+        SurfaceResamplingHelper myHelp(methods[i], fromSphere, toSphere, fromAreas.data(), toAreas.data());
+        timeCase("resampling column " + methodName + " " + resampleName, 10, toSphere->getNumberOfNodes(), "vertices", [&]()
+        {
+            myHelp.resampleNormal(input.data(), output.data());
+        });
+    }
+}
@@ -0,0 +1,187 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+//program for running benchmarks
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "ApplicationInformation.h"
+#include "BenchmarkInterface.h"
+#include "CaretCommandLine.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "SessionManager.h"
+#include "SystemUtilities.h"
+
+//benchmarks
+#include "CiftiBenchmark.h"
+#include "ComputeBenchmark.h"
+#include "GiftiBenchmark.h"
+#include "NiftiBenchmark.h"
+#include "SurfaceBenchmark.h"
+
+using namespace std;
+using namespace caret;
+
+void freeBenchmarkList(vector<BenchmarkInterface*>& mylist)
+{
+    for (int i = 0; i < (int)mylist.size(); ++i)
+    {
+        delete mylist[i];
+    }
+}
+
+QJsonObject resultsToJson(const vector<BenchmarkInterface*>& ran, const bool& quick)
+{
+    ApplicationInformation appInfo;
+    QJsonObject root;
+    root["version"] = appInfo.getVersion();
+    root["commit"] = appInfo.getCommit();
+    root["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["host"] = SystemUtilities::getLocalHostName();
+    root["processors"] = SystemUtilities::getNumberOfProcessors();
+    int numThreads = 1;
+#ifdef CARET_OMP
+    numThreads = omp_get_max_threads();
+#endif
+    root["omp_threads"] = numThreads;
+    root["quick"] = quick;
+    QJsonArray results;
+    for (size_t i = 0; i < ran.size(); ++i)
+    {
+        const vector<BenchmarkResult>& benchResults = ran[i]->getResults();
+        for (size_t j = 0; j < benchResults.size(); ++j)
+        {
+            const BenchmarkResult& result = benchResults[j];
+            QJsonObject item;
+            item["benchmark"] = ran[i]->getIdentifier();
+            item["case"] = result.m_case;
+            item["repetitions"] = result.m_repetitions;
+            item["min_seconds"] = result.m_minSeconds;
+            item["median_seconds"] = result.m_medianSeconds;
+            item["mean_seconds"] = result.m_meanSeconds;
+            if (result.m_itemsPerRun > 0.0 && result.m_medianSeconds > 0.0)
+            {
+                item["unit"] = result.m_itemUnit;
+                item["items_per_run"] = result.m_itemsPerRun;
+                item["items_per_second"] = result.m_itemsPerRun / result.m_medianSeconds;
+            }
+            results.append(item);
+        }
+    }
+    root["results"] = results;
+    return root;
+}
+
+int main(int argc, char** argv)
+{
+    srand(time(NULL));
+    int ret = 0;
+    {
+        QCoreApplication myApp(argc, argv);
+        caret_global_commandLine_init(argc, argv);
+        SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
+        vector<BenchmarkInterface*> mybenchmarks;
+        mybenchmarks.push_back(new CiftiBenchmark("cifti"));
+        mybenchmarks.push_back(new ComputeBenchmark("compute"));
+        mybenchmarks.push_back(new GiftiBenchmark("gifti"));
+        mybenchmarks.push_back(new NiftiBenchmark("nifti"));
+        mybenchmarks.push_back(new SurfaceBenchmark("surface"));
+        bool quick = false;
+        AString jsonName;
+        vector<AString> requested;
+        for (int i = 1; i < argc; ++i)
+        {
+            const AString arg(argv[i]);
+            if (arg == "-quick")
+            {
+                quick = true;
+            } else if (arg == "-json" && i + 1 < argc) {
+                jsonName = AString(argv[++i]);
+            } else {
+                requested.push_back(arg);
+            }
+        }
+        if (requested.empty())
+        {
+            cout << "usage: benchmark_driver [-quick] [-json <file>] <benchmark>..." << endl;
+            cout << "   -quick: use smaller synthetic data" << endl;
+            cout << "   -json: write results to <file> as JSON" << endl;
+            cout << "No benchmark specified, please specify 'all' or one or more of the following:" << endl;
+            for (int i = 0; i < (int)mybenchmarks.size(); ++i)
+            {
+                cout << mybenchmarks[i]->getIdentifier() << endl;
+            }
+            freeBenchmarkList(mybenchmarks);
+            return 1;
+        }
+        vector<BenchmarkInterface*> ran;
+        int failCount = 0;
+        for (int j = 0; j < (int)mybenchmarks.size(); ++j)
+        {
+            bool wanted = false;
+            for (size_t i = 0; i < requested.size(); ++i)
+            {
+                if (mybenchmarks[j]->getIdentifier() == requested[i] || "all" == requested[i]) wanted = true;
+            }
+            if (!wanted) continue;
+            mybenchmarks[j]->setQuick(quick);
+            try
+            {
+                mybenchmarks[j]->execute();
+            } catch (CaretException& e) {
+                ++failCount;
+                cout << "Benchmark " << mybenchmarks[j]->getIdentifier() << " failed, exception: " << e.whatString() << endl;
+            }
+            ran.push_back(mybenchmarks[j]);//partial results are still useful
+        }
+        if (jsonName != "")
+        {
+            QFile jsonFile(jsonName);
+            if (jsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            {
+                jsonFile.write(QJsonDocument(resultsToJson(ran, quick)).toJson());
+            } else {
+                cout << "failed to open '" << jsonName << "' for writing" << endl;
+                ++failCount;
+            }
+        }
+        freeBenchmarkList(mybenchmarks);
+        if (failCount != 0)
+        {
+            cout << "Total of " << failCount << " benchmarks failed!" << endl;
+            ret = 1;
+        }
+        SessionManager::deleteSessionManager();
+        myApp.processEvents();
+    }
+    CaretObject::printListOfObjectsNotDeleted(true);
+    return ret;
+}